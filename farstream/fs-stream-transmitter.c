@@ -71,6 +71,11 @@ enum
 struct _FsStreamTransmitterPrivate
 {
   gboolean disposed;
+
+  /* Serializes the changes and the calls to the source_validated vfunc,
+   * so the subclass always ends with the stored value */
+  GMutex source_validated_mutex;
+  volatile gint source_validated;
 };
 
 G_DEFINE_ABSTRACT_TYPE(FsStreamTransmitter, fs_stream_transmitter,
@@ -90,6 +95,8 @@ static void fs_stream_transmitter_set_property (GObject *object,
                                                 const GValue *value,
                                                 GParamSpec *pspec);
 
+static void fs_stream_transmitter_finalize (GObject *object);
+
 static guint signals[LAST_SIGNAL] = { 0 };
 
 static void
@@ -101,6 +108,7 @@ fs_stream_transmitter_class_init (FsStreamTransmitterClass *klass)
 
   gobject_class->set_property = fs_stream_transmitter_set_property;
   gobject_class->get_property = fs_stream_transmitter_get_property;
+  gobject_class->finalize = fs_stream_transmitter_finalize;
 
 
   /**
@@ -226,7 +234,8 @@ fs_stream_transmitter_class_init (FsStreamTransmitterClass *klass)
    * @buffer: the #GstBuffer coming from the known source
    *
    * This signal is emitted when a buffer coming from a confirmed known source
-   * is received.
+   * is received. It may stop being emitted once
+   * fs_stream_transmitter_set_source_validated() has been called.
    */
   signals[KNOWN_SOURCE_PACKET_RECEIVED] = g_signal_new
     ("known-source-packet-received",
@@ -262,6 +271,17 @@ fs_stream_transmitter_init (FsStreamTransmitter *self)
   /* member init */
   self->priv = FS_STREAM_TRANSMITTER_GET_PRIVATE (self);
   self->priv->disposed = FALSE;
+  g_mutex_init (&self->priv->source_validated_mutex);
+}
+
+static void
+fs_stream_transmitter_finalize (GObject *object)
+{
+  FsStreamTransmitter *self = FS_STREAM_TRANSMITTER (object);
+
+  g_mutex_clear (&self->priv->source_validated_mutex);
+
+  G_OBJECT_CLASS (fs_stream_transmitter_parent_class)->finalize (object);
 }
 
 static void
@@ -321,6 +341,8 @@ fs_stream_transmitter_add_remote_candidates (
   g_return_val_if_fail (FS_IS_STREAM_TRANSMITTER (streamtransmitter), FALSE);
   klass = FS_STREAM_TRANSMITTER_GET_CLASS (streamtransmitter);
 
+  fs_stream_transmitter_set_source_validated (streamtransmitter, FALSE);
+
   if (klass->add_remote_candidates) {
     return klass->add_remote_candidates (streamtransmitter, candidates, error);
   } else {
@@ -357,6 +379,8 @@ fs_stream_transmitter_force_remote_candidates (
   g_return_val_if_fail (FS_IS_STREAM_TRANSMITTER (streamtransmitter), FALSE);
   klass = FS_STREAM_TRANSMITTER_GET_CLASS (streamtransmitter);
 
+  fs_stream_transmitter_set_source_validated (streamtransmitter, FALSE);
+
   if (klass->force_remote_candidates) {
     return klass->force_remote_candidates (streamtransmitter,
         remote_candidates, error);
@@ -420,6 +444,66 @@ fs_stream_transmitter_stop (FsStreamTransmitter *streamtransmitter)
     klass->stop (streamtransmitter);
 }
 
+/**
+ * fs_stream_transmitter_set_source_validated:
+ * @streamtransmitter: a #FsStreamTransmitter
+ * @validated: %TRUE if the data coming from the known source has been
+ *   associated, %FALSE to ask for #FsStreamTransmitter::known-source-packet-received
+ *   again
+ *
+ * Tells the stream transmitter that whoever listens to
+ * #FsStreamTransmitter::known-source-packet-received has associated the data
+ * coming from the current remote source and does not need to see more of it.
+ * While the source is validated, the stream transmitter may stop emitting
+ * the signal and skip any per-packet work needed to emit it.
+ *
+ * The validation is dropped whenever remote candidates are added or forced.
+ *
+ * This function can be called from any thread.
+ */
+
+void
+fs_stream_transmitter_set_source_validated (
+    FsStreamTransmitter *streamtransmitter,
+    gboolean validated)
+{
+  FsStreamTransmitterClass *klass;
+
+  g_return_if_fail (FS_IS_STREAM_TRANSMITTER (streamtransmitter));
+  klass = FS_STREAM_TRANSMITTER_GET_CLASS (streamtransmitter);
+
+  validated = !!validated;
+
+  g_mutex_lock (&streamtransmitter->priv->source_validated_mutex);
+  if (g_atomic_int_get (&streamtransmitter->priv->source_validated) !=
+      validated)
+  {
+    g_atomic_int_set (&streamtransmitter->priv->source_validated, validated);
+
+    if (klass->source_validated)
+      klass->source_validated (streamtransmitter, validated);
+  }
+  g_mutex_unlock (&streamtransmitter->priv->source_validated_mutex);
+}
+
+/**
+ * fs_stream_transmitter_get_source_validated:
+ * @streamtransmitter: a #FsStreamTransmitter
+ *
+ * Checks if the known source has been validated with
+ * fs_stream_transmitter_set_source_validated(). This does not take any lock,
+ * so subclasses can call it from their streaming threads.
+ *
+ * Returns: %TRUE if the known source is validated
+ */
+
+gboolean
+fs_stream_transmitter_get_source_validated (
+    FsStreamTransmitter *streamtransmitter)
+{
+  return g_atomic_int_get (&streamtransmitter->priv->source_validated);
+}
+
 
 /**
  * fs_stream_transmitter_emit_error:
@@ -61,6 +61,9 @@ typedef struct _FsStreamTransmitterPrivate FsStreamTransmitterPrivate;
  * @gather_local_candidates: Starts the gathering of local candidates
  * @stop: Stop the stream transmitter synchronously (does any Gst stopping
  * that needs to be done)
+ * @source_validated: Called when the validation state of the known source
+ * changes, see fs_stream_transmitter_set_source_validated(). The calls are
+ * serialized by an internal lock, so it must not call that function.
  *
  * You must override the add_remote_candidate in a subclass
  */
@@ -79,9 +82,11 @@ struct _FsStreamTransmitterClass
   gboolean (*gather_local_candidates) (FsStreamTransmitter *streamtransmitter,
                                        GError **error);
   void (*stop) (FsStreamTransmitter *streamtransmitter);
+  void (*source_validated) (FsStreamTransmitter *streamtransmitter,
+      gboolean validated);
 
   /*< private >*/
-  gpointer _padding[8];
+  gpointer _padding[7];
 };
 
 /**
@@ -117,6 +122,13 @@ fs_stream_transmitter_gather_local_candidates (
 
 void fs_stream_transmitter_stop (FsStreamTransmitter *streamtransmitter);
 
+void fs_stream_transmitter_set_source_validated (
+    FsStreamTransmitter *streamtransmitter,
+    gboolean validated);
+
+gboolean fs_stream_transmitter_get_source_validated (
+    FsStreamTransmitter *streamtransmitter);
+
 void fs_stream_transmitter_emit_error (FsStreamTransmitter *streamtransmitter,
     gint error_no,
     const gchar *error_msg);
@@ -0,0 +1,502 @@
+/*
+ * Farstream - Farstream RTP Bandwidth Allocator
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-bandwidth-allocator.c - Shares the estimated bandwidth between
+ *  the sessions sending to the same peer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "fs-rtp-bandwidth-allocator.h"
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+GST_DEBUG_CATEGORY_EXTERN (fsrtpconference_debug);
+
+/*
+ * This is a flow state exchange as in RFC 8699: the flows that go to the
+ * same peer are put in one group, and the sum of what their congestion
+ * controllers estimate is taken as the capacity of the path. It is then
+ * shared again between them, the protected flows (the audio) first get
+ * the bitrate the application set for them, and what is left is split in
+ * proportion to the priorities of the others. Each flow is then told its
+ * share. A protected flow the application set no bitrate for keeps what
+ * its own controller estimates, nothing is made up for it.
+ *
+ * The controllers are not fed back the share, so it is the passive
+ * variant of the algorithm: the sum of their estimates converges to the
+ * capacity of the bottleneck even if each of them oscillates, and the
+ * encoders follow the share instead of their own controller.
+ *
+ * A flow that is not in any group is given what its controller estimates.
+ */
+
+/* What each other flow keeps if the path can not carry the protected ones */
+#define MIN_SHARED_BITRATE (16 * 1000)
+
+struct _FsRtpBandwidthAllocator {
+  volatile gint refcount;
+
+  GMutex mutex;
+
+  /* Protected by the mutex */
+  /* of Flow */
+  GList *flows;
+};
+
+typedef struct {
+  GObject *flow;
+  FsRtpBandwidthAllocatorFunc func;
+
+  gpointer group;
+  gboolean protected;
+  guint priority;
+  guint desired;
+
+  /* What its controller estimates, 0 if it has none */
+  guint estimate;
+  /* Its share, 0 until it got one */
+  guint allocated;
+} Flow;
+
+typedef struct {
+  GObject *flow;
+  FsRtpBandwidthAllocatorFunc func;
+  guint bitrate;
+} Change;
+
+#define FS_RTP_BANDWIDTH_ALLOCATOR_LOCK(a) g_mutex_lock (&(a)->mutex)
+#define FS_RTP_BANDWIDTH_ALLOCATOR_UNLOCK(a) g_mutex_unlock (&(a)->mutex)
+
+FsRtpBandwidthAllocator *
+fs_rtp_bandwidth_allocator_new (void)
+{
+  FsRtpBandwidthAllocator *self = g_slice_new0 (FsRtpBandwidthAllocator);
+
+  self->refcount = 1;
+  g_mutex_init (&self->mutex);
+
+  return self;
+}
+
+FsRtpBandwidthAllocator *
+fs_rtp_bandwidth_allocator_ref (FsRtpBandwidthAllocator *allocator)
+{
+  g_atomic_int_inc (&allocator->refcount);
+
+  return allocator;
+}
+
+void
+fs_rtp_bandwidth_allocator_unref (FsRtpBandwidthAllocator *allocator)
+{
+  if (!g_atomic_int_dec_and_test (&allocator->refcount))
+    return;
+
+  if (allocator->flows)
+    GST_WARNING ("Bandwidth allocator freed with %u flows left",
+        g_list_length (allocator->flows));
+  g_list_free_full (allocator->flows, (GDestroyNotify) g_free);
+  g_mutex_clear (&allocator->mutex);
+  g_slice_free (FsRtpBandwidthAllocator, allocator);
+}
+
+static Flow *
+find_flow (FsRtpBandwidthAllocator *self, GObject *flow)
+{
+  GList *item;
+
+  for (item = self->flows; item; item = item->next)
+  {
+    Flow *f = item->data;
+
+    if (f->flow == flow)
+      return f;
+  }
+
+  return NULL;
+}
+
+static void
+set_allocation (Flow *f, guint bitrate, GList **changes)
+{
+  Change *change;
+
+  if (bitrate == 0 || bitrate == f->allocated)
+    return;
+
+  f->allocated = bitrate;
+
+  change = g_slice_new (Change);
+  change->flow = g_object_ref (f->flow);
+  change->func = f->func;
+  change->bitrate = bitrate;
+  *changes = g_list_append (*changes, change);
+}
+
+static guint64
+get_group_estimate (FsRtpBandwidthAllocator *self, gpointer group,
+    guint *n_flows)
+{
+  GList *item;
+  guint64 total = 0;
+
+  if (n_flows)
+    *n_flows = 0;
+
+  for (item = self->flows; item; item = item->next)
+  {
+    Flow *f = item->data;
+
+    if (f->group != group)
+      continue;
+    total += f->estimate;
+    if (n_flows)
+      (*n_flows)++;
+  }
+
+  return total;
+}
+
+/* What a protected flow takes before the others */
+
+static guint
+get_protected_bitrate (Flow *f)
+{
+  return f->desired ? f->desired : f->estimate;
+}
+
+static void
+allocate_group_locked (FsRtpBandwidthAllocator *self, gpointer group,
+    GList **changes)
+{
+  GList *item;
+  guint64 total;
+  guint64 wanted = 0;
+  guint64 budget;
+  guint64 left;
+  guint64 priorities = 0;
+  guint n_shared = 0;
+
+  total = get_group_estimate (self, group, NULL);
+
+  /* Nothing is known about the path yet */
+  if (total == 0)
+    return;
+
+  for (item = self->flows; item; item = item->next)
+  {
+    Flow *f = item->data;
+
+    if (f->group != group)
+      continue;
+
+    if (f->protected)
+      wanted += get_protected_bitrate (f);
+    else if (f->estimate)
+    {
+      priorities += f->priority;
+      n_shared++;
+    }
+  }
+
+  /* If the path can not even carry the protected flows, they share what
+   * is left after a minimum for the others */
+  budget = total - MIN ((guint64) n_shared * MIN_SHARED_BITRATE, total);
+  left = total;
+  for (item = self->flows; item; item = item->next)
+  {
+    Flow *f = item->data;
+    guint64 want;
+
+    if (f->group != group || !f->protected)
+      continue;
+
+    want = get_protected_bitrate (f);
+    if (wanted > budget)
+      want = want * budget / wanted;
+    set_allocation (f, want, changes);
+    left -= MIN (want, left);
+  }
+
+  /* The flows without an estimate are not sending, they get nothing */
+  if (priorities == 0)
+    return;
+
+  for (item = self->flows; item; item = item->next)
+  {
+    Flow *f = item->data;
+
+    if (f->group != group || f->protected || !f->estimate)
+      continue;
+
+    set_allocation (f, left * f->priority / priorities, changes);
+  }
+
+  GST_LOG ("Shared %" G_GUINT64_FORMAT " bits/s of group %p, %"
+      G_GUINT64_FORMAT " to the protected flows", total, group,
+      MIN (wanted, budget));
+}
+
+static void
+allocate_locked (FsRtpBandwidthAllocator *self, Flow *f, GList **changes)
+{
+  if (f->group)
+    allocate_group_locked (self, f->group, changes);
+  else if (!f->protected || !f->desired)
+    set_allocation (f, f->estimate, changes);
+}
+
+static void
+apply_changes (GList *changes)
+{
+  GList *item;
+
+  for (item = changes; item; item = item->next)
+  {
+    Change *change = item->data;
+
+    change->func (change->flow, change->bitrate);
+    g_object_unref (change->flow);
+    g_slice_free (Change, change);
+  }
+
+  g_list_free (changes);
+}
+
+/**
+ * fs_rtp_bandwidth_allocator_add_flow:
+ * @allocator: a #FsRtpBandwidthAllocator
+ * @flow: the object sending the flow, not reffed
+ * @protected: %TRUE if the flow must get its desired bitrate first
+ * @func: called whenever the share of @flow changes
+ *
+ * Adds a flow, it is not in any group until
+ * fs_rtp_bandwidth_allocator_set_group() is called. It must be removed
+ * with fs_rtp_bandwidth_allocator_remove_flow() before @flow is finalized.
+ */
+
+void
+fs_rtp_bandwidth_allocator_add_flow (FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    gboolean protected,
+    FsRtpBandwidthAllocatorFunc func)
+{
+  Flow *f = g_new0 (Flow, 1);
+
+  f->flow = flow;
+  f->func = func;
+  f->protected = protected;
+  f->priority = FS_RTP_BANDWIDTH_ALLOCATOR_DEFAULT_PRIORITY;
+
+  FS_RTP_BANDWIDTH_ALLOCATOR_LOCK (allocator);
+  allocator->flows = g_list_append (allocator->flows, f);
+  FS_RTP_BANDWIDTH_ALLOCATOR_UNLOCK (allocator);
+}
+
+void
+fs_rtp_bandwidth_allocator_remove_flow (FsRtpBandwidthAllocator *allocator,
+    GObject *flow)
+{
+  GList *changes = NULL;
+  Flow *f;
+
+  FS_RTP_BANDWIDTH_ALLOCATOR_LOCK (allocator);
+  f = find_flow (allocator, flow);
+  if (f)
+  {
+    allocator->flows = g_list_remove (allocator->flows, f);
+    /* What it had goes back to the others */
+    if (f->group)
+      allocate_group_locked (allocator, f->group, &changes);
+    g_free (f);
+  }
+  FS_RTP_BANDWIDTH_ALLOCATOR_UNLOCK (allocator);
+
+  apply_changes (changes);
+}
+
+/**
+ * fs_rtp_bandwidth_allocator_set_group:
+ * @allocator: a #FsRtpBandwidthAllocator
+ * @flow: a flow added with fs_rtp_bandwidth_allocator_add_flow()
+ * @group: any pointer identifying the peer the flow goes to, or %NULL
+ *
+ * Puts @flow with all the other flows with the same @group, they are
+ * assumed to share a bottleneck.
+ */
+
+void
+fs_rtp_bandwidth_allocator_set_group (FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    gpointer group)
+{
+  GList *changes = NULL;
+  gpointer old_group;
+  Flow *f;
+
+  FS_RTP_BANDWIDTH_ALLOCATOR_LOCK (allocator);
+  f = find_flow (allocator, flow);
+  if (f && f->group != group)
+  {
+    old_group = f->group;
+    f->group = group;
+    if (old_group)
+      allocate_group_locked (allocator, old_group, &changes);
+    allocate_locked (allocator, f, &changes);
+  }
+  FS_RTP_BANDWIDTH_ALLOCATOR_UNLOCK (allocator);
+
+  apply_changes (changes);
+}
+
+/**
+ * fs_rtp_bandwidth_allocator_set_priority:
+ * @allocator: a #FsRtpBandwidthAllocator
+ * @flow: a flow added with fs_rtp_bandwidth_allocator_add_flow()
+ * @priority: the weight of @flow, at least 1
+ *
+ * Sets how much of what is left after the protected flows @flow gets
+ * compared to the other flows of its group.
+ */
+
+void
+fs_rtp_bandwidth_allocator_set_priority (FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    guint priority)
+{
+  GList *changes = NULL;
+  Flow *f;
+
+  g_return_if_fail (priority > 0);
+
+  FS_RTP_BANDWIDTH_ALLOCATOR_LOCK (allocator);
+  f = find_flow (allocator, flow);
+  if (f && f->priority != priority)
+  {
+    f->priority = priority;
+    allocate_locked (allocator, f, &changes);
+  }
+  FS_RTP_BANDWIDTH_ALLOCATOR_UNLOCK (allocator);
+
+  apply_changes (changes);
+}
+
+/**
+ * fs_rtp_bandwidth_allocator_set_desired_bitrate:
+ * @allocator: a #FsRtpBandwidthAllocator
+ * @flow: a flow added with fs_rtp_bandwidth_allocator_add_flow()
+ * @bitrate: the bitrate in bits/sec, or 0 to follow its own estimate
+ *
+ * Sets the bitrate a protected flow is given before the others.
+ */
+
+void
+fs_rtp_bandwidth_allocator_set_desired_bitrate (
+    FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    guint bitrate)
+{
+  GList *changes = NULL;
+  Flow *f;
+
+  FS_RTP_BANDWIDTH_ALLOCATOR_LOCK (allocator);
+  f = find_flow (allocator, flow);
+  if (f && f->desired != bitrate)
+  {
+    f->desired = bitrate;
+    allocate_locked (allocator, f, &changes);
+  }
+  FS_RTP_BANDWIDTH_ALLOCATOR_UNLOCK (allocator);
+
+  apply_changes (changes);
+}
+
+/**
+ * fs_rtp_bandwidth_allocator_set_estimate:
+ * @allocator: a #FsRtpBandwidthAllocator
+ * @flow: a flow added with fs_rtp_bandwidth_allocator_add_flow()
+ * @bitrate: the new estimate of the congestion controller of @flow
+ *
+ * Gives the new estimate of the controller of @flow, the shares of its
+ * group are computed again and every flow whose share changed is told.
+ */
+
+void
+fs_rtp_bandwidth_allocator_set_estimate (FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    guint bitrate)
+{
+  GList *changes = NULL;
+  Flow *f;
+
+  FS_RTP_BANDWIDTH_ALLOCATOR_LOCK (allocator);
+  f = find_flow (allocator, flow);
+  if (f)
+  {
+    f->estimate = bitrate;
+    allocate_locked (allocator, f, &changes);
+  }
+  FS_RTP_BANDWIDTH_ALLOCATOR_UNLOCK (allocator);
+
+  apply_changes (changes);
+}
+
+/**
+ * fs_rtp_bandwidth_allocator_get_stats:
+ * @allocator: a #FsRtpBandwidthAllocator
+ * @flow: a flow added with fs_rtp_bandwidth_allocator_add_flow()
+ *
+ * Returns: a "application/x-fs-rtp-bandwidth-allocation" #GstStructure
+ *  describing the share of @flow, or %NULL if it is unknown
+ */
+
+GstStructure *
+fs_rtp_bandwidth_allocator_get_stats (FsRtpBandwidthAllocator *allocator,
+    GObject *flow)
+{
+  GstStructure *s = NULL;
+  guint64 total;
+  guint n_flows = 1;
+  Flow *f;
+
+  FS_RTP_BANDWIDTH_ALLOCATOR_LOCK (allocator);
+  f = find_flow (allocator, flow);
+  if (f)
+  {
+    if (f->group)
+      total = get_group_estimate (allocator, f->group, &n_flows);
+    else
+      total = f->estimate;
+
+    s = gst_structure_new ("application/x-fs-rtp-bandwidth-allocation",
+        "coupled", G_TYPE_BOOLEAN, f->group != NULL,
+        "protected", G_TYPE_BOOLEAN, f->protected,
+        "priority", G_TYPE_UINT, f->priority,
+        "estimate", G_TYPE_UINT, f->estimate,
+        "allocated", G_TYPE_UINT, f->allocated,
+        "group-estimate", G_TYPE_UINT64, total,
+        "group-flows", G_TYPE_UINT, n_flows,
+        NULL);
+  }
+  FS_RTP_BANDWIDTH_ALLOCATOR_UNLOCK (allocator);
+
+  return s;
+}
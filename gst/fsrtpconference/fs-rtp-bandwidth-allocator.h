@@ -0,0 +1,82 @@
+/*
+ * Farstream - Farstream RTP Bandwidth Allocator
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-bandwidth-allocator.h - Shares the estimated bandwidth between
+ *  the sessions sending to the same peer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef __FS_RTP_BANDWIDTH_ALLOCATOR_H__
+#define __FS_RTP_BANDWIDTH_ALLOCATOR_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _FsRtpBandwidthAllocator FsRtpBandwidthAllocator;
+
+/**
+ * FsRtpBandwidthAllocatorFunc:
+ * @flow: the flow whose allocation changed
+ * @bitrate: its new target bitrate in bits/sec
+ *
+ * Called without any lock of the allocator held, the flow is reffed for
+ * the duration of the call.
+ */
+typedef void (*FsRtpBandwidthAllocatorFunc) (GObject *flow, guint bitrate);
+
+#define FS_RTP_BANDWIDTH_ALLOCATOR_DEFAULT_PRIORITY (1)
+
+FsRtpBandwidthAllocator *fs_rtp_bandwidth_allocator_new (void);
+
+FsRtpBandwidthAllocator *fs_rtp_bandwidth_allocator_ref (
+    FsRtpBandwidthAllocator *allocator);
+void fs_rtp_bandwidth_allocator_unref (FsRtpBandwidthAllocator *allocator);
+
+void fs_rtp_bandwidth_allocator_add_flow (FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    gboolean protected,
+    FsRtpBandwidthAllocatorFunc func);
+void fs_rtp_bandwidth_allocator_remove_flow (
+    FsRtpBandwidthAllocator *allocator,
+    GObject *flow);
+
+void fs_rtp_bandwidth_allocator_set_group (FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    gpointer group);
+void fs_rtp_bandwidth_allocator_set_priority (
+    FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    guint priority);
+void fs_rtp_bandwidth_allocator_set_desired_bitrate (
+    FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    guint bitrate);
+void fs_rtp_bandwidth_allocator_set_estimate (
+    FsRtpBandwidthAllocator *allocator,
+    GObject *flow,
+    guint bitrate);
+
+GstStructure *fs_rtp_bandwidth_allocator_get_stats (
+    FsRtpBandwidthAllocator *allocator,
+    GObject *flow);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_BANDWIDTH_ALLOCATOR_H__ */
@@ -0,0 +1,346 @@
+/*
+ * Farstream - Farstream RTP Bandwidth Cache
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-bandwidth-cache.c - Remembers the bandwidth of the paths to the
+ *  recently called destinations
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "fs-rtp-bandwidth-cache.h"
+
+#include <math.h>
+
+#include <gio/gio.h>
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+GST_DEBUG_CATEGORY_EXTERN (fsrtpconference_debug);
+
+/*
+ * At the end of a call, the bitrate the congestion control had reached is
+ * remembered along with the RTT and the loss rate, per destination prefix
+ * (a /24 for IPv4, a /64 for IPv6), as the hosts of a subnet usually share
+ * the same path. The next call to that prefix starts from that bitrate
+ * instead of the few kbits/sec of a cold start.
+ *
+ * Since the path may have changed in between, only a fraction of what was
+ * reached is used, reduced by the loss rate at the time, and halved for
+ * each day since. Entries older than a week are forgotten.
+ *
+ * The cache is shared by all the conferences of the process and is saved
+ * in the user cache directory, or in the file named by the
+ * FS_BANDWIDTH_CACHE environment variable. A store only marks it dirty,
+ * the file is written after the cache_mutex is released so that the
+ * lookups of the other sessions never wait for the disk.
+ */
+
+#define SAFETY_MARGIN (0.75)
+#define HALF_LIFE (G_GINT64_CONSTANT (24 * 3600) * G_USEC_PER_SEC)
+#define MAX_AGE (7 * HALF_LIFE)
+#define MAX_LOSS (0.5)
+#define MAX_ENTRIES (256)
+
+typedef struct {
+  guint bitrate;
+  guint rtt;
+  gdouble loss;
+  /* in microseconds of the real time */
+  gint64 time;
+} CacheEntry;
+
+static GMutex cache_mutex;
+/* prefix -> CacheEntry, protected by the cache_mutex */
+static GHashTable *cache = NULL;
+/* protected by the cache_mutex */
+static gboolean cache_dirty = FALSE;
+
+/* Taken before the cache_mutex, keeps the writes in order */
+static GMutex save_mutex;
+
+static gchar *
+get_bandwidth_cache_path (void)
+{
+  gchar *cache_path = g_strdup (g_getenv ("FS_BANDWIDTH_CACHE"));
+
+  if (cache_path == NULL)
+    cache_path = g_build_filename (g_get_user_cache_dir (), "farstream",
+        "bandwidth.cache", NULL);
+
+  return cache_path;
+}
+
+/**
+ * fs_rtp_bandwidth_cache_get_prefix:
+ * @address: a numeric IPv4 or IPv6 address
+ *
+ * Returns: the prefix under which the paths to this address are
+ *  remembered, or %NULL if it is not a numeric address
+ */
+
+gchar *
+fs_rtp_bandwidth_cache_get_prefix (const gchar *address)
+{
+  GInetAddress *addr;
+  const guint8 *b;
+  gchar *prefix;
+
+  if (!address)
+    return NULL;
+
+  addr = g_inet_address_new_from_string (address);
+  if (!addr)
+    return NULL;
+
+  b = g_inet_address_to_bytes (addr);
+  if (g_inet_address_get_family (addr) == G_SOCKET_FAMILY_IPV4)
+    prefix = g_strdup_printf ("%u.%u.%u.0/24", b[0], b[1], b[2]);
+  else
+    prefix = g_strdup_printf ("%x:%x:%x:%x::/64",
+        b[0] << 8 | b[1], b[2] << 8 | b[3], b[4] << 8 | b[5], b[6] << 8 | b[7]);
+
+  g_object_unref (addr);
+
+  return prefix;
+}
+
+static void
+load_bandwidth_cache_locked (gint64 now)
+{
+  GKeyFile *keyfile;
+  gchar *cache_path;
+  gchar **groups;
+  guint i;
+
+  cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  cache_path = get_bandwidth_cache_path ();
+  keyfile = g_key_file_new ();
+
+  if (!g_key_file_load_from_file (keyfile, cache_path, G_KEY_FILE_NONE,
+          NULL))
+  {
+    GST_DEBUG ("No bandwidth cache at %s", cache_path);
+    goto out;
+  }
+
+  GST_DEBUG ("Loading bandwidth cache %s", cache_path);
+
+  groups = g_key_file_get_groups (keyfile, NULL);
+  for (i = 0; groups[i]; i++)
+  {
+    CacheEntry *entry = g_new0 (CacheEntry, 1);
+
+    entry->bitrate = g_key_file_get_integer (keyfile, groups[i], "bitrate",
+        NULL);
+    entry->rtt = g_key_file_get_integer (keyfile, groups[i], "rtt", NULL);
+    entry->loss = g_key_file_get_double (keyfile, groups[i], "loss", NULL);
+    entry->time = g_key_file_get_int64 (keyfile, groups[i], "time", NULL);
+
+    if (entry->bitrate == 0 || now - entry->time > MAX_AGE)
+      g_free (entry);
+    else
+      g_hash_table_insert (cache, g_strdup (groups[i]), entry);
+  }
+  g_strfreev (groups);
+
+out:
+  g_key_file_free (keyfile);
+  g_free (cache_path);
+}
+
+static gchar *
+serialize_bandwidth_cache_locked (gsize *size)
+{
+  GHashTableIter iter;
+  GKeyFile *keyfile;
+  gchar *data;
+  gpointer key, value;
+
+  keyfile = g_key_file_new ();
+
+  g_hash_table_iter_init (&iter, cache);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+  {
+    CacheEntry *entry = value;
+
+    g_key_file_set_integer (keyfile, key, "bitrate", entry->bitrate);
+    g_key_file_set_integer (keyfile, key, "rtt", entry->rtt);
+    g_key_file_set_double (keyfile, key, "loss", entry->loss);
+    g_key_file_set_int64 (keyfile, key, "time", entry->time);
+  }
+
+  data = g_key_file_to_data (keyfile, size, NULL);
+  g_key_file_free (keyfile);
+
+  return data;
+}
+
+static void
+save_bandwidth_cache (void)
+{
+  gchar *cache_path;
+  gchar *dir;
+  gchar *data;
+  gsize size;
+  GError *error = NULL;
+
+  g_mutex_lock (&save_mutex);
+
+  g_mutex_lock (&cache_mutex);
+  if (!cache_dirty)
+  {
+    /* An earlier save already wrote these changes */
+    g_mutex_unlock (&cache_mutex);
+    g_mutex_unlock (&save_mutex);
+    return;
+  }
+  data = serialize_bandwidth_cache_locked (&size);
+  cache_dirty = FALSE;
+  g_mutex_unlock (&cache_mutex);
+
+  cache_path = get_bandwidth_cache_path ();
+  dir = g_path_get_dirname (cache_path);
+  g_mkdir_with_parents (dir, 0777);
+  g_free (dir);
+
+  GST_DEBUG ("Saving bandwidth cache to %s", cache_path);
+
+  if (!g_file_set_contents (cache_path, data, size, &error))
+  {
+    GST_DEBUG ("Unable to save bandwidth cache: %s", error->message);
+    g_clear_error (&error);
+  }
+
+  g_free (cache_path);
+  g_free (data);
+
+  g_mutex_unlock (&save_mutex);
+}
+
+/**
+ * fs_rtp_bandwidth_cache_lookup:
+ * @address: the numeric address of the destination
+ * @now: the current real time, in microseconds
+ * @bitrate: (out): where to put the bitrate to start from, in bits/sec
+ * @rtt: (out) (allow-none): where to put the RTT last measured, in
+ *  microseconds
+ *
+ * Returns: %TRUE if the path to this prefix was used recently
+ */
+
+gboolean
+fs_rtp_bandwidth_cache_lookup (const gchar *address, gint64 now,
+    guint *bitrate, guint *rtt)
+{
+  gchar *prefix = fs_rtp_bandwidth_cache_get_prefix (address);
+  CacheEntry *entry;
+  gboolean ret = FALSE;
+
+  if (!prefix)
+    return FALSE;
+
+  g_mutex_lock (&cache_mutex);
+  if (!cache)
+    load_bandwidth_cache_locked (now);
+
+  entry = g_hash_table_lookup (cache, prefix);
+  if (entry && now >= entry->time && now - entry->time <= MAX_AGE)
+  {
+    *bitrate = entry->bitrate * SAFETY_MARGIN *
+        (1 - MIN (entry->loss, MAX_LOSS)) *
+        pow (0.5, (gdouble) (now - entry->time) / HALF_LIFE);
+    if (rtt)
+      *rtt = entry->rtt;
+    ret = TRUE;
+
+    GST_DEBUG ("Starting %s at %u bits/sec, it reached %u with a loss rate"
+        " of %f", prefix, *bitrate, entry->bitrate, entry->loss);
+  }
+  g_mutex_unlock (&cache_mutex);
+
+  g_free (prefix);
+
+  return ret;
+}
+
+static gboolean
+is_oldest (gpointer key, gpointer value, gpointer user_data)
+{
+  return value == user_data;
+}
+
+/**
+ * fs_rtp_bandwidth_cache_store:
+ * @address: the numeric address of the destination
+ * @now: the current real time, in microseconds
+ * @bitrate: the bitrate that was reached, in bits/sec
+ * @rtt: the RTT at the time, in microseconds
+ * @loss: the loss rate at the time
+ *
+ * Remembers the path to the prefix of @address, replacing what was known.
+ */
+
+void
+fs_rtp_bandwidth_cache_store (const gchar *address, gint64 now,
+    guint bitrate, guint rtt, gdouble loss)
+{
+  gchar *prefix = fs_rtp_bandwidth_cache_get_prefix (address);
+  CacheEntry *entry;
+
+  if (!prefix || bitrate == 0)
+  {
+    g_free (prefix);
+    return;
+  }
+
+  g_mutex_lock (&cache_mutex);
+  if (!cache)
+    load_bandwidth_cache_locked (now);
+
+  if (!g_hash_table_lookup (cache, prefix) &&
+      g_hash_table_size (cache) >= MAX_ENTRIES)
+  {
+    GHashTableIter iter;
+    CacheEntry *oldest = NULL;
+    gpointer value;
+
+    g_hash_table_iter_init (&iter, cache);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+      if (!oldest || ((CacheEntry *) value)->time < oldest->time)
+        oldest = value;
+    g_hash_table_foreach_remove (cache, is_oldest, oldest);
+  }
+
+  entry = g_new0 (CacheEntry, 1);
+  entry->bitrate = bitrate;
+  entry->rtt = rtt;
+  entry->loss = CLAMP (loss, 0, 1);
+  entry->time = now;
+
+  GST_DEBUG ("Remembering %s: %u bits/sec, rtt %u, loss rate %f", prefix,
+      bitrate, rtt, loss);
+
+  g_hash_table_replace (cache, prefix, entry);
+  cache_dirty = TRUE;
+  g_mutex_unlock (&cache_mutex);
+
+  save_bandwidth_cache ();
+}
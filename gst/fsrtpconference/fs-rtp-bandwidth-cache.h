@@ -0,0 +1,41 @@
+/*
+ * Farstream - Farstream RTP Bandwidth Cache
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-bandwidth-cache.h - Remembers the bandwidth of the paths to the
+ *  recently called destinations
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef __FS_RTP_BANDWIDTH_CACHE_H__
+#define __FS_RTP_BANDWIDTH_CACHE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+gchar *fs_rtp_bandwidth_cache_get_prefix (const gchar *address);
+
+gboolean fs_rtp_bandwidth_cache_lookup (const gchar *address, gint64 now,
+    guint *bitrate, guint *rtt);
+void fs_rtp_bandwidth_cache_store (const gchar *address, gint64 now,
+    guint bitrate, guint rtt, gdouble loss);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_BANDWIDTH_CACHE_H__ */
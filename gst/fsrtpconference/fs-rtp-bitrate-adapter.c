@@ -172,6 +172,9 @@ fs_rtp_bitrate_adapter_finalize (GObject *object)
   if (self->system_clock)
     gst_object_unref (self->system_clock);
 
+  if (self->timer_wheel)
+    fs_rtp_timer_wheel_unref (self->timer_wheel);
+
   g_queue_foreach (&self->bitrate_history, (GFunc) bitrate_point_free, NULL);
   g_queue_clear(&self->bitrate_history);
 
@@ -493,28 +496,24 @@ fs_rtp_bitrate_adapter_cleanup_locked (FsRtpBitrateAdapter *self,
   }
 }
 
-static gboolean
-clock_callback (GstClock *clock, GstClockTime now, GstClockID clockid,
-    gpointer user_data)
+static void
+timer_callback (FsRtpTimer *timer, GstClockTime now, gpointer user_data)
 {
   FsRtpBitrateAdapter *self = user_data;
 
   GST_OBJECT_LOCK (self);
-  if (self->clockid == clockid)
+  if (self->timer == timer)
   {
-    gst_clock_id_unref (self->clockid);
+    fs_rtp_timer_unref (self->timer);
   }
   else
   {
     GST_OBJECT_UNLOCK (self);
-    return TRUE;
+    return;
   }
-  self->clockid = NULL;
+  self->timer = NULL;
 
   fs_rtp_bitrate_adapter_updated_unlock (self);
-
-
-  return TRUE;
 }
 
 static gboolean
@@ -530,13 +529,10 @@ fs_rtp_bitrate_adapter_add_bitrate_locked (FsRtpBitrateAdapter *self,
 
   fs_rtp_bitrate_adapter_cleanup_locked (self, now);
 
-  if (!self->clockid && GST_STATE (self) == GST_STATE_PLAYING)
-  {
-    self->clockid = gst_clock_new_single_shot_id (self->system_clock,
-        now + self->interval);
-    gst_clock_id_wait_async (self->clockid,
-        clock_callback, gst_object_ref (self), gst_object_unref);
-  }
+  if (!self->timer && GST_STATE (self) == GST_STATE_PLAYING)
+    self->timer = fs_rtp_timer_wheel_add (self->timer_wheel,
+        now + self->interval, timer_callback, gst_object_ref (self),
+        gst_object_unref);
 
   return first;
 }
@@ -583,12 +579,12 @@ fs_rtp_bitrate_adapter_change_state (GstElement *element,
   switch (transition) {
     case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
       GST_OBJECT_LOCK (self);
-      if (self->clockid)
+      if (self->timer)
       {
-        gst_clock_id_unschedule (self->clockid);
-        gst_clock_id_unref (self->clockid);
+        fs_rtp_timer_cancel (self->timer);
+        fs_rtp_timer_unref (self->timer);
       }
-      self->clockid = NULL;
+      self->timer = NULL;
       GST_OBJECT_UNLOCK (self);
 
       break;
@@ -630,7 +626,14 @@ fs_rtp_bitrate_adapter_change_state (GstElement *element,
 }
 
 GstElement *
-fs_rtp_bitrate_adapter_new (void)
+fs_rtp_bitrate_adapter_new (FsRtpTimerWheel *timer_wheel)
 {
-  return g_object_new (FS_TYPE_RTP_BITRATE_ADAPTER, NULL);
+  FsRtpBitrateAdapter *self;
+
+  g_return_val_if_fail (timer_wheel, NULL);
+
+  self = g_object_new (FS_TYPE_RTP_BITRATE_ADAPTER, NULL);
+  self->timer_wheel = fs_rtp_timer_wheel_ref (timer_wheel);
+
+  return GST_ELEMENT (self);
 }
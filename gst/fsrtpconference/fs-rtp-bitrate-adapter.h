@@ -25,6 +25,8 @@
 
 #include <gst/gst.h>
 
+#include "fs-rtp-timer-wheel.h"
+
 G_BEGIN_DECLS
 
 /* #define's don't like whitespacey bits */
@@ -53,9 +55,10 @@ struct _FsRtpBitrateAdapter
   GstPad *sinkpad;
 
   GstClock *system_clock;
+  FsRtpTimerWheel *timer_wheel;
   GstClockTime interval;
   GQueue bitrate_history;
-  GstClockID clockid;
+  FsRtpTimer *timer;
   guint bitrate;
   guint last_bitrate;
 };
@@ -67,7 +70,7 @@ struct _FsRtpBitrateAdapterClass
 
 GType fs_rtp_bitrate_adapter_get_type (void);
 
-GstElement *fs_rtp_bitrate_adapter_new (void);
+GstElement *fs_rtp_bitrate_adapter_new (FsRtpTimerWheel *timer_wheel);
 
 G_END_DECLS
 
@@ -0,0 +1,511 @@
+/*
+ * Farstream - Farstream RTP Bundle demuxer
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rtp-bundle-demux.c - Splits a bundled RTP/RTCP stream between sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "fs-rtp-bundle-demux.h"
+
+#include <stdio.h>
+
+GST_DEBUG_CATEGORY_STATIC (fs_rtp_bundle_demux_debug);
+#define GST_CAT_DEFAULT fs_rtp_bundle_demux_debug
+
+/*
+ * All the sessions of a bundle share a single transport with RTCP
+ * multiplexed with RTP (RFC 5761). RTP packets are sent to the session that
+ * negotiated their payload type, with the SSRC as a fallback for payload
+ * types that are not known yet. RTCP packets go to the session that owns
+ * their sender SSRC, or to every session if it is not known.
+ */
+
+static GstStaticPadTemplate fs_rtp_bundle_demux_sink_template =
+    GST_STATIC_PAD_TEMPLATE ("sink",
+        GST_PAD_SINK,
+        GST_PAD_ALWAYS,
+        GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate fs_rtp_bundle_demux_rtp_src_template =
+    GST_STATIC_PAD_TEMPLATE ("rtp_src_%u",
+        GST_PAD_SRC,
+        GST_PAD_REQUEST,
+        GST_STATIC_CAPS ("application/x-rtp"));
+
+static GstStaticPadTemplate fs_rtp_bundle_demux_rtcp_src_template =
+    GST_STATIC_PAD_TEMPLATE ("rtcp_src_%u",
+        GST_PAD_SRC,
+        GST_PAD_REQUEST,
+        GST_STATIC_CAPS ("application/x-rtcp"));
+
+typedef struct {
+  guint id;
+  GstPad *rtp_pad;
+  GstPad *rtcp_pad;
+  gboolean rtp_events_sent;
+  gboolean rtcp_events_sent;
+} BundleDemuxSession;
+
+G_DEFINE_TYPE (FsRtpBundleDemux, fs_rtp_bundle_demux, GST_TYPE_ELEMENT);
+
+static void fs_rtp_bundle_demux_finalize (GObject *object);
+
+static GstFlowReturn fs_rtp_bundle_demux_chain (GstPad *pad,
+    GstObject *parent, GstBuffer *buffer);
+static gboolean fs_rtp_bundle_demux_sink_event (GstPad *pad,
+    GstObject *parent, GstEvent *event);
+static GstPad *fs_rtp_bundle_demux_request_new_pad (GstElement *element,
+    GstPadTemplate *templ, const gchar *name, const GstCaps *caps);
+static void fs_rtp_bundle_demux_release_pad (GstElement *element,
+    GstPad *pad);
+
+
+static void
+fs_rtp_bundle_demux_class_init (FsRtpBundleDemuxClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  GST_DEBUG_CATEGORY_INIT
+      (fs_rtp_bundle_demux_debug, "fsrtpbundledemux", 0,
+          "fsrtpbundledemux element");
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Farstream RTP Bundle demuxer",
+      "Demuxer/Network/RTP",
+      "Splits bundled RTP and RTCP packets between sessions",
+      "Collabora Ltd");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_bundle_demux_sink_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_bundle_demux_rtp_src_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rtp_bundle_demux_rtcp_src_template));
+
+  gstelement_class->request_new_pad = fs_rtp_bundle_demux_request_new_pad;
+  gstelement_class->release_pad = fs_rtp_bundle_demux_release_pad;
+
+  gobject_class->finalize = fs_rtp_bundle_demux_finalize;
+}
+
+static void
+fs_rtp_bundle_demux_init (FsRtpBundleDemux *self)
+{
+  self->sinkpad = gst_pad_new_from_static_template (
+    &fs_rtp_bundle_demux_sink_template, "sink");
+  gst_pad_set_chain_function (self->sinkpad, fs_rtp_bundle_demux_chain);
+  gst_pad_set_event_function (self->sinkpad, fs_rtp_bundle_demux_sink_event);
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  self->sessions = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, g_free);
+  self->ssrc_sessions = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+static void
+fs_rtp_bundle_demux_finalize (GObject *object)
+{
+  FsRtpBundleDemux *self = FS_RTP_BUNDLE_DEMUX (object);
+
+  g_hash_table_destroy (self->sessions);
+  g_hash_table_destroy (self->ssrc_sessions);
+
+  G_OBJECT_CLASS (fs_rtp_bundle_demux_parent_class)->finalize (object);
+}
+
+FsRtpBundleDemux *
+fs_rtp_bundle_demux_new (void)
+{
+  return g_object_new (FS_TYPE_RTP_BUNDLE_DEMUX, NULL);
+}
+
+/**
+ * fs_rtp_bundle_demux_set_payload_types:
+ * @self: a #FsRtpBundleDemux
+ * @session_id: The id of the session
+ * @pts: the payload types negotiated for that session
+ * @n_pts: the number of elements in @pts
+ *
+ * Replaces the payload types that are routed to the session @session_id.
+ * Payload types can only belong to one session of a bundle, the last session
+ * to claim one wins.
+ */
+
+void
+fs_rtp_bundle_demux_set_payload_types (FsRtpBundleDemux *self,
+    guint session_id, const guint8 *pts, guint n_pts)
+{
+  guint i;
+
+  g_return_if_fail (FS_IS_RTP_BUNDLE_DEMUX (self));
+  g_return_if_fail (session_id != 0);
+
+  GST_OBJECT_LOCK (self);
+  for (i = 0; i < G_N_ELEMENTS (self->pt_sessions); i++)
+    if (self->pt_sessions[i] == session_id)
+      self->pt_sessions[i] = 0;
+
+  for (i = 0; i < n_pts; i++)
+  {
+    if (pts[i] >= G_N_ELEMENTS (self->pt_sessions))
+      continue;
+
+    if (self->pt_sessions[pts[i]] &&
+        self->pt_sessions[pts[i]] != session_id)
+      GST_WARNING_OBJECT (self, "Payload type %u moved from session %u to %u",
+          pts[i], self->pt_sessions[pts[i]], session_id);
+
+    self->pt_sessions[pts[i]] = session_id;
+  }
+  GST_OBJECT_UNLOCK (self);
+}
+
+typedef struct {
+  GstPad *srcpad;
+  gboolean rtcp;
+} CopyStickyData;
+
+static gboolean
+copy_sticky_event (GstPad *pad, GstEvent **event, gpointer user_data)
+{
+  CopyStickyData *data = user_data;
+
+  /* The sink caps describe the bundled stream, every src pad has its own */
+  if (GST_EVENT_TYPE (*event) == GST_EVENT_CAPS)
+  {
+    GstCaps *caps = gst_caps_new_empty_simple (data->rtcp ?
+        "application/x-rtcp" : "application/x-rtp");
+
+    gst_pad_push_event (data->srcpad, gst_event_new_caps (caps));
+    gst_caps_unref (caps);
+  }
+  else
+  {
+    gst_pad_push_event (data->srcpad, gst_event_ref (*event));
+  }
+
+  return TRUE;
+}
+
+static GstFlowReturn
+push_to_pad (FsRtpBundleDemux *self, GstPad *srcpad, gboolean rtcp,
+    gboolean send_events, GstBuffer *buffer)
+{
+  GstFlowReturn ret;
+
+  if (send_events)
+  {
+    CopyStickyData data = {srcpad, rtcp};
+
+    gst_pad_sticky_events_foreach (self->sinkpad, copy_sticky_event, &data);
+  }
+
+  ret = gst_pad_push (srcpad, buffer);
+  gst_object_unref (srcpad);
+
+  /* A session that is not linked yet must not stop the others */
+  if (ret == GST_FLOW_NOT_LINKED)
+    ret = GST_FLOW_OK;
+
+  return ret;
+}
+
+static GstPad *
+session_get_pad_locked (BundleDemuxSession *session, gboolean rtcp,
+    gboolean *send_events)
+{
+  GstPad *pad;
+
+  if (rtcp)
+  {
+    pad = session->rtcp_pad;
+    *send_events = !session->rtcp_events_sent;
+    session->rtcp_events_sent = TRUE;
+  }
+  else
+  {
+    pad = session->rtp_pad;
+    *send_events = !session->rtp_events_sent;
+    session->rtp_events_sent = TRUE;
+  }
+
+  if (pad)
+    gst_object_ref (pad);
+
+  return pad;
+}
+
+static GstFlowReturn
+fs_rtp_bundle_demux_broadcast_rtcp (FsRtpBundleDemux *self, GstBuffer *buffer)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GList *pads = NULL;
+  GList *events = NULL;
+  GHashTableIter iter;
+  gpointer value;
+
+  GST_OBJECT_LOCK (self);
+  g_hash_table_iter_init (&iter, self->sessions);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+  {
+    gboolean send_events;
+    GstPad *pad = session_get_pad_locked (value, TRUE, &send_events);
+
+    if (pad)
+    {
+      pads = g_list_prepend (pads, pad);
+      events = g_list_prepend (events, GINT_TO_POINTER (send_events));
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  while (pads)
+  {
+    GstFlowReturn pad_ret = push_to_pad (self, pads->data, TRUE,
+        GPOINTER_TO_INT (events->data), gst_buffer_ref (buffer));
+
+    if (pad_ret != GST_FLOW_OK && ret == GST_FLOW_OK)
+      ret = pad_ret;
+
+    pads = g_list_delete_link (pads, pads);
+    events = g_list_delete_link (events, events);
+  }
+
+  gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+static GstFlowReturn
+fs_rtp_bundle_demux_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  FsRtpBundleDemux *self = FS_RTP_BUNDLE_DEMUX (parent);
+  BundleDemuxSession *session;
+  GstMapInfo map;
+  gboolean rtcp;
+  guint8 pt = 0;
+  guint32 ssrc;
+  guint session_id;
+  GstPad *srcpad = NULL;
+  gboolean send_events = FALSE;
+
+  if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+    goto drop;
+
+  /* Both RTP and RTCP start with version 2 */
+  if (map.size < 8 || (map.data[0] >> 6) != 2)
+  {
+    gst_buffer_unmap (buffer, &map);
+    GST_LOG_OBJECT (self, "Dropping packet that is not RTP or RTCP");
+    goto drop;
+  }
+
+  /* RFC 5761 section 4, RTCP packet types 192-223 can not be RTP */
+  rtcp = (map.data[1] >= 192 && map.data[1] <= 223);
+
+  if (rtcp)
+  {
+    ssrc = GST_READ_UINT32_BE (map.data + 4);
+  }
+  else if (map.size >= 12)
+  {
+    pt = map.data[1] & 0x7f;
+    ssrc = GST_READ_UINT32_BE (map.data + 8);
+  }
+  else
+  {
+    gst_buffer_unmap (buffer, &map);
+    GST_LOG_OBJECT (self, "Dropping truncated RTP packet");
+    goto drop;
+  }
+  gst_buffer_unmap (buffer, &map);
+
+  GST_OBJECT_LOCK (self);
+  if (rtcp)
+  {
+    session_id = GPOINTER_TO_UINT (g_hash_table_lookup (self->ssrc_sessions,
+            GUINT_TO_POINTER (ssrc)));
+  }
+  else
+  {
+    session_id = self->pt_sessions[pt];
+
+    if (session_id)
+      g_hash_table_insert (self->ssrc_sessions, GUINT_TO_POINTER (ssrc),
+          GUINT_TO_POINTER (session_id));
+    else
+      session_id = GPOINTER_TO_UINT (g_hash_table_lookup (self->ssrc_sessions,
+              GUINT_TO_POINTER (ssrc)));
+  }
+
+  session = g_hash_table_lookup (self->sessions, GUINT_TO_POINTER (session_id));
+  if (session)
+    srcpad = session_get_pad_locked (session, rtcp, &send_events);
+  GST_OBJECT_UNLOCK (self);
+
+  if (srcpad)
+    return push_to_pad (self, srcpad, rtcp, send_events, buffer);
+
+  if (rtcp)
+    return fs_rtp_bundle_demux_broadcast_rtcp (self, buffer);
+
+  GST_LOG_OBJECT (self, "Dropping RTP packet with unknown pt %u ssrc %X",
+      pt, ssrc);
+
+drop:
+  gst_buffer_unref (buffer);
+  return GST_FLOW_OK;
+}
+
+static gboolean
+fs_rtp_bundle_demux_sink_event (GstPad *pad, GstObject *parent,
+    GstEvent *event)
+{
+  FsRtpBundleDemux *self = FS_RTP_BUNDLE_DEMUX (parent);
+
+  /* Sticky events are sent to each pad before its first buffer */
+  if (GST_EVENT_IS_STICKY (event) && GST_EVENT_TYPE (event) != GST_EVENT_EOS)
+  {
+    GHashTableIter iter;
+    gpointer value;
+
+    GST_OBJECT_LOCK (self);
+    g_hash_table_iter_init (&iter, self->sessions);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      BundleDemuxSession *session = value;
+
+      session->rtp_events_sent = FALSE;
+      session->rtcp_events_sent = FALSE;
+    }
+    GST_OBJECT_UNLOCK (self);
+
+    gst_event_unref (event);
+    return TRUE;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static GstPad *
+fs_rtp_bundle_demux_request_new_pad (GstElement *element,
+    GstPadTemplate *templ, const gchar *name, const GstCaps *caps)
+{
+  FsRtpBundleDemux *self = FS_RTP_BUNDLE_DEMUX (element);
+  GstElementClass *klass = GST_ELEMENT_GET_CLASS (element);
+  BundleDemuxSession *session;
+  GstPad *pad;
+  gboolean rtcp;
+  guint session_id;
+
+  if (templ == gst_element_class_get_pad_template (klass, "rtp_src_%u"))
+    rtcp = FALSE;
+  else if (templ == gst_element_class_get_pad_template (klass, "rtcp_src_%u"))
+    rtcp = TRUE;
+  else
+    return NULL;
+
+  if (!name || sscanf (name, rtcp ? "rtcp_src_%u" : "rtp_src_%u",
+          &session_id) != 1 || session_id == 0)
+  {
+    GST_WARNING_OBJECT (self, "Pads must be requested with a session id");
+    return NULL;
+  }
+
+  pad = gst_pad_new_from_template (templ, name);
+
+  GST_OBJECT_LOCK (self);
+  session = g_hash_table_lookup (self->sessions, GUINT_TO_POINTER (session_id));
+  if (!session)
+  {
+    session = g_new0 (BundleDemuxSession, 1);
+    session->id = session_id;
+    g_hash_table_insert (self->sessions, GUINT_TO_POINTER (session_id),
+        session);
+  }
+
+  if ((rtcp && session->rtcp_pad) || (!rtcp && session->rtp_pad))
+  {
+    GST_OBJECT_UNLOCK (self);
+    GST_WARNING_OBJECT (self, "Pad %s already exists", name);
+    gst_object_unref (pad);
+    return NULL;
+  }
+
+  if (rtcp)
+    session->rtcp_pad = pad;
+  else
+    session->rtp_pad = pad;
+  GST_OBJECT_UNLOCK (self);
+
+  gst_pad_set_active (pad, TRUE);
+  gst_element_add_pad (element, pad);
+
+  return pad;
+}
+
+static gboolean
+ssrc_is_session (gpointer key, gpointer value, gpointer user_data)
+{
+  return value == user_data;
+}
+
+static void
+fs_rtp_bundle_demux_release_pad (GstElement *element, GstPad *pad)
+{
+  FsRtpBundleDemux *self = FS_RTP_BUNDLE_DEMUX (element);
+  GHashTableIter iter;
+  gpointer value;
+
+  GST_OBJECT_LOCK (self);
+  g_hash_table_iter_init (&iter, self->sessions);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+  {
+    BundleDemuxSession *session = value;
+
+    if (session->rtp_pad == pad)
+      session->rtp_pad = NULL;
+    else if (session->rtcp_pad == pad)
+      session->rtcp_pad = NULL;
+    else
+      continue;
+
+    if (!session->rtp_pad && !session->rtcp_pad)
+    {
+      guint i;
+
+      for (i = 0; i < G_N_ELEMENTS (self->pt_sessions); i++)
+        if (self->pt_sessions[i] == session->id)
+          self->pt_sessions[i] = 0;
+      g_hash_table_foreach_remove (self->ssrc_sessions, ssrc_is_session,
+          GUINT_TO_POINTER (session->id));
+      g_hash_table_iter_remove (&iter);
+    }
+    break;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_element_remove_pad (element, pad);
+}
@@ -0,0 +1,80 @@
+/*
+ * Farstream - Farstream RTP Bundle demuxer
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rtp-bundle-demux.h - Splits a bundled RTP/RTCP stream between sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef __FS_RTP_BUNDLE_DEMUX_H__
+#define __FS_RTP_BUNDLE_DEMUX_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define FS_TYPE_RTP_BUNDLE_DEMUX \
+  (fs_rtp_bundle_demux_get_type ())
+#define FS_RTP_BUNDLE_DEMUX(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),FS_TYPE_RTP_BUNDLE_DEMUX, \
+      FsRtpBundleDemux))
+#define FS_RTP_BUNDLE_DEMUX_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),FS_TYPE_RTP_BUNDLE_DEMUX, \
+      FsRtpBundleDemuxClass))
+#define FS_IS_RTP_BUNDLE_DEMUX(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),FS_TYPE_RTP_BUNDLE_DEMUX))
+#define FS_IS_RTP_BUNDLE_DEMUX_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),FS_TYPE_RTP_BUNDLE_DEMUX))
+
+typedef struct _FsRtpBundleDemux          FsRtpBundleDemux;
+typedef struct _FsRtpBundleDemuxClass     FsRtpBundleDemuxClass;
+
+/**
+ * FsRtpBundleDemux:
+ *
+ * Opaque #FsRtpBundleDemux data structure.
+ */
+struct _FsRtpBundleDemux {
+  GstElement      element;
+
+  GstPad *sinkpad;
+
+  /* Everything below is protected by the object lock */
+
+  /* session id -> BundleDemuxSession */
+  GHashTable *sessions;
+  /* payload type -> session id, 0 if unknown */
+  guint pt_sessions[128];
+  /* SSRC -> session id, learnt from RTP packets */
+  GHashTable *ssrc_sessions;
+};
+
+struct _FsRtpBundleDemuxClass {
+  GstElementClass parent_class;
+};
+
+GType   fs_rtp_bundle_demux_get_type        (void);
+
+FsRtpBundleDemux *fs_rtp_bundle_demux_new (void);
+
+void fs_rtp_bundle_demux_set_payload_types (FsRtpBundleDemux *self,
+    guint session_id, const guint8 *pts, guint n_pts);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_BUNDLE_DEMUX_H__ */
@@ -0,0 +1,970 @@
+/*
+ * Farstream - Farstream RTP Bundle
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rtp-bundle.c - A transport shared by all the sessions of a conference
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "fs-rtp-bundle.h"
+
+#include "fs-rtp-bundle-demux.h"
+#include "fs-rtp-conference.h"
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+
+/*
+ * A bundle owns a single component transmitter. The RTP and RTCP of every
+ * session are funneled into its only sink pad and what comes out of its
+ * src pad is split back between the sessions by a FsRtpBundleDemux.
+ *
+ * All the streams of one participant share the same stream transmitter,
+ * it is only stopped once the last of them is gone. Its candidates, states
+ * and active pairs are recorded and dispatched to every stream, so a stream
+ * that joins late still gets the ones emitted before.
+ *
+ * The streams expect an RTCP component like the transmitters of the
+ * sessions have, so everything about the RTP component is also reported
+ * to them as a copy for the RTCP component, with the same address. The
+ * remote side then sends its RTCP to the same socket, and the remote
+ * candidates of the RTCP component are ignored.
+ */
+
+struct _FsRtpBundle {
+  volatile gint refcount;
+
+  FsTransmitter *transmitter;
+  GstElement *transmitter_src;
+  GstElement *transmitter_sink;
+  GstElement *send_funnel;
+  GstElement *demux;
+
+  GMutex mutex;
+  /* Held while the signals of the stream transmitters are dispatched to
+   * the streams or replayed to a new one, so they see them in order.
+   * Taken before the mutex */
+  GRecMutex dispatch_mutex;
+
+  /* Protected by the mutex */
+  /* session id -> BundleSession */
+  GHashTable *sessions;
+  /* FsParticipant * -> BundleTransport */
+  GHashTable *transports;
+};
+
+typedef struct {
+  GstElement *rtp_tee;
+  GstElement *rtcp_tee;
+  GstElement *rtp_funnel;
+  GstElement *rtcp_funnel;
+  GstElement *send_funnel;
+  GstElement *demux;
+
+  GstPad *rtp_tee_pad;
+  GstPad *rtcp_tee_pad;
+  GstPad *rtp_send_pad;
+  GstPad *rtcp_send_pad;
+  GstPad *rtp_demux_pad;
+  GstPad *rtcp_demux_pad;
+  GstPad *rtp_funnel_pad;
+  GstPad *rtcp_funnel_pad;
+} BundleSession;
+
+typedef struct {
+  /* Only compared to, @ref is used to get a reference to it */
+  GObject *stream;
+  GWeakRef ref;
+  const FsRtpBundleStreamFuncs *funcs;
+} BundleStream;
+
+typedef struct {
+  FsRtpBundle *bundle;
+  FsParticipant *participant;
+  FsStreamTransmitter *st;
+
+  /* of BundleStream, for the FsRtpStreams using this transport */
+  GList *streams;
+  /* of GObject, the FsRtpStreams that want to send */
+  GList *sending_streams;
+
+  /* What the stream transmitter emitted so far, replayed to new streams */
+  GList *local_candidates;
+  gboolean prepared;
+  gboolean have_state;
+  FsStreamState state;
+  FsCandidate *active_local;
+  FsCandidate *active_remote;
+} BundleTransport;
+
+#define FS_RTP_BUNDLE_LOCK(bundle) g_mutex_lock (&(bundle)->mutex)
+#define FS_RTP_BUNDLE_UNLOCK(bundle) g_mutex_unlock (&(bundle)->mutex)
+
+static void
+stop_and_remove_element (GstElement *element)
+{
+  GstObject *parent;
+
+  if (!element)
+    return;
+
+  gst_element_set_locked_state (element, TRUE);
+  gst_element_set_state (element, GST_STATE_NULL);
+
+  parent = gst_object_get_parent (GST_OBJECT (element));
+  if (parent)
+  {
+    gst_bin_remove (GST_BIN (parent), element);
+    gst_object_unref (parent);
+  }
+
+  gst_object_unref (element);
+}
+
+static void
+release_request_pad (GstElement *element, GstPad *pad)
+{
+  GstPad *peer;
+
+  if (!pad)
+    return;
+
+  peer = gst_pad_get_peer (pad);
+  if (peer)
+  {
+    if (GST_PAD_DIRECTION (pad) == GST_PAD_SRC)
+      gst_pad_unlink (pad, peer);
+    else
+      gst_pad_unlink (peer, pad);
+    gst_object_unref (peer);
+  }
+
+  gst_element_release_request_pad (element, pad);
+  gst_object_unref (pad);
+}
+
+static void
+bundle_session_free (BundleSession *bs)
+{
+  release_request_pad (bs->rtp_tee, bs->rtp_tee_pad);
+  release_request_pad (bs->rtcp_tee, bs->rtcp_tee_pad);
+  release_request_pad (bs->rtp_funnel, bs->rtp_funnel_pad);
+  release_request_pad (bs->rtcp_funnel, bs->rtcp_funnel_pad);
+  release_request_pad (bs->send_funnel, bs->rtp_send_pad);
+  release_request_pad (bs->send_funnel, bs->rtcp_send_pad);
+  release_request_pad (bs->demux, bs->rtp_demux_pad);
+  release_request_pad (bs->demux, bs->rtcp_demux_pad);
+
+  g_clear_object (&bs->rtp_tee);
+  g_clear_object (&bs->rtcp_tee);
+  g_clear_object (&bs->rtp_funnel);
+  g_clear_object (&bs->rtcp_funnel);
+  g_clear_object (&bs->send_funnel);
+  g_clear_object (&bs->demux);
+
+  g_slice_free (BundleSession, bs);
+}
+
+/**
+ * fs_rtp_bundle_new:
+ * @conference: the #FsRtpConference as a #GstBin
+ * @transmitter_name: the name of the transmitter to use
+ * @tos: the IP ToS of the shared transport
+ * @error: location of a #GError, or %NULL
+ *
+ * Creates the shared transmitter and adds its elements to the conference.
+ *
+ * Returns: a new #FsRtpBundle or %NULL on error
+ */
+
+FsRtpBundle *
+fs_rtp_bundle_new (GstBin *conference, const gchar *transmitter_name,
+    guint tos, GError **error)
+{
+  FsRtpBundle *bundle;
+  GstPad *srcpad, *sinkpad;
+  GstPadLinkReturn ret;
+  gchar *tmp;
+
+  bundle = g_slice_new0 (FsRtpBundle);
+  bundle->refcount = 1;
+  g_mutex_init (&bundle->mutex);
+  g_rec_mutex_init (&bundle->dispatch_mutex);
+  bundle->sessions = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) bundle_session_free);
+  bundle->transports = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  /* RTCP goes over the RTP component */
+  bundle->transmitter = fs_transmitter_new (transmitter_name, 1, tos, error);
+  if (!bundle->transmitter)
+    goto error;
+
+  g_object_get (bundle->transmitter,
+      "gst-src", &bundle->transmitter_src,
+      "gst-sink", &bundle->transmitter_sink,
+      NULL);
+
+  tmp = g_strdup_printf ("bundle_send_funnel_%s", transmitter_name);
+  bundle->send_funnel = gst_element_factory_make ("funnel", tmp);
+  g_free (tmp);
+
+  if (!bundle->send_funnel)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not create the bundle funnel element");
+    goto error;
+  }
+  gst_object_ref_sink (bundle->send_funnel);
+
+  bundle->demux = GST_ELEMENT (fs_rtp_bundle_demux_new ());
+  tmp = g_strdup_printf ("bundle_demux_%s", transmitter_name);
+  gst_object_set_name (GST_OBJECT (bundle->demux), tmp);
+  g_free (tmp);
+  gst_object_ref_sink (bundle->demux);
+
+  if (!gst_bin_add (conference, bundle->transmitter_sink) ||
+      !gst_bin_add (conference, bundle->transmitter_src) ||
+      !gst_bin_add (conference, bundle->send_funnel) ||
+      !gst_bin_add (conference, bundle->demux))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not add the bundle elements for %s to the conference",
+        transmitter_name);
+    goto error;
+  }
+
+  srcpad = gst_element_get_static_pad (bundle->send_funnel, "src");
+  sinkpad = gst_element_get_static_pad (bundle->transmitter_sink, "sink_1");
+  ret = gst_pad_link (srcpad, sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+
+  if (GST_PAD_LINK_FAILED (ret))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link the bundle funnel to the transmitter sink");
+    goto error;
+  }
+
+  srcpad = gst_element_get_static_pad (bundle->transmitter_src, "src_1");
+  sinkpad = gst_element_get_static_pad (bundle->demux, "sink");
+  ret = gst_pad_link (srcpad, sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+
+  if (GST_PAD_LINK_FAILED (ret))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link the transmitter src to the bundle demuxer");
+    goto error;
+  }
+
+  gst_element_sync_state_with_parent (bundle->demux);
+  gst_element_sync_state_with_parent (bundle->transmitter_src);
+  gst_element_sync_state_with_parent (bundle->send_funnel);
+  gst_element_sync_state_with_parent (bundle->transmitter_sink);
+
+  return bundle;
+
+ error:
+  fs_rtp_bundle_unref (bundle);
+  return NULL;
+}
+
+FsRtpBundle *
+fs_rtp_bundle_ref (FsRtpBundle *bundle)
+{
+  g_atomic_int_inc (&bundle->refcount);
+
+  return bundle;
+}
+
+void
+fs_rtp_bundle_unref (FsRtpBundle *bundle)
+{
+  if (!g_atomic_int_dec_and_test (&bundle->refcount))
+    return;
+
+  /* Every transport holds a ref, so they are all gone by now */
+  g_assert (g_hash_table_size (bundle->transports) == 0);
+  g_hash_table_destroy (bundle->transports);
+  g_hash_table_destroy (bundle->sessions);
+
+  stop_and_remove_element (bundle->transmitter_src);
+  stop_and_remove_element (bundle->demux);
+  stop_and_remove_element (bundle->send_funnel);
+  stop_and_remove_element (bundle->transmitter_sink);
+
+  if (bundle->transmitter)
+    g_object_unref (bundle->transmitter);
+
+  g_mutex_clear (&bundle->mutex);
+  g_rec_mutex_clear (&bundle->dispatch_mutex);
+  g_slice_free (FsRtpBundle, bundle);
+}
+
+/**
+ * fs_rtp_bundle_get_transmitter:
+ * @bundle: a #FsRtpBundle
+ *
+ * Returns: the shared #FsTransmitter, valid as long as @bundle is
+ */
+
+FsTransmitter *
+fs_rtp_bundle_get_transmitter (FsRtpBundle *bundle)
+{
+  return bundle->transmitter;
+}
+
+static gboolean
+link_request_pads (GstElement *src, const gchar *src_name, GstPad **srcpad,
+    GstElement *sink, const gchar *sink_name, GstPad **sinkpad,
+    GError **error)
+{
+  *srcpad = gst_element_get_request_pad (src, src_name);
+  *sinkpad = gst_element_get_request_pad (sink, sink_name);
+
+  if (!*srcpad || !*sinkpad)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not get the %s or %s bundle pad", src_name, sink_name);
+    return FALSE;
+  }
+
+  if (GST_PAD_LINK_FAILED (gst_pad_link (*srcpad, *sinkpad)))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link the %s and %s bundle pads", src_name, sink_name);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ * fs_rtp_bundle_add_session:
+ * @bundle: a #FsRtpBundle
+ * @session_id: the id of the session
+ * @rtp_tee: the tee where the session's outgoing RTP comes out
+ * @rtcp_tee: the tee where the session's outgoing RTCP comes out
+ * @rtp_funnel: the funnel leading to the session's RTP input
+ * @rtcp_funnel: the funnel leading to the session's RTCP input
+ * @error: location of a #GError, or %NULL
+ *
+ * Plugs a session into the shared transport.
+ *
+ * Returns: %TRUE on success, %FALSE on error
+ */
+
+gboolean
+fs_rtp_bundle_add_session (FsRtpBundle *bundle, guint session_id,
+    GstElement *rtp_tee, GstElement *rtcp_tee,
+    GstElement *rtp_funnel, GstElement *rtcp_funnel,
+    GError **error)
+{
+  BundleSession *bs;
+  gchar *rtp_name, *rtcp_name;
+  gboolean ret;
+
+  FS_RTP_BUNDLE_LOCK (bundle);
+  if (g_hash_table_lookup (bundle->sessions, GUINT_TO_POINTER (session_id)))
+  {
+    FS_RTP_BUNDLE_UNLOCK (bundle);
+    return TRUE;
+  }
+  bs = g_slice_new0 (BundleSession);
+  g_hash_table_insert (bundle->sessions, GUINT_TO_POINTER (session_id), bs);
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+
+  rtp_name = g_strdup_printf ("rtp_src_%u", session_id);
+  rtcp_name = g_strdup_printf ("rtcp_src_%u", session_id);
+
+  bs->rtp_tee = gst_object_ref (rtp_tee);
+  bs->rtcp_tee = gst_object_ref (rtcp_tee);
+  bs->rtp_funnel = gst_object_ref (rtp_funnel);
+  bs->rtcp_funnel = gst_object_ref (rtcp_funnel);
+  bs->send_funnel = gst_object_ref (bundle->send_funnel);
+  bs->demux = gst_object_ref (bundle->demux);
+
+  ret = link_request_pads (rtp_tee, "src_%u", &bs->rtp_tee_pad,
+          bundle->send_funnel, "sink_%u", &bs->rtp_send_pad, error) &&
+      link_request_pads (rtcp_tee, "src_%u", &bs->rtcp_tee_pad,
+          bundle->send_funnel, "sink_%u", &bs->rtcp_send_pad, error) &&
+      link_request_pads (bundle->demux, rtp_name, &bs->rtp_demux_pad,
+          rtp_funnel, "sink_%u", &bs->rtp_funnel_pad, error) &&
+      link_request_pads (bundle->demux, rtcp_name, &bs->rtcp_demux_pad,
+          rtcp_funnel, "sink_%u", &bs->rtcp_funnel_pad, error);
+
+  g_free (rtp_name);
+  g_free (rtcp_name);
+
+  if (!ret)
+    fs_rtp_bundle_remove_session (bundle, session_id);
+
+  return ret;
+}
+
+/**
+ * fs_rtp_bundle_remove_session:
+ * @bundle: a #FsRtpBundle
+ * @session_id: the id of the session
+ *
+ * Unplugs a session from the shared transport, the payload types and SSRCs
+ * of the session are forgotten by the demuxer.
+ */
+
+void
+fs_rtp_bundle_remove_session (FsRtpBundle *bundle, guint session_id)
+{
+  BundleSession *bs;
+
+  FS_RTP_BUNDLE_LOCK (bundle);
+  bs = g_hash_table_lookup (bundle->sessions, GUINT_TO_POINTER (session_id));
+  if (bs)
+    g_hash_table_steal (bundle->sessions, GUINT_TO_POINTER (session_id));
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+
+  if (bs)
+    bundle_session_free (bs);
+}
+
+/**
+ * fs_rtp_bundle_set_payload_types:
+ * @bundle: a #FsRtpBundle
+ * @session_id: the id of the session
+ * @pts: the negotiated payload types of the session
+ * @n_pts: the number of elements in @pts
+ *
+ * Tells the demuxer which incoming RTP packets belong to the session.
+ */
+
+void
+fs_rtp_bundle_set_payload_types (FsRtpBundle *bundle, guint session_id,
+    const guint8 *pts, guint n_pts)
+{
+  fs_rtp_bundle_demux_set_payload_types (FS_RTP_BUNDLE_DEMUX (bundle->demux),
+      session_id, pts, n_pts);
+}
+
+static void
+bundle_transport_update_sending_locked (BundleTransport *bt)
+{
+  g_object_set (bt->st, "sending", (bt->sending_streams != NULL), NULL);
+}
+
+static BundleStream *
+bundle_transport_find_stream_locked (BundleTransport *bt, GObject *stream)
+{
+  GList *item;
+
+  for (item = bt->streams; item; item = item->next)
+  {
+    BundleStream *bs = item->data;
+
+    if (bs->stream == stream)
+      return bs;
+  }
+
+  return NULL;
+}
+
+static void
+bundle_stream_free (gpointer data)
+{
+  BundleStream *bs = data;
+
+  g_weak_ref_clear (&bs->ref);
+  g_slice_free (BundleStream, bs);
+}
+
+/* The copies hold a real reference on the stream instead of the weak one */
+static void
+bundle_stream_copy_free (gpointer data)
+{
+  BundleStream *bs = data;
+
+  g_object_unref (bs->stream);
+  g_slice_free (BundleStream, bs);
+}
+
+/*
+ * Returns copies of the streams of the transport, with a ref on each. The
+ * streams that are being finalized are skipped, their weak ref notify
+ * removes them from the transport.
+ */
+static GList *
+bundle_transport_copy_streams_locked (BundleTransport *bt)
+{
+  GList *streams = NULL;
+  GList *item;
+
+  for (item = bt->streams; item; item = item->next)
+  {
+    BundleStream *bs = item->data;
+    GObject *stream = g_weak_ref_get (&bs->ref);
+    BundleStream *copy;
+
+    if (!stream)
+      continue;
+
+    copy = g_slice_new0 (BundleStream);
+    copy->stream = stream;
+    copy->funcs = bs->funcs;
+    streams = g_list_prepend (streams, copy);
+  }
+
+  return streams;
+}
+
+static FsCandidate *
+copy_for_rtcp (FsCandidate *candidate)
+{
+  FsCandidate *copy = fs_candidate_copy (candidate);
+
+  copy->component_id = FS_COMPONENT_RTCP;
+
+  return copy;
+}
+
+/* These report what happens on the RTP component for the RTCP one too */
+
+static void
+bundle_stream_new_local_candidate (BundleStream *bs, FsStreamTransmitter *st,
+    FsCandidate *candidate)
+{
+  FsCandidate *rtcp;
+
+  bs->funcs->new_local_candidate (st, candidate, bs->stream);
+
+  if (candidate->component_id != FS_COMPONENT_RTP)
+    return;
+
+  rtcp = copy_for_rtcp (candidate);
+  bs->funcs->new_local_candidate (st, rtcp, bs->stream);
+  fs_candidate_destroy (rtcp);
+}
+
+static void
+bundle_stream_new_active_candidate_pair (BundleStream *bs,
+    FsStreamTransmitter *st, FsCandidate *local_candidate,
+    FsCandidate *remote_candidate)
+{
+  FsCandidate *rtcp_local, *rtcp_remote;
+
+  bs->funcs->new_active_candidate_pair (st, local_candidate,
+      remote_candidate, bs->stream);
+
+  if (local_candidate->component_id != FS_COMPONENT_RTP)
+    return;
+
+  rtcp_local = copy_for_rtcp (local_candidate);
+  rtcp_remote = copy_for_rtcp (remote_candidate);
+  bs->funcs->new_active_candidate_pair (st, rtcp_local, rtcp_remote,
+      bs->stream);
+  fs_candidate_destroy (rtcp_local);
+  fs_candidate_destroy (rtcp_remote);
+}
+
+static void
+bundle_stream_state_changed (BundleStream *bs, FsStreamTransmitter *st,
+    guint component, FsStreamState state)
+{
+  bs->funcs->state_changed (st, component, state, bs->stream);
+
+  if (component == FS_COMPONENT_RTP)
+    bs->funcs->state_changed (st, FS_COMPONENT_RTCP, state, bs->stream);
+}
+
+static void
+_transport_new_local_candidate (FsStreamTransmitter *st,
+    FsCandidate *candidate, gpointer user_data)
+{
+  BundleTransport *bt = user_data;
+  FsRtpBundle *bundle = bt->bundle;
+  GList *streams, *item;
+
+  g_rec_mutex_lock (&bundle->dispatch_mutex);
+  FS_RTP_BUNDLE_LOCK (bundle);
+  bt->local_candidates = g_list_append (bt->local_candidates,
+      fs_candidate_copy (candidate));
+  streams = bundle_transport_copy_streams_locked (bt);
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+
+  for (item = streams; item; item = item->next)
+    bundle_stream_new_local_candidate (item->data, st, candidate);
+  g_rec_mutex_unlock (&bundle->dispatch_mutex);
+
+  g_list_free_full (streams, bundle_stream_copy_free);
+}
+
+static void
+_transport_local_candidates_prepared (FsStreamTransmitter *st,
+    gpointer user_data)
+{
+  BundleTransport *bt = user_data;
+  FsRtpBundle *bundle = bt->bundle;
+  GList *streams, *item;
+
+  g_rec_mutex_lock (&bundle->dispatch_mutex);
+  FS_RTP_BUNDLE_LOCK (bundle);
+  bt->prepared = TRUE;
+  streams = bundle_transport_copy_streams_locked (bt);
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+
+  for (item = streams; item; item = item->next)
+  {
+    BundleStream *bs = item->data;
+
+    bs->funcs->local_candidates_prepared (st, bs->stream);
+  }
+  g_rec_mutex_unlock (&bundle->dispatch_mutex);
+
+  g_list_free_full (streams, bundle_stream_copy_free);
+}
+
+static void
+_transport_new_active_candidate_pair (FsStreamTransmitter *st,
+    FsCandidate *local_candidate, FsCandidate *remote_candidate,
+    gpointer user_data)
+{
+  BundleTransport *bt = user_data;
+  FsRtpBundle *bundle = bt->bundle;
+  GList *streams, *item;
+
+  g_rec_mutex_lock (&bundle->dispatch_mutex);
+  FS_RTP_BUNDLE_LOCK (bundle);
+  fs_candidate_destroy (bt->active_local);
+  fs_candidate_destroy (bt->active_remote);
+  bt->active_local = fs_candidate_copy (local_candidate);
+  bt->active_remote = fs_candidate_copy (remote_candidate);
+  streams = bundle_transport_copy_streams_locked (bt);
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+
+  for (item = streams; item; item = item->next)
+    bundle_stream_new_active_candidate_pair (item->data, st, local_candidate,
+        remote_candidate);
+  g_rec_mutex_unlock (&bundle->dispatch_mutex);
+
+  g_list_free_full (streams, bundle_stream_copy_free);
+}
+
+static void
+_transport_state_changed (FsStreamTransmitter *st, guint component,
+    FsStreamState state, gpointer user_data)
+{
+  BundleTransport *bt = user_data;
+  FsRtpBundle *bundle = bt->bundle;
+  GList *streams, *item;
+
+  g_rec_mutex_lock (&bundle->dispatch_mutex);
+  FS_RTP_BUNDLE_LOCK (bundle);
+  bt->have_state = TRUE;
+  bt->state = state;
+  streams = bundle_transport_copy_streams_locked (bt);
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+
+  for (item = streams; item; item = item->next)
+    bundle_stream_state_changed (item->data, st, component, state);
+  g_rec_mutex_unlock (&bundle->dispatch_mutex);
+
+  g_list_free_full (streams, bundle_stream_copy_free);
+}
+
+static BundleTransport *
+bundle_transport_new_locked (FsRtpBundle *bundle, FsParticipant *participant,
+    FsStreamTransmitter *st)
+{
+  BundleTransport *bt = g_slice_new0 (BundleTransport);
+
+  bt->bundle = bundle;
+  bt->participant = participant;
+  bt->st = st;
+
+  /* Connected before gathering, so nothing is missed */
+  g_signal_connect (st, "new-local-candidate",
+      G_CALLBACK (_transport_new_local_candidate), bt);
+  g_signal_connect (st, "local-candidates-prepared",
+      G_CALLBACK (_transport_local_candidates_prepared), bt);
+  g_signal_connect (st, "new-active-candidate-pair",
+      G_CALLBACK (_transport_new_active_candidate_pair), bt);
+  g_signal_connect (st, "state-changed",
+      G_CALLBACK (_transport_state_changed), bt);
+
+  g_hash_table_insert (bundle->transports, participant, bt);
+
+  return bt;
+}
+
+static void
+bundle_transport_free (BundleTransport *bt)
+{
+  g_signal_handlers_disconnect_by_data (bt->st, bt);
+  g_object_unref (bt->st);
+
+  fs_candidate_list_destroy (bt->local_candidates);
+  fs_candidate_destroy (bt->active_local);
+  fs_candidate_destroy (bt->active_remote);
+
+  g_slice_free (BundleTransport, bt);
+}
+
+/* Sends what the stream transmitter emitted before @bs was attached */
+static void
+bundle_transport_replay (BundleTransport *bt, BundleStream *bs)
+{
+  FsRtpBundle *bundle = bt->bundle;
+  GList *candidates, *item;
+  gboolean prepared;
+  gboolean have_state;
+  FsStreamState state;
+  FsCandidate *active_local;
+  FsCandidate *active_remote;
+
+  FS_RTP_BUNDLE_LOCK (bundle);
+  candidates = fs_candidate_list_copy (bt->local_candidates);
+  prepared = bt->prepared;
+  have_state = bt->have_state;
+  state = bt->state;
+  active_local = bt->active_local ?
+      fs_candidate_copy (bt->active_local) : NULL;
+  active_remote = bt->active_remote ?
+      fs_candidate_copy (bt->active_remote) : NULL;
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+
+  for (item = candidates; item; item = item->next)
+    bundle_stream_new_local_candidate (bs, bt->st, item->data);
+  if (prepared)
+    bs->funcs->local_candidates_prepared (bt->st, bs->stream);
+
+  if (have_state)
+    bundle_stream_state_changed (bs, bt->st, FS_COMPONENT_RTP, state);
+  if (active_local && active_remote)
+    bundle_stream_new_active_candidate_pair (bs, bt->st, active_local,
+        active_remote);
+
+  fs_candidate_destroy (active_local);
+  fs_candidate_destroy (active_remote);
+  fs_candidate_list_destroy (candidates);
+}
+
+static void
+_stream_disposed (gpointer user_data, GObject *where_the_object_was)
+{
+  BundleTransport *bt = user_data;
+  FsRtpBundle *bundle = bt->bundle;
+  BundleStream *bs;
+  gboolean last = FALSE;
+
+  FS_RTP_BUNDLE_LOCK (bundle);
+  bs = bundle_transport_find_stream_locked (bt, where_the_object_was);
+  bt->streams = g_list_remove (bt->streams, bs);
+  bundle_stream_free (bs);
+
+  if (g_list_find (bt->sending_streams, where_the_object_was))
+  {
+    bt->sending_streams = g_list_remove (bt->sending_streams,
+        where_the_object_was);
+    bundle_transport_update_sending_locked (bt);
+  }
+
+  if (!bt->streams)
+  {
+    g_hash_table_remove (bundle->transports, bt->participant);
+    last = TRUE;
+  }
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+
+  if (last)
+  {
+    GST_DEBUG ("Last bundled stream for participant %p is gone",
+        bt->participant);
+    fs_stream_transmitter_stop (bt->st);
+    bundle_transport_free (bt);
+  }
+
+  fs_rtp_bundle_unref (bundle);
+}
+
+/**
+ * fs_rtp_bundle_get_stream_transmitter:
+ * @bundle: a #FsRtpBundle
+ * @stream: the #FsRtpStream that will use the stream transmitter
+ * @funcs: the functions the signals of the stream transmitter are
+ *  dispatched to, must stay valid as long as @stream
+ * @participant: the #FsParticipant of @stream
+ * @parameters: the parameters of the stream transmitter
+ * @n_parameters: the number of elements in @parameters
+ * @gathered: set to %TRUE if the local candidates of the returned stream
+ *  transmitter have already been gathered
+ * @error: location of a #GError, or %NULL
+ *
+ * Gets the stream transmitter shared by all the streams of @participant,
+ * creating it if @stream is the first one. The parameters are only used
+ * when it is created. It is not sending until a stream is marked as sending
+ * with fs_rtp_bundle_set_stream_sending() and it is stopped once the last
+ * stream is disposed, so streams must not stop it themselves.
+ *
+ * Its local candidates, states and active candidate pairs are given to
+ * @funcs instead of being signalled to @stream, those emitted before this
+ * call are replayed to it before it returns.
+ *
+ * Returns: a #FsStreamTransmitter (unref after use) or %NULL on error
+ */
+
+FsStreamTransmitter *
+fs_rtp_bundle_get_stream_transmitter (FsRtpBundle *bundle,
+    GObject *stream,
+    const FsRtpBundleStreamFuncs *funcs,
+    FsParticipant *participant,
+    GParameter *parameters,
+    guint n_parameters,
+    gboolean *gathered,
+    GError **error)
+{
+  BundleTransport *bt;
+  BundleStream *bs;
+  FsStreamTransmitter *st = NULL;
+  FsStreamTransmitter *ret;
+
+  g_rec_mutex_lock (&bundle->dispatch_mutex);
+  FS_RTP_BUNDLE_LOCK (bundle);
+  bt = g_hash_table_lookup (bundle->transports, participant);
+  if (!bt)
+  {
+    FS_RTP_BUNDLE_UNLOCK (bundle);
+
+    st = fs_transmitter_new_stream_transmitter (bundle->transmitter,
+        participant, n_parameters, parameters, error);
+    if (!st)
+    {
+      g_rec_mutex_unlock (&bundle->dispatch_mutex);
+      return NULL;
+    }
+    g_object_set (st, "sending", FALSE, NULL);
+
+    FS_RTP_BUNDLE_LOCK (bundle);
+    /* Check if another stream of the same participant raced us */
+    bt = g_hash_table_lookup (bundle->transports, participant);
+    if (!bt)
+    {
+      bt = bundle_transport_new_locked (bundle, participant, st);
+      st = NULL;
+      *gathered = FALSE;
+    }
+    else
+    {
+      *gathered = TRUE;
+    }
+  }
+  else
+  {
+    *gathered = TRUE;
+  }
+
+  bs = g_slice_new (BundleStream);
+  bs->stream = stream;
+  g_weak_ref_init (&bs->ref, stream);
+  bs->funcs = funcs;
+  bt->streams = g_list_prepend (bt->streams, bs);
+  g_object_weak_ref (stream, _stream_disposed, bt);
+  fs_rtp_bundle_ref (bundle);
+  ret = g_object_ref (bt->st);
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+
+  /* The transport is kept alive by @stream, which the caller holds */
+  bundle_transport_replay (bt, bs);
+  g_rec_mutex_unlock (&bundle->dispatch_mutex);
+
+  if (st)
+  {
+    fs_stream_transmitter_stop (st);
+    g_object_unref (st);
+  }
+
+  return ret;
+}
+
+/**
+ * fs_rtp_bundle_set_stream_sending:
+ * @bundle: a #FsRtpBundle
+ * @stream: a #FsRtpStream using the bundle
+ * @sending: whether @stream wants to send
+ *
+ * The shared stream transmitter sends as long as one of its streams does.
+ */
+
+void
+fs_rtp_bundle_set_stream_sending (FsRtpBundle *bundle, GObject *stream,
+    gboolean sending)
+{
+  GHashTableIter iter;
+  gpointer value;
+
+  FS_RTP_BUNDLE_LOCK (bundle);
+  g_hash_table_iter_init (&iter, bundle->transports);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+  {
+    BundleTransport *bt = value;
+    gboolean was_sending;
+
+    if (!bundle_transport_find_stream_locked (bt, stream))
+      continue;
+
+    was_sending = (g_list_find (bt->sending_streams, stream) != NULL);
+    if (sending && !was_sending)
+      bt->sending_streams = g_list_prepend (bt->sending_streams, stream);
+    else if (!sending && was_sending)
+      bt->sending_streams = g_list_remove (bt->sending_streams, stream);
+    else
+      break;
+
+    bundle_transport_update_sending_locked (bt);
+    break;
+  }
+  FS_RTP_BUNDLE_UNLOCK (bundle);
+}
+
+/**
+ * fs_rtp_bundle_filter_remote_candidates:
+ * @candidates: a #GList of #FsCandidate
+ *
+ * The remote side sends its RTCP to the RTP component of the shared
+ * transport, so the remote candidates of the RTCP component are dropped.
+ *
+ * Returns: a new list of the candidates of @candidates for the RTP
+ *  component, free it with g_list_free()
+ */
+
+GList *
+fs_rtp_bundle_filter_remote_candidates (GList *candidates)
+{
+  GList *filtered = NULL;
+  GList *item;
+
+  for (item = candidates; item; item = item->next)
+  {
+    FsCandidate *candidate = item->data;
+
+    if (candidate->component_id == FS_COMPONENT_RTP)
+      filtered = g_list_prepend (filtered, candidate);
+  }
+
+  return g_list_reverse (filtered);
+}
@@ -0,0 +1,103 @@
+/*
+ * Farstream - Farstream RTP Bundle
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rtp-bundle.h - A transport shared by all the sessions of a conference
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef __FS_RTP_BUNDLE_H__
+#define __FS_RTP_BUNDLE_H__
+
+#include <gst/gst.h>
+
+#include <farstream/fs-participant.h>
+#include <farstream/fs-transmitter.h>
+
+G_BEGIN_DECLS
+
+typedef struct _FsRtpBundle FsRtpBundle;
+
+/**
+ * FsRtpBundleStreamFuncs:
+ * @new_local_candidate: Called for each local candidate of the transport
+ * @local_candidates_prepared: Called once all the local candidates have
+ *  been gathered
+ * @new_active_candidate_pair: Called when a component has a new active pair
+ * @state_changed: Called when the state of a component changes
+ *
+ * The signals of the shared stream transmitter are dispatched to each of
+ * its streams through these, which have the signatures of the signal
+ * handlers, with the stream as user data. When a stream is attached to a
+ * transport that already emitted some of them, they are replayed to it.
+ */
+typedef struct {
+  void (*new_local_candidate) (FsStreamTransmitter *st,
+      FsCandidate *candidate, gpointer stream);
+  void (*local_candidates_prepared) (FsStreamTransmitter *st,
+      gpointer stream);
+  void (*new_active_candidate_pair) (FsStreamTransmitter *st,
+      FsCandidate *local_candidate, FsCandidate *remote_candidate,
+      gpointer stream);
+  void (*state_changed) (FsStreamTransmitter *st, guint component,
+      FsStreamState state, gpointer stream);
+} FsRtpBundleStreamFuncs;
+
+FsRtpBundle *fs_rtp_bundle_new (GstBin *conference,
+    const gchar *transmitter_name,
+    guint tos,
+    GError **error);
+
+FsRtpBundle *fs_rtp_bundle_ref (FsRtpBundle *bundle);
+void fs_rtp_bundle_unref (FsRtpBundle *bundle);
+
+FsTransmitter *fs_rtp_bundle_get_transmitter (FsRtpBundle *bundle);
+
+gboolean fs_rtp_bundle_add_session (FsRtpBundle *bundle,
+    guint session_id,
+    GstElement *rtp_tee,
+    GstElement *rtcp_tee,
+    GstElement *rtp_funnel,
+    GstElement *rtcp_funnel,
+    GError **error);
+void fs_rtp_bundle_remove_session (FsRtpBundle *bundle, guint session_id);
+
+void fs_rtp_bundle_set_payload_types (FsRtpBundle *bundle,
+    guint session_id,
+    const guint8 *pts,
+    guint n_pts);
+
+FsStreamTransmitter *fs_rtp_bundle_get_stream_transmitter (
+    FsRtpBundle *bundle,
+    GObject *stream,
+    const FsRtpBundleStreamFuncs *funcs,
+    FsParticipant *participant,
+    GParameter *parameters,
+    guint n_parameters,
+    gboolean *gathered,
+    GError **error);
+
+void fs_rtp_bundle_set_stream_sending (FsRtpBundle *bundle,
+    GObject *stream,
+    gboolean sending);
+
+GList *fs_rtp_bundle_filter_remote_candidates (GList *candidates);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_BUNDLE_H__ */
@@ -354,7 +354,7 @@ load_codecs_cache (FsMediaType media_type)
       magic[2] != magic_media ||
       magic[3] != 'C' ||
       magic[4] != '1' ||   /* This is the version number */
-      magic[5] != '2') {
+      magic[5] != '3') {
     GST_WARNING ("Cache file has incorrect magic header. File corrupted");
     goto error;
   }
@@ -557,7 +557,7 @@ save_codecs_cache (FsMediaType media_type, GList *blueprints)
 
   /* version of the binary format */
   magic[4] = '1';
-  magic[5] = '2';
+  magic[5] = '3';
 
   if (write (fd, magic, 8) != 8)
     return FALSE;
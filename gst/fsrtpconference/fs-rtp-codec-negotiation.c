@@ -35,6 +35,7 @@
 #include "fs-rtp-bin-error-downgrade.h"
 #include "fs-rtp-codec-specific.h"
 #include "fs-rtp-conference.h"
+#include "fs-rtp-retransmission.h"
 
 
 #define GST_CAT_DEFAULT fsrtpconference_nego
@@ -531,6 +532,75 @@ list_insert_local_ca (GList *list, CodecAssociation *ca)
   return g_list_append (list, ca);
 }
 
+static gboolean
+match_rtx_codec (CodecAssociation *ca, gpointer user_data)
+{
+  gint apt;
+
+  return fs_rtp_codec_is_rtx (ca->codec, &apt) &&
+      apt == GPOINTER_TO_INT (user_data);
+}
+
+/*
+ * Adds an RTX codec (RFC 4588) for every codec with the "nack" feedback
+ * parameter, keeping the payload type it had before if it is still free.
+ * None of the default preferences have it, the application must ask for
+ * it in the codec preferences.
+ */
+
+static GList *
+add_local_rtx_codec_associations (GList *codec_associations,
+    GList *current_codec_associations)
+{
+  GList *item;
+
+  for (item = codec_associations; item; item = item->next)
+  {
+    CodecAssociation *ca = item->data;
+    CodecAssociation *rtx_ca;
+    CodecAssociation *old_ca;
+    gchar *apt;
+
+    if (ca->reserved || ca->disable ||
+        !fs_codec_get_feedback_parameter (ca->codec, "nack", "", NULL))
+      continue;
+
+    rtx_ca = g_slice_new0 (CodecAssociation);
+    rtx_ca->codec = fs_codec_new (FS_CODEC_ID_ANY, "rtx",
+        ca->codec->media_type, ca->codec->clock_rate);
+    apt = g_strdup_printf ("%d", ca->codec->id);
+    fs_codec_add_optional_parameter (rtx_ca->codec, "apt", apt);
+    g_free (apt);
+
+    old_ca = lookup_codec_association_custom_internal (
+        current_codec_associations, FALSE, match_rtx_codec,
+        GINT_TO_POINTER (ca->codec->id));
+    if (old_ca && !lookup_codec_association_by_pt_list (codec_associations,
+            old_ca->codec->id, TRUE))
+      rtx_ca->codec->id = old_ca->codec->id;
+    else
+      rtx_ca->codec->id = _find_first_empty_dynamic_entry (
+          current_codec_associations, codec_associations);
+
+    if (rtx_ca->codec->id < 0)
+    {
+      GST_WARNING ("No dynamic payload type left for the RTX codec of "
+          FS_CODEC_FORMAT, FS_CODEC_ARGS (ca->codec));
+      _codec_association_destroy (rtx_ca);
+      break;
+    }
+
+    rtx_ca->send_codec = fs_codec_copy (rtx_ca->codec);
+
+    GST_LOG ("Added RTX codec " FS_CODEC_FORMAT, FS_CODEC_ARGS (rtx_ca->codec));
+
+    /* It has no feedback parameter, so the loop skips it */
+    codec_associations = g_list_append (codec_associations, rtx_ca);
+  }
+
+  return codec_associations;
+}
+
 static gboolean
 verify_caps (CodecPreference *cp, CodecBlueprint *bp, GstCaps *input_caps,
     GstCaps *output_caps)
@@ -895,6 +965,9 @@ create_local_codec_associations (
     codec_associations = list_insert_local_ca (codec_associations, ca);
   }
 
+  codec_associations = add_local_rtx_codec_associations (codec_associations,
+      current_codec_associations);
+
   for (lca_e = codec_associations;
        lca_e;
        lca_e = g_list_next (lca_e))
@@ -986,6 +1059,55 @@ negotiate_stream_codec (CodecAssociation *old_ca, FsCodec *remote_codec,
   }
 }
 
+/*
+ * An RTX codec is kept if the codec it retransmits was negotiated with the
+ * "nack" feedback parameter and if we offered RTX for it too
+ */
+
+static CodecAssociation *
+negotiate_stream_rtx_codec (FsCodec *remote_codec, gint nego_apt,
+    gint local_apt, GList *current_codec_associations,
+    GList *new_codec_associations, gboolean multi_stream)
+{
+  CodecAssociation *new_ca = g_slice_new0 (CodecAssociation);
+  CodecAssociation *apt_ca = NULL;
+  CodecAssociation *local_ca = NULL;
+
+  if (nego_apt >= 0)
+    apt_ca = lookup_codec_association_by_pt_list (new_codec_associations,
+        nego_apt, FALSE);
+  if (local_apt >= 0)
+    local_ca = lookup_codec_association_custom_internal (
+        current_codec_associations, FALSE, match_rtx_codec,
+        GINT_TO_POINTER (local_apt));
+
+  if (apt_ca && local_ca &&
+      fs_codec_get_feedback_parameter (apt_ca->codec, "nack", "", NULL))
+  {
+    gchar *apt = g_strdup_printf ("%d", apt_ca->codec->id);
+
+    new_ca->codec = fs_codec_new (
+        multi_stream ? local_ca->codec->id : remote_codec->id, "rtx",
+        apt_ca->codec->media_type, apt_ca->codec->clock_rate);
+    fs_codec_add_optional_parameter (new_ca->codec, "apt", apt);
+    new_ca->send_codec = fs_codec_copy (new_ca->codec);
+    g_free (apt);
+
+    GST_DEBUG ("Negotiated RTX codec " FS_CODEC_FORMAT,
+        FS_CODEC_ARGS (new_ca->codec));
+  }
+  else
+  {
+    GST_DEBUG ("Refusing RTX codec " FS_CODEC_FORMAT,
+        FS_CODEC_ARGS (remote_codec));
+
+    new_ca->codec = fs_codec_copy (remote_codec);
+    new_ca->disable = TRUE;
+  }
+
+  return new_ca;
+}
+
 /**
  * negotiate_stream_codecs:
  * @remote_codecs: Remote codecs for the stream
@@ -1007,10 +1129,17 @@ negotiate_stream_codecs (
   GList *new_codec_associations = NULL;
   const GList *rcodec_e = NULL;
   GList *item = NULL;
+  /* The negotiated and local payload types of each remote one */
+  gint nego_pts[128];
+  gint local_pts[128];
+  gint i;
 
   GST_DEBUG ("Negotiating stream codecs (for %s)",
       multi_stream ? "a single stream" : "multiple streams");
 
+  for (i = 0; i < 128; i++)
+    nego_pts[i] = local_pts[i] = -1;
+
   for (rcodec_e = remote_codecs;
        rcodec_e;
        rcodec_e = g_list_next (rcodec_e)) {
@@ -1023,6 +1152,10 @@ negotiate_stream_codecs (
     GST_DEBUG ("Remote codec %s", tmp);
     g_free (tmp);
 
+    /* Once the codecs they retransmit are negotiated */
+    if (fs_rtp_codec_is_rtx (remote_codec, NULL))
+      continue;
+
     /* First lets try the codec that is in the same PT */
 
     old_ca = lookup_codec_association_by_pt_list (current_codec_associations,
@@ -1075,6 +1208,12 @@ negotiate_stream_codecs (
       GST_DEBUG ("Negotiated codec %s", tmp);
       g_free (tmp);
 
+      if (remote_codec->id >= 0 && remote_codec->id < 128)
+      {
+        nego_pts[remote_codec->id] = nego_codec->id;
+        local_pts[remote_codec->id] = old_ca->codec->id;
+      }
+
       new_codec_associations = g_list_append (new_codec_associations,
           new_ca);
     } else {
@@ -1091,6 +1230,20 @@ negotiate_stream_codecs (
     }
   }
 
+  for (rcodec_e = remote_codecs;
+       rcodec_e;
+       rcodec_e = g_list_next (rcodec_e))
+  {
+    FsCodec *remote_codec = rcodec_e->data;
+    gint apt;
+
+    if (fs_rtp_codec_is_rtx (remote_codec, &apt))
+      new_codec_associations = g_list_append (new_codec_associations,
+          negotiate_stream_rtx_codec (remote_codec, nego_pts[apt],
+              local_pts[apt], current_codec_associations,
+              new_codec_associations, multi_stream));
+  }
+
   /*
    * Check if there is a non-disabled codec left that we can use
    * for sending
@@ -1228,6 +1381,54 @@ finish_codec_negotiation (
 }
 
 
+/**
+ * filter_rtx_codec_associations:
+ * @codec_associations: a #GList of #CodecAssociation
+ * @supported: %FALSE if the RTX codecs can not be handled
+ *
+ * Removes the RTX codecs if they can not be handled, or if the codec they
+ * retransmit is gone or does not have the "nack" feedback parameter anymore
+ *
+ * Returns: the modified list of #CodecAssociation
+ */
+
+GList *
+filter_rtx_codec_associations (GList *codec_associations, gboolean supported)
+{
+  GList *item;
+
+  for (item = codec_associations; item;)
+  {
+    CodecAssociation *ca = item->data;
+    CodecAssociation *apt_ca = NULL;
+    GList *next = item->next;
+    gint apt;
+
+    if (ca->disable || ca->reserved || !fs_rtp_codec_is_rtx (ca->codec, &apt))
+    {
+      item = next;
+      continue;
+    }
+
+    if (supported)
+      apt_ca = lookup_codec_association_by_pt_list (codec_associations, apt,
+          FALSE);
+
+    if (!apt_ca || fs_rtp_codec_is_rtx (apt_ca->codec, NULL) ||
+        !fs_codec_get_feedback_parameter (apt_ca->codec, "nack", "", NULL))
+    {
+      GST_DEBUG ("Removing RTX codec " FS_CODEC_FORMAT,
+          FS_CODEC_ARGS (ca->codec));
+      _codec_association_destroy (ca);
+      codec_associations = g_list_delete_link (codec_associations, item);
+    }
+
+    item = next;
+  }
+
+  return codec_associations;
+}
+
 static CodecAssociation *
 lookup_codec_association_by_pt_list (GList *codec_associations, gint pt,
                                      gboolean want_disabled)
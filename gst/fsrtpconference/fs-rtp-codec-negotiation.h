@@ -98,6 +98,9 @@ finish_codec_negotiation (
     GList *old_codec_associations,
     GList *new_codec_associations);
 
+GList *
+filter_rtx_codec_associations (GList *codec_associations, gboolean supported);
+
 CodecAssociation *
 lookup_codec_association_by_pt (GList *codec_associations, gint pt);
 
@@ -33,6 +33,10 @@
  *
  * The various sdes property allow you to set the content of the SDES packet
  * in the sent RTCP reports.
+ *
+ * If the #FsRtpConference:bundle property is set, all the sessions share
+ * a single transport per transmitter and participant, RTCP being
+ * multiplexed with RTP as in RFC 5761.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -48,6 +52,7 @@
 #include "fs-rtp-session.h"
 #include "fs-rtp-stream.h"
 #include "fs-rtp-participant.h"
+#include "fs-rtp-bundle.h"
 
 
 GST_DEBUG_CATEGORY (fsrtpconference_debug);
@@ -66,6 +71,7 @@ enum
 {
   PROP_0,
   PROP_SDES,
+  PROP_BUNDLE,
 };
 
 
@@ -98,6 +104,20 @@ struct _FsRtpConferencePrivate
 
   /* Array of all internal threads, as GThreads */
   GPtrArray *threads;
+
+  /* Shared by all the timers of the sessions, never changes */
+  FsRtpTimerWheel *timer_wheel;
+
+  /* Shares the bandwidth between the sessions, never changes */
+  FsRtpBandwidthAllocator *bandwidth_allocator;
+
+  /* Relays the packets between the forwarding sessions, never changes */
+  FsRtpForwarder *forwarder;
+
+  /* Protected by GST_OBJECT_LOCK */
+  gboolean bundle;
+  /* transmitter name -> FsRtpBundle */
+  GHashTable *bundles;
 };
 
 G_DEFINE_TYPE (FsRtpConference, fs_rtp_conference, FS_TYPE_CONFERENCE);
@@ -186,6 +206,8 @@ fs_rtp_conference_dispose (GObject * object)
   g_list_free (self->priv->participants);
   self->priv->participants = NULL;
 
+  g_hash_table_remove_all (self->priv->bundles);
+
   self->priv->disposed = TRUE;
 
   G_OBJECT_CLASS (fs_rtp_conference_parent_class)->dispose (object);
@@ -202,6 +224,14 @@ fs_rtp_conference_finalize (GObject * object)
 
   g_ptr_array_free (self->priv->threads, TRUE);
 
+  fs_rtp_timer_wheel_unref (self->priv->timer_wheel);
+
+  fs_rtp_bandwidth_allocator_unref (self->priv->bandwidth_allocator);
+
+  fs_rtp_forwarder_unref (self->priv->forwarder);
+
+  g_hash_table_destroy (self->priv->bundles);
+
   G_OBJECT_CLASS (fs_rtp_conference_parent_class)->finalize (object);
 }
 
@@ -255,6 +285,21 @@ fs_rtp_conference_class_init (FsRtpConferenceClass * klass)
       g_param_spec_boxed ("sdes", "SDES Items for this conference",
           "SDES items to use for sessions in this conference",
           GST_TYPE_STRUCTURE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * FsRtpConference:bundle:
+   *
+   * Makes all the sessions send and receive over a single transport per
+   * transmitter and participant, with RTCP multiplexed on the RTP
+   * component. The incoming packets are sent to the session that negotiated
+   * their payload type. It only applies to the streams whose transmitter is
+   * set afterwards and the payload types of different sessions must not
+   * overlap.
+   */
+  g_object_class_install_property (gobject_class, PROP_BUNDLE,
+      g_param_spec_boolean ("bundle", "Bundle all sessions",
+          "Share a single rtcp-muxed transport between all the sessions",
+          FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -269,6 +314,15 @@ fs_rtp_conference_init (FsRtpConference *conf)
 
   conf->priv->threads = g_ptr_array_new ();
 
+  conf->priv->timer_wheel = fs_rtp_timer_wheel_new ();
+
+  conf->priv->bandwidth_allocator = fs_rtp_bandwidth_allocator_new ();
+
+  conf->priv->forwarder = fs_rtp_forwarder_new ();
+
+  conf->priv->bundles = g_hash_table_new_full (g_str_hash, g_str_equal,
+      g_free, (GDestroyNotify) fs_rtp_bundle_unref);
+
   conf->rtpbin = gst_element_factory_make ("rtpbin", NULL);
 
   if (!conf->rtpbin) {
@@ -318,6 +372,11 @@ fs_rtp_conference_get_property (GObject *object,
     case PROP_SDES:
       g_object_get_property (G_OBJECT (self->rtpbin), "sdes", value);
       break;
+    case PROP_BUNDLE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_boolean (value, self->priv->bundle);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -340,6 +399,11 @@ fs_rtp_conference_set_property (GObject *object,
     case PROP_SDES:
       g_object_set_property (G_OBJECT (self->rtpbin), "sdes", value);
       break;
+    case PROP_BUNDLE:
+      GST_OBJECT_LOCK (self);
+      self->priv->bundle = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -857,3 +921,114 @@ fs_rtp_conference_is_internal_thread (FsRtpConference *self)
 
   return ret;
 }
+
+/**
+ * fs_rtp_conference_get_timer_wheel:
+ * @self: a #FsRtpConference
+ *
+ * Gets the timer wheel shared by all the sessions of the conference. The
+ * returned pointer is valid as long as the conference is alive, take a
+ * reference with fs_rtp_timer_wheel_ref() to keep it longer.
+ *
+ * Returns: the #FsRtpTimerWheel of the conference
+ */
+
+FsRtpTimerWheel *
+fs_rtp_conference_get_timer_wheel (FsRtpConference *self)
+{
+  return self->priv->timer_wheel;
+}
+
+/**
+ * fs_rtp_conference_get_bandwidth_allocator:
+ * @self: a #FsRtpConference
+ *
+ * Gets the allocator that shares the estimated bandwidth between the
+ * sessions going to the same participant. The returned pointer is valid
+ * as long as the conference is alive.
+ *
+ * Returns: the #FsRtpBandwidthAllocator of the conference
+ */
+
+FsRtpBandwidthAllocator *
+fs_rtp_conference_get_bandwidth_allocator (FsRtpConference *self)
+{
+  return self->priv->bandwidth_allocator;
+}
+
+/**
+ * fs_rtp_conference_get_forwarder:
+ * @self: a #FsRtpConference
+ *
+ * Gets the forwarder that relays the packets received by the sessions
+ * that have the "forwarding" property set to the other ones. The returned
+ * pointer is valid as long as the conference is alive.
+ *
+ * Returns: the #FsRtpForwarder of the conference
+ */
+
+FsRtpForwarder *
+fs_rtp_conference_get_forwarder (FsRtpConference *self)
+{
+  return self->priv->forwarder;
+}
+
+/**
+ * fs_rtp_conference_get_bundle:
+ * @self: a #FsRtpConference
+ * @transmitter_name: the name of the transmitter
+ * @tos: the IP ToS to use if the bundle has to be created
+ * @error: location of a #GError, or %NULL
+ *
+ * Gets the transport shared by all the sessions using @transmitter_name,
+ * creating it if needed.
+ *
+ * Returns: a #FsRtpBundle (unref after use) or %NULL if bundling is
+ *  disabled or on error
+ */
+
+FsRtpBundle *
+fs_rtp_conference_get_bundle (FsRtpConference *self,
+    const gchar *transmitter_name, guint tos, GError **error)
+{
+  FsRtpBundle *bundle = NULL;
+
+  GST_OBJECT_LOCK (self);
+  if (!self->priv->bundle || self->priv->disposed)
+  {
+    GST_OBJECT_UNLOCK (self);
+    return NULL;
+  }
+
+  bundle = g_hash_table_lookup (self->priv->bundles, transmitter_name);
+  if (bundle)
+  {
+    fs_rtp_bundle_ref (bundle);
+    GST_OBJECT_UNLOCK (self);
+    return bundle;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  bundle = fs_rtp_bundle_new (GST_BIN (self), transmitter_name, tos, error);
+  if (!bundle)
+    return NULL;
+
+  GST_OBJECT_LOCK (self);
+  /* Check if two were created at the same time */
+  if (g_hash_table_lookup (self->priv->bundles, transmitter_name))
+  {
+    FsRtpBundle *other = g_hash_table_lookup (self->priv->bundles,
+        transmitter_name);
+
+    fs_rtp_bundle_ref (other);
+    GST_OBJECT_UNLOCK (self);
+    fs_rtp_bundle_unref (bundle);
+    return other;
+  }
+
+  g_hash_table_insert (self->priv->bundles, g_strdup (transmitter_name),
+      fs_rtp_bundle_ref (bundle));
+  GST_OBJECT_UNLOCK (self);
+
+  return bundle;
+}
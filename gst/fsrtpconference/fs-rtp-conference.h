@@ -28,6 +28,11 @@
 
 #include <farstream/fs-conference.h>
 
+#include "fs-rtp-timer-wheel.h"
+#include "fs-rtp-bundle.h"
+#include "fs-rtp-bandwidth-allocator.h"
+#include "fs-rtp-forwarder.h"
+
 G_BEGIN_DECLS
 
 #define FS_TYPE_RTP_CONFERENCE \
@@ -79,6 +84,16 @@ GstCaps *fs_codec_to_gst_caps_with_ptime (const FsCodec *codec);
 
 gboolean fs_rtp_conference_is_internal_thread (FsRtpConference *self);
 
+FsRtpTimerWheel *fs_rtp_conference_get_timer_wheel (FsRtpConference *self);
+
+FsRtpBundle *fs_rtp_conference_get_bundle (FsRtpConference *self,
+    const gchar *transmitter_name, guint tos, GError **error);
+
+FsRtpBandwidthAllocator *fs_rtp_conference_get_bandwidth_allocator (
+    FsRtpConference *self);
+
+FsRtpForwarder *fs_rtp_conference_get_forwarder (FsRtpConference *self);
+
 G_END_DECLS
 
 #endif /* __FS_RTP_CONFERENCE_H__ */
@@ -0,0 +1,152 @@
+/*
+ * Farstream - Farstream RTP Congestion Control
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-congestion-control.c - Base class for the rate controllers of
+ *  Farstream RTP sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-congestion-control.h"
+
+/*
+ * The session creates one of each subclass and lets the codec negotiation
+ * decide which one is in use: each of them only acts on the payload types
+ * for which the matching feedback parameter and header extension were
+ * negotiated, and the session only follows the bitrate of the one enabled
+ * for the current send codec.
+ */
+
+G_DEFINE_ABSTRACT_TYPE (FsRtpCongestionControl, fs_rtp_congestion_control,
+    GST_TYPE_OBJECT);
+
+/* props */
+enum
+{
+  PROP_0,
+  PROP_BITRATE,
+  PROP_SENDING
+};
+
+/* The subclasses override both properties */
+
+static void
+fs_rtp_congestion_control_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+}
+
+static void
+fs_rtp_congestion_control_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+}
+
+static void
+fs_rtp_congestion_control_class_init (FsRtpCongestionControlClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->get_property = fs_rtp_congestion_control_get_property;
+  gobject_class->set_property = fs_rtp_congestion_control_set_property;
+
+  g_object_class_install_property (gobject_class,
+      PROP_BITRATE,
+      g_param_spec_uint ("bitrate",
+          "The bitrate at which data should be sent",
+          "The bitrate that the session should try to send at in bits/sec",
+          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SENDING,
+      g_param_spec_boolean ("sending",
+          "Whether the session is sending",
+          "Whether any stream of the session is sending",
+          FALSE, G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+fs_rtp_congestion_control_init (FsRtpCongestionControl *self)
+{
+}
+
+void
+fs_rtp_congestion_control_destroy (FsRtpCongestionControl *self)
+{
+  g_return_if_fail (FS_IS_RTP_CONGESTION_CONTROL (self));
+
+  FS_RTP_CONGESTION_CONTROL_GET_CLASS (self)->destroy (self);
+}
+
+void
+fs_rtp_congestion_control_codecs_updated (FsRtpCongestionControl *self,
+    GList *codec_associations,
+    GList *header_extensions)
+{
+  g_return_if_fail (FS_IS_RTP_CONGESTION_CONTROL (self));
+
+  FS_RTP_CONGESTION_CONTROL_GET_CLASS (self)->codecs_updated (self,
+      codec_associations, header_extensions);
+}
+
+gboolean
+fs_rtp_congestion_control_is_enabled (FsRtpCongestionControl *self, guint pt)
+{
+  g_return_val_if_fail (FS_IS_RTP_CONGESTION_CONTROL (self), FALSE);
+  g_return_val_if_fail (pt < 128, FALSE);
+
+  return FS_RTP_CONGESTION_CONTROL_GET_CLASS (self)->is_enabled (self, pt);
+}
+
+void
+fs_rtp_congestion_control_warm_start (FsRtpCongestionControl *self,
+    guint bitrate)
+{
+  FsRtpCongestionControlClass *klass;
+
+  g_return_if_fail (FS_IS_RTP_CONGESTION_CONTROL (self));
+
+  klass = FS_RTP_CONGESTION_CONTROL_GET_CLASS (self);
+  if (klass->warm_start)
+    klass->warm_start (self, bitrate);
+}
+
+gboolean
+fs_rtp_congestion_control_get_path (FsRtpCongestionControl *self,
+    guint *rtt,
+    gdouble *loss)
+{
+  FsRtpCongestionControlClass *klass;
+
+  g_return_val_if_fail (FS_IS_RTP_CONGESTION_CONTROL (self), FALSE);
+
+  klass = FS_RTP_CONGESTION_CONTROL_GET_CLASS (self);
+  if (!klass->get_path)
+    return FALSE;
+
+  return klass->get_path (self, rtt, loss);
+}
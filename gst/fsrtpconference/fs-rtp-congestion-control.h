@@ -0,0 +1,111 @@
+/*
+ * Farstream - Farstream RTP Congestion Control
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-congestion-control.h - Base class for the rate controllers of
+ *  Farstream RTP sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef __FS_RTP_CONGESTION_CONTROL_H__
+#define __FS_RTP_CONGESTION_CONTROL_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_RTP_CONGESTION_CONTROL \
+  (fs_rtp_congestion_control_get_type ())
+#define FS_RTP_CONGESTION_CONTROL(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_RTP_CONGESTION_CONTROL, \
+      FsRtpCongestionControl))
+#define FS_RTP_CONGESTION_CONTROL_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_RTP_CONGESTION_CONTROL, \
+      FsRtpCongestionControlClass))
+#define FS_IS_RTP_CONGESTION_CONTROL(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_RTP_CONGESTION_CONTROL))
+#define FS_IS_RTP_CONGESTION_CONTROL_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_RTP_CONGESTION_CONTROL))
+#define FS_RTP_CONGESTION_CONTROL_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), FS_TYPE_RTP_CONGESTION_CONTROL, \
+      FsRtpCongestionControlClass))
+#define FS_RTP_CONGESTION_CONTROL_CAST(obj) ((FsRtpCongestionControl *) (obj))
+
+typedef struct _FsRtpCongestionControl FsRtpCongestionControl;
+typedef struct _FsRtpCongestionControlClass FsRtpCongestionControlClass;
+
+/**
+ * FsRtpCongestionControl:
+ *
+ * The base of the objects that decide at which bitrate a session sends.
+ * The subclasses implement the "bitrate" (readable, in bits/sec, notified
+ * when it changes) and "sending" (writable) properties.
+ */
+struct _FsRtpCongestionControl
+{
+  GstObject parent;
+};
+
+/**
+ * FsRtpCongestionControlClass:
+ * @destroy: disconnects from the session, called before the last unref
+ * @codecs_updated: called with the session lock held after each
+ *  negotiation, with the negotiated #CodecAssociation and
+ *  #FsRtpHeaderExtension lists
+ * @is_enabled: returns whether the controller was negotiated for the
+ *  payload type
+ * @warm_start: optional, makes the controller start from this bitrate
+ *  instead of its default, if it has not started yet
+ * @get_path: optional, gets the RTT (in microseconds) and loss rate the
+ *  controller measured, returns %FALSE if it has not measured them yet
+ */
+struct _FsRtpCongestionControlClass
+{
+  GstObjectClass parent_class;
+
+  void (*destroy) (FsRtpCongestionControl *self);
+  void (*codecs_updated) (FsRtpCongestionControl *self,
+      GList *codec_associations, GList *header_extensions);
+  gboolean (*is_enabled) (FsRtpCongestionControl *self, guint pt);
+  void (*warm_start) (FsRtpCongestionControl *self, guint bitrate);
+  gboolean (*get_path) (FsRtpCongestionControl *self, guint *rtt,
+      gdouble *loss);
+};
+
+GType fs_rtp_congestion_control_get_type (void);
+
+void fs_rtp_congestion_control_destroy (FsRtpCongestionControl *self);
+
+void fs_rtp_congestion_control_codecs_updated (FsRtpCongestionControl *self,
+    GList *codec_associations,
+    GList *header_extensions);
+
+gboolean fs_rtp_congestion_control_is_enabled (FsRtpCongestionControl *self,
+    guint pt);
+
+void fs_rtp_congestion_control_warm_start (FsRtpCongestionControl *self,
+    guint bitrate);
+
+gboolean fs_rtp_congestion_control_get_path (FsRtpCongestionControl *self,
+    guint *rtt,
+    gdouble *loss);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_CONGESTION_CONTROL_H__ */
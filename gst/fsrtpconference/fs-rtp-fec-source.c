@@ -0,0 +1,220 @@
+/*
+ * Farstream - Farstream RTP FEC Source
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-fec-source.c - The special source class that negotiates the
+ *  forward error correction codecs
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-fec-source.h"
+
+#include <farstream/fs-conference.h>
+
+#include "fs-rtp-conference.h"
+#include "fs-rtp-discover-codecs.h"
+#include "fs-rtp-codec-negotiation.h"
+#include "fs-rtp-fec.h"
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+
+/*
+ * SECTION:fs-rtp-fec-source
+ * @short_description: Class to negotiate the FEC codecs
+ *
+ * The ULPFEC packets (RFC 5109) are carried in RED (RFC 2198) along with the
+ * media packets, so both the "red" and the "ulpfec" codecs have to be
+ * negotiated for the media to be protected.
+ *
+ * Unlike telephone-event, the FEC packets are not produced by a separate
+ * source but from the media packets by the encoder that rtpbin asks for, so
+ * this class never builds anything and only adds the blueprints and filters
+ * the negotiated codecs. The rest is done by #FsRtpFec.
+ *
+ * The blueprints have no clock rate, so like the other incomplete
+ * blueprints they are only offered if the codec preferences have them with
+ * one, for example "red" and "ulpfec" at 90000 Hz.
+ */
+
+
+G_DEFINE_TYPE (FsRtpFecSource, fs_rtp_fec_source,
+    FS_TYPE_RTP_SPECIAL_SOURCE);
+
+
+static GList *fs_rtp_fec_source_class_add_blueprint (
+    FsRtpSpecialSourceClass *klass,
+    GList *blueprints);
+static GList *fs_rtp_fec_source_negotiation_filter (
+    FsRtpSpecialSourceClass *klass,
+    GList *codec_associations);
+
+static void
+fs_rtp_fec_source_class_init (FsRtpFecSourceClass *klass)
+{
+  FsRtpSpecialSourceClass *spsource_class = FS_RTP_SPECIAL_SOURCE_CLASS (klass);
+
+  spsource_class->add_blueprint = fs_rtp_fec_source_class_add_blueprint;
+  spsource_class->negotiation_filter = fs_rtp_fec_source_negotiation_filter;
+}
+
+static void
+fs_rtp_fec_source_init (FsRtpFecSource *self)
+{
+}
+
+static gboolean
+has_factory (const gchar *factory_name)
+{
+  GstElementFactory *fact = gst_element_factory_find (factory_name);
+
+  if (!fact)
+  {
+    GST_CAT_WARNING (fsrtpconference_disco,
+        "Could not find %s, will not offer FEC", factory_name);
+    return FALSE;
+  }
+
+  gst_object_unref (fact);
+  return TRUE;
+}
+
+static CodecBlueprint *
+new_fec_blueprint (const gchar *encoding_name)
+{
+  CodecBlueprint *bp = g_slice_new0 (CodecBlueprint);
+
+  /* Without a clock rate, it takes a preference to use it */
+  bp->codec = fs_codec_new (FS_CODEC_ID_ANY, encoding_name,
+      FS_MEDIA_TYPE_VIDEO, 0);
+  bp->rtp_caps = fs_codec_to_gst_caps (bp->codec);
+  bp->media_caps = gst_caps_new_any ();
+
+  return bp;
+}
+
+/**
+ * fs_rtp_fec_source_class_add_blueprint:
+ *
+ * Add the red and ulpfec blueprints if there is a video codec to protect,
+ * they are only used if the codec preferences ask for them
+ */
+
+static GList*
+fs_rtp_fec_source_class_add_blueprint (FsRtpSpecialSourceClass *klass,
+    GList *blueprints)
+{
+  GList *item;
+  gboolean has_video = FALSE;
+
+  if (!has_factory ("rtpulpfecenc") || !has_factory ("rtpulpfecdec") ||
+      !has_factory ("rtpredenc") || !has_factory ("rtpreddec"))
+    return blueprints;
+
+  for (item = g_list_first (blueprints);
+       item;
+       item = g_list_next (item))
+  {
+    CodecBlueprint *bp = item->data;
+
+    if (bp->codec->media_type != FS_MEDIA_TYPE_VIDEO)
+      continue;
+
+    /* Already there */
+    if (fs_rtp_codec_is_fec (bp->codec))
+      return blueprints;
+
+    has_video = TRUE;
+  }
+
+  if (!has_video)
+    return blueprints;
+
+  blueprints = g_list_append (blueprints, new_fec_blueprint ("red"));
+  blueprints = g_list_append (blueprints, new_fec_blueprint ("ulpfec"));
+
+  return blueprints;
+}
+
+static gboolean
+_is_protected_codec (CodecAssociation *ca, gpointer user_data)
+{
+  if (!ca->recv_only &&
+      ca->codec->media_type == FS_MEDIA_TYPE_VIDEO &&
+      !fs_rtp_codec_is_fec (ca->codec) &&
+      g_ascii_strcasecmp (ca->codec->encoding_name, "rtx"))
+    return TRUE;
+  else
+    return FALSE;
+}
+
+static gboolean
+_is_fec_codec (CodecAssociation *ca, gpointer user_data)
+{
+  const gchar *encoding_name = user_data;
+
+  if (!ca->recv_only &&
+      !g_ascii_strcasecmp (ca->codec->encoding_name, encoding_name))
+    return TRUE;
+  else
+    return FALSE;
+}
+
+/*
+ * Only one red and one ulpfec codec are kept, and only if they were both
+ * negotiated along with a video codec they can protect.
+ */
+
+static GList *
+fs_rtp_fec_source_negotiation_filter (FsRtpSpecialSourceClass *klass,
+      GList *codec_associations)
+{
+  CodecAssociation *red_ca;
+  CodecAssociation *ulpfec_ca;
+  gboolean usable;
+  GList *tmp;
+
+  red_ca = lookup_codec_association_custom (codec_associations,
+      _is_fec_codec, "red");
+  ulpfec_ca = lookup_codec_association_custom (codec_associations,
+      _is_fec_codec, "ulpfec");
+  usable = red_ca && ulpfec_ca &&
+      lookup_codec_association_custom (codec_associations,
+          _is_protected_codec, NULL);
+
+  for (tmp = codec_associations; tmp; tmp = g_list_next (tmp))
+  {
+    CodecAssociation *ca = tmp->data;
+
+    if (ca->disable || ca->reserved || ca->recv_only ||
+        !fs_rtp_codec_is_fec (ca->codec))
+      continue;
+
+    if (!usable || (ca != red_ca && ca != ulpfec_ca))
+    {
+      GST_DEBUG ("Disabling FEC codec " FS_CODEC_FORMAT,
+          FS_CODEC_ARGS (ca->codec));
+      ca->disable = TRUE;
+    }
+  }
+
+  return codec_associations;
+}
@@ -0,0 +1,664 @@
+/*
+ * Farstream - Farstream RTP Forward Error Correction
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-fec.c - Protects the media with ULPFEC packets carried in RED and
+ *  recovers the lost packets from them
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-fec.h"
+
+#include <math.h>
+
+#include "fs-rtp-codec-negotiation.h"
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+GST_DEBUG_CATEGORY_EXTERN (fsrtpconference_debug);
+
+/*
+ * When the "red" and "ulpfec" codecs are negotiated (see FsRtpFecSource),
+ * the FEC encoder that rtpbin puts in front of the session adds ULPFEC
+ * packets to the media and wraps everything in RED. Those share the
+ * sequence numbers of the media, so the receiver notices when one is lost.
+ *
+ * On the receiving side, the RED packets are unwrapped by the auxiliary
+ * receiver before rtpbin stores them. When the jitterbuffer gives up on a
+ * packet, it sends a lost event to the FEC decoder placed after it, which
+ * rebuilds the packet from the stored ones if it can, just in time to be
+ * depayloaded.
+ *
+ * The more packets are lost, the more FEC packets are sent, in proportion
+ * of the loss rate measured by the congestion control. That overhead comes
+ * out of the bitrate given to the encoder.
+ */
+
+/* Below this loss rate, the media is not protected */
+#define MIN_LOSS_RATE (0.005)
+/* Percent of FEC packets per percent of loss */
+#define PERCENTAGE_PER_LOSS (2)
+#define MIN_PERCENTAGE (5)
+#define MAX_PERCENTAGE (50)
+
+struct _FsRtpFecClass
+{
+  GstObjectClass parent_class;
+};
+
+struct _FsRtpFec
+{
+  GstObject parent;
+
+  guint session_id;
+
+  /* All NULL if the elements are not installed */
+  GstElement *encoder;
+  GstElement *fecenc;
+  GstElement *redenc;
+  GstElement *reddec;
+
+  GstElement *rtpbin;
+  gulong request_decoder_id;
+  gulong new_storage_id;
+  gulong new_jitterbuffer_id;
+
+  /* Everything below is protected by the object lock */
+
+  /* Weak references to the decoders of the session */
+  GList *decoders;
+
+  gint recv_ulpfec_pt;
+
+  gboolean sending;
+  gboolean receiving;
+
+  gdouble loss;
+  guint percentage;
+};
+
+
+G_DEFINE_TYPE (FsRtpFec, fs_rtp_fec, GST_TYPE_OBJECT);
+
+static void fs_rtp_fec_dispose (GObject *obj);
+
+static void
+fs_rtp_fec_class_init (FsRtpFecClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->dispose = fs_rtp_fec_dispose;
+}
+
+static void
+fs_rtp_fec_init (FsRtpFec *self)
+{
+  self->recv_ulpfec_pt = -1;
+}
+
+static void
+decoder_gone (gpointer user_data, GObject *where_the_object_was)
+{
+  FsRtpFec *self = FS_RTP_FEC (user_data);
+
+  GST_OBJECT_LOCK (self);
+  self->decoders = g_list_remove (self->decoders, where_the_object_was);
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+fs_rtp_fec_dispose (GObject *obj)
+{
+  FsRtpFec *self = FS_RTP_FEC (obj);
+  GList *item;
+
+  GST_OBJECT_LOCK (self);
+  for (item = self->decoders; item; item = item->next)
+    g_object_weak_unref (item->data, decoder_gone, self);
+  g_list_free (self->decoders);
+  self->decoders = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  if (self->request_decoder_id)
+    g_signal_handler_disconnect (self->rtpbin, self->request_decoder_id);
+  self->request_decoder_id = 0;
+  if (self->new_storage_id)
+    g_signal_handler_disconnect (self->rtpbin, self->new_storage_id);
+  self->new_storage_id = 0;
+  if (self->new_jitterbuffer_id)
+    g_signal_handler_disconnect (self->rtpbin, self->new_jitterbuffer_id);
+  self->new_jitterbuffer_id = 0;
+
+  g_clear_object (&self->rtpbin);
+  g_clear_object (&self->fecenc);
+  g_clear_object (&self->redenc);
+  g_clear_object (&self->reddec);
+  g_clear_object (&self->encoder);
+
+  G_OBJECT_CLASS (fs_rtp_fec_parent_class)->dispose (obj);
+}
+
+static gboolean
+has_decoders (void)
+{
+  GstElementFactory *fact;
+
+  fact = gst_element_factory_find ("rtpulpfecdec");
+  if (!fact)
+    return FALSE;
+  gst_object_unref (fact);
+
+  fact = gst_element_factory_find ("rtpreddec");
+  if (!fact)
+    return FALSE;
+  gst_object_unref (fact);
+
+  return TRUE;
+}
+
+/*
+ * The FEC packets are computed on the media packets, then both are wrapped
+ * in RED. Until the codecs are negotiated, it lets the media through.
+ */
+
+static GstElement *
+make_encoder (guint session_id, GstElement **fecenc, GstElement **redenc)
+{
+  GstElement *bin;
+  GstPad *pad;
+  gchar *name;
+
+  *fecenc = gst_element_factory_make ("rtpulpfecenc", NULL);
+  *redenc = gst_element_factory_make ("rtpredenc", NULL);
+  if (!*fecenc || !*redenc || !has_decoders ())
+  {
+    GST_WARNING ("Could not make the FEC elements, FEC is disabled");
+    if (*fecenc)
+      gst_object_unref (*fecenc);
+    if (*redenc)
+      gst_object_unref (*redenc);
+    *fecenc = NULL;
+    *redenc = NULL;
+    return NULL;
+  }
+
+  g_object_set (*fecenc,
+      "percentage", 0,
+      "multipacket", TRUE,
+      NULL);
+  g_object_set (*redenc,
+      "distance", 0,
+      "allow-no-red-blocks", FALSE,
+      NULL);
+
+  name = g_strdup_printf ("fec_encoder_%u", session_id);
+  bin = gst_bin_new (name);
+  g_free (name);
+  gst_object_ref_sink (bin);
+
+  gst_bin_add_many (GST_BIN (bin), gst_object_ref (*fecenc),
+      gst_object_ref (*redenc), NULL);
+  gst_element_link_pads (*fecenc, "src", *redenc, "sink");
+
+  pad = gst_element_get_static_pad (*fecenc, "sink");
+  gst_element_add_pad (bin, gst_ghost_pad_new ("sink", pad));
+  gst_object_unref (pad);
+
+  pad = gst_element_get_static_pad (*redenc, "src");
+  gst_element_add_pad (bin, gst_ghost_pad_new ("src", pad));
+  gst_object_unref (pad);
+
+  return bin;
+}
+
+FsRtpFec *
+fs_rtp_fec_new (guint session_id)
+{
+  FsRtpFec *self = g_object_new (FS_TYPE_RTP_FEC, NULL);
+
+  self->session_id = session_id;
+  self->encoder = make_encoder (session_id, &self->fecenc, &self->redenc);
+
+  return self;
+}
+
+/**
+ * fs_rtp_fec_is_available:
+ * @self: a #FsRtpFec
+ *
+ * Returns: %TRUE if the FEC elements are installed
+ */
+
+gboolean
+fs_rtp_fec_is_available (FsRtpFec *self)
+{
+  return self->encoder != NULL;
+}
+
+/**
+ * fs_rtp_fec_get_encoder:
+ * @self: a #FsRtpFec
+ *
+ * Returns: (transfer full): the element to return from the
+ *  "request-fec-encoder" signal of rtpbin, or %NULL
+ */
+
+GstElement *
+fs_rtp_fec_get_encoder (FsRtpFec *self)
+{
+  return self->encoder ? gst_object_ref (self->encoder) : NULL;
+}
+
+/**
+ * fs_rtp_fec_get_decoder:
+ * @self: a #FsRtpFec
+ * @storage: the storage of the received packets, where the FEC packets are
+ *  looked up
+ *
+ * Returns: (transfer full): the element to return from the
+ *  "request-fec-decoder" signal of rtpbin, or %NULL
+ */
+
+GstElement *
+fs_rtp_fec_get_decoder (FsRtpFec *self, GObject *storage)
+{
+  GstElement *decoder;
+  gint pt;
+
+  if (!self->encoder || !storage)
+    return NULL;
+
+  decoder = gst_element_factory_make ("rtpulpfecdec", NULL);
+  if (!decoder)
+    return NULL;
+
+  g_object_set (decoder, "storage", storage, NULL);
+
+  GST_OBJECT_LOCK (self);
+  g_object_weak_ref (G_OBJECT (decoder), decoder_gone, self);
+  self->decoders = g_list_prepend (self->decoders, decoder);
+  pt = self->recv_ulpfec_pt;
+  GST_OBJECT_UNLOCK (self);
+
+  if (pt >= 0)
+    g_object_set (decoder, "pt", pt, NULL);
+
+  return decoder;
+}
+
+/**
+ * fs_rtp_fec_get_aux_receiver:
+ * @self: a #FsRtpFec
+ * @next: (transfer full) (allow-none): another auxiliary receiver to put
+ *  after the RED decoder
+ *
+ * rtpbin only takes one auxiliary receiver per session, the RED packets are
+ * unwrapped before the other one gets them.
+ *
+ * Returns: (transfer full): the element to return from the
+ *  "request-aux-receiver" signal of rtpbin, or %NULL
+ */
+
+GstElement *
+fs_rtp_fec_get_aux_receiver (FsRtpFec *self, GstElement *next)
+{
+  GstElement *bin;
+  GstPad *pad;
+  gchar *name;
+
+  if (!self->encoder || self->reddec)
+    return next;
+
+  self->reddec = gst_element_factory_make ("rtpreddec", NULL);
+  if (!self->reddec)
+    return next;
+
+  name = g_strdup_printf ("fec_receive_%u", self->session_id);
+  bin = gst_bin_new (name);
+  g_free (name);
+
+  gst_bin_add (GST_BIN (bin), gst_object_ref (self->reddec));
+
+  pad = gst_element_get_static_pad (self->reddec, "sink");
+  name = g_strdup_printf ("sink_%u", self->session_id);
+  gst_element_add_pad (bin, gst_ghost_pad_new (name, pad));
+  g_free (name);
+  gst_object_unref (pad);
+
+  name = g_strdup_printf ("src_%u", self->session_id);
+  if (next)
+  {
+    gchar *sink_name = g_strdup_printf ("sink_%u", self->session_id);
+
+    gst_bin_add (GST_BIN (bin), next);
+    gst_element_link_pads (self->reddec, "src", next, sink_name);
+    g_free (sink_name);
+    pad = gst_element_get_static_pad (next, name);
+    gst_object_unref (next);
+  }
+  else
+  {
+    pad = gst_element_get_static_pad (self->reddec, "src");
+  }
+  gst_element_add_pad (bin, gst_ghost_pad_new (name, pad));
+  g_free (name);
+  gst_object_unref (pad);
+
+  return bin;
+}
+
+static GstElement *
+rtpbin_request_fec_decoder (GstElement *rtpbin, guint session_id,
+    gpointer user_data)
+{
+  FsRtpFec *self = FS_RTP_FEC (user_data);
+  GObject *storage = NULL;
+  GstElement *decoder;
+
+  if (session_id != self->session_id)
+    return NULL;
+
+  g_signal_emit_by_name (rtpbin, "get-internal-storage", session_id,
+      &storage);
+  decoder = fs_rtp_fec_get_decoder (self, storage);
+  if (storage)
+    g_object_unref (storage);
+
+  return decoder;
+}
+
+/*
+ * The packets have to be kept for as long as the jitterbuffer may wait
+ * for a lost one
+ */
+
+static void
+rtpbin_new_storage (GstElement *rtpbin, GstElement *storage,
+    guint session_id, gpointer user_data)
+{
+  FsRtpFec *self = FS_RTP_FEC (user_data);
+  guint latency = 0;
+
+  if (session_id != self->session_id)
+    return;
+
+  g_object_get (rtpbin, "latency", &latency, NULL);
+  g_object_set (storage, "size-time", (guint64) latency * GST_MSECOND, NULL);
+}
+
+static void
+rtpbin_new_jitterbuffer (GstElement *rtpbin, GstElement *jitterbuffer,
+    guint session_id, guint ssrc, gpointer user_data)
+{
+  FsRtpFec *self = FS_RTP_FEC (user_data);
+
+  if (session_id != self->session_id)
+    return;
+
+  /* The FEC decoder only tries to recover the packets it is told about */
+  g_object_set (jitterbuffer, "do-lost", TRUE, NULL);
+}
+
+/**
+ * fs_rtp_fec_attach:
+ * @self: a #FsRtpFec
+ * @rtpbin: the rtpbin of the conference
+ *
+ * Must be called before the pads of the session are requested from rtpbin
+ */
+
+void
+fs_rtp_fec_attach (FsRtpFec *self, GstElement *rtpbin)
+{
+  if (!self->encoder)
+    return;
+
+  if (!g_signal_lookup ("request-fec-decoder", G_OBJECT_TYPE (rtpbin)) ||
+      !g_signal_lookup ("new-storage", G_OBJECT_TYPE (rtpbin)))
+  {
+    GST_WARNING ("rtpbin is too old for FEC");
+    return;
+  }
+
+  self->rtpbin = gst_object_ref (rtpbin);
+
+  self->request_decoder_id = g_signal_connect_object (rtpbin,
+      "request-fec-decoder", G_CALLBACK (rtpbin_request_fec_decoder), self, 0);
+  self->new_storage_id = g_signal_connect_object (rtpbin,
+      "new-storage", G_CALLBACK (rtpbin_new_storage), self, 0);
+  self->new_jitterbuffer_id = g_signal_connect_object (rtpbin,
+      "new-jitterbuffer", G_CALLBACK (rtpbin_new_jitterbuffer), self, 0);
+}
+
+/**
+ * fs_rtp_codec_is_fec:
+ * @codec: a #FsCodec
+ *
+ * Returns: %TRUE if @codec is one of the codecs used by the FEC
+ */
+
+gboolean
+fs_rtp_codec_is_fec (FsCodec *codec)
+{
+  return codec->encoding_name &&
+      (!g_ascii_strcasecmp (codec->encoding_name, "red") ||
+          !g_ascii_strcasecmp (codec->encoding_name, "ulpfec"));
+}
+
+/**
+ * fs_rtp_fec_get_percentage:
+ * @loss: the loss rate
+ *
+ * Returns: how many FEC packets to send, in percent of the media packets
+ */
+
+guint
+fs_rtp_fec_get_percentage (gdouble loss)
+{
+  if (loss < MIN_LOSS_RATE)
+    return 0;
+
+  return CLAMP ((guint) ceil (loss * 100 * PERCENTAGE_PER_LOSS),
+      MIN_PERCENTAGE, MAX_PERCENTAGE);
+}
+
+static void
+fs_rtp_fec_set_percentage (FsRtpFec *self, gboolean sending, guint percentage)
+{
+  if (!sending)
+    percentage = 0;
+
+  /* Losing a key frame is worse */
+  g_object_set (self->fecenc,
+      "percentage", percentage,
+      "percentage-important", MIN (2 * percentage, 100),
+      NULL);
+}
+
+void
+fs_rtp_fec_codecs_updated (FsRtpFec *self, GList *codec_associations)
+{
+  gint red_pt = -1, ulpfec_pt = -1;
+  gint recv_red_pt = -1, recv_ulpfec_pt = -1;
+  GList *item;
+  GList *decoders = NULL;
+  gboolean sending, receiving;
+  guint percentage;
+
+  if (!self->encoder)
+    return;
+
+  for (item = codec_associations; item; item = item->next)
+  {
+    CodecAssociation *ca = item->data;
+    gboolean red;
+
+    if (ca->disable || ca->reserved || !fs_rtp_codec_is_fec (ca->codec))
+      continue;
+
+    red = !g_ascii_strcasecmp (ca->codec->encoding_name, "red");
+
+    if (!ca->recv_only)
+    {
+      if (red && red_pt < 0)
+        red_pt = ca->codec->id;
+      else if (!red && ulpfec_pt < 0)
+        ulpfec_pt = ca->codec->id;
+    }
+    if (red && (recv_red_pt < 0 || !ca->recv_only))
+      recv_red_pt = ca->codec->id;
+    else if (!red && (recv_ulpfec_pt < 0 || !ca->recv_only))
+      recv_ulpfec_pt = ca->codec->id;
+  }
+
+  sending = red_pt >= 0 && ulpfec_pt >= 0;
+  receiving = recv_red_pt >= 0 && recv_ulpfec_pt >= 0;
+
+  GST_DEBUG ("FEC send red: %d ulpfec: %d, receive red: %d ulpfec: %d",
+      red_pt, ulpfec_pt, recv_red_pt, recv_ulpfec_pt);
+
+  if (sending)
+  {
+    g_object_set (self->fecenc, "pt", ulpfec_pt, NULL);
+    g_object_set (self->redenc, "pt", red_pt, NULL);
+  }
+  g_object_set (self->redenc, "allow-no-red-blocks", sending, NULL);
+
+  if (self->reddec && receiving)
+    g_object_set (self->reddec, "pt", recv_red_pt, NULL);
+
+  GST_OBJECT_LOCK (self);
+  self->sending = sending;
+  self->receiving = receiving;
+  self->recv_ulpfec_pt = recv_ulpfec_pt;
+  percentage = self->percentage;
+  for (item = self->decoders; item; item = item->next)
+    decoders = g_list_prepend (decoders, gst_object_ref (item->data));
+  GST_OBJECT_UNLOCK (self);
+
+  fs_rtp_fec_set_percentage (self, sending, percentage);
+
+  if (receiving)
+    for (item = decoders; item; item = item->next)
+      g_object_set (item->data, "pt", recv_ulpfec_pt, NULL);
+  g_list_free_full (decoders, gst_object_unref);
+}
+
+/**
+ * fs_rtp_fec_set_loss_rate:
+ * @self: a #FsRtpFec
+ * @loss: the loss rate measured by the congestion control
+ *
+ * Adapts the protection of the media to the loss rate
+ */
+
+void
+fs_rtp_fec_set_loss_rate (FsRtpFec *self, gdouble loss)
+{
+  guint percentage = fs_rtp_fec_get_percentage (loss);
+  gboolean changed;
+  gboolean sending;
+
+  GST_OBJECT_LOCK (self);
+  self->loss = loss;
+  changed = self->percentage != percentage;
+  self->percentage = percentage;
+  sending = self->sending;
+  GST_OBJECT_UNLOCK (self);
+
+  if (changed && self->fecenc)
+  {
+    GST_LOG ("Loss rate is %f, sending %u%% of FEC packets", loss,
+        percentage);
+    fs_rtp_fec_set_percentage (self, sending, percentage);
+  }
+}
+
+/**
+ * fs_rtp_fec_get_media_bitrate:
+ * @self: a #FsRtpFec
+ * @bitrate: the bitrate of the whole stream, in bits/sec
+ *
+ * Returns: what is left of @bitrate for the media once the FEC packets
+ *  are sent
+ */
+
+guint
+fs_rtp_fec_get_media_bitrate (FsRtpFec *self, guint bitrate)
+{
+  guint percentage = 0;
+
+  GST_OBJECT_LOCK (self);
+  if (self->sending)
+    percentage = self->percentage;
+  GST_OBJECT_UNLOCK (self);
+
+  return (guint64) bitrate * 100 / (100 + percentage);
+}
+
+/**
+ * fs_rtp_fec_get_stats:
+ * @self: a #FsRtpFec
+ *
+ * Returns: (transfer full): a #GstStructure with the protection that is
+ *  sent and the number of packets that were recovered or not
+ */
+
+GstStructure *
+fs_rtp_fec_get_stats (FsRtpFec *self)
+{
+  guint protected = 0, recovered = 0, unrecovered = 0;
+  GList *decoders = NULL;
+  GList *item;
+  GstStructure *s;
+
+  if (self->fecenc)
+    g_object_get (self->fecenc, "protected", &protected, NULL);
+
+  GST_OBJECT_LOCK (self);
+  for (item = self->decoders; item; item = item->next)
+    decoders = g_list_prepend (decoders, gst_object_ref (item->data));
+  GST_OBJECT_UNLOCK (self);
+
+  for (item = decoders; item; item = item->next)
+  {
+    guint r = 0, u = 0;
+
+    g_object_get (item->data, "recovered", &r, "unrecovered", &u, NULL);
+    recovered += r;
+    unrecovered += u;
+  }
+  g_list_free_full (decoders, gst_object_unref);
+
+  GST_OBJECT_LOCK (self);
+  s = gst_structure_new ("application/x-fs-rtp-fec-stats",
+      "available", G_TYPE_BOOLEAN, self->encoder != NULL,
+      "sending", G_TYPE_BOOLEAN, self->sending,
+      "receiving", G_TYPE_BOOLEAN, self->receiving,
+      "loss-rate", G_TYPE_DOUBLE, self->loss,
+      "percentage", G_TYPE_UINT, self->sending ? self->percentage : 0,
+      "protected-packets", G_TYPE_UINT, protected,
+      "recovered-packets", G_TYPE_UINT, recovered,
+      "unrecovered-packets", G_TYPE_UINT, unrecovered,
+      NULL);
+  GST_OBJECT_UNLOCK (self);
+
+  return s;
+}
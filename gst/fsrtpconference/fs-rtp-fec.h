@@ -0,0 +1,77 @@
+/*
+ * Farstream - Farstream RTP Forward Error Correction
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-fec.h - Protects the media with ULPFEC packets carried in RED and
+ *  recovers the lost packets from them
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_FEC_H__
+#define __FS_RTP_FEC_H__
+
+#include <gst/gst.h>
+
+#include <farstream/fs-codec.h>
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_RTP_FEC \
+  (fs_rtp_fec_get_type ())
+#define FS_RTP_FEC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_RTP_FEC, FsRtpFec))
+#define FS_RTP_FEC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_RTP_FEC, FsRtpFecClass))
+#define FS_IS_RTP_FEC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_RTP_FEC))
+#define FS_IS_RTP_FEC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_RTP_FEC))
+#define FS_RTP_FEC_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), FS_TYPE_RTP_FEC, FsRtpFecClass))
+#define FS_RTP_FEC_CAST(obj) ((FsRtpFec *) (obj))
+
+typedef struct _FsRtpFec FsRtpFec;
+typedef struct _FsRtpFecClass FsRtpFecClass;
+
+GType fs_rtp_fec_get_type (void);
+
+FsRtpFec *fs_rtp_fec_new (guint session_id);
+
+gboolean fs_rtp_fec_is_available (FsRtpFec *self);
+
+void fs_rtp_fec_attach (FsRtpFec *self, GstElement *rtpbin);
+
+GstElement *fs_rtp_fec_get_encoder (FsRtpFec *self);
+GstElement *fs_rtp_fec_get_decoder (FsRtpFec *self, GObject *storage);
+GstElement *fs_rtp_fec_get_aux_receiver (FsRtpFec *self, GstElement *next);
+
+void fs_rtp_fec_codecs_updated (FsRtpFec *self, GList *codec_associations);
+
+void fs_rtp_fec_set_loss_rate (FsRtpFec *self, gdouble loss);
+
+guint fs_rtp_fec_get_media_bitrate (FsRtpFec *self, guint bitrate);
+
+GstStructure *fs_rtp_fec_get_stats (FsRtpFec *self);
+
+guint fs_rtp_fec_get_percentage (gdouble loss);
+
+gboolean fs_rtp_codec_is_fec (FsCodec *codec);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_FEC_H__ */
@@ -0,0 +1,1212 @@
+/*
+ * Farstream - Farstream RTP Forwarder
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-forwarder.c - Relays the RTP packets received by a session to the
+ *  other forwarding sessions without decoding them
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "fs-rtp-forwarder.h"
+
+#include <string.h>
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+GST_DEBUG_CATEGORY_EXTERN (fsrtpconference_debug);
+
+/*
+ * This is a selective forwarding unit: each source the rtpbin demuxes from
+ * a forwarding session is sent as-is to every other forwarding session of
+ * the same media type, instead of being depayloaded and decoded by a
+ * substream. Since all the streams of a session share its transmitters,
+ * each participant has to be in a session of its own.
+ *
+ * Only the fixed RTP header is rewritten: the payload type becomes the one
+ * the destination negotiated for the same codec (the format parameters are
+ * not compared, the participants are expected to offer the same ones) and
+ * each source gets a SSRC of its own in each destination. The sequence
+ * numbers and timestamps are kept. A packet whose codec the destination
+ * did not negotiate is dropped.
+ *
+ * The packets go through the rtpbin of the destination, which terminates
+ * RTCP for them: it sends the sender reports and handles the receiver
+ * reports, and retransmits from its own history when asked. The key frame
+ * requests it gets are translated back into requests to the origin, and
+ * one is made when a video source starts being forwarded somewhere new.
+ *
+ * When a VP8 or H.264 SVC source is sent with temporal layers, the rate of
+ * each layer is measured, and each destination only gets the layers that
+ * fit in its share of what its congestion control allows, the whole
+ * frames of the higher layers are dropped and the following sequence
+ * numbers are moved down to close the gap. Layers are removed at any
+ * frame but only added back at a frame of the base layer, which the
+ * frames of the upper layers that follow only depend on.
+ */
+
+/* VP8 has 4, H.264 SVC has 8 */
+#define MAX_TEMPORAL_LAYERS (8)
+
+/* In RTP time, as a fraction of a second */
+#define LAYER_RATE_WINDOW_DIV (2)
+
+struct _FsRtpForwarder {
+  volatile gint refcount;
+
+  GMutex mutex;
+
+  /* Protected by the mutex */
+  /* of Session */
+  GList *sessions;
+  /* of Source */
+  GList *sources;
+  /* Bumped when the codecs of any session change */
+  guint codecs_generation;
+};
+
+typedef struct {
+  GObject *session;
+  FsMediaType media_type;
+  FsRtpForwarderRequestPadFunc request_pad;
+  FsRtpForwarderReleasePadFunc release_pad;
+
+  /* of FsCodec */
+  GList *codecs;
+
+  /* SSRC received -> SSRC it is forwarded with in this session, the SSRCs
+   * are assumed to be unique in the whole conference */
+  GHashTable *ssrcs;
+
+  /* What its congestion control allows in bits/sec, 0 if unknown */
+  guint bitrate;
+  /* The number of sources forwarded to it, which share the bitrate */
+  guint n_outputs;
+} Session;
+
+typedef enum {
+  LAYERING_NONE,
+  LAYERING_VP8,
+  LAYERING_H264
+} Layering;
+
+typedef struct {
+  FsRtpForwarder *forwarder;
+  Session *session;
+  guint32 ssrc;
+  guint pt;
+
+  GstPad *rtpbin_pad;
+  GstPad *sinkpad;
+
+  /* Protected by the mutex of the forwarder */
+  gboolean removed;
+  GstEvent *segment;
+  /* of Output */
+  GList *outputs;
+
+  Layering layering;
+  guint clock_rate;
+  guint codecs_generation;
+
+  /* The frame being received and its temporal layer */
+  gboolean have_frame;
+  guint32 frame_ts;
+  guint frame_layer;
+
+  /* Bytes of each layer since the start of the window, in bits/sec */
+  gboolean have_window;
+  guint32 window_ts;
+  guint64 layer_bytes[MAX_TEMPORAL_LAYERS];
+  guint layer_rates[MAX_TEMPORAL_LAYERS];
+} Source;
+
+typedef struct {
+  /* Only valid while it is in the outputs of its source */
+  Session *session;
+
+  GObject *dest;
+  FsRtpForwarderReleasePadFunc release_pad;
+
+  GstPad *srcpad;
+  GstPad *peer;
+
+  guint32 ssrc;
+  /* In the destination, -1 if it did not negotiate the codec */
+  gint pt;
+  guint codecs_generation;
+
+  GstCaps *caps;
+  gboolean started;
+  gboolean caps_pending;
+  gboolean segment_pending;
+
+  /* The highest temporal layer sent */
+  guint max_layer;
+  gboolean drop_frame;
+  /* Subtracted from the sequence numbers */
+  guint16 dropped;
+} Output;
+
+typedef struct {
+  GstPad *srcpad;
+  guint8 pt;
+  guint32 ssrc;
+  guint16 seqnum;
+  /* of GstEvent, to push before the packet */
+  GList *events;
+} Push;
+
+#define FS_RTP_FORWARDER_LOCK(f) g_mutex_lock (&(f)->mutex)
+#define FS_RTP_FORWARDER_UNLOCK(f) g_mutex_unlock (&(f)->mutex)
+
+FsRtpForwarder *
+fs_rtp_forwarder_new (void)
+{
+  FsRtpForwarder *self = g_slice_new0 (FsRtpForwarder);
+
+  self->refcount = 1;
+  self->codecs_generation = 1;
+  g_mutex_init (&self->mutex);
+
+  return self;
+}
+
+FsRtpForwarder *
+fs_rtp_forwarder_ref (FsRtpForwarder *forwarder)
+{
+  g_atomic_int_inc (&forwarder->refcount);
+
+  return forwarder;
+}
+
+void
+fs_rtp_forwarder_unref (FsRtpForwarder *forwarder)
+{
+  if (!g_atomic_int_dec_and_test (&forwarder->refcount))
+    return;
+
+  /* The sources hold a ref, there can only be sessions left */
+  if (forwarder->sessions)
+    GST_WARNING ("Forwarder freed with %u sessions left",
+        g_list_length (forwarder->sessions));
+  while (forwarder->sessions)
+    fs_rtp_forwarder_remove_session (forwarder,
+        ((Session *) forwarder->sessions->data)->session);
+  g_mutex_clear (&forwarder->mutex);
+  g_slice_free (FsRtpForwarder, forwarder);
+}
+
+static Session *
+find_session (FsRtpForwarder *self, GObject *session)
+{
+  GList *item;
+
+  for (item = self->sessions; item; item = item->next)
+  {
+    Session *s = item->data;
+
+    if (s->session == session)
+      return s;
+  }
+
+  return NULL;
+}
+
+static FsCodec *
+find_codec_by_id (GList *codecs, gint id)
+{
+  GList *item;
+
+  for (item = codecs; item; item = item->next)
+  {
+    FsCodec *codec = item->data;
+
+    if (codec->id == id)
+      return codec;
+  }
+
+  return NULL;
+}
+
+static FsCodec *
+find_same_codec (GList *codecs, FsCodec *codec)
+{
+  GList *item;
+
+  for (item = codecs; item; item = item->next)
+  {
+    FsCodec *c = item->data;
+
+    if (c->media_type == codec->media_type &&
+        c->clock_rate == codec->clock_rate &&
+        (c->channels == codec->channels || !c->channels || !codec->channels) &&
+        c->encoding_name && codec->encoding_name &&
+        !g_ascii_strcasecmp (c->encoding_name, codec->encoding_name))
+      return c;
+  }
+
+  return NULL;
+}
+
+static gboolean
+ssrc_is_value (gpointer key, gpointer value, gpointer user_data)
+{
+  return value == user_data;
+}
+
+static guint32
+get_forwarded_ssrc (Session *dest, guint32 ssrc)
+{
+  gpointer forwarded;
+
+  if (g_hash_table_lookup_extended (dest->ssrcs, GUINT_TO_POINTER (ssrc),
+          NULL, &forwarded))
+    return GPOINTER_TO_UINT (forwarded);
+
+  do {
+    forwarded = GUINT_TO_POINTER (g_random_int ());
+  } while (forwarded == NULL ||
+      g_hash_table_find (dest->ssrcs, ssrc_is_value, forwarded));
+
+  g_hash_table_insert (dest->ssrcs, GUINT_TO_POINTER (ssrc), forwarded);
+
+  return GPOINTER_TO_UINT (forwarded);
+}
+
+static gboolean fs_rtp_forwarder_src_event (GstPad *pad, GstObject *parent,
+    GstEvent *event);
+
+static Output *
+output_new (FsRtpForwarder *self, Source *source, Session *dest)
+{
+  Output *output = g_slice_new0 (Output);
+
+  output->session = dest;
+  output->dest = g_object_ref (dest->session);
+  output->release_pad = dest->release_pad;
+  output->ssrc = get_forwarded_ssrc (dest, source->ssrc);
+  output->pt = -1;
+  output->segment_pending = TRUE;
+  output->max_layer = MAX_TEMPORAL_LAYERS - 1;
+  dest->n_outputs++;
+
+  output->peer = dest->request_pad (dest->session);
+  if (output->peer)
+  {
+    gchar *name = g_strdup_printf ("forward_src_%u_%u_%u", source->ssrc,
+        source->pt, output->ssrc);
+
+    output->srcpad = gst_pad_new (name, GST_PAD_SRC);
+    g_free (name);
+    gst_object_ref_sink (output->srcpad);
+    gst_pad_set_element_private (output->srcpad, self);
+    gst_pad_set_event_function (output->srcpad, fs_rtp_forwarder_src_event);
+    gst_pad_set_active (output->srcpad, TRUE);
+
+    if (GST_PAD_LINK_FAILED (gst_pad_link_full (output->srcpad, output->peer,
+                GST_PAD_LINK_CHECK_NOTHING)))
+      GST_WARNING ("Could not link %s:%s to forward SSRC %x",
+          GST_DEBUG_PAD_NAME (output->peer), source->ssrc);
+  }
+  else
+  {
+    GST_WARNING ("Could not get a pad to forward SSRC %x", source->ssrc);
+  }
+
+  GST_DEBUG ("Forwarding SSRC %x pt %u as SSRC %x", source->ssrc, source->pt,
+      output->ssrc);
+
+  return output;
+}
+
+static void
+output_destroy (Output *output)
+{
+  if (output->srcpad)
+  {
+    gst_pad_unlink (output->srcpad, output->peer);
+    gst_pad_set_active (output->srcpad, FALSE);
+    gst_object_unref (output->srcpad);
+  }
+
+  if (output->peer)
+  {
+    output->release_pad (output->dest, output->peer);
+    gst_object_unref (output->peer);
+  }
+
+  if (output->caps)
+    gst_caps_unref (output->caps);
+  g_object_unref (output->dest);
+  g_slice_free (Output, output);
+}
+
+static void fs_rtp_forwarder_sink_unlinked (GstPad *pad, GstPad *peer,
+    gpointer user_data);
+
+static void
+source_destroy (Source *source)
+{
+  g_signal_handlers_disconnect_by_func (source->sinkpad,
+      fs_rtp_forwarder_sink_unlinked, source->forwarder);
+  gst_pad_unlink (source->rtpbin_pad, source->sinkpad);
+
+  /* Waits for the chain function to return */
+  gst_pad_set_active (source->sinkpad, FALSE);
+
+  g_list_free_full (source->outputs, (GDestroyNotify) output_destroy);
+
+  if (source->segment)
+    gst_event_unref (source->segment);
+  gst_object_unref (source->sinkpad);
+  gst_object_unref (source->rtpbin_pad);
+  fs_rtp_forwarder_unref (source->forwarder);
+  g_slice_free (Source, source);
+}
+
+static void
+detach_source_locked (FsRtpForwarder *self, GList *item)
+{
+  Source *source = item->data;
+  GList *item2;
+
+  source->removed = TRUE;
+  for (item2 = source->outputs; item2; item2 = item2->next)
+    ((Output *) item2->data)->session->n_outputs--;
+  self->sources = g_list_delete_link (self->sources, item);
+}
+
+/**
+ * fs_rtp_forwarder_add_session:
+ * @forwarder: a #FsRtpForwarder
+ * @session: the session
+ * @media_type: the media type of the session, only the packets of the same
+ *  media type are forwarded to it
+ * @request_pad: gets a pad to inject the packets of one source into the
+ *  send path of @session
+ * @release_pad: releases a pad returned by @request_pad
+ *
+ * The sources of @session will be forwarded to the other sessions, and
+ * theirs to @session.
+ */
+
+void
+fs_rtp_forwarder_add_session (FsRtpForwarder *forwarder,
+    GObject *session,
+    FsMediaType media_type,
+    FsRtpForwarderRequestPadFunc request_pad,
+    FsRtpForwarderReleasePadFunc release_pad)
+{
+  Session *s;
+
+  FS_RTP_FORWARDER_LOCK (forwarder);
+  if (find_session (forwarder, session))
+  {
+    FS_RTP_FORWARDER_UNLOCK (forwarder);
+    return;
+  }
+
+  s = g_slice_new0 (Session);
+  s->session = session;
+  s->media_type = media_type;
+  s->request_pad = request_pad;
+  s->release_pad = release_pad;
+  s->ssrcs = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  forwarder->sessions = g_list_append (forwarder->sessions, s);
+  FS_RTP_FORWARDER_UNLOCK (forwarder);
+}
+
+/**
+ * fs_rtp_forwarder_remove_session:
+ * @forwarder: a #FsRtpForwarder
+ * @session: the session
+ *
+ * Stops forwarding the sources of @session and the packets to it, the pads
+ * it returned are all released before this returns.
+ */
+
+void
+fs_rtp_forwarder_remove_session (FsRtpForwarder *forwarder, GObject *session)
+{
+  GList *dead_sources = NULL;
+  GList *dead_outputs = NULL;
+  GList *item;
+  Session *s;
+
+  FS_RTP_FORWARDER_LOCK (forwarder);
+  s = find_session (forwarder, session);
+  if (!s)
+  {
+    FS_RTP_FORWARDER_UNLOCK (forwarder);
+    return;
+  }
+  forwarder->sessions = g_list_remove (forwarder->sessions, s);
+
+  item = forwarder->sources;
+  while (item)
+  {
+    Source *source = item->data;
+    GList *next = item->next;
+
+    if (source->session == s)
+    {
+      detach_source_locked (forwarder, item);
+      dead_sources = g_list_prepend (dead_sources, source);
+    }
+    else
+    {
+      GList *item2 = source->outputs;
+
+      while (item2)
+      {
+        Output *output = item2->data;
+        GList *next2 = item2->next;
+
+        if (output->session == s)
+        {
+          source->outputs = g_list_delete_link (source->outputs, item2);
+          dead_outputs = g_list_prepend (dead_outputs, output);
+        }
+        item2 = next2;
+      }
+    }
+    item = next;
+  }
+  FS_RTP_FORWARDER_UNLOCK (forwarder);
+
+  g_list_free_full (dead_outputs, (GDestroyNotify) output_destroy);
+  g_list_free_full (dead_sources, (GDestroyNotify) source_destroy);
+
+  fs_codec_list_destroy (s->codecs);
+  g_hash_table_destroy (s->ssrcs);
+  g_slice_free (Session, s);
+}
+
+/**
+ * fs_rtp_forwarder_set_codecs:
+ * @forwarder: a #FsRtpForwarder
+ * @session: the session
+ * @codecs: (element-type FsCodec): the codecs negotiated by @session,
+ *  without the redundancy and retransmission ones
+ *
+ * The payload types of the packets received by @session are looked up in
+ * @codecs, and the packets from the other sessions are given the payload
+ * type of the same codec in @codecs.
+ */
+
+void
+fs_rtp_forwarder_set_codecs (FsRtpForwarder *forwarder, GObject *session,
+    GList *codecs)
+{
+  Session *s;
+
+  FS_RTP_FORWARDER_LOCK (forwarder);
+  s = find_session (forwarder, session);
+  if (s)
+  {
+    fs_codec_list_destroy (s->codecs);
+    s->codecs = fs_codec_list_copy (codecs);
+    forwarder->codecs_generation++;
+  }
+  FS_RTP_FORWARDER_UNLOCK (forwarder);
+}
+
+/**
+ * fs_rtp_forwarder_set_bitrate:
+ * @forwarder: a #FsRtpForwarder
+ * @session: the session
+ * @bitrate: what the congestion control of @session allows, in bits/sec,
+ *  0 if it is not known
+ *
+ * The layered sources forwarded to @session share @bitrate, they are
+ * thinned to fit in it.
+ */
+
+void
+fs_rtp_forwarder_set_bitrate (FsRtpForwarder *forwarder, GObject *session,
+    guint bitrate)
+{
+  Session *s;
+
+  FS_RTP_FORWARDER_LOCK (forwarder);
+  s = find_session (forwarder, session);
+  if (s && s->bitrate != bitrate)
+  {
+    GST_LOG ("Forwarding at most %u bits/sec", bitrate);
+    s->bitrate = bitrate;
+  }
+  FS_RTP_FORWARDER_UNLOCK (forwarder);
+}
+
+/**
+ * fs_rtp_forwarder_get_vp8_temporal_layer:
+ * @payload: the payload of a VP8 RTP packet
+ * @size: its size
+ *
+ * Reads the TID of the payload descriptor of RFC 7741.
+ *
+ * Returns: the temporal layer of the frame, 0 if the stream is not
+ *  layered, -1 if the descriptor is truncated
+ */
+
+gint
+fs_rtp_forwarder_get_vp8_temporal_layer (const guint8 *payload, guint size)
+{
+  guint offset = 2;
+  guint8 ext;
+
+  if (size < 1)
+    return -1;
+
+  /* X */
+  if (!(payload[0] & 0x80))
+    return 0;
+
+  if (size < 2)
+    return -1;
+  ext = payload[1];
+
+  /* I, with a 7 or a 15 bits picture ID */
+  if (ext & 0x80)
+  {
+    if (size <= offset)
+      return -1;
+    offset += (payload[offset] & 0x80) ? 2 : 1;
+  }
+
+  /* L */
+  if (ext & 0x40)
+    offset++;
+
+  /* T */
+  if (!(ext & 0x20))
+    return 0;
+
+  if (size <= offset)
+    return -1;
+
+  return payload[offset] >> 6;
+}
+
+static gint
+h264_nal_temporal_layer (const guint8 *nal, guint size)
+{
+  guint type;
+
+  if (size < 1)
+    return -1;
+
+  /* The prefix and the coded slice extension have the SVC header */
+  type = nal[0] & 0x1f;
+  if (type != 14 && type != 20)
+    return 0;
+
+  if (size < 4)
+    return -1;
+
+  return nal[3] >> 5;
+}
+
+/**
+ * fs_rtp_forwarder_get_h264_temporal_layer:
+ * @payload: the payload of a H.264 RTP packet
+ * @size: its size
+ *
+ * Reads the temporal_id of the SVC NAL unit header extension of the first
+ * NAL unit of the packet, as packetized by RFC 6184 and RFC 6190.
+ *
+ * Returns: the temporal layer of the frame, 0 if the NAL unit has no SVC
+ *  extension, -1 if it can not be known from this packet
+ */
+
+gint
+fs_rtp_forwarder_get_h264_temporal_layer (const guint8 *payload, guint size)
+{
+  if (size < 1)
+    return -1;
+
+  switch (payload[0] & 0x1f)
+  {
+    case 24:
+      /* STAP-A, the first NAL unit follows its size */
+      if (size < 3)
+        return -1;
+      return h264_nal_temporal_layer (payload + 3,
+          MIN (GST_READ_UINT16_BE (payload + 1), size - 3));
+    case 28:
+      /* FU-A, only the first fragment has the rest of the header */
+      if (size < 2 || !(payload[1] & 0x80))
+        return -1;
+      if ((payload[1] & 0x1f) != 14 && (payload[1] & 0x1f) != 20)
+        return 0;
+      if (size < 5)
+        return -1;
+      return payload[4] >> 5;
+    default:
+      return h264_nal_temporal_layer (payload, size);
+  }
+}
+
+static void
+update_source_locked (FsRtpForwarder *self, Source *source)
+{
+  FsCodec *codec;
+
+  source->codecs_generation = self->codecs_generation;
+
+  codec = find_codec_by_id (source->session->codecs, source->pt);
+  source->layering = LAYERING_NONE;
+  source->clock_rate = 0;
+  if (!codec || !codec->encoding_name)
+    return;
+
+  source->clock_rate = codec->clock_rate;
+  if (!g_ascii_strcasecmp (codec->encoding_name, "VP8"))
+    source->layering = LAYERING_VP8;
+  else if (!g_ascii_strcasecmp (codec->encoding_name, "H264") ||
+      !g_ascii_strcasecmp (codec->encoding_name, "H264-SVC"))
+    source->layering = LAYERING_H264;
+}
+
+/*
+ * Returns TRUE if the packet starts a new frame
+ */
+
+static gboolean
+account_packet_locked (Source *source, guint32 ts, const guint8 *payload,
+    guint payload_size, guint size)
+{
+  gboolean new_frame = FALSE;
+  guint32 elapsed;
+  guint i;
+
+  if (!source->have_frame || ts != source->frame_ts)
+  {
+    gint layer = -1;
+
+    if (source->layering == LAYERING_VP8)
+      layer = fs_rtp_forwarder_get_vp8_temporal_layer (payload, payload_size);
+    else if (source->layering == LAYERING_H264)
+      layer = fs_rtp_forwarder_get_h264_temporal_layer (payload,
+          payload_size);
+
+    source->have_frame = TRUE;
+    source->frame_ts = ts;
+    source->frame_layer = CLAMP (layer, 0, MAX_TEMPORAL_LAYERS - 1);
+    new_frame = TRUE;
+  }
+
+  if (source->layering == LAYERING_NONE || source->clock_rate == 0)
+    return new_frame;
+
+  /* The timestamps of the frames go back with B-frames */
+  elapsed = ts - source->window_ts;
+  if ((gint32) elapsed < 0)
+    elapsed = 0;
+
+  if (!source->have_window || elapsed > 10 * source->clock_rate)
+  {
+    /* The first packet, or the timestamps jumped */
+    source->have_window = TRUE;
+    source->window_ts = ts;
+    memset (source->layer_bytes, 0, sizeof (source->layer_bytes));
+  }
+  else if (elapsed >= source->clock_rate / LAYER_RATE_WINDOW_DIV)
+  {
+    for (i = 0; i < MAX_TEMPORAL_LAYERS; i++)
+    {
+      guint rate = source->layer_bytes[i] * 8 * source->clock_rate / elapsed;
+
+      if (source->layer_rates[i] == 0)
+        source->layer_rates[i] = rate;
+      else
+        source->layer_rates[i] = (source->layer_rates[i] + rate) / 2;
+      source->layer_bytes[i] = 0;
+    }
+    source->window_ts = ts;
+  }
+
+  source->layer_bytes[source->frame_layer] += size;
+
+  return new_frame;
+}
+
+static guint
+get_target_layer_locked (Source *source, Output *output)
+{
+  Session *dest = output->session;
+  guint64 budget;
+  guint64 sum = 0;
+  guint layer;
+
+  if (dest->bitrate == 0 || dest->n_outputs == 0)
+    return MAX_TEMPORAL_LAYERS - 1;
+
+  budget = dest->bitrate / dest->n_outputs;
+
+  /* The base layer is always sent */
+  for (layer = 0; layer < MAX_TEMPORAL_LAYERS; layer++)
+  {
+    sum += source->layer_rates[layer];
+    if (sum > budget)
+      break;
+  }
+
+  return layer > 0 ? layer - 1 : 0;
+}
+
+/*
+ * Decides whether the new frame is sent to this destination
+ */
+
+static void
+thin_output_locked (Source *source, Output *output)
+{
+  guint target = get_target_layer_locked (source, output);
+
+  if (target < output->max_layer ||
+      (target > output->max_layer && source->frame_layer == 0))
+  {
+    GST_DEBUG ("Forwarding the temporal layers up to %u of SSRC %x as %x",
+        target, source->ssrc, output->ssrc);
+    output->max_layer = target;
+  }
+
+  output->drop_frame = source->frame_layer > output->max_layer;
+}
+
+static void
+request_key_unit (Source *source)
+{
+  GST_DEBUG ("Requesting a key unit from SSRC %x", source->ssrc);
+
+  gst_pad_push_event (source->sinkpad,
+      gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+          gst_structure_new ("GstForceKeyUnit",
+              "all-headers", G_TYPE_BOOLEAN, TRUE,
+              "ssrc", G_TYPE_UINT, source->ssrc,
+              NULL)));
+}
+
+static void
+update_output_locked (FsRtpForwarder *self, Source *source, Output *output)
+{
+  FsCodec *codec;
+  FsCodec *dest_codec = NULL;
+  gchar *encoding_name;
+  GstCaps *caps;
+
+  output->codecs_generation = self->codecs_generation;
+
+  codec = find_codec_by_id (source->session->codecs, source->pt);
+  if (codec)
+    dest_codec = find_same_codec (output->session->codecs, codec);
+
+  if (!dest_codec)
+  {
+    if (output->pt >= 0 || !output->caps)
+      GST_DEBUG ("Not forwarding SSRC %x pt %u, the destination did not"
+          " negotiate its codec", source->ssrc, source->pt);
+    output->pt = -1;
+    return;
+  }
+
+  output->pt = dest_codec->id;
+
+  /* What the rtpbin and the aux senders need, the rest is opaque to them.
+   * There is no ssrc, the rtpsession would take it as its own each time the
+   * funnel switches to this pad. */
+  encoding_name = g_ascii_strup (dest_codec->encoding_name, -1);
+  caps = gst_caps_new_simple ("application/x-rtp",
+      "media", G_TYPE_STRING, fs_media_type_to_string (dest_codec->media_type),
+      "clock-rate", G_TYPE_INT, dest_codec->clock_rate,
+      "encoding-name", G_TYPE_STRING, encoding_name,
+      "payload", G_TYPE_INT, dest_codec->id,
+      NULL);
+  g_free (encoding_name);
+  if (output->caps && gst_caps_is_equal (caps, output->caps))
+  {
+    gst_caps_unref (caps);
+    return;
+  }
+
+  gst_caps_replace (&output->caps, caps);
+  gst_caps_unref (caps);
+  output->caps_pending = TRUE;
+}
+
+/*
+ * The new buffer shares the memory of the original one, only the 12 bytes
+ * of the fixed header are copied
+ */
+
+static GstBuffer *
+rewrite_header (GstBuffer *buffer, guint8 pt, guint32 ssrc, guint16 seqnum)
+{
+  GstBuffer *outbuf;
+  GstMemory *header;
+  GstMapInfo map;
+
+  header = gst_allocator_alloc (NULL, 12, NULL);
+  gst_memory_map (header, &map, GST_MAP_WRITE);
+  gst_buffer_extract (buffer, 0, map.data, 12);
+  map.data[1] = (map.data[1] & 0x80) | (pt & 0x7f);
+  GST_WRITE_UINT16_BE (map.data + 2, seqnum);
+  GST_WRITE_UINT32_BE (map.data + 8, ssrc);
+  gst_memory_unmap (header, &map);
+
+  outbuf = gst_buffer_new ();
+  gst_buffer_copy_into (outbuf, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
+  gst_buffer_append_memory (outbuf, header);
+  if (gst_buffer_get_size (buffer) > 12)
+    gst_buffer_copy_into (outbuf, buffer, GST_BUFFER_COPY_MEMORY, 12, -1);
+
+  return outbuf;
+}
+
+static GstFlowReturn
+fs_rtp_forwarder_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  Source *source = gst_pad_get_element_private (pad);
+  FsRtpForwarder *self = source->forwarder;
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GArray *pushes;
+  gboolean new_output = FALSE;
+  gboolean new_frame;
+  guint16 seqnum;
+  GList *item;
+  guint i;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+  {
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  pushes = g_array_new (FALSE, FALSE, sizeof (Push));
+  seqnum = gst_rtp_buffer_get_seq (&rtpbuffer);
+
+  FS_RTP_FORWARDER_LOCK (self);
+  if (source->removed)
+  {
+    FS_RTP_FORWARDER_UNLOCK (self);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+    g_array_free (pushes, TRUE);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_FLUSHING;
+  }
+
+  if (source->codecs_generation != self->codecs_generation)
+    update_source_locked (self, source);
+
+  new_frame = account_packet_locked (source,
+      gst_rtp_buffer_get_timestamp (&rtpbuffer),
+      gst_rtp_buffer_get_payload (&rtpbuffer),
+      gst_rtp_buffer_get_payload_len (&rtpbuffer),
+      gst_buffer_get_size (buffer));
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  for (item = self->sessions; item; item = item->next)
+  {
+    Session *dest = item->data;
+    GList *item2;
+
+    if (dest == source->session ||
+        dest->media_type != source->session->media_type)
+      continue;
+
+    for (item2 = source->outputs; item2; item2 = item2->next)
+      if (((Output *) item2->data)->session == dest)
+        break;
+
+    if (!item2)
+    {
+      source->outputs = g_list_prepend (source->outputs,
+          output_new (self, source, dest));
+      new_output = TRUE;
+    }
+  }
+
+  for (item = source->outputs; item; item = item->next)
+  {
+    Output *output = item->data;
+    Push push = { NULL, 0, 0, 0, NULL };
+
+    if (output->codecs_generation != self->codecs_generation)
+      update_output_locked (self, source, output);
+
+    if (output->pt < 0 || !output->srcpad)
+      continue;
+
+    if (new_frame && source->layering != LAYERING_NONE)
+      thin_output_locked (source, output);
+
+    if (output->drop_frame)
+    {
+      output->dropped++;
+      continue;
+    }
+
+    if (!output->started)
+    {
+      gchar *stream_id = g_strdup_printf ("fsrtpforwarder/%08x", output->ssrc);
+
+      push.events = g_list_append (push.events,
+          gst_event_new_stream_start (stream_id));
+      g_free (stream_id);
+      output->started = TRUE;
+    }
+
+    if (output->caps_pending)
+    {
+      push.events = g_list_append (push.events,
+          gst_event_new_caps (output->caps));
+      output->caps_pending = FALSE;
+    }
+
+    if (output->segment_pending)
+    {
+      if (source->segment)
+      {
+        push.events = g_list_append (push.events,
+            gst_event_ref (source->segment));
+      }
+      else
+      {
+        GstSegment segment;
+
+        gst_segment_init (&segment, GST_FORMAT_TIME);
+        push.events = g_list_append (push.events,
+            gst_event_new_segment (&segment));
+      }
+      output->segment_pending = FALSE;
+    }
+
+    push.srcpad = gst_object_ref (output->srcpad);
+    push.pt = output->pt;
+    push.ssrc = output->ssrc;
+    push.seqnum = seqnum - output->dropped;
+    g_array_append_val (pushes, push);
+  }
+  FS_RTP_FORWARDER_UNLOCK (self);
+
+  if (new_output && source->session->media_type == FS_MEDIA_TYPE_VIDEO)
+    request_key_unit (source);
+
+  for (i = 0; i < pushes->len; i++)
+  {
+    Push *push = &g_array_index (pushes, Push, i);
+    GList *event;
+
+    for (event = push->events; event; event = event->next)
+      gst_pad_push_event (push->srcpad, event->data);
+    g_list_free (push->events);
+
+    /* A destination going away must not stop the others */
+    gst_pad_push (push->srcpad, rewrite_header (buffer, push->pt,
+            push->ssrc, push->seqnum));
+    gst_object_unref (push->srcpad);
+  }
+
+  g_array_free (pushes, TRUE);
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+fs_rtp_forwarder_sink_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  Source *source = gst_pad_get_element_private (pad);
+  GList *item;
+
+  /* The destinations get their own caps and keep streaming */
+  if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT)
+  {
+    FS_RTP_FORWARDER_LOCK (source->forwarder);
+    gst_event_replace (&source->segment, event);
+    for (item = source->outputs; item; item = item->next)
+      ((Output *) item->data)->segment_pending = TRUE;
+    FS_RTP_FORWARDER_UNLOCK (source->forwarder);
+  }
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+/*
+ * Translates the key unit requests the destination gets from its peer into
+ * requests to the origin of the packets. The other upstream events stay in
+ * the destination.
+ */
+
+static gboolean
+fs_rtp_forwarder_src_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  FsRtpForwarder *self = gst_pad_get_element_private (pad);
+  GstPad *sinkpad = NULL;
+  guint32 origin_ssrc = 0;
+  GList *item, *item2;
+  gboolean ret;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CUSTOM_UPSTREAM ||
+      !gst_event_has_name (event, "GstForceKeyUnit"))
+  {
+    gst_event_unref (event);
+    return FALSE;
+  }
+
+  FS_RTP_FORWARDER_LOCK (self);
+  for (item = self->sources; item && !sinkpad; item = item->next)
+  {
+    Source *source = item->data;
+
+    for (item2 = source->outputs; item2; item2 = item2->next)
+    {
+      Output *output = item2->data;
+      guint ssrc;
+
+      if (output->srcpad != pad)
+        continue;
+
+      /* The funnel sends it to every source of the destination */
+      if (!gst_structure_get_uint (gst_event_get_structure (event), "ssrc",
+              &ssrc) || ssrc == output->ssrc)
+      {
+        sinkpad = gst_object_ref (source->sinkpad);
+        origin_ssrc = source->ssrc;
+      }
+      break;
+    }
+  }
+  FS_RTP_FORWARDER_UNLOCK (self);
+
+  if (!sinkpad)
+  {
+    gst_event_unref (event);
+    return FALSE;
+  }
+
+  GST_DEBUG ("Forwarding key unit request to SSRC %x", origin_ssrc);
+
+  event = gst_event_make_writable (event);
+  gst_structure_set (gst_event_writable_structure (event),
+      "ssrc", G_TYPE_UINT, origin_ssrc, NULL);
+  ret = gst_pad_push_event (sinkpad, event);
+  gst_object_unref (sinkpad);
+
+  return ret;
+}
+
+static void
+fs_rtp_forwarder_sink_unlinked (GstPad *pad, GstPad *peer, gpointer user_data)
+{
+  FsRtpForwarder *self = user_data;
+  Source *source = gst_pad_get_element_private (pad);
+  GList *item;
+
+  FS_RTP_FORWARDER_LOCK (self);
+  item = g_list_find (self->sources, source);
+  if (!item)
+  {
+    FS_RTP_FORWARDER_UNLOCK (self);
+    return;
+  }
+  detach_source_locked (self, item);
+  FS_RTP_FORWARDER_UNLOCK (self);
+
+  GST_DEBUG ("SSRC %x pt %u is gone, not forwarding it anymore",
+      source->ssrc, source->pt);
+
+  source_destroy (source);
+}
+
+/**
+ * fs_rtp_forwarder_add_source:
+ * @forwarder: a #FsRtpForwarder
+ * @session: the session that received the packets
+ * @pad: a src pad of the rtpbin with the packets of one SSRC and payload
+ *  type
+ * @ssrc: the SSRC
+ * @pt: the payload type
+ *
+ * Links @pad to the forwarder, until it is unlinked or @session is removed.
+ *
+ * Returns: %TRUE if the packets from @pad will be forwarded, %FALSE if
+ *  @session does not forward
+ */
+
+gboolean
+fs_rtp_forwarder_add_source (FsRtpForwarder *forwarder,
+    GObject *session,
+    GstPad *pad,
+    guint32 ssrc,
+    guint pt)
+{
+  Source *source;
+  Session *s;
+  gchar *name;
+
+  FS_RTP_FORWARDER_LOCK (forwarder);
+  s = find_session (forwarder, session);
+  if (!s)
+  {
+    FS_RTP_FORWARDER_UNLOCK (forwarder);
+    return FALSE;
+  }
+
+  source = g_slice_new0 (Source);
+  source->forwarder = fs_rtp_forwarder_ref (forwarder);
+  source->session = s;
+  source->ssrc = ssrc;
+  source->pt = pt;
+  source->rtpbin_pad = gst_object_ref (pad);
+
+  name = g_strdup_printf ("forward_sink_%u_%u", ssrc, pt);
+  source->sinkpad = gst_pad_new (name, GST_PAD_SINK);
+  g_free (name);
+  gst_object_ref_sink (source->sinkpad);
+  gst_pad_set_element_private (source->sinkpad, source);
+  gst_pad_set_chain_function (source->sinkpad, fs_rtp_forwarder_chain);
+  gst_pad_set_event_function (source->sinkpad, fs_rtp_forwarder_sink_event);
+  gst_pad_set_active (source->sinkpad, TRUE);
+
+  forwarder->sources = g_list_prepend (forwarder->sources, source);
+  FS_RTP_FORWARDER_UNLOCK (forwarder);
+
+  g_signal_connect (source->sinkpad, "unlinked",
+      G_CALLBACK (fs_rtp_forwarder_sink_unlinked), forwarder);
+
+  if (GST_PAD_LINK_FAILED (gst_pad_link (pad, source->sinkpad)))
+  {
+    GST_WARNING ("Could not link %s:%s to the forwarder",
+        GST_DEBUG_PAD_NAME (pad));
+    fs_rtp_forwarder_sink_unlinked (source->sinkpad, pad, forwarder);
+    return FALSE;
+  }
+
+  GST_DEBUG ("Forwarding SSRC %x pt %u", ssrc, pt);
+
+  return TRUE;
+}
@@ -0,0 +1,90 @@
+/*
+ * Farstream - Farstream RTP Forwarder
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-forwarder.h - Relays the RTP packets received by a session to the
+ *  other forwarding sessions without decoding them
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_FORWARDER_H__
+#define __FS_RTP_FORWARDER_H__
+
+#include <gst/gst.h>
+
+#include <farstream/fs-codec.h>
+
+G_BEGIN_DECLS
+
+typedef struct _FsRtpForwarder FsRtpForwarder;
+
+/**
+ * FsRtpForwarderRequestPadFunc:
+ * @session: the session the packets are forwarded to
+ *
+ * Called with the lock of the forwarder held, it must not call back into
+ * the forwarder.
+ *
+ * Returns: (transfer full): a new sink pad on the send path of @session,
+ *  or %NULL
+ */
+typedef GstPad *(*FsRtpForwarderRequestPadFunc) (GObject *session);
+
+/**
+ * FsRtpForwarderReleasePadFunc:
+ * @session: the session the packets were forwarded to
+ * @pad: a pad returned by the #FsRtpForwarderRequestPadFunc
+ *
+ * Called without any lock of the forwarder held.
+ */
+typedef void (*FsRtpForwarderReleasePadFunc) (GObject *session, GstPad *pad);
+
+FsRtpForwarder *fs_rtp_forwarder_new (void);
+
+FsRtpForwarder *fs_rtp_forwarder_ref (FsRtpForwarder *forwarder);
+void fs_rtp_forwarder_unref (FsRtpForwarder *forwarder);
+
+void fs_rtp_forwarder_add_session (FsRtpForwarder *forwarder,
+    GObject *session,
+    FsMediaType media_type,
+    FsRtpForwarderRequestPadFunc request_pad,
+    FsRtpForwarderReleasePadFunc release_pad);
+void fs_rtp_forwarder_remove_session (FsRtpForwarder *forwarder,
+    GObject *session);
+
+void fs_rtp_forwarder_set_codecs (FsRtpForwarder *forwarder,
+    GObject *session,
+    GList *codecs);
+
+void fs_rtp_forwarder_set_bitrate (FsRtpForwarder *forwarder,
+    GObject *session,
+    guint bitrate);
+
+gboolean fs_rtp_forwarder_add_source (FsRtpForwarder *forwarder,
+    GObject *session,
+    GstPad *pad,
+    guint32 ssrc,
+    guint pt);
+
+gint fs_rtp_forwarder_get_vp8_temporal_layer (const guint8 *payload,
+    guint size);
+gint fs_rtp_forwarder_get_h264_temporal_layer (const guint8 *payload,
+    guint size);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_FORWARDER_H__ */
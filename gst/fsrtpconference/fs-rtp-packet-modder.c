@@ -29,9 +29,106 @@
 
 #include "fs-rtp-packet-modder.h"
 
+#include <string.h>
+
+#include <gst/rtp/gstrtpbuffer.h>
+
+/*
+ * Without pacing, every buffer waits on the clock until the time returned
+ * by the FsRtpPacketModderSyncTimeFunc and is pushed on its own.
+ *
+ * With pacing, the packets go through a token bucket filled at the rate
+ * returned by the FsRtpPacketModderRateFunc. Packets that find tokens and
+ * nothing queued are pushed right away from the streaming thread. The
+ * others are queued and a task on the src pad wakes up once per pacing
+ * interval, on a single periodic clock id, to push as many as the tokens
+ * allow in one buffer list. The bucket holds at most one interval worth of
+ * tokens, so the bursts on the wire never last more than that. The pacing
+ * follows the system clock, as what matters is the rate on the wire.
+ *
+ * When the #FsRtpPacketModder:latency-budget is set, the queue is not
+ * allowed to hold more than that much time at the current rate. Instead of
+ * blocking upstream, whole frames (all the packets with the same SSRC and
+ * RTP timestamp) are dropped: first the ones that no other frame refers
+ * to, oldest first, then frames from the end of the queue. Payloaders
+ * rarely set %GST_BUFFER_FLAG_DROPPABLE, so those are also found in the
+ * payload of the codecs that say it in every packet, VP8 and H.264, whose
+ * payload types come from the caps. For the other codecs, only the tail
+ * is dropped unless upstream sets the flag. Since the frames following those can not be decoded anymore,
+ * a key unit is requested upstream and the incoming delta units are dropped
+ * until it arrives. The frame being sent is never touched and the
+ * sequence numbers are rewritten so that the receivers do not see the
+ * drops as losses: each SSRC has its own offset, which grows by one when a
+ * packet that was dropped is passed, so the other SSRCs keep their
+ * numbers. The offsets start again from zero after a flush.
+ *
+ * With the latency budget set, padding can also be requested to probe the
+ * path. When the queue is empty and there are tokens left, the pacing task
+ * sends RTP packets made only of padding, in the stream of the frame being
+ * sent, and only shifts the offset of that SSRC to make room for them.
+ */
+
 GST_DEBUG_CATEGORY_STATIC (fs_rtp_packet_modder_debug);
 #define GST_CAT_DEFAULT fs_rtp_packet_modder_debug
 
+/* At most this many packets are taken out of the queue at once */
+#define PACE_MAX_BURST_PACKETS (64)
+
+/* Upstream is blocked while more than this much data is queued */
+#define PACE_MAX_QUEUE_TIME (200 * GST_MSECOND)
+
+#define DEFAULT_PACING_INTERVAL (5 * GST_MSECOND)
+
+/* The RTP padding length is a single byte */
+#define MAX_PADDING_SIZE (255)
+
+/* Repeat the key unit request if none came after this long */
+#define KEYFRAME_REQUEST_INTERVAL (GST_SECOND)
+
+typedef struct {
+  GstBuffer *buffer;
+  GstClockTime queued_at;
+  gsize size;
+  /* only set if the latency budget was set when it arrived */
+  gboolean parsed;
+  GstBufferFlags flags;
+  guint32 ssrc;
+  guint32 rtptime;
+  guint8 pt;
+  guint16 seqnum;
+  guint16 out_seqnum;
+  gboolean padding;
+  /* no other frame refers to its frame, from the payload */
+  gboolean non_reference;
+} QueuedPacket;
+
+/* The codecs whose payload says if a frame is a reference */
+typedef enum {
+  PAYLOAD_CODEC_OTHER,
+  PAYLOAD_CODEC_VP8,
+  PAYLOAD_CODEC_H264
+} PayloadCodec;
+
+#define SAME_FRAME(qp, frame_ssrc, frame_rtptime) \
+  ((qp)->ssrc == (frame_ssrc) && (qp)->rtptime == (frame_rtptime))
+
+/* How the sequence numbers of a SSRC are rewritten */
+typedef struct {
+  /* subtracted from the sequence numbers of the packets sent */
+  guint16 offset;
+  guint16 next_seqnum;
+  /* of the dropped packets that no packet sent has passed yet */
+  GArray *dropped;
+} SsrcSeqnums;
+
+enum
+{
+  PROP_0,
+  PROP_PACING_INTERVAL,
+  PROP_LATENCY_BUDGET,
+  PROP_STATS
+};
+
 static GstStaticPadTemplate fs_rtp_packet_modder_sink_template =
     GST_STATIC_PAD_TEMPLATE ("sink",
         GST_PAD_SINK,
@@ -48,6 +145,8 @@ G_DEFINE_TYPE (FsRtpPacketModder, fs_rtp_packet_modder, GST_TYPE_ELEMENT);
 
 static GstFlowReturn fs_rtp_packet_modder_chain (GstPad *pad,
     GstObject *parent, GstBuffer *buffer);
+static GstFlowReturn fs_rtp_packet_modder_chain_list (GstPad *pad,
+    GstObject *parent, GstBufferList *list);
 static GstCaps *fs_rtp_packet_modder_getcaps (FsRtpPacketModder *self,
     GstPad *pad, GstCaps *filter);
 static gboolean fs_rtp_packet_modder_sink_event (GstPad *pad,
@@ -58,11 +157,19 @@ static gboolean fs_rtp_packet_modder_query (GstPad *pad,
     GstQuery *query);
 static GstStateChangeReturn fs_rtp_packet_modder_change_state (
   GstElement *element, GstStateChange transition);
+static gboolean fs_rtp_packet_modder_src_activate_mode (GstPad *pad,
+    GstObject *parent, GstPadMode mode, gboolean active);
+static void fs_rtp_packet_modder_finalize (GObject *object);
+static void fs_rtp_packet_modder_set_property (GObject *object,
+    guint prop_id, const GValue *value, GParamSpec *pspec);
+static void fs_rtp_packet_modder_get_property (GObject *object,
+    guint prop_id, GValue *value, GParamSpec *pspec);
 
 
 static void
 fs_rtp_packet_modder_class_init (FsRtpPacketModderClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
 
   GST_DEBUG_CATEGORY_INIT
@@ -81,6 +188,44 @@ fs_rtp_packet_modder_class_init (FsRtpPacketModderClass *klass)
       gst_static_pad_template_get (&fs_rtp_packet_modder_src_template));
 
   gstelement_class->change_state = fs_rtp_packet_modder_change_state;
+
+  gobject_class->finalize = fs_rtp_packet_modder_finalize;
+  gobject_class->set_property = fs_rtp_packet_modder_set_property;
+  gobject_class->get_property = fs_rtp_packet_modder_get_property;
+
+  g_object_class_install_property (gobject_class,
+      PROP_PACING_INTERVAL,
+      g_param_spec_uint64 ("pacing-interval",
+          "The pacing interval",
+          "How often the queued packets are released when pacing, in ns",
+          GST_MSECOND, GST_SECOND, DEFAULT_PACING_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_LATENCY_BUDGET,
+      g_param_spec_uint64 ("latency-budget",
+          "The latency budget",
+          "How long packets may wait when pacing before whole frames are"
+          " dropped, in ns, 0 to never drop",
+          0, G_MAXUINT64, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_STATS,
+      g_param_spec_boxed ("stats",
+          "Pacing statistics",
+          "The queue delay and the number of dropped frames and packets",
+          GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+ssrc_seqnums_free (gpointer data)
+{
+  SsrcSeqnums *seqnums = data;
+
+  g_array_unref (seqnums->dropped);
+  g_slice_free (SsrcSeqnums, seqnums);
 }
 
 static void
@@ -88,9 +233,23 @@ fs_rtp_packet_modder_init (FsRtpPacketModder *self)
 {
   gst_segment_init (&self->segment, GST_FORMAT_TIME);
 
+  g_mutex_init (&self->pace_lock);
+  g_cond_init (&self->pace_cond);
+  g_queue_init (&self->pace_queue);
+  self->ssrc_seqnums = g_hash_table_new_full (NULL, NULL, NULL,
+      ssrc_seqnums_free);
+  self->pace_interval = DEFAULT_PACING_INTERVAL;
+  self->pace_clock = gst_system_clock_obtain ();
+  self->last_refill = GST_CLOCK_TIME_NONE;
+  self->last_keyframe_request = GST_CLOCK_TIME_NONE;
+  self->pace_flushing = TRUE;
+  self->pace_ret = GST_FLOW_OK;
+
   self->sinkpad = gst_pad_new_from_static_template (
     &fs_rtp_packet_modder_sink_template, "sink");
   gst_pad_set_chain_function (self->sinkpad, fs_rtp_packet_modder_chain);
+  gst_pad_set_chain_list_function (self->sinkpad,
+      fs_rtp_packet_modder_chain_list);
   gst_pad_set_query_function (self->sinkpad, fs_rtp_packet_modder_query);
   gst_pad_set_event_function (self->sinkpad, fs_rtp_packet_modder_sink_event);
   GST_PAD_SET_PROXY_CAPS (self->sinkpad);
@@ -99,9 +258,122 @@ fs_rtp_packet_modder_init (FsRtpPacketModder *self)
   self->srcpad = gst_pad_new_from_static_template (
     &fs_rtp_packet_modder_src_template, "src");
   gst_pad_set_query_function (self->srcpad, fs_rtp_packet_modder_query);
+  gst_pad_set_activatemode_function (self->srcpad,
+      fs_rtp_packet_modder_src_activate_mode);
   gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
 }
 
+static void
+fs_rtp_packet_modder_clear_pace_queue_locked (FsRtpPacketModder *self)
+{
+  QueuedPacket *qp;
+
+  while ((qp = g_queue_pop_head (&self->pace_queue)))
+  {
+    gst_buffer_unref (qp->buffer);
+    g_slice_free (QueuedPacket, qp);
+  }
+  self->pace_queue_bytes = 0;
+}
+
+static void
+fs_rtp_packet_modder_finalize (GObject *object)
+{
+  FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (object);
+
+  fs_rtp_packet_modder_clear_pace_queue_locked (self);
+  g_hash_table_unref (self->ssrc_seqnums);
+  if (self->pace_clock_id)
+    gst_clock_id_unref (self->pace_clock_id);
+  gst_object_unref (self->pace_clock);
+
+  g_mutex_clear (&self->pace_lock);
+  g_cond_clear (&self->pace_cond);
+
+  G_OBJECT_CLASS (fs_rtp_packet_modder_parent_class)->finalize (object);
+}
+
+static GstStructure *
+fs_rtp_packet_modder_get_stats (FsRtpPacketModder *self)
+{
+  GstClockTime now = gst_clock_get_time (self->pace_clock);
+  QueuedPacket *head;
+  GstStructure *stats;
+
+  g_mutex_lock (&self->pace_lock);
+  head = g_queue_peek_head (&self->pace_queue);
+  stats = gst_structure_new ("application/x-fs-rtp-packet-modder-stats",
+      "queue-delay", G_TYPE_UINT64,
+      head && now > head->queued_at ? now - head->queued_at : 0,
+      "max-queue-delay", G_TYPE_UINT64, self->max_queue_delay,
+      "queued-bytes", G_TYPE_UINT64, self->pace_queue_bytes,
+      "dropped-frames", G_TYPE_UINT64, self->dropped_frames,
+      "dropped-packets", G_TYPE_UINT64, self->dropped_packets,
+      "keyframe-requests", G_TYPE_UINT64, self->keyframe_requests,
+      "padding-bytes", G_TYPE_UINT64, self->padding_sent,
+      NULL);
+  g_mutex_unlock (&self->pace_lock);
+
+  return stats;
+}
+
+static void
+fs_rtp_packet_modder_set_property (GObject *object, guint prop_id,
+    const GValue *value, GParamSpec *pspec)
+{
+  FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (object);
+
+  switch (prop_id)
+  {
+    case PROP_PACING_INTERVAL:
+      g_mutex_lock (&self->pace_lock);
+      self->pace_interval = g_value_get_uint64 (value);
+      g_mutex_unlock (&self->pace_lock);
+      break;
+    case PROP_LATENCY_BUDGET:
+      g_mutex_lock (&self->pace_lock);
+      self->latency_budget = g_value_get_uint64 (value);
+      g_mutex_unlock (&self->pace_lock);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_rtp_packet_modder_get_property (GObject *object, guint prop_id,
+    GValue *value, GParamSpec *pspec)
+{
+  FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (object);
+
+  switch (prop_id)
+  {
+    case PROP_PACING_INTERVAL:
+      g_mutex_lock (&self->pace_lock);
+      g_value_set_uint64 (value, self->pace_interval);
+      g_mutex_unlock (&self->pace_lock);
+      break;
+    case PROP_LATENCY_BUDGET:
+      g_mutex_lock (&self->pace_lock);
+      g_value_set_uint64 (value, self->latency_budget);
+      g_mutex_unlock (&self->pace_lock);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, fs_rtp_packet_modder_get_stats (self));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/*
+ * @sync_func can be %NULL, then the buffers are synchronised on their own
+ * timestamps, or not at all once fs_rtp_packet_modder_set_pacing() is
+ * called.
+ */
+
 FsRtpPacketModder *
 fs_rtp_packet_modder_new (FsRtpPacketModderFunc modder_func,
     FsRtpPacketModderSyncTimeFunc sync_func,
@@ -110,7 +382,6 @@ fs_rtp_packet_modder_new (FsRtpPacketModderFunc modder_func,
   FsRtpPacketModder *self;
 
   g_return_val_if_fail (modder_func != NULL, NULL);
-  g_return_val_if_fail (sync_func != NULL, NULL);
 
   self = g_object_new (FS_TYPE_RTP_PACKET_MODDER, NULL);
 
@@ -121,6 +392,332 @@ fs_rtp_packet_modder_new (FsRtpPacketModderFunc modder_func,
   return self;
 }
 
+/**
+ * fs_rtp_packet_modder_reserve_prefix:
+ * @self: a #FsRtpPacketModder
+ * @prefix_size: the number of bytes
+ *
+ * Asks upstream, through the allocation query, to leave @prefix_size bytes
+ * free in front of the memory of each buffer, so that the
+ * #FsRtpPacketModderFunc can grow the RTP header without copying the
+ * packet.
+ */
+
+void
+fs_rtp_packet_modder_reserve_prefix (FsRtpPacketModder *self,
+    guint prefix_size)
+{
+  GST_OBJECT_LOCK (self);
+  self->prefix_size = prefix_size;
+  GST_OBJECT_UNLOCK (self);
+}
+
+/**
+ * fs_rtp_packet_modder_set_pacing:
+ * @self: a #FsRtpPacketModder
+ * @rate_func: the function returning the rate to pace at
+ * @interval: how often the queued packets are released, or 0 to keep the
+ *  #FsRtpPacketModder:pacing-interval
+ *
+ * Replaces the synchronisation on the #FsRtpPacketModderSyncTimeFunc by
+ * pacing. It must be called before the element is started.
+ */
+
+void
+fs_rtp_packet_modder_set_pacing (FsRtpPacketModder *self,
+    FsRtpPacketModderRateFunc rate_func, GstClockTime interval)
+{
+  g_mutex_lock (&self->pace_lock);
+  self->rate_func = rate_func;
+  if (interval)
+    self->pace_interval = interval;
+  g_mutex_unlock (&self->pace_lock);
+}
+
+/**
+ * fs_rtp_packet_modder_request_padding:
+ * @self: a #FsRtpPacketModder
+ * @bytes: how many bytes of padding to send, replacing the previous request
+ *
+ * Asks the pacing task to send that many bytes of padding when it has
+ * nothing else to send, within the current rate. It only works when pacing
+ * with the #FsRtpPacketModder:latency-budget set.
+ */
+
+void
+fs_rtp_packet_modder_request_padding (FsRtpPacketModder *self, guint bytes)
+{
+  g_mutex_lock (&self->pace_lock);
+  if (self->padding_bytes != bytes)
+  {
+    self->padding_bytes = bytes;
+    g_cond_broadcast (&self->pace_cond);
+  }
+  g_mutex_unlock (&self->pace_lock);
+}
+
+/*
+ * Adding a header extension to an outgoing packet
+ */
+
+/**
+ * fs_rtp_packet_modder_get_extension_size:
+ * @type: the format of the extension block
+ * @len: the length of the data of the element
+ *
+ * Returns: the size of the extension block, including its RFC 5285 header
+ *  and the padding to 32 bits, when the element is the only one in it
+ */
+
+guint
+fs_rtp_packet_modder_get_extension_size (ExtensionType type, guint len)
+{
+  if (type == EXTENSION_ONE_BYTE)
+    return 4 + GST_ROUND_UP_4 (1 + len);
+  else
+    return 4 + GST_ROUND_UP_4 (2 + len);
+}
+
+/* Writes the whole extension block, including its RFC 5285 header */
+
+static void
+write_extension (guint8 *ext, ExtensionType type, guint id,
+    const guint8 *data, guint len)
+{
+  guint ext_size = fs_rtp_packet_modder_get_extension_size (type, len);
+
+  memset (ext, 0, ext_size);
+
+  if (type == EXTENSION_ONE_BYTE)
+  {
+    GST_WRITE_UINT16_BE (ext, 0xBEDE);
+    ext[4] = (id << 4) | (len - 1);
+    memcpy (ext + 5, data, len);
+  }
+  else
+  {
+    GST_WRITE_UINT16_BE (ext, 0x1000);
+    ext[4] = id;
+    ext[5] = len;
+    memcpy (ext + 6, data, len);
+  }
+
+  GST_WRITE_UINT16_BE (ext + 2, (ext_size - 4) / 4);
+}
+
+/*
+ * Returns the length of the fixed header and the CSRCs, or 0 if the packet
+ * already has an extension or is not RTP.
+ */
+
+static gsize
+get_fixed_header_len (const guint8 *data, gsize size)
+{
+  gsize len;
+
+  if (size < 12 || (data[0] & 0xC0) != 0x80 || (data[0] & 0x10))
+    return 0;
+
+  len = 12 + (data[0] & 0x0F) * 4;
+  if (size < len)
+    return 0;
+
+  return len;
+}
+
+/*
+ * If upstream left room in front of the packet (see
+ * fs_rtp_packet_modder_reserve_prefix()), the fixed header is moved into it
+ * and the extension is written between the header and the payload, nothing
+ * is allocated or copied except the header itself.
+ */
+
+static gboolean
+add_extension_in_place (GstBuffer *buffer, ExtensionType type, guint id,
+    const guint8 *data, guint len)
+{
+  GstMemory *mem;
+  GstMapInfo map;
+  guint ext_size = fs_rtp_packet_modder_get_extension_size (type, len);
+  gsize header_len;
+
+  if (!gst_buffer_is_writable (buffer) || gst_buffer_n_memory (buffer) == 0)
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (buffer, 0);
+  if (mem->offset < ext_size || !gst_memory_is_writable (mem))
+    return FALSE;
+
+  if (!gst_memory_map (mem, &map, GST_MAP_READ))
+    return FALSE;
+  header_len = get_fixed_header_len (map.data, map.size);
+  gst_memory_unmap (mem, &map);
+
+  if (header_len == 0)
+    return FALSE;
+
+  gst_buffer_resize (buffer, -(gssize) ext_size,
+      gst_buffer_get_size (buffer) + ext_size);
+
+  mem = gst_buffer_peek_memory (buffer, 0);
+  if (!gst_memory_map (mem, &map, GST_MAP_READWRITE))
+  {
+    gst_buffer_resize (buffer, ext_size, -1);
+    return FALSE;
+  }
+
+  memmove (map.data, map.data + ext_size, header_len);
+  map.data[0] |= 0x10;
+  write_extension (map.data + header_len, type, id, data, len);
+
+  gst_memory_unmap (mem, &map);
+
+  return TRUE;
+}
+
+/*
+ * Otherwise, only the header gets a new memory, the payload memory is shared
+ * with the original buffer.
+ */
+
+static GstBuffer *
+add_extension_copy (GstBuffer *buffer, ExtensionType type, guint id,
+    const guint8 *data, guint len)
+{
+  guint8 first[12 + 15 * 4];
+  gsize header_len;
+  gsize first_size;
+  guint ext_size = fs_rtp_packet_modder_get_extension_size (type, len);
+  GstMemory *mem;
+  GstMapInfo map;
+  GstBuffer *newbuf;
+
+  first_size = gst_buffer_extract (buffer, 0, first, sizeof (first));
+  header_len = get_fixed_header_len (first, first_size);
+
+  if (header_len == 0)
+    return NULL;
+
+  mem = gst_allocator_alloc (NULL, header_len + ext_size, NULL);
+  if (!gst_memory_map (mem, &map, GST_MAP_WRITE))
+  {
+    gst_memory_unref (mem);
+    return NULL;
+  }
+  memcpy (map.data, first, header_len);
+  map.data[0] |= 0x10;
+  write_extension (map.data + header_len, type, id, data, len);
+  gst_memory_unmap (mem, &map);
+
+  newbuf = gst_buffer_copy_region (buffer,
+      GST_BUFFER_COPY_METADATA | GST_BUFFER_COPY_MEMORY, header_len, -1);
+  gst_buffer_prepend_memory (newbuf, mem);
+
+  return newbuf;
+}
+
+/*
+ * Packets that already carry extensions go through GstRTPBuffer, which
+ * knows how to append to them.
+ */
+
+static GstBuffer *
+add_extension_rtpbuffer (GstBuffer *buffer, ExtensionType type, guint id,
+    const guint8 *data, guint len)
+{
+  GstBuffer *headerbuf;
+  gsize header_size;
+  gsize new_header_size;
+  guint8 first_byte;
+  gboolean added = FALSE;
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+    return NULL;
+  header_size = gst_rtp_buffer_get_header_len (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  headerbuf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL, 0,
+      header_size);
+  headerbuf = gst_buffer_make_writable (headerbuf);
+  gst_buffer_set_size (headerbuf, header_size +
+      fs_rtp_packet_modder_get_extension_size (EXTENSION_TWO_BYTES, len));
+
+  /* The padding is at the end of the payload, hide it from GstRTPBuffer
+   * while it only sees the header */
+  gst_buffer_extract (headerbuf, 0, &first_byte, 1);
+  if (first_byte & 0x20)
+  {
+    guint8 unpadded = first_byte & ~0x20;
+    gst_buffer_fill (headerbuf, 0, &unpadded, 1);
+  }
+
+  if (!gst_rtp_buffer_map (headerbuf, GST_MAP_READWRITE, &rtpbuffer))
+  {
+    gst_buffer_unref (headerbuf);
+    return NULL;
+  }
+
+  if (type == EXTENSION_ONE_BYTE)
+    added = gst_rtp_buffer_add_extension_onebyte_header (&rtpbuffer, id,
+        data, len);
+  else if (type == EXTENSION_TWO_BYTES)
+    added = gst_rtp_buffer_add_extension_twobytes_header (&rtpbuffer, 0, id,
+        data, len);
+
+  if (!added)
+    GST_WARNING ("Could not add extension %u to RTP header buf %p", id,
+        headerbuf);
+
+  new_header_size = gst_rtp_buffer_get_header_len (&rtpbuffer);
+
+  gst_rtp_buffer_unmap (&rtpbuffer);
+  gst_buffer_set_size (headerbuf, new_header_size);
+
+  if (first_byte & 0x20)
+    gst_buffer_fill (headerbuf, 0, &first_byte, 1);
+
+  /* append_region eats a ref */
+  gst_buffer_ref (buffer);
+  return gst_buffer_append_region (headerbuf, buffer, header_size, -1);
+}
+
+/**
+ * fs_rtp_packet_modder_add_extension:
+ * @buffer: (transfer full): an RTP packet
+ * @type: the format of the extension block
+ * @id: the id of the extension element
+ * @data: the data of the extension element
+ * @len: the length of @data
+ *
+ * Adds a RFC 5285 header extension element to the packet, without copying
+ * the payload. Meant to be called from a #FsRtpPacketModderFunc.
+ *
+ * Returns: the packet with the extension, or %NULL if @buffer is not a
+ *  valid RTP packet, in which case @buffer is left untouched
+ */
+
+GstBuffer *
+fs_rtp_packet_modder_add_extension (GstBuffer *buffer, ExtensionType type,
+    guint id, const guint8 *data, guint len)
+{
+  GstBuffer *newbuf;
+
+  g_return_val_if_fail (type != EXTENSION_NONE, NULL);
+
+  if (add_extension_in_place (buffer, type, id, data, len))
+    return buffer;
+
+  newbuf = add_extension_copy (buffer, type, id, data, len);
+  if (!newbuf)
+    newbuf = add_extension_rtpbuffer (buffer, type, id, data, len);
+
+  if (newbuf)
+    gst_buffer_unref (buffer);
+
+  return newbuf;
+}
+
 static void
 fs_rtp_packet_modder_sync_to_clock (FsRtpPacketModder *self,
   GstClockTime buffer_ts)
@@ -164,6 +761,687 @@ fs_rtp_packet_modder_sync_to_clock (FsRtpPacketModder *self,
   GST_OBJECT_UNLOCK (self);
 }
 
+static void
+fs_rtp_packet_modder_refill_locked (FsRtpPacketModder *self, guint rate,
+    GstClockTime now)
+{
+  gint64 burst = gst_util_uint64_scale (rate, self->pace_interval,
+      GST_SECOND);
+
+  if (rate == 0)
+  {
+    /* Not pacing right now, start from a full bucket when it resumes */
+    self->last_refill = GST_CLOCK_TIME_NONE;
+    return;
+  }
+
+  if (!GST_CLOCK_TIME_IS_VALID (self->last_refill))
+    self->tokens = burst;
+  else if (now > self->last_refill)
+    self->tokens += gst_util_uint64_scale (rate, now - self->last_refill,
+        GST_SECOND);
+  self->last_refill = now;
+
+  if (self->tokens > burst)
+    self->tokens = burst;
+}
+
+/*
+ * The N bit of the VP8 payload descriptor (RFC 7741) or a nal_ref_idc of 0
+ * in the H.264 NAL unit header (RFC 6184), which the STAP-A and FU-A
+ * headers carry too
+ */
+
+static gboolean
+fs_rtp_packet_modder_is_non_reference (PayloadCodec codec,
+    const guint8 *payload, guint len)
+{
+  if (len < 1)
+    return FALSE;
+
+  switch (codec) {
+    case PAYLOAD_CODEC_VP8:
+      return (payload[0] & 0x20) != 0;
+    case PAYLOAD_CODEC_H264:
+      return (payload[0] & 0x1f) != 0 && (payload[0] & 0x60) == 0;
+    default:
+      return FALSE;
+  }
+}
+
+static gboolean
+fs_rtp_packet_modder_parse_packet (FsRtpPacketModder *self, QueuedPacket *qp)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+  if (!gst_rtp_buffer_map (qp->buffer, GST_MAP_READ, &rtpbuffer))
+    return FALSE;
+
+  qp->flags = GST_BUFFER_FLAGS (qp->buffer);
+  qp->ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
+  qp->rtptime = gst_rtp_buffer_get_timestamp (&rtpbuffer);
+  qp->pt = gst_rtp_buffer_get_payload_type (&rtpbuffer);
+  qp->seqnum = gst_rtp_buffer_get_seq (&rtpbuffer);
+  qp->out_seqnum = qp->seqnum;
+  qp->non_reference = fs_rtp_packet_modder_is_non_reference (
+      self->pt_codecs[qp->pt], gst_rtp_buffer_get_payload (&rtpbuffer),
+      gst_rtp_buffer_get_payload_len (&rtpbuffer));
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rtp_packet_modder_is_sending_frame_locked (FsRtpPacketModder *self,
+    QueuedPacket *qp)
+{
+  return self->has_sending_frame &&
+      SAME_FRAME (qp, self->sending_ssrc, self->sending_rtptime);
+}
+
+static SsrcSeqnums *
+fs_rtp_packet_modder_get_seqnums_locked (FsRtpPacketModder *self,
+    guint32 ssrc)
+{
+  SsrcSeqnums *seqnums = g_hash_table_lookup (self->ssrc_seqnums,
+      GUINT_TO_POINTER (ssrc));
+
+  if (!seqnums)
+  {
+    seqnums = g_slice_new0 (SsrcSeqnums);
+    seqnums->dropped = g_array_new (FALSE, FALSE, sizeof (guint16));
+    g_hash_table_insert (self->ssrc_seqnums, GUINT_TO_POINTER (ssrc),
+        seqnums);
+  }
+
+  return seqnums;
+}
+
+/* Must be called in the order the packets leave */
+
+static void
+fs_rtp_packet_modder_sending_locked (FsRtpPacketModder *self,
+    QueuedPacket *qp, GstClockTime now)
+{
+  SsrcSeqnums *seqnums;
+  guint i;
+
+  if (now > qp->queued_at && now - qp->queued_at > self->max_queue_delay)
+    self->max_queue_delay = now - qp->queued_at;
+
+  if (!qp->parsed)
+    return;
+
+  self->has_sending_frame = TRUE;
+  self->sending_ssrc = qp->ssrc;
+  self->sending_rtptime = qp->rtptime;
+  self->sending_pt = qp->pt;
+
+  seqnums = fs_rtp_packet_modder_get_seqnums_locked (self, qp->ssrc);
+
+  if (qp->padding)
+  {
+    /* The packets that follow make room for it */
+    qp->out_seqnum = seqnums->next_seqnum;
+    seqnums->offset--;
+  }
+  else
+  {
+    for (i = 0; i < seqnums->dropped->len;)
+    {
+      guint16 dropped = g_array_index (seqnums->dropped, guint16, i);
+
+      if ((gint16) (dropped - qp->seqnum) < 0)
+      {
+        seqnums->offset++;
+        g_array_remove_index_fast (seqnums->dropped, i);
+      }
+      else
+      {
+        i++;
+      }
+    }
+
+    qp->out_seqnum = qp->seqnum - seqnums->offset;
+  }
+
+  seqnums->next_seqnum = qp->out_seqnum + 1;
+}
+
+static GstBuffer *
+fs_rtp_packet_modder_renumber (FsRtpPacketModder *self, QueuedPacket *qp)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer = qp->buffer;
+
+  if (!qp->parsed || qp->out_seqnum == qp->seqnum)
+    return buffer;
+
+  buffer = gst_buffer_make_writable (buffer);
+  if (gst_rtp_buffer_map (buffer, GST_MAP_READWRITE, &rtpbuffer))
+  {
+    gst_rtp_buffer_set_seq (&rtpbuffer, qp->out_seqnum);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+  }
+
+  return buffer;
+}
+
+/* The packets of the same SSRC sent after it will take its number */
+
+static void
+fs_rtp_packet_modder_dropped_packet_locked (FsRtpPacketModder *self,
+    QueuedPacket *qp)
+{
+  SsrcSeqnums *seqnums = fs_rtp_packet_modder_get_seqnums_locked (self,
+      qp->ssrc);
+
+  g_array_append_val (seqnums->dropped, qp->seqnum);
+  self->dropped_packets++;
+}
+
+static void
+fs_rtp_packet_modder_drop_link_locked (FsRtpPacketModder *self, GList *item)
+{
+  QueuedPacket *qp = item->data;
+
+  GST_LOG_OBJECT (self, "Dropping packet %u of frame %u from %X",
+      qp->seqnum, qp->rtptime, qp->ssrc);
+
+  self->pace_queue_bytes -= qp->size;
+  fs_rtp_packet_modder_dropped_packet_locked (self, qp);
+  g_queue_delete_link (&self->pace_queue, item);
+  gst_buffer_unref (qp->buffer);
+  g_slice_free (QueuedPacket, qp);
+}
+
+/*
+ * If @incoming is part of the frame, its other packets will be dropped as
+ * they arrive
+ */
+
+static void
+fs_rtp_packet_modder_dropping_frame_locked (FsRtpPacketModder *self,
+    QueuedPacket *qp, QueuedPacket *incoming)
+{
+  GST_DEBUG_OBJECT (self, "Dropping frame %u from %X", qp->rtptime,
+      qp->ssrc);
+
+  if (SAME_FRAME (incoming, qp->ssrc, qp->rtptime))
+  {
+    self->has_dropped_frame = TRUE;
+    self->dropped_ssrc = qp->ssrc;
+    self->dropped_rtptime = qp->rtptime;
+  }
+
+  self->dropped_frames++;
+}
+
+static gboolean
+fs_rtp_packet_modder_should_request_keyframe_locked (FsRtpPacketModder *self,
+    GstClockTime now)
+{
+  if (GST_CLOCK_TIME_IS_VALID (self->last_keyframe_request) &&
+      now < self->last_keyframe_request + KEYFRAME_REQUEST_INTERVAL)
+    return FALSE;
+
+  self->last_keyframe_request = now;
+  self->keyframe_requests++;
+  return TRUE;
+}
+
+static void
+fs_rtp_packet_modder_request_keyframe (FsRtpPacketModder *self)
+{
+  GST_DEBUG_OBJECT (self, "Requesting a key unit after dropping frames");
+
+  gst_pad_push_event (self->sinkpad,
+      gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+          gst_structure_new ("GstForceKeyUnit",
+              "all-headers", G_TYPE_BOOLEAN, TRUE,
+              NULL)));
+}
+
+/*
+ * Returns %TRUE if the incoming packet belongs to a frame that is already
+ * being dropped or has to wait for the next key unit
+ */
+
+static gboolean
+fs_rtp_packet_modder_drop_incoming_locked (FsRtpPacketModder *self,
+    QueuedPacket *qp, GstClockTime now, gboolean *request_keyframe)
+{
+  if (self->has_dropped_frame &&
+      SAME_FRAME (qp, self->dropped_ssrc, self->dropped_rtptime))
+  {
+    fs_rtp_packet_modder_dropped_packet_locked (self, qp);
+    return TRUE;
+  }
+
+  /* The end of the frame being sent must follow */
+  if (!self->waiting_keyframe ||
+      fs_rtp_packet_modder_is_sending_frame_locked (self, qp))
+    return FALSE;
+
+  if (!(qp->flags & GST_BUFFER_FLAG_DELTA_UNIT))
+  {
+    GST_DEBUG_OBJECT (self, "Got a key unit, stop dropping");
+    self->waiting_keyframe = FALSE;
+    return FALSE;
+  }
+
+  fs_rtp_packet_modder_dropping_frame_locked (self, qp, qp);
+  fs_rtp_packet_modder_dropped_packet_locked (self, qp);
+  *request_keyframe = fs_rtp_packet_modder_should_request_keyframe_locked (
+      self, now);
+
+  return TRUE;
+}
+
+/*
+ * Drops whole frames until the queue can be sent within the latency budget,
+ * @incoming is the packet that was just queued. Returns %TRUE if a key unit
+ * should be requested.
+ */
+
+static gboolean
+fs_rtp_packet_modder_make_room_locked (FsRtpPacketModder *self, guint rate,
+    QueuedPacket *incoming, GstClockTime now)
+{
+  guint64 max_bytes = gst_util_uint64_scale (rate, self->latency_budget,
+      GST_SECOND);
+  gboolean in_frame = FALSE;
+  gboolean dropping = FALSE;
+  gboolean dropped_reference = FALSE;
+  guint32 frame_ssrc = 0, frame_rtptime = 0;
+  GList *item, *next;
+
+  if (self->pace_queue_bytes <= max_bytes)
+    return FALSE;
+
+  /* First the frames that nothing else depends on, oldest first */
+  for (item = self->pace_queue.head; item; item = next)
+  {
+    QueuedPacket *qp = item->data;
+
+    next = item->next;
+
+    if (!qp->parsed)
+      continue;
+
+    if (!in_frame || !SAME_FRAME (qp, frame_ssrc, frame_rtptime))
+    {
+      in_frame = TRUE;
+      frame_ssrc = qp->ssrc;
+      frame_rtptime = qp->rtptime;
+      dropping = self->pace_queue_bytes > max_bytes &&
+          ((qp->flags & GST_BUFFER_FLAG_DROPPABLE) || qp->non_reference) &&
+          !fs_rtp_packet_modder_is_sending_frame_locked (self, qp);
+      if (dropping)
+        fs_rtp_packet_modder_dropping_frame_locked (self, qp, incoming);
+    }
+
+    if (dropping)
+      fs_rtp_packet_modder_drop_link_locked (self, item);
+  }
+
+  /* Then the newest frames, the ones after them can not be decoded until
+   * the next key unit */
+  while (self->pace_queue_bytes > max_bytes && self->pace_queue.tail)
+  {
+    QueuedPacket *qp = self->pace_queue.tail->data;
+
+    if (!qp->parsed || fs_rtp_packet_modder_is_sending_frame_locked (self, qp))
+      break;
+
+    frame_ssrc = qp->ssrc;
+    frame_rtptime = qp->rtptime;
+    fs_rtp_packet_modder_dropping_frame_locked (self, qp, incoming);
+    dropped_reference = TRUE;
+
+    while (self->pace_queue.tail &&
+        ((QueuedPacket *) self->pace_queue.tail->data)->parsed &&
+        SAME_FRAME ((QueuedPacket *) self->pace_queue.tail->data,
+            frame_ssrc, frame_rtptime))
+      fs_rtp_packet_modder_drop_link_locked (self, self->pace_queue.tail);
+  }
+
+  if (!dropped_reference)
+    return FALSE;
+
+  self->waiting_keyframe = TRUE;
+  return fs_rtp_packet_modder_should_request_keyframe_locked (self, now);
+}
+
+static GstFlowReturn
+fs_rtp_packet_modder_pace (FsRtpPacketModder *self, GstBuffer *buffer)
+{
+  GstClockTime now = gst_clock_get_time (self->pace_clock);
+  guint rate = self->rate_func (self, self->user_data);
+  QueuedPacket packet = { buffer, now, gst_buffer_get_size (buffer) };
+  gboolean request_keyframe = FALSE;
+  GstFlowReturn ret;
+
+  g_mutex_lock (&self->pace_lock);
+
+  if (self->pace_flushing)
+  {
+    g_mutex_unlock (&self->pace_lock);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_FLUSHING;
+  }
+
+  if (self->latency_budget)
+  {
+    packet.parsed = fs_rtp_packet_modder_parse_packet (self, &packet);
+
+    if (packet.parsed && fs_rtp_packet_modder_drop_incoming_locked (self,
+            &packet, now, &request_keyframe))
+    {
+      g_mutex_unlock (&self->pace_lock);
+      gst_buffer_unref (buffer);
+      if (request_keyframe)
+        fs_rtp_packet_modder_request_keyframe (self);
+      return GST_FLOW_OK;
+    }
+  }
+
+  fs_rtp_packet_modder_refill_locked (self, rate, now);
+
+  if ((rate == 0 || self->tokens > 0) && !self->pace_pushing &&
+      g_queue_is_empty (&self->pace_queue))
+  {
+    /* Nothing ahead of it, no need to go through the task */
+    self->tokens -= packet.size;
+    fs_rtp_packet_modder_sending_locked (self, &packet, now);
+    g_mutex_unlock (&self->pace_lock);
+
+    buffer = fs_rtp_packet_modder_renumber (self, &packet);
+    buffer = self->modder_func (self, buffer, GST_BUFFER_TIMESTAMP (buffer),
+        self->user_data);
+    if (!buffer)
+    {
+      GST_LOG_OBJECT (self, "Got NULL from FsRtpPacketModderFunc");
+      return GST_FLOW_ERROR;
+    }
+
+    return gst_pad_push (self->srcpad, buffer);
+  }
+
+  g_queue_push_tail (&self->pace_queue, g_slice_dup (QueuedPacket, &packet));
+  self->pace_queue_bytes += packet.size;
+  if (self->latency_budget && packet.parsed && rate)
+    request_keyframe = fs_rtp_packet_modder_make_room_locked (self, rate,
+        &packet, now);
+  g_cond_broadcast (&self->pace_cond);
+
+  /* With a latency budget, the queue is kept short by dropping instead */
+  while (!self->pace_flushing && !self->latency_budget &&
+      self->pace_queue_bytes >
+      gst_util_uint64_scale (rate, PACE_MAX_QUEUE_TIME, GST_SECOND))
+    g_cond_wait (&self->pace_cond, &self->pace_lock);
+
+  if (self->pace_flushing)
+    ret = GST_FLOW_FLUSHING;
+  else
+    ret = self->pace_ret;
+
+  g_mutex_unlock (&self->pace_lock);
+
+  if (request_keyframe)
+    fs_rtp_packet_modder_request_keyframe (self);
+
+  return ret;
+}
+
+static gboolean
+fs_rtp_packet_modder_can_pad_locked (FsRtpPacketModder *self)
+{
+  return self->padding_bytes > 0 && self->has_sending_frame;
+}
+
+/*
+ * A packet of the frame being sent, with no payload, numbered after it.
+ * It can not be sent as RTX padding, the RTX streams are only made after
+ * the modder by the aux sender of rtpbin, so only the offset of the SSRC
+ * of the frame is shifted.
+ */
+
+static QueuedPacket *
+fs_rtp_packet_modder_new_padding_locked (FsRtpPacketModder *self,
+    GstClockTime now)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  QueuedPacket *qp = g_slice_new0 (QueuedPacket);
+  guint pad_len = CLAMP (self->padding_bytes, 1, MAX_PADDING_SIZE);
+  SsrcSeqnums *seqnums = fs_rtp_packet_modder_get_seqnums_locked (self,
+      self->sending_ssrc);
+
+  qp->buffer = gst_rtp_buffer_new_allocate (0, pad_len, 0);
+  gst_rtp_buffer_map (qp->buffer, GST_MAP_WRITE, &rtpbuffer);
+  gst_rtp_buffer_set_ssrc (&rtpbuffer, self->sending_ssrc);
+  gst_rtp_buffer_set_timestamp (&rtpbuffer, self->sending_rtptime);
+  gst_rtp_buffer_set_payload_type (&rtpbuffer, self->sending_pt);
+  gst_rtp_buffer_set_seq (&rtpbuffer, seqnums->next_seqnum);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  qp->queued_at = now;
+  qp->size = gst_buffer_get_size (qp->buffer);
+  qp->parsed = TRUE;
+  qp->flags = GST_BUFFER_FLAGS (qp->buffer);
+  qp->ssrc = self->sending_ssrc;
+  qp->rtptime = self->sending_rtptime;
+  qp->pt = self->sending_pt;
+  qp->seqnum = qp->out_seqnum = seqnums->next_seqnum;
+  qp->padding = TRUE;
+
+  self->padding_bytes -= MIN (self->padding_bytes, qp->size);
+  self->padding_sent += qp->size;
+
+  return qp;
+}
+
+static void
+fs_rtp_packet_modder_pace_loop (gpointer user_data)
+{
+  FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (user_data);
+  QueuedPacket *burst[PACE_MAX_BURST_PACKETS];
+  GstBufferList *list;
+  GstClockTime now;
+  GstFlowReturn ret;
+  guint rate;
+  guint count = 0;
+  guint i;
+
+  g_mutex_lock (&self->pace_lock);
+
+  while (!self->pace_flushing && g_queue_is_empty (&self->pace_queue) &&
+      !fs_rtp_packet_modder_can_pad_locked (self))
+    g_cond_wait (&self->pace_cond, &self->pace_lock);
+
+  if (self->pace_flushing)
+    goto paused;
+
+  if (self->tokens <= 0)
+  {
+    GstClockID id;
+
+    if (self->pace_clock_id &&
+        self->pace_clock_id_interval != self->pace_interval)
+    {
+      gst_clock_id_unref (self->pace_clock_id);
+      self->pace_clock_id = NULL;
+    }
+
+    if (!self->pace_clock_id)
+    {
+      self->pace_clock_id = gst_clock_new_periodic_id (self->pace_clock,
+          gst_clock_get_time (self->pace_clock) + self->pace_interval,
+          self->pace_interval);
+      self->pace_clock_id_interval = self->pace_interval;
+    }
+
+    id = gst_clock_id_ref (self->pace_clock_id);
+    g_mutex_unlock (&self->pace_lock);
+    gst_clock_id_wait (id, NULL);
+    gst_clock_id_unref (id);
+    g_mutex_lock (&self->pace_lock);
+
+    if (self->pace_flushing)
+      goto paused;
+  }
+
+  g_mutex_unlock (&self->pace_lock);
+  rate = self->rate_func (self, self->user_data);
+  now = gst_clock_get_time (self->pace_clock);
+  g_mutex_lock (&self->pace_lock);
+
+  if (self->pace_flushing)
+    goto paused;
+
+  fs_rtp_packet_modder_refill_locked (self, rate, now);
+
+  while (count < PACE_MAX_BURST_PACKETS &&
+      (rate == 0 || self->tokens > 0) &&
+      !g_queue_is_empty (&self->pace_queue))
+  {
+    burst[count] = g_queue_pop_head (&self->pace_queue);
+    self->tokens -= burst[count]->size;
+    self->pace_queue_bytes -= burst[count]->size;
+    fs_rtp_packet_modder_sending_locked (self, burst[count], now);
+    count++;
+  }
+
+  /* Padding is only sent within the pacing rate */
+  if (rate == 0)
+    self->padding_bytes = 0;
+
+  while (count < PACE_MAX_BURST_PACKETS && self->tokens > 0 &&
+      g_queue_is_empty (&self->pace_queue) &&
+      fs_rtp_packet_modder_can_pad_locked (self))
+  {
+    burst[count] = fs_rtp_packet_modder_new_padding_locked (self, now);
+    self->tokens -= burst[count]->size;
+    fs_rtp_packet_modder_sending_locked (self, burst[count], now);
+    count++;
+  }
+
+  self->pace_pushing = TRUE;
+  g_cond_broadcast (&self->pace_cond);
+  g_mutex_unlock (&self->pace_lock);
+
+  list = gst_buffer_list_new_sized (count);
+  for (i = 0; i < count; i++)
+  {
+    GstBuffer *buffer = fs_rtp_packet_modder_renumber (self, burst[i]);
+    GstClockTime buffer_ts = GST_BUFFER_TIMESTAMP (buffer);
+
+    /* Tell the modder function for how long the pacing held it back */
+    if (GST_CLOCK_TIME_IS_VALID (buffer_ts))
+      buffer_ts += now - burst[i]->queued_at;
+
+    buffer = self->modder_func (self, buffer, buffer_ts, self->user_data);
+    if (buffer)
+      gst_buffer_list_add (list, buffer);
+    else
+      GST_LOG_OBJECT (self, "Got NULL from FsRtpPacketModderFunc");
+
+    g_slice_free (QueuedPacket, burst[i]);
+  }
+
+  if (gst_buffer_list_length (list))
+  {
+    ret = gst_pad_push_list (self->srcpad, list);
+  }
+  else
+  {
+    gst_buffer_list_unref (list);
+    ret = GST_FLOW_OK;
+  }
+
+  g_mutex_lock (&self->pace_lock);
+  self->pace_pushing = FALSE;
+  if (ret != GST_FLOW_OK)
+    GST_DEBUG_OBJECT (self, "Pushing a burst returned %s",
+        gst_flow_get_name (ret));
+  self->pace_ret = ret;
+  g_cond_broadcast (&self->pace_cond);
+  g_mutex_unlock (&self->pace_lock);
+
+  return;
+
+paused:
+  g_mutex_unlock (&self->pace_lock);
+  gst_pad_pause_task (self->srcpad);
+}
+
+static void
+fs_rtp_packet_modder_set_pace_flushing (FsRtpPacketModder *self,
+    gboolean flushing)
+{
+  g_mutex_lock (&self->pace_lock);
+  self->pace_flushing = flushing;
+  if (flushing)
+  {
+    fs_rtp_packet_modder_clear_pace_queue_locked (self);
+    if (self->pace_clock_id)
+    {
+      gst_clock_id_unschedule (self->pace_clock_id);
+      gst_clock_id_unref (self->pace_clock_id);
+      self->pace_clock_id = NULL;
+    }
+  }
+  else
+  {
+    self->pace_ret = GST_FLOW_OK;
+    self->last_refill = GST_CLOCK_TIME_NONE;
+    self->has_sending_frame = FALSE;
+    self->has_dropped_frame = FALSE;
+    self->padding_bytes = 0;
+    self->waiting_keyframe = FALSE;
+    g_hash_table_remove_all (self->ssrc_seqnums);
+  }
+  g_cond_broadcast (&self->pace_cond);
+  g_mutex_unlock (&self->pace_lock);
+}
+
+/* Lets the queued packets go out before a serialized event */
+
+static void
+fs_rtp_packet_modder_drain (FsRtpPacketModder *self)
+{
+  g_mutex_lock (&self->pace_lock);
+  while (!self->pace_flushing &&
+      (self->pace_pushing || !g_queue_is_empty (&self->pace_queue)))
+    g_cond_wait (&self->pace_cond, &self->pace_lock);
+  g_mutex_unlock (&self->pace_lock);
+}
+
+static gboolean
+fs_rtp_packet_modder_src_activate_mode (GstPad *pad, GstObject *parent,
+    GstPadMode mode, gboolean active)
+{
+  FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (parent);
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  if (!self->rate_func)
+    return TRUE;
+
+  if (active)
+  {
+    fs_rtp_packet_modder_set_pace_flushing (self, FALSE);
+    return gst_pad_start_task (pad, fs_rtp_packet_modder_pace_loop, self,
+        NULL);
+  }
+  else
+  {
+    fs_rtp_packet_modder_set_pace_flushing (self, TRUE);
+    return gst_pad_stop_task (pad);
+  }
+}
+
 static GstFlowReturn
 fs_rtp_packet_modder_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
 {
@@ -171,7 +1449,10 @@ fs_rtp_packet_modder_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
   GstFlowReturn ret = GST_FLOW_ERROR;
   GstClockTime buffer_ts = GST_BUFFER_TIMESTAMP (buffer);
 
-  if (GST_CLOCK_TIME_IS_VALID (buffer_ts))
+  if (self->rate_func)
+    return fs_rtp_packet_modder_pace (self, buffer);
+
+  if (GST_CLOCK_TIME_IS_VALID (buffer_ts) && self->sync_func)
     buffer_ts = self->sync_func (self, buffer, self->user_data);
 
   if (GST_CLOCK_TIME_IS_VALID (buffer_ts))
@@ -192,6 +1473,90 @@ invalid:
   return ret;
 }
 
+struct ModifyListData {
+  FsRtpPacketModder *self;
+  GstClockTime buffer_ts;
+};
+
+static gboolean
+fs_rtp_packet_modder_modify_list_item (GstBuffer **buffer, guint idx,
+    gpointer user_data)
+{
+  struct ModifyListData *data = user_data;
+
+  *buffer = data->self->modder_func (data->self, *buffer, data->buffer_ts,
+      data->self->user_data);
+
+  if (!*buffer)
+    GST_LOG_OBJECT (data->self, "Got NULL from FsRtpPacketModderFunc");
+
+  return TRUE;
+}
+
+/*
+ * A list usually holds a whole frame, it is kept together: every packet is
+ * accounted for by the sync function, the list waits until the last one is
+ * due and then all of them are modified in one pass.
+ */
+
+static gboolean
+fs_rtp_packet_modder_sync_list_item (GstBuffer **buffer, guint idx,
+    gpointer user_data)
+{
+  struct ModifyListData *data = user_data;
+  GstClockTime buffer_ts = GST_BUFFER_TIMESTAMP (*buffer);
+
+  if (GST_CLOCK_TIME_IS_VALID (buffer_ts) && data->self->sync_func)
+    buffer_ts = data->self->sync_func (data->self, *buffer,
+        data->self->user_data);
+
+  if (GST_CLOCK_TIME_IS_VALID (buffer_ts) &&
+      (!GST_CLOCK_TIME_IS_VALID (data->buffer_ts) ||
+          buffer_ts > data->buffer_ts))
+    data->buffer_ts = buffer_ts;
+
+  return TRUE;
+}
+
+static GstFlowReturn
+fs_rtp_packet_modder_chain_list (GstPad *pad, GstObject *parent,
+    GstBufferList *list)
+{
+  FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (parent);
+  struct ModifyListData data = { self, GST_CLOCK_TIME_NONE };
+
+  if (self->rate_func)
+  {
+    GstFlowReturn ret = GST_FLOW_OK;
+    guint i;
+
+    for (i = 0; i < gst_buffer_list_length (list) && ret == GST_FLOW_OK; i++)
+      ret = fs_rtp_packet_modder_pace (self,
+          gst_buffer_ref (gst_buffer_list_get (list, i)));
+
+    gst_buffer_list_unref (list);
+    return ret;
+  }
+
+  list = gst_buffer_list_make_writable (list);
+
+  gst_buffer_list_foreach (list, fs_rtp_packet_modder_sync_list_item, &data);
+
+  if (GST_CLOCK_TIME_IS_VALID (data.buffer_ts))
+    fs_rtp_packet_modder_sync_to_clock (self, data.buffer_ts);
+
+  gst_buffer_list_foreach (list, fs_rtp_packet_modder_modify_list_item,
+      &data);
+
+  if (gst_buffer_list_length (list) == 0)
+  {
+    gst_buffer_list_unref (list);
+    return GST_FLOW_OK;
+  }
+
+  return gst_pad_push_list (self->srcpad, list);
+}
+
 
 static GstCaps *
 fs_rtp_packet_modder_getcaps (FsRtpPacketModder *self, GstPad *pad,
@@ -219,6 +1584,34 @@ fs_rtp_packet_modder_getcaps (FsRtpPacketModder *self, GstPad *pad,
   return caps;
 }
 
+/* Remembers which payload types carry a codec whose payload is parsed */
+
+static void
+fs_rtp_packet_modder_set_caps (FsRtpPacketModder *self, GstCaps *caps)
+{
+  GstStructure *s;
+  const gchar *encoding_name;
+  PayloadCodec codec = PAYLOAD_CODEC_OTHER;
+  gint pt;
+
+  if (gst_caps_get_size (caps) == 0)
+    return;
+
+  s = gst_caps_get_structure (caps, 0);
+  if (!gst_structure_get_int (s, "payload", &pt) || pt < 0 || pt > 127)
+    return;
+
+  encoding_name = gst_structure_get_string (s, "encoding-name");
+  if (!g_strcmp0 (encoding_name, "VP8"))
+    codec = PAYLOAD_CODEC_VP8;
+  else if (!g_strcmp0 (encoding_name, "H264"))
+    codec = PAYLOAD_CODEC_H264;
+
+  g_mutex_lock (&self->pace_lock);
+  self->pt_codecs[pt] = codec;
+  g_mutex_unlock (&self->pace_lock);
+}
+
 static gboolean
 fs_rtp_packet_modder_sink_event (GstPad *pad, GstObject *parent,
     GstEvent *event)
@@ -226,6 +1619,14 @@ fs_rtp_packet_modder_sink_event (GstPad *pad, GstObject *parent,
   FsRtpPacketModder *self = FS_RTP_PACKET_MODDER (parent);
 
   switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+    {
+      GstCaps *caps;
+
+      gst_event_parse_caps (event, &caps);
+      fs_rtp_packet_modder_set_caps (self, caps);
+      break;
+    }
     case GST_EVENT_SEGMENT:
     {
       gst_event_copy_segment (event, &self->segment);
@@ -242,11 +1643,34 @@ fs_rtp_packet_modder_sink_event (GstPad *pad, GstObject *parent,
         self->unscheduled = TRUE;
       }
       GST_OBJECT_UNLOCK (self);
+      if (self->rate_func)
+      {
+        gboolean ret;
+
+        fs_rtp_packet_modder_set_pace_flushing (self, TRUE);
+        ret = gst_pad_push_event (self->srcpad, event);
+        gst_pad_pause_task (self->srcpad);
+        return ret;
+      }
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      if (self->rate_func)
+      {
+        gboolean ret = gst_pad_push_event (self->srcpad, event);
+
+        fs_rtp_packet_modder_set_pace_flushing (self, FALSE);
+        gst_pad_start_task (self->srcpad, fs_rtp_packet_modder_pace_loop,
+            self, NULL);
+        return ret;
+      }
       break;
     default:
       break;
   }
 
+  if (self->rate_func && GST_EVENT_IS_SERIALIZED (event))
+    fs_rtp_packet_modder_drain (self);
+
   return gst_pad_push_event (self->srcpad, event);
 
 newseg_wrong_format:
@@ -352,6 +1776,42 @@ fs_rtp_packet_modder_query (GstPad *pad, GstObject *parent, GstQuery *query)
       }
       break;
     }
+    case GST_QUERY_ALLOCATION:
+    {
+      guint prefix_size;
+      GstAllocationParams params;
+      GstAllocator *allocator;
+      guint i;
+
+      res = gst_pad_query_default (pad, parent, query);
+
+      GST_OBJECT_LOCK (self);
+      prefix_size = self->prefix_size;
+      GST_OBJECT_UNLOCK (self);
+
+      if (pad != self->sinkpad || prefix_size == 0)
+        break;
+
+      if (gst_query_get_n_allocation_params (query) == 0)
+      {
+        gst_allocation_params_init (&params);
+        gst_query_add_allocation_param (query, NULL, &params);
+      }
+
+      for (i = 0; i < gst_query_get_n_allocation_params (query); i++)
+      {
+        gst_query_parse_nth_allocation_param (query, i, &allocator, &params);
+        params.prefix = MAX (params.prefix, prefix_size);
+        gst_query_set_nth_allocation_param (query, i, allocator, &params);
+        if (allocator)
+          gst_object_unref (allocator);
+      }
+
+      GST_DEBUG_OBJECT (self, "Asked upstream for %u bytes of prefix",
+          prefix_size);
+      res = TRUE;
+      break;
+    }
     default:
       res = gst_pad_query_default (pad, parent, query);
       break;
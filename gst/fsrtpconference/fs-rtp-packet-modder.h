@@ -46,6 +46,13 @@ G_BEGIN_DECLS
 typedef struct _FsRtpPacketModder          FsRtpPacketModder;
 typedef struct _FsRtpPacketModderClass     FsRtpPacketModderClass;
 
+/* The formats of RFC 5285 header extension blocks */
+typedef enum {
+  EXTENSION_NONE,
+  EXTENSION_ONE_BYTE,
+  EXTENSION_TWO_BYTES
+} ExtensionType;
+
 
 typedef GstBuffer *(*FsRtpPacketModderFunc) (FsRtpPacketModder *modder,
     GstBuffer *buffer, GstClockTime sync_time, gpointer user_data);
@@ -53,6 +60,10 @@ typedef GstBuffer *(*FsRtpPacketModderFunc) (FsRtpPacketModder *modder,
 typedef GstClockTime (*FsRtpPacketModderSyncTimeFunc) (
   FsRtpPacketModder *modder, GstBuffer *buffer, gpointer user_data);
 
+/* Returns the rate at which to pace the packets in bytes/sec, 0 to not pace */
+typedef guint (*FsRtpPacketModderRateFunc) (FsRtpPacketModder *modder,
+    gpointer user_data);
+
 /**
  * FsRtpPacketModder:
  *
@@ -68,6 +79,50 @@ struct _FsRtpPacketModder {
   FsRtpPacketModderSyncTimeFunc sync_func;
   gpointer user_data;
 
+  /* bytes upstream should leave free in front of each buffer,
+   * protected by the object lock */
+  guint prefix_size;
+
+  /* for pacing, everything below is protected by the pace_lock */
+  FsRtpPacketModderRateFunc rate_func;
+  GMutex pace_lock;
+  GCond pace_cond;
+  GstClockTime pace_interval;
+  GstClock *pace_clock;
+  GstClockID pace_clock_id;
+  GstClockTime pace_clock_id_interval;
+  /* of queued packets, oldest first */
+  GQueue pace_queue;
+  guint64 pace_queue_bytes;
+  gint64 tokens;
+  GstClockTime last_refill;
+  gboolean pace_flushing;
+  gboolean pace_pushing;
+  GstFlowReturn pace_ret;
+
+  /* for dropping frames over the latency budget, also under the pace_lock */
+  GstClockTime latency_budget;
+  gboolean has_sending_frame;
+  guint32 sending_ssrc;
+  guint32 sending_rtptime;
+  guint8 sending_pt;
+  /* payload type -> PayloadCodec, from the caps */
+  guint8 pt_codecs[128];
+  gboolean has_dropped_frame;
+  guint32 dropped_ssrc;
+  guint32 dropped_rtptime;
+  gboolean waiting_keyframe;
+  GstClockTime last_keyframe_request;
+  /* SSRC -> how its sequence numbers are rewritten */
+  GHashTable *ssrc_seqnums;
+  guint64 dropped_frames;
+  guint64 dropped_packets;
+  guint64 keyframe_requests;
+  GstClockTime max_queue_delay;
+  /* padding still to send in the gaps of the frame being sent */
+  guint padding_bytes;
+  guint64 padding_sent;
+
   /* for sync */
   GstSegment segment;
   GstClockID clock_id;
@@ -88,6 +143,20 @@ FsRtpPacketModder *fs_rtp_packet_modder_new (
   FsRtpPacketModderSyncTimeFunc sync_func,
   gpointer user_data);
 
+void fs_rtp_packet_modder_reserve_prefix (FsRtpPacketModder *self,
+    guint prefix_size);
+
+void fs_rtp_packet_modder_set_pacing (FsRtpPacketModder *self,
+    FsRtpPacketModderRateFunc rate_func, GstClockTime interval);
+
+void fs_rtp_packet_modder_request_padding (FsRtpPacketModder *self,
+    guint bytes);
+
+guint fs_rtp_packet_modder_get_extension_size (ExtensionType type,
+    guint len);
+
+GstBuffer *fs_rtp_packet_modder_add_extension (GstBuffer *buffer,
+    ExtensionType type, guint id, const guint8 *data, guint len);
 
 G_END_DECLS
 
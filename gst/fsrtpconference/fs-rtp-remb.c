@@ -0,0 +1,606 @@
+/*
+ * Farstream - Farstream RTP REMB Support
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-remb.c - Receiver estimated maximum bitrate for Farstream RTP
+ *  sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-remb.h"
+
+#include <string.h>
+
+#include "fs-rtp-codec-negotiation.h"
+
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+/*
+ * draft-alvestrand-rmcat-remb-03: a payload-specific feedback message with
+ * FMT 15, whose FCI is "REMB", the number of SSRCs, the bitrate as a 6 bits
+ * exponent and 18 bits mantissa, then the SSRCs it applies to.
+ */
+
+#define REMB_FMT (15)
+#define REMB_HEADER_SIZE (8)
+#define REMB_MAX_MANTISSA (0x3FFFF)
+
+/* The estimate of a receiver that stopped sending them is forgotten */
+#define RECEIVER_TIMEOUT (5 * 1000 * 1000)
+
+#define ONE_32BIT_CYCLE ((guint64) (((guint64)0xffffffff) + ((guint64)1)))
+
+GST_DEBUG_CATEGORY_STATIC (fsrtpconference_remb);
+#define GST_CAT_DEFAULT fsrtpconference_remb
+
+G_DEFINE_TYPE (FsRtpRemb, fs_rtp_remb, FS_TYPE_RTP_CONGESTION_CONTROL);
+
+/* props */
+enum
+{
+  PROP_0,
+  PROP_BITRATE,
+  PROP_SENDING
+};
+
+struct RemoteSource {
+  GccRemoteEstimator *estimator;
+  guint64 ext_ts;
+  guint bitrate;
+  gboolean send_remb;
+};
+
+struct Receiver {
+  guint bitrate;
+  guint64 last_remb;
+};
+
+static void fs_rtp_remb_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec);
+static void fs_rtp_remb_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec);
+static void fs_rtp_remb_dispose (GObject *object);
+static void fs_rtp_remb_destroy (FsRtpCongestionControl *cc);
+static void fs_rtp_remb_codecs_updated (FsRtpCongestionControl *cc,
+    GList *codec_associations,
+    GList *header_extensions);
+static gboolean fs_rtp_remb_is_enabled (FsRtpCongestionControl *cc,
+    guint pt);
+
+static void
+fs_rtp_remb_class_init (FsRtpRembClass *klass)
+{
+  GObjectClass *gobject_class;
+  FsRtpCongestionControlClass *cc_class;
+
+  gobject_class = (GObjectClass *) klass;
+  cc_class = (FsRtpCongestionControlClass *) klass;
+
+  gobject_class->get_property = fs_rtp_remb_get_property;
+  gobject_class->set_property = fs_rtp_remb_set_property;
+  gobject_class->dispose = fs_rtp_remb_dispose;
+
+  cc_class->destroy = fs_rtp_remb_destroy;
+  cc_class->codecs_updated = fs_rtp_remb_codecs_updated;
+  cc_class->is_enabled = fs_rtp_remb_is_enabled;
+
+  g_object_class_override_property (gobject_class, PROP_BITRATE, "bitrate");
+  g_object_class_override_property (gobject_class, PROP_SENDING, "sending");
+}
+
+static void
+remote_source_free (struct RemoteSource *src)
+{
+  gcc_remote_estimator_free (src->estimator);
+  g_slice_free (struct RemoteSource, src);
+}
+
+static void
+receiver_free (struct Receiver *receiver)
+{
+  g_slice_free (struct Receiver, receiver);
+}
+
+static void
+fs_rtp_remb_init (FsRtpRemb *self)
+{
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_remb,
+      "fsrtpconference_remb", 0,
+      "Farstream RTP Conference Element REMB logic");
+
+  /* member init */
+
+  self->remote_sources = g_hash_table_new_full (g_direct_hash,
+      g_direct_equal, NULL, (GDestroyNotify) remote_source_free);
+  self->receivers = g_hash_table_new_full (g_direct_hash,
+      g_direct_equal, NULL, (GDestroyNotify) receiver_free);
+
+  memset (self->clock_rates, 0, sizeof (self->clock_rates));
+
+  self->systemclock = gst_system_clock_obtain ();
+}
+
+static void
+fs_rtp_remb_destroy (FsRtpCongestionControl *cc)
+{
+  FsRtpRemb *self = FS_RTP_REMB (cc);
+
+  GST_OBJECT_LOCK (self);
+
+  if (self->in_rtp_probe_id)
+    gst_pad_remove_probe (self->in_rtp_pad, self->in_rtp_probe_id);
+  self->in_rtp_probe_id = 0;
+  if (self->in_rtcp_probe_id)
+    gst_pad_remove_probe (self->in_rtcp_pad, self->in_rtcp_probe_id);
+  self->in_rtcp_probe_id = 0;
+
+  if (self->on_sending_rtcp_id)
+    g_signal_handler_disconnect (self->rtpsession, self->on_sending_rtcp_id);
+  self->on_sending_rtcp_id = 0;
+  if (self->on_bye_ssrc_id)
+    g_signal_handler_disconnect (self->rtpsession, self->on_bye_ssrc_id);
+  self->on_bye_ssrc_id = 0;
+  if (self->on_timeout_id)
+    g_signal_handler_disconnect (self->rtpsession, self->on_timeout_id);
+  self->on_timeout_id = 0;
+
+  g_hash_table_remove_all (self->remote_sources);
+  g_hash_table_remove_all (self->receivers);
+
+  self->fsrtpsession = NULL;
+
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+fs_rtp_remb_dispose (GObject *object)
+{
+  FsRtpRemb *self = FS_RTP_REMB (object);
+
+  GST_OBJECT_LOCK (self);
+
+  if (self->remote_sources)
+    g_hash_table_destroy (self->remote_sources);
+  self->remote_sources = NULL;
+  if (self->receivers)
+    g_hash_table_destroy (self->receivers);
+  self->receivers = NULL;
+
+  if (self->rtpsession)
+    g_object_unref (self->rtpsession);
+  self->rtpsession = NULL;
+  if (self->in_rtp_pad)
+    g_object_unref (self->in_rtp_pad);
+  self->in_rtp_pad = NULL;
+  if (self->in_rtcp_pad)
+    g_object_unref (self->in_rtcp_pad);
+  self->in_rtcp_pad = NULL;
+
+  if (self->systemclock)
+    gst_object_unref (self->systemclock);
+  self->systemclock = NULL;
+
+  GST_OBJECT_UNLOCK (self);
+
+  if (G_OBJECT_CLASS (fs_rtp_remb_parent_class)->dispose)
+    G_OBJECT_CLASS (fs_rtp_remb_parent_class)->dispose (object);
+}
+
+
+static void
+fs_rtp_remb_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  FsRtpRemb *self = FS_RTP_REMB (object);
+
+  switch (prop_id)
+  {
+    case PROP_BITRATE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->send_bitrate);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_rtp_remb_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  FsRtpRemb *self = FS_RTP_REMB (object);
+
+  switch (prop_id)
+  {
+    case PROP_SENDING:
+      GST_OBJECT_LOCK (self);
+      self->sending = g_value_get_boolean (value);
+      if (!self->sending)
+      {
+        g_hash_table_remove_all (self->receivers);
+        self->send_bitrate = 0;
+      }
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static guint64
+fs_rtp_remb_get_now (FsRtpRemb *self)
+{
+  return GST_TIME_AS_USECONDS (gst_clock_get_time (self->systemclock));
+}
+
+/* The lowest of the recent estimates, the sender has to fit them all */
+
+static gboolean
+fs_rtp_remb_update_bitrate_locked (FsRtpRemb *self, guint64 now)
+{
+  GHashTableIter iter;
+  struct Receiver *receiver;
+  guint new_bitrate = 0;
+  gboolean ret;
+
+  g_hash_table_iter_init (&iter, self->receivers);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &receiver))
+  {
+    if (now - receiver->last_remb > RECEIVER_TIMEOUT)
+      g_hash_table_iter_remove (&iter);
+    else if (new_bitrate == 0 || receiver->bitrate < new_bitrate)
+      new_bitrate = receiver->bitrate;
+  }
+
+  ret = self->send_bitrate != new_bitrate;
+
+  if (ret)
+    GST_DEBUG_OBJECT (self, "Send rate changed: %u -> %u",
+        self->send_bitrate, new_bitrate);
+
+  self->send_bitrate = new_bitrate;
+
+  /* Without any estimate left, the session keeps its bitrate */
+  return ret && new_bitrate != 0;
+}
+
+static void
+rtpsession_source_gone (GObject *rtpsession, GObject *rtpsource,
+    FsRtpRemb *self)
+{
+  guint32 ssrc;
+  gboolean notify;
+
+  g_object_get (rtpsource, "ssrc", &ssrc, NULL);
+
+  GST_OBJECT_LOCK (self);
+  g_hash_table_remove (self->remote_sources, GUINT_TO_POINTER (ssrc));
+  g_hash_table_remove (self->receivers, GUINT_TO_POINTER (ssrc));
+  notify = fs_rtp_remb_update_bitrate_locked (self, fs_rtp_remb_get_now (self));
+  GST_OBJECT_UNLOCK (self);
+
+  if (notify)
+    g_object_notify (G_OBJECT (self), "bitrate");
+}
+
+struct SendingRtcpData {
+  GstRTCPBuffer rtcpbuffer;
+  guint32 ssrc;
+  gboolean ret;
+};
+
+static void
+remote_sources_process (gpointer key, gpointer value, gpointer user_data)
+{
+  struct SendingRtcpData *data = user_data;
+  struct RemoteSource *src = value;
+  GstRTCPPacket packet;
+  guint8 *fci;
+  guint exp = 0;
+
+  if (!src->send_remb)
+    return;
+
+  if (!gst_rtcp_buffer_add_packet (&data->rtcpbuffer, GST_RTCP_TYPE_PSFB,
+          &packet))
+    return;
+
+  if (!gst_rtcp_packet_fb_set_fci_length (&packet, 3))
+  {
+    gst_rtcp_packet_remove (&packet);
+    return;
+  }
+
+  while ((src->bitrate >> exp) > REMB_MAX_MANTISSA)
+    exp++;
+
+  gst_rtcp_packet_fb_set_type (&packet, REMB_FMT);
+  gst_rtcp_packet_fb_set_sender_ssrc (&packet, data->ssrc);
+  gst_rtcp_packet_fb_set_media_ssrc (&packet, 0);
+  fci = gst_rtcp_packet_fb_get_fci (&packet);
+
+  memcpy (fci, "REMB", 4);
+  fci[4] = 1;
+  GST_WRITE_UINT24_BE (fci + 5, (exp << 18) | (src->bitrate >> exp));
+  GST_WRITE_UINT32_BE (fci + 8, GPOINTER_TO_UINT (key));
+
+  GST_LOG ("Sending REMB of %u bits/s for %X", src->bitrate,
+      GPOINTER_TO_UINT (key));
+
+  src->send_remb = FALSE;
+  data->ret = TRUE;
+}
+
+static gboolean
+rtpsession_sending_rtcp (GObject *rtpsession, GstBuffer *buffer,
+    gboolean is_early, FsRtpRemb *self)
+{
+  struct SendingRtcpData data = {GST_RTCP_BUFFER_INIT};
+
+  g_object_get (self->rtpsession, "internal-ssrc", &data.ssrc, NULL);
+  data.ret = FALSE;
+
+  gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &data.rtcpbuffer);
+
+  GST_OBJECT_LOCK (self);
+  g_hash_table_foreach (self->remote_sources, remote_sources_process, &data);
+  GST_OBJECT_UNLOCK (self);
+
+  gst_rtcp_buffer_unmap (&data.rtcpbuffer);
+
+  /* Return TRUE if something was added */
+  return data.ret;
+}
+
+static GstPadProbeReturn
+incoming_rtp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpRemb *self = FS_RTP_REMB (user_data);
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  struct RemoteSource *src;
+  guint32 ssrc, ts;
+  guint clock_rate;
+  guint64 now;
+  guint8 pt;
+  gboolean send_rtcp = FALSE;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+    return GST_PAD_PROBE_OK;
+
+  ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
+  pt = gst_rtp_buffer_get_payload_type (&rtpbuffer);
+  ts = gst_rtp_buffer_get_timestamp (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  GST_OBJECT_LOCK (self);
+
+  if (!self->fsrtpsession)
+    goto out;
+
+  clock_rate = self->clock_rates[pt];
+  if (clock_rate == 0)
+    goto out;
+
+  src = g_hash_table_lookup (self->remote_sources, GUINT_TO_POINTER (ssrc));
+  if (!src)
+  {
+    src = g_slice_new0 (struct RemoteSource);
+    src->estimator = gcc_remote_estimator_new ();
+    /* Leave room below for the reordered ones */
+    src->ext_ts = ONE_32BIT_CYCLE + ts;
+    g_hash_table_insert (self->remote_sources, GUINT_TO_POINTER (ssrc), src);
+  }
+  else
+  {
+    src->ext_ts += (gint32) (ts - (guint32) src->ext_ts);
+  }
+
+  now = fs_rtp_remb_get_now (self);
+
+  /* The packets of a frame share the timestamp of its capture, it is the
+   * best guess of when they were sent */
+  gcc_remote_estimator_got_packet (src->estimator, now,
+      gst_util_uint64_scale_int (src->ext_ts, 1000 * 1000, clock_rate),
+      gst_buffer_get_size (buffer));
+
+  src->bitrate = gcc_remote_estimator_get_report (src->estimator, now);
+  if (src->bitrate)
+    send_rtcp = src->send_remb = TRUE;
+
+out:
+  GST_OBJECT_UNLOCK (self);
+
+  if (send_rtcp)
+    g_signal_emit_by_name (self->rtpsession, "send-rtcp", (guint64) 0);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+incoming_rtcp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpRemb *self = FS_RTP_REMB (user_data);
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstRTCPBuffer rtcpbuffer = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  gboolean notify = FALSE;
+
+  if (!gst_rtcp_buffer_validate (buffer))
+    return GST_PAD_PROBE_OK;
+
+  gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcpbuffer);
+
+  if (!gst_rtcp_buffer_get_first_packet (&rtcpbuffer, &packet))
+    goto out;
+
+  do {
+    if (gst_rtcp_packet_get_type (&packet) == GST_RTCP_TYPE_PSFB &&
+        gst_rtcp_packet_fb_get_type (&packet) == REMB_FMT &&
+        gst_rtcp_packet_fb_get_fci_length (&packet) >= 3)
+    {
+      guint8 *fci = gst_rtcp_packet_fb_get_fci (&packet);
+      guint fci_size = gst_rtcp_packet_fb_get_fci_length (&packet) * 4;
+      guint32 sender_ssrc;
+      guint32 local_ssrc;
+      guint num_ssrc;
+      guint64 bitrate;
+      struct Receiver *receiver;
+      guint i;
+
+      if (memcmp (fci, "REMB", 4))
+        continue;
+
+      num_ssrc = fci[4];
+      if (REMB_HEADER_SIZE + num_ssrc * 4 > fci_size)
+        continue;
+
+      g_object_get (self->rtpsession, "internal-ssrc", &local_ssrc, NULL);
+
+      for (i = 0; i < num_ssrc; i++)
+        if (GST_READ_UINT32_BE (fci + REMB_HEADER_SIZE + i * 4) ==
+            local_ssrc)
+          break;
+      if (i == num_ssrc)
+        continue;
+
+      bitrate = (guint64) (GST_READ_UINT24_BE (fci + 5) & REMB_MAX_MANTISSA)
+          << (fci[5] >> 2);
+      bitrate = MIN (bitrate, G_MAXUINT);
+      sender_ssrc = gst_rtcp_packet_fb_get_sender_ssrc (&packet);
+
+      GST_LOG_OBJECT (self, "Got REMB of %" G_GUINT64_FORMAT " bits/s"
+          " from %X", bitrate, sender_ssrc);
+
+      GST_OBJECT_LOCK (self);
+
+      if (!self->fsrtpsession || !self->sending || bitrate == 0)
+        goto done;
+
+      receiver = g_hash_table_lookup (self->receivers,
+          GUINT_TO_POINTER (sender_ssrc));
+      if (!receiver)
+      {
+        receiver = g_slice_new0 (struct Receiver);
+        g_hash_table_insert (self->receivers, GUINT_TO_POINTER (sender_ssrc),
+            receiver);
+      }
+      receiver->bitrate = bitrate;
+      receiver->last_remb = fs_rtp_remb_get_now (self);
+
+      if (fs_rtp_remb_update_bitrate_locked (self, receiver->last_remb))
+        notify = TRUE;
+
+    done:
+      GST_OBJECT_UNLOCK (self);
+    }
+  } while (gst_rtcp_packet_move_to_next (&packet));
+
+  if (notify)
+    g_object_notify (G_OBJECT (self), "bitrate");
+
+out:
+
+  gst_rtcp_buffer_unmap (&rtcpbuffer);
+
+  return GST_PAD_PROBE_OK;
+}
+
+
+FsRtpRemb *
+fs_rtp_remb_new (FsRtpSession *fsrtpsession)
+{
+  FsRtpRemb *self;
+
+  g_return_val_if_fail (fsrtpsession, NULL);
+
+  self = g_object_new (FS_TYPE_RTP_REMB, NULL);
+
+  self->fsrtpsession = fsrtpsession;
+  self->sending = FALSE;
+
+  self->rtpsession = fs_rtp_session_get_rtpbin_internal_session (fsrtpsession);
+  self->in_rtp_pad = fs_rtp_session_get_rtpbin_recv_rtp_sink (fsrtpsession);
+  self->in_rtcp_pad = fs_rtp_session_get_rtpbin_recv_rtcp_sink (fsrtpsession);
+
+  self->in_rtp_probe_id = gst_pad_add_probe (self->in_rtp_pad,
+      GST_PAD_PROBE_TYPE_BUFFER, incoming_rtp_probe, self, NULL);
+  self->in_rtcp_probe_id = gst_pad_add_probe (self->in_rtcp_pad,
+      GST_PAD_PROBE_TYPE_BUFFER, incoming_rtcp_probe, self, NULL);
+
+  self->on_sending_rtcp_id = g_signal_connect_object (self->rtpsession,
+      "on-sending-rtcp", G_CALLBACK (rtpsession_sending_rtcp), self, 0);
+  self->on_bye_ssrc_id = g_signal_connect_object (self->rtpsession,
+      "on-bye-ssrc", G_CALLBACK (rtpsession_source_gone), self, 0);
+  self->on_timeout_id = g_signal_connect_object (self->rtpsession,
+      "on-timeout", G_CALLBACK (rtpsession_source_gone), self, 0);
+
+  return self;
+}
+
+static void
+fs_rtp_remb_codecs_updated (FsRtpCongestionControl *cc,
+    GList *codec_associations,
+    GList *header_extensions)
+{
+  FsRtpRemb *self = FS_RTP_REMB (cc);
+  GList *item;
+
+  GST_OBJECT_LOCK (self);
+
+  memset (self->clock_rates, 0, sizeof (self->clock_rates));
+  for (item = codec_associations; item; item = item->next)
+  {
+    CodecAssociation *ca = item->data;
+
+    if (fs_codec_get_feedback_parameter (ca->codec, "goog-remb", NULL, NULL))
+      self->clock_rates[ca->codec->id] = ca->codec->clock_rate;
+  }
+
+  GST_OBJECT_UNLOCK (self);
+}
+
+
+static gboolean
+fs_rtp_remb_is_enabled (FsRtpCongestionControl *cc, guint pt)
+{
+  FsRtpRemb *self = FS_RTP_REMB (cc);
+  gboolean is_enabled;
+
+  /* Only once there is an estimate to follow */
+  GST_OBJECT_LOCK (self);
+  is_enabled = self->clock_rates[pt] != 0 && self->send_bitrate != 0;
+  GST_OBJECT_UNLOCK (self);
+
+  return is_enabled;
+}
@@ -0,0 +1,105 @@
+/*
+ * Farstream - Farstream RTP REMB Support
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-remb.h - Receiver estimated maximum bitrate for Farstream RTP
+ *  sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef __FS_RTP_REMB_H__
+#define __FS_RTP_REMB_H__
+
+#include <gst/gst.h>
+
+#include "gcc.h"
+
+#include "fs-rtp-session.h"
+#include "fs-rtp-congestion-control.h"
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_RTP_REMB \
+  (fs_rtp_remb_get_type ())
+#define FS_RTP_REMB(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_RTP_REMB, FsRtpRemb))
+#define FS_RTP_REMB_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_RTP_REMB, FsRtpRembClass))
+#define FS_IS_RTP_REMB(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_RTP_REMB))
+#define FS_IS_RTP_REMB_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_RTP_REMB))
+#define FS_RTP_REMB_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), FS_TYPE_RTP_REMB, FsRtpRembClass))
+#define FS_RTP_REMB_CAST(obj) ((FsRtpRemb *) (obj))
+
+typedef struct _FsRtpRemb FsRtpRemb;
+typedef struct _FsRtpRembClass FsRtpRembClass;
+
+/**
+ * FsRtpRemb:
+ *
+ * Estimates the bitrate each remote source can send at from the arrival
+ * of its packets and tells it with RTCP REMB messages, and follows the
+ * REMB messages sent about the local source.
+ */
+struct _FsRtpRemb
+{
+  FsRtpCongestionControl parent;
+
+  GstClock *systemclock;
+
+  FsRtpSession *fsrtpsession;
+  GObject *rtpsession;
+
+  GstPad *in_rtp_pad;
+  GstPad *in_rtcp_pad;
+
+  gulong in_rtp_probe_id;
+  gulong in_rtcp_probe_id;
+
+  gulong on_sending_rtcp_id;
+  gulong on_bye_ssrc_id;
+  gulong on_timeout_id;
+
+  /* Receiver stuff, of the remote sources */
+  GHashTable *remote_sources;
+
+  /* Sender stuff, the last estimate of each receiver */
+  GHashTable *receivers;
+  gboolean sending;
+  guint send_bitrate;
+
+  /* 0 if goog-remb was not negotiated for the payload type */
+  guint clock_rates[128];
+};
+
+struct _FsRtpRembClass
+{
+  FsRtpCongestionControlClass parent_class;
+};
+
+
+GType fs_rtp_remb_get_type (void);
+
+FsRtpRemb *fs_rtp_remb_new (FsRtpSession *fsrtpsession);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_REMB_H__ */
@@ -0,0 +1,548 @@
+/*
+ * Farstream - Farstream RTP Retransmission
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-retransmission.c - Retransmits the lost packets in a separate RTX
+ *  stream when the receiver sends a generic NACK
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-retransmission.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fs-rtp-codec-negotiation.h"
+
+#define GST_CAT_DEFAULT fsrtpconference_debug
+GST_DEBUG_CATEGORY_EXTERN (fsrtpconference_debug);
+
+/*
+ * When the "nack" feedback parameter is negotiated for a codec along with
+ * an "rtx" codec whose "apt" parameter is its payload type (RFC 4588), the
+ * packets that were sent are kept for a while by a rtprtxsend element, and
+ * sent again in the RTX stream when a NACK asks for them. On the receiving
+ * side, the jitterbuffers ask for the missing packets and a rtprtxreceive
+ * element turns the RTX packets back into the original ones.
+ *
+ * Both elements are the auxiliary sender and receiver of the rtpbin
+ * session. A retransmission is only useful if it arrives before the
+ * receiver gives up on the packet, which is about an RTT after it was sent,
+ * a bit later if the receiver waits for reordered packets and twice that if
+ * the retransmission is lost too. So the history is bounded to a few RTTs,
+ * as measured by the RTCP receiver reports.
+ */
+
+/* in milliseconds */
+#define HISTORY_MARGIN (50)
+#define MIN_HISTORY_TIME (100)
+#define MAX_HISTORY_TIME (1000)
+#define HISTORY_RTTS (3)
+
+/* Even at very high bitrates, a second of video is not kept */
+#define MAX_HISTORY_PACKETS (1024)
+
+struct _FsRtpRetransmissionClass
+{
+  GstObjectClass parent_class;
+};
+
+struct _FsRtpRetransmission
+{
+  GstObject parent;
+
+  guint session_id;
+
+  /* Both NULL if the elements are not installed */
+  GstElement *aux_sender;
+  GstElement *aux_receiver;
+  GstElement *rtxsend;
+  GstElement *rtxreceive;
+
+  GObject *rtpbin_internal_session;
+  gulong new_jitterbuffer_id;
+  GstElement *rtpbin;
+
+  /* Everything below is protected by the object lock */
+
+  /* Weak references to the jitterbuffers of the session */
+  GList *jitterbuffers;
+
+  gboolean sending;
+  gboolean receiving;
+
+  /* in microseconds, 0 if unknown */
+  guint rtt;
+  guint history_time;
+};
+
+
+G_DEFINE_TYPE (FsRtpRetransmission, fs_rtp_retransmission, GST_TYPE_OBJECT);
+
+static void fs_rtp_retransmission_dispose (GObject *obj);
+
+static void
+fs_rtp_retransmission_class_init (FsRtpRetransmissionClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->dispose = fs_rtp_retransmission_dispose;
+}
+
+static void
+fs_rtp_retransmission_init (FsRtpRetransmission *self)
+{
+  self->history_time = MAX_HISTORY_TIME;
+}
+
+static void
+jitterbuffer_gone (gpointer user_data, GObject *where_the_object_was)
+{
+  FsRtpRetransmission *self = FS_RTP_RETRANSMISSION (user_data);
+
+  GST_OBJECT_LOCK (self);
+  self->jitterbuffers = g_list_remove (self->jitterbuffers,
+      where_the_object_was);
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+fs_rtp_retransmission_dispose (GObject *obj)
+{
+  FsRtpRetransmission *self = FS_RTP_RETRANSMISSION (obj);
+  GList *item;
+
+  GST_OBJECT_LOCK (self);
+  for (item = self->jitterbuffers; item; item = item->next)
+    g_object_weak_unref (item->data, jitterbuffer_gone, self);
+  g_list_free (self->jitterbuffers);
+  self->jitterbuffers = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  if (self->new_jitterbuffer_id)
+    g_signal_handler_disconnect (self->rtpbin, self->new_jitterbuffer_id);
+  self->new_jitterbuffer_id = 0;
+
+  g_clear_object (&self->rtpbin);
+  g_clear_object (&self->rtpbin_internal_session);
+  g_clear_object (&self->rtxsend);
+  g_clear_object (&self->rtxreceive);
+  g_clear_object (&self->aux_sender);
+  g_clear_object (&self->aux_receiver);
+
+  G_OBJECT_CLASS (fs_rtp_retransmission_parent_class)->dispose (obj);
+}
+
+/*
+ * rtpbin wants the auxiliary elements to have a sink_%u and a src_%u pad
+ * named after the session id
+ */
+
+static GstElement *
+make_aux_bin (const gchar *factory_name, const gchar *prefix,
+    guint session_id, GstElement **element)
+{
+  GstElement *bin;
+  GstPad *pad;
+  gchar *name;
+
+  *element = gst_element_factory_make (factory_name, NULL);
+  if (!*element)
+  {
+    GST_WARNING ("Could not make %s, retransmissions are disabled",
+        factory_name);
+    return NULL;
+  }
+
+  name = g_strdup_printf ("%s_%u", prefix, session_id);
+  bin = gst_bin_new (name);
+  g_free (name);
+  gst_object_ref_sink (bin);
+
+  gst_object_ref (*element);
+  gst_bin_add (GST_BIN (bin), *element);
+
+  pad = gst_element_get_static_pad (*element, "sink");
+  name = g_strdup_printf ("sink_%u", session_id);
+  gst_element_add_pad (bin, gst_ghost_pad_new (name, pad));
+  g_free (name);
+  gst_object_unref (pad);
+
+  pad = gst_element_get_static_pad (*element, "src");
+  name = g_strdup_printf ("src_%u", session_id);
+  gst_element_add_pad (bin, gst_ghost_pad_new (name, pad));
+  g_free (name);
+  gst_object_unref (pad);
+
+  return bin;
+}
+
+FsRtpRetransmission *
+fs_rtp_retransmission_new (guint session_id)
+{
+  FsRtpRetransmission *self = g_object_new (FS_TYPE_RTP_RETRANSMISSION,
+      NULL);
+
+  self->session_id = session_id;
+
+  self->aux_sender = make_aux_bin ("rtprtxsend", "rtx_send", session_id,
+      &self->rtxsend);
+  if (self->aux_sender)
+    self->aux_receiver = make_aux_bin ("rtprtxreceive", "rtx_receive",
+        session_id, &self->rtxreceive);
+
+  if (!self->aux_receiver)
+  {
+    g_clear_object (&self->rtxsend);
+    g_clear_object (&self->aux_sender);
+    g_clear_object (&self->rtxreceive);
+  }
+  else
+  {
+    g_object_set (self->rtxsend,
+        "max-size-time", self->history_time,
+        "max-size-packets", MAX_HISTORY_PACKETS,
+        NULL);
+  }
+
+  return self;
+}
+
+/**
+ * fs_rtp_retransmission_is_available:
+ * @self: a #FsRtpRetransmission
+ *
+ * Returns: %TRUE if the elements that retransmit are installed
+ */
+
+gboolean
+fs_rtp_retransmission_is_available (FsRtpRetransmission *self)
+{
+  return self->aux_sender != NULL;
+}
+
+/**
+ * fs_rtp_retransmission_get_aux_sender:
+ * @self: a #FsRtpRetransmission
+ *
+ * Returns: (transfer full): the element to return from the
+ *  "request-aux-sender" signal of rtpbin, or %NULL
+ */
+
+GstElement *
+fs_rtp_retransmission_get_aux_sender (FsRtpRetransmission *self)
+{
+  return self->aux_sender ? gst_object_ref (self->aux_sender) : NULL;
+}
+
+/**
+ * fs_rtp_retransmission_get_aux_receiver:
+ * @self: a #FsRtpRetransmission
+ *
+ * Returns: (transfer full): the element to return from the
+ *  "request-aux-receiver" signal of rtpbin, or %NULL
+ */
+
+GstElement *
+fs_rtp_retransmission_get_aux_receiver (FsRtpRetransmission *self)
+{
+  return self->aux_receiver ? gst_object_ref (self->aux_receiver) : NULL;
+}
+
+static void
+rtpbin_new_jitterbuffer (GstElement *rtpbin, GstElement *jitterbuffer,
+    guint session_id, guint ssrc, gpointer user_data)
+{
+  FsRtpRetransmission *self = FS_RTP_RETRANSMISSION (user_data);
+  gboolean receiving;
+
+  if (session_id != self->session_id)
+    return;
+
+  GST_OBJECT_LOCK (self);
+  g_object_weak_ref (G_OBJECT (jitterbuffer), jitterbuffer_gone, self);
+  self->jitterbuffers = g_list_prepend (self->jitterbuffers, jitterbuffer);
+  receiving = self->receiving;
+  GST_OBJECT_UNLOCK (self);
+
+  g_object_set (jitterbuffer, "do-retransmission", receiving, NULL);
+}
+
+/*
+ * The receiver reports of the peer about our stream give the RTT
+ */
+
+static void
+rtpsession_ssrc_active (GObject *rtpsession, GObject *src, gpointer user_data)
+{
+  FsRtpRetransmission *self = FS_RTP_RETRANSMISSION (user_data);
+  GstStructure *stats = NULL;
+  gboolean internal = TRUE;
+  gboolean have_rb = FALSE;
+  guint rb_round_trip = 0;
+
+  g_object_get (src, "stats", &stats, NULL);
+  if (!stats)
+    return;
+
+  gst_structure_get_boolean (stats, "internal", &internal);
+  gst_structure_get_boolean (stats, "have-rb", &have_rb);
+  gst_structure_get_uint (stats, "rb-round-trip", &rb_round_trip);
+  gst_structure_free (stats);
+
+  /* In units of 1/65536 seconds */
+  if (!internal && have_rb && rb_round_trip)
+    fs_rtp_retransmission_set_rtt (self,
+        gst_util_uint64_scale (rb_round_trip, G_USEC_PER_SEC, 65536));
+}
+
+void
+fs_rtp_retransmission_attach (FsRtpRetransmission *self,
+    GstElement *rtpbin, GObject *rtpbin_internal_session)
+{
+  if (!self->aux_sender)
+    return;
+
+  self->rtpbin = gst_object_ref (rtpbin);
+  self->rtpbin_internal_session = g_object_ref (rtpbin_internal_session);
+
+  self->new_jitterbuffer_id = g_signal_connect_object (rtpbin,
+      "new-jitterbuffer", G_CALLBACK (rtpbin_new_jitterbuffer), self, 0);
+  g_signal_connect_object (rtpbin_internal_session, "on-ssrc-active",
+      G_CALLBACK (rtpsession_ssrc_active), self, 0);
+}
+
+/**
+ * fs_rtp_codec_is_rtx:
+ * @codec: a #FsCodec
+ * @apt: (out) (allow-none): the payload type it retransmits
+ *
+ * Returns: %TRUE if @codec is an RTX codec with a valid "apt" parameter
+ */
+
+gboolean
+fs_rtp_codec_is_rtx (FsCodec *codec, gint *apt)
+{
+  FsCodecParameter *param;
+  gchar *end = NULL;
+  glong pt;
+
+  if (!codec->encoding_name ||
+      g_ascii_strcasecmp (codec->encoding_name, "rtx"))
+    return FALSE;
+
+  param = fs_codec_get_optional_parameter (codec, "apt", NULL);
+  if (!param || !param->value)
+    return FALSE;
+
+  pt = strtol (param->value, &end, 10);
+  if (!end || *end || end == param->value || pt < 0 || pt > 127)
+    return FALSE;
+
+  if (apt)
+    *apt = pt;
+
+  return TRUE;
+}
+
+static void
+set_feedback_profile (GObject *rtpsession, gboolean feedback)
+{
+  GParamSpec *pspec;
+  GEnumValue *value;
+  gint profile = 0;
+  gboolean secure;
+
+  /* The early feedback of AVPF sends the NACKs as soon as possible */
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (rtpsession),
+      "rtp-profile");
+  if (!pspec || !G_IS_PARAM_SPEC_ENUM (pspec))
+    return;
+
+  g_object_get (rtpsession, "rtp-profile", &profile, NULL);
+  value = g_enum_get_value (G_PARAM_SPEC_ENUM (pspec)->enum_class, profile);
+  if (!value)
+    return;
+
+  secure = g_str_has_prefix (value->value_nick, "s");
+  if (feedback)
+    gst_util_set_object_arg (rtpsession, "rtp-profile",
+        secure ? "savpf" : "avpf");
+  else
+    gst_util_set_object_arg (rtpsession, "rtp-profile",
+        secure ? "savp" : "avp");
+}
+
+/*
+ * The maps of rtprtxsend and rtprtxreceive are both from the original
+ * payload type to the RTX one. The sender only uses the codecs that were
+ * negotiated, the receiver also accepts what we offered.
+ */
+
+void
+fs_rtp_retransmission_codecs_updated (FsRtpRetransmission *self,
+    GList *codec_associations)
+{
+  GstStructure *send_map;
+  GstStructure *recv_map;
+  GList *item;
+  GList *jitterbuffers = NULL;
+  gboolean sending, receiving;
+
+  if (!self->aux_sender)
+    return;
+
+  send_map = gst_structure_new_empty ("application/x-rtp-pt-map");
+  recv_map = gst_structure_new_empty ("application/x-rtp-pt-map");
+
+  for (item = codec_associations; item; item = item->next)
+  {
+    CodecAssociation *ca = item->data;
+    gchar *key;
+    gint apt;
+
+    if (ca->disable || ca->reserved || !fs_rtp_codec_is_rtx (ca->codec, &apt))
+      continue;
+
+    key = g_strdup_printf ("%d", apt);
+    if (!ca->recv_only)
+      gst_structure_set (send_map, key, G_TYPE_UINT, ca->codec->id, NULL);
+    if (!ca->recv_only || !gst_structure_has_field (recv_map, key))
+      gst_structure_set (recv_map, key, G_TYPE_UINT, ca->codec->id, NULL);
+    g_free (key);
+  }
+
+  sending = gst_structure_n_fields (send_map) > 0;
+  receiving = gst_structure_n_fields (recv_map) > 0;
+
+  GST_DEBUG ("Retransmission maps, send: %" GST_PTR_FORMAT " receive: %"
+      GST_PTR_FORMAT, send_map, recv_map);
+
+  g_object_set (self->rtxsend, "payload-type-map", send_map, NULL);
+  g_object_set (self->rtxreceive, "payload-type-map", recv_map, NULL);
+  gst_structure_free (send_map);
+  gst_structure_free (recv_map);
+
+  GST_OBJECT_LOCK (self);
+  self->sending = sending;
+  self->receiving = receiving;
+  for (item = self->jitterbuffers; item; item = item->next)
+    jitterbuffers = g_list_prepend (jitterbuffers,
+        gst_object_ref (item->data));
+  GST_OBJECT_UNLOCK (self);
+
+  for (item = jitterbuffers; item; item = item->next)
+    g_object_set (item->data, "do-retransmission", receiving, NULL);
+  g_list_free_full (jitterbuffers, gst_object_unref);
+
+  if (self->rtpbin_internal_session)
+    set_feedback_profile (self->rtpbin_internal_session,
+        sending || receiving);
+}
+
+/**
+ * fs_rtp_retransmission_get_history_time:
+ * @rtt: the round trip time in microseconds, 0 if unknown
+ *
+ * Returns: how long the packets that were sent are kept, in milliseconds
+ */
+
+guint
+fs_rtp_retransmission_get_history_time (guint rtt)
+{
+  if (rtt == 0)
+    return MAX_HISTORY_TIME;
+
+  return CLAMP (HISTORY_RTTS * (guint64) rtt / 1000 + HISTORY_MARGIN,
+      MIN_HISTORY_TIME, MAX_HISTORY_TIME);
+}
+
+/**
+ * fs_rtp_retransmission_set_rtt:
+ * @self: a #FsRtpRetransmission
+ * @rtt: the round trip time in microseconds
+ *
+ * Bounds the history of the sent packets to what can still arrive in time
+ */
+
+void
+fs_rtp_retransmission_set_rtt (FsRtpRetransmission *self, guint rtt)
+{
+  guint history_time = fs_rtp_retransmission_get_history_time (rtt);
+  gboolean changed;
+
+  GST_OBJECT_LOCK (self);
+  self->rtt = rtt;
+  changed = self->history_time != history_time;
+  self->history_time = history_time;
+  GST_OBJECT_UNLOCK (self);
+
+  if (changed && self->rtxsend)
+  {
+    GST_LOG ("RTT is %u us, keeping %u ms of packets", rtt, history_time);
+    g_object_set (self->rtxsend, "max-size-time", history_time, NULL);
+  }
+}
+
+/**
+ * fs_rtp_retransmission_get_stats:
+ * @self: a #FsRtpRetransmission
+ *
+ * Returns: (transfer full): a #GstStructure with the number of packets
+ *  that were asked for and retransmitted in each direction
+ */
+
+GstStructure *
+fs_rtp_retransmission_get_stats (FsRtpRetransmission *self)
+{
+  guint send_requests = 0, retransmitted = 0;
+  guint recv_requests = 0, received = 0, recovered = 0;
+  GstStructure *s;
+
+  if (self->rtxsend)
+    g_object_get (self->rtxsend,
+        "num-rtx-requests", &send_requests,
+        "num-rtx-packets", &retransmitted,
+        NULL);
+  if (self->rtxreceive)
+    g_object_get (self->rtxreceive,
+        "num-rtx-requests", &recv_requests,
+        "num-rtx-packets", &received,
+        "num-rtx-assoc-packets", &recovered,
+        NULL);
+
+  GST_OBJECT_LOCK (self);
+  s = gst_structure_new ("application/x-fs-rtp-retransmission-stats",
+      "available", G_TYPE_BOOLEAN, self->aux_sender != NULL,
+      "sending", G_TYPE_BOOLEAN, self->sending,
+      "receiving", G_TYPE_BOOLEAN, self->receiving,
+      "rtt", G_TYPE_UINT, self->rtt,
+      "history-time", G_TYPE_UINT, self->history_time,
+      "nacked-packets", G_TYPE_UINT, send_requests,
+      "retransmitted-packets", G_TYPE_UINT, retransmitted,
+      "requested-packets", G_TYPE_UINT, recv_requests,
+      "received-packets", G_TYPE_UINT, received,
+      "recovered-packets", G_TYPE_UINT, recovered,
+      NULL);
+  GST_OBJECT_UNLOCK (self);
+
+  return s;
+}
@@ -0,0 +1,79 @@
+/*
+ * Farstream - Farstream RTP Retransmission
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-retransmission.h - Retransmits the lost packets in a separate RTX
+ *  stream when the receiver sends a generic NACK
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_RETRANSMISSION_H__
+#define __FS_RTP_RETRANSMISSION_H__
+
+#include <gst/gst.h>
+
+#include <farstream/fs-codec.h>
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_RTP_RETRANSMISSION \
+  (fs_rtp_retransmission_get_type ())
+#define FS_RTP_RETRANSMISSION(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_RTP_RETRANSMISSION, \
+      FsRtpRetransmission))
+#define FS_RTP_RETRANSMISSION_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_RTP_RETRANSMISSION, \
+      FsRtpRetransmissionClass))
+#define FS_IS_RTP_RETRANSMISSION(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_RTP_RETRANSMISSION))
+#define FS_IS_RTP_RETRANSMISSION_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_RTP_RETRANSMISSION))
+#define FS_RTP_RETRANSMISSION_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), FS_TYPE_RTP_RETRANSMISSION, \
+      FsRtpRetransmissionClass))
+#define FS_RTP_RETRANSMISSION_CAST(obj) ((FsRtpRetransmission *) (obj))
+
+typedef struct _FsRtpRetransmission FsRtpRetransmission;
+typedef struct _FsRtpRetransmissionClass FsRtpRetransmissionClass;
+
+GType fs_rtp_retransmission_get_type (void);
+
+FsRtpRetransmission *fs_rtp_retransmission_new (guint session_id);
+
+gboolean fs_rtp_retransmission_is_available (FsRtpRetransmission *self);
+
+GstElement *fs_rtp_retransmission_get_aux_sender (FsRtpRetransmission *self);
+GstElement *fs_rtp_retransmission_get_aux_receiver (FsRtpRetransmission *self);
+
+void fs_rtp_retransmission_attach (FsRtpRetransmission *self,
+    GstElement *rtpbin, GObject *rtpbin_internal_session);
+
+void fs_rtp_retransmission_codecs_updated (FsRtpRetransmission *self,
+    GList *codec_associations);
+
+void fs_rtp_retransmission_set_rtt (FsRtpRetransmission *self, guint rtt);
+
+GstStructure *fs_rtp_retransmission_get_stats (FsRtpRetransmission *self);
+
+guint fs_rtp_retransmission_get_history_time (guint rtt);
+
+gboolean fs_rtp_codec_is_rtx (FsCodec *codec, gint *apt);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_RETRANSMISSION_H__ */
@@ -130,6 +130,12 @@
 #include "fs-rtp-special-source.h"
 #include "fs-rtp-codec-specific.h"
 #include "fs-rtp-tfrc.h"
+#include "fs-rtp-transport-cc.h"
+#include "fs-rtp-remb.h"
+#include "fs-rtp-bundle.h"
+#include "fs-rtp-bandwidth-cache.h"
+#include "fs-rtp-retransmission.h"
+#include "fs-rtp-fec.h"
 
 #define GST_CAT_DEFAULT fsrtpconference_debug
 
@@ -159,7 +165,14 @@ enum
   PROP_RTP_HEADER_EXTENSION_PREFERENCES,
   PROP_ALLOWED_SINK_CAPS,
   PROP_ALLOWED_SRC_CAPS,
-  PROP_ENCRYPTION_PARAMETERS
+  PROP_ENCRYPTION_PARAMETERS,
+  PROP_BANDWIDTH_PRIORITY,
+  PROP_BANDWIDTH_ALLOCATION,
+  PROP_MAX_PROBE_BITRATE,
+  PROP_BANDWIDTH_CACHE,
+  PROP_RETRANSMISSION_STATS,
+  PROP_FEC_STATS,
+  PROP_FORWARDING
 };
 
 #define DEFAULT_NO_RTCP_TIMEOUT (7000)
@@ -173,6 +186,10 @@ struct _FsRtpSessionPrivate
 
   GHashTable *transmitters;
 
+  /* transmitter name -> FsRtpBundle this session is plugged into,
+   * protected by the session lock */
+  GHashTable *bundles;
+
   /* We keep references to these elements
    */
 
@@ -186,6 +203,8 @@ struct _FsRtpSessionPrivate
   GstElement *transmitter_rtcp_funnel;
 
   GstElement *rtpmuxer;
+  /* Between the muxer and the rtpbin, the forwarded packets come in there */
+  GstElement *send_rtp_funnel;
   GstElement *srtpenc;
   GstElement *srtpdec;
 
@@ -271,6 +290,12 @@ struct _FsRtpSessionPrivate
 
   /* Protected by session mutex */
   guint send_bitrate;
+  guint bandwidth_priority;
+  guint max_probe_bitrate;
+  gboolean bandwidth_cache;
+  gboolean forwarding;
+  /* Where the first stream sends, only set with the bandwidth cache */
+  gchar *remote_address;
   GstStructure *encryption_parameters;
 
   /* Protected by session mutex */
@@ -279,8 +304,11 @@ struct _FsRtpSessionPrivate
   GstCaps *output_caps;
 
   /* Set at construction time, can not change */
-  FsRtpTfrc *rtp_tfrc;
+  /* of FsRtpCongestionControl, the negotiation picks which one is used */
+  GList *congestion_controls;
   FsRtpKeyunitManager *keyunit_manager;
+  FsRtpRetransmission *retransmission;
+  FsRtpFec *fec;
 
   /* Can only be used while using the lock */
   GRWLock disposed_lock;
@@ -321,6 +349,11 @@ static gboolean fs_rtp_session_set_codec_preferences (FsSession *session,
     GList *codec_preferences,
     GError **error);
 static void fs_rtp_session_verify_send_codec_bin_locked (FsRtpSession *self);
+static void fs_rtp_session_remember_bandwidth (FsRtpSession *self);
+static void fs_rtp_session_set_forwarding (FsRtpSession *self,
+    gboolean forwarding);
+static void fs_rtp_session_update_forwarded_codecs_locked (
+    FsRtpSession *self);
 
 static gchar **fs_rtp_session_list_transmitters (FsSession *session);
 static GType fs_rtp_session_get_stream_transmitter_type (FsSession *session,
@@ -342,6 +375,9 @@ static FsStreamTransmitter* _stream_get_new_stream_transmitter (
   const gchar *transmitter_name,
   GParameter *parameters,
   guint n_parameters,
+  const FsRtpBundleStreamFuncs *bundle_funcs,
+  gboolean *bundled,
+  gboolean *gathered,
   GError **error,
   gpointer user_data);
 
@@ -479,6 +515,83 @@ fs_rtp_session_class_init (FsRtpSessionClass *klass)
           "The bitrate that the session will try to send at in bits/sec",
           0, G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class,
+      PROP_BANDWIDTH_PRIORITY,
+      g_param_spec_uint ("bandwidth-priority",
+          "The share of the bandwidth of this session",
+          "The bandwidth estimated to the participant is shared between its"
+          " sessions, the audio ones first get their send-bitrate and what is"
+          " left is split between the others in proportion to this",
+          1, G_MAXUINT, FS_RTP_BANDWIDTH_ALLOCATOR_DEFAULT_PRIORITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_BANDWIDTH_ALLOCATION,
+      g_param_spec_boxed ("bandwidth-allocation",
+          "The share of the bandwidth of this session",
+          "The estimate of the congestion control of this session, the"
+          " estimate of all the sessions to the same participant and the"
+          " bitrate given to this one",
+          GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_MAX_PROBE_BITRATE,
+      g_param_spec_uint ("max-probe-bitrate",
+          "The highest bitrate to probe at",
+          "When transport-cc is negotiated, the path is probed at the start"
+          " with short bursts of up to this many bits/sec to quickly find"
+          " its capacity, 0 to not probe",
+          0, G_MAXUINT, FS_RTP_TRANSPORT_CC_DEFAULT_MAX_PROBE_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_BANDWIDTH_CACHE,
+      g_param_spec_boolean ("bandwidth-cache",
+          "Remember the bandwidth of the path",
+          "Remember the bitrate reached to the destination of the stream at"
+          " the end of the call, and start the next calls to the same subnet"
+          " from a fraction of it. It must be set before the streams are"
+          " created",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_RETRANSMISSION_STATS,
+      g_param_spec_boxed ("retransmission-stats",
+          "The statistics of the retransmissions",
+          "The packets lost by the peer that it asked for and that were"
+          " retransmitted, and those we asked for and recovered. Packets are"
+          " retransmitted when the \"nack\" feedback parameter and an \"rtx\""
+          " codec are negotiated, an \"rtx\" codec is only offered for the"
+          " codecs whose preferences have the \"nack\" feedback parameter",
+          GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_FEC_STATS,
+      g_param_spec_boxed ("fec-stats",
+          "The statistics of the forward error correction",
+          "The share of FEC packets sent for the current loss rate, and the"
+          " lost packets that were recovered or not. The media is protected"
+          " when the \"red\" and \"ulpfec\" codecs are negotiated, they are"
+          " only offered if the codec preferences have them",
+          GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_FORWARDING,
+      g_param_spec_boolean ("forwarding",
+          "Forward the received packets",
+          "Relay the RTP packets received in this session to the other"
+          " forwarding sessions of the conference with the same media type,"
+          " without decoding them, and send theirs. No src pad is created"
+          " for the received streams. Each participant should be in a"
+          " session of its own. It must be set before the streams are"
+          " created",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   g_object_class_install_property (gobject_class,
       PROP_RTP_HEADER_EXTENSIONS,
       g_param_spec_boxed ("rtp-header-extensions",
@@ -513,6 +626,8 @@ fs_rtp_session_init (FsRtpSession *self)
 
   self->priv->transmitters = g_hash_table_new_full (g_str_hash, g_str_equal,
     g_free, g_object_unref);
+  self->priv->bundles = g_hash_table_new_full (g_str_hash, g_str_equal,
+    g_free, (GDestroyNotify) fs_rtp_bundle_unref);
 
   g_mutex_init (&self->mutex);
 
@@ -521,6 +636,8 @@ fs_rtp_session_init (FsRtpSession *self)
   self->priv->media_type = FS_MEDIA_TYPE_LAST + 1;
 
   self->priv->no_rtcp_timeout = DEFAULT_NO_RTCP_TIMEOUT;
+  self->priv->bandwidth_priority = FS_RTP_BANDWIDTH_ALLOCATOR_DEFAULT_PRIORITY;
+  self->priv->max_probe_bitrate = FS_RTP_TRANSPORT_CC_DEFAULT_MAX_PROBE_BITRATE;
 
   self->priv->ssrc_streams = g_hash_table_new (g_direct_hash, g_direct_equal);
   self->priv->ssrc_streams_manual = g_hash_table_new (g_direct_hash,
@@ -550,6 +667,14 @@ _remove_transmitter (gpointer key, gpointer value, gpointer user_data)
   gst_object_unref (sink);
 }
 
+static void
+_remove_from_bundle (gpointer key, gpointer value, gpointer user_data)
+{
+  FsRtpSession *self = FS_RTP_SESSION (user_data);
+
+  fs_rtp_bundle_remove_session (value, self->id);
+}
+
 static void
 _stop_transmitter_elem (gpointer key, gpointer value, gpointer elem_name)
 {
@@ -622,6 +747,9 @@ fs_rtp_session_dispose (GObject *obj)
 
   conferencebin = GST_BIN (self->priv->conference);
 
+  fs_rtp_forwarder_remove_session (
+      fs_rtp_conference_get_forwarder (self->priv->conference), obj);
+
   if (self->priv->rtpbin_internal_session)
     g_object_unref (self->priv->rtpbin_internal_session);
   self->priv->rtpbin_internal_session = NULL;
@@ -630,6 +758,14 @@ fs_rtp_session_dispose (GObject *obj)
     g_object_unref (self->priv->keyunit_manager);
   self->priv->keyunit_manager = NULL;
 
+  if (self->priv->retransmission)
+    g_object_unref (self->priv->retransmission);
+  self->priv->retransmission = NULL;
+
+  if (self->priv->fec)
+    g_object_unref (self->priv->fec);
+  self->priv->fec = NULL;
+
   /* Lets stop all of the elements sink to source */
 
   /* First the send pipeline */
@@ -637,6 +773,10 @@ fs_rtp_session_dispose (GObject *obj)
     g_hash_table_foreach (self->priv->transmitters, _stop_transmitter_elem,
       "gst-sink");
 
+  /* The shared transports keep running for the other sessions */
+  if (self->priv->bundles)
+    g_hash_table_foreach (self->priv->bundles, _remove_from_bundle, self);
+
   stop_and_remove (conferencebin, &self->priv->transmitter_rtp_tee, TRUE);
   stop_and_remove (conferencebin, &self->priv->transmitter_rtcp_tee, TRUE);
 
@@ -645,12 +785,19 @@ fs_rtp_session_dispose (GObject *obj)
   if (self->priv->rtpbin_send_rtp_sink)
     gst_pad_set_active (self->priv->rtpbin_send_rtp_sink, FALSE);
 
-  if (self->priv->rtp_tfrc)
+  fs_rtp_session_remember_bandwidth (self);
+
+  for (item = self->priv->congestion_controls; item; item = item->next)
   {
-    fs_rtp_tfrc_destroy (self->priv->rtp_tfrc);
-    g_object_unref (self->priv->rtp_tfrc);
+    fs_rtp_congestion_control_destroy (item->data);
+    g_object_unref (item->data);
   }
-  self->priv->rtp_tfrc = NULL;
+  g_list_free (self->priv->congestion_controls);
+  self->priv->congestion_controls = NULL;
+
+  fs_rtp_bandwidth_allocator_remove_flow (
+      fs_rtp_conference_get_bandwidth_allocator (self->priv->conference),
+      obj);
 
   FS_RTP_SESSION_LOCK (self);
   fs_rtp_session_stop_codec_param_gathering_unlock (self);
@@ -709,6 +856,7 @@ fs_rtp_session_dispose (GObject *obj)
   }
 
   stop_and_remove (conferencebin, &self->priv->rtpmuxer, TRUE);
+  stop_and_remove (conferencebin, &self->priv->send_rtp_funnel, TRUE);
   stop_and_remove (conferencebin, &self->priv->send_capsfilter, TRUE);
 
   while (self->priv->extra_send_capsfilters)
@@ -842,6 +990,12 @@ fs_rtp_session_dispose (GObject *obj)
     self->priv->transmitters = NULL;
   }
 
+  if (self->priv->bundles)
+  {
+    g_hash_table_destroy (self->priv->bundles);
+    self->priv->bundles = NULL;
+  }
+
   G_OBJECT_CLASS (fs_rtp_session_parent_class)->dispose (obj);
 }
 
@@ -885,6 +1039,8 @@ fs_rtp_session_finalize (GObject *object)
   if (self->priv->encryption_parameters)
     gst_structure_free (self->priv->encryption_parameters);
 
+  g_free (self->priv->remote_address);
+
   g_rw_lock_clear (&self->priv->disposed_lock);
 
   G_OBJECT_CLASS (fs_rtp_session_parent_class)->finalize (object);
@@ -1024,6 +1180,38 @@ fs_rtp_session_get_property (GObject *object,
       g_value_set_uint (value, self->priv->send_bitrate);
       FS_RTP_SESSION_UNLOCK (self);
       break;
+    case PROP_BANDWIDTH_PRIORITY:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_uint (value, self->priv->bandwidth_priority);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_MAX_PROBE_BITRATE:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_uint (value, self->priv->max_probe_bitrate);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_BANDWIDTH_CACHE:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_boolean (value, self->priv->bandwidth_cache);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_BANDWIDTH_ALLOCATION:
+      g_value_take_boxed (value, fs_rtp_bandwidth_allocator_get_stats (
+              fs_rtp_conference_get_bandwidth_allocator (
+                  self->priv->conference), object));
+      break;
+    case PROP_RETRANSMISSION_STATS:
+      g_value_take_boxed (value, fs_rtp_retransmission_get_stats (
+              self->priv->retransmission));
+      break;
+    case PROP_FEC_STATS:
+      g_value_take_boxed (value, fs_rtp_fec_get_stats (self->priv->fec));
+      break;
+    case PROP_FORWARDING:
+      FS_RTP_SESSION_LOCK (self);
+      g_value_set_boolean (value, self->priv->forwarding);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
     case PROP_RTP_HEADER_EXTENSIONS:
       FS_RTP_SESSION_LOCK (self);
       g_value_set_boxed (value, self->priv->hdrext_negotiated);
@@ -1073,6 +1261,7 @@ fs_rtp_session_set_property (GObject *object,
                              GParamSpec *pspec)
 {
   FsRtpSession *self = FS_RTP_SESSION (object);
+  GList *item;
 
   if (fs_rtp_session_has_disposed_enter (self, NULL))
     return;
@@ -1106,6 +1295,35 @@ fs_rtp_session_set_property (GObject *object,
       break;
     case PROP_SEND_BITRATE:
       fs_rtp_session_set_send_bitrate (self, g_value_get_uint (value));
+      if (self->priv->media_type == FS_MEDIA_TYPE_AUDIO)
+        fs_rtp_bandwidth_allocator_set_desired_bitrate (
+            fs_rtp_conference_get_bandwidth_allocator (self->priv->conference),
+            object, g_value_get_uint (value));
+      break;
+    case PROP_BANDWIDTH_PRIORITY:
+      FS_RTP_SESSION_LOCK (self);
+      self->priv->bandwidth_priority = g_value_get_uint (value);
+      FS_RTP_SESSION_UNLOCK (self);
+      fs_rtp_bandwidth_allocator_set_priority (
+          fs_rtp_conference_get_bandwidth_allocator (self->priv->conference),
+          object, g_value_get_uint (value));
+      break;
+    case PROP_MAX_PROBE_BITRATE:
+      FS_RTP_SESSION_LOCK (self);
+      self->priv->max_probe_bitrate = g_value_get_uint (value);
+      FS_RTP_SESSION_UNLOCK (self);
+      for (item = self->priv->congestion_controls; item; item = item->next)
+        if (FS_IS_RTP_TRANSPORT_CC (item->data))
+          g_object_set (item->data, "max-probe-bitrate",
+              g_value_get_uint (value), NULL);
+      break;
+    case PROP_BANDWIDTH_CACHE:
+      FS_RTP_SESSION_LOCK (self);
+      self->priv->bandwidth_cache = g_value_get_boolean (value);
+      FS_RTP_SESSION_UNLOCK (self);
+      break;
+    case PROP_FORWARDING:
+      fs_rtp_session_set_forwarding (self, g_value_get_boolean (value));
       break;
     case PROP_RTP_HEADER_EXTENSION_PREFERENCES:
       FS_RTP_SESSION_LOCK (self);
@@ -1137,14 +1355,238 @@ _rtpbin_send_rtp_sink_notify_caps (GstPad *pad, GParamSpec *param, gpointer self
 }
 
 static void
-_rtp_tfrc_bitrate_changed (GObject *rtp_tfrc, GParamSpec *pspec,
+_congestion_control_bitrate_changed (GObject *cc, GParamSpec *pspec,
     FsRtpSession *self)
 {
   guint bitrate;
+  guint rtt;
+  gdouble loss;
+  GList *item = NULL;
+
+  /* Only the preferred one of those enabled for the current codec */
+  FS_RTP_SESSION_LOCK (self);
+  if (self->priv->current_send_codec)
+    for (item = self->priv->congestion_controls; item; item = item->next)
+      if (fs_rtp_congestion_control_is_enabled (item->data,
+              self->priv->current_send_codec->id))
+        break;
+  FS_RTP_SESSION_UNLOCK (self);
+
+  if (item && item->data != (gpointer) cc)
+    return;
+
+  g_object_get (cc, "bitrate", &bitrate, NULL);
+  GST_DEBUG ("Session %u estimated bitrate: %u", self->id, bitrate);
+
+  /* The protection follows the losses it saw with the same reports */
+  if (fs_rtp_congestion_control_get_path (FS_RTP_CONGESTION_CONTROL (cc),
+          &rtt, &loss))
+    fs_rtp_fec_set_loss_rate (self->priv->fec, loss);
+
+  /* It comes back through _bandwidth_allocated() */
+  fs_rtp_bandwidth_allocator_set_estimate (
+      fs_rtp_conference_get_bandwidth_allocator (self->priv->conference),
+      G_OBJECT (self), bitrate);
+}
+
+static void
+_bandwidth_allocated (GObject *flow, guint bitrate)
+{
+  FsRtpSession *self = FS_RTP_SESSION (flow);
 
-  g_object_get (rtp_tfrc, "bitrate", &bitrate, NULL);
-  g_debug ("setting bitrate to: %u", bitrate);
+  if (fs_rtp_session_has_disposed_enter (self, NULL))
+    return;
+
+  /* The FEC packets are sent on top of the media */
+  bitrate = fs_rtp_fec_get_media_bitrate (self->priv->fec, bitrate);
+
+  GST_DEBUG ("Setting bitrate of session %u to: %u", self->id, bitrate);
   fs_rtp_session_set_send_bitrate (self, bitrate);
+
+  /* The forwarded streams are thinned instead */
+  fs_rtp_forwarder_set_bitrate (
+      fs_rtp_conference_get_forwarder (self->priv->conference), flow,
+      bitrate);
+
+  fs_rtp_session_has_disposed_exit (self);
+}
+
+/*
+ * The sessions with a single participant are coupled with the other
+ * sessions to it, they are assumed to share the same path. Must be called
+ * without the session lock.
+ */
+
+static void
+fs_rtp_session_update_bandwidth_group (FsRtpSession *self)
+{
+  gpointer group = NULL;
+
+  FS_RTP_SESSION_LOCK (self);
+  if (g_list_length (self->priv->streams) == 1)
+    group = FS_RTP_STREAM (self->priv->streams->data)->participant;
+  FS_RTP_SESSION_UNLOCK (self);
+
+  fs_rtp_bandwidth_allocator_set_group (
+      fs_rtp_conference_get_bandwidth_allocator (self->priv->conference),
+      G_OBJECT (self), group);
+}
+
+/*
+ * With the bandwidth cache, the controllers start from what was reached
+ * the last time the destination of the first stream was called, and what
+ * they reach is remembered once the last stream is gone.
+ */
+
+static void
+_stream_transmitter_new_active_candidate_pair (
+    FsStreamTransmitter *stream_transmitter,
+    FsCandidate *local_candidate,
+    FsCandidate *remote_candidate,
+    gpointer user_data)
+{
+  FsRtpSession *self = FS_RTP_SESSION (user_data);
+  GList *item;
+  guint bitrate;
+
+  if (remote_candidate->component_id != FS_COMPONENT_RTP)
+    return;
+
+  if (fs_rtp_session_has_disposed_enter (self, NULL))
+    return;
+
+  FS_RTP_SESSION_LOCK (self);
+  if (!self->priv->bandwidth_cache || self->priv->remote_address)
+  {
+    FS_RTP_SESSION_UNLOCK (self);
+    fs_rtp_session_has_disposed_exit (self);
+    return;
+  }
+  self->priv->remote_address = g_strdup (remote_candidate->ip);
+  FS_RTP_SESSION_UNLOCK (self);
+
+  if (fs_rtp_bandwidth_cache_lookup (remote_candidate->ip, g_get_real_time (),
+          &bitrate, NULL))
+  {
+    GST_DEBUG ("Session %u warm starting at %u", self->id, bitrate);
+    for (item = self->priv->congestion_controls; item; item = item->next)
+      fs_rtp_congestion_control_warm_start (item->data, bitrate);
+  }
+
+  fs_rtp_session_has_disposed_exit (self);
+}
+
+static void
+fs_rtp_session_remember_bandwidth (FsRtpSession *self)
+{
+  FsRtpCongestionControl *cc = NULL;
+  gchar *address;
+  GList *item;
+  guint bitrate;
+  guint rtt;
+  gdouble loss;
+
+  FS_RTP_SESSION_LOCK (self);
+  address = self->priv->remote_address;
+  self->priv->remote_address = NULL;
+  if (address && self->priv->current_send_codec)
+    for (item = self->priv->congestion_controls; item; item = item->next)
+      if (fs_rtp_congestion_control_is_enabled (item->data,
+              self->priv->current_send_codec->id))
+      {
+        cc = g_object_ref (item->data);
+        break;
+      }
+  FS_RTP_SESSION_UNLOCK (self);
+
+  if (cc && fs_rtp_congestion_control_get_path (cc, &rtt, &loss))
+  {
+    g_object_get (cc, "bitrate", &bitrate, NULL);
+    fs_rtp_bandwidth_cache_store (address, g_get_real_time (), bitrate, rtt,
+        loss);
+  }
+
+  if (cc)
+    g_object_unref (cc);
+  g_free (address);
+}
+
+static GstPad *
+_forwarder_request_pad (GObject *session)
+{
+  FsRtpSession *self = FS_RTP_SESSION (session);
+
+  return gst_element_get_request_pad (self->priv->send_rtp_funnel,
+      "sink_%u");
+}
+
+static void
+_forwarder_release_pad (GObject *session, GstPad *pad)
+{
+  FsRtpSession *self = FS_RTP_SESSION (session);
+
+  gst_element_release_request_pad (self->priv->send_rtp_funnel, pad);
+}
+
+static void
+fs_rtp_session_set_forwarding (FsRtpSession *self, gboolean forwarding)
+{
+  FsRtpForwarder *forwarder =
+      fs_rtp_conference_get_forwarder (self->priv->conference);
+
+  FS_RTP_SESSION_LOCK (self);
+  if (self->priv->forwarding == forwarding)
+  {
+    FS_RTP_SESSION_UNLOCK (self);
+    return;
+  }
+  self->priv->forwarding = forwarding;
+
+  if (forwarding)
+  {
+    fs_rtp_forwarder_add_session (forwarder, G_OBJECT (self),
+        self->priv->media_type, _forwarder_request_pad,
+        _forwarder_release_pad);
+    fs_rtp_session_update_forwarded_codecs_locked (self);
+  }
+  FS_RTP_SESSION_UNLOCK (self);
+
+  /* Releases the pads of our funnel, so it is done without the lock */
+  if (!forwarding)
+    fs_rtp_forwarder_remove_session (forwarder, G_OBJECT (self));
+}
+
+static void
+fs_rtp_session_update_forwarded_codecs_locked (FsRtpSession *self)
+{
+  GList *codecs;
+  GList *item;
+
+  if (!self->priv->forwarding)
+    return;
+
+  /* The redundancy and retransmissions are undone by the aux receivers and
+   * redone by the aux senders of each session */
+  codecs = codec_associations_to_codecs (self->priv->codec_associations,
+      TRUE);
+  item = codecs;
+  while (item)
+  {
+    FsCodec *codec = item->data;
+    GList *next = item->next;
+
+    if (fs_rtp_codec_is_rtx (codec, NULL) || fs_rtp_codec_is_fec (codec))
+    {
+      fs_codec_destroy (codec);
+      codecs = g_list_delete_link (codecs, item);
+    }
+    item = next;
+  }
+
+  fs_rtp_forwarder_set_codecs (
+      fs_rtp_conference_get_forwarder (self->priv->conference),
+      G_OBJECT (self), codecs);
+  fs_codec_list_destroy (codecs);
 }
 
 
@@ -1174,6 +1616,43 @@ _rtpbin_request_decoder (GstElement *rtpbin, guint session_id,
     return NULL;
 }
 
+static GstElement *
+_rtpbin_request_aux_sender (GstElement *rtpbin, guint session_id,
+    gpointer user_data)
+{
+  FsRtpSession *self = FS_RTP_SESSION (user_data);
+
+  if (self->id == session_id)
+    return fs_rtp_retransmission_get_aux_sender (self->priv->retransmission);
+  else
+    return NULL;
+}
+
+static GstElement *
+_rtpbin_request_aux_receiver (GstElement *rtpbin, guint session_id,
+    gpointer user_data)
+{
+  FsRtpSession *self = FS_RTP_SESSION (user_data);
+
+  if (self->id == session_id)
+    return fs_rtp_fec_get_aux_receiver (self->priv->fec,
+        fs_rtp_retransmission_get_aux_receiver (self->priv->retransmission));
+  else
+    return NULL;
+}
+
+static GstElement *
+_rtpbin_request_fec_encoder (GstElement *rtpbin, guint session_id,
+    gpointer user_data)
+{
+  FsRtpSession *self = FS_RTP_SESSION (user_data);
+
+  if (self->id == session_id)
+    return fs_rtp_fec_get_encoder (self->priv->fec);
+  else
+    return NULL;
+}
+
 static void
 fs_rtp_session_constructed (GObject *object)
 {
@@ -1186,7 +1665,6 @@ fs_rtp_session_constructed (GObject *object)
   GstPad *tee_sink_pad = NULL;
   GstPad *valve_sink_pad = NULL;
   GstPad *funnel_src_pad = NULL;
-  GstPad *muxer_src_pad = NULL;
   GstPad *transmitter_rtcp_tee_sink_pad;
   GstPad *pad;
   GstPadLinkReturn ret;
@@ -1195,6 +1673,10 @@ fs_rtp_session_constructed (GObject *object)
   gulong request_rtp_decoder_id = 0;
   gulong request_rtcp_encoder_id = 0;
   gulong request_rtcp_decoder_id = 0;
+  gulong request_aux_sender_id = 0;
+  gulong request_aux_receiver_id = 0;
+  gulong request_fec_encoder_id = 0;
+  GList *item;
 
   if (self->id == 0)
   {
@@ -1253,7 +1735,8 @@ fs_rtp_session_constructed (GObject *object)
 
   if (self->priv->media_type == FS_MEDIA_TYPE_VIDEO)
   {
-    GstElement *bitrate_adapter = fs_rtp_bitrate_adapter_new ();
+    GstElement *bitrate_adapter = fs_rtp_bitrate_adapter_new (
+        fs_rtp_conference_get_timer_wheel (self->priv->conference));
 
     if (!gst_bin_add (GST_BIN (self->priv->conference), bitrate_adapter))
     {
@@ -1340,6 +1823,29 @@ fs_rtp_session_constructed (GObject *object)
         G_CALLBACK (_srtpdec_request_key), self, 0);
   }
 
+  /* And the retransmission elements */
+
+  self->priv->retransmission = fs_rtp_retransmission_new (self->id);
+
+  request_aux_sender_id =
+      g_signal_connect (self->priv->conference->rtpbin, "request-aux-sender",
+          G_CALLBACK (_rtpbin_request_aux_sender), self);
+  request_aux_receiver_id =
+      g_signal_connect (self->priv->conference->rtpbin, "request-aux-receiver",
+          G_CALLBACK (_rtpbin_request_aux_receiver), self);
+
+  /* And the FEC ones, the decoders are requested for each new source */
+
+  self->priv->fec = fs_rtp_fec_new (self->id);
+  fs_rtp_fec_attach (self->priv->fec, self->priv->conference->rtpbin);
+
+  if (g_signal_lookup ("request-fec-encoder",
+          G_OBJECT_TYPE (self->priv->conference->rtpbin)))
+    request_fec_encoder_id =
+        g_signal_connect (self->priv->conference->rtpbin,
+            "request-fec-encoder",
+            G_CALLBACK (_rtpbin_request_fec_encoder), self);
+
   request_rtp_encoder_id =
       g_signal_connect (self->priv->conference->rtpbin, "request-rtp-encoder",
           G_CALLBACK (_rtpbin_request_encoder), self);
@@ -1385,6 +1891,13 @@ fs_rtp_session_constructed (GObject *object)
       request_rtcp_encoder_id);
   g_signal_handler_disconnect (self->priv->conference->rtpbin,
       request_rtcp_decoder_id);
+  g_signal_handler_disconnect (self->priv->conference->rtpbin,
+      request_aux_sender_id);
+  g_signal_handler_disconnect (self->priv->conference->rtpbin,
+      request_aux_receiver_id);
+  if (request_fec_encoder_id)
+    g_signal_handler_disconnect (self->priv->conference->rtpbin,
+        request_fec_encoder_id);
 
   if (!self->priv->rtpbin_recv_rtp_sink)
   {
@@ -1624,6 +2137,9 @@ fs_rtp_session_constructed (GObject *object)
       "notify::internal-ssrc",
       G_CALLBACK (_rtpbin_internal_session_notify_internal_ssrc), self);
 
+  fs_rtp_retransmission_attach (self->priv->retransmission,
+      self->priv->conference->rtpbin, self->priv->rtpbin_internal_session);
+
   g_object_set (self->priv->rtpbin_internal_session,
       "favor-new", TRUE,
       "bandwidth", (gdouble) 0,
@@ -1658,36 +2174,84 @@ fs_rtp_session_constructed (GObject *object)
   g_signal_connect_object (self->priv->rtpbin_send_rtp_sink, "notify::caps",
       G_CALLBACK (_rtpbin_send_rtp_sink_notify_caps), self, 0);
 
+  /* The packets forwarded from the other sessions join the muxed ones
+   * there, they must not go through the muxer as it rewrites the SSRC.
+   * Their caps have no ssrc, so only the muxer sets the one of the
+   * rtpsession when the funnel switches pads. */
+
+  tmp = g_strdup_printf ("send_rtp_funnel_%u", self->id);
+  funnel = gst_element_factory_make ("funnel", tmp);
+  g_free (tmp);
+
+  if (!funnel)
+  {
+    self->priv->construction_error = g_error_new (FS_ERROR,
+      FS_ERROR_CONSTRUCTION,
+      "Could not create the rtp funnel element");
+    return;
+  }
 
-  muxer_src_pad = gst_element_get_static_pad (muxer, "src");
+  if (!gst_bin_add (GST_BIN (self->priv->conference), funnel))
+  {
+    self->priv->construction_error = g_error_new (FS_ERROR,
+      FS_ERROR_CONSTRUCTION,
+      "Could not add the rtp funnel element to the FsRtpConference");
+    gst_object_unref (funnel);
+    return;
+  }
+
+  self->priv->send_rtp_funnel = gst_object_ref (funnel);
+
+  funnel_src_pad = gst_element_get_static_pad (funnel, "src");
 
-  ret = gst_pad_link (muxer_src_pad, self->priv->rtpbin_send_rtp_sink);
+  ret = gst_pad_link (funnel_src_pad, self->priv->rtpbin_send_rtp_sink);
 
   if (GST_PAD_LINK_FAILED (ret))
   {
     self->priv->construction_error = g_error_new (FS_ERROR,
         FS_ERROR_CONSTRUCTION,
         "Could not link pad %s with pad %s",
-        GST_PAD_NAME (muxer_src_pad),
+        GST_PAD_NAME (funnel_src_pad),
         GST_PAD_NAME (self->priv->rtpbin_send_rtp_sink));
 
-    gst_object_unref (muxer_src_pad);
+    gst_object_unref (funnel_src_pad);
     return;
   }
 
-  gst_object_unref (muxer_src_pad);
+  gst_object_unref (funnel_src_pad);
+
+  if (!gst_element_link_pads (muxer, "src", funnel, "sink_%u"))
+  {
+    self->priv->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not link the rtp muxer to the rtp funnel");
+    return;
+  }
 
+  gst_element_set_state (funnel, GST_STATE_PLAYING);
   gst_element_set_state (muxer, GST_STATE_PLAYING);
 
 
   if (self->priv->media_type == FS_MEDIA_TYPE_VIDEO)
   {
-    self->priv->rtp_tfrc = fs_rtp_tfrc_new (self);
+    /* In order of preference */
+    self->priv->congestion_controls = g_list_append (
+        self->priv->congestion_controls, fs_rtp_transport_cc_new (self));
+    self->priv->congestion_controls = g_list_append (
+        self->priv->congestion_controls, fs_rtp_tfrc_new (self));
+    self->priv->congestion_controls = g_list_append (
+        self->priv->congestion_controls, fs_rtp_remb_new (self));
 
-    g_signal_connect_object (self->priv->rtp_tfrc, "notify::bitrate",
-        G_CALLBACK (_rtp_tfrc_bitrate_changed), self, 0);
+    for (item = self->priv->congestion_controls; item; item = item->next)
+      g_signal_connect_object (item->data, "notify::bitrate",
+          G_CALLBACK (_congestion_control_bitrate_changed), self, 0);
   }
 
+  fs_rtp_bandwidth_allocator_add_flow (
+      fs_rtp_conference_get_bandwidth_allocator (self->priv->conference),
+      object, self->priv->media_type == FS_MEDIA_TYPE_AUDIO,
+      _bandwidth_allocated);
+
   self->priv->keyunit_manager = fs_rtp_keyunit_manager_new (
     self->priv->rtpbin_internal_session);
 
@@ -1861,6 +2425,50 @@ fs_rtp_session_add_ssrc_stream_locked (FsRtpSession *self, guint32 ssrc,
   }
 }
 
+/**
+ * fs_rtp_session_is_own_bundled_rtp:
+ * @self: a #FsRtpSession
+ * @buffer: a packet received on a bundled transport
+ * @ssrc: location for the SSRC of the packet
+ *
+ * Only the RTP packets with one of the negotiated payload types of the
+ * session can be used to associate their SSRC with a stream, the RTCP
+ * multiplexed on the same transport may belong to any session.
+ *
+ * Returns: %TRUE if @buffer is a RTP packet of this session
+ */
+
+static gboolean
+fs_rtp_session_is_own_bundled_rtp (FsRtpSession *self, GstBuffer *buffer,
+    guint32 *ssrc)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  guint8 byte1;
+  guint pt;
+  gboolean ret;
+
+  if (gst_buffer_extract (buffer, 1, &byte1, 1) != 1)
+    return FALSE;
+
+  /* RFC 5761, section 4 */
+  if (byte1 >= 192 && byte1 <= 223)
+    return FALSE;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+    return FALSE;
+
+  *ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
+  pt = gst_rtp_buffer_get_payload_type (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  FS_RTP_SESSION_LOCK (self);
+  ret = (lookup_codec_association_by_pt (self->priv->codec_associations,
+          pt) != NULL);
+  FS_RTP_SESSION_UNLOCK (self);
+
+  return ret;
+}
+
 static void
 _stream_known_source_packet_received (FsRtpStream *stream, guint component,
     GstBuffer *buffer, gpointer user_data)
@@ -1868,12 +2476,22 @@ _stream_known_source_packet_received (FsRtpStream *stream, guint component,
   guint32 ssrc;
   FsRtpSession *self = FS_RTP_SESSION_CAST (user_data);
   gboolean valid = FALSE;
+  gboolean bundled;
   GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
 
   if (fs_rtp_session_has_disposed_enter (self, NULL))
     return;
 
-  if (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+  FS_RTP_SESSION_LOCK (self);
+  bundled = (g_hash_table_size (self->priv->bundles) > 0);
+  FS_RTP_SESSION_UNLOCK (self);
+
+  if (bundled)
+  {
+    /* A bundled transport carries the packets of every session */
+    valid = fs_rtp_session_is_own_bundled_rtp (self, buffer, &ssrc);
+  }
+  else if (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
   {
 
     ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
@@ -1934,6 +2552,13 @@ _stream_known_source_packet_received (FsRtpStream *stream, guint component,
   }
   else
   {
+    /* The association is confirmed, we don't need to look at every packet
+     * until an SSRC we can't place shows up. A bundled stream transmitter
+     * also feeds the other sessions, so it keeps emitting. */
+    if (!bundled && !self->priv->free_substreams &&
+        g_hash_table_lookup (self->priv->ssrc_streams,
+            GUINT_TO_POINTER (ssrc)) == stream)
+      fs_rtp_stream_set_source_validated_locked (stream, TRUE);
     FS_RTP_SESSION_UNLOCK (self);
   }
 
@@ -1945,12 +2570,19 @@ _stream_sending_changed_locked (FsRtpStream *stream, gboolean sending,
     gpointer user_data)
 {
   FsRtpSession *session = user_data;
+  GHashTableIter iter;
+  gpointer value;
+  GList *item;
 
   if (sending)
     session->priv->streams_sending++;
   else
     session->priv->streams_sending--;
 
+  g_hash_table_iter_init (&iter, session->priv->bundles);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    fs_rtp_bundle_set_stream_sending (value, G_OBJECT (stream), sending);
+
   if (fs_rtp_session_has_disposed_enter (session, NULL))
     return;
 
@@ -1959,8 +2591,8 @@ _stream_sending_changed_locked (FsRtpStream *stream, gboolean sending,
   else
     g_object_set (session->priv->media_sink_valve, "drop", TRUE, NULL);
 
-  if (session->priv->rtp_tfrc)
-    g_object_set (session->priv->rtp_tfrc, "sending",
+  for (item = session->priv->congestion_controls; item; item = item->next)
+    g_object_set (item->data, "sending",
         (session->priv->streams_sending > 0), NULL);
 
   fs_rtp_session_has_disposed_exit (session);
@@ -1997,6 +2629,7 @@ _remove_stream (gpointer user_data,
     GObject *where_the_object_was)
 {
   FsRtpSession *self = FS_RTP_SESSION (user_data);
+  gboolean last_stream;
 
   if (fs_rtp_session_has_disposed_enter (self, NULL))
     return;
@@ -2010,8 +2643,14 @@ _remove_stream (gpointer user_data,
       where_the_object_was);
   g_hash_table_foreach_remove (self->priv->ssrc_streams_manual,
       _remove_stream_from_ht, where_the_object_was);
+  last_stream = (self->priv->streams == NULL);
   FS_RTP_SESSION_UNLOCK (self);
 
+  if (last_stream)
+    fs_rtp_session_remember_bandwidth (self);
+
+  fs_rtp_session_update_bandwidth_group (self);
+
   fs_rtp_session_has_disposed_exit (self);
 }
 
@@ -2074,6 +2713,8 @@ fs_rtp_session_new_stream (FsSession *session,
     self->priv->streams = g_list_append (self->priv->streams, new_stream);
     self->priv->streams_cookie++;
     FS_RTP_SESSION_UNLOCK (self);
+
+    fs_rtp_session_update_bandwidth_group (self);
   }
 
   g_object_weak_ref (G_OBJECT (new_stream), _remove_stream, self);
@@ -2647,22 +3288,129 @@ fs_rtp_session_get_transmitter (FsRtpSession *self,
 }
 
 
+static void
+_bundle_set_payload_types_locked (gpointer key, gpointer value,
+    gpointer user_data)
+{
+  FsRtpSession *self = FS_RTP_SESSION (user_data);
+  guint8 pts[128];
+  guint n_pts = 0;
+  GList *item;
+
+  for (item = self->priv->codec_associations;
+       item && n_pts < G_N_ELEMENTS (pts);
+       item = g_list_next (item))
+  {
+    CodecAssociation *ca = item->data;
+
+    if (!ca->disable && !ca->reserved)
+      pts[n_pts++] = ca->codec->id;
+  }
+
+  fs_rtp_bundle_set_payload_types (value, self->id, pts, n_pts);
+}
+
+/**
+ * fs_rtp_session_get_bundle:
+ * @self: a #FsRtpSession
+ * @transmitter_name: The name of the transmitter
+ * @error: a #GError or %NULL
+ *
+ * Returns the shared transport for @transmitter_name, plugging the session
+ * into it if it is not already.
+ *
+ * Returns: a #FsRtpBundle or %NULL if the conference does not bundle
+ *  sessions or on error
+ */
+static FsRtpBundle *
+fs_rtp_session_get_bundle (FsRtpSession *self,
+    const gchar *transmitter_name,
+    GError **error)
+{
+  FsRtpBundle *bundle;
+  guint tos;
+
+  FS_RTP_SESSION_LOCK (self);
+  bundle = g_hash_table_lookup (self->priv->bundles, transmitter_name);
+  if (bundle)
+  {
+    fs_rtp_bundle_ref (bundle);
+    FS_RTP_SESSION_UNLOCK (self);
+    return bundle;
+  }
+  tos = self->priv->tos;
+  FS_RTP_SESSION_UNLOCK (self);
+
+  bundle = fs_rtp_conference_get_bundle (self->priv->conference,
+      transmitter_name, tos, error);
+  if (!bundle)
+    return NULL;
+
+  if (!fs_rtp_bundle_add_session (bundle, self->id,
+          self->priv->transmitter_rtp_tee, self->priv->transmitter_rtcp_tee,
+          self->priv->transmitter_rtp_funnel,
+          self->priv->transmitter_rtcp_funnel, error))
+  {
+    fs_rtp_bundle_unref (bundle);
+    return NULL;
+  }
+
+  FS_RTP_SESSION_LOCK (self);
+  /* Check if two were added at the same time */
+  if (!g_hash_table_lookup (self->priv->bundles, transmitter_name))
+  {
+    g_signal_connect_object (fs_rtp_bundle_get_transmitter (bundle), "error",
+        G_CALLBACK (_transmitter_error), self, 0);
+    g_hash_table_insert (self->priv->bundles, g_strdup (transmitter_name),
+        fs_rtp_bundle_ref (bundle));
+    _bundle_set_payload_types_locked (NULL, bundle, self);
+  }
+  FS_RTP_SESSION_UNLOCK (self);
+
+  return bundle;
+}
+
 static FsStreamTransmitter *
 _stream_get_new_stream_transmitter (FsRtpStream *stream,
     FsParticipant *participant,
     const gchar *transmitter_name,
     GParameter *parameters,
     guint n_parameters,
+    const FsRtpBundleStreamFuncs *bundle_funcs,
+    gboolean *bundled,
+    gboolean *gathered,
     GError **error,
     gpointer user_data)
 {
   FsTransmitter *transmitter;
   FsStreamTransmitter *st = NULL;
   FsRtpSession *self = user_data;
+  FsRtpBundle *bundle;
+  GError *bundle_error = NULL;
 
   if (fs_rtp_session_has_disposed_enter (self, error))
     return NULL;
 
+  bundle = fs_rtp_session_get_bundle (self, transmitter_name, &bundle_error);
+  if (bundle)
+  {
+    *bundled = TRUE;
+    st = fs_rtp_bundle_get_stream_transmitter (bundle, G_OBJECT (stream),
+        bundle_funcs, participant, parameters, n_parameters, gathered, error);
+    fs_rtp_bundle_unref (bundle);
+    if (st)
+      g_signal_connect_object (st, "new-active-candidate-pair",
+          G_CALLBACK (_stream_transmitter_new_active_candidate_pair), self, 0);
+    fs_rtp_session_has_disposed_exit (self);
+    return st;
+  }
+  else if (bundle_error)
+  {
+    g_propagate_error (error, bundle_error);
+    fs_rtp_session_has_disposed_exit (self);
+    return NULL;
+  }
+
   transmitter = fs_rtp_session_get_transmitter (self, transmitter_name, error);
 
   if (!transmitter)
@@ -2673,6 +3421,9 @@ _stream_get_new_stream_transmitter (FsRtpStream *stream,
 
   st = fs_transmitter_new_stream_transmitter (transmitter, participant,
       n_parameters, parameters, error);
+  if (st)
+    g_signal_connect_object (st, "new-active-candidate-pair",
+        G_CALLBACK (_stream_transmitter_new_active_candidate_pair), self, 0);
 
   g_object_unref (transmitter);
 
@@ -2960,9 +3711,16 @@ fs_rtp_session_negotiate_codecs_locked (FsRtpSession *session,
     fs_rtp_special_sources_negotiation_filter (
         new_negotiated_codec_associations);
 
+  /* transport-cc first, it removes TFRC when both were negotiated */
+  fs_rtp_transport_cc_filter_codecs (&new_negotiated_codec_associations,
+      &new_hdrexts);
   fs_rtp_tfrc_filter_codecs (&new_negotiated_codec_associations,
       &new_hdrexts);
 
+  new_negotiated_codec_associations = filter_rtx_codec_associations (
+      new_negotiated_codec_associations,
+      fs_rtp_retransmission_is_available (session->priv->retransmission));
+
   if (session->priv->codec_associations)
     *is_new = ! codec_associations_list_are_equal (
       session->priv->codec_associations, new_negotiated_codec_associations);
@@ -2970,6 +3728,9 @@ fs_rtp_session_negotiate_codecs_locked (FsRtpSession *session,
   codec_association_list_destroy (session->priv->codec_associations);
   session->priv->codec_associations = new_negotiated_codec_associations;
 
+  g_hash_table_foreach (session->priv->bundles,
+      _bundle_set_payload_types_locked, session);
+
   new_hdrexts = finish_header_extensions_nego (new_hdrexts, hdrext_used_ids);
 
   fs_rtp_header_extension_list_destroy (session->priv->hdrext_negotiated);
@@ -3010,6 +3771,7 @@ fs_rtp_session_update_codecs (FsRtpSession *session,
 {
   gboolean is_new = TRUE;
   gboolean has_remotes = FALSE;
+  GList *item;
 
   FS_RTP_SESSION_LOCK (session);
 
@@ -3020,11 +3782,17 @@ fs_rtp_session_update_codecs (FsRtpSession *session,
     return FALSE;
   }
 
-  if (session->priv->rtp_tfrc)
-    fs_rtp_tfrc_codecs_updated (session->priv->rtp_tfrc,
+  for (item = session->priv->congestion_controls; item; item = item->next)
+    fs_rtp_congestion_control_codecs_updated (item->data,
         session->priv->codec_associations,
         session->priv->hdrext_negotiated);
 
+  fs_rtp_retransmission_codecs_updated (session->priv->retransmission,
+      session->priv->codec_associations);
+  fs_rtp_fec_codecs_updated (session->priv->fec,
+      session->priv->codec_associations);
+  fs_rtp_session_update_forwarded_codecs_locked (session);
+
   fs_rtp_session_distribute_recv_codecs_locked (session, stream, remote_codecs);
 
   fs_rtp_session_verify_recv_codecs_locked (session);
@@ -3197,14 +3965,26 @@ fs_rtp_session_new_recv_pad (FsRtpSession *session, GstPad *new_pad,
   FsRtpStream *stream = NULL;
   GError *error = NULL;
   gint no_rtcp_timeout;
+  gboolean forwarding;
 
   if (fs_rtp_session_has_disposed_enter (session, NULL))
     return;
 
   FS_RTP_SESSION_LOCK (session);
   no_rtcp_timeout = session->priv->no_rtcp_timeout;
+  forwarding = session->priv->forwarding;
   FS_RTP_SESSION_UNLOCK (session);
 
+  /* The packets are relayed as-is, there is no substream to decode them */
+  if (forwarding &&
+      fs_rtp_forwarder_add_source (
+          fs_rtp_conference_get_forwarder (session->priv->conference),
+          G_OBJECT (session), new_pad, ssrc, pt))
+  {
+    fs_rtp_session_has_disposed_exit (session);
+    return;
+  }
+
   substream = fs_rtp_sub_stream_new (session->priv->conference, session,
       new_pad, ssrc, pt, no_rtcp_timeout, &error);
 
@@ -3251,9 +4031,16 @@ fs_rtp_session_new_recv_pad (FsRtpSession *session, GstPad *new_pad,
     }
     else
     {
+      GList *item;
+
       session->priv->free_substreams =
         g_list_prepend (session->priv->free_substreams, substream);
 
+      /* Ask the transmitters for the packets from known sources again so
+       * the new SSRC can be associated */
+      for (item = session->priv->streams; item; item = item->next)
+        fs_rtp_stream_set_source_validated_locked (item->data, FALSE);
+
       g_signal_connect_object (substream, "error",
           G_CALLBACK (_substream_error), session, 0);
 
@@ -3911,6 +4698,7 @@ fs_rtp_session_add_send_codec_bin_unlock (FsRtpSession *session,
   gchar *name;
   GstCaps *sendcaps;
   GList *codecs;
+  GList *item;
   GstIterator *iter;
   GValue link_rv = {0};
   struct link_data data;
@@ -3929,13 +4717,16 @@ fs_rtp_session_add_send_codec_bin_unlock (FsRtpSession *session,
 
   sendcaps = fs_codec_to_gst_caps (ca->send_codec);
 
-  if (session->priv->rtp_tfrc &&
-      fs_rtp_tfrc_is_enabled (session->priv->rtp_tfrc, ca->codec->id))
+  for (item = session->priv->congestion_controls; item; item = item->next)
   {
-    guint bitrate;
+    if (fs_rtp_congestion_control_is_enabled (item->data, ca->codec->id))
+    {
+      guint bitrate;
 
-    g_object_get (session->priv->rtp_tfrc, "bitrate", &bitrate, NULL);
-    session->priv->send_bitrate = bitrate;
+      g_object_get (item->data, "bitrate", &bitrate, NULL);
+      session->priv->send_bitrate = bitrate;
+      break;
+    }
   }
 
   if (codecbin)
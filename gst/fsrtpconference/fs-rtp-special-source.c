@@ -36,6 +36,7 @@
 
 #include "fs-rtp-dtmf-event-source.h"
 #include "fs-rtp-dtmf-sound-source.h"
+#include "fs-rtp-fec-source.h"
 
 #define GST_CAT_DEFAULT fsrtpconference_debug
 
@@ -44,7 +45,7 @@
  * @short_description: Base class to abstract how special sources are handled
  *
  * This class defines how special sources can be handled, it is the base
- * for DMTF and CN sources.
+ * for DMTF and CN sources, and for the negotiation of the FEC codecs.
  *
  */
 
@@ -112,6 +113,8 @@ register_classes (gpointer data)
       g_type_class_ref (FS_TYPE_RTP_DTMF_EVENT_SOURCE));
   my_classes = g_list_prepend (my_classes,
       g_type_class_ref (FS_TYPE_RTP_DTMF_SOUND_SOURCE));
+  my_classes = g_list_prepend (my_classes,
+      g_type_class_ref (FS_TYPE_RTP_FEC_SOURCE));
 
   return my_classes;
 }
@@ -68,7 +68,7 @@ typedef struct _FsRtpSpecialSourcePrivate FsRtpSpecialSourcePrivate;
  * @get_codec: Gets the codec used by this source
  *
  * Class structure for #FsRtpSpecialSource, the build() and get_codec()
- * methods are required.
+ * methods are required for the classes that add a source to the stream.
  */
 
 struct _FsRtpSpecialSourceClass
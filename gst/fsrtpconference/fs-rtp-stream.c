@@ -83,6 +83,9 @@ struct _FsRtpStreamPrivate
 {
   FsRtpSession *session;
   FsStreamTransmitter *stream_transmitter;
+  /* The stream transmitter is shared with the other streams of the
+   * participant, it is stopped and its sending is managed by the bundle */
+  gboolean bundled;
 
   FsStreamDirection direction;
 
@@ -176,6 +179,14 @@ static void _state_changed (FsStreamTransmitter *stream_transmitter,
     FsStreamState state,
     gpointer user_data);
 
+/* The bundle dispatches the signals of a shared stream transmitter */
+static const FsRtpBundleStreamFuncs bundle_funcs = {
+  _new_local_candidate,
+  _local_candidates_prepared,
+  _new_active_candidate_pair,
+  _state_changed
+};
+
 // static guint signals[LAST_SIGNAL] = { 0 };
 
 static void
@@ -320,21 +331,26 @@ fs_rtp_stream_dispose (GObject *object)
 
   if (st)
   {
-    g_signal_handler_disconnect (st,
-        self->priv->local_candidates_prepared_handler_id);
-    g_signal_handler_disconnect (st,
-        self->priv->new_active_candidate_pair_handler_id);
-    g_signal_handler_disconnect (st,
-        self->priv->new_local_candidate_handler_id);
+    /* Those are dispatched by the bundle to bundled streams */
+    if (!self->priv->bundled)
+    {
+      g_signal_handler_disconnect (st,
+          self->priv->local_candidates_prepared_handler_id);
+      g_signal_handler_disconnect (st,
+          self->priv->new_active_candidate_pair_handler_id);
+      g_signal_handler_disconnect (st,
+          self->priv->new_local_candidate_handler_id);
+      g_signal_handler_disconnect (st,
+          self->priv->state_changed_handler_id);
+    }
     g_signal_handler_disconnect (st,
         self->priv->error_handler_id);
     g_signal_handler_disconnect (st,
         self->priv->known_source_packet_received_handler_id);
-    g_signal_handler_disconnect (st,
-        self->priv->state_changed_handler_id);
 
     FS_RTP_SESSION_UNLOCK (session);
-    fs_stream_transmitter_stop (st);
+    if (!self->priv->bundled)
+      fs_stream_transmitter_stop (st);
     g_object_unref (st);
     FS_RTP_SESSION_LOCK (session);
   }
@@ -504,8 +520,8 @@ fs_rtp_stream_set_property (GObject *object,
         st = fs_rtp_stream_get_stream_transmitter (self, NULL);
         if (st)
         {
-          g_object_set (self->priv->stream_transmitter, "sending",
-              dir & FS_DIRECTION_SEND, NULL);
+          if (!self->priv->bundled)
+            g_object_set (st, "sending", dir & FS_DIRECTION_SEND, NULL);
           g_object_unref (st);
         }
 
@@ -558,13 +574,26 @@ fs_rtp_stream_add_remote_candidates (FsStream *stream, GList *candidates,
 {
   FsRtpStream *self = FS_RTP_STREAM (stream);
   FsStreamTransmitter *st = fs_rtp_stream_get_stream_transmitter (self, error);
+  GList *filtered = NULL;
   gboolean ret = FALSE;
 
   if (!st)
     return FALSE;
 
+  if (self->priv->bundled)
+  {
+    filtered = fs_rtp_bundle_filter_remote_candidates (candidates);
+    if (!filtered)
+    {
+      g_object_unref (st);
+      return TRUE;
+    }
+    candidates = filtered;
+  }
+
   ret = fs_stream_transmitter_add_remote_candidates (st, candidates, error);
 
+  g_list_free (filtered);
   g_object_unref (st);
   return ret;
 }
@@ -583,16 +612,28 @@ fs_rtp_stream_force_remote_candidates (FsStream *stream,
 {
   FsRtpStream *self = FS_RTP_STREAM (stream);
   FsStreamTransmitter *st = fs_rtp_stream_get_stream_transmitter (self, error);
+  GList *filtered = NULL;
   gboolean ret = FALSE;
 
   if (!st)
     return FALSE;
 
+  if (self->priv->bundled)
+  {
+    filtered = fs_rtp_bundle_filter_remote_candidates (remote_candidates);
+    if (!filtered)
+    {
+      g_object_unref (st);
+      return TRUE;
+    }
+    remote_candidates = filtered;
+  }
 
   ret = fs_stream_transmitter_force_remote_candidates (
       self->priv->stream_transmitter, remote_candidates,
       error);
 
+  g_list_free (filtered);
   g_object_unref (st);
   return ret;
 }
@@ -1112,6 +1153,8 @@ fs_rtp_stream_set_transmitter (FsStream *stream,
   FsStreamTransmitter *st = NULL;
   FsRtpStream *self = FS_RTP_STREAM (stream);
   FsRtpSession *session = fs_rtp_stream_get_session (self, error);
+  gboolean bundled = FALSE;
+  gboolean gathered = FALSE;
 
   if (!session)
     return FALSE;
@@ -1127,8 +1170,8 @@ fs_rtp_stream_set_transmitter (FsStream *stream,
 
   st = self->priv->get_new_stream_transmitter_cb (self,
       FS_PARTICIPANT (self->participant), transmitter,
-      stream_transmitter_parameters, stream_transmitter_n_parameters, error,
-      self->priv->user_data_for_cb);
+      stream_transmitter_parameters, stream_transmitter_n_parameters,
+      &bundle_funcs, &bundled, &gathered, error, self->priv->user_data_for_cb);
 
   if (!st)
   {
@@ -1136,25 +1179,32 @@ fs_rtp_stream_set_transmitter (FsStream *stream,
     return FALSE;
   }
 
-
-  g_object_set (st, "sending",
-    self->priv->direction & FS_DIRECTION_SEND, NULL);
-
-  self->priv->local_candidates_prepared_handler_id =
-    g_signal_connect_object (st,
-        "local-candidates-prepared",
-        G_CALLBACK (_local_candidates_prepared),
-        self, 0);
-  self->priv->new_active_candidate_pair_handler_id =
-    g_signal_connect_object (st,
-        "new-active-candidate-pair",
-        G_CALLBACK (_new_active_candidate_pair),
-        self, 0);
-  self->priv->new_local_candidate_handler_id =
-    g_signal_connect_object (st,
-        "new-local-candidate",
-        G_CALLBACK (_new_local_candidate),
-        self, 0);
+  if (!bundled)
+  {
+    g_object_set (st, "sending",
+        self->priv->direction & FS_DIRECTION_SEND, NULL);
+
+    self->priv->local_candidates_prepared_handler_id =
+      g_signal_connect_object (st,
+          "local-candidates-prepared",
+          G_CALLBACK (_local_candidates_prepared),
+          self, 0);
+    self->priv->new_active_candidate_pair_handler_id =
+      g_signal_connect_object (st,
+          "new-active-candidate-pair",
+          G_CALLBACK (_new_active_candidate_pair),
+          self, 0);
+    self->priv->new_local_candidate_handler_id =
+      g_signal_connect_object (st,
+          "new-local-candidate",
+          G_CALLBACK (_new_local_candidate),
+          self, 0);
+    self->priv->state_changed_handler_id =
+      g_signal_connect_object (st,
+          "state-changed",
+          G_CALLBACK (_state_changed),
+          self, 0);
+  }
   self->priv->error_handler_id =
     g_signal_connect_object (st,
         "error",
@@ -1165,22 +1215,19 @@ fs_rtp_stream_set_transmitter (FsStream *stream,
         "known-source-packet-received",
         G_CALLBACK (_known_source_packet_received),
         self, 0);
-  self->priv->state_changed_handler_id =
-    g_signal_connect_object (st,
-        "state-changed",
-        G_CALLBACK (_state_changed),
-        self, 0);
 
 
   FS_RTP_SESSION_LOCK (session);
   self->priv->stream_transmitter = st;
+  self->priv->bundled = bundled;
   if (self->priv->direction & FS_DIRECTION_SEND)
     self->priv->sending_changed_locked_cb (self,
         self->priv->direction & FS_DIRECTION_SEND,
         self->priv->user_data_for_cb);
   FS_RTP_SESSION_UNLOCK (session);
 
-  if (!fs_stream_transmitter_gather_local_candidates (st, error))
+  /* A shared stream transmitter only gathers once */
+  if (!gathered && !fs_stream_transmitter_gather_local_candidates (st, error))
   {
 
     FS_RTP_SESSION_LOCK (session);
@@ -1496,3 +1543,16 @@ fs_rtp_stream_get_srtp_caps_locked (FsRtpStream *self)
       "srtcp-auth", G_TYPE_STRING, srtcp_auth,
       NULL);
 }
+
+/*
+ * Once the SSRC coming from the known source has been associated with this
+ * stream, the stream transmitter can stop sending us every packet.
+ */
+void
+fs_rtp_stream_set_source_validated_locked (FsRtpStream *self,
+    gboolean validated)
+{
+  if (self->priv->stream_transmitter)
+    fs_stream_transmitter_set_source_validated (
+        self->priv->stream_transmitter, validated);
+}
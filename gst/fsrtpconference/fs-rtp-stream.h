@@ -28,6 +28,7 @@
 #include <farstream/fs-stream.h>
 #include <farstream/fs-stream-transmitter.h>
 
+#include "fs-rtp-bundle.h"
 #include "fs-rtp-participant.h"
 #include "fs-rtp-session.h"
 #include "fs-rtp-substream.h"
@@ -100,7 +101,8 @@ typedef void (*stream_ssrc_added_cb) (FsRtpStream *stream, guint32 ssrc,
 typedef FsStreamTransmitter* (*stream_get_new_stream_transmitter_cb) (
   FsRtpStream *stream,  FsParticipant *participant,
   const gchar *transmitter_name, GParameter *parameters, guint n_parameters,
-  GError **error, gpointer user_data);
+  const FsRtpBundleStreamFuncs *bundle_funcs,
+  gboolean *bundled, gboolean *gathered, GError **error, gpointer user_data);
 typedef gboolean (*stream_decrypt_clear_locked_cb) (FsRtpStream *stream,
     gpointer user_data);
 
@@ -131,6 +133,10 @@ validate_srtp_parameters (GstStructure *parameters,
 GstCaps *
 fs_rtp_stream_get_srtp_caps_locked (FsRtpStream *self);
 
+void
+fs_rtp_stream_set_source_validated_locked (FsRtpStream *self,
+    gboolean validated);
+
 G_END_DECLS
 
 #endif /* __FS_RTP_STREAM_H__ */
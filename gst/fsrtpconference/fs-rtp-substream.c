@@ -120,9 +120,7 @@ struct _FsRtpSubStreamPrivate {
 
   /* Protected by the this mutex */
   GMutex mutex;
-  GstClockID no_rtcp_timeout_id;
-  GstClockTime next_no_rtcp_timeout;
-  GThread *no_rtcp_timeout_thread;
+  FsRtpTimer *no_rtcp_timer;
 
   /* Can only be used while using the lock */
   GRWLock stopped_lock;
@@ -416,115 +414,113 @@ fs_rtp_sub_stream_init (FsRtpSubStream *self)
 }
 
 
-static gpointer
-no_rtcp_timeout_func (gpointer user_data)
-{
-  FsRtpSubStream *self = FS_RTP_SUB_STREAM (user_data);
-  GstClock *sysclock = NULL;
-  GstClockID id;
-  gboolean emit = TRUE;
+typedef struct {
+  FsRtpSubStream *self;
+  FsRtpTimer *timer;
+} NoRtcpTimeout;
 
-  sysclock = gst_system_clock_obtain ();
-  if (sysclock == NULL)
-    goto no_sysclock;
+static void
+no_rtcp_timedout_task (gpointer data, gpointer user_data)
+{
+  NoRtcpTimeout *timeout = data;
+  FsRtpSubStream *self = timeout->self;
+  gboolean emit;
 
+  /* If the timer was stopped or restarted in the meantime, this is not the
+   * current timer anymore */
   FS_RTP_SUB_STREAM_LOCK(self);
-  id = self->priv->no_rtcp_timeout_id = gst_clock_new_single_shot_id (sysclock,
-      self->priv->next_no_rtcp_timeout);
-
+  emit = (self->priv->no_rtcp_timer == timeout->timer);
   FS_RTP_SUB_STREAM_UNLOCK(self);
-  gst_clock_id_wait (id, NULL);
-  FS_RTP_SUB_STREAM_LOCK(self);
 
-  gst_clock_id_unref (id);
-  self->priv->no_rtcp_timeout_id = NULL;
-
-  if (self->priv->next_no_rtcp_timeout == 0)
-    emit = FALSE;
+  if (emit)
+    g_signal_emit (self, signals[NO_RTCP_TIMEDOUT], 0);
 
-  FS_RTP_SUB_STREAM_UNLOCK(self);
+  fs_rtp_timer_unref (timeout->timer);
+  g_object_unref (self);
+  g_slice_free (NoRtcpTimeout, timeout);
+}
 
-  gst_object_unref (sysclock);
+/*
+ * The handlers of no-rtcp-timedout attach the substream to a stream, which
+ * emits src-pad-added to the application, so they can't run on the timer
+ * wheel thread. The timeouts are emitted from a pool shared by all the
+ * conferences instead.
+ */
 
-  if (emit)
-    g_signal_emit (self, signals[NO_RTCP_TIMEDOUT], 0);
+static GThreadPool *
+get_no_rtcp_timeout_pool (void)
+{
+  static gsize pool = 0;
 
-  return NULL;
+  if (g_once_init_enter (&pool))
+    g_once_init_leave (&pool, (gsize) g_thread_pool_new (
+            no_rtcp_timedout_task, NULL, -1, FALSE, NULL));
 
- no_sysclock:
-  {
-    fs_rtp_sub_stream_emit_error (self, FS_ERROR_INTERNAL,
-        "Could not get system clock",
-        "Could not get system clock");
-    return NULL;
-  }
+  return (GThreadPool *) pool;
 }
 
-static gboolean
-fs_rtp_sub_stream_start_no_rtcp_timeout_thread (FsRtpSubStream *self,
-    GError **error)
+static void
+no_rtcp_timeout_func (FsRtpTimer *timer, GstClockTime time, gpointer user_data)
 {
-  gboolean res = TRUE;
-  GstClock *sysclock = NULL;
+  FsRtpSubStream *self = FS_RTP_SUB_STREAM (user_data);
+  NoRtcpTimeout *timeout = NULL;
 
-  sysclock = gst_system_clock_obtain ();
-  if (sysclock == NULL)
+  FS_RTP_SUB_STREAM_LOCK(self);
+  if (self->priv->no_rtcp_timer == timer)
   {
-    g_set_error (error, FS_ERROR, FS_ERROR_INTERNAL,
-        "Could not obtain gst system clock");
-    return FALSE;
+    timeout = g_slice_new (NoRtcpTimeout);
+    timeout->self = g_object_ref (self);
+    timeout->timer = fs_rtp_timer_ref (timer);
   }
+  FS_RTP_SUB_STREAM_UNLOCK(self);
 
-  FS_RTP_SESSION_LOCK (self->priv->session);
-  FS_RTP_SUB_STREAM_LOCK(self);
-
-  self->priv->next_no_rtcp_timeout = gst_clock_get_time (sysclock) +
-    (self->no_rtcp_timeout * GST_MSECOND);
-
-  gst_object_unref (sysclock);
+  if (timeout)
+    g_thread_pool_push (get_no_rtcp_timeout_pool (), timeout, NULL);
+}
 
-  if (self->priv->no_rtcp_timeout_thread == NULL) {
-    /* only create a new thread if the old one was stopped. Otherwise we can
-     * just reuse the currently running one. */
-    self->priv->no_rtcp_timeout_thread =
-        g_thread_try_new ("no rtcp timeout", no_rtcp_timeout_func, self, error);
-  }
+static void
+fs_rtp_sub_stream_start_no_rtcp_timeout (FsRtpSubStream *self)
+{
+  FsRtpTimerWheel *wheel =
+      fs_rtp_conference_get_timer_wheel (self->priv->conference);
+  FsRtpTimer *old_timer;
 
-  res = (self->priv->no_rtcp_timeout_thread != NULL);
+  FS_RTP_SESSION_LOCK (self->priv->session);
+  FS_RTP_SUB_STREAM_LOCK(self);
 
-  if (res == FALSE && error && *error == NULL)
-    g_set_error (error, FS_ERROR, FS_ERROR_INTERNAL, "Unknown error creating"
-        " thread");
+  old_timer = self->priv->no_rtcp_timer;
+  self->priv->no_rtcp_timer = fs_rtp_timer_wheel_add (wheel,
+      fs_rtp_timer_wheel_get_time (wheel) +
+      (self->no_rtcp_timeout * GST_MSECOND),
+      no_rtcp_timeout_func, self, NULL);
 
   FS_RTP_SUB_STREAM_UNLOCK(self);
   FS_RTP_SESSION_UNLOCK (self->priv->session);
 
-  return res;
+  if (old_timer)
+  {
+    fs_rtp_timer_cancel (old_timer);
+    fs_rtp_timer_unref (old_timer);
+  }
 }
 
 static void
-fs_rtp_sub_stream_stop_no_rtcp_timeout_thread (FsRtpSubStream *self)
+fs_rtp_sub_stream_stop_no_rtcp_timeout (FsRtpSubStream *self)
 {
+  FsRtpTimer *timer;
+
   FS_RTP_SUB_STREAM_LOCK(self);
-  self->priv->next_no_rtcp_timeout = 0;
-  if (self->priv->no_rtcp_timeout_id)
-    gst_clock_id_unschedule (self->priv->no_rtcp_timeout_id);
+  timer = self->priv->no_rtcp_timer;
+  self->priv->no_rtcp_timer = NULL;
+  FS_RTP_SUB_STREAM_UNLOCK(self);
 
-  if (self->priv->no_rtcp_timeout_thread == NULL)
-  {
-    FS_RTP_SUB_STREAM_UNLOCK(self);
+  if (timer == NULL)
     return;
-  }
-  else
-  {
-    FS_RTP_SUB_STREAM_UNLOCK(self);
-  }
 
-  g_thread_join (self->priv->no_rtcp_timeout_thread);
-
-  FS_RTP_SUB_STREAM_LOCK(self);
-  self->priv->no_rtcp_timeout_thread = NULL;
-  FS_RTP_SUB_STREAM_UNLOCK(self);
+  /* The callback uses the substream without holding a reference, so wait
+   * for it to return */
+  fs_rtp_timer_cancel_sync (timer);
+  fs_rtp_timer_unref (timer);
 }
 
 static void
@@ -682,9 +678,7 @@ fs_rtp_sub_stream_constructed (GObject *object)
   }
 
   if (self->no_rtcp_timeout > 0)
-    if (!fs_rtp_sub_stream_start_no_rtcp_timeout_thread (self,
-            &self->priv->construction_error))
-      return;
+    fs_rtp_sub_stream_start_no_rtcp_timeout (self);
 
   GST_CALL_PARENT (G_OBJECT_CLASS, constructed, (object));
 }
@@ -695,7 +689,7 @@ fs_rtp_sub_stream_dispose (GObject *object)
 {
   FsRtpSubStream *self = FS_RTP_SUB_STREAM (object);
 
-  fs_rtp_sub_stream_stop_no_rtcp_timeout_thread (self);
+  fs_rtp_sub_stream_stop_no_rtcp_timeout (self);
 
   if (self->priv->output_ghostpad) {
     gst_element_remove_pad (GST_ELEMENT (self->priv->conference),
@@ -43,7 +43,7 @@
 GST_DEBUG_CATEGORY_STATIC (fsrtpconference_tfrc);
 #define GST_CAT_DEFAULT fsrtpconference_tfrc
 
-G_DEFINE_TYPE (FsRtpTfrc, fs_rtp_tfrc, GST_TYPE_OBJECT);
+G_DEFINE_TYPE (FsRtpTfrc, fs_rtp_tfrc, FS_TYPE_RTP_CONGESTION_CONTROL);
 
 /* props */
 enum
@@ -62,14 +62,25 @@ static void fs_rtp_tfrc_set_property (GObject *object,
     const GValue *value,
     GParamSpec *pspec);
 static void fs_rtp_tfrc_dispose (GObject *object);
+static void fs_rtp_tfrc_destroy (FsRtpCongestionControl *cc);
+static void fs_rtp_tfrc_codecs_updated (FsRtpCongestionControl *cc,
+    GList *codec_associations,
+    GList *header_extensions);
+static gboolean fs_rtp_tfrc_is_enabled (FsRtpCongestionControl *cc,
+    guint pt);
+static void fs_rtp_tfrc_warm_start (FsRtpCongestionControl *cc,
+    guint bitrate);
+static gboolean fs_rtp_tfrc_get_path (FsRtpCongestionControl *cc,
+    guint *rtt,
+    gdouble *loss);
 
 static void fs_rtp_tfrc_update_sender_timer_locked (
   FsRtpTfrc *self,
   struct TrackedSource *src,
   guint64 now);
 
-static gboolean feedback_timer_expired (GstClock *clock, GstClockTime time,
-    GstClockID id, gpointer user_data);
+static void feedback_timer_expired (FsRtpTimer *timer, GstClockTime time,
+    gpointer user_data);
 
 static void fs_rtp_tfrc_clear_sender (FsRtpTfrc *self);
 
@@ -77,26 +88,23 @@ static void
 fs_rtp_tfrc_class_init (FsRtpTfrcClass *klass)
 {
   GObjectClass *gobject_class;
+  FsRtpCongestionControlClass *cc_class;
 
   gobject_class = (GObjectClass *) klass;
+  cc_class = (FsRtpCongestionControlClass *) klass;
 
   gobject_class->get_property = fs_rtp_tfrc_get_property;
   gobject_class->set_property = fs_rtp_tfrc_set_property;
   gobject_class->dispose = fs_rtp_tfrc_dispose;
 
-  g_object_class_install_property (gobject_class,
-      PROP_BITRATE,
-      g_param_spec_uint ("bitrate",
-          "The bitrate at which data should be sent",
-          "The bitrate that the session should try to send at in bits/sec",
-          0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
-
- g_object_class_install_property (gobject_class,
-      PROP_SENDING,
-      g_param_spec_boolean ("sending",
-          "The bitrate at which data should be sent",
-          "The bitrate that the session should try to send at in bits/sec",
-          FALSE, G_PARAM_WRITABLE | G_PARAM_STATIC_STRINGS));
+  cc_class->destroy = fs_rtp_tfrc_destroy;
+  cc_class->codecs_updated = fs_rtp_tfrc_codecs_updated;
+  cc_class->is_enabled = fs_rtp_tfrc_is_enabled;
+  cc_class->warm_start = fs_rtp_tfrc_warm_start;
+  cc_class->get_path = fs_rtp_tfrc_get_path;
+
+  g_object_class_override_property (gobject_class, PROP_BITRATE, "bitrate");
+  g_object_class_override_property (gobject_class, PROP_SENDING, "sending");
 }
 
 
@@ -115,16 +123,16 @@ tracked_src_new (FsRtpTfrc *self)
 static void
 tracked_src_free (struct TrackedSource *src)
 {
-  if (src->sender_id)
+  if (src->sender_timer)
   {
-    gst_clock_id_unschedule (src->sender_id);
-    gst_clock_id_unref (src->sender_id);
+    fs_rtp_timer_cancel (src->sender_timer);
+    fs_rtp_timer_unref (src->sender_timer);
   }
 
-  if (src->receiver_id)
+  if (src->receiver_timer)
   {
-    gst_clock_id_unschedule (src->receiver_id);
-    gst_clock_id_unref (src->receiver_id);
+    fs_rtp_timer_cancel (src->receiver_timer);
+    fs_rtp_timer_unref (src->receiver_timer);
   }
 
   if (src->rtpsource)
@@ -135,9 +143,6 @@ tracked_src_free (struct TrackedSource *src)
   if (src->receiver)
     tfrc_receiver_free (src->receiver);
 
-  if (src->idl)
-    tfrc_is_data_limited_free (src->idl);
-
   g_slice_free (struct TrackedSource, src);
 }
 
@@ -152,6 +157,7 @@ fs_rtp_tfrc_init (FsRtpTfrc *self)
 
   self->tfrc_sources = g_hash_table_new_full (g_direct_hash,
       g_direct_equal, NULL, (GDestroyNotify) tracked_src_free);
+  self->send_log = tfrc_send_log_new (1460);
 
   fs_rtp_tfrc_clear_sender (self);
   self->send_bitrate = tfrc_sender_get_send_rate (NULL)  * 8;
@@ -163,9 +169,11 @@ fs_rtp_tfrc_init (FsRtpTfrc *self)
   self->systemclock = gst_system_clock_obtain ();
 }
 
-void
-fs_rtp_tfrc_destroy (FsRtpTfrc *self)
+static void
+fs_rtp_tfrc_destroy (FsRtpCongestionControl *cc)
 {
+  FsRtpTfrc *self = FS_RTP_TFRC (cc);
+
   GST_OBJECT_LOCK (self);
 
   if (self->modder_check_probe_id)
@@ -194,21 +202,49 @@ fs_rtp_tfrc_destroy (FsRtpTfrc *self)
   GST_OBJECT_UNLOCK (self);
 }
 
+static void
+tracked_src_cancel_timers_sync (gpointer key, gpointer value,
+    gpointer user_data)
+{
+  struct TrackedSource *src = value;
+
+  if (src->sender_timer)
+    fs_rtp_timer_cancel_sync (src->sender_timer);
+  if (src->receiver_timer)
+    fs_rtp_timer_cancel_sync (src->receiver_timer);
+}
+
 static void
 fs_rtp_tfrc_dispose (GObject *object)
 {
   FsRtpTfrc *self = FS_RTP_TFRC (object);
+  GHashTable *tfrc_sources;
+  struct TrackedSource *initial_src;
 
   GST_OBJECT_LOCK (self);
-
-  if (self->tfrc_sources)
-    g_hash_table_destroy (self->tfrc_sources);
+  tfrc_sources = self->tfrc_sources;
   self->tfrc_sources = NULL;
   self->last_src = NULL;
-
-  if (self->initial_src)
-    tracked_src_free (self->initial_src);
+  initial_src = self->initial_src;
   self->initial_src = NULL;
+  GST_OBJECT_UNLOCK (self);
+
+  /* The timer callbacks take the object lock, so wait for the ones that
+   * may be running on the wheel thread without holding it, they find no
+   * source once they get it. After this, nothing uses the wheel anymore.
+   */
+  if (tfrc_sources)
+  {
+    g_hash_table_foreach (tfrc_sources, tracked_src_cancel_timers_sync, NULL);
+    g_hash_table_destroy (tfrc_sources);
+  }
+  if (initial_src)
+  {
+    tracked_src_cancel_timers_sync (NULL, initial_src, NULL);
+    tracked_src_free (initial_src);
+  }
+
+  GST_OBJECT_LOCK (self);
 
   if (self->packet_modder)
   {
@@ -232,6 +268,14 @@ fs_rtp_tfrc_dispose (GObject *object)
   gst_object_unref (self->systemclock);
   self->systemclock = NULL;
 
+  if (self->timer_wheel)
+    fs_rtp_timer_wheel_unref (self->timer_wheel);
+  self->timer_wheel = NULL;
+
+  if (self->send_log)
+    tfrc_send_log_free (self->send_log);
+  self->send_log = NULL;
+
   GST_OBJECT_UNLOCK (self);
 
   if (G_OBJECT_CLASS (fs_rtp_tfrc_parent_class)->dispose)
@@ -271,23 +315,17 @@ clear_sender (gpointer key, gpointer value, gpointer user_data)
   src->fb_last_ts = 0;
   src->fb_ts_cycles = 0;
 
-  if (src->sender_id)
+  if (src->sender_timer)
   {
-    gst_clock_id_unschedule (src->sender_id);
-    gst_clock_id_unref (src->sender_id);
-    src->sender_id = 0;
+    fs_rtp_timer_cancel (src->sender_timer);
+    fs_rtp_timer_unref (src->sender_timer);
+    src->sender_timer = NULL;
   }
 
   if (src->sender)
     tfrc_sender_free (src->sender);
   src->sender = NULL;
 
-  if (src->idl)
-  {
-    tfrc_is_data_limited_free (src->idl);
-    src->idl = NULL;
-  }
-
   if (self->last_src == src)
     self->last_src = NULL;
 
@@ -304,9 +342,6 @@ fs_rtp_tfrc_clear_sender (FsRtpTfrc *self)
   if (self->initial_src)
     if (clear_sender (NULL, self->initial_src, self))
       self->initial_src = NULL;
-
-  self->last_sent_ts = GST_CLOCK_TIME_NONE;
-  self->byte_reservoir = 1500; /* About one packet */
 }
 
 static void
@@ -341,7 +376,12 @@ fs_rtp_tfrc_update_bitrate_locked (FsRtpTfrc *self, const gchar *source)
   gboolean ret;
 
   if (self->last_src && self->last_src->sender)
+  {
+    tfrc_sender_sync_send_log (self->last_src->sender, self->send_log);
     byterate = tfrc_sender_get_send_rate (self->last_src->sender);
+  }
+  else if (self->warm_start_rate)
+    byterate = self->warm_start_rate;
   else
     byterate = tfrc_sender_get_send_rate (NULL);
 
@@ -453,33 +493,26 @@ fs_rtp_tfrc_set_receiver_timer_locked (FsRtpTfrc *self,
     struct TrackedSource *src, guint64 now)
 {
   guint64 expiry = tfrc_receiver_get_feedback_timer_expiry (src->receiver);
-  GstClockReturn cret;
 
   if (expiry == 0)
     return;
 
-  if (src->receiver_id)
+  if (src->receiver_timer)
   {
     if (src->next_feedback_timer <= expiry)
       return;
 
-    gst_clock_id_unschedule (src->receiver_id);
-    gst_clock_id_unref (src->receiver_id);
-    src->receiver_id = NULL;
+    fs_rtp_timer_cancel (src->receiver_timer);
+    fs_rtp_timer_unref (src->receiver_timer);
+    src->receiver_timer = NULL;
   }
   src->next_feedback_timer = expiry;
 
   g_assert (expiry != now);
 
-  src->receiver_id = gst_clock_new_single_shot_id (self->systemclock,
-      expiry * GST_USECOND);
-
-  cret = gst_clock_id_wait_async (src->receiver_id, feedback_timer_expired,
+  src->receiver_timer = fs_rtp_timer_wheel_add (self->timer_wheel,
+      expiry * GST_USECOND, feedback_timer_expired,
       build_timer_data (self, src->ssrc), free_timer_data);
-  if (cret != GST_CLOCK_OK)
-    GST_ERROR_OBJECT (self,
-        "Could not schedule feedback time for %" G_GUINT64_FORMAT
-        " (now %" G_GUINT64_FORMAT ") error: %d", expiry, now, cret);
 }
 
 static void
@@ -488,11 +521,11 @@ fs_rtp_tfrc_receiver_timer_func_locked (FsRtpTfrc *self,
 {
   guint64 expiry;
 
-  if (src->receiver_id)
+  if (src->receiver_timer)
   {
-    gst_clock_id_unschedule (src->receiver_id);
-    gst_clock_id_unref (src->receiver_id);
-    src->receiver_id = NULL;
+    fs_rtp_timer_cancel (src->receiver_timer);
+    fs_rtp_timer_unref (src->receiver_timer);
+    src->receiver_timer = NULL;
   }
 
   expiry = tfrc_receiver_get_feedback_timer_expiry (src->receiver);
@@ -509,30 +542,31 @@ fs_rtp_tfrc_receiver_timer_func_locked (FsRtpTfrc *self,
   }
 }
 
-static gboolean
-feedback_timer_expired (GstClock *clock, GstClockTime time, GstClockID id,
+static void
+feedback_timer_expired (FsRtpTimer *timer, GstClockTime time,
   gpointer user_data)
 {
   struct TimerData *td = user_data;
   struct TrackedSource *src;
   guint64 now;
 
-  if (time == GST_CLOCK_TIME_NONE)
-    return FALSE;
-
   GST_OBJECT_LOCK (td->self);
 
+  if (G_UNLIKELY (!td->self->tfrc_sources))
+  {
+    GST_OBJECT_UNLOCK (td->self);
+    return;
+  }
+
   src = g_hash_table_lookup (td->self->tfrc_sources,
       GUINT_TO_POINTER (td->ssrc));
 
   now = fs_rtp_tfrc_get_now (td->self);
 
-  if (G_LIKELY (src && src->receiver_id == id))
+  if (G_LIKELY (src && src->receiver_timer == timer))
     fs_rtp_tfrc_receiver_timer_func_locked (td->self, src, now);
 
   GST_OBJECT_UNLOCK (td->self);
-
-  return FALSE;
 }
 
 
@@ -711,11 +745,11 @@ incoming_rtp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
     src->last_rtt = 0;
     tfrc_receiver_free (src->receiver);
     src->receiver = tfrc_receiver_new (now);
-    if (src->receiver_id)
+    if (src->receiver_timer)
     {
-      gst_clock_id_unschedule (src->receiver_id);
-      gst_clock_id_unref (src->receiver_id);
-      src->receiver_id = NULL;
+      fs_rtp_timer_cancel (src->receiver_timer);
+      fs_rtp_timer_unref (src->receiver_timer);
+      src->receiver_timer = NULL;
     }
   }
   seq_delta = seq - src->last_seq;
@@ -770,8 +804,8 @@ out_no_header:
   goto out;
 }
 
-static gboolean
-no_feedback_timer_expired (GstClock *clock, GstClockTime time, GstClockID id,
+static void
+no_feedback_timer_expired (FsRtpTimer *timer, GstClockTime time,
   gpointer user_data)
 {
   struct TimerData *td = user_data;
@@ -779,12 +813,9 @@ no_feedback_timer_expired (GstClock *clock, GstClockTime time, GstClockID id,
   guint64 now;
   gboolean notify = FALSE;
 
-  if (time == GST_CLOCK_TIME_NONE)
-    return FALSE;
-
   GST_OBJECT_LOCK (td->self);
 
-  if (!td->self->sending)
+  if (!td->self->sending || !td->self->tfrc_sources)
     goto out;
 
   src = g_hash_table_lookup (td->self->tfrc_sources,
@@ -793,7 +824,7 @@ no_feedback_timer_expired (GstClock *clock, GstClockTime time, GstClockID id,
   if (!src)
     goto out;
 
-  if (src->sender_id != id)
+  if (src->sender_timer != timer)
     goto out;
 
   now = fs_rtp_tfrc_get_now (td->self);
@@ -809,8 +840,6 @@ out:
 
   if (notify)
     g_object_notify (G_OBJECT (td->self), "bitrate");
-
-  return FALSE;
 }
 
 static void
@@ -818,13 +847,12 @@ fs_rtp_tfrc_update_sender_timer_locked (FsRtpTfrc *self,
     struct TrackedSource *src, guint64 now)
 {
   guint64 expiry;
-  GstClockReturn cret;
 
-  if (src->sender_id)
+  if (src->sender_timer)
   {
-    gst_clock_id_unschedule (src->sender_id);
-    gst_clock_id_unref (src->sender_id);
-    src->sender_id = NULL;
+    fs_rtp_timer_cancel (src->sender_timer);
+    fs_rtp_timer_unref (src->sender_timer);
+    src->sender_timer = NULL;
   }
 
   if (src->sender == NULL)
@@ -834,21 +862,14 @@ fs_rtp_tfrc_update_sender_timer_locked (FsRtpTfrc *self,
 
   if (expiry <= now)
   {
+    tfrc_sender_sync_send_log (src->sender, self->send_log);
     tfrc_sender_no_feedback_timer_expired (src->sender, now);
     expiry = tfrc_sender_get_no_feedback_timer_expiry (src->sender);
   }
 
-  src->sender_id = gst_clock_new_single_shot_id (self->systemclock,
-      expiry * GST_USECOND);
-
-  cret = gst_clock_id_wait_async (src->sender_id,
-      no_feedback_timer_expired, build_timer_data (self, src->ssrc),
-      free_timer_data);
-  if (cret != GST_CLOCK_OK)
-    GST_ERROR_OBJECT (self,
-        "Could not schedule feedback time for %" G_GUINT64_FORMAT
-        " (now %" G_GUINT64_FORMAT ") error: %d",
-        expiry, now, cret);
+  src->sender_timer = fs_rtp_timer_wheel_add (self->timer_wheel,
+      expiry * GST_USECOND, no_feedback_timer_expired,
+      build_timer_data (self, src->ssrc), free_timer_data);
 }
 
 static void
@@ -856,7 +877,9 @@ tracked_src_add_sender (struct TrackedSource *src, guint64 now,
   guint initial_rate)
 {
   src->sender = tfrc_sender_new (1460, now, initial_rate);
-  src->idl = tfrc_is_data_limited_new (now);
+  if (src->self->warm_start_rate)
+    tfrc_sender_warm_start (src->sender, src->self->warm_start_rate);
+  tfrc_sender_sync_send_log (src->sender, src->self->send_log);
   src->send_ts_base = now;
 }
 
@@ -981,10 +1004,10 @@ incoming_rtcp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
       if (G_UNLIKELY (tfrc_sender_get_averaged_rtt (src->sender) == 0))
         tfrc_sender_on_first_rtt (src->sender, now);
 
-      is_data_limited =
-          tfrc_is_data_limited_received_feedback (src->idl, now, ts,
-              tfrc_sender_get_averaged_rtt (src->sender));
+      is_data_limited = tfrc_send_log_is_data_limited (self->send_log, ts,
+          tfrc_sender_get_averaged_rtt (src->sender));
 
+      tfrc_sender_sync_send_log (src->sender, self->send_log);
       tfrc_sender_on_feedback_packet (src->sender, now, rtt, x_recv,
           loss_event_rate, is_data_limited);
 
@@ -1010,14 +1033,19 @@ out:
   return GST_PAD_PROBE_OK;
 }
 
-static GstClockTime
-fs_rtp_tfrc_get_sync_time (FsRtpPacketModder *modder,
-    GstBuffer *buffer, gpointer user_data)
+/*
+ * The packet modder paces the packets at the allowed sending rate of the
+ * receiver that sent the last feedback. When the encoder produces more than
+ * that, it drops whole frames instead of letting the latency grow until the
+ * bitrate change reaches the encoder.
+ */
+
+#define PACING_LATENCY_BUDGET (300 * GST_MSECOND)
+
+static guint
+fs_rtp_tfrc_get_pacing_rate (FsRtpPacketModder *modder, gpointer user_data)
 {
   FsRtpTfrc *self = FS_RTP_TFRC (user_data);
-  GstClockTime sync_time = GST_BUFFER_TIMESTAMP (buffer);
-  gint bytes_for_one_rtt = 0;
-  guint size = 0;
   guint send_rate;
 
   GST_OBJECT_LOCK (self);
@@ -1025,79 +1053,37 @@ fs_rtp_tfrc_get_sync_time (FsRtpPacketModder *modder,
   if (self->extension_type == EXTENSION_NONE || !self->sending)
   {
     GST_OBJECT_UNLOCK (self);
-    return GST_CLOCK_TIME_NONE;
+    return 0;
   }
 
   if (self->last_src && self->last_src->sender)
   {
+    tfrc_sender_sync_send_log (self->last_src->sender, self->send_log);
     send_rate = tfrc_sender_get_send_rate (self->last_src->sender);
-    bytes_for_one_rtt = send_rate *
-        tfrc_sender_get_averaged_rtt (self->last_src->sender);
   }
   else
   {
     send_rate = tfrc_sender_get_send_rate (NULL);
-    bytes_for_one_rtt = 0;
-  }
-
-  size = gst_buffer_get_size (buffer) + 10;
-
-  if (GST_BUFFER_TIMESTAMP_IS_VALID (buffer))
-  {
-    if (GST_CLOCK_TIME_IS_VALID (self->last_sent_ts) &&
-        self->last_sent_ts < GST_BUFFER_TIMESTAMP (buffer))
-      self->byte_reservoir +=
-        gst_util_uint64_scale (
-            (GST_BUFFER_TIMESTAMP (buffer) - self->last_sent_ts),
-            send_rate,
-            GST_SECOND);
-    self->last_sent_ts = GST_BUFFER_TIMESTAMP (buffer);
-
-    if (bytes_for_one_rtt &&
-        self->byte_reservoir > bytes_for_one_rtt)
-      self->byte_reservoir = bytes_for_one_rtt;
-  }
-
-  self->byte_reservoir -= size;
-
-  if (GST_BUFFER_TIMESTAMP_IS_VALID (buffer) &&
-      self->byte_reservoir < 0)
-  {
-    GstClockTimeDiff diff = 0;
-
-    diff = gst_util_uint64_scale_int (GST_SECOND,
-        -self->byte_reservoir, send_rate);
-    g_assert (diff > 0);
-
-
-    GST_LOG_OBJECT (self, "Delaying packet by %"GST_TIME_FORMAT
-        " = 1sec * bytes %d / rate %u",
-        GST_TIME_ARGS (diff), self->byte_reservoir,
-        send_rate);
-
-    GST_BUFFER_TIMESTAMP (buffer) += diff;
   }
 
   GST_OBJECT_UNLOCK (self);
 
-
-  return sync_time;
+  return send_rate;
 }
 
 
+/* The extension carrying the RTT and the send timestamp */
+#define EXTENSION_LEN (7)
+
 static GstBuffer *
 fs_rtp_tfrc_outgoing_packets (FsRtpPacketModder *modder,
     GstBuffer *buffer, GstClockTime buffer_ts, gpointer user_data)
 {
   FsRtpTfrc *self = FS_RTP_TFRC (user_data);
-  gchar data[7];
+  guint8 data[EXTENSION_LEN];
   guint64 now;
-  GstBuffer *headerbuf;
   GstBuffer *newbuf;
   gboolean is_data_limited;
-  gsize header_size;
-  gsize new_header_size;
-  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
 
   if (!GST_CLOCK_TIME_IS_VALID (buffer_ts))
     return buffer;
@@ -1130,79 +1116,26 @@ fs_rtp_tfrc_outgoing_packets (FsRtpPacketModder *modder,
       ONE_32BIT_CYCLE)
     self->last_src->send_ts_cycles += ONE_32BIT_CYCLE;
 
+  /* The pacer only moves the timestamp of the packets it held back */
   is_data_limited = (GST_BUFFER_PTS (buffer) == buffer_ts);
 
-  gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer);
-  header_size = gst_rtp_buffer_get_header_len (&rtpbuffer);
-  gst_rtp_buffer_unmap (&rtpbuffer);
-
-  headerbuf = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_ALL, 0,
-      header_size);
-  headerbuf = gst_buffer_make_writable (headerbuf);
-  gst_buffer_set_size (headerbuf, header_size + 16);
-
-  gst_rtp_buffer_map (headerbuf, GST_MAP_READWRITE, &rtpbuffer);
-
-  if (self->extension_type == EXTENSION_ONE_BYTE)
+  newbuf = fs_rtp_packet_modder_add_extension (buffer, self->extension_type,
+      self->extension_id, data, EXTENSION_LEN);
+  if (!newbuf)
   {
-    if (!gst_rtp_buffer_add_extension_onebyte_header (&rtpbuffer,
-            self->extension_id, data, 7))
-      GST_WARNING_OBJECT (self,
-          "Could not add extension to RTP header buf %p", headerbuf);
+    GST_WARNING_OBJECT (self, "Could not add the TFRC extension to an"
+        " invalid RTP packet, sending it as is");
+    newbuf = buffer;
   }
-  else if (self->extension_type == EXTENSION_TWO_BYTES)
-  {
-    if (!gst_rtp_buffer_add_extension_twobytes_header (&rtpbuffer, 0,
-            self->extension_id, data, 7))
-      GST_WARNING_OBJECT (self,
-          "Could not add extension to RTP header in list %p", headerbuf);
-  }
-
-  /* FIXME:
-   * This will break if any padding is applied
-   */
-  new_header_size = gst_rtp_buffer_get_header_len (&rtpbuffer);
-
-  gst_rtp_buffer_unmap (&rtpbuffer);
-  gst_buffer_set_size (headerbuf, new_header_size);
-
-  /* append_region eats a ref */
-  gst_buffer_ref (buffer);
-  newbuf = gst_buffer_append_region (headerbuf, buffer, header_size, -1);
 
   GST_LOG_OBJECT (self, "Sending RTP");
 
-  if (g_hash_table_size (self->tfrc_sources))
-  {
-    GHashTableIter ht_iter;
-    struct TrackedSource *src;
-
-    g_hash_table_iter_init (&ht_iter, self->tfrc_sources);
-
-    while (g_hash_table_iter_next (&ht_iter, NULL,
-            (gpointer *) &src))
-    {
-      if (src->sender)
-      {
-        if (!is_data_limited)
-          tfrc_is_data_limited_not_limited_now (src->idl, now);
-        tfrc_sender_sending_packet (src->sender, gst_buffer_get_size (newbuf));
-      }
-    }
-  }
-  if (self->initial_src)
-  {
-    if (!is_data_limited)
-      tfrc_is_data_limited_not_limited_now (self->initial_src->idl, now);
-    tfrc_sender_sending_packet (self->initial_src->sender,
-        gst_buffer_get_size (newbuf));
-  }
-
+  /* The senders of the sources catch up when they need it */
+  tfrc_send_log_sending_packet (self->send_log, now,
+      gst_buffer_get_size (newbuf), is_data_limited);
 
   GST_OBJECT_UNLOCK (self);
 
-  gst_buffer_unref (buffer);
-
   return newbuf;
 }
 
@@ -1229,8 +1162,18 @@ send_rtp_pad_blocked (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
     GstPad *modder_pad;
 
     self->packet_modder = GST_ELEMENT (fs_rtp_packet_modder_new (
-          fs_rtp_tfrc_outgoing_packets, fs_rtp_tfrc_get_sync_time, self));
+          fs_rtp_tfrc_outgoing_packets, NULL, self));
     g_object_ref (self->packet_modder);
+    fs_rtp_packet_modder_set_pacing (
+        FS_RTP_PACKET_MODDER (self->packet_modder),
+        fs_rtp_tfrc_get_pacing_rate, 0);
+    g_object_set (self->packet_modder,
+        "latency-budget", (guint64) PACING_LATENCY_BUDGET,
+        NULL);
+    fs_rtp_packet_modder_reserve_prefix (
+        FS_RTP_PACKET_MODDER (self->packet_modder),
+        fs_rtp_packet_modder_get_extension_size (EXTENSION_TWO_BYTES,
+            EXTENSION_LEN));
 
     if (!gst_bin_add (self->parent_bin, self->packet_modder))
     {
@@ -1346,6 +1289,8 @@ fs_rtp_tfrc_new (FsRtpSession *fsrtpsession)
 
   self->rtpsession = fs_rtp_session_get_rtpbin_internal_session (fsrtpsession);
   self->parent_bin = GST_BIN (fs_rtp_session_get_conference (fsrtpsession));
+  self->timer_wheel = fs_rtp_timer_wheel_ref (
+      fs_rtp_conference_get_timer_wheel (FS_RTP_CONFERENCE (self->parent_bin)));
   self->in_rtp_pad = fs_rtp_session_get_rtpbin_recv_rtp_sink (fsrtpsession);;
   self->in_rtcp_pad = fs_rtp_session_get_rtpbin_recv_rtcp_sink (fsrtpsession);;
 
@@ -1434,11 +1379,12 @@ fs_rtp_tfrc_filter_codecs (GList **codec_associations,
 
 }
 
-void
-fs_rtp_tfrc_codecs_updated (FsRtpTfrc *self,
+static void
+fs_rtp_tfrc_codecs_updated (FsRtpCongestionControl *cc,
     GList *codec_associations,
     GList *header_extensions)
 {
+  FsRtpTfrc *self = FS_RTP_TFRC (cc);
   GList *item;
   FsRtpHeaderExtension *hdrext;
 
@@ -1486,13 +1432,12 @@ out:
 }
 
 
-gboolean
-fs_rtp_tfrc_is_enabled (FsRtpTfrc *self, guint pt)
+static gboolean
+fs_rtp_tfrc_is_enabled (FsRtpCongestionControl *cc, guint pt)
 {
+  FsRtpTfrc *self = FS_RTP_TFRC (cc);
   gboolean is_enabled;
 
-  g_return_val_if_fail (pt < 128, FALSE);
-
   GST_OBJECT_LOCK (self);
   is_enabled = (self->extension_type != EXTENSION_NONE) &&
       self->pts[pt];
@@ -1500,3 +1445,45 @@ fs_rtp_tfrc_is_enabled (FsRtpTfrc *self, guint pt)
 
   return is_enabled;
 }
+
+static void
+fs_rtp_tfrc_warm_start (FsRtpCongestionControl *cc, guint bitrate)
+{
+  FsRtpTfrc *self = FS_RTP_TFRC (cc);
+  gboolean notify = FALSE;
+
+  GST_OBJECT_LOCK (self);
+  /* Too late, the sender already knows better */
+  if (self->last_src && self->last_src->sender)
+  {
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+
+  self->warm_start_rate = bitrate / 8;
+  if (fs_rtp_tfrc_update_bitrate_locked (self, "warm start"))
+    notify = TRUE;
+  GST_OBJECT_UNLOCK (self);
+
+  if (notify)
+    g_object_notify (G_OBJECT (self), "bitrate");
+}
+
+static gboolean
+fs_rtp_tfrc_get_path (FsRtpCongestionControl *cc, guint *rtt, gdouble *loss)
+{
+  FsRtpTfrc *self = FS_RTP_TFRC (cc);
+  gboolean ret = FALSE;
+
+  GST_OBJECT_LOCK (self);
+  if (self->last_src && self->last_src->sender &&
+      tfrc_sender_get_averaged_rtt (self->last_src->sender))
+  {
+    *rtt = tfrc_sender_get_averaged_rtt (self->last_src->sender);
+    *loss = tfrc_sender_get_loss_event_rate (self->last_src->sender);
+    ret = TRUE;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return ret;
+}
@@ -31,7 +31,10 @@
 #include "tfrc.h"
 
 #include "fs-rtp-session.h"
+#include "fs-rtp-congestion-control.h"
 #include "fs-rtp-keyunit-manager.h"
+#include "fs-rtp-timer-wheel.h"
+#include "fs-rtp-packet-modder.h"
 
 G_BEGIN_DECLS
 
@@ -53,12 +56,6 @@ G_BEGIN_DECLS
 typedef struct _FsRtpTfrc FsRtpTfrc;
 typedef struct _FsRtpTfrcClass FsRtpTfrcClass;
 
-typedef enum {
-  EXTENSION_NONE,
-  EXTENSION_ONE_BYTE,
-  EXTENSION_TWO_BYTES
-} ExtensionType;
-
 
 struct TrackedSource {
   FsRtpTfrc *self;
@@ -67,15 +64,14 @@ struct TrackedSource {
   GObject *rtpsource;
 
   TfrcSender *sender;
-  GstClockID sender_id;
-  TfrcIsDataLimited *idl;
+  FsRtpTimer *sender_timer;
   guint64 send_ts_base;
   guint64 send_ts_cycles;
   guint32 fb_last_ts;
   guint64 fb_ts_cycles;
 
   TfrcReceiver *receiver;
-  GstClockID receiver_id;
+  FsRtpTimer *receiver_timer;
   guint32 seq_cycles;
   guint32 last_seq;
   guint64 ts_cycles;
@@ -95,9 +91,10 @@ struct TrackedSource {
  */
 struct _FsRtpTfrc
 {
-  GstObject parent;
+  FsRtpCongestionControl parent;
 
   GstClock *systemclock;
+  FsRtpTimerWheel *timer_wheel;
 
   FsRtpSession *fsrtpsession;
   GstBin *parent_bin;
@@ -120,11 +117,14 @@ struct _FsRtpTfrc
   struct TrackedSource *initial_src;
   struct TrackedSource *last_src;
 
+  /* What was sent, shared by the senders of all the sources */
+  TfrcSendLog *send_log;
+
   /* Sender stuff */
   gboolean sending;
-  gint byte_reservoir;
-  GstClockTime last_sent_ts;
   guint send_bitrate;
+  /* in bytes/sec, 0 for the RFC 5348 initial rate */
+  guint warm_start_rate;
 
   ExtensionType extension_type;
   guint extension_id;
@@ -134,7 +134,7 @@ struct _FsRtpTfrc
 
 struct _FsRtpTfrcClass
 {
-  GstObjectClass parent_class;
+  FsRtpCongestionControlClass parent_class;
 };
 
 
@@ -142,17 +142,9 @@ GType fs_rtp_tfrc_get_type (void);
 
 FsRtpTfrc *fs_rtp_tfrc_new (FsRtpSession *fsrtpsession);
 
-void fs_rtp_tfrc_destroy (FsRtpTfrc *self);
-
 void fs_rtp_tfrc_filter_codecs (GList **codec_associations,
     GList **header_extensions);
 
-void fs_rtp_tfrc_codecs_updated (FsRtpTfrc *self,
-    GList *codec_associations,
-    GList *header_extensions);
-
-gboolean fs_rtp_tfrc_is_enabled (FsRtpTfrc *self, guint pt);
-
 G_END_DECLS
 
 #endif /* __FS_RTP_TFRC_H__ */
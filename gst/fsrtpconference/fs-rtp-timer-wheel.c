@@ -0,0 +1,507 @@
+/*
+ * Farstream - Farstream RTP Timer Wheel
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rtp-timer-wheel.c - A conference-wide timer service
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-timer-wheel.h"
+
+/*
+ * SECTION:fs-rtp-timer-wheel
+ * @short_description: A hierarchical timer wheel driven by a single thread
+ *
+ * All the timers of a conference (no-RTCP timeouts of the substreams, TFRC
+ * feedback and no-feedback timers, bitrate adapter intervals) are registered
+ * here, so the number of threads stays constant no matter how many SSRCs
+ * are being tracked.
+ *
+ * Timers are hashed into 4 levels of 64 slots, the first level has a
+ * resolution of one tick (1ms), each following level covers 64 times more.
+ * Timers in the upper levels are cascaded down when the lower level wraps
+ * around, so adding and cancelling a timer are O(1). Timers further than
+ * the range of the wheel (about 4.6 hours) are parked in the last level and
+ * re-inserted when they are cascaded down.
+ *
+ * The thread only wakes up when a slot has to be processed, never
+ * periodically.
+ *
+ * Each conference has its own wheel, but all the callbacks of a conference
+ * are called one after the other from its thread, so a slow callback
+ * delays every other timer of every session in that conference. Callbacks
+ * must only take short-lived locks and must never block on the streaming
+ * threads; anything longer has to be handed off to another thread.
+ */
+
+#define TICK (GST_MSECOND)
+#define LEVEL_BITS (6)
+#define LEVEL_SIZE (1 << LEVEL_BITS)
+#define LEVEL_MASK (LEVEL_SIZE - 1)
+#define LEVELS (4)
+#define MAX_DELTA (G_GUINT64_CONSTANT (1) << (LEVEL_BITS * LEVELS))
+
+struct _FsRtpTimerWheel
+{
+  volatile gint refcount;
+
+  GstClock *clock;
+
+  /* Everything below is protected by the mutex */
+  GMutex mutex;
+  GCond cond;
+
+  GThread *thread;
+  gboolean quit;
+  gboolean free_on_exit;
+
+  /* The next tick to be processed */
+  guint64 current_tick;
+  guint pending;
+  GQueue slots[LEVELS][LEVEL_SIZE];
+
+  /* The timer whose callback is being called */
+  FsRtpTimer *running;
+};
+
+struct _FsRtpTimer
+{
+  volatile gint refcount;
+
+  FsRtpTimerWheel *wheel;
+
+  /* Protected by the wheel mutex */
+  GList link;
+  GQueue *queue;
+  guint64 expiry_tick;
+
+  FsRtpTimerFunc func;
+  gpointer user_data;
+  GDestroyNotify destroy_data;
+};
+
+static void fs_rtp_timer_wheel_insert_locked (FsRtpTimerWheel *wheel,
+    FsRtpTimer *timer);
+
+
+FsRtpTimerWheel *
+fs_rtp_timer_wheel_new (void)
+{
+  FsRtpTimerWheel *wheel = g_slice_new0 (FsRtpTimerWheel);
+  guint level, i;
+
+  wheel->refcount = 1;
+  wheel->clock = gst_system_clock_obtain ();
+  g_mutex_init (&wheel->mutex);
+  g_cond_init (&wheel->cond);
+
+  for (level = 0; level < LEVELS; level++)
+    for (i = 0; i < LEVEL_SIZE; i++)
+      g_queue_init (&wheel->slots[level][i]);
+
+  wheel->current_tick = gst_clock_get_time (wheel->clock) / TICK;
+
+  return wheel;
+}
+
+static void
+fs_rtp_timer_wheel_free (FsRtpTimerWheel *wheel)
+{
+  g_assert (wheel->pending == 0);
+
+  gst_object_unref (wheel->clock);
+  g_mutex_clear (&wheel->mutex);
+  g_cond_clear (&wheel->cond);
+
+  g_slice_free (FsRtpTimerWheel, wheel);
+}
+
+FsRtpTimerWheel *
+fs_rtp_timer_wheel_ref (FsRtpTimerWheel *wheel)
+{
+  g_atomic_int_inc (&wheel->refcount);
+
+  return wheel;
+}
+
+void
+fs_rtp_timer_wheel_unref (FsRtpTimerWheel *wheel)
+{
+  GThread *thread;
+
+  if (!g_atomic_int_dec_and_test (&wheel->refcount))
+    return;
+
+  g_mutex_lock (&wheel->mutex);
+  thread = wheel->thread;
+  wheel->quit = TRUE;
+  g_cond_broadcast (&wheel->cond);
+
+  /* The last reference can be dropped from a timer callback, in that case
+   * the thread frees the wheel on its way out */
+  if (thread && thread == g_thread_self ())
+  {
+    wheel->free_on_exit = TRUE;
+    g_mutex_unlock (&wheel->mutex);
+    return;
+  }
+  g_mutex_unlock (&wheel->mutex);
+
+  if (thread)
+    g_thread_join (thread);
+
+  fs_rtp_timer_wheel_free (wheel);
+}
+
+GstClockTime
+fs_rtp_timer_wheel_get_time (FsRtpTimerWheel *wheel)
+{
+  return gst_clock_get_time (wheel->clock);
+}
+
+static void
+fs_rtp_timer_wheel_insert_locked (FsRtpTimerWheel *wheel, FsRtpTimer *timer)
+{
+  guint64 expires = MAX (timer->expiry_tick, wheel->current_tick);
+  guint64 delta = expires - wheel->current_tick;
+  guint level;
+  GQueue *queue;
+
+  if (delta >= MAX_DELTA)
+  {
+    expires = wheel->current_tick + MAX_DELTA - 1;
+    delta = MAX_DELTA - 1;
+  }
+
+  for (level = 0; level < LEVELS - 1; level++)
+    if (delta < (G_GUINT64_CONSTANT (1) << (LEVEL_BITS * (level + 1))))
+      break;
+
+  queue = &wheel->slots[level][(expires >> (LEVEL_BITS * level)) & LEVEL_MASK];
+
+  g_queue_push_tail_link (queue, &timer->link);
+  timer->queue = queue;
+  wheel->pending++;
+}
+
+static void
+fs_rtp_timer_wheel_cascade_locked (FsRtpTimerWheel *wheel, guint level,
+    guint index)
+{
+  GQueue *slot = &wheel->slots[level][index];
+  GList *link;
+
+  while ((link = g_queue_pop_head_link (slot)))
+  {
+    wheel->pending--;
+    fs_rtp_timer_wheel_insert_locked (wheel, link->data);
+  }
+}
+
+/*
+ * Returns the first tick at which a slot has to be either expired or
+ * cascaded, or G_MAXUINT64 if there is no pending timer
+ */
+
+static guint64
+fs_rtp_timer_wheel_next_tick_locked (FsRtpTimerWheel *wheel)
+{
+  guint64 current = wheel->current_tick;
+  guint64 next = G_MAXUINT64;
+  guint level, i;
+
+  if (wheel->pending == 0)
+    return G_MAXUINT64;
+
+  for (i = 0; i < LEVEL_SIZE; i++)
+  {
+    if (!g_queue_is_empty (&wheel->slots[0][(current + i) & LEVEL_MASK]))
+    {
+      next = current + i;
+      break;
+    }
+  }
+
+  for (level = 1; level < LEVELS; level++)
+  {
+    guint shift = LEVEL_BITS * level;
+    guint64 base = current >> shift;
+    guint start;
+
+    /* If the current tick is not aligned, the slot at "base" has already
+     * been cascaded */
+    start = (current & ((G_GUINT64_CONSTANT (1) << shift) - 1)) ? 1 : 0;
+
+    for (i = start; i < start + LEVEL_SIZE; i++)
+    {
+      guint64 tick = (base + i) << shift;
+
+      if (tick >= next)
+        break;
+
+      if (!g_queue_is_empty (&wheel->slots[level][(base + i) & LEVEL_MASK]))
+      {
+        next = tick;
+        break;
+      }
+    }
+  }
+
+  return next;
+}
+
+/* Called with the lock held, drops it while calling the callbacks */
+
+static void
+fs_rtp_timer_wheel_run_tick_locked (FsRtpTimerWheel *wheel, GstClockTime now)
+{
+  guint64 tick = wheel->current_tick;
+  guint index = tick & LEVEL_MASK;
+  GQueue expired = G_QUEUE_INIT;
+  GList *link;
+
+  if (index == 0)
+  {
+    guint level;
+
+    for (level = 1; level < LEVELS; level++)
+    {
+      guint level_index = (tick >> (LEVEL_BITS * level)) & LEVEL_MASK;
+
+      fs_rtp_timer_wheel_cascade_locked (wheel, level, level_index);
+      if (level_index != 0)
+        break;
+    }
+  }
+
+  /* Move the slot out of the wheel so that timers added from the callbacks
+   * for an expired time are run on the next tick instead */
+  while ((link = g_queue_pop_head_link (&wheel->slots[0][index])))
+  {
+    FsRtpTimer *timer = link->data;
+
+    g_queue_push_tail_link (&expired, link);
+    timer->queue = &expired;
+  }
+
+  wheel->current_tick++;
+
+  while ((link = g_queue_pop_head_link (&expired)))
+  {
+    FsRtpTimer *timer = link->data;
+
+    timer->queue = NULL;
+    wheel->pending--;
+
+    /* Timers that were too far in the future for the wheel */
+    if (timer->expiry_tick > tick)
+    {
+      fs_rtp_timer_wheel_insert_locked (wheel, timer);
+      continue;
+    }
+
+    wheel->running = timer;
+    g_mutex_unlock (&wheel->mutex);
+
+    timer->func (timer, now, timer->user_data);
+    /* Drop the reference held by the wheel */
+    fs_rtp_timer_unref (timer);
+
+    g_mutex_lock (&wheel->mutex);
+    wheel->running = NULL;
+    g_cond_broadcast (&wheel->cond);
+  }
+}
+
+static gpointer
+fs_rtp_timer_wheel_thread (gpointer data)
+{
+  FsRtpTimerWheel *wheel = data;
+
+  g_mutex_lock (&wheel->mutex);
+  while (!wheel->quit)
+  {
+    GstClockTime now = gst_clock_get_time (wheel->clock);
+    guint64 now_tick = now / TICK;
+    guint64 next_tick = fs_rtp_timer_wheel_next_tick_locked (wheel);
+
+    if (next_tick <= now_tick)
+    {
+      /* Nothing needs to be done in the slots in between */
+      if (next_tick > wheel->current_tick)
+        wheel->current_tick = next_tick;
+      fs_rtp_timer_wheel_run_tick_locked (wheel, now);
+      continue;
+    }
+
+    if (wheel->current_tick <= now_tick)
+      wheel->current_tick = now_tick + 1;
+
+    if (next_tick == G_MAXUINT64)
+      g_cond_wait (&wheel->cond, &wheel->mutex);
+    else
+      g_cond_wait_until (&wheel->cond, &wheel->mutex,
+          g_get_monotonic_time () +
+          (next_tick * TICK - now) / GST_USECOND + 1);
+  }
+
+  if (wheel->free_on_exit)
+  {
+    g_mutex_unlock (&wheel->mutex);
+    g_thread_unref (wheel->thread);
+    fs_rtp_timer_wheel_free (wheel);
+    return NULL;
+  }
+
+  g_mutex_unlock (&wheel->mutex);
+
+  return NULL;
+}
+
+/**
+ * fs_rtp_timer_wheel_add:
+ * @wheel: a #FsRtpTimerWheel
+ * @expiry: The system clock time at which the timer should expire
+ * @func: The function to call when the timer expires
+ * @user_data: The data to pass to @func
+ * @destroy_data: Called on @user_data when the timer is freed
+ *
+ * Adds a single shot timer to the wheel. Timers never expire early, but
+ * can expire up to one tick (1ms) late.
+ *
+ * Returns: a new #FsRtpTimer, unref it with fs_rtp_timer_unref()
+ */
+
+FsRtpTimer *
+fs_rtp_timer_wheel_add (FsRtpTimerWheel *wheel, GstClockTime expiry,
+    FsRtpTimerFunc func, gpointer user_data, GDestroyNotify destroy_data)
+{
+  FsRtpTimer *timer;
+
+  g_return_val_if_fail (wheel != NULL, NULL);
+  g_return_val_if_fail (func != NULL, NULL);
+  g_return_val_if_fail (GST_CLOCK_TIME_IS_VALID (expiry), NULL);
+
+  timer = g_slice_new0 (FsRtpTimer);
+  /* One reference for the caller, one for the wheel */
+  timer->refcount = 2;
+  timer->wheel = fs_rtp_timer_wheel_ref (wheel);
+  timer->link.data = timer;
+  timer->expiry_tick = (expiry + TICK - 1) / TICK;
+  timer->func = func;
+  timer->user_data = user_data;
+  timer->destroy_data = destroy_data;
+
+  g_mutex_lock (&wheel->mutex);
+  if (wheel->thread == NULL)
+    wheel->thread = g_thread_new ("fs-rtp-timer-wheel",
+        fs_rtp_timer_wheel_thread, wheel);
+  fs_rtp_timer_wheel_insert_locked (wheel, timer);
+  g_cond_signal (&wheel->cond);
+  g_mutex_unlock (&wheel->mutex);
+
+  return timer;
+}
+
+static gboolean
+fs_rtp_timer_cancel_locked (FsRtpTimer *timer)
+{
+  FsRtpTimerWheel *wheel = timer->wheel;
+
+  if (!timer->queue)
+    return FALSE;
+
+  g_queue_unlink (timer->queue, &timer->link);
+  timer->queue = NULL;
+  wheel->pending--;
+
+  return TRUE;
+}
+
+/**
+ * fs_rtp_timer_cancel:
+ * @timer: a #FsRtpTimer
+ *
+ * Cancels a timer, its callback will not be called unless it is
+ * already running. This never blocks, so it can be called while holding
+ * locks that the callback takes, just like gst_clock_id_unschedule().
+ */
+
+void
+fs_rtp_timer_cancel (FsRtpTimer *timer)
+{
+  gboolean cancelled;
+
+  g_mutex_lock (&timer->wheel->mutex);
+  cancelled = fs_rtp_timer_cancel_locked (timer);
+  g_mutex_unlock (&timer->wheel->mutex);
+
+  if (cancelled)
+    fs_rtp_timer_unref (timer);
+}
+
+/**
+ * fs_rtp_timer_cancel_sync:
+ * @timer: a #FsRtpTimer
+ *
+ * Cancels a timer and waits for its callback to return if it is
+ * currently running (unless it is called from the callback itself). The
+ * caller must not hold any lock that the callback could take, and the
+ * callback must not wait on the caller, or they deadlock.
+ */
+
+void
+fs_rtp_timer_cancel_sync (FsRtpTimer *timer)
+{
+  FsRtpTimerWheel *wheel = timer->wheel;
+  gboolean cancelled;
+
+  g_mutex_lock (&wheel->mutex);
+  cancelled = fs_rtp_timer_cancel_locked (timer);
+  if (wheel->thread != g_thread_self ())
+    while (wheel->running == timer)
+      g_cond_wait (&wheel->cond, &wheel->mutex);
+  g_mutex_unlock (&wheel->mutex);
+
+  if (cancelled)
+    fs_rtp_timer_unref (timer);
+}
+
+FsRtpTimer *
+fs_rtp_timer_ref (FsRtpTimer *timer)
+{
+  g_atomic_int_inc (&timer->refcount);
+
+  return timer;
+}
+
+void
+fs_rtp_timer_unref (FsRtpTimer *timer)
+{
+  if (!g_atomic_int_dec_and_test (&timer->refcount))
+    return;
+
+  if (timer->destroy_data)
+    timer->destroy_data (timer->user_data);
+
+  fs_rtp_timer_wheel_unref (timer->wheel);
+  g_slice_free (FsRtpTimer, timer);
+}
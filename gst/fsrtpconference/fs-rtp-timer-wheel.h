@@ -0,0 +1,71 @@
+/*
+ * Farstream - Farstream RTP Timer Wheel
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rtp-timer-wheel.h - A conference-wide timer service
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RTP_TIMER_WHEEL_H__
+#define __FS_RTP_TIMER_WHEEL_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _FsRtpTimerWheel FsRtpTimerWheel;
+typedef struct _FsRtpTimer FsRtpTimer;
+
+/**
+ * FsRtpTimerFunc:
+ * @timer: The #FsRtpTimer that expired
+ * @time: The current time of the system clock
+ * @user_data: The user data passed when the timer was added
+ *
+ * Called from the timer wheel thread when a timer expires, without any
+ * lock held. It is never called for a timer that has been cancelled.
+ *
+ * It must not block: every other timer of the conference waits for it to
+ * return, and so does any thread in fs_rtp_timer_cancel_sync() on it, so
+ * waiting on such a thread deadlocks. It must not emit signals that reach
+ * the application either, anything like that has to be handed off to
+ * another thread.
+ */
+typedef void (*FsRtpTimerFunc) (FsRtpTimer *timer, GstClockTime time,
+    gpointer user_data);
+
+FsRtpTimerWheel *fs_rtp_timer_wheel_new (void);
+FsRtpTimerWheel *fs_rtp_timer_wheel_ref (FsRtpTimerWheel *wheel);
+void fs_rtp_timer_wheel_unref (FsRtpTimerWheel *wheel);
+
+GstClockTime fs_rtp_timer_wheel_get_time (FsRtpTimerWheel *wheel);
+
+FsRtpTimer *fs_rtp_timer_wheel_add (FsRtpTimerWheel *wheel,
+    GstClockTime expiry,
+    FsRtpTimerFunc func,
+    gpointer user_data,
+    GDestroyNotify destroy_data);
+
+void fs_rtp_timer_cancel (FsRtpTimer *timer);
+void fs_rtp_timer_cancel_sync (FsRtpTimer *timer);
+
+FsRtpTimer *fs_rtp_timer_ref (FsRtpTimer *timer);
+void fs_rtp_timer_unref (FsRtpTimer *timer);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_TIMER_WHEEL_H__ */
@@ -0,0 +1,986 @@
+/*
+ * Farstream - Farstream RTP Transport-wide Congestion Control
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-transport-cc.c - Delay-based rate control for Farstream RTP
+ *  sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rtp-transport-cc.h"
+
+#include <string.h>
+
+#include "farstream/fs-rtp.h"
+#include "fs-rtp-codec-negotiation.h"
+
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+#define TRANSPORT_CC_URI \
+  "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"
+
+/* draft-holmer-rmcat-transport-wide-cc-extensions-01 uses FMT 15 */
+#define TRANSPORT_CC_FMT (15)
+
+/* The extension only carries the transport-wide sequence number */
+#define EXTENSION_LEN (2)
+
+#define FEEDBACK_INTERVAL (100 * GST_MSECOND)
+#define MAX_FEEDBACK_SIZE (512)
+
+/* After that long without feedback from the source driving the sender,
+ * the feedback of another one is accepted */
+#define FEEDBACK_SOURCE_TIMEOUT (5 * 1000 * 1000)
+
+GST_DEBUG_CATEGORY_STATIC (fsrtpconference_transport_cc);
+#define GST_CAT_DEFAULT fsrtpconference_transport_cc
+
+G_DEFINE_TYPE (FsRtpTransportCc, fs_rtp_transport_cc,
+    FS_TYPE_RTP_CONGESTION_CONTROL);
+
+/* props */
+enum
+{
+  PROP_0,
+  PROP_BITRATE,
+  PROP_SENDING,
+  PROP_MAX_PROBE_BITRATE
+};
+
+
+static void fs_rtp_transport_cc_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec);
+static void fs_rtp_transport_cc_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec);
+static void fs_rtp_transport_cc_dispose (GObject *object);
+static void fs_rtp_transport_cc_destroy (FsRtpCongestionControl *cc);
+static void fs_rtp_transport_cc_codecs_updated (FsRtpCongestionControl *cc,
+    GList *codec_associations,
+    GList *header_extensions);
+static gboolean fs_rtp_transport_cc_is_enabled (FsRtpCongestionControl *cc,
+    guint pt);
+static void fs_rtp_transport_cc_warm_start (FsRtpCongestionControl *cc,
+    guint bitrate);
+static gboolean fs_rtp_transport_cc_get_path (FsRtpCongestionControl *cc,
+    guint *rtt,
+    gdouble *loss);
+
+static void
+fs_rtp_transport_cc_class_init (FsRtpTransportCcClass *klass)
+{
+  GObjectClass *gobject_class;
+  FsRtpCongestionControlClass *cc_class;
+
+  gobject_class = (GObjectClass *) klass;
+  cc_class = (FsRtpCongestionControlClass *) klass;
+
+  gobject_class->get_property = fs_rtp_transport_cc_get_property;
+  gobject_class->set_property = fs_rtp_transport_cc_set_property;
+  gobject_class->dispose = fs_rtp_transport_cc_dispose;
+
+  cc_class->destroy = fs_rtp_transport_cc_destroy;
+  cc_class->codecs_updated = fs_rtp_transport_cc_codecs_updated;
+  cc_class->is_enabled = fs_rtp_transport_cc_is_enabled;
+  cc_class->warm_start = fs_rtp_transport_cc_warm_start;
+  cc_class->get_path = fs_rtp_transport_cc_get_path;
+
+  g_object_class_override_property (gobject_class, PROP_BITRATE, "bitrate");
+  g_object_class_override_property (gobject_class, PROP_SENDING, "sending");
+
+  g_object_class_install_property (gobject_class,
+      PROP_MAX_PROBE_BITRATE,
+      g_param_spec_uint ("max-probe-bitrate",
+          "The highest bitrate to probe at",
+          "At the start of the call, the path is probed with short bursts"
+          " of up to this many bits/sec to find its capacity, 0 to not probe",
+          0, G_MAXUINT, FS_RTP_TRANSPORT_CC_DEFAULT_MAX_PROBE_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static guint64
+fs_rtp_transport_cc_get_now (FsRtpTransportCc *self)
+{
+  return GST_TIME_AS_USECONDS (gst_clock_get_time (self->systemclock));
+}
+
+static void
+fs_rtp_transport_cc_init (FsRtpTransportCc *self)
+{
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_transport_cc,
+      "fsrtpconference_transport_cc", 0,
+      "Farstream RTP Conference Element Transport-wide Congestion Control");
+
+  /* member init */
+
+  self->systemclock = gst_system_clock_obtain ();
+
+  self->max_probe_bitrate = FS_RTP_TRANSPORT_CC_DEFAULT_MAX_PROBE_BITRATE;
+  self->sender = gcc_sender_new (fs_rtp_transport_cc_get_now (self), 0);
+  gcc_sender_set_max_probe_bitrate (self->sender, self->max_probe_bitrate);
+  self->send_bitrate = gcc_sender_get_bitrate (self->sender);
+
+  self->extension_type = EXTENSION_NONE;
+  self->extension_id = 0;
+  memset (self->pts, 0, 128);
+}
+
+static void
+fs_rtp_transport_cc_clear_feedback_timer_locked (FsRtpTransportCc *self)
+{
+  if (self->feedback_timer)
+  {
+    fs_rtp_timer_cancel (self->feedback_timer);
+    fs_rtp_timer_unref (self->feedback_timer);
+  }
+  self->feedback_timer = NULL;
+}
+
+static void
+fs_rtp_transport_cc_destroy (FsRtpCongestionControl *cc)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (cc);
+
+  GST_OBJECT_LOCK (self);
+
+  if (self->modder_check_probe_id)
+    gst_pad_remove_probe (self->out_rtp_pad, self->modder_check_probe_id);
+  self->modder_check_probe_id = 0;
+
+  if (self->in_rtp_probe_id)
+    gst_pad_remove_probe (self->in_rtp_pad, self->in_rtp_probe_id);
+  self->in_rtp_probe_id = 0;
+  if (self->in_rtcp_probe_id)
+    gst_pad_remove_probe (self->in_rtcp_pad, self->in_rtcp_probe_id);
+  self->in_rtcp_probe_id = 0;
+
+  if (self->on_sending_rtcp_id)
+    g_signal_handler_disconnect (self->rtpsession, self->on_sending_rtcp_id);
+  self->on_sending_rtcp_id = 0;
+
+  fs_rtp_transport_cc_clear_feedback_timer_locked (self);
+
+  self->fsrtpsession = NULL;
+
+  GST_OBJECT_UNLOCK (self);
+}
+
+static void
+fs_rtp_transport_cc_dispose (GObject *object)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (object);
+
+  GST_OBJECT_LOCK (self);
+
+  fs_rtp_transport_cc_clear_feedback_timer_locked (self);
+
+  if (self->packet_modder)
+  {
+    gst_bin_remove (self->parent_bin, self->packet_modder);
+    gst_element_set_state (self->packet_modder, GST_STATE_NULL);
+    g_object_unref (self->packet_modder);
+  }
+  self->packet_modder = NULL;
+
+  if (self->rtpsession)
+    g_object_unref (self->rtpsession);
+  self->rtpsession = NULL;
+  if (self->in_rtp_pad)
+    g_object_unref (self->in_rtp_pad);
+  self->in_rtp_pad = NULL;
+  if (self->in_rtcp_pad)
+    g_object_unref (self->in_rtcp_pad);
+  self->in_rtcp_pad = NULL;
+  if (self->out_rtp_pad)
+    g_object_unref (self->out_rtp_pad);
+  self->out_rtp_pad = NULL;
+
+  if (self->parent_bin)
+    gst_object_unref (self->parent_bin);
+  self->parent_bin = NULL;
+
+  if (self->systemclock)
+    gst_object_unref (self->systemclock);
+  self->systemclock = NULL;
+
+  if (self->timer_wheel)
+    fs_rtp_timer_wheel_unref (self->timer_wheel);
+  self->timer_wheel = NULL;
+
+  if (self->sender)
+    gcc_sender_free (self->sender);
+  self->sender = NULL;
+  if (self->receiver)
+    gcc_receiver_free (self->receiver);
+  self->receiver = NULL;
+
+  GST_OBJECT_UNLOCK (self);
+
+  if (G_OBJECT_CLASS (fs_rtp_transport_cc_parent_class)->dispose)
+    G_OBJECT_CLASS (fs_rtp_transport_cc_parent_class)->dispose (object);
+}
+
+
+static void
+fs_rtp_transport_cc_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (object);
+
+  switch (prop_id)
+  {
+    case PROP_BITRATE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->send_bitrate);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_MAX_PROBE_BITRATE:
+      GST_OBJECT_LOCK (self);
+      g_value_set_uint (value, self->max_probe_bitrate);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+/* Starts again from the last bitrate, the next packets are numbered from 0 */
+static void
+fs_rtp_transport_cc_reset_sender_locked (FsRtpTransportCc *self)
+{
+  if (self->sender)
+    gcc_sender_free (self->sender);
+  self->sender = gcc_sender_new (fs_rtp_transport_cc_get_now (self),
+      self->send_bitrate);
+  gcc_sender_set_max_probe_bitrate (self->sender, self->max_probe_bitrate);
+  self->feedback_ssrc = 0;
+  self->last_feedback = 0;
+}
+
+static void
+fs_rtp_transport_cc_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (object);
+
+  switch (prop_id)
+  {
+    case PROP_SENDING:
+      GST_OBJECT_LOCK (self);
+      self->sending = g_value_get_boolean (value);
+      if (!self->sending)
+        fs_rtp_transport_cc_reset_sender_locked (self);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    case PROP_MAX_PROBE_BITRATE:
+      GST_OBJECT_LOCK (self);
+      self->max_probe_bitrate = g_value_get_uint (value);
+      gcc_sender_set_max_probe_bitrate (self->sender, self->max_probe_bitrate);
+      GST_OBJECT_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static gboolean
+fs_rtp_transport_cc_update_bitrate_locked (FsRtpTransportCc *self,
+    const gchar *source)
+{
+  guint new_bitrate = gcc_sender_get_bitrate (self->sender);
+  gboolean ret;
+
+  ret = self->send_bitrate != new_bitrate;
+
+  if (ret)
+    GST_DEBUG_OBJECT (self, "Send rate changed (%s): %u -> %u", source,
+        self->send_bitrate, new_bitrate);
+
+  self->send_bitrate = new_bitrate;
+
+  return ret;
+}
+
+static void
+feedback_timer_expired (FsRtpTimer *timer, GstClockTime time,
+  gpointer user_data)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (user_data);
+  gboolean send_rtcp = FALSE;
+
+  GST_OBJECT_LOCK (self);
+
+  if (self->feedback_timer != timer)
+  {
+    GST_OBJECT_UNLOCK (self);
+    return;
+  }
+
+  fs_rtp_timer_unref (self->feedback_timer);
+  self->feedback_timer = NULL;
+
+  if (self->fsrtpsession && self->receiver &&
+      gcc_receiver_has_feedback (self->receiver))
+    send_rtcp = TRUE;
+
+  GST_OBJECT_UNLOCK (self);
+
+  if (send_rtcp)
+    g_signal_emit_by_name (self->rtpsession, "send-rtcp", (guint64) 0);
+}
+
+static gboolean
+rtpsession_sending_rtcp (GObject *rtpsession, GstBuffer *buffer,
+    gboolean is_early, FsRtpTransportCc *self)
+{
+  GstRTCPBuffer rtcpbuffer = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  guint32 ssrc;
+  gsize size;
+  gboolean ret = FALSE;
+
+  g_object_get (self->rtpsession, "internal-ssrc", &ssrc, NULL);
+
+  gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &rtcpbuffer);
+
+  GST_OBJECT_LOCK (self);
+
+  if (!self->receiver || !gcc_receiver_has_feedback (self->receiver))
+    goto out;
+
+  if (!gst_rtcp_buffer_add_packet (&rtcpbuffer, GST_RTCP_TYPE_RTPFB,
+          &packet))
+    goto out;
+
+  if (!gst_rtcp_packet_fb_set_fci_length (&packet, MAX_FEEDBACK_SIZE / 4))
+  {
+    gst_rtcp_packet_remove (&packet);
+    goto out;
+  }
+
+  size = gcc_receiver_build_feedback (self->receiver,
+      gst_rtcp_packet_fb_get_fci (&packet), MAX_FEEDBACK_SIZE);
+  if (size == 0)
+  {
+    gst_rtcp_packet_remove (&packet);
+    goto out;
+  }
+
+  /* Shrink it to what was actually written */
+  gst_rtcp_packet_fb_set_fci_length (&packet, size / 4);
+  gst_rtcp_packet_fb_set_type (&packet, TRANSPORT_CC_FMT);
+  gst_rtcp_packet_fb_set_sender_ssrc (&packet, ssrc);
+  gst_rtcp_packet_fb_set_media_ssrc (&packet, self->media_ssrc);
+
+  GST_LOG_OBJECT (self, "Sending transport-cc feedback of %"
+      G_GSIZE_FORMAT " bytes", size);
+
+  ret = TRUE;
+
+out:
+  GST_OBJECT_UNLOCK (self);
+
+  gst_rtcp_buffer_unmap (&rtcpbuffer);
+
+  /* Return TRUE if something was added */
+  return ret;
+}
+
+static GstPadProbeReturn
+incoming_rtp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (user_data);
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  gboolean got_header = FALSE;
+  guint8 *data;
+  guint size;
+  guint64 now;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+    return GST_PAD_PROBE_OK;
+
+  GST_OBJECT_LOCK (self);
+
+  if (!self->fsrtpsession)
+    goto out;
+
+  /* The sequence number is transport-wide, so every packet carrying it
+   * is reported, whatever its payload type */
+  if (self->extension_type == EXTENSION_NONE)
+    goto out;
+  else if (self->extension_type == EXTENSION_ONE_BYTE)
+    got_header = gst_rtp_buffer_get_extension_onebyte_header (&rtpbuffer,
+        self->extension_id, 0, (gpointer *) &data, &size);
+  else if (self->extension_type == EXTENSION_TWO_BYTES)
+    got_header = gst_rtp_buffer_get_extension_twobytes_header (&rtpbuffer,
+        NULL, self->extension_id, 0, (gpointer *) &data, &size);
+
+  if (!got_header || size != EXTENSION_LEN)
+    goto out;
+
+  now = fs_rtp_transport_cc_get_now (self);
+
+  if (!self->receiver)
+    self->receiver = gcc_receiver_new ();
+
+  gcc_receiver_got_packet (self->receiver, now, GST_READ_UINT16_BE (data));
+  self->media_ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
+
+  if (!self->feedback_timer)
+    self->feedback_timer = fs_rtp_timer_wheel_add (self->timer_wheel,
+        now * GST_USECOND + FEEDBACK_INTERVAL, feedback_timer_expired,
+        g_object_ref (self), g_object_unref);
+
+out:
+  GST_OBJECT_UNLOCK (self);
+
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+incoming_rtcp_probe (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (user_data);
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstRTCPBuffer rtcpbuffer = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  gboolean notify = FALSE;
+
+  if (!gst_rtcp_buffer_validate (buffer))
+    return GST_PAD_PROBE_OK;
+
+  gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcpbuffer);
+
+  if (!gst_rtcp_buffer_get_first_packet (&rtcpbuffer, &packet))
+    goto out;
+
+  do {
+    if (gst_rtcp_packet_get_type (&packet) == GST_RTCP_TYPE_RTPFB &&
+        gst_rtcp_packet_fb_get_type (&packet) == TRANSPORT_CC_FMT &&
+        gst_rtcp_packet_get_length (&packet) > 2)
+    {
+      guint32 media_ssrc;
+      guint32 sender_ssrc;
+      guint32 local_ssrc;
+      guint64 now;
+
+      media_ssrc = gst_rtcp_packet_fb_get_media_ssrc (&packet);
+
+      g_object_get (self->rtpsession, "internal-ssrc", &local_ssrc, NULL);
+
+      if (media_ssrc != local_ssrc)
+        continue;
+
+      sender_ssrc = gst_rtcp_packet_fb_get_sender_ssrc (&packet);
+
+      GST_OBJECT_LOCK (self);
+
+      if (!self->fsrtpsession || !self->sending)
+        goto done;
+
+      now = fs_rtp_transport_cc_get_now (self);
+
+      /* The reports of two receivers can not be mixed, their clocks are
+       * unrelated */
+      if (self->last_feedback && sender_ssrc != self->feedback_ssrc)
+      {
+        if (now - self->last_feedback < FEEDBACK_SOURCE_TIMEOUT)
+          goto done;
+
+        GST_DEBUG_OBJECT (self, "Feedback source changed from %X to %X",
+            self->feedback_ssrc, sender_ssrc);
+        fs_rtp_transport_cc_reset_sender_locked (self);
+      }
+
+      if (!gcc_sender_on_feedback (self->sender, now,
+              gst_rtcp_packet_fb_get_fci (&packet),
+              gst_rtcp_packet_fb_get_fci_length (&packet) * 4))
+      {
+        GST_DEBUG_OBJECT (self, "Ignoring invalid transport-cc feedback");
+        goto done;
+      }
+
+      self->feedback_ssrc = sender_ssrc;
+      self->last_feedback = now;
+
+      GST_LOG_OBJECT (self, "Got transport-cc feedback, rtt: %u",
+          gcc_sender_get_rtt (self->sender));
+
+      if (fs_rtp_transport_cc_update_bitrate_locked (self, "fb"))
+        notify = TRUE;
+
+    done:
+      GST_OBJECT_UNLOCK (self);
+    }
+  } while (gst_rtcp_packet_move_to_next (&packet));
+
+  if (notify)
+    g_object_notify (G_OBJECT (self), "bitrate");
+
+out:
+
+  gst_rtcp_buffer_unmap (&rtcpbuffer);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/*
+ * Unlike TFRC, the controller backs off before the queues fill up, so the
+ * pacer only has to spread the frames, not to hold the rate. While a probe
+ * cluster is being sent, the packets go out at exactly the probed rate and
+ * the gaps between the frames are filled with padding.
+ */
+
+#define PACING_FACTOR (2.5)
+#define PACING_LATENCY_BUDGET (300 * GST_MSECOND)
+
+static guint
+fs_rtp_transport_cc_get_pacing_rate (FsRtpPacketModder *modder,
+    gpointer user_data)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (user_data);
+  guint send_rate = 0;
+
+  GST_OBJECT_LOCK (self);
+  if (self->extension_type != EXTENSION_NONE && self->sending)
+  {
+    send_rate = gcc_sender_get_probe_bitrate (self->sender) / 8;
+    if (send_rate == 0)
+      send_rate = self->send_bitrate / 8 * PACING_FACTOR;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return send_rate;
+}
+
+static GstBuffer *
+fs_rtp_transport_cc_outgoing_packets (FsRtpPacketModder *modder,
+    GstBuffer *buffer, GstClockTime buffer_ts, gpointer user_data)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (user_data);
+  guint8 data[EXTENSION_LEN];
+  GstBuffer *newbuf;
+  gboolean notify = FALSE;
+  guint padding;
+  guint size;
+
+  GST_OBJECT_LOCK (self);
+
+  if (!self->fsrtpsession || self->extension_type == EXTENSION_NONE ||
+      !self->sending)
+  {
+    GST_OBJECT_UNLOCK (self);
+    return buffer;
+  }
+
+  size = gst_buffer_get_size (buffer) +
+      fs_rtp_packet_modder_get_extension_size (self->extension_type,
+          EXTENSION_LEN);
+  GST_WRITE_UINT16_BE (data, gcc_sender_sending_packet (self->sender,
+          fs_rtp_transport_cc_get_now (self), size));
+
+  newbuf = fs_rtp_packet_modder_add_extension (buffer, self->extension_type,
+      self->extension_id, data, EXTENSION_LEN);
+  if (!newbuf)
+  {
+    GST_WARNING_OBJECT (self, "Could not add the transport-cc extension to"
+        " an invalid RTP packet, sending it as is");
+    newbuf = buffer;
+  }
+
+  /* The sender halves the rate when the feedback stops coming */
+  if (fs_rtp_transport_cc_update_bitrate_locked (self, "tm"))
+    notify = TRUE;
+
+  padding = gcc_sender_get_probe_padding (self->sender);
+
+  GST_OBJECT_UNLOCK (self);
+
+  fs_rtp_packet_modder_request_padding (modder, padding);
+
+  if (notify)
+    g_object_notify (G_OBJECT (self), "bitrate");
+
+  return newbuf;
+}
+
+static GstPadProbeReturn
+send_rtp_pad_blocked (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  FsRtpTransportCc *self = user_data;
+  gboolean need_modder;
+  GstPad *peer = NULL;
+
+  GST_OBJECT_LOCK (self);
+  self->modder_check_probe_id = 0;
+  need_modder = self->extension_type != EXTENSION_NONE;
+
+  if (!self->fsrtpsession || !!self->packet_modder == need_modder)
+    goto out;
+
+  GST_DEBUG ("Pad blocked to possibly %s the transport-cc packet modder",
+      need_modder ? "add" : "remove");
+
+  if (need_modder)
+  {
+    GstPadLinkReturn linkret;
+    GstPad *modder_pad;
+
+    self->packet_modder = GST_ELEMENT (fs_rtp_packet_modder_new (
+          fs_rtp_transport_cc_outgoing_packets, NULL, self));
+    g_object_ref (self->packet_modder);
+    fs_rtp_packet_modder_set_pacing (
+        FS_RTP_PACKET_MODDER (self->packet_modder),
+        fs_rtp_transport_cc_get_pacing_rate, 0);
+    g_object_set (self->packet_modder,
+        "latency-budget", (guint64) PACING_LATENCY_BUDGET,
+        NULL);
+    fs_rtp_packet_modder_reserve_prefix (
+        FS_RTP_PACKET_MODDER (self->packet_modder),
+        fs_rtp_packet_modder_get_extension_size (EXTENSION_TWO_BYTES,
+            EXTENSION_LEN));
+
+    if (!gst_bin_add (self->parent_bin, self->packet_modder))
+    {
+      fs_session_emit_error (FS_SESSION (self->fsrtpsession),
+          FS_ERROR_CONSTRUCTION,
+          "Could not add transport-cc packet modder to the pipeline");
+      goto adding_failed;
+    }
+
+    peer = gst_pad_get_peer (pad);
+    gst_pad_unlink (pad, peer);
+
+    modder_pad = gst_element_get_static_pad (self->packet_modder, "src");
+    linkret = gst_pad_link (modder_pad, peer);
+    gst_object_unref (modder_pad);
+    if (GST_PAD_LINK_FAILED (linkret))
+    {
+      fs_session_emit_error (FS_SESSION (self->fsrtpsession),
+          FS_ERROR_CONSTRUCTION,
+          "Could not link transport-cc packet modder to rtp muxer");
+      goto linking_failed;
+    }
+
+    modder_pad = gst_element_get_static_pad (self->packet_modder, "sink");
+    linkret = gst_pad_link (pad, modder_pad);
+    gst_object_unref (modder_pad);
+    if (GST_PAD_LINK_FAILED (linkret))
+    {
+      fs_session_emit_error (FS_SESSION (self->fsrtpsession),
+          FS_ERROR_CONSTRUCTION,
+          "Could not link transport-cc packet modder to the rtpbin");
+      goto linking_failed;
+    }
+
+    if (gst_element_set_state (self->packet_modder, GST_STATE_PLAYING) ==
+        GST_STATE_CHANGE_FAILURE)
+    {
+      fs_session_emit_error (FS_SESSION (self->fsrtpsession),
+          FS_ERROR_CONSTRUCTION,
+          "Could not set the transport-cc packet modder to playing");
+      goto linking_failed;
+    }
+  }
+  else
+  {
+    GstPadLinkReturn linkret;
+    GstPad *modder_src_pad;
+
+    modder_src_pad = gst_element_get_static_pad (self->packet_modder, "src");
+    peer = gst_pad_get_peer (modder_src_pad);
+    gst_object_unref (modder_src_pad);
+
+    gst_bin_remove (self->parent_bin, self->packet_modder);
+    gst_element_set_state (self->packet_modder, GST_STATE_NULL);
+    gst_object_unref (self->packet_modder);
+    self->packet_modder = NULL;
+
+    linkret = gst_pad_link (pad, peer);
+    if (GST_PAD_LINK_FAILED (linkret))
+      fs_session_emit_error (FS_SESSION (self->fsrtpsession),
+          FS_ERROR_CONSTRUCTION,
+          "Could not re-link after removing transport-cc packet modder");
+  }
+
+out:
+  if (peer)
+    gst_object_unref (peer);
+  GST_OBJECT_UNLOCK (self);
+
+  return GST_PAD_PROBE_REMOVE;
+
+linking_failed:
+  gst_bin_remove (self->parent_bin, self->packet_modder);
+  gst_pad_link (pad, peer);
+adding_failed:
+  gst_object_unref (self->packet_modder);
+  self->packet_modder = NULL;
+  goto out;
+}
+
+static void
+fs_rtp_transport_cc_check_modder_locked (FsRtpTransportCc *self)
+{
+  gboolean need_modder;
+
+  need_modder = self->extension_type != EXTENSION_NONE;
+
+  if (!!self->packet_modder == need_modder)
+    return;
+
+  if (self->modder_check_probe_id != 0)
+    return;
+
+  self->modder_check_probe_id =
+      gst_pad_add_probe (self->out_rtp_pad,
+          GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM,
+          send_rtp_pad_blocked,
+          g_object_ref (self), (GDestroyNotify) g_object_unref);
+}
+
+
+FsRtpTransportCc *
+fs_rtp_transport_cc_new (FsRtpSession *fsrtpsession)
+{
+  FsRtpTransportCc *self;
+  GstElement *rtpmuxer;
+
+  g_return_val_if_fail (fsrtpsession, NULL);
+
+  self = g_object_new (FS_TYPE_RTP_TRANSPORT_CC, NULL);
+
+  self->fsrtpsession = fsrtpsession;
+  self->sending = FALSE;
+
+  self->rtpsession = fs_rtp_session_get_rtpbin_internal_session (fsrtpsession);
+  self->parent_bin = GST_BIN (fs_rtp_session_get_conference (fsrtpsession));
+  self->timer_wheel = fs_rtp_timer_wheel_ref (
+      fs_rtp_conference_get_timer_wheel (FS_RTP_CONFERENCE (self->parent_bin)));
+  self->in_rtp_pad = fs_rtp_session_get_rtpbin_recv_rtp_sink (fsrtpsession);
+  self->in_rtcp_pad = fs_rtp_session_get_rtpbin_recv_rtcp_sink (fsrtpsession);
+
+  rtpmuxer = fs_rtp_session_get_rtpmuxer (fsrtpsession);
+  self->out_rtp_pad = gst_element_get_static_pad (rtpmuxer, "src");
+  gst_object_unref (rtpmuxer);
+
+  self->in_rtp_probe_id = gst_pad_add_probe (self->in_rtp_pad,
+      GST_PAD_PROBE_TYPE_BUFFER, incoming_rtp_probe, self, NULL);
+  self->in_rtcp_probe_id = gst_pad_add_probe (self->in_rtcp_pad,
+      GST_PAD_PROBE_TYPE_BUFFER, incoming_rtcp_probe, self, NULL);
+
+  self->on_sending_rtcp_id = g_signal_connect_object (self->rtpsession,
+      "on-sending-rtcp", G_CALLBACK (rtpsession_sending_rtcp), self, 0);
+
+  return self;
+}
+
+static gboolean
+validate_ca_for_transport_cc (CodecAssociation *ca, gpointer user_data)
+{
+  return codec_association_is_valid_for_sending (ca, TRUE) &&
+      fs_codec_get_feedback_parameter (ca->codec, "transport-cc", "",  "");
+}
+
+/*
+ * Keeps transport-cc only if both the feedback parameter and the header
+ * extension were negotiated. When it is kept, it replaces TFRC, whose
+ * feedback parameter is removed so fs_rtp_tfrc_filter_codecs() also
+ * drops its header extension.
+ */
+
+void
+fs_rtp_transport_cc_filter_codecs (GList **codec_associations,
+    GList **header_extensions)
+{
+  gboolean has_header_ext = FALSE;
+  gboolean has_codec_rtcpfb = FALSE;
+  GList *item;
+
+  has_codec_rtcpfb = !!lookup_codec_association_custom (*codec_associations,
+      validate_ca_for_transport_cc, NULL);
+
+  for (item = *header_extensions; item;)
+  {
+    FsRtpHeaderExtension *hdrext = item->data;
+    GList *next = item->next;
+
+    if (!strcmp (hdrext->uri, TRANSPORT_CC_URI))
+    {
+      if (has_header_ext || !has_codec_rtcpfb)
+      {
+        GST_WARNING ("Removing transport-cc hdrext because matching"
+            " transport-cc feedback parameter not found or because"
+            " rtp-hdrext is duplicated");
+        fs_rtp_header_extension_destroy (item->data);
+        *header_extensions = g_list_remove_link (*header_extensions, item);
+      }
+      else if (hdrext->direction == FS_DIRECTION_BOTH)
+      {
+        has_header_ext = TRUE;
+      }
+    }
+    item = next;
+  }
+
+  if (!has_codec_rtcpfb)
+    return;
+
+  for (item = *codec_associations; item; item = item->next)
+  {
+    CodecAssociation *ca = item->data;
+    GList *item2;
+
+    for (item2 = ca->codec->feedback_params; item2;)
+    {
+      GList *next2 = item2->next;
+      FsFeedbackParameter *p = item2->data;
+
+      if (!has_header_ext && !g_ascii_strcasecmp (p->type, "transport-cc"))
+      {
+        GST_WARNING ("Removing transport-cc from codec because no"
+            " transport-cc hdrext: " FS_CODEC_FORMAT,
+            FS_CODEC_ARGS (ca->codec));
+        fs_codec_remove_feedback_parameter (ca->codec, item2);
+      }
+      else if (has_header_ext && !g_ascii_strcasecmp (p->type, "tfrc"))
+      {
+        GST_DEBUG ("Removing tfrc from codec in favour of transport-cc: "
+            FS_CODEC_FORMAT, FS_CODEC_ARGS (ca->codec));
+        fs_codec_remove_feedback_parameter (ca->codec, item2);
+      }
+
+      item2 = next2;
+    }
+  }
+}
+
+static void
+fs_rtp_transport_cc_codecs_updated (FsRtpCongestionControl *cc,
+    GList *codec_associations,
+    GList *header_extensions)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (cc);
+  GList *item;
+  FsRtpHeaderExtension *hdrext;
+
+  GST_OBJECT_LOCK (self);
+
+  memset (self->pts, 0, 128);
+  for (item = codec_associations; item; item = item->next)
+  {
+    CodecAssociation *ca = item->data;
+
+    /* Like TFRC, it needs the encoder to only send keyframes on request */
+    if (fs_codec_get_feedback_parameter (ca->codec, "transport-cc", NULL,
+            NULL) &&
+        fs_rtp_keyunit_manager_has_key_request_feedback (ca->codec))
+      self->pts[ca->codec->id] = TRUE;
+  }
+
+  for (item = header_extensions; item; item = item->next)
+  {
+    hdrext = item->data;
+    if (!strcmp (hdrext->uri, TRANSPORT_CC_URI) &&
+        hdrext->direction == FS_DIRECTION_BOTH)
+      break;
+  }
+
+  if (!item)
+  {
+    self->extension_type = EXTENSION_NONE;
+    goto out;
+  }
+
+  if (hdrext->id > 15)
+    self->extension_type = EXTENSION_TWO_BYTES;
+  else
+    self->extension_type = EXTENSION_ONE_BYTE;
+
+  self->extension_id = hdrext->id;
+
+out:
+  fs_rtp_transport_cc_check_modder_locked (self);
+
+  GST_OBJECT_UNLOCK (self);
+}
+
+
+static gboolean
+fs_rtp_transport_cc_is_enabled (FsRtpCongestionControl *cc, guint pt)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (cc);
+  gboolean is_enabled;
+
+  GST_OBJECT_LOCK (self);
+  is_enabled = (self->extension_type != EXTENSION_NONE) &&
+      self->pts[pt];
+  GST_OBJECT_UNLOCK (self);
+
+  return is_enabled;
+}
+
+static void
+fs_rtp_transport_cc_warm_start (FsRtpCongestionControl *cc, guint bitrate)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (cc);
+  gboolean notify;
+
+  GST_OBJECT_LOCK (self);
+  gcc_sender_warm_start (self->sender, bitrate);
+  notify = fs_rtp_transport_cc_update_bitrate_locked (self, "warm start");
+  GST_OBJECT_UNLOCK (self);
+
+  if (notify)
+    g_object_notify (G_OBJECT (self), "bitrate");
+}
+
+static gboolean
+fs_rtp_transport_cc_get_path (FsRtpCongestionControl *cc, guint *rtt,
+    gdouble *loss)
+{
+  FsRtpTransportCc *self = FS_RTP_TRANSPORT_CC (cc);
+  gboolean ret = FALSE;
+
+  GST_OBJECT_LOCK (self);
+  if (gcc_sender_get_rtt (self->sender))
+  {
+    *rtt = gcc_sender_get_rtt (self->sender);
+    *loss = gcc_sender_get_loss (self->sender);
+    ret = TRUE;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  return ret;
+}
@@ -0,0 +1,128 @@
+/*
+ * Farstream - Farstream RTP Transport-wide Congestion Control
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * fs-rtp-transport-cc.h - Delay-based rate control for Farstream RTP
+ *  sessions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+#ifndef __FS_RTP_TRANSPORT_CC_H__
+#define __FS_RTP_TRANSPORT_CC_H__
+
+#include <gst/gst.h>
+
+#include "gcc.h"
+
+#include "fs-rtp-session.h"
+#include "fs-rtp-congestion-control.h"
+#include "fs-rtp-keyunit-manager.h"
+#include "fs-rtp-timer-wheel.h"
+#include "fs-rtp-packet-modder.h"
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_RTP_TRANSPORT_CC \
+  (fs_rtp_transport_cc_get_type ())
+#define FS_RTP_TRANSPORT_CC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_RTP_TRANSPORT_CC, \
+      FsRtpTransportCc))
+#define FS_RTP_TRANSPORT_CC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_RTP_TRANSPORT_CC, \
+      FsRtpTransportCcClass))
+#define FS_IS_RTP_TRANSPORT_CC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_RTP_TRANSPORT_CC))
+#define FS_IS_RTP_TRANSPORT_CC_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_RTP_TRANSPORT_CC))
+#define FS_RTP_TRANSPORT_CC_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), FS_TYPE_RTP_TRANSPORT_CC, \
+      FsRtpTransportCcClass))
+#define FS_RTP_TRANSPORT_CC_CAST(obj) ((FsRtpTransportCc *) (obj))
+
+#define FS_RTP_TRANSPORT_CC_DEFAULT_MAX_PROBE_BITRATE (10 * 1000 * 1000)
+
+typedef struct _FsRtpTransportCc FsRtpTransportCc;
+typedef struct _FsRtpTransportCcClass FsRtpTransportCcClass;
+
+/**
+ * FsRtpTransportCc:
+ *
+ * Numbers every outgoing packet with a transport-wide sequence number,
+ * reports the arrival time of the incoming ones and runs a delay-based
+ * controller on the reports of the other side.
+ */
+struct _FsRtpTransportCc
+{
+  FsRtpCongestionControl parent;
+
+  GstClock *systemclock;
+  FsRtpTimerWheel *timer_wheel;
+
+  FsRtpSession *fsrtpsession;
+  GstBin *parent_bin;
+  GObject *rtpsession;
+
+  GstPad *in_rtp_pad;
+  GstPad *in_rtcp_pad;
+  GstPad *out_rtp_pad;
+
+  gulong in_rtp_probe_id;
+  gulong in_rtcp_probe_id;
+
+  gulong on_sending_rtcp_id;
+
+  gulong modder_check_probe_id;
+  GstElement *packet_modder;
+
+  /* Sender stuff */
+  gboolean sending;
+  guint send_bitrate;
+  guint max_probe_bitrate;
+  GccSender *sender;
+  /* The source whose feedback drives the sender */
+  guint32 feedback_ssrc;
+  guint64 last_feedback;
+
+  /* Receiver stuff */
+  GccReceiver *receiver;
+  guint32 media_ssrc;
+  FsRtpTimer *feedback_timer;
+
+  ExtensionType extension_type;
+  guint extension_id;
+
+  gboolean pts[128];
+};
+
+struct _FsRtpTransportCcClass
+{
+  FsRtpCongestionControlClass parent_class;
+};
+
+
+GType fs_rtp_transport_cc_get_type (void);
+
+FsRtpTransportCc *fs_rtp_transport_cc_new (FsRtpSession *fsrtpsession);
+
+void fs_rtp_transport_cc_filter_codecs (GList **codec_associations,
+    GList **header_extensions);
+
+G_END_DECLS
+
+#endif /* __FS_RTP_TRANSPORT_CC_H__ */
@@ -0,0 +1,1436 @@
+/*
+ * Farstream - Farstream delay-based congestion control
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * gcc.c - A delay-based congestion controller driven by transport-wide
+ *  feedback, draft-ietf-rmcat-gcc-02 and
+ *  draft-holmer-rmcat-transport-wide-cc-extensions-01
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "gcc.h"
+
+#include <math.h>
+#include <string.h>
+
+/* for GST_READ_UINT16_BE and friends */
+#include <gst/gst.h>
+
+/*
+ * ALL TIMES ARE IN MICROSECONDS
+ * bitrates are in bits/sec
+ *
+ * The receiver only records when each packet arrived and reports it back
+ * in the transport-wide feedback. The sender does all the work: it groups
+ * the packets sent within a burst, and looks at how the difference between
+ * the spacing of the groups on arrival and on departure accumulates. A
+ * trendline over the last groups tells if the bottleneck queue is growing,
+ * which is compared to a threshold that adapts to the jitter of the path.
+ * The bitrate goes up while the queue is stable and down to a bit below
+ * what actually went through as soon as it grows, long before it
+ * overflows. A loss-based controller on top only matters when the losses
+ * do not come from the queue.
+ *
+ * At the start, a few short clusters of packets are sent at multiples of
+ * the initial bitrate, padded by the pacer if the encoder does not produce
+ * enough. The rate at which they arrive shows what the path can take, and
+ * the bitrate jumps there instead of growing 8% per second. Each cluster
+ * that goes through unharmed is followed by one twice as fast, until one
+ * is slowed down by the bottleneck, loses packets, makes the queue grow or
+ * reaches the maximum probe bitrate. Clusters only last a few packets, so
+ * the other flows see at most a few milliseconds of extra queueing.
+ */
+
+#if 0
+#define DEBUG_SENDER(sender, format, ...) \
+  g_debug ("GCC-S (%p): " format,  sender,  __VA_ARGS__)
+#else
+#define DEBUG_SENDER(...)
+#endif
+
+#define SECOND (1000 * 1000)
+#define MS (1000)
+
+#define DEFAULT_INITIAL_BITRATE (300 * 1000)
+#define MIN_BITRATE (30 * 1000)
+#define MAX_BITRATE (30 * 1000 * 1000)
+
+/* Must be a power of 2, packets older than that can not be acknowledged */
+#define HISTORY_SIZE (4096)
+
+/* Packets sent within that long of the first of a group are one group */
+#define BURST_TIME (5 * MS)
+
+#define TRENDLINE_WINDOW (20)
+#define TRENDLINE_SMOOTHING (0.9)
+#define TRENDLINE_GAIN (4.0)
+#define TRENDLINE_MAX_DELTAS (60)
+
+/* The thresholds and the trend are in milliseconds */
+#define INITIAL_THRESHOLD (12.5)
+#define MIN_THRESHOLD (6.0)
+#define MAX_THRESHOLD (600.0)
+#define THRESHOLD_K_UP (0.0087)
+#define THRESHOLD_K_DOWN (0.039)
+#define MAX_THRESHOLD_STEP (15.0)
+#define OVERUSE_TIME (10.0)
+
+#define BETA (0.85)
+#define INCREASE_FACTOR (1.08)
+#define ACKED_WINDOW (250 * MS)
+
+#define LOSS_LOW (0.02)
+#define LOSS_HIGH (0.1)
+#define MIN_LOSS_SAMPLES (20)
+
+/* Halve the bitrate when the feedback stops for that long */
+#define NO_FEEDBACK_TIMEOUT (500 * MS)
+
+#define DEFAULT_MAX_PROBE_BITRATE (10 * 1000 * 1000)
+#define PROBE_MAX_CLUSTERS (8)
+#define PROBE_MIN_PACKETS (5)
+#define PROBE_MIN_DURATION (15 * MS)
+/* A cluster not sent or not reported within that long is given up */
+#define PROBE_TIMEOUT (SECOND)
+/* Arriving slower than that fraction of the sending rate means the cluster
+ * was held back by the bottleneck */
+#define PROBE_LIMITED_RATIO (0.9)
+
+typedef enum {
+  USAGE_NORMAL,
+  USAGE_UNDERUSING,
+  USAGE_OVERUSING
+} GccUsage;
+
+typedef enum {
+  RATE_HOLD,
+  RATE_INCREASE,
+  RATE_DECREASE
+} GccRateState;
+
+struct SentPacket {
+  guint64 seqnum;
+  guint64 send_time;
+  guint size;
+  gboolean reported;
+  gboolean received;
+  /* index of its probe cluster, -1 if none */
+  gint probe;
+};
+
+struct ProbeCluster {
+  guint bitrate;
+
+  guint sent_packets;
+  guint64 sent_bytes;
+  guint64 first_send;
+  guint64 last_send;
+  guint last_send_size;
+  gboolean sent;
+
+  guint reported_packets;
+  guint received_packets;
+  guint64 received_bytes;
+  gboolean has_arrival;
+  gint64 first_arrival;
+  gint64 last_arrival;
+  guint first_arrival_size;
+};
+
+struct PacketGroup {
+  guint64 first_send;
+  guint64 last_send;
+  gint64 last_arrival;
+};
+
+/* What the sender and the receiver side estimations share */
+struct DelayEstimator {
+  gboolean has_group;
+  gboolean has_prev_group;
+  struct PacketGroup group;
+  struct PacketGroup prev_group;
+
+  /* trendline filter */
+  gint64 first_arrival;
+  gdouble accumulated_delay;
+  gdouble smoothed_delay;
+  gdouble window_x[TRENDLINE_WINDOW];
+  gdouble window_y[TRENDLINE_WINDOW];
+  guint window_len;
+  guint window_pos;
+  guint num_deltas;
+  gdouble trend;
+  gdouble prev_trend;
+
+  /* overuse detector */
+  gdouble threshold;
+  guint64 last_threshold_update;
+  gdouble time_over_using;
+  guint overuse_counter;
+  GccUsage usage;
+
+  /* delay-based rate controller */
+  GccRateState state;
+  gdouble bitrate;
+  guint64 last_rate_update;
+  guint64 last_decrease;
+  gboolean has_link_capacity;
+  gdouble link_capacity;
+  gdouble link_capacity_var;
+
+  /* what went through */
+  gdouble acked_bitrate;
+  guint64 acked_bytes;
+  gint64 acked_window_start;
+  gboolean has_acked_window;
+  gdouble average_packet_size;
+  guint rtt;
+};
+
+struct _GccSender {
+  struct SentPacket history[HISTORY_SIZE];
+  /* unwrapped */
+  guint64 next_seqnum;
+
+  gboolean has_ref_time;
+  guint32 last_ref_time;
+  gint64 ref_time;
+
+  struct DelayEstimator delay;
+
+  /* loss-based controller */
+  gdouble loss_bitrate;
+  gdouble loss;
+  guint lost;
+  guint received;
+  guint64 last_loss_update;
+
+  guint64 last_send_time;
+  guint64 no_feedback_expiry;
+
+  /* probing */
+  guint max_probe_bitrate;
+  struct ProbeCluster probes[PROBE_MAX_CLUSTERS];
+  guint n_probes;
+  /* the one being sent and the next one to evaluate */
+  guint probe_sending;
+  guint probe_evaluated;
+};
+
+static void
+delay_estimator_init (struct DelayEstimator *est, guint initial_bitrate)
+{
+  est->threshold = INITIAL_THRESHOLD;
+  est->time_over_using = -1;
+  est->state = RATE_HOLD;
+  est->bitrate = CLAMP (initial_bitrate, MIN_BITRATE, MAX_BITRATE);
+}
+
+GccSender *
+gcc_sender_new (guint64 now, guint initial_bitrate)
+{
+  GccSender *sender = g_slice_new0 (GccSender);
+
+  if (initial_bitrate == 0)
+    initial_bitrate = DEFAULT_INITIAL_BITRATE;
+
+  delay_estimator_init (&sender->delay, initial_bitrate);
+  sender->loss_bitrate = sender->delay.bitrate;
+  sender->last_loss_update = now;
+  sender->max_probe_bitrate = DEFAULT_MAX_PROBE_BITRATE;
+
+  return sender;
+}
+
+/**
+ * gcc_sender_set_max_probe_bitrate:
+ * @sender: a #GccSender
+ * @bitrate: the highest bitrate to probe at, 0 to not probe
+ *
+ * Must be called before the first packet is sent, or it only affects the
+ * clusters that have not been started yet.
+ */
+
+void
+gcc_sender_set_max_probe_bitrate (GccSender *sender, guint bitrate)
+{
+  sender->max_probe_bitrate = bitrate;
+
+  /* Forget the clusters not started yet that are now too fast */
+  while (sender->n_probes > sender->probe_sending &&
+      sender->probes[sender->n_probes - 1].bitrate > bitrate)
+    sender->n_probes--;
+}
+
+void
+gcc_sender_free (GccSender *sender)
+{
+  g_slice_free (GccSender, sender);
+}
+
+guint
+gcc_sender_get_bitrate (GccSender *sender)
+{
+  return MIN (sender->delay.bitrate, sender->loss_bitrate);
+}
+
+guint
+gcc_sender_get_rtt (GccSender *sender)
+{
+  return sender->delay.rtt;
+}
+
+gdouble
+gcc_sender_get_loss (GccSender *sender)
+{
+  return sender->loss;
+}
+
+static void
+probe_add_cluster (GccSender *sender, gdouble bitrate)
+{
+  bitrate = MIN (bitrate, sender->max_probe_bitrate);
+
+  if (sender->n_probes == PROBE_MAX_CLUSTERS ||
+      bitrate <= gcc_sender_get_bitrate (sender) ||
+      (sender->n_probes > 0 &&
+          bitrate <= sender->probes[sender->n_probes - 1].bitrate))
+    return;
+
+  memset (&sender->probes[sender->n_probes], 0, sizeof (struct ProbeCluster));
+  sender->probes[sender->n_probes].bitrate = bitrate;
+  sender->n_probes++;
+  DEBUG_SENDER (sender, "probing at %f", bitrate);
+}
+
+/* Nothing more is probed, the clusters already sent may still be used */
+
+static void
+probe_stop (GccSender *sender)
+{
+  struct ProbeCluster *cluster;
+
+  if (sender->probe_sending < sender->n_probes)
+  {
+    cluster = &sender->probes[sender->probe_sending];
+    cluster->sent = TRUE;
+    sender->n_probes = sender->probe_sending +
+        (cluster->sent_packets ? 1 : 0);
+  }
+  sender->probe_sending = sender->n_probes;
+  sender->max_probe_bitrate = 0;
+}
+
+/**
+ * gcc_sender_warm_start:
+ * @sender: a #GccSender
+ * @bitrate: the bitrate an earlier connection over the same path reached
+ *
+ * Starts from that bitrate instead of the initial one, the probing then
+ * starts from there too. It does nothing once there was any feedback.
+ */
+
+void
+gcc_sender_warm_start (GccSender *sender, guint bitrate)
+{
+  struct ProbeCluster *cluster;
+
+  if (sender->has_ref_time)
+    return;
+
+  sender->delay.bitrate = CLAMP (bitrate, MIN_BITRATE, MAX_BITRATE);
+  sender->loss_bitrate = sender->delay.bitrate;
+
+  /* Only keep the cluster being sent, if any */
+  if (sender->probe_sending < sender->n_probes)
+  {
+    cluster = &sender->probes[sender->probe_sending];
+    sender->n_probes = sender->probe_sending +
+        (cluster->sent_packets ? 1 : 0);
+  }
+
+  if (sender->next_seqnum > 0 && sender->max_probe_bitrate)
+  {
+    probe_add_cluster (sender, 3 * sender->delay.bitrate);
+    probe_add_cluster (sender, 6 * sender->delay.bitrate);
+  }
+}
+
+static gint
+probe_sending_packet (GccSender *sender, guint64 now, guint size)
+{
+  struct ProbeCluster *cluster;
+  gint probe;
+
+  if (sender->next_seqnum == 1 && sender->max_probe_bitrate)
+  {
+    probe_add_cluster (sender, 3 * sender->delay.bitrate);
+    probe_add_cluster (sender, 6 * sender->delay.bitrate);
+  }
+
+  if (sender->probe_sending == sender->n_probes)
+    return -1;
+
+  probe = sender->probe_sending;
+  cluster = &sender->probes[probe];
+
+  if (cluster->sent_packets == 0)
+    cluster->first_send = now;
+  else if (now - cluster->first_send > PROBE_TIMEOUT)
+  {
+    probe_stop (sender);
+    return -1;
+  }
+
+  cluster->sent_packets++;
+  cluster->sent_bytes += size;
+  cluster->last_send = now;
+  cluster->last_send_size = size;
+
+  if (cluster->sent_packets >= PROBE_MIN_PACKETS &&
+      now - cluster->first_send >= PROBE_MIN_DURATION)
+  {
+    cluster->sent = TRUE;
+    sender->probe_sending++;
+  }
+
+  return probe;
+}
+
+guint16
+gcc_sender_sending_packet (GccSender *sender, guint64 now, guint size)
+{
+  struct SentPacket *packet;
+  guint64 seqnum = sender->next_seqnum++;
+
+  packet = &sender->history[seqnum & (HISTORY_SIZE - 1)];
+  packet->seqnum = seqnum;
+  packet->send_time = now;
+  packet->size = size;
+  packet->reported = FALSE;
+  packet->received = FALSE;
+  packet->probe = probe_sending_packet (sender, now, size);
+
+  /* The timeout starts again when the sending stopped for a while */
+  if (sender->no_feedback_expiry == 0 ||
+      now - sender->last_send_time > NO_FEEDBACK_TIMEOUT)
+  {
+    sender->no_feedback_expiry = now + NO_FEEDBACK_TIMEOUT;
+  }
+  else if (now >= sender->no_feedback_expiry)
+  {
+    gdouble bitrate = gcc_sender_get_bitrate (sender) / 2;
+
+    sender->delay.bitrate = sender->loss_bitrate = MAX (bitrate, MIN_BITRATE);
+    sender->delay.state = RATE_HOLD;
+    sender->no_feedback_expiry = now + NO_FEEDBACK_TIMEOUT;
+    DEBUG_SENDER (sender, "no feedback, bitrate: %f", sender->delay.bitrate);
+  }
+  sender->last_send_time = now;
+
+  return seqnum & 0xFFFF;
+}
+
+/**
+ * gcc_sender_get_probe_bitrate:
+ * @sender: a #GccSender
+ *
+ * Returns: the bitrate at which to pace the packets of the probe cluster
+ *  being sent, or 0 if not probing
+ */
+
+guint
+gcc_sender_get_probe_bitrate (GccSender *sender)
+{
+  if (sender->probe_sending == sender->n_probes)
+    return 0;
+
+  return sender->probes[sender->probe_sending].bitrate;
+}
+
+/**
+ * gcc_sender_get_probe_padding:
+ * @sender: a #GccSender
+ *
+ * Returns: how many bytes of padding to send if nothing else is sent, for
+ *  the probe cluster being sent to be complete
+ */
+
+guint
+gcc_sender_get_probe_padding (GccSender *sender)
+{
+  struct ProbeCluster *cluster;
+  guint64 needed;
+
+  if (sender->probe_sending == sender->n_probes)
+    return 0;
+
+  cluster = &sender->probes[sender->probe_sending];
+  needed = (guint64) cluster->bitrate * PROBE_MIN_DURATION / (8 * SECOND);
+
+  /* Too few packets, or too fast, it still needs something */
+  if (cluster->sent_bytes >= needed)
+    return 1;
+
+  return needed - cluster->sent_bytes;
+}
+
+/* A linear regression over the window of (arrival time, smoothed delay) */
+
+static gdouble
+trendline_slope (struct DelayEstimator *est)
+{
+  gdouble sum_x = 0, sum_y = 0, mean_x, mean_y;
+  gdouble numerator = 0, denominator = 0;
+  guint i;
+
+  for (i = 0; i < est->window_len; i++)
+  {
+    sum_x += est->window_x[i];
+    sum_y += est->window_y[i];
+  }
+  mean_x = sum_x / est->window_len;
+  mean_y = sum_y / est->window_len;
+
+  for (i = 0; i < est->window_len; i++)
+  {
+    gdouble dx = est->window_x[i] - mean_x;
+
+    numerator += dx * (est->window_y[i] - mean_y);
+    denominator += dx * dx;
+  }
+
+  if (denominator == 0)
+    return est->trend;
+
+  return numerator / denominator;
+}
+
+static void
+update_threshold (struct DelayEstimator *est, gdouble modified_trend, guint64 now)
+{
+  gdouble abs_trend = fabs (modified_trend);
+  gdouble k;
+  guint64 dt;
+
+  if (est->last_threshold_update == 0)
+    est->last_threshold_update = now;
+
+  /* Do not adapt to spikes, they are not the usual jitter of the path */
+  if (abs_trend > est->threshold + MAX_THRESHOLD_STEP)
+  {
+    est->last_threshold_update = now;
+    return;
+  }
+
+  k = abs_trend < est->threshold ? THRESHOLD_K_DOWN : THRESHOLD_K_UP;
+  dt = MIN (now - est->last_threshold_update, 100 * MS);
+
+  est->threshold += k * (abs_trend - est->threshold) * dt / MS;
+  est->threshold = CLAMP (est->threshold, MIN_THRESHOLD, MAX_THRESHOLD);
+  est->last_threshold_update = now;
+}
+
+static void
+detect_overuse (struct DelayEstimator *est, gdouble send_delta_ms, guint64 now)
+{
+  gdouble modified_trend;
+
+  if (est->num_deltas < 2)
+    return;
+
+  modified_trend = MIN (est->num_deltas, TRENDLINE_MAX_DELTAS) *
+      est->trend * TRENDLINE_GAIN;
+
+  if (modified_trend > est->threshold)
+  {
+    if (est->time_over_using < 0)
+      est->time_over_using = send_delta_ms / 2;
+    else
+      est->time_over_using += send_delta_ms;
+    est->overuse_counter++;
+
+    if (est->time_over_using > OVERUSE_TIME &&
+        est->overuse_counter > 1 &&
+        est->trend >= est->prev_trend)
+    {
+      est->time_over_using = 0;
+      est->overuse_counter = 0;
+      est->usage = USAGE_OVERUSING;
+    }
+  }
+  else if (modified_trend < -est->threshold)
+  {
+    est->time_over_using = -1;
+    est->overuse_counter = 0;
+    est->usage = USAGE_UNDERUSING;
+  }
+  else
+  {
+    est->time_over_using = -1;
+    est->overuse_counter = 0;
+    est->usage = USAGE_NORMAL;
+  }
+
+  est->prev_trend = est->trend;
+  update_threshold (est, modified_trend, now);
+}
+
+static void
+trendline_update (struct DelayEstimator *est, gint64 send_delta, gint64 arrival_delta,
+    gint64 arrival_time, guint64 now)
+{
+  gdouble delay = (arrival_delta - send_delta) / (gdouble) MS;
+
+  if (est->num_deltas == 0)
+    est->first_arrival = arrival_time;
+  est->num_deltas = MIN (est->num_deltas + 1, 1000);
+
+  est->accumulated_delay += delay;
+  est->smoothed_delay = TRENDLINE_SMOOTHING * est->smoothed_delay +
+      (1 - TRENDLINE_SMOOTHING) * est->accumulated_delay;
+
+  est->window_x[est->window_pos] =
+      (arrival_time - est->first_arrival) / (gdouble) MS;
+  est->window_y[est->window_pos] = est->smoothed_delay;
+  est->window_pos = (est->window_pos + 1) % TRENDLINE_WINDOW;
+  if (est->window_len < TRENDLINE_WINDOW)
+    est->window_len++;
+
+  if (est->window_len == TRENDLINE_WINDOW)
+    est->trend = trendline_slope (est);
+
+  detect_overuse (est, send_delta / (gdouble) MS, now);
+}
+
+static void
+acked_packet (struct DelayEstimator *est, gint64 arrival, guint size)
+{
+  if (!est->has_acked_window)
+  {
+    est->acked_window_start = arrival;
+    est->has_acked_window = TRUE;
+  }
+  else if (arrival - est->acked_window_start >= ACKED_WINDOW)
+  {
+    gdouble sample = est->acked_bytes * 8.0 * SECOND /
+        (arrival - est->acked_window_start);
+
+    if (est->acked_bitrate == 0)
+      est->acked_bitrate = sample;
+    else
+      est->acked_bitrate = 0.5 * est->acked_bitrate + 0.5 * sample;
+    est->acked_bytes = 0;
+    est->acked_window_start = arrival;
+  }
+
+  est->acked_bytes += size;
+
+  if (est->average_packet_size == 0)
+    est->average_packet_size = size;
+  else
+    est->average_packet_size = 0.95 * est->average_packet_size +
+        0.05 * size;
+}
+
+static void
+received_packet (struct DelayEstimator *est, guint64 send_time, guint size,
+    gint64 arrival, guint64 now)
+{
+  acked_packet (est, arrival, size);
+
+  if (!est->has_group)
+  {
+    est->group.first_send = est->group.last_send = send_time;
+    est->group.last_arrival = arrival;
+    est->has_group = TRUE;
+    return;
+  }
+
+  /* Reordered by the network, only the acked bitrate can use it */
+  if (send_time < est->group.first_send)
+    return;
+
+  if (send_time - est->group.first_send <= BURST_TIME)
+  {
+    est->group.last_send = MAX (est->group.last_send,
+        send_time);
+    est->group.last_arrival = MAX (est->group.last_arrival, arrival);
+    return;
+  }
+
+  if (est->has_prev_group)
+    trendline_update (est,
+        est->group.last_send - est->prev_group.last_send,
+        est->group.last_arrival - est->prev_group.last_arrival,
+        est->group.last_arrival, now);
+
+  est->prev_group = est->group;
+  est->has_prev_group = TRUE;
+  est->group.first_send = est->group.last_send = send_time;
+  est->group.last_arrival = arrival;
+}
+
+static void
+update_link_capacity (struct DelayEstimator *est)
+{
+  gdouble norm, error;
+
+  if (!est->has_link_capacity)
+  {
+    est->link_capacity = est->acked_bitrate;
+    est->link_capacity_var = 0.4;
+    est->has_link_capacity = TRUE;
+    return;
+  }
+
+  est->link_capacity = 0.95 * est->link_capacity +
+      0.05 * est->acked_bitrate;
+  norm = MAX (est->link_capacity, 1.0);
+  error = est->link_capacity - est->acked_bitrate;
+  est->link_capacity_var = 0.95 * est->link_capacity_var +
+      0.05 * error * error / norm;
+  est->link_capacity_var = CLAMP (est->link_capacity_var, 0.4, 2.5);
+}
+
+static void
+update_delay_bitrate (struct DelayEstimator *est, guint64 now)
+{
+  gdouble dt;
+
+  switch (est->usage)
+  {
+    case USAGE_OVERUSING:
+      if (est->state != RATE_DECREASE)
+        est->state = RATE_DECREASE;
+      break;
+    case USAGE_UNDERUSING:
+      est->state = RATE_HOLD;
+      break;
+    case USAGE_NORMAL:
+      if (est->state == RATE_HOLD)
+      {
+        est->state = RATE_INCREASE;
+        est->last_rate_update = now;
+      }
+      break;
+  }
+
+  dt = MIN (now - est->last_rate_update, SECOND) / (gdouble) SECOND;
+
+  switch (est->state)
+  {
+    case RATE_HOLD:
+      break;
+
+    case RATE_INCREASE:
+      /* Forget the capacity if the path got much faster */
+      if (est->has_link_capacity && est->acked_bitrate >
+          est->link_capacity + 3 * sqrt (est->link_capacity_var *
+              est->link_capacity))
+        est->has_link_capacity = FALSE;
+
+      if (est->has_link_capacity)
+      {
+        /* Close to the last known capacity, about one packet per RTT */
+        gdouble response_time = (est->rtt + 100 * MS) /
+            (gdouble) SECOND;
+        gdouble increase = est->average_packet_size * 8 / response_time;
+
+        est->bitrate += MAX (increase, 4000) * dt;
+      }
+      else
+      {
+        est->bitrate *= pow (INCREASE_FACTOR, dt);
+      }
+
+      if (est->acked_bitrate > 0)
+        est->bitrate = MIN (est->bitrate,
+            1.5 * est->acked_bitrate + 10000);
+      est->last_rate_update = now;
+      break;
+
+    case RATE_DECREASE:
+      /* Give the previous decrease one RTT to take effect */
+      if (est->acked_bitrate > 0 &&
+          now - est->last_decrease >= MAX (est->rtt, 100 * MS))
+      {
+        gdouble bitrate = BETA * est->acked_bitrate;
+
+        if (bitrate < est->bitrate)
+          est->bitrate = bitrate;
+        update_link_capacity (est);
+        est->last_decrease = now;
+        DEBUG_SENDER (est, "overuse, bitrate: %f", est->bitrate);
+      }
+      est->state = RATE_HOLD;
+      est->last_rate_update = now;
+      break;
+  }
+
+  est->bitrate = CLAMP (est->bitrate, MIN_BITRATE,
+      MAX_BITRATE);
+}
+
+/* Only the losses that happened since the last update matter, and only
+ * once there are enough packets to compute a rate */
+
+static void
+update_loss_bitrate (GccSender *sender, guint64 now)
+{
+  guint total = sender->lost + sender->received;
+  gdouble bitrate = gcc_sender_get_bitrate (sender);
+  gdouble loss, dt;
+
+  if (total == 0 || (total < MIN_LOSS_SAMPLES &&
+          now - sender->last_loss_update < SECOND))
+    return;
+
+  loss = (gdouble) sender->lost / total;
+  sender->loss = loss;
+  dt = MIN (now - sender->last_loss_update, SECOND) / (gdouble) SECOND;
+
+  if (loss < LOSS_LOW)
+    sender->loss_bitrate = bitrate * pow (INCREASE_FACTOR, dt);
+  else if (loss > LOSS_HIGH)
+    sender->loss_bitrate = bitrate * (1 - 0.5 * loss);
+  else
+    sender->loss_bitrate = bitrate;
+
+  sender->loss_bitrate = CLAMP (sender->loss_bitrate, MIN_BITRATE,
+      MAX_BITRATE);
+  sender->lost = 0;
+  sender->received = 0;
+  sender->last_loss_update = now;
+}
+
+static void
+probe_received_packet (GccSender *sender, struct SentPacket *packet,
+    gint64 arrival)
+{
+  struct ProbeCluster *cluster;
+
+  if (packet->probe < 0 || packet->probe >= sender->n_probes)
+    return;
+
+  cluster = &sender->probes[packet->probe];
+  cluster->received_packets++;
+  cluster->received_bytes += packet->size;
+
+  if (!cluster->has_arrival || arrival < cluster->first_arrival)
+  {
+    cluster->first_arrival = arrival;
+    cluster->first_arrival_size = packet->size;
+  }
+  if (!cluster->has_arrival || arrival > cluster->last_arrival)
+    cluster->last_arrival = arrival;
+  cluster->has_arrival = TRUE;
+}
+
+/*
+ * The rate is what was sent or received between the first and the last
+ * packet, so the size of one of the ends is not counted. If the cluster
+ * arrived much slower than it was sent, the bottleneck is a bit below the
+ * rate it arrived at.
+ */
+
+static gboolean
+probe_evaluate (GccSender *sender, struct ProbeCluster *cluster)
+{
+  gdouble send_rate, receive_rate, estimate;
+  gdouble bitrate = gcc_sender_get_bitrate (sender);
+  gboolean limited;
+
+  if (cluster->received_packets < cluster->sent_packets ||
+      cluster->last_send <= cluster->first_send ||
+      cluster->last_arrival <= cluster->first_arrival)
+    return FALSE;
+
+  send_rate = (cluster->sent_bytes - cluster->last_send_size) * 8.0 *
+      SECOND / (cluster->last_send - cluster->first_send);
+  receive_rate = (cluster->received_bytes - cluster->first_arrival_size) *
+      8.0 * SECOND / (cluster->last_arrival - cluster->first_arrival);
+
+  limited = receive_rate < PROBE_LIMITED_RATIO * send_rate;
+  if (limited)
+    estimate = BETA * receive_rate;
+  else
+    estimate = MIN (send_rate, receive_rate);
+
+  DEBUG_SENDER (sender, "probe at %u: sent %f received %f", cluster->bitrate,
+      send_rate, receive_rate);
+
+  if (estimate > bitrate)
+  {
+    estimate = MIN (estimate, MAX_BITRATE);
+    sender->delay.bitrate = estimate;
+    sender->loss_bitrate = MAX (sender->loss_bitrate, estimate);
+    /* Or the increase would be capped by what the encoder sent so far */
+    sender->delay.acked_bitrate = MAX (sender->delay.acked_bitrate,
+        estimate);
+    sender->delay.has_link_capacity = FALSE;
+  }
+
+  return !limited;
+}
+
+static void
+probe_on_feedback (GccSender *sender, guint64 now)
+{
+  /* What the clusters got through is not what the path can take anymore */
+  if (sender->delay.usage == USAGE_OVERUSING)
+  {
+    probe_stop (sender);
+    sender->probe_evaluated = sender->n_probes;
+    return;
+  }
+
+  while (sender->probe_evaluated < sender->n_probes)
+  {
+    struct ProbeCluster *cluster = &sender->probes[sender->probe_evaluated];
+
+    if (!cluster->sent)
+      break;
+
+    if (cluster->reported_packets < cluster->sent_packets)
+    {
+      if (now - cluster->last_send > PROBE_TIMEOUT)
+        probe_stop (sender);
+      else
+        break;
+    }
+    else if (!probe_evaluate (sender, cluster))
+    {
+      probe_stop (sender);
+    }
+    else if (sender->probe_evaluated == sender->n_probes - 1)
+    {
+      probe_add_cluster (sender, 2.0 * gcc_sender_get_bitrate (sender));
+    }
+
+    sender->probe_evaluated++;
+  }
+}
+
+/*
+ * The feedback starts with the sequence number of the first packet, the
+ * number of packets it covers, a reference time in multiples of 64ms and a
+ * counter. Then come the status chunks: a run of the same status, or a
+ * vector of 14 one bit or 7 two bits statuses. A packet is either not
+ * received, or received with a small (8 bits) or large (16 bits signed)
+ * delta, in multiples of 250us, from the previous one, and the deltas
+ * follow the chunks.
+ */
+
+#define FEEDBACK_HEADER_SIZE (8)
+#define TICK (250)
+#define TICKS_PER_REF_TIME (256)
+
+#define STATUS_NOT_RECEIVED (0)
+#define STATUS_SMALL_DELTA (1)
+#define STATUS_LARGE_DELTA (2)
+
+static gboolean
+parse_statuses (const guint8 *fci, gsize size, guint count, guint8 *statuses,
+    gsize *deltas_offset)
+{
+  gsize pos = FEEDBACK_HEADER_SIZE;
+  guint n = 0;
+  guint i;
+
+  while (n < count)
+  {
+    guint16 chunk;
+
+    if (pos + 2 > size)
+      return FALSE;
+    chunk = GST_READ_UINT16_BE (fci + pos);
+    pos += 2;
+
+    if (!(chunk & 0x8000))
+    {
+      guint8 status = (chunk >> 13) & 0x3;
+      guint run = chunk & 0x1FFF;
+
+      for (i = 0; i < run && n < count; i++)
+        statuses[n++] = status;
+    }
+    else if (!(chunk & 0x4000))
+    {
+      for (i = 0; i < 14 && n < count; i++)
+        statuses[n++] = (chunk >> (13 - i)) & 0x1;
+    }
+    else
+    {
+      for (i = 0; i < 7 && n < count; i++)
+        statuses[n++] = (chunk >> (2 * (6 - i))) & 0x3;
+    }
+  }
+
+  *deltas_offset = pos;
+
+  for (i = 0; i < count; i++)
+  {
+    if (statuses[i] == STATUS_SMALL_DELTA)
+      pos += 1;
+    else if (statuses[i] == STATUS_LARGE_DELTA)
+      pos += 2;
+    else if (statuses[i] != STATUS_NOT_RECEIVED)
+      return FALSE;
+  }
+
+  return pos <= size;
+}
+
+gboolean
+gcc_sender_on_feedback (GccSender *sender, guint64 now,
+    const guint8 *fci, gsize size)
+{
+  guint8 statuses[HISTORY_SIZE];
+  guint16 base_seqnum;
+  guint count;
+  guint32 ref_time;
+  guint64 latest, base;
+  gint64 ticks;
+  gsize pos;
+  guint64 newest_send_time = 0;
+  guint i;
+
+  if (size < FEEDBACK_HEADER_SIZE || sender->next_seqnum == 0)
+    return FALSE;
+
+  base_seqnum = GST_READ_UINT16_BE (fci);
+  count = GST_READ_UINT16_BE (fci + 2);
+  ref_time = GST_READ_UINT24_BE (fci + 4);
+
+  if (count == 0 || count > HISTORY_SIZE)
+    return FALSE;
+
+  if (!parse_statuses (fci, size, count, statuses, &pos))
+    return FALSE;
+
+  latest = sender->next_seqnum - 1;
+  base = latest - (guint16) ((latest & 0xFFFF) - base_seqnum);
+  if (base > latest)
+    return FALSE;
+
+  /* The reference time is 24 bits, it wraps after about 12 days */
+  if (!sender->has_ref_time)
+    sender->ref_time = ref_time;
+  else
+    sender->ref_time += ((gint32) ((ref_time - sender->last_ref_time) << 8))
+        >> 8;
+  sender->has_ref_time = TRUE;
+  sender->last_ref_time = ref_time;
+  ticks = sender->ref_time * TICKS_PER_REF_TIME;
+
+  for (i = 0; i < count && base + i <= latest; i++)
+  {
+    struct SentPacket *packet;
+    guint64 seqnum = base + i;
+
+    if (statuses[i] == STATUS_SMALL_DELTA)
+    {
+      ticks += fci[pos];
+      pos += 1;
+    }
+    else if (statuses[i] == STATUS_LARGE_DELTA)
+    {
+      ticks += (gint16) GST_READ_UINT16_BE (fci + pos);
+      pos += 2;
+    }
+
+    packet = &sender->history[seqnum & (HISTORY_SIZE - 1)];
+    if (packet->seqnum != seqnum)
+      continue;
+
+    if (!packet->reported && packet->probe >= 0 &&
+        packet->probe < sender->n_probes)
+      sender->probes[packet->probe].reported_packets++;
+
+    if (statuses[i] == STATUS_NOT_RECEIVED)
+    {
+      if (!packet->reported)
+        sender->lost++;
+      packet->reported = TRUE;
+      continue;
+    }
+
+    if (packet->received)
+      continue;
+
+    /* Reported lost by an earlier feedback, but it came in the end */
+    if (packet->reported && sender->lost > 0)
+      sender->lost--;
+    sender->received++;
+    packet->reported = TRUE;
+    packet->received = TRUE;
+
+    newest_send_time = MAX (newest_send_time, packet->send_time);
+    received_packet (&sender->delay, packet->send_time, packet->size,
+        ticks * TICK, now);
+    probe_received_packet (sender, packet, ticks * TICK);
+  }
+
+  /* This includes the time the receiver waited before sending the
+   * feedback, it is only used for how fast to react */
+  if (newest_send_time && now > newest_send_time)
+  {
+    guint rtt_sample = MIN (now - newest_send_time, 10 * SECOND);
+
+    if (sender->delay.rtt == 0)
+      sender->delay.rtt = rtt_sample;
+    else
+      sender->delay.rtt = (7 * (guint64) sender->delay.rtt + rtt_sample) / 8;
+  }
+
+  update_delay_bitrate (&sender->delay, now);
+  update_loss_bitrate (sender, now);
+  probe_on_feedback (sender, now);
+  sender->no_feedback_expiry = now + NO_FEEDBACK_TIMEOUT;
+
+  DEBUG_SENDER (sender, "feedback, trend: %f threshold: %f acked: %f"
+      " delay: %f loss: %f", sender->delay.trend, sender->delay.threshold,
+      sender->delay.acked_bitrate, sender->delay.bitrate,
+      sender->loss_bitrate);
+
+  return TRUE;
+}
+
+
+struct ReceivedPacket {
+  guint64 seqnum;
+  guint64 arrival;
+};
+
+/* Do not keep more than that when no feedback is sent */
+#define MAX_PENDING_PACKETS (HISTORY_SIZE)
+
+struct _GccReceiver {
+  /* in arrival order, until the feedback is built */
+  GArray *packets;
+
+  gboolean has_seqnum;
+  guint64 max_seqnum;
+  /* the first one that has not been reported yet */
+  guint64 next_seqnum;
+
+  guint8 feedback_count;
+};
+
+GccReceiver *
+gcc_receiver_new (void)
+{
+  GccReceiver *receiver = g_slice_new0 (GccReceiver);
+
+  receiver->packets = g_array_new (FALSE, FALSE,
+      sizeof (struct ReceivedPacket));
+
+  return receiver;
+}
+
+void
+gcc_receiver_free (GccReceiver *receiver)
+{
+  g_array_free (receiver->packets, TRUE);
+  g_slice_free (GccReceiver, receiver);
+}
+
+void
+gcc_receiver_got_packet (GccReceiver *receiver, guint64 now, guint16 seqnum)
+{
+  struct ReceivedPacket packet;
+
+  if (!receiver->has_seqnum)
+  {
+    /* Leave room below for the reordered ones */
+    packet.seqnum = (1 << 16) + seqnum;
+    receiver->next_seqnum = packet.seqnum;
+    receiver->has_seqnum = TRUE;
+  }
+  else
+  {
+    packet.seqnum = receiver->max_seqnum +
+        (gint16) (seqnum - (receiver->max_seqnum & 0xFFFF));
+  }
+
+  receiver->max_seqnum = MAX (receiver->max_seqnum, packet.seqnum);
+  packet.arrival = now;
+
+  if (receiver->packets->len >= MAX_PENDING_PACKETS)
+    g_array_remove_index (receiver->packets, 0);
+  g_array_append_val (receiver->packets, packet);
+}
+
+gboolean
+gcc_receiver_has_feedback (GccReceiver *receiver)
+{
+  return receiver->packets->len > 0;
+}
+
+static gint
+compare_received_packets (gconstpointer a, gconstpointer b)
+{
+  const struct ReceivedPacket *pa = a;
+  const struct ReceivedPacket *pb = b;
+
+  if (pa->seqnum < pb->seqnum)
+    return -1;
+  else if (pa->seqnum > pb->seqnum)
+    return 1;
+  else
+    return 0;
+}
+
+static gsize
+write_chunks (guint8 *data, const guint8 *statuses, guint count)
+{
+  gsize pos = 0;
+  guint i = 0;
+
+  while (i < count)
+  {
+    guint run, j;
+    guint16 chunk;
+
+    for (run = 1; i + run < count && run < 0x1FFF &&
+             statuses[i + run] == statuses[i]; run++);
+
+    if (run >= 14)
+    {
+      chunk = (statuses[i] << 13) | run;
+      i += run;
+    }
+    else
+    {
+      for (j = 0; j < 14 && i + j < count; j++)
+        if (statuses[i + j] > STATUS_SMALL_DELTA)
+          break;
+
+      if (j == 14 || i + j == count)
+      {
+        chunk = 0x8000;
+        for (j = 0; j < 14 && i < count; j++, i++)
+          chunk |= statuses[i] << (13 - j);
+      }
+      else
+      {
+        chunk = 0xC000;
+        for (j = 0; j < 7 && i < count; j++, i++)
+          chunk |= statuses[i] << (2 * (6 - j));
+      }
+    }
+
+    GST_WRITE_UINT16_BE (data + pos, chunk);
+    pos += 2;
+  }
+
+  return pos;
+}
+
+/*
+ * Writes the feedback for the packets received since the last one into
+ * @fci, covering as many as fit in @size bytes. Returns the number of
+ * bytes written, padded to 32 bits, or 0 if there is nothing to report.
+ */
+
+gsize
+gcc_receiver_build_feedback (GccReceiver *receiver, guint8 *fci, gsize size)
+{
+  struct ReceivedPacket *packets;
+  guint8 statuses[HISTORY_SIZE];
+  gint16 deltas[HISTORY_SIZE];
+  guint max_count;
+  guint64 base;
+  guint32 ref_time = 0;
+  gint64 prev_ticks = 0;
+  gboolean has_ref_time = FALSE;
+  guint count = 0;
+  guint reported = 0;
+  guint j = 0;
+  gsize pos;
+  guint i;
+
+  /* Each status takes at most 2/7 bytes of chunk and 2 bytes of delta,
+   * plus the last chunk and the padding */
+  if (size < FEEDBACK_HEADER_SIZE + 5)
+    return 0;
+  max_count = MIN ((size - FEEDBACK_HEADER_SIZE - 5) * 7 / 16, HISTORY_SIZE);
+
+  if (receiver->packets->len == 0 || max_count == 0)
+    return 0;
+
+  g_array_sort (receiver->packets, compare_received_packets);
+  packets = (struct ReceivedPacket *) receiver->packets->data;
+
+  /* Report the losses since the last feedback, unless there were so many
+   * that the sender forgot about them */
+  base = packets[0].seqnum;
+  if (receiver->next_seqnum < base &&
+      base - receiver->next_seqnum < HISTORY_SIZE / 2)
+    base = receiver->next_seqnum;
+
+  while (j < receiver->packets->len && count < max_count)
+  {
+    if (packets[j].seqnum != base + count)
+    {
+      statuses[count++] = STATUS_NOT_RECEIVED;
+      continue;
+    }
+
+    if (!has_ref_time)
+    {
+      ref_time = packets[j].arrival / (TICK * TICKS_PER_REF_TIME);
+      prev_ticks = (gint64) ref_time * TICKS_PER_REF_TIME;
+      has_ref_time = TRUE;
+    }
+
+    {
+      gint64 ticks = packets[j].arrival / TICK;
+      gint64 delta = ticks - prev_ticks;
+
+      /* Too far apart, it goes in the next feedback */
+      if (delta < G_MININT16 || delta > G_MAXINT16)
+        break;
+
+      statuses[count] = (delta >= 0 && delta <= G_MAXUINT8) ?
+          STATUS_SMALL_DELTA : STATUS_LARGE_DELTA;
+      deltas[count] = delta;
+      prev_ticks = ticks;
+    }
+
+    count++;
+    /* Skip the duplicates */
+    for (j++; j < receiver->packets->len &&
+             packets[j].seqnum < base + count; j++);
+    reported = j;
+  }
+
+  /* Do not end on losses, the next packet may still come */
+  while (count > 0 && statuses[count - 1] == STATUS_NOT_RECEIVED)
+    count--;
+
+  if (count == 0)
+    return 0;
+
+  GST_WRITE_UINT16_BE (fci, base & 0xFFFF);
+  GST_WRITE_UINT16_BE (fci + 2, count);
+  GST_WRITE_UINT24_BE (fci + 4, ref_time & 0xFFFFFF);
+  fci[7] = receiver->feedback_count++;
+  pos = FEEDBACK_HEADER_SIZE;
+
+  pos += write_chunks (fci + pos, statuses, count);
+
+  for (i = 0; i < count; i++)
+  {
+    if (statuses[i] == STATUS_SMALL_DELTA)
+    {
+      fci[pos++] = deltas[i];
+    }
+    else if (statuses[i] == STATUS_LARGE_DELTA)
+    {
+      GST_WRITE_UINT16_BE (fci + pos, deltas[i]);
+      pos += 2;
+    }
+  }
+
+  while (pos % 4)
+    fci[pos++] = 0;
+
+  g_array_remove_range (receiver->packets, 0, reported);
+  receiver->next_seqnum = MAX (receiver->next_seqnum, base + count);
+
+  return pos;
+}
+
+
+/*
+ * The receiver side estimation, for when the sender does not ask for the
+ * transport-wide feedback. The same delay-based controller runs on the
+ * arrival times and on the send times the receiver can guess, usually
+ * from the RTP timestamps, and the result is sent back as a maximum
+ * bitrate: at least every REMOTE_REPORT_INTERVAL and as soon as it drops.
+ */
+
+#define REMOTE_DEFAULT_RTT (200 * MS)
+#define REMOTE_REPORT_INTERVAL (SECOND)
+#define REMOTE_REPORT_DECREASE (0.97)
+
+struct _GccRemoteEstimator {
+  struct DelayEstimator delay;
+
+  gboolean has_report;
+  guint64 last_report;
+  guint last_report_bitrate;
+};
+
+GccRemoteEstimator *
+gcc_remote_estimator_new (void)
+{
+  GccRemoteEstimator *estimator = g_slice_new0 (GccRemoteEstimator);
+
+  /* It is brought down to what is received on the first update */
+  delay_estimator_init (&estimator->delay, MAX_BITRATE);
+  estimator->delay.rtt = REMOTE_DEFAULT_RTT;
+
+  return estimator;
+}
+
+void
+gcc_remote_estimator_free (GccRemoteEstimator *estimator)
+{
+  g_slice_free (GccRemoteEstimator, estimator);
+}
+
+void
+gcc_remote_estimator_got_packet (GccRemoteEstimator *estimator, guint64 now,
+    guint64 send_time, guint size)
+{
+  received_packet (&estimator->delay, send_time, size, now, now);
+
+  if (estimator->delay.acked_bitrate > 0)
+    update_delay_bitrate (&estimator->delay, now);
+}
+
+guint
+gcc_remote_estimator_get_bitrate (GccRemoteEstimator *estimator)
+{
+  if (estimator->delay.acked_bitrate == 0)
+    return 0;
+
+  return estimator->delay.bitrate;
+}
+
+guint
+gcc_remote_estimator_get_report (GccRemoteEstimator *estimator, guint64 now)
+{
+  guint bitrate = gcc_remote_estimator_get_bitrate (estimator);
+
+  if (bitrate == 0)
+    return 0;
+
+  if (estimator->has_report &&
+      now - estimator->last_report < REMOTE_REPORT_INTERVAL &&
+      bitrate >= REMOTE_REPORT_DECREASE * estimator->last_report_bitrate)
+    return 0;
+
+  estimator->has_report = TRUE;
+  estimator->last_report = now;
+  estimator->last_report_bitrate = bitrate;
+
+  return bitrate;
+}
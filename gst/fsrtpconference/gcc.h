@@ -0,0 +1,70 @@
+/*
+ * Farstream - Farstream delay-based congestion control
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * gcc.h - A delay-based congestion controller driven by transport-wide
+ *  feedback, draft-ietf-rmcat-gcc-02 and
+ *  draft-holmer-rmcat-transport-wide-cc-extensions-01
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include <glib.h>
+
+#ifndef __GCC_H__
+#define __GCC_H__
+
+typedef struct _GccSender GccSender;
+typedef struct _GccReceiver GccReceiver;
+typedef struct _GccRemoteEstimator GccRemoteEstimator;
+
+GccSender *gcc_sender_new (guint64 now, guint initial_bitrate);
+void gcc_sender_free (GccSender *sender);
+
+guint16 gcc_sender_sending_packet (GccSender *sender, guint64 now,
+    guint size);
+gboolean gcc_sender_on_feedback (GccSender *sender, guint64 now,
+    const guint8 *fci, gsize size);
+guint gcc_sender_get_bitrate (GccSender *sender);
+guint gcc_sender_get_rtt (GccSender *sender);
+gdouble gcc_sender_get_loss (GccSender *sender);
+void gcc_sender_warm_start (GccSender *sender, guint bitrate);
+
+void gcc_sender_set_max_probe_bitrate (GccSender *sender, guint bitrate);
+guint gcc_sender_get_probe_bitrate (GccSender *sender);
+guint gcc_sender_get_probe_padding (GccSender *sender);
+
+
+GccReceiver *gcc_receiver_new (void);
+void gcc_receiver_free (GccReceiver *receiver);
+
+void gcc_receiver_got_packet (GccReceiver *receiver, guint64 now,
+    guint16 seqnum);
+gboolean gcc_receiver_has_feedback (GccReceiver *receiver);
+gsize gcc_receiver_build_feedback (GccReceiver *receiver, guint8 *fci,
+    gsize size);
+
+
+GccRemoteEstimator *gcc_remote_estimator_new (void);
+void gcc_remote_estimator_free (GccRemoteEstimator *estimator);
+
+void gcc_remote_estimator_got_packet (GccRemoteEstimator *estimator,
+    guint64 now, guint64 send_time, guint size);
+guint gcc_remote_estimator_get_bitrate (GccRemoteEstimator *estimator);
+guint gcc_remote_estimator_get_report (GccRemoteEstimator *estimator,
+    guint64 now);
+
+#endif /* __GCC_H__ */
@@ -55,9 +55,59 @@
 
 #define MIN_NOFEEDBACK_TIMER (20 * 1000)
 
+/*
+ * The TCP throughput equation only depends on p through
+ *   f(p) = sqrt(2*p/3) + 12*sqrt(3*p/8)*p*(1+32*p^2)
+ * which, with q = sqrt(p), is the polynomial
+ *   f = A*q + B*q^3 + 32*B*q^7 with A = sqrt(2/3) and B = 12*sqrt(3/8)
+ * so it only takes one square root to compute.
+ *
+ * To invert it, f is tabulated for q between 0 and 1. A binary search and a
+ * linear interpolation in the table give a first q, which one Newton step
+ * brings very close to the exact value, without any square root.
+ */
+
+#define EQUATION_A (0.81649658092772603) /* sqrt (2/3) */
+#define EQUATION_B (7.3484692283495345) /* 12 * sqrt (3/8) */
+#define EQUATION_TABLE_SIZE (256)
+
+static gdouble equation_table[EQUATION_TABLE_SIZE + 1];
+
+static gdouble
+equation_f (gdouble q)
+{
+  gdouble q2 = q * q;
+
+  return q * (EQUATION_A + EQUATION_B * q2 * (1 + 32 * q2 * q2));
+}
+
+static gdouble
+equation_f_derivative (gdouble q)
+{
+  gdouble q2 = q * q;
+
+  return EQUATION_A + EQUATION_B * q2 * (3 + 224 * q2 * q2);
+}
+
+static void
+equation_table_init (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+  {
+    guint i;
+
+    for (i = 0; i <= EQUATION_TABLE_SIZE; i++)
+      equation_table[i] = equation_f ((gdouble) i / EQUATION_TABLE_SIZE);
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
 /*
  * @s: segment size in bytes
- * @R: RTT in milli seconds (instead of seconds)
+ * @R: RTT in micro seconds
  * @p: loss event per packet transmitted
  *
  *                              s
@@ -66,12 +116,49 @@
  *
  * Returns: The bitrate in bytes/s
  */
-static gdouble
-calculate_bitrate (gdouble s, gdouble R, gdouble p)
+gdouble
+tfrc_equation_bitrate (gdouble s, gdouble R, gdouble p)
+{
+  return (SECOND * s) / (R * equation_f (sqrt (p)));
+}
+
+/*
+ * Returns: the loss event rate p for which tfrc_equation_bitrate() gives
+ * @bitrate, or 1 if even that gives more
+ */
+gdouble
+tfrc_equation_loss_event_rate (gdouble s, gdouble R, gdouble bitrate)
 {
-  gdouble f = sqrt (2 * p / 3) + 12 * sqrt (3 * p / 8) * p * (1 + 32 * p * p);
+  guint low = 0, high = EQUATION_TABLE_SIZE;
+  gdouble f, q;
+
+  equation_table_init ();
+
+  if (bitrate <= 0)
+    return 1;
+
+  f = (SECOND * s) / (R * bitrate);
+
+  if (f >= equation_table[EQUATION_TABLE_SIZE])
+    return 1;
+
+  while (high - low > 1)
+  {
+    guint middle = (low + high) / 2;
+
+    if (equation_table[middle] <= f)
+      low = middle;
+    else
+      high = middle;
+  }
+
+  q = (low + (f - equation_table[low]) /
+      (equation_table[high] - equation_table[low])) / EQUATION_TABLE_SIZE;
+
+  /* f is convex, so this never goes below the solution */
+  q -= (equation_f (q) - f) / equation_f_derivative (q);
 
-  return (SECOND * s) / (R * f);
+  return MIN (q * q, 1);
 }
 
 #define RECEIVE_RATE_HISTORY_SIZE      (4)
@@ -94,6 +181,7 @@ struct _TfrcSender {
   guint mss; /* max segment size */
   guint rate; /* maximum allowed sending rate in bytes/sec */
   guint inst_rate; /* corrected maximum allowed sending rate */
+  guint warm_rate; /* rate known to work from an earlier connection */
   guint averaged_rtt;
   guint sqmean_rtt;
   guint last_sqrt_rtt;
@@ -108,6 +196,10 @@ struct _TfrcSender {
   gdouble last_loss_event_rate;
 
   gboolean sent_packet;
+
+  /* Number of packets in the TfrcSendLog at the last sync */
+  gboolean has_send_log;
+  guint64 send_log_packets;
 };
 
 TfrcSender *
@@ -147,6 +239,19 @@ tfrc_sender_use_inst_rate (TfrcSender *sender, gboolean use_inst_rate)
   sender->use_inst_rate = use_inst_rate;
 }
 
+/*
+ * Starts from a rate that an earlier connection over the same path reached
+ * instead of the RFC 5348 initial rate, the slow-start then continues from
+ * there. Must be called before the first feedback.
+ */
+
+void
+tfrc_sender_warm_start (TfrcSender *sender, guint rate)
+{
+  sender->warm_rate = rate;
+  sender->rate = rate;
+}
+
 
 void
 tfrc_sender_free (TfrcSender *sender)
@@ -257,7 +362,8 @@ recompute_sending_rate (TfrcSender *sender, guint recv_limit,
 {
   if (loss_event_rate > 0) {
     /* congestion avoidance phase */
-    sender->computed_rate = calculate_bitrate (sender_get_segment_size (sender),
+    sender->computed_rate = tfrc_equation_bitrate (
+        sender_get_segment_size (sender),
         sender->averaged_rtt, loss_event_rate);
     sender->rate = MAX (MIN (sender->computed_rate, recv_limit),
             sender_get_segment_size (sender)/T_MBI);
@@ -305,7 +411,8 @@ tfrc_sender_on_feedback_packet (TfrcSender *sender, guint64 now,
 
   /* On first feedback packet, set he rate based on the mss and rtt */
   if (sender->tld == 0) {
-    sender->rate = compute_initial_rate (sender->mss, rtt);
+    sender->rate = MAX (compute_initial_rate (sender->mss, rtt),
+        sender->warm_rate);
     sender->tld = now;
     DEBUG_SENDER (sender, "fb: initial rate: %u", sender->rate);
   }
@@ -468,6 +575,134 @@ tfrc_sender_sending_packet (TfrcSender *sender, guint size)
   sender->sent_packet = TRUE;
 }
 
+/*
+ * When the same packets go to many receivers, each one with its own
+ * TfrcSender, the per packet accounting is done once in a shared
+ * TfrcSendLog and each sender catches up with it only when it needs it.
+ *
+ * For the data-limited detection of RFC 5348 section 8.2.1, the log keeps
+ * the last few runs of consecutive packets that were not data-limited,
+ * which is enough to know if there was such a packet in the RTT before
+ * the one that a feedback packet acknowledges.
+ *
+ * The log also counts the steps done to record the packets and to bring
+ * the senders up to date, so the benchmark can check that this work does
+ * not grow with the number of receivers without timing it.
+ */
+
+#define SEND_LOG_RUNS (16)
+
+struct NotLimitedRun {
+  guint64 start;
+  guint64 end;
+};
+
+struct _TfrcSendLog {
+  guint64 packets;
+  guint average_packet_size; /* 16 times larger */
+
+  struct NotLimitedRun runs[SEND_LOG_RUNS];
+  guint last_run;
+  gboolean in_run;
+
+  guint64 operations;
+};
+
+TfrcSendLog *
+tfrc_send_log_new (guint segment_size)
+{
+  TfrcSendLog *log = g_slice_new0 (TfrcSendLog);
+
+  log->average_packet_size = segment_size << 4;
+
+  return log;
+}
+
+void
+tfrc_send_log_free (TfrcSendLog *log)
+{
+  g_slice_free (TfrcSendLog, log);
+}
+
+void
+tfrc_send_log_sending_packet (TfrcSendLog *log, guint64 now, guint size,
+    gboolean is_data_limited)
+{
+  /* Same average as in tfrc_sender_sending_packet() */
+  log->average_packet_size =
+      size + ((15 * log->average_packet_size) >> 4);
+  log->packets++;
+  log->operations++;
+
+  if (is_data_limited)
+  {
+    log->in_run = FALSE;
+    return;
+  }
+
+  if (!log->in_run)
+  {
+    log->last_run = (log->last_run + 1) % SEND_LOG_RUNS;
+    log->runs[log->last_run].start = now;
+    log->in_run = TRUE;
+  }
+  log->runs[log->last_run].end = now;
+}
+
+/*
+ * Returns TRUE if no packet that was not data-limited was sent in the RTT
+ * before @last_packet_timestamp
+ */
+
+gboolean
+tfrc_send_log_is_data_limited (TfrcSendLog *log,
+    guint64 last_packet_timestamp, guint rtt)
+{
+  guint64 t_new = last_packet_timestamp;
+  guint64 t_old = t_new > rtt ? t_new - rtt : 0;
+  guint i;
+
+  for (i = 0; i < SEND_LOG_RUNS; i++)
+  {
+    struct NotLimitedRun *run =
+        &log->runs[(log->last_run + SEND_LOG_RUNS - i) % SEND_LOG_RUNS];
+
+    log->operations++;
+
+    /* The runs are in order, all the older ones ended before too */
+    if (run->end <= t_old)
+      break;
+    if (run->start <= t_new)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*
+ * Brings the sender up to date with the packets sent since the last sync,
+ * it must be called before the sender is used. The first call only
+ * records where the log is.
+ */
+
+void
+tfrc_sender_sync_send_log (TfrcSender *sender, TfrcSendLog *log)
+{
+  if (sender->has_send_log && sender->send_log_packets != log->packets)
+    sender->sent_packet = TRUE;
+
+  sender->has_send_log = TRUE;
+  sender->send_log_packets = log->packets;
+  sender->average_packet_size = log->average_packet_size;
+  log->operations++;
+}
+
+guint64
+tfrc_send_log_get_operations (TfrcSendLog *log)
+{
+  return log->operations;
+}
+
 guint
 tfrc_sender_get_send_rate (TfrcSender *sender)
 {
@@ -500,6 +735,12 @@ tfrc_sender_get_averaged_rtt (TfrcSender *sender)
   return sender->averaged_rtt;
 }
 
+gdouble
+tfrc_sender_get_loss_event_rate (TfrcSender *sender)
+{
+  return sender->last_loss_event_rate;
+}
+
 
 #define NDUPACK 3 /* Number of packets to receive after a loss before declaring the loss event */
 #define LOSS_EVENTS_MAX (9)
@@ -517,8 +758,27 @@ typedef struct  {
   guint64 last_recvtime;
 } ReceivedInterval;
 
+/*
+ * The received intervals are kept in a ring, oldest first. It only grows
+ * past MAX_HISTORY_SIZE while the history is shorter than
+ * MIN_HISTORY_DURATION RTTs, and when it is full the oldest interval is
+ * forgotten, so no memory is allocated per packet. It must be a power of 2.
+ */
+#define RECEIVED_INTERVALS_SIZE (64)
+
+G_STATIC_ASSERT (MAX_HISTORY_SIZE + 2 <= RECEIVED_INTERVALS_SIZE);
+G_STATIC_ASSERT ((RECEIVED_INTERVALS_SIZE & (RECEIVED_INTERVALS_SIZE - 1))
+    == 0);
+
+/* The i-th oldest received interval */
+#define RECEIVED_INTERVAL(receiver, i)                                  \
+  (&(receiver)->received_intervals[((receiver)->received_intervals_head + \
+          (i)) & (RECEIVED_INTERVALS_SIZE - 1)])
+
 struct _TfrcReceiver {
-  GQueue received_intervals;
+  ReceivedInterval received_intervals[RECEIVED_INTERVALS_SIZE];
+  guint received_intervals_head;
+  guint received_intervals_len;
 
   gboolean sp;
 
@@ -548,7 +808,6 @@ tfrc_receiver_new (guint64 now)
 {
   TfrcReceiver *receiver = g_slice_new0 (TfrcReceiver);
 
-  g_queue_init (&receiver->received_intervals);
   receiver->received_bytes_reset_time = now;
   receiver->prev_received_bytes_reset_time = now;
 
@@ -569,17 +828,68 @@ tfrc_receiver_new_sp (guint64 now)
 void
 tfrc_receiver_free (TfrcReceiver *receiver)
 {
-  ReceivedInterval *ri;
+  g_slice_free (TfrcReceiver, receiver);
+}
 
-  while ((ri = g_queue_pop_tail (&receiver->received_intervals)))
-    g_slice_free (ReceivedInterval, ri);
+static void
+received_intervals_pop_head (TfrcReceiver *receiver)
+{
+  receiver->received_intervals_head =
+      (receiver->received_intervals_head + 1) & (RECEIVED_INTERVALS_SIZE - 1);
+  receiver->received_intervals_len--;
+}
 
-  g_slice_free (TfrcReceiver, receiver);
+/*
+ * Makes room for a new interval at position @index, the intervals from
+ * there on move one position towards the newest. When the ring is full,
+ * the oldest interval is forgotten first.
+ *
+ * Returns: the position of the new interval
+ */
+
+static guint
+received_intervals_insert (TfrcReceiver *receiver, guint index)
+{
+  guint i;
+
+  if (receiver->received_intervals_len == RECEIVED_INTERVALS_SIZE)
+  {
+    received_intervals_pop_head (receiver);
+    if (index > 0)
+      index--;
+  }
+
+  receiver->received_intervals_len++;
+
+  for (i = receiver->received_intervals_len - 1; i > index; i--)
+    *RECEIVED_INTERVAL (receiver, i) = *RECEIVED_INTERVAL (receiver, i - 1);
+
+  return index;
+}
+
+static void
+received_intervals_remove (TfrcReceiver *receiver, guint index)
+{
+  guint i;
+
+  for (i = index; i + 1 < receiver->received_intervals_len; i++)
+    *RECEIVED_INTERVAL (receiver, i) = *RECEIVED_INTERVAL (receiver, i + 1);
+
+  receiver->received_intervals_len--;
+}
+
+static void
+received_interval_init (ReceivedInterval *ri, guint64 timestamp, guint64 now,
+    guint seqnum)
+{
+  ri->first_timestamp = ri->last_timestamp = timestamp;
+  ri->first_seqnum = ri->last_seqnum = seqnum;
+  ri->first_recvtime = ri->last_recvtime = now;
 }
 
 /*
  * @s:  segment size in bytes
- * @R: RTT in milli seconds (instead of seconds)
+ * @R: RTT in micro seconds
  * @rate: the sending rate
  *
  * Returns the 1/p that would produce this sending rate
@@ -589,27 +899,7 @@ tfrc_receiver_free (TfrcReceiver *receiver)
 static gdouble
 compute_first_loss_interval (gdouble s, gdouble R, gdouble rate)
 {
-  gdouble p_min = 0;
-  gdouble p_max = 1;
-  gdouble p;
-  gdouble computed_rate;
-
-  /* Use an iterative process to find p
-   * it would be faster to use a table, but I'm lazy
-   */
-
-  do {
-    p = (p_min + p_max) / 2;
-    computed_rate = calculate_bitrate (s, R, p);
-
-    if (computed_rate < rate)
-      p_max = p;
-    else
-      p_min = p;
-
-  } while (computed_rate < 0.95 * rate || computed_rate > 1.05 * rate);
-
-  return 1 / p;
+  return 1 / tfrc_equation_loss_event_rate (s, R, rate);
 }
 
 
@@ -623,7 +913,7 @@ calculate_loss_event_rate (TfrcReceiver *receiver, guint64 now)
   guint loss_intervals[LOSS_EVENTS_MAX];
   const gdouble weights[8] = { 1.0, 1.0, 1.0, 1.0, 0.8, 0.6, 0.4, 0.2 };
   gint max_index = -1;
-  GList *item;
+  guint item;
   guint max_seqnum = 0;
   gint i;
   guint max_interval;
@@ -635,17 +925,15 @@ calculate_loss_event_rate (TfrcReceiver *receiver, guint64 now)
   if (receiver->sender_rtt == 0)
     return 0;
 
-  if (receiver->received_intervals.length < 2)
+  if (receiver->received_intervals_len < 2)
     return 0;
 
   DEBUG_RECEIVER (receiver, "start loss event rate computation (rtt: %u)",
       receiver->sender_rtt);
 
-  for (item = g_queue_peek_head_link (&receiver->received_intervals)->next;
-       item;
-       item = item->next) {
-    ReceivedInterval *current = item->data;
-    ReceivedInterval *prev = item->prev->data;
+  for (item = 1; item < receiver->received_intervals_len; item++) {
+    ReceivedInterval *current = RECEIVED_INTERVAL (receiver, item);
+    ReceivedInterval *prev = RECEIVED_INTERVAL (receiver, item - 1);
     guint64 start_ts;
     guint start_seqnum;
 
@@ -833,9 +1121,11 @@ gboolean
 tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
     guint64 now, guint seqnum, guint sender_rtt, guint packet_size)
 {
-  GList *item = NULL;
   ReceivedInterval *current = NULL;
   ReceivedInterval *prev = NULL;
+  gint i;
+  /* Position of current in the ring */
+  gint current_i = -1;
   gboolean recalculate_loss_rate = FALSE;
   gboolean retval = FALSE;
   gboolean history_too_short = !sender_rtt; /* No RTT, keep all history */
@@ -851,7 +1141,7 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
     receiver->sender_rtt = sender_rtt;
 
   /* RFC 5348 section 6.3: First packet received */
-  if (g_queue_get_length (&receiver->received_intervals) == 0 ||
+  if (receiver->received_intervals_len == 0 ||
       receiver->sender_rtt == 0) {
     if (receiver->sender_rtt)
       receiver->feedback_timer_expiry = now + receiver->sender_rtt;
@@ -862,11 +1152,10 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
 
   /* RFC 5348 section 6.1 Step 1: Add to packet history */
 
-  for (item = g_queue_peek_tail_link (&receiver->received_intervals);
-       item;
-       item = item->prev) {
-    current = item->data;
-    prev = item->prev ? item->prev->data : NULL;
+  for (i = receiver->received_intervals_len - 1; i >= 0; i--) {
+    current = RECEIVED_INTERVAL (receiver, i);
+    prev = i > 0 ? RECEIVED_INTERVAL (receiver, i - 1) : NULL;
+    current_i = i;
 
     if (G_LIKELY (seqnum == current->last_seqnum + 1)) {
       /* Extend the current packet forwardd */
@@ -878,15 +1167,9 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
       /* Is inside the current interval, must be duplicate, ignore */
     } else if (seqnum > current->last_seqnum + 1) {
       /* We had a loss, lets add a new one */
-      prev = current;
-
-      current = g_slice_new (ReceivedInterval);
-      current->first_timestamp = current->last_timestamp = timestamp;
-      current->first_seqnum = current->last_seqnum = seqnum;
-      current->first_recvtime = current->last_recvtime = now;
-      g_queue_push_tail (&receiver->received_intervals, current);
-
-      item = g_queue_peek_tail_link (&receiver->received_intervals);
+      current_i = received_intervals_insert (receiver, i + 1);
+      current = RECEIVED_INTERVAL (receiver, current_i);
+      received_interval_init (current, timestamp, now, seqnum);
     } else if (seqnum == current->first_seqnum - 1) {
       /* Extend the current packet backwards */
       current->first_seqnum = seqnum;
@@ -896,15 +1179,9 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
         (!prev || seqnum > prev->last_seqnum + 1)) {
       /* We have something that goes in the middle of a gap,
          so lets created a new received interval */
-      current = g_slice_new (ReceivedInterval);
-
-      current->first_timestamp = current->last_timestamp = timestamp;
-      current->first_seqnum = current->last_seqnum = seqnum;
-      current->first_recvtime = current->last_recvtime = now;
-
-      g_queue_insert_before (&receiver->received_intervals, item, current);
-      item = item->prev;
-      prev = item->prev ? item->prev->data : NULL;
+      current_i = received_intervals_insert (receiver, i);
+      current = RECEIVED_INTERVAL (receiver, current_i);
+      received_interval_init (current, timestamp, now, seqnum);
     } else
       continue;
     break;
@@ -915,13 +1192,11 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
    */
   if (!history_too_short)
   {
-    ReceivedInterval *newest =
-      g_queue_peek_tail (&receiver->received_intervals);
-    ReceivedInterval *oldest =
-      g_queue_peek_head (&receiver->received_intervals);
-    if (newest && oldest)
+    if (receiver->received_intervals_len)
       history_too_short =
-        newest->last_timestamp - oldest->first_timestamp <
+        RECEIVED_INTERVAL (receiver,
+            receiver->received_intervals_len - 1)->last_timestamp -
+        RECEIVED_INTERVAL (receiver, 0)->first_timestamp <
         MIN_HISTORY_DURATION * receiver->sender_rtt;
     else
       history_too_short = TRUE;
@@ -931,40 +1206,35 @@ tfrc_receiver_got_packet (TfrcReceiver *receiver, guint64 timestamp,
   if (G_UNLIKELY (!current)) {
     /* If its before MAX_HISTORY_SIZE, its too old, just discard it */
     if (!history_too_short &&
-        g_queue_get_length (&receiver->received_intervals) > MAX_HISTORY_SIZE)
+        receiver->received_intervals_len > MAX_HISTORY_SIZE)
       return retval;
 
-    current = g_slice_new (ReceivedInterval);
-
-    current->first_timestamp = current->last_timestamp = timestamp;
-    current->first_seqnum = current->last_seqnum = seqnum;
-    current->first_recvtime = current->last_recvtime = now;
-    g_queue_push_head (&receiver->received_intervals, current);
+    current_i = received_intervals_insert (receiver, 0);
+    current = RECEIVED_INTERVAL (receiver, current_i);
+    received_interval_init (current, timestamp, now, seqnum);
   }
 
-  if (!history_too_short &&
-      g_queue_get_length (&receiver->received_intervals) > MAX_HISTORY_SIZE) {
-    ReceivedInterval *remove = g_queue_pop_head (&receiver->received_intervals);
-    if (remove == prev)
-      prev = NULL;
-    g_slice_free (ReceivedInterval, remove);
+  /* Never forget the interval that was just updated */
+  if (!history_too_short && current_i > 0 &&
+      receiver->received_intervals_len > MAX_HISTORY_SIZE) {
+    received_intervals_pop_head (receiver);
+    current_i--;
   }
 
+  prev = current_i > 0 ? RECEIVED_INTERVAL (receiver, current_i - 1) : NULL;
 
   if (prev && (current->last_seqnum - current->first_seqnum == NDUPACK))
     recalculate_loss_rate = TRUE;
 
 
   if (prev &&  G_UNLIKELY (prev->last_seqnum + 1 == current->first_seqnum)) {
-    /* Merge closed gap if any */
-    current->first_seqnum = prev->first_seqnum;
-    current->first_timestamp = prev->first_timestamp;
-    current->first_recvtime = prev->first_recvtime;
-
-    g_slice_free (ReceivedInterval, prev);
-    g_queue_delete_link (&receiver->received_intervals, item->prev);
+    /* Merge closed gap if any, the current one is usually the newest so
+     * folding it into the previous one moves nothing */
+    prev->last_seqnum = current->last_seqnum;
+    prev->last_timestamp = current->last_timestamp;
+    prev->last_recvtime = current->last_recvtime;
 
-    prev = item->prev ? item->prev->data : NULL;
+    received_intervals_remove (receiver, current_i);
 
     recalculate_loss_rate = TRUE;
   }
@@ -1067,68 +1337,3 @@ tfrc_receiver_get_feedback_timer_expiry (TfrcReceiver *receiver)
   g_assert (receiver->sender_rtt || receiver->feedback_timer_expiry == 0);
   return receiver->feedback_timer_expiry;
 }
-
-struct _TfrcIsDataLimited
-{
-  guint64 not_limited_1;
-  guint64 not_limited_2;
-  guint64 t_new;
-  guint64 t_next;
-};
-
-/*
- * This implements the algorithm proposed in RFC 5248 section 8.2.1 */
-
-TfrcIsDataLimited *
-tfrc_is_data_limited_new (guint64 now)
-{
-  TfrcIsDataLimited *idl = g_slice_new0 (TfrcIsDataLimited);
-
-  return idl;
-}
-
-void
-tfrc_is_data_limited_free (TfrcIsDataLimited *idl)
-{
-  g_slice_free (TfrcIsDataLimited, idl);
-}
-
-void
-tfrc_is_data_limited_not_limited_now (TfrcIsDataLimited *idl, guint64 now)
-{
-  /* Sender is not data-limited at this instant. */
-  if (idl->not_limited_1 <= idl->t_new)
-    /* Goal: NotLimited1 > t_new. */
-    idl->not_limited_1 = now;
-  else if (idl->not_limited_2 <= idl->t_next)
-    /* Goal: NotLimited2 > t_next. */
-    idl->not_limited_2 = now;
-}
-
-/*
- * Returns TRUE if the period since the previous feedback packet
- * was data limited
- */
-gboolean
-tfrc_is_data_limited_received_feedback (TfrcIsDataLimited *idl, guint64 now,
-    guint64 last_packet_timestamp, guint rtt)
-{
-  gboolean ret;
-  guint64 t_old;
-
-  idl->t_new = last_packet_timestamp;
-  t_old = idl->t_new - rtt;
-  idl->t_next = now;
-  if ((t_old < idl->not_limited_1 && idl->not_limited_1 <= idl->t_new) ||
-      (t_old <  idl->not_limited_2 && idl->not_limited_2 <= idl->t_new))
-    /* This was NOT a data-limited interval */
-    ret =  FALSE;
-  else
-    /* This was a data-limited interval. */
-    ret = TRUE;
-
-  if (idl->not_limited_1 <= idl->t_new && idl->not_limited_2 > idl->t_new)
-      idl->not_limited_1 = idl->not_limited_2;
-
-  return ret;
-}
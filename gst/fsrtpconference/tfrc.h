@@ -29,13 +29,14 @@
 
 typedef struct _TfrcSender TfrcSender;
 typedef struct _TfrcReceiver TfrcReceiver;
-typedef struct _TfrcIsDataLimited TfrcIsDataLimited;
+typedef struct _TfrcSendLog TfrcSendLog;
 
 TfrcSender *tfrc_sender_new (guint segment_size, guint64 now,
     guint initial_rate);
 TfrcSender *tfrc_sender_new_sp (guint64 now, guint initial_average_packet_size);
 void tfrc_sender_free (TfrcSender *sender);
 void tfrc_sender_use_inst_rate (TfrcSender *sender, gboolean use_inst_rate);
+void tfrc_sender_warm_start (TfrcSender *sender, guint rate);
 
 
 void tfrc_sender_on_first_rtt (TfrcSender *sender, guint64 now);
@@ -47,6 +48,8 @@ void tfrc_sender_sending_packet (TfrcSender *sender, guint size);
 guint tfrc_sender_get_send_rate (TfrcSender *sender);
 guint64 tfrc_sender_get_no_feedback_timer_expiry (TfrcSender *sender);
 guint tfrc_sender_get_averaged_rtt (TfrcSender *sender);
+gdouble tfrc_sender_get_loss_event_rate (TfrcSender *sender);
+void tfrc_sender_sync_send_log (TfrcSender *sender, TfrcSendLog *log);
 
 
 TfrcReceiver *tfrc_receiver_new (guint64 now);
@@ -61,11 +64,16 @@ guint64 tfrc_receiver_get_feedback_timer_expiry (TfrcReceiver *receiver);
 gboolean tfrc_receiver_send_feedback (TfrcReceiver *receiver, guint64 now,
     double *loss_event_rate, guint *receive_rate);
 
-TfrcIsDataLimited *tfrc_is_data_limited_new (guint64 now);
-void tfrc_is_data_limited_free (TfrcIsDataLimited *idl);
-void tfrc_is_data_limited_not_limited_now (TfrcIsDataLimited *idl, guint64 now);
-gboolean tfrc_is_data_limited_received_feedback (TfrcIsDataLimited *idl,
-    guint64 now, guint64 last_packet_timestamp, guint rtt);
+gdouble tfrc_equation_bitrate (gdouble s, gdouble R, gdouble p);
+gdouble tfrc_equation_loss_event_rate (gdouble s, gdouble R, gdouble bitrate);
+
+TfrcSendLog *tfrc_send_log_new (guint segment_size);
+void tfrc_send_log_free (TfrcSendLog *log);
+void tfrc_send_log_sending_packet (TfrcSendLog *log, guint64 now, guint size,
+    gboolean is_data_limited);
+gboolean tfrc_send_log_is_data_limited (TfrcSendLog *log,
+    guint64 last_packet_timestamp, guint rtt);
+guint64 tfrc_send_log_get_operations (TfrcSendLog *log);
 
 
 
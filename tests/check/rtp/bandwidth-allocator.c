@@ -0,0 +1,232 @@
+/* Farstream unit tests for FsRtpBandwidthAllocator
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include "fs-rtp-bandwidth-allocator.h"
+
+GST_DEBUG_CATEGORY (fsrtpconference_debug);
+
+static GQuark allocated_quark;
+
+static void
+allocated_cb (GObject *flow, guint bitrate)
+{
+  g_object_set_qdata (flow, allocated_quark, GUINT_TO_POINTER (bitrate));
+}
+
+static guint
+get_allocated (GObject *flow)
+{
+  return GPOINTER_TO_UINT (g_object_get_qdata (flow, allocated_quark));
+}
+
+static void
+setup (void)
+{
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+  allocated_quark = g_quark_from_static_string ("allocated");
+}
+
+GST_START_TEST (test_allocator_uncoupled)
+{
+  FsRtpBandwidthAllocator *allocator = fs_rtp_bandwidth_allocator_new ();
+  GObject *video = g_object_new (G_TYPE_OBJECT, NULL);
+  GObject *audio = g_object_new (G_TYPE_OBJECT, NULL);
+
+  setup ();
+
+  fs_rtp_bandwidth_allocator_add_flow (allocator, video, FALSE,
+      allocated_cb);
+  fs_rtp_bandwidth_allocator_add_flow (allocator, audio, TRUE,
+      allocated_cb);
+
+  /* Without a group, a flow gets what its controller estimates */
+  fs_rtp_bandwidth_allocator_set_estimate (allocator, video, 500000);
+  fail_unless_equals_int (get_allocated (video), 500000);
+  fail_unless_equals_int (get_allocated (audio), 0);
+
+  fs_rtp_bandwidth_allocator_remove_flow (allocator, video);
+  fs_rtp_bandwidth_allocator_remove_flow (allocator, audio);
+  fs_rtp_bandwidth_allocator_unref (allocator);
+  g_object_unref (video);
+  g_object_unref (audio);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_allocator_audio_first)
+{
+  FsRtpBandwidthAllocator *allocator = fs_rtp_bandwidth_allocator_new ();
+  GObject *video = g_object_new (G_TYPE_OBJECT, NULL);
+  GObject *audio = g_object_new (G_TYPE_OBJECT, NULL);
+  GObject *peer = g_object_new (G_TYPE_OBJECT, NULL);
+  GstStructure *s;
+  guint64 total;
+
+  setup ();
+
+  fs_rtp_bandwidth_allocator_add_flow (allocator, video, FALSE,
+      allocated_cb);
+  fs_rtp_bandwidth_allocator_add_flow (allocator, audio, TRUE,
+      allocated_cb);
+  fs_rtp_bandwidth_allocator_set_desired_bitrate (allocator, audio, 40000);
+  fs_rtp_bandwidth_allocator_set_group (allocator, video, peer);
+  fs_rtp_bandwidth_allocator_set_group (allocator, audio, peer);
+
+  fs_rtp_bandwidth_allocator_set_estimate (allocator, video, 500000);
+  fail_unless_equals_int (get_allocated (audio), 40000);
+  fail_unless_equals_int (get_allocated (video), 460000);
+
+  /* The path can not even carry the audio, the video keeps a minimum */
+  fs_rtp_bandwidth_allocator_set_estimate (allocator, video, 30000);
+  fail_unless_equals_int (get_allocated (audio), 14000);
+  fail_unless_equals_int (get_allocated (video), 16000);
+
+  s = fs_rtp_bandwidth_allocator_get_stats (allocator, audio);
+  fail_unless (s != NULL);
+  fail_unless (gst_structure_get_uint64 (s, "group-estimate", &total));
+  fail_unless_equals_int (total, 30000);
+  gst_structure_free (s);
+
+  /* Once the audio is gone the video gets everything */
+  fs_rtp_bandwidth_allocator_set_estimate (allocator, video, 500000);
+  fs_rtp_bandwidth_allocator_remove_flow (allocator, audio);
+  fail_unless_equals_int (get_allocated (video), 500000);
+
+  fs_rtp_bandwidth_allocator_remove_flow (allocator, video);
+  fs_rtp_bandwidth_allocator_unref (allocator);
+  g_object_unref (video);
+  g_object_unref (audio);
+  g_object_unref (peer);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_allocator_audio_unset)
+{
+  FsRtpBandwidthAllocator *allocator = fs_rtp_bandwidth_allocator_new ();
+  GObject *video = g_object_new (G_TYPE_OBJECT, NULL);
+  GObject *audio = g_object_new (G_TYPE_OBJECT, NULL);
+  GObject *peer = g_object_new (G_TYPE_OBJECT, NULL);
+
+  setup ();
+
+  fs_rtp_bandwidth_allocator_add_flow (allocator, video, FALSE,
+      allocated_cb);
+  fs_rtp_bandwidth_allocator_add_flow (allocator, audio, TRUE,
+      allocated_cb);
+
+  /* Alone, the audio follows its own controller */
+  fs_rtp_bandwidth_allocator_set_estimate (allocator, audio, 30000);
+  fail_unless_equals_int (get_allocated (audio), 30000);
+
+  /* Without a bitrate from the application, nothing is reserved beyond
+   * what its controller estimates */
+  fs_rtp_bandwidth_allocator_set_group (allocator, video, peer);
+  fs_rtp_bandwidth_allocator_set_group (allocator, audio, peer);
+  fs_rtp_bandwidth_allocator_set_estimate (allocator, video, 470000);
+  fail_unless_equals_int (get_allocated (audio), 30000);
+  fail_unless_equals_int (get_allocated (video), 470000);
+
+  /* Once it is set, it is protected */
+  fs_rtp_bandwidth_allocator_set_desired_bitrate (allocator, audio, 40000);
+  fail_unless_equals_int (get_allocated (audio), 40000);
+  fail_unless_equals_int (get_allocated (video), 460000);
+
+  /* And unsetting it goes back to the estimate */
+  fs_rtp_bandwidth_allocator_set_desired_bitrate (allocator, audio, 0);
+  fail_unless_equals_int (get_allocated (audio), 30000);
+  fail_unless_equals_int (get_allocated (video), 470000);
+
+  fs_rtp_bandwidth_allocator_remove_flow (allocator, video);
+  fs_rtp_bandwidth_allocator_remove_flow (allocator, audio);
+  fs_rtp_bandwidth_allocator_unref (allocator);
+  g_object_unref (video);
+  g_object_unref (audio);
+  g_object_unref (peer);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_allocator_priority)
+{
+  FsRtpBandwidthAllocator *allocator = fs_rtp_bandwidth_allocator_new ();
+  GObject *camera = g_object_new (G_TYPE_OBJECT, NULL);
+  GObject *screen = g_object_new (G_TYPE_OBJECT, NULL);
+  GObject *peer = g_object_new (G_TYPE_OBJECT, NULL);
+
+  setup ();
+
+  fs_rtp_bandwidth_allocator_add_flow (allocator, camera, FALSE,
+      allocated_cb);
+  fs_rtp_bandwidth_allocator_add_flow (allocator, screen, FALSE,
+      allocated_cb);
+  fs_rtp_bandwidth_allocator_set_group (allocator, camera, peer);
+  fs_rtp_bandwidth_allocator_set_group (allocator, screen, peer);
+  fs_rtp_bandwidth_allocator_set_priority (allocator, screen, 3);
+
+  /* The sum of the estimates is shared by priority, not as estimated */
+  fs_rtp_bandwidth_allocator_set_estimate (allocator, camera, 700000);
+  fs_rtp_bandwidth_allocator_set_estimate (allocator, screen, 100000);
+  fail_unless_equals_int (get_allocated (camera), 200000);
+  fail_unless_equals_int (get_allocated (screen), 600000);
+
+  /* Leaving the group makes it independent again */
+  fs_rtp_bandwidth_allocator_set_group (allocator, screen, NULL);
+  fail_unless_equals_int (get_allocated (camera), 700000);
+  fail_unless_equals_int (get_allocated (screen), 100000);
+
+  fs_rtp_bandwidth_allocator_remove_flow (allocator, camera);
+  fs_rtp_bandwidth_allocator_remove_flow (allocator, screen);
+  fs_rtp_bandwidth_allocator_unref (allocator);
+  g_object_unref (camera);
+  g_object_unref (screen);
+  g_object_unref (peer);
+}
+GST_END_TEST;
+
+static Suite *
+bandwidthallocator_suite (void)
+{
+  Suite *s = suite_create ("bandwidthallocator");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("bandwidth_allocator_uncoupled");
+  tcase_add_test (tc_chain, test_allocator_uncoupled);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("bandwidth_allocator_audio_first");
+  tcase_add_test (tc_chain, test_allocator_audio_first);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("bandwidth_allocator_audio_unset");
+  tcase_add_test (tc_chain, test_allocator_audio_unset);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("bandwidth_allocator_priority");
+  tcase_add_test (tc_chain, test_allocator_priority);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (bandwidthallocator);
@@ -0,0 +1,161 @@
+/* Farstream unit tests for the bandwidth cache
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+
+#include "fs-rtp-bandwidth-cache.h"
+
+GST_DEBUG_CATEGORY (fsrtpconference_debug);
+
+#define DAY (G_GINT64_CONSTANT (24 * 3600) * G_USEC_PER_SEC)
+
+/* Some time in 2026 */
+#define NOW (G_GINT64_CONSTANT (1790000000) * G_USEC_PER_SEC)
+
+static gchar *cache_path;
+
+static void
+setup (void)
+{
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+
+  cache_path = g_build_filename (g_get_tmp_dir (),
+      "farstream-bandwidth-cache-test", NULL);
+  g_unlink (cache_path);
+  g_setenv ("FS_BANDWIDTH_CACHE", cache_path, TRUE);
+}
+
+static void
+teardown (void)
+{
+  g_unlink (cache_path);
+  g_free (cache_path);
+}
+
+GST_START_TEST (test_bandwidth_cache_prefix)
+{
+  gchar *prefix;
+
+  prefix = fs_rtp_bandwidth_cache_get_prefix ("192.168.1.42");
+  fail_unless (!g_strcmp0 (prefix, "192.168.1.0/24"), "Got %s", prefix);
+  g_free (prefix);
+
+  prefix = fs_rtp_bandwidth_cache_get_prefix ("2001:db8:1:2::5");
+  fail_unless (!g_strcmp0 (prefix, "2001:db8:1:2::/64"), "Got %s", prefix);
+  g_free (prefix);
+
+  fail_unless (fs_rtp_bandwidth_cache_get_prefix ("example.com") == NULL);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_bandwidth_cache_aging)
+{
+  guint bitrate = 0, rtt = 0;
+
+  setup ();
+
+  fail_if (fs_rtp_bandwidth_cache_lookup ("10.0.0.1", NOW, &bitrate, &rtt));
+
+  fs_rtp_bandwidth_cache_store ("10.0.0.1", NOW, 2000000, 40000, 0);
+
+  /* Another host of the subnet is assumed to be behind the same path */
+  fail_unless (fs_rtp_bandwidth_cache_lookup ("10.0.0.2", NOW, &bitrate,
+          &rtt));
+  fail_unless_equals_int (bitrate, 1500000);
+  fail_unless_equals_int (rtt, 40000);
+
+  /* Halved for each day */
+  fail_unless (fs_rtp_bandwidth_cache_lookup ("10.0.0.1", NOW + DAY,
+          &bitrate, NULL));
+  fail_unless_equals_int (bitrate, 750000);
+
+  /* And forgotten after a week */
+  fail_if (fs_rtp_bandwidth_cache_lookup ("10.0.0.1", NOW + 8 * DAY,
+          &bitrate, NULL));
+
+  fail_if (fs_rtp_bandwidth_cache_lookup ("10.0.1.1", NOW, &bitrate, NULL));
+
+  /* The losses at the time lower it too */
+  fs_rtp_bandwidth_cache_store ("10.0.0.1", NOW, 2000000, 40000, 0.1);
+  fail_unless (fs_rtp_bandwidth_cache_lookup ("10.0.0.1", NOW, &bitrate,
+          NULL));
+  fail_unless_equals_int (bitrate, 1350000);
+
+  teardown ();
+}
+GST_END_TEST;
+
+GST_START_TEST (test_bandwidth_cache_saved)
+{
+  GKeyFile *keyfile = g_key_file_new ();
+
+  setup ();
+
+  fs_rtp_bandwidth_cache_store ("2001:db8:1:2::5", NOW, 800000, 120000, 0);
+
+  fail_unless (g_key_file_load_from_file (keyfile, cache_path,
+          G_KEY_FILE_NONE, NULL));
+  fail_unless_equals_int (g_key_file_get_integer (keyfile,
+          "2001:db8:1:2::/64", "bitrate", NULL), 800000);
+  fail_unless_equals_int (g_key_file_get_integer (keyfile,
+          "2001:db8:1:2::/64", "rtt", NULL), 120000);
+
+  /* Each store is written, not only the first one */
+  fs_rtp_bandwidth_cache_store ("10.0.0.1", NOW, 300000, 50000, 0);
+
+  fail_unless (g_key_file_load_from_file (keyfile, cache_path,
+          G_KEY_FILE_NONE, NULL));
+  fail_unless_equals_int (g_key_file_get_integer (keyfile,
+          "10.0.0.0/24", "bitrate", NULL), 300000);
+  fail_unless_equals_int (g_key_file_get_integer (keyfile,
+          "2001:db8:1:2::/64", "bitrate", NULL), 800000);
+
+  g_key_file_free (keyfile);
+  teardown ();
+}
+GST_END_TEST;
+
+static Suite *
+bandwidthcache_suite (void)
+{
+  Suite *s = suite_create ("bandwidthcache");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("bandwidth_cache_prefix");
+  tcase_add_test (tc_chain, test_bandwidth_cache_prefix);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("bandwidth_cache_aging");
+  tcase_add_test (tc_chain, test_bandwidth_cache_aging);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("bandwidth_cache_saved");
+  tcase_add_test (tc_chain, test_bandwidth_cache_saved);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (bandwidthcache);
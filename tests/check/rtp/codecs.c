@@ -2283,6 +2283,162 @@ GST_START_TEST (test_rtpcodecs_nego_feedback)
 }
 GST_END_TEST;
 
+static FsCodec *
+find_rtx_codec (GList *codecs, gint apt)
+{
+  for (; codecs; codecs = g_list_next (codecs))
+  {
+    FsCodec *codec = codecs->data;
+    FsCodecParameter *param;
+
+    if (g_ascii_strcasecmp (codec->encoding_name, "rtx"))
+      continue;
+    param = fs_codec_get_optional_parameter (codec, "apt", NULL);
+    if (param && g_ascii_strtoll (param->value, NULL, 10) == apt)
+      return codec;
+  }
+
+  return NULL;
+}
+
+GST_START_TEST (test_rtpcodecs_rtx_opt_in)
+{
+  struct SimpleTestConference *dat = NULL;
+  FsCodec *prefcodec = NULL;
+  FsCodec *codec;
+  FsParticipant *participant;
+  GError *error = NULL;
+  GstElementFactory *factory;
+  GstCaps *caps;
+  GList *codecs;
+
+  setup_codec_tests (&dat, &participant, FS_MEDIA_TYPE_VIDEO);
+
+  caps = gst_caps_from_string ("application/x-rtp, media=(string)video,"
+      " clock-rate=90000, encoding-name=H264; video/x-raw");
+  fail_unless (fs_session_set_allowed_caps (dat->session, caps, caps, &error));
+  g_assert_no_error (error);
+  gst_caps_unref (caps);
+
+  prefcodec = fs_codec_new (FS_CODEC_ID_ANY, "H264",
+      FS_MEDIA_TYPE_VIDEO, 90000);
+  fs_codec_add_optional_parameter (prefcodec, "farstream-recv-profile",
+      "identity");
+  fs_codec_add_optional_parameter (prefcodec, "farstream-send-profile",
+      "identity");
+  fs_codec_add_feedback_parameter (prefcodec, "nack", "pli", "");
+
+  /* Without the generic nack, there is no RTX */
+  codecs = g_list_append (NULL, prefcodec);
+  fail_unless (fs_session_set_codec_preferences (dat->session, codecs,
+          &error));
+  g_assert_no_error (error);
+  g_list_free (codecs);
+
+  g_object_get (dat->session, "codecs-without-config", &codecs, NULL);
+  fail_unless_equals_int (g_list_length (codecs), 1);
+  codec = codecs->data;
+  fail_unless (find_rtx_codec (codecs, codec->id) == NULL);
+  fs_codec_list_destroy (codecs);
+
+  /* Asking for it in the preferences adds it, if it can be done */
+  fs_codec_add_feedback_parameter (prefcodec, "nack", "", "");
+  codecs = g_list_append (NULL, prefcodec);
+  fail_unless (fs_session_set_codec_preferences (dat->session, codecs,
+          &error));
+  g_assert_no_error (error);
+  g_list_free (codecs);
+
+  factory = gst_element_factory_find ("rtprtxsend");
+  g_object_get (dat->session, "codecs-without-config", &codecs, NULL);
+  codec = codecs->data;
+  if (factory)
+  {
+    fail_unless_equals_int (g_list_length (codecs), 2);
+    fail_unless (find_rtx_codec (codecs, codec->id) != NULL);
+    gst_object_unref (factory);
+  }
+  else
+  {
+    fail_unless_equals_int (g_list_length (codecs), 1);
+  }
+  fs_codec_list_destroy (codecs);
+
+  fs_codec_destroy (prefcodec);
+  cleanup_codec_tests (dat, participant);
+}
+GST_END_TEST;
+
+static gboolean
+has_fec_codec (GList *codecs, const gchar *encoding_name)
+{
+  for (; codecs; codecs = g_list_next (codecs))
+  {
+    FsCodec *codec = codecs->data;
+
+    if (!g_ascii_strcasecmp (codec->encoding_name, encoding_name))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+static gboolean
+has_fec_factories (void)
+{
+  const gchar *factories[] = {
+    "rtpulpfecenc", "rtpulpfecdec", "rtpredenc", "rtpreddec", NULL
+  };
+  guint i;
+
+  for (i = 0; factories[i]; i++)
+  {
+    GstElementFactory *factory = gst_element_factory_find (factories[i]);
+
+    if (!factory)
+      return FALSE;
+    gst_object_unref (factory);
+  }
+
+  return TRUE;
+}
+
+GST_START_TEST (test_rtpcodecs_fec_opt_in)
+{
+  struct SimpleTestConference *dat = NULL;
+  FsParticipant *participant;
+  GError *error = NULL;
+  GList *prefs = NULL;
+  GList *codecs;
+
+  setup_codec_tests (&dat, &participant, FS_MEDIA_TYPE_VIDEO);
+
+  /* Without a preference, the offer is what it was before FEC */
+  g_object_get (dat->session, "codecs-without-config", &codecs, NULL);
+  fail_if (codecs == NULL);
+  fail_if (has_fec_codec (codecs, "red"));
+  fail_if (has_fec_codec (codecs, "ulpfec"));
+  fs_codec_list_destroy (codecs);
+
+  prefs = g_list_append (prefs, fs_codec_new (FS_CODEC_ID_ANY, "red",
+          FS_MEDIA_TYPE_VIDEO, 90000));
+  prefs = g_list_append (prefs, fs_codec_new (FS_CODEC_ID_ANY, "ulpfec",
+          FS_MEDIA_TYPE_VIDEO, 90000));
+  fail_unless (fs_session_set_codec_preferences (dat->session, prefs,
+          &error));
+  g_assert_no_error (error);
+  fs_codec_list_destroy (prefs);
+
+  /* Asking for them offers them, if they can be done */
+  g_object_get (dat->session, "codecs-without-config", &codecs, NULL);
+  fail_unless (has_fec_codec (codecs, "red") == has_fec_factories ());
+  fail_unless (has_fec_codec (codecs, "ulpfec") == has_fec_factories ());
+  fs_codec_list_destroy (codecs);
+
+  cleanup_codec_tests (dat, participant);
+}
+GST_END_TEST;
+
 static gboolean
 compare_extensions (FsRtpHeaderExtension *ext1, FsRtpHeaderExtension *ext2)
 {
@@ -2568,6 +2724,14 @@ fsrtpcodecs_suite (void)
   tcase_add_test (tc_chain, test_rtpcodecs_nego_feedback);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("fsrtpcodecs_rtx_opt_in");
+  tcase_add_test (tc_chain, test_rtpcodecs_rtx_opt_in);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpcodecs_fec_opt_in");
+  tcase_add_test (tc_chain, test_rtpcodecs_fec_opt_in);
+  suite_add_tcase (s, tc_chain);
+
   tc_chain = tcase_create ("fsrtpcodecs_nego_hdrext");
   tcase_add_test (tc_chain, test_rtpcodecs_nego_hdrext);
   suite_add_tcase (s, tc_chain);
@@ -895,6 +895,133 @@ GST_START_TEST (test_rtpconference_ten_way)
 }
 GST_END_TEST;
 
+static void
+_bundle_conf_init (struct SimpleTestConference *dat, guint confid)
+{
+  g_object_set (dat->conference, "bundle", TRUE, NULL);
+}
+
+GST_START_TEST (test_rtpconference_three_way_bundle)
+{
+  nway_test (3, _bundle_conf_init, NULL, "rawudp", 0, NULL);
+}
+GST_END_TEST;
+
+/* Both streams of the participant share one transport, each must get its
+ * local candidates, even the one set up second. RTCP is multiplexed, so
+ * the candidates of the RTCP component are those of the RTP one and the
+ * participant gets a single socket */
+GST_START_TEST (test_rtpconference_bundle_two_streams)
+{
+  GstElement *pipeline;
+  FsConference *conf;
+  FsParticipant *part;
+  FsSession *sessions[2];
+  FsStream *streams[2];
+  guint candidates[2][3] = {{0}};
+  gboolean prepared[2] = {FALSE, FALSE};
+  guint port = 0;
+  GstBus *bus;
+  GError *error = NULL;
+  guint i;
+
+  pipeline = gst_pipeline_new (NULL);
+  conf = FS_CONFERENCE (gst_element_factory_make ("fsrtpconference", NULL));
+  fail_if (conf == NULL);
+  g_object_set (conf, "bundle", TRUE, NULL);
+  fail_unless (gst_bin_add (GST_BIN (pipeline), GST_ELEMENT (conf)));
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  part = fs_conference_new_participant (conf, &error);
+  fail_if (part == NULL || error != NULL);
+
+  for (i = 0; i < 2; i++)
+  {
+    sessions[i] = fs_conference_new_session (conf, FS_MEDIA_TYPE_AUDIO,
+        &error);
+    fail_if (sessions[i] == NULL || error != NULL);
+
+    streams[i] = fs_session_new_stream (sessions[i], part, FS_DIRECTION_BOTH,
+        &error);
+    fail_if (streams[i] == NULL || error != NULL);
+
+    fail_unless (fs_stream_set_transmitter (streams[i], "rawudp", NULL, 0,
+            &error));
+    fail_if (error != NULL);
+  }
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+
+  while (!prepared[0] || !prepared[1])
+  {
+    GstMessage *message = gst_bus_timed_pop_filtered (bus, 5 * GST_SECOND,
+        GST_MESSAGE_ELEMENT);
+    const GstStructure *s;
+    FsStream *stream;
+
+    fail_if (message == NULL, "Timed out waiting for the local candidates");
+    s = gst_message_get_structure (message);
+
+    if (gst_structure_has_name (s, "farstream-new-local-candidate") ||
+        gst_structure_has_name (s, "farstream-local-candidates-prepared"))
+    {
+      stream = g_value_get_object (gst_structure_get_value (s, "stream"));
+      fail_unless (stream == streams[0] || stream == streams[1]);
+      i = (stream == streams[0]) ? 0 : 1;
+      fail_if (prepared[i], "Got a local candidate after being prepared");
+
+      if (gst_structure_has_name (s, "farstream-new-local-candidate"))
+      {
+        FsCandidate *candidate = g_value_get_boxed (
+            gst_structure_get_value (s, "candidate"));
+
+        fail_unless (candidate->component_id == 1 ||
+            candidate->component_id == 2);
+        candidates[i][candidate->component_id]++;
+
+        if (port == 0)
+          port = candidate->port;
+        fail_unless (candidate->port == port,
+            "Got candidates on ports %u and %u", port, candidate->port);
+      }
+      else
+      {
+        prepared[i] = TRUE;
+      }
+    }
+
+    gst_message_unref (message);
+  }
+
+  for (i = 1; i <= 2; i++)
+  {
+    fail_unless (candidates[0][i] > 0, "No local candidate for component %u",
+        i);
+    fail_unless (candidates[0][i] == candidates[1][i],
+        "The streams got %u and %u candidates for component %u",
+        candidates[0][i], candidates[1][i], i);
+  }
+  fail_unless (candidates[0][1] == candidates[0][2],
+      "Got %u candidates for RTP and %u for RTCP", candidates[0][1],
+      candidates[0][2]);
+
+  gst_object_unref (bus);
+  fail_if (gst_element_set_state (pipeline, GST_STATE_NULL) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  for (i = 0; i < 2; i++)
+  {
+    fs_stream_destroy (streams[i]);
+    g_object_unref (streams[i]);
+    fs_session_destroy (sessions[i]);
+    g_object_unref (sessions[i]);
+  }
+  g_object_unref (part);
+  gst_object_unref (pipeline);
+}
+GST_END_TEST;
+
 GST_START_TEST (test_rtpconference_errors)
 {
   struct SimpleTestConference *dat = NULL;
@@ -1518,6 +1645,14 @@ fsrtpconference_suite (void)
   tcase_add_test (tc_chain, test_rtpconference_ten_way);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("fsrtpconference_three_way_bundle");
+  tcase_add_test (tc_chain, test_rtpconference_three_way_bundle);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fsrtpconference_bundle_two_streams");
+  tcase_add_test (tc_chain, test_rtpconference_bundle_two_streams);
+  suite_add_tcase (s, tc_chain);
+
   tc_chain = tcase_create ("fsrtpconference_errors");
   tcase_add_test (tc_chain, test_rtpconference_errors);
   suite_add_tcase (s, tc_chain);
@@ -0,0 +1,419 @@
+/* Farstream unit tests for FsRtpFec
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "fs-rtp-fec.h"
+#include "fs-rtp-codec-negotiation.h"
+#include "fs-impair-model.h"
+
+GST_DEBUG_CATEGORY (fsrtpconference_debug);
+
+/*
+ * The packets go from the FEC encoder to the RED decoder of the auxiliary
+ * receiver through a link that loses some of them, then they are stored.
+ * The sink in the middle tells the FEC decoder about the holes in the
+ * sequence numbers, like a jitterbuffer does when it gives up on a packet,
+ * and the decoder rebuilds what it can from the stored packets.
+ */
+
+#define MEDIA_PT (96)
+#define RED_PT (100)
+#define ULPFEC_PT (101)
+#define MEDIA_SSRC (0x1234)
+#define LOSS_RATE (0.05)
+#define LOSS_PACKETS (1000)
+/* The last ones are not lost, they reveal the holes before them */
+#define LOSS_TAIL (5)
+
+static guint received[LOSS_PACKETS];
+static guint lost_packets;
+static gboolean link_is_lossy;
+static gboolean have_seqnum;
+static guint16 next_seqnum;
+
+static FsImpairModel *model;
+static GstPad *srcpad, *midsinkpad, *midsrcpad, *sinkpad;
+
+static void
+setup (void)
+{
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+}
+
+GST_START_TEST (test_fec_percentage)
+{
+  setup ();
+
+  /* A clean link is not protected */
+  fail_unless_equals_int (fs_rtp_fec_get_percentage (0), 0);
+  fail_unless_equals_int (fs_rtp_fec_get_percentage (0.001), 0);
+
+  /* Then twice as many FEC packets as lost ones */
+  fail_unless_equals_int (fs_rtp_fec_get_percentage (0.01), 5);
+  fail_unless_equals_int (fs_rtp_fec_get_percentage (0.05), 10);
+  fail_unless_equals_int (fs_rtp_fec_get_percentage (0.2), 40);
+
+  /* But bounded */
+  fail_unless_equals_int (fs_rtp_fec_get_percentage (0.6), 50);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_fec_codec_is_fec)
+{
+  FsCodec *codec;
+
+  setup ();
+
+  codec = fs_codec_new (RED_PT, "red", FS_MEDIA_TYPE_VIDEO, 90000);
+  fail_unless (fs_rtp_codec_is_fec (codec));
+  fs_codec_destroy (codec);
+
+  codec = fs_codec_new (ULPFEC_PT, "ULPFEC", FS_MEDIA_TYPE_VIDEO, 90000);
+  fail_unless (fs_rtp_codec_is_fec (codec));
+  fs_codec_destroy (codec);
+
+  codec = fs_codec_new (MEDIA_PT, "H264", FS_MEDIA_TYPE_VIDEO, 90000);
+  fail_if (fs_rtp_codec_is_fec (codec));
+  fs_codec_destroy (codec);
+}
+GST_END_TEST;
+
+static GstPadProbeReturn
+lossy_link (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstClockTime departure;
+
+  /* The media and FEC packets are lost alike */
+  if (!link_is_lossy)
+    return GST_PAD_PROBE_OK;
+
+  if (fs_impair_model_process (model, gst_buffer_get_size (buffer),
+          GST_BUFFER_PTS (buffer), &departure))
+    return GST_PAD_PROBE_OK;
+
+  lost_packets++;
+  return GST_PAD_PROBE_DROP;
+}
+
+static gboolean
+mid_sink_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  return gst_pad_push_event (midsrcpad, event);
+}
+
+static GstFlowReturn
+mid_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  guint16 seqnum;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer));
+  seqnum = gst_rtp_buffer_get_seq (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  /* Give up on the holes, like a jitterbuffer */
+  if (have_seqnum)
+    for (; next_seqnum != seqnum; next_seqnum++)
+      gst_pad_push_event (midsrcpad,
+          gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM,
+              gst_structure_new ("GstRTPPacketLost",
+                  "seqnum", G_TYPE_UINT, (guint) next_seqnum,
+                  "timestamp", G_TYPE_UINT64, GST_BUFFER_PTS (buffer),
+                  "duration", G_TYPE_UINT64, (guint64) 0,
+                  "retry", G_TYPE_UINT, 0,
+                  NULL)));
+  have_seqnum = TRUE;
+  next_seqnum = seqnum + 1;
+
+  return gst_pad_push (midsrcpad, buffer);
+}
+
+static GstFlowReturn
+fec_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  guint32 timestamp;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer));
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_type (&rtpbuffer),
+      MEDIA_PT);
+  fail_unless_equals_int (gst_rtp_buffer_get_ssrc (&rtpbuffer), MEDIA_SSRC);
+  timestamp = gst_rtp_buffer_get_timestamp (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+  gst_buffer_unref (buffer);
+
+  /* The sequence numbers are shared with the FEC packets */
+  fail_unless (timestamp % 3000 == 0);
+  fail_unless (timestamp / 3000 < LOSS_PACKETS);
+  received[timestamp / 3000]++;
+
+  return GST_FLOW_OK;
+}
+
+static CodecAssociation *
+new_codec_association (FsCodec *codec)
+{
+  CodecAssociation *ca = g_slice_new0 (CodecAssociation);
+
+  ca->codec = codec;
+  ca->send_codec = fs_codec_copy (codec);
+
+  return ca;
+}
+
+static void
+free_codec_association (CodecAssociation *ca)
+{
+  fs_codec_destroy (ca->codec);
+  fs_codec_destroy (ca->send_codec);
+  g_slice_free (CodecAssociation, ca);
+}
+
+static void
+link_pads (GstPad *src, GstElement *sink, const gchar *sink_name)
+{
+  GstPad *pad = gst_element_get_static_pad (sink, sink_name);
+
+  fail_unless (gst_pad_link (src, pad) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+}
+
+static GstPad *
+get_pad (GstElement *element, const gchar *name)
+{
+  GstPad *pad = gst_element_get_static_pad (element, name);
+
+  fail_unless (pad != NULL);
+  gst_object_unref (pad);
+
+  return pad;
+}
+
+GST_START_TEST (test_fec_loss)
+{
+  FsRtpFec *fec;
+  GstElement *encoder, *receiver, *storage, *decoder;
+  GObject *internal_storage = NULL;
+  GstStructure *s;
+  GstSegment segment;
+  GstCaps *caps;
+  GList *cas = NULL;
+  FsCodec *codec;
+  GError *error = NULL;
+  guint protected = 0, recovered = 0;
+  guint missing = 0;
+  gdouble loss_rate, residual_loss_rate;
+  guint i;
+
+  setup ();
+
+  fec = fs_rtp_fec_new (0);
+  storage = gst_element_factory_make ("rtpstorage", NULL);
+  if (!fs_rtp_fec_is_available (fec) || !storage)
+  {
+    g_debug ("FEC elements or rtpstorage not installed, skipping test");
+    if (storage)
+      gst_object_unref (storage);
+    gst_object_unref (fec);
+    return;
+  }
+  gst_object_ref_sink (storage);
+
+  s = gst_structure_from_string ("impairment, seed=(uint)4588,"
+      " loss=(double)0.05", NULL);
+  model = fs_impair_model_new (s, 0, &error);
+  g_assert_no_error (error);
+  gst_structure_free (s);
+
+  memset (received, 0, sizeof (received));
+  lost_packets = 0;
+  link_is_lossy = TRUE;
+  have_seqnum = FALSE;
+
+  codec = fs_codec_new (MEDIA_PT, "H264", FS_MEDIA_TYPE_VIDEO, 90000);
+  cas = g_list_append (cas, new_codec_association (codec));
+  codec = fs_codec_new (RED_PT, "red", FS_MEDIA_TYPE_VIDEO, 90000);
+  cas = g_list_append (cas, new_codec_association (codec));
+  codec = fs_codec_new (ULPFEC_PT, "ulpfec", FS_MEDIA_TYPE_VIDEO, 90000);
+  cas = g_list_append (cas, new_codec_association (codec));
+  fs_rtp_fec_codecs_updated (fec, cas);
+  g_list_free_full (cas, (GDestroyNotify) free_codec_association);
+
+  /* What the congestion control would have measured */
+  fs_rtp_fec_set_loss_rate (fec, LOSS_RATE);
+
+  g_object_set (storage, "size-time", (guint64) 2 * GST_SECOND, NULL);
+  g_object_get (storage, "internal-storage", &internal_storage, NULL);
+
+  encoder = fs_rtp_fec_get_encoder (fec);
+  receiver = fs_rtp_fec_get_aux_receiver (fec, NULL);
+  decoder = fs_rtp_fec_get_decoder (fec, internal_storage);
+  g_object_unref (internal_storage);
+  fail_unless (encoder && receiver && decoder);
+  gst_object_ref_sink (receiver);
+  gst_object_ref_sink (decoder);
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  midsinkpad = gst_pad_new ("midsink", GST_PAD_SINK);
+  midsrcpad = gst_pad_new ("midsrc", GST_PAD_SRC);
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (midsinkpad, mid_sink_chain);
+  gst_pad_set_event_function (midsinkpad, mid_sink_event);
+  gst_pad_set_chain_function (sinkpad, fec_sink_chain);
+
+  link_pads (srcpad, encoder, "sink");
+  link_pads (get_pad (encoder, "src"), receiver, "sink_0");
+  gst_pad_add_probe (get_pad (encoder, "src"), GST_PAD_PROBE_TYPE_BUFFER,
+      lossy_link, NULL, NULL);
+  link_pads (get_pad (receiver, "src_0"), storage, "sink");
+  fail_unless (gst_pad_link (get_pad (storage, "src"), midsinkpad) ==
+      GST_PAD_LINK_OK);
+  link_pads (midsrcpad, decoder, "sink");
+  fail_unless (gst_pad_link (get_pad (decoder, "src"), sinkpad) ==
+      GST_PAD_LINK_OK);
+
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (midsinkpad, TRUE);
+  gst_pad_set_active (midsrcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_if (gst_element_set_state (decoder, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (storage, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (receiver, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (encoder, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("fec"));
+  caps = gst_caps_new_simple ("application/x-rtp",
+      "media", G_TYPE_STRING, "video",
+      "clock-rate", G_TYPE_INT, 90000,
+      "encoding-name", G_TYPE_STRING, "H264",
+      "payload", G_TYPE_INT, MEDIA_PT,
+      "ssrc", G_TYPE_UINT, MEDIA_SSRC,
+      NULL);
+  gst_pad_push_event (srcpad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  /* One packet per frame at 30 frames/sec, everything is synchronous */
+  for (i = 0; i < LOSS_PACKETS; i++)
+  {
+    GstBuffer *buffer = gst_rtp_buffer_new_allocate (500, 0, 0);
+    GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+    gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer);
+    gst_rtp_buffer_set_payload_type (&rtpbuffer, MEDIA_PT);
+    gst_rtp_buffer_set_ssrc (&rtpbuffer, MEDIA_SSRC);
+    gst_rtp_buffer_set_seq (&rtpbuffer, i);
+    gst_rtp_buffer_set_timestamp (&rtpbuffer, i * 3000);
+    gst_rtp_buffer_set_marker (&rtpbuffer, TRUE);
+    memset (gst_rtp_buffer_get_payload (&rtpbuffer), i & 0xff, 500);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+    GST_BUFFER_PTS (buffer) = i * GST_SECOND / 30;
+
+    link_is_lossy = i < LOSS_PACKETS - LOSS_TAIL;
+
+    fail_unless (gst_pad_push (srcpad, buffer) == GST_FLOW_OK);
+  }
+
+  fail_unless (lost_packets > 0, "The link lost nothing");
+
+  for (i = 0; i < LOSS_PACKETS; i++)
+  {
+    fail_unless (received[i] <= 1, "Got packet %u %u times", i, received[i]);
+    if (!received[i])
+      missing++;
+  }
+
+  s = fs_rtp_fec_get_stats (fec);
+  fail_unless (gst_structure_get_uint (s, "protected-packets", &protected));
+  fail_unless (gst_structure_get_uint (s, "recovered-packets", &recovered));
+  gst_structure_free (s);
+
+  /* The link loses the FEC packets too */
+  loss_rate = (gdouble) lost_packets / (LOSS_PACKETS + LOSS_PACKETS *
+      fs_rtp_fec_get_percentage (LOSS_RATE) / 100);
+  residual_loss_rate = (gdouble) missing / LOSS_PACKETS;
+
+  GST_INFO ("Loss rate %f, after recovery %f: %u packets lost, %u"
+      " recovered, %u protected", loss_rate, residual_loss_rate,
+      lost_packets, recovered, protected);
+
+  fail_unless (protected > 0);
+  fail_unless (recovered > 0, "Nothing was recovered");
+  fail_unless (residual_loss_rate < loss_rate / 2,
+      "Loss rate %f after recovery, %f before", residual_loss_rate,
+      loss_rate);
+
+  gst_element_set_state (encoder, GST_STATE_NULL);
+  gst_element_set_state (receiver, GST_STATE_NULL);
+  gst_element_set_state (storage, GST_STATE_NULL);
+  gst_element_set_state (decoder, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (midsinkpad, FALSE);
+  gst_pad_set_active (midsrcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_object_unref (srcpad);
+  gst_object_unref (midsinkpad);
+  gst_object_unref (midsrcpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (encoder);
+  gst_object_unref (receiver);
+  gst_object_unref (storage);
+  gst_object_unref (decoder);
+  gst_object_unref (fec);
+  fs_impair_model_free (model);
+}
+GST_END_TEST;
+
+static Suite *
+fec_suite (void)
+{
+  Suite *s = suite_create ("fec");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("fec_percentage");
+  tcase_add_test (tc_chain, test_fec_percentage);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fec_codec_is_fec");
+  tcase_add_test (tc_chain, test_fec_codec_is_fec);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("fec_loss");
+  tcase_add_test (tc_chain, test_fec_loss);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (fec);
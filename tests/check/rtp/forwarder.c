@@ -0,0 +1,612 @@
+/* Farstream unit tests for FsRtpForwarder
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "fs-rtp-forwarder.h"
+
+GST_DEBUG_CATEGORY (fsrtpconference_debug);
+
+/*
+ * The sessions are plain objects, the pads they give to the forwarder
+ * keep what they receive in a queue attached to them.
+ */
+
+#define ORIGIN_SSRC (0x1234)
+#define ORIGIN_PT (96)
+#define DEST_PT (100)
+#define NEW_DEST_PT (101)
+#define MUXER_SSRC (0x5678)
+
+static guint released;
+static guint keyunit_requests;
+static guint keyunit_ssrc;
+
+static GstFlowReturn
+session_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  GObject *session = gst_pad_get_element_private (pad);
+
+  g_queue_push_tail (g_object_get_data (session, "buffers"), buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+session_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static GstPad *
+request_pad (GObject *session)
+{
+  GstPad *pad = gst_pad_new (NULL, GST_PAD_SINK);
+
+  gst_object_ref_sink (pad);
+  gst_pad_set_element_private (pad, session);
+  gst_pad_set_chain_function (pad, session_chain);
+  gst_pad_set_event_function (pad, session_event);
+  gst_pad_set_active (pad, TRUE);
+  g_object_set_data_full (session, "pad", gst_object_ref (pad),
+      gst_object_unref);
+
+  return pad;
+}
+
+static void
+release_pad (GObject *session, GstPad *pad)
+{
+  fail_unless (g_object_get_data (session, "pad") == pad);
+  gst_pad_set_active (pad, FALSE);
+  released++;
+}
+
+static GObject *
+add_session (FsRtpForwarder *forwarder, FsMediaType media_type,
+    const gchar *encoding_name, gint pt)
+{
+  GObject *session = g_object_new (G_TYPE_OBJECT, NULL);
+  GList *codecs;
+
+  g_object_set_data_full (session, "buffers", g_queue_new (),
+      (GDestroyNotify) g_queue_free);
+
+  fs_rtp_forwarder_add_session (forwarder, session, media_type, request_pad,
+      release_pad);
+
+  codecs = g_list_append (NULL, fs_codec_new (pt, encoding_name, media_type,
+          media_type == FS_MEDIA_TYPE_VIDEO ? 90000 : 8000));
+  fs_rtp_forwarder_set_codecs (forwarder, session, codecs);
+  fs_codec_list_destroy (codecs);
+
+  return session;
+}
+
+static void
+push_packet (GstPad *pad, guint16 seqnum)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer = gst_rtp_buffer_new_allocate (4, 0, 0);
+
+  gst_buffer_fill (buffer, 12, "abcd", 4);
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer));
+  gst_rtp_buffer_set_payload_type (&rtpbuffer, ORIGIN_PT);
+  gst_rtp_buffer_set_ssrc (&rtpbuffer, ORIGIN_SSRC);
+  gst_rtp_buffer_set_seq (&rtpbuffer, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtpbuffer, seqnum * 3000);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  fail_unless (gst_pad_push (pad, buffer) == GST_FLOW_OK);
+}
+
+static guint32
+check_packet (GObject *session, guint16 seqnum, guint pt)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer = g_queue_pop_head (g_object_get_data (session,
+          "buffers"));
+  guint32 ssrc;
+
+  fail_unless (buffer != NULL);
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer));
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_type (&rtpbuffer), pt);
+  fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtpbuffer), seqnum);
+  fail_unless_equals_int (gst_rtp_buffer_get_timestamp (&rtpbuffer),
+      seqnum * 3000);
+  fail_unless (!memcmp (gst_rtp_buffer_get_payload (&rtpbuffer), "abcd", 4));
+  ssrc = gst_rtp_buffer_get_ssrc (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+  gst_buffer_unref (buffer);
+
+  fail_if (ssrc == ORIGIN_SSRC);
+
+  return ssrc;
+}
+
+static gboolean
+origin_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  if (gst_event_has_name (event, "GstForceKeyUnit"))
+  {
+    fail_unless (gst_structure_get_uint (gst_event_get_structure (event),
+            "ssrc", &keyunit_ssrc));
+    keyunit_requests++;
+  }
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static GstEvent *
+keyunit_event (guint32 ssrc)
+{
+  return gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+      gst_structure_new ("GstForceKeyUnit",
+          "all-headers", G_TYPE_BOOLEAN, TRUE,
+          "ssrc", G_TYPE_UINT, ssrc,
+          NULL));
+}
+
+GST_START_TEST (test_forwarder_relay)
+{
+  FsRtpForwarder *forwarder = fs_rtp_forwarder_new ();
+  GObject *origin, *dest, *other_codec, *audio;
+  GstPad *pad;
+  GstCaps *caps;
+  GstSegment segment;
+  GList *codecs;
+  guint32 ssrc;
+  gint caps_pt;
+
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+
+  released = 0;
+  keyunit_requests = 0;
+
+  origin = add_session (forwarder, FS_MEDIA_TYPE_VIDEO, "H264", ORIGIN_PT);
+  dest = add_session (forwarder, FS_MEDIA_TYPE_VIDEO, "H264", DEST_PT);
+  other_codec = add_session (forwarder, FS_MEDIA_TYPE_VIDEO, "VP8", 97);
+  audio = add_session (forwarder, FS_MEDIA_TYPE_AUDIO, "PCMU", 0);
+
+  pad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_event_function (pad, origin_event);
+  gst_pad_set_active (pad, TRUE);
+
+  fail_unless (fs_rtp_forwarder_add_source (forwarder, origin, pad,
+          ORIGIN_SSRC, ORIGIN_PT));
+  fail_unless (gst_pad_is_linked (pad));
+
+  gst_pad_push_event (pad, gst_event_new_stream_start ("origin"));
+  caps = gst_caps_new_simple ("application/x-rtp",
+      "payload", G_TYPE_INT, ORIGIN_PT,
+      "ssrc", G_TYPE_UINT, ORIGIN_SSRC, NULL);
+  gst_pad_push_event (pad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (pad, gst_event_new_segment (&segment));
+
+  push_packet (pad, 42);
+
+  /* Only to the session of the same codec, with its payload type */
+  ssrc = check_packet (dest, 42, DEST_PT);
+  fail_unless (g_queue_is_empty (g_object_get_data (dest, "buffers")));
+  fail_unless (g_queue_is_empty (g_object_get_data (other_codec,
+              "buffers")));
+  fail_unless (g_queue_is_empty (g_object_get_data (audio, "buffers")));
+  fail_unless (g_object_get_data (audio, "pad") == NULL);
+
+  caps = gst_pad_get_current_caps (g_object_get_data (dest, "pad"));
+  fail_unless (caps != NULL);
+  fail_unless (gst_structure_get_int (gst_caps_get_structure (caps, 0),
+          "payload", &caps_pt));
+  fail_unless_equals_int (caps_pt, DEST_PT);
+  /* The rtpsession would take it as its own SSRC */
+  fail_if (gst_structure_has_field (gst_caps_get_structure (caps, 0),
+          "ssrc"));
+  gst_caps_unref (caps);
+
+  /* The new destinations want a key frame */
+  fail_unless_equals_int (keyunit_requests, 1);
+  fail_unless_equals_int (keyunit_ssrc, ORIGIN_SSRC);
+
+  /* The requests of the destination go to the origin */
+  fail_unless (gst_pad_push_event (g_object_get_data (dest, "pad"),
+          keyunit_event (ssrc)));
+  fail_unless_equals_int (keyunit_requests, 2);
+  fail_unless_equals_int (keyunit_ssrc, ORIGIN_SSRC);
+  fail_if (gst_pad_push_event (g_object_get_data (dest, "pad"),
+          keyunit_event (ssrc + 1)));
+  fail_unless_equals_int (keyunit_requests, 2);
+
+  /* Renegotiating changes the payload type, not the SSRC */
+  codecs = g_list_append (NULL, fs_codec_new (NEW_DEST_PT, "H264",
+          FS_MEDIA_TYPE_VIDEO, 90000));
+  fs_rtp_forwarder_set_codecs (forwarder, dest, codecs);
+  fs_codec_list_destroy (codecs);
+
+  push_packet (pad, 43);
+  fail_unless_equals_int (check_packet (dest, 43, NEW_DEST_PT), ssrc);
+
+  /* The pads are given back when the session goes */
+  fs_rtp_forwarder_remove_session (forwarder, dest);
+  fail_unless_equals_int (released, 1);
+  push_packet (pad, 44);
+  fail_unless (g_queue_is_empty (g_object_get_data (dest, "buffers")));
+
+  fs_rtp_forwarder_remove_session (forwarder, origin);
+  fail_if (gst_pad_is_linked (pad));
+  fail_unless_equals_int (released, 2);
+
+  fail_if (fs_rtp_forwarder_add_source (forwarder, origin, pad,
+          ORIGIN_SSRC, ORIGIN_PT));
+
+  fs_rtp_forwarder_remove_session (forwarder, other_codec);
+  fs_rtp_forwarder_remove_session (forwarder, audio);
+  fs_rtp_forwarder_unref (forwarder);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_object_unref (pad);
+  g_object_unref (origin);
+  g_object_unref (dest);
+  g_object_unref (other_codec);
+  g_object_unref (audio);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_forwarder_temporal_layer)
+{
+  const guint8 vp8_plain[] = { 0x10 };
+  const guint8 vp8_tid[] = { 0x90, 0x20, 0x80 };
+  const guint8 vp8_all[] = { 0x90, 0xe0, 0x80, 0x01, 0x05, 0x40 };
+  const guint8 vp8_truncated[] = { 0x90, 0x20 };
+  const guint8 h264_idr[] = { 0x65, 0x88 };
+  const guint8 h264_prefix[] = { 0x6e, 0x80, 0x00, 0x40 };
+  const guint8 h264_stap_a[] = { 0x78, 0x00, 0x04, 0x6e, 0x80, 0x00, 0x20 };
+  const guint8 h264_fu_a_start[] = { 0x7c, 0x94, 0x80, 0x00, 0x60 };
+  const guint8 h264_fu_a_middle[] = { 0x7c, 0x14, 0x12 };
+
+  fail_unless_equals_int (fs_rtp_forwarder_get_vp8_temporal_layer (
+          vp8_plain, sizeof (vp8_plain)), 0);
+  fail_unless_equals_int (fs_rtp_forwarder_get_vp8_temporal_layer (
+          vp8_tid, sizeof (vp8_tid)), 2);
+  fail_unless_equals_int (fs_rtp_forwarder_get_vp8_temporal_layer (
+          vp8_all, sizeof (vp8_all)), 1);
+  fail_unless_equals_int (fs_rtp_forwarder_get_vp8_temporal_layer (
+          vp8_truncated, sizeof (vp8_truncated)), -1);
+
+  fail_unless_equals_int (fs_rtp_forwarder_get_h264_temporal_layer (
+          h264_idr, sizeof (h264_idr)), 0);
+  fail_unless_equals_int (fs_rtp_forwarder_get_h264_temporal_layer (
+          h264_prefix, sizeof (h264_prefix)), 2);
+  fail_unless_equals_int (fs_rtp_forwarder_get_h264_temporal_layer (
+          h264_stap_a, sizeof (h264_stap_a)), 1);
+  fail_unless_equals_int (fs_rtp_forwarder_get_h264_temporal_layer (
+          h264_fu_a_start, sizeof (h264_fu_a_start)), 3);
+  fail_unless_equals_int (fs_rtp_forwarder_get_h264_temporal_layer (
+          h264_fu_a_middle, sizeof (h264_fu_a_middle)), -1);
+}
+GST_END_TEST;
+
+/* 30 frames per second of one packet, alternating between two layers */
+
+static void
+push_vp8_frame (GstPad *pad, guint frame)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer = gst_rtp_buffer_new_allocate (1000, 0, 0);
+  guint8 *payload;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer));
+  gst_rtp_buffer_set_payload_type (&rtpbuffer, ORIGIN_PT);
+  gst_rtp_buffer_set_ssrc (&rtpbuffer, ORIGIN_SSRC);
+  gst_rtp_buffer_set_seq (&rtpbuffer, frame);
+  gst_rtp_buffer_set_timestamp (&rtpbuffer, frame * 3000);
+  gst_rtp_buffer_set_marker (&rtpbuffer, TRUE);
+  payload = gst_rtp_buffer_get_payload (&rtpbuffer);
+  payload[0] = 0x90;
+  payload[1] = 0x20;
+  payload[2] = (frame % 2) << 6;
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  fail_unless (gst_pad_push (pad, buffer) == GST_FLOW_OK);
+}
+
+/*
+ * Returns the number of frames of the upper layer from @first_frame on
+ */
+
+static guint
+check_thinned_frames (GObject *session, guint16 *seqnum, guint first_frame)
+{
+  GQueue *buffers = g_object_get_data (session, "buffers");
+  GstBuffer *buffer;
+  guint upper_frames = 0;
+
+  while ((buffer = g_queue_pop_head (buffers)))
+  {
+    GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+    guint frame;
+
+    fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer));
+    frame = gst_rtp_buffer_get_timestamp (&rtpbuffer) / 3000;
+
+    /* The gaps are closed */
+    fail_unless_equals_int (gst_rtp_buffer_get_seq (&rtpbuffer), *seqnum);
+    (*seqnum)++;
+
+    if (frame >= first_frame && frame % 2)
+      upper_frames++;
+
+    gst_rtp_buffer_unmap (&rtpbuffer);
+    gst_buffer_unref (buffer);
+  }
+
+  return upper_frames;
+}
+
+GST_START_TEST (test_forwarder_thinning)
+{
+  FsRtpForwarder *forwarder = fs_rtp_forwarder_new ();
+  GObject *origin, *dest;
+  GstPad *pad;
+  guint16 seqnum = 0;
+  guint frame;
+
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+
+  origin = add_session (forwarder, FS_MEDIA_TYPE_VIDEO, "VP8", ORIGIN_PT);
+  dest = add_session (forwarder, FS_MEDIA_TYPE_VIDEO, "VP8", DEST_PT);
+
+  pad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_event_function (pad, origin_event);
+  gst_pad_set_active (pad, TRUE);
+  fail_unless (fs_rtp_forwarder_add_source (forwarder, origin, pad,
+          ORIGIN_SSRC, ORIGIN_PT));
+  gst_pad_push_event (pad, gst_event_new_stream_start ("origin"));
+
+  /* Each layer is around 120 kbits/sec */
+  fs_rtp_forwarder_set_bitrate (forwarder, dest, 150000);
+
+  for (frame = 0; frame < 60; frame++)
+    push_vp8_frame (pad, frame);
+
+  /* Once the rates are known, only the base layer fits */
+  fail_unless_equals_int (check_thinned_frames (dest, &seqnum, 20), 0);
+  fail_unless (seqnum < 60);
+
+  /* The upper layer comes back after a frame of the base layer */
+  fs_rtp_forwarder_set_bitrate (forwarder, dest, 1000000);
+
+  push_vp8_frame (pad, 60);
+  push_vp8_frame (pad, 61);
+  push_vp8_frame (pad, 62);
+  push_vp8_frame (pad, 63);
+  fail_unless_equals_int (check_thinned_frames (dest, &seqnum, 60), 2);
+
+  fs_rtp_forwarder_remove_session (forwarder, origin);
+  fs_rtp_forwarder_remove_session (forwarder, dest);
+  fs_rtp_forwarder_unref (forwarder);
+
+  gst_pad_set_active (pad, FALSE);
+  gst_object_unref (pad);
+  g_object_unref (origin);
+  g_object_unref (dest);
+}
+GST_END_TEST;
+
+/*
+ * Here the destination is a funnel in front of a real rtpbin, as in a
+ * session, with the packets of the muxer on another pad of the funnel
+ */
+
+static GstPad *
+funnel_request_pad (GObject *session)
+{
+  return gst_element_get_request_pad (g_object_get_data (session, "funnel"),
+      "sink_%u");
+}
+
+static void
+funnel_release_pad (GObject *session, GstPad *pad)
+{
+  gst_element_release_request_pad (g_object_get_data (session, "funnel"),
+      pad);
+  released++;
+}
+
+static void
+push_muxed_packet (GstPad *pad, guint16 seqnum)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer = gst_rtp_buffer_new_allocate (4, 0, 0);
+
+  gst_buffer_fill (buffer, 12, "efgh", 4);
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer));
+  gst_rtp_buffer_set_payload_type (&rtpbuffer, DEST_PT);
+  gst_rtp_buffer_set_ssrc (&rtpbuffer, MUXER_SSRC);
+  gst_rtp_buffer_set_seq (&rtpbuffer, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtpbuffer, seqnum * 3000);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  fail_unless (gst_pad_push (pad, buffer) == GST_FLOW_OK);
+}
+
+static guint
+get_internal_ssrc (GObject *internal_session)
+{
+  guint ssrc;
+
+  g_object_get (internal_session, "internal-ssrc", &ssrc, NULL);
+
+  return ssrc;
+}
+
+GST_START_TEST (test_forwarder_internal_ssrc)
+{
+  FsRtpForwarder *forwarder = fs_rtp_forwarder_new ();
+  GstElement *pipeline, *funnel, *rtpbin, *sink;
+  GObject *origin, *dest, *internal_session = NULL;
+  GstPad *pad, *muxer_pad, *funnel_pad;
+  GstCaps *caps;
+  GstSegment segment;
+  GList *codecs;
+  guint i;
+
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+
+  released = 0;
+  keyunit_requests = 0;
+
+  pipeline = gst_pipeline_new (NULL);
+  funnel = gst_element_factory_make ("funnel", NULL);
+  rtpbin = gst_element_factory_make ("rtpbin", NULL);
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (funnel && rtpbin && sink);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add_many (GST_BIN (pipeline), funnel, rtpbin, sink, NULL);
+  fail_unless (gst_element_link_pads (funnel, "src", rtpbin,
+          "send_rtp_sink_0"));
+  fail_unless (gst_element_link_pads (rtpbin, "send_rtp_src_0", sink,
+          "sink"));
+  g_signal_emit_by_name (rtpbin, "get-internal-session", 0,
+      &internal_session);
+  fail_unless (internal_session != NULL);
+
+  origin = add_session (forwarder, FS_MEDIA_TYPE_VIDEO, "H264", ORIGIN_PT);
+
+  dest = g_object_new (G_TYPE_OBJECT, NULL);
+  g_object_set_data (dest, "funnel", funnel);
+  fs_rtp_forwarder_add_session (forwarder, dest, FS_MEDIA_TYPE_VIDEO,
+      funnel_request_pad, funnel_release_pad);
+  codecs = g_list_append (NULL, fs_codec_new (DEST_PT, "H264",
+          FS_MEDIA_TYPE_VIDEO, 90000));
+  fs_rtp_forwarder_set_codecs (forwarder, dest, codecs);
+  fs_codec_list_destroy (codecs);
+
+  fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  /* The own packets of the session set its SSRC */
+  muxer_pad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_active (muxer_pad, TRUE);
+  funnel_pad = gst_element_get_request_pad (funnel, "sink_%u");
+  fail_unless (gst_pad_link (muxer_pad, funnel_pad) == GST_PAD_LINK_OK);
+
+  gst_pad_push_event (muxer_pad, gst_event_new_stream_start ("muxer"));
+  caps = gst_caps_new_simple ("application/x-rtp",
+      "media", G_TYPE_STRING, "video",
+      "clock-rate", G_TYPE_INT, 90000,
+      "encoding-name", G_TYPE_STRING, "H264",
+      "payload", G_TYPE_INT, DEST_PT,
+      "ssrc", G_TYPE_UINT, MUXER_SSRC, NULL);
+  gst_pad_push_event (muxer_pad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (muxer_pad, gst_event_new_segment (&segment));
+
+  push_muxed_packet (muxer_pad, 1);
+  fail_unless_equals_int (get_internal_ssrc (internal_session), MUXER_SSRC);
+
+  pad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_event_function (pad, origin_event);
+  gst_pad_set_active (pad, TRUE);
+  fail_unless (fs_rtp_forwarder_add_source (forwarder, origin, pad,
+          ORIGIN_SSRC, ORIGIN_PT));
+
+  gst_pad_push_event (pad, gst_event_new_stream_start ("origin"));
+  caps = gst_caps_new_simple ("application/x-rtp",
+      "payload", G_TYPE_INT, ORIGIN_PT,
+      "ssrc", G_TYPE_UINT, ORIGIN_SSRC, NULL);
+  gst_pad_push_event (pad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+  gst_pad_push_event (pad, gst_event_new_segment (&segment));
+
+  /* The funnel switches between its pads, and sends the sticky events of
+   * the new one each time, the SSRC of the session must not follow */
+  for (i = 0; i < 3; i++)
+  {
+    push_packet (pad, 42 + i);
+    fail_unless_equals_int (get_internal_ssrc (internal_session),
+        MUXER_SSRC);
+    push_muxed_packet (muxer_pad, 2 + i);
+    fail_unless_equals_int (get_internal_ssrc (internal_session),
+        MUXER_SSRC);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  fs_rtp_forwarder_remove_session (forwarder, dest);
+  fail_unless_equals_int (released, 1);
+  fs_rtp_forwarder_remove_session (forwarder, origin);
+  fs_rtp_forwarder_unref (forwarder);
+
+  gst_pad_unlink (muxer_pad, funnel_pad);
+  gst_element_release_request_pad (funnel, funnel_pad);
+  gst_object_unref (funnel_pad);
+  gst_pad_set_active (muxer_pad, FALSE);
+  gst_object_unref (muxer_pad);
+  gst_pad_set_active (pad, FALSE);
+  gst_object_unref (pad);
+  g_object_unref (internal_session);
+  gst_object_unref (pipeline);
+  g_object_unref (origin);
+  g_object_unref (dest);
+}
+GST_END_TEST;
+
+static Suite *
+forwarder_suite (void)
+{
+  Suite *s = suite_create ("forwarder");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("forwarder_relay");
+  tcase_add_test (tc_chain, test_forwarder_relay);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("forwarder_internal_ssrc");
+  tcase_add_test (tc_chain, test_forwarder_internal_ssrc);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("forwarder_temporal_layer");
+  tcase_add_test (tc_chain, test_forwarder_temporal_layer);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("forwarder_thinning");
+  tcase_add_test (tc_chain, test_forwarder_thinning);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (forwarder);
@@ -0,0 +1,586 @@
+/* Farstream delay-based congestion control simulation on a virtual clock
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include "sim-common.h"
+#include "gcc.h"
+
+/*
+ * The bottleneck of sim-common.c, with GccSender and GccReceiver pairs on
+ * each side. The receiver sends the transport-wide feedback every
+ * FEEDBACK_INTERVAL, the way FsRtpTransportCc does, and the sender parses
+ * the same bytes that would go on the wire.
+ *
+ * The queue delay is what the delay-based controller is about: on a link
+ * with a deep buffer, TFRC fills it until it overflows, while this should
+ * keep it almost empty.
+ *
+ * The senders probe at the start like they would in FsRtpTransportCc,
+ * the pacer sends padding during the probe clusters, which here is the
+ * same as sending more packets.
+ *
+ * The REMB scenarios run GccRemoteEstimator on the receiver instead, on
+ * the RTP timestamps of frames sent every SIM_FRAME_INTERVAL, and the
+ * sender simply follows the estimate it sends back, the way FsRtpRemb
+ * does.
+ */
+
+#define SIM_FEEDBACK_INTERVAL (100 * 1000)
+#define SIM_FEEDBACK_SIZE (1200)
+#define SIM_FRAME_INTERVAL (33333)
+#define SIM_REMB_INITIAL_BITRATE (300 * 1000)
+
+typedef struct {
+  SimScenario common;
+
+  /* Driven by the receiver estimate instead of the feedback */
+  gboolean remb;
+  gboolean no_probing;
+} GccSimScenario;
+
+typedef enum {
+  EVENT_SEND,
+  EVENT_RECEIVE,
+  EVENT_FEEDBACK,
+  EVENT_FEEDBACK_TIMER,
+  EVENT_REMB
+} GccSimEventType;
+
+typedef struct {
+  SimEvent header;
+
+  guint16 seqnum;
+  /* index in the feedback array of the flow */
+  guint feedback;
+
+  /* for the REMB scenarios */
+  guint64 send_time;
+  guint bitrate;
+} GccSimEvent;
+
+typedef struct {
+  GccSender *sender;
+  GccReceiver *receiver;
+  GccRemoteEstimator *estimator;
+  guint remb_bitrate;
+
+  guint64 last_send;
+  /* when the pending send is due */
+  guint64 send_expiry;
+
+  /* all the feedback sent, the events point into it */
+  GArray *feedback;
+} SimFlow;
+
+typedef struct {
+  guint8 data[SIM_FEEDBACK_SIZE];
+  gsize size;
+} SimFeedback;
+
+#define SIM_FLOW(sim, i) (&((SimFlow *) (sim)->user_data)[i])
+#define GCC_SCENARIO(sim) ((const GccSimScenario *) (sim)->scenario)
+
+/* The next packet goes out when the current rate allows it, which is
+ * moved when the rate changes, like the pacing does */
+
+static void
+sim_schedule_send (Sim *sim, guint i)
+{
+  SimFlow *flow = SIM_FLOW (sim, i);
+  guint bitrate = GCC_SCENARIO (sim)->remb ? flow->remb_bitrate :
+      MAX (gcc_sender_get_bitrate (flow->sender),
+          gcc_sender_get_probe_bitrate (flow->sender));
+  guint rate = MAX (bitrate / 8, 1);
+  guint64 next = MAX (sim->now, flow->last_send +
+      MAX ((guint64) SIM_PACKET_SIZE * SIM_SECOND / rate, 1));
+
+  if (next == flow->send_expiry)
+    return;
+
+  flow->send_expiry = next;
+  sim_push_simple_event (sim, EVENT_SEND, i, next);
+}
+
+static void
+sim_handle_send (Sim *sim, guint i)
+{
+  SimFlow *flow = SIM_FLOW (sim, i);
+  GccSimEvent event = { { 0 } };
+  guint64 arrival;
+
+  if (GCC_SCENARIO (sim)->remb)
+  {
+    /* All the packets of a frame have the same timestamp */
+    event.send_time = sim->now - sim->now % SIM_FRAME_INTERVAL;
+  }
+  else
+  {
+    if (!flow->sender)
+    {
+      flow->sender = gcc_sender_new (sim->now, 0);
+      if (GCC_SCENARIO (sim)->no_probing)
+        gcc_sender_set_max_probe_bitrate (flow->sender, 0);
+    }
+
+    event.seqnum = gcc_sender_sending_packet (flow->sender, sim->now,
+        SIM_PACKET_SIZE);
+  }
+  sim->sent_bins[i][sim->now / SIM_BIN] += SIM_PACKET_SIZE;
+
+  if (sim_link_transmit (sim, SIM_PACKET_SIZE, &arrival))
+  {
+    event.header.time = arrival;
+    event.header.type = EVENT_RECEIVE;
+    event.header.flow = i;
+    sim_push_event (sim, &event);
+  }
+  flow->last_send = sim->now;
+
+  sim_schedule_send (sim, i);
+}
+
+static void
+sim_handle_receive (Sim *sim, GccSimEvent *event)
+{
+  SimFlow *flow = SIM_FLOW (sim, event->header.flow);
+
+  if (sim->now / SIM_BIN < sim->n_bins)
+    sim->received_bins[event->header.flow][sim->now / SIM_BIN] +=
+        SIM_PACKET_SIZE;
+
+  if (GCC_SCENARIO (sim)->remb)
+  {
+    GccSimEvent remb = { { 0 } };
+
+    if (!flow->estimator)
+      flow->estimator = gcc_remote_estimator_new ();
+
+    gcc_remote_estimator_got_packet (flow->estimator, sim->now,
+        event->send_time, SIM_PACKET_SIZE);
+    remb.bitrate = gcc_remote_estimator_get_report (flow->estimator,
+        sim->now);
+    if (remb.bitrate)
+    {
+      remb.header.time = sim->now + sim->step->delay;
+      remb.header.type = EVENT_REMB;
+      remb.header.flow = event->header.flow;
+      sim_push_event (sim, &remb);
+    }
+    return;
+  }
+
+  if (!flow->receiver)
+  {
+    flow->receiver = gcc_receiver_new ();
+    sim_push_simple_event (sim, EVENT_FEEDBACK_TIMER, event->header.flow,
+        sim->now + SIM_FEEDBACK_INTERVAL);
+  }
+
+  gcc_receiver_got_packet (flow->receiver, sim->now, event->seqnum);
+}
+
+static void
+sim_send_feedback (Sim *sim, guint i)
+{
+  SimFlow *flow = SIM_FLOW (sim, i);
+  SimFeedback feedback;
+  GccSimEvent event = { { 0 } };
+
+  /* Everything that arrived goes in as many feedback packets as needed */
+  while (gcc_receiver_has_feedback (flow->receiver))
+  {
+    feedback.size = gcc_receiver_build_feedback (flow->receiver,
+        feedback.data, sizeof (feedback.data));
+    if (feedback.size == 0)
+      break;
+
+    g_array_append_val (flow->feedback, feedback);
+    event.header.time = sim->now + sim->step->delay;
+    event.header.type = EVENT_FEEDBACK;
+    event.header.flow = i;
+    event.feedback = flow->feedback->len - 1;
+    sim_push_event (sim, &event);
+  }
+
+  sim_push_simple_event (sim, EVENT_FEEDBACK_TIMER, i,
+      sim->now + SIM_FEEDBACK_INTERVAL);
+}
+
+static void
+sim_handle_feedback (Sim *sim, GccSimEvent *event)
+{
+  SimFlow *flow = SIM_FLOW (sim, event->header.flow);
+  SimFeedback *feedback = &g_array_index (flow->feedback, SimFeedback,
+      event->feedback);
+
+  fail_unless (gcc_sender_on_feedback (flow->sender, sim->now,
+          feedback->data, feedback->size), "Could not parse the feedback");
+
+  sim_schedule_send (sim, event->header.flow);
+}
+
+static void
+sim_start (Sim *sim)
+{
+  guint i;
+
+  for (i = 0; i < sim->scenario->flows; i++)
+  {
+    SimFlow *flow = SIM_FLOW (sim, i);
+
+    flow->feedback = g_array_new (FALSE, FALSE, sizeof (SimFeedback));
+    flow->remb_bitrate = SIM_REMB_INITIAL_BITRATE;
+    flow->send_expiry = i * sim->scenario->flow_spacing;
+    sim_push_simple_event (sim, EVENT_SEND, i, flow->send_expiry);
+  }
+}
+
+static void
+sim_handle_event (Sim *sim, SimEvent *event)
+{
+  SimFlow *flow = SIM_FLOW (sim, event->flow);
+
+  switch (event->type)
+  {
+    case EVENT_SEND:
+      if (flow->send_expiry != event->time)
+        break;
+      sim_handle_send (sim, event->flow);
+      sim->packets++;
+      break;
+    case EVENT_RECEIVE:
+      sim_handle_receive (sim, (GccSimEvent *) event);
+      break;
+    case EVENT_FEEDBACK:
+      sim_handle_feedback (sim, (GccSimEvent *) event);
+      break;
+    case EVENT_FEEDBACK_TIMER:
+      sim_send_feedback (sim, event->flow);
+      break;
+    case EVENT_REMB:
+      flow->remb_bitrate = ((GccSimEvent *) event)->bitrate;
+      sim_schedule_send (sim, event->flow);
+      break;
+  }
+}
+
+static void
+sim_stop (Sim *sim)
+{
+  guint i;
+
+  for (i = 0; i < sim->scenario->flows; i++)
+  {
+    SimFlow *flow = SIM_FLOW (sim, i);
+
+    if (flow->sender)
+      gcc_sender_free (flow->sender);
+    if (flow->receiver)
+      gcc_receiver_free (flow->receiver);
+    if (flow->estimator)
+      gcc_remote_estimator_free (flow->estimator);
+    g_array_free (flow->feedback, TRUE);
+  }
+}
+
+static const SimHarness gcc_harness = {
+  "gcc-sim", sizeof (GccSimEvent), sim_start, sim_handle_event, sim_stop
+};
+
+static void
+run_scenario (const GccSimScenario *scenario, SimResults *results)
+{
+  SimFlow flows[SIM_MAX_FLOWS] = { { 0 } };
+
+  sim_run_scenario (&gcc_harness, &scenario->common, flows, results);
+}
+
+static void
+check_scenario (const GccSimScenario *scenario)
+{
+  SimFlow flows[SIM_MAX_FLOWS] = { { 0 } };
+
+  sim_check_scenario (&gcc_harness, &scenario->common, flows);
+}
+
+/* 1 Mbit/s, 100ms RTT, with a second of buffer */
+static const SimStep deep_buffer_steps[] = {
+  { 0, 125000, 50 * 1000, 0 },
+  { G_MAXUINT64 }
+};
+
+static const GccSimScenario deep_buffer_scenario = {
+  { "deep-buffer", 1, 0, 600 * SIM_SECOND, 125000, deep_buffer_steps, 0,
+    30, 0, 0.2, 0.8, 0, 50 }
+};
+
+GST_START_TEST (test_gccsim_deep_buffer)
+{
+  check_scenario (&deep_buffer_scenario);
+}
+GST_END_TEST;
+
+/* 4 Mbit/s, 80ms RTT, flows starting 20 seconds apart */
+static const SimStep fairness_steps[] = {
+  { 0, 500000, 40 * 1000, 0 },
+  { G_MAXUINT64 }
+};
+
+static const GccSimScenario fairness_scenario = {
+  { "fairness", 4, 20 * SIM_SECOND, 1000 * SIM_SECOND, 250000,
+    fairness_steps, 0, 40, 0.95, 0.3, 0.8, 0, 50 }
+};
+
+GST_START_TEST (test_gccsim_fairness)
+{
+  check_scenario (&fairness_scenario);
+}
+GST_END_TEST;
+
+/* 2 Mbit/s down to 500 kbit/s and back */
+static const SimStep rate_change_steps[] = {
+  { 0, 250000, 30 * 1000, 0 },
+  { 200 * SIM_SECOND, 62500, 30 * 1000, 0 },
+  { 400 * SIM_SECOND, 250000, 30 * 1000, 0 },
+  { G_MAXUINT64 }
+};
+
+static const GccSimScenario rate_change_scenario = {
+  { "rate-change", 2, 5 * SIM_SECOND, 800 * SIM_SECOND, 250000,
+    rate_change_steps, 0, 60, 0.95, 0.3, 0.8, 0, 50 }
+};
+
+GST_START_TEST (test_gccsim_rate_change)
+{
+  check_scenario (&rate_change_scenario);
+}
+GST_END_TEST;
+
+/*
+ * 2 Mbit/s with 1% random loss, which the delay-based controller does not
+ * mistake for congestion, unlike TFRC.
+ */
+static const SimStep random_loss_steps[] = {
+  { 0, 250000, 50 * 1000, 0.01 },
+  { G_MAXUINT64 }
+};
+
+static const GccSimScenario random_loss_scenario = {
+  { "random-loss", 1, 0, 600 * SIM_SECOND, 250000, random_loss_steps, 0,
+    60, 0, 0.2, 0.8, 0, 50 }
+};
+
+GST_START_TEST (test_gccsim_random_loss)
+{
+  check_scenario (&random_loss_scenario);
+}
+GST_END_TEST;
+
+/* The deep buffer again, with the estimate computed by the receiver */
+static const GccSimScenario remb_deep_buffer_scenario = {
+  { "remb-deep", 1, 0, 600 * SIM_SECOND, 125000, deep_buffer_steps, 0,
+    30, 0, 0.2, 0.8, 0, 50 }, TRUE
+};
+
+GST_START_TEST (test_gccsim_remb_deep_buffer)
+{
+  check_scenario (&remb_deep_buffer_scenario);
+}
+GST_END_TEST;
+
+static const GccSimScenario remb_rate_change_scenario = {
+  { "remb-rate", 2, 5 * SIM_SECOND, 800 * SIM_SECOND, 250000,
+    rate_change_steps, 0, 60, 0.95, 0.3, 0.8, 0, 50 }, TRUE
+};
+
+GST_START_TEST (test_gccsim_remb_rate_change)
+{
+  check_scenario (&remb_rate_change_scenario);
+}
+GST_END_TEST;
+
+/*
+ * 4 Mbit/s, 100ms RTT: the probing should get there in a couple of
+ * seconds, growing 8% per second from the initial bitrate takes more than
+ * thirty.
+ */
+static const SimStep ramp_up_steps[] = {
+  { 0, 500000, 50 * 1000, 0 },
+  { G_MAXUINT64 }
+};
+
+static const GccSimScenario ramp_up_scenario = {
+  { "ramp-up", 1, 0, 60 * SIM_SECOND, 250000, ramp_up_steps, 0,
+    2, 0, 0.2, 0.8, 0, 50 }
+};
+
+static const GccSimScenario ramp_up_no_probing_scenario = {
+  { "ramp-up-np", 1, 0, 60 * SIM_SECOND, 250000, ramp_up_steps, 0,
+    0, 0, 0, 0, 0, 0 }, FALSE, TRUE
+};
+
+GST_START_TEST (test_gccsim_probing)
+{
+  SimResults results = { 0 };
+
+  check_scenario (&ramp_up_scenario);
+
+  /* Or the scenario does not show anything */
+  run_scenario (&ramp_up_no_probing_scenario, &results);
+  fail_unless (results.convergence > ramp_up_scenario.common.max_convergence,
+      "Took only %.1f s to converge without probing", results.convergence);
+}
+GST_END_TEST;
+
+/* The wire format, with losses, reordering and a long gap */
+GST_START_TEST (test_gccsim_feedback)
+{
+  GccSender *sender = gcc_sender_new (0, 0);
+  GccReceiver *receiver = gcc_receiver_new ();
+  guint8 fci[SIM_FEEDBACK_SIZE];
+  /* a run of 20 small deltas, a 1 bit vector of 14 small deltas and a 2
+   * bits vector with a large delta, then the padding */
+  static const guint8 handmade[] = {
+    0x00, 0x00, 0x00, 0x23, 0x00, 0x00, 0x00, 0x00,
+    0x20, 0x14, 0xBF, 0xFF, 0xE0, 0x00,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0x7F, 0xFF,
+    0, 0
+  };
+  gsize size;
+  guint i;
+
+  for (i = 0; i < 100; i++)
+    fail_unless (gcc_sender_sending_packet (sender, i * 1000, 1000) == i);
+
+  /* 10 and 11 are lost, 20 comes after 21, 50 comes 20 seconds late */
+  for (i = 0; i < 60; i++)
+  {
+    if (i == 10 || i == 11 || i == 20 || i == 50)
+      continue;
+    gcc_receiver_got_packet (receiver, 100000 + i * 1000, i);
+    if (i == 21)
+      gcc_receiver_got_packet (receiver, 100000 + i * 1000, 20);
+  }
+  gcc_receiver_got_packet (receiver, 20 * SIM_SECOND, 50);
+
+  size = gcc_receiver_build_feedback (receiver, fci, sizeof (fci));
+  fail_unless (size > 0 && size % 4 == 0);
+  fail_unless (GST_READ_UINT16_BE (fci) == 0);
+  /* it stops before the one that does not fit in a delta */
+  fail_unless (GST_READ_UINT16_BE (fci + 2) == 50);
+  fail_unless (gcc_sender_on_feedback (sender, 200000, fci, size));
+  fail_unless (gcc_receiver_has_feedback (receiver));
+
+  /* and the ones after it are too far in the past */
+  size = gcc_receiver_build_feedback (receiver, fci, sizeof (fci));
+  fail_unless (GST_READ_UINT16_BE (fci) == 50);
+  fail_unless (GST_READ_UINT16_BE (fci + 2) == 1);
+  fail_unless (gcc_sender_on_feedback (sender, 300000, fci, size));
+
+  size = gcc_receiver_build_feedback (receiver, fci, sizeof (fci));
+  fail_unless (GST_READ_UINT16_BE (fci) == 51);
+  fail_unless (GST_READ_UINT16_BE (fci + 2) == 9);
+  fail_unless (gcc_sender_on_feedback (sender, 300000, fci, size));
+  fail_unless (!gcc_receiver_has_feedback (receiver));
+  fail_unless (gcc_receiver_build_feedback (receiver, fci, sizeof (fci)) == 0);
+
+  /* Too small to hold anything */
+  gcc_receiver_got_packet (receiver, 400000, 60);
+  fail_unless (gcc_receiver_build_feedback (receiver, fci, 8) == 0);
+
+  fail_unless (gcc_sender_on_feedback (sender, 400000, handmade,
+          sizeof (handmade)));
+  fail_unless (!gcc_sender_on_feedback (sender, 400000, handmade,
+          sizeof (handmade) - 4));
+  fail_unless (!gcc_sender_on_feedback (sender, 400000, handmade, 12));
+
+  gcc_receiver_free (receiver);
+  gcc_sender_free (sender);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_gccsim_deterministic)
+{
+  SimResults first = { 0 }, second = { 0 };
+
+  run_scenario (&fairness_scenario, &first);
+  run_scenario (&fairness_scenario, &second);
+
+  fail_unless (first.packets == second.packets &&
+      first.convergence == second.convergence &&
+      first.fairness == second.fairness &&
+      first.oscillation == second.oscillation &&
+      first.utilisation == second.utilisation &&
+      first.queue_delay == second.queue_delay,
+      "Two runs of the same scenario gave different results");
+}
+GST_END_TEST;
+
+static Suite *
+gccsim_suite (void)
+{
+  Suite *s = suite_create ("gccsim");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("gcc_sim_deep_buffer");
+  tcase_add_test (tc_chain, test_gccsim_deep_buffer);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("gcc_sim_fairness");
+  tcase_add_test (tc_chain, test_gccsim_fairness);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("gcc_sim_rate_change");
+  tcase_add_test (tc_chain, test_gccsim_rate_change);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("gcc_sim_random_loss");
+  tcase_add_test (tc_chain, test_gccsim_random_loss);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("gcc_sim_remb_deep_buffer");
+  tcase_add_test (tc_chain, test_gccsim_remb_deep_buffer);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("gcc_sim_remb_rate_change");
+  tcase_add_test (tc_chain, test_gccsim_remb_rate_change);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("gcc_sim_probing");
+  tcase_add_test (tc_chain, test_gccsim_probing);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("gcc_sim_feedback");
+  tcase_add_test (tc_chain, test_gccsim_feedback);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("gcc_sim_deterministic");
+  tcase_add_test (tc_chain, test_gccsim_deterministic);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (gccsim);
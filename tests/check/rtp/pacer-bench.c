@@ -0,0 +1,846 @@
+/* Farstream pacing benchmark for FsRtpPacketModder
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <time.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gsttestclock.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "fs-rtp-packet-modder.h"
+
+/*
+ * Pushes packets into a FsRtpPacketModder as fast as it accepts them and
+ * measures the rate at which they come out, the largest burst and the CPU
+ * time spent per packet. It is done once with the old synchronisation of
+ * every buffer on its timestamp and once with the token bucket pacer, for
+ * a few pacing intervals.
+ *
+ * The last test sends frames twice as fast as the pacing rate with a
+ * latency budget, and checks that whole frames are dropped to stay within
+ * it, without holes in the sequence numbers of any SSRC. It is repeated
+ * with two video streams and a RTX stream, the SSRCs that lost nothing
+ * must keep their sequence numbers. The same goes for the SSRCs that did
+ * not carry the probing padding. Then without
+ * %GST_BUFFER_FLAG_DROPPABLE, at a lower rate, only the VP8 and H.264
+ * frames whose payload says nothing refers to them must be dropped.
+ *
+ * The pacer follows the system clock, it is replaced by a GstTestClock
+ * which is only moved forward when the modder waits on it, so every packet
+ * leaves at an exact time, however loaded the machine is.
+ */
+
+#define BENCH_RATE (2 * 1000 * 1000) /* bytes/sec */
+#define BENCH_PACKET_SIZE (1000)
+#define BENCH_PACKETS (2000)
+#define BENCH_TIMEOUT (10 * G_TIME_SPAN_SECOND)
+
+static GMutex bench_mutex;
+static GCond bench_cond;
+static guint received_packets;
+static guint received_pushes;
+static guint max_push_packets;
+static GstClockTime departures[BENCH_PACKETS];
+/* SSRC -> SsrcCheck */
+static GHashTable *ssrc_checks;
+static guint seqnum_errors;
+static guint shifted_packets;
+static guint keyframe_requests;
+/* of the frames received, whatever their SSRC */
+static GHashTable *received_rtptimes;
+
+static FsRtpPacketModder *modder;
+static GstPad *srcpad, *sinkpad;
+static GstClock *test_clock;
+
+static GstBuffer *
+bench_modder_func (FsRtpPacketModder *modder, GstBuffer *buffer,
+    GstClockTime buffer_ts, gpointer user_data)
+{
+  return buffer;
+}
+
+static guint
+bench_rate_func (FsRtpPacketModder *modder, gpointer user_data)
+{
+  return BENCH_RATE;
+}
+
+typedef struct {
+  guint16 next_seqnum;
+  guint16 next_original;
+  /* some of its packets were dropped */
+  gboolean lost;
+  guint packets;
+  guint padding;
+  guint shifted;
+} SsrcCheck;
+
+/* The payload ends with the sequence number the packet was pushed with */
+
+static GstBuffer *
+new_packet (guint32 ssrc, guint8 pt, guint16 seqnum, guint32 rtptime,
+    gboolean marker, guint size)
+{
+  GstBuffer *buffer = gst_rtp_buffer_new_allocate (MAX (size, 2), 0, 0);
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+  gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer);
+  gst_rtp_buffer_set_ssrc (&rtpbuffer, ssrc);
+  gst_rtp_buffer_set_payload_type (&rtpbuffer, pt);
+  gst_rtp_buffer_set_seq (&rtpbuffer, seqnum);
+  gst_rtp_buffer_set_timestamp (&rtpbuffer, rtptime);
+  gst_rtp_buffer_set_marker (&rtpbuffer, marker);
+  GST_WRITE_UINT16_BE ((guint8 *) gst_rtp_buffer_get_payload (&rtpbuffer) +
+      gst_rtp_buffer_get_payload_len (&rtpbuffer) - 2, seqnum);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return buffer;
+}
+
+/*
+ * Even if its first packets are dropped, the sequence numbers of a SSRC
+ * must start where they started upstream
+ */
+
+static void
+expect_ssrc (guint32 ssrc, guint16 first_seqnum)
+{
+  SsrcCheck *check = g_new0 (SsrcCheck, 1);
+
+  check->next_seqnum = check->next_original = first_seqnum;
+  g_hash_table_insert (ssrc_checks, GUINT_TO_POINTER (ssrc), check);
+}
+
+/* Only the RTP packets are checked, the others fail to map */
+
+static gboolean
+check_seqnum (GstBuffer **buffer, guint idx, gpointer user_data)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  SsrcCheck *check;
+  guint16 seqnum;
+
+  if (!gst_rtp_buffer_map (*buffer, GST_MAP_READ, &rtpbuffer))
+    return TRUE;
+
+  seqnum = gst_rtp_buffer_get_seq (&rtpbuffer);
+
+  g_mutex_lock (&bench_mutex);
+  check = g_hash_table_lookup (ssrc_checks,
+      GUINT_TO_POINTER (gst_rtp_buffer_get_ssrc (&rtpbuffer)));
+  if (!check)
+  {
+    check = g_new0 (SsrcCheck, 1);
+    check->next_seqnum = check->next_original = seqnum;
+    g_hash_table_insert (ssrc_checks,
+        GUINT_TO_POINTER (gst_rtp_buffer_get_ssrc (&rtpbuffer)), check);
+  }
+
+  if (seqnum != check->next_seqnum)
+    seqnum_errors++;
+  check->next_seqnum = seqnum + 1;
+  check->packets++;
+
+  /* Padding has no payload */
+  if (gst_rtp_buffer_get_payload_len (&rtpbuffer) < 2)
+  {
+    check->padding++;
+  }
+  else
+  {
+    guint16 original = GST_READ_UINT16_BE (
+        (guint8 *) gst_rtp_buffer_get_payload (&rtpbuffer) +
+        gst_rtp_buffer_get_payload_len (&rtpbuffer) - 2);
+
+    g_hash_table_add (received_rtptimes,
+        GUINT_TO_POINTER (gst_rtp_buffer_get_timestamp (&rtpbuffer)));
+
+    if (original != check->next_original)
+      check->lost = TRUE;
+    check->next_original = original + 1;
+
+    if (seqnum != original)
+      check->shifted++;
+    if (!check->lost && seqnum != original)
+      shifted_packets++;
+  }
+  g_mutex_unlock (&bench_mutex);
+
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  return TRUE;
+}
+
+static void
+record_arrival (guint packets)
+{
+  GstClockTime now = gst_clock_get_time (test_clock);
+  guint i;
+
+  g_mutex_lock (&bench_mutex);
+  for (i = received_packets;
+       i < MIN (received_packets + packets, BENCH_PACKETS); i++)
+    departures[i] = now;
+  received_packets += packets;
+  received_pushes++;
+  max_push_packets = MAX (max_push_packets, packets);
+  g_cond_broadcast (&bench_cond);
+  g_mutex_unlock (&bench_mutex);
+}
+
+static GstFlowReturn
+bench_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  check_seqnum (&buffer, 0, NULL);
+  gst_buffer_unref (buffer);
+  record_arrival (1);
+
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+bench_sink_chain_list (GstPad *pad, GstObject *parent, GstBufferList *list)
+{
+  gst_buffer_list_foreach (list, check_seqnum, NULL);
+  record_arrival (gst_buffer_list_length (list));
+  gst_buffer_list_unref (list);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+bench_src_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_CUSTOM_UPSTREAM &&
+      gst_structure_has_name (gst_event_get_structure (event),
+          "GstForceKeyUnit"))
+  {
+    g_mutex_lock (&bench_mutex);
+    keyframe_requests++;
+    g_mutex_unlock (&bench_mutex);
+  }
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+/* With an @encoding_name, the caps are for the payload type 96 */
+
+static void
+setup_modder (GstClockTime interval, GstClockTime latency_budget,
+    const gchar *encoding_name)
+{
+  GstPad *modder_pad;
+  GstSegment segment;
+  GstCaps *caps;
+
+  received_packets = 0;
+  received_pushes = 0;
+  max_push_packets = 0;
+  ssrc_checks = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  seqnum_errors = 0;
+  shifted_packets = 0;
+  keyframe_requests = 0;
+  received_rtptimes = g_hash_table_new (NULL, NULL);
+
+  /* The pacer takes the system clock when it is created */
+  test_clock = gst_test_clock_new ();
+  gst_system_clock_set_default (test_clock);
+
+  modder = fs_rtp_packet_modder_new (bench_modder_func, NULL, NULL);
+  gst_object_ref_sink (modder);
+  if (interval)
+    fs_rtp_packet_modder_set_pacing (modder, bench_rate_func, interval);
+  g_object_set (modder, "latency-budget", latency_budget, NULL);
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  gst_pad_set_event_function (srcpad, bench_src_event);
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (sinkpad, bench_sink_chain);
+  gst_pad_set_chain_list_function (sinkpad, bench_sink_chain_list);
+
+  modder_pad = gst_element_get_static_pad (GST_ELEMENT (modder), "sink");
+  fail_unless (gst_pad_link (srcpad, modder_pad) == GST_PAD_LINK_OK);
+  gst_object_unref (modder_pad);
+  modder_pad = gst_element_get_static_pad (GST_ELEMENT (modder), "src");
+  fail_unless (gst_pad_link (modder_pad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (modder_pad);
+
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  gst_element_set_clock (GST_ELEMENT (modder), test_clock);
+  gst_element_set_base_time (GST_ELEMENT (modder), 0);
+  fail_if (gst_element_set_state (GST_ELEMENT (modder), GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("pacer-bench"));
+  if (encoding_name)
+    caps = gst_caps_new_simple ("application/x-rtp",
+        "media", G_TYPE_STRING, "video",
+        "clock-rate", G_TYPE_INT, 90000,
+        "encoding-name", G_TYPE_STRING, encoding_name,
+        "payload", G_TYPE_INT, 96,
+        NULL);
+  else
+    caps = gst_caps_new_empty_simple ("application/x-rtp");
+  gst_pad_push_event (srcpad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+}
+
+static void
+teardown_modder (void)
+{
+  gst_element_set_state (GST_ELEMENT (modder), GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (modder);
+  gst_system_clock_set_default (NULL);
+  gst_object_unref (test_clock);
+  g_hash_table_unref (ssrc_checks);
+  g_hash_table_unref (received_rtptimes);
+}
+
+/*
+ * Returns the clock id the modder waits on, or %NULL once it has nothing
+ * left to send
+ */
+
+static GstClockID
+wait_for_modder (void)
+{
+  gint64 end_time = g_get_monotonic_time () + BENCH_TIMEOUT;
+  GstClockID id = NULL;
+  gboolean idle;
+
+  do {
+    if (gst_test_clock_peek_next_pending_id (GST_TEST_CLOCK (test_clock),
+            &id))
+      return id;
+
+    g_mutex_lock (&modder->pace_lock);
+    idle = g_queue_is_empty (&modder->pace_queue) && !modder->pace_pushing &&
+        !(modder->padding_bytes && modder->has_sending_frame);
+    g_mutex_unlock (&modder->pace_lock);
+
+    if (!idle)
+      g_usleep (100);
+  } while (!idle && g_get_monotonic_time () < end_time);
+
+  fail_unless (idle, "The modder is stuck");
+
+  return NULL;
+}
+
+/* Lets the modder send everything it can before @time, or everything it
+ * has with %GST_CLOCK_TIME_NONE */
+
+static void
+advance_clock (GstClockTime time)
+{
+  GstClockID id;
+
+  while ((id = wait_for_modder ()) && gst_clock_id_get_time (id) <= time)
+  {
+    gst_clock_id_unref (id);
+    gst_test_clock_crank (GST_TEST_CLOCK (test_clock));
+  }
+  if (id)
+    gst_clock_id_unref (id);
+
+  if (GST_CLOCK_TIME_IS_VALID (time) &&
+      time > gst_clock_get_time (test_clock))
+    gst_test_clock_set_time (GST_TEST_CLOCK (test_clock), time);
+}
+
+/* Moves the clock to wherever the modder or the pushing thread waits */
+
+static void
+wait_for_packets (guint packets)
+{
+  gint64 end_time = g_get_monotonic_time () + BENCH_TIMEOUT;
+
+  g_mutex_lock (&bench_mutex);
+  while (received_packets < packets && g_get_monotonic_time () < end_time)
+  {
+    g_mutex_unlock (&bench_mutex);
+    if (gst_test_clock_peek_next_pending_id (GST_TEST_CLOCK (test_clock),
+            NULL))
+      gst_test_clock_crank (GST_TEST_CLOCK (test_clock));
+    else
+      g_usleep (100);
+    g_mutex_lock (&bench_mutex);
+  }
+  g_mutex_unlock (&bench_mutex);
+}
+
+static gpointer
+push_packets (gpointer user_data)
+{
+  guint i;
+
+  for (i = 0; i < BENCH_PACKETS; i++)
+  {
+    GstBuffer *buffer = gst_buffer_new_allocate (NULL, BENCH_PACKET_SIZE,
+        NULL);
+
+    /* Without pacing, the timestamps are what spreads the packets */
+    GST_BUFFER_PTS (buffer) = gst_util_uint64_scale (i * BENCH_PACKET_SIZE,
+        GST_SECOND, BENCH_RATE);
+    fail_unless (gst_pad_push (srcpad, buffer) == GST_FLOW_OK);
+  }
+
+  return NULL;
+}
+
+static void
+run_pacer_bench (GstClockTime interval)
+{
+  guint interval_packets = gst_util_uint64_scale (BENCH_RATE, interval,
+      GST_SECOND * BENCH_PACKET_SIZE);
+  clock_t cpu_start, cpu_used;
+  GThread *thread;
+  gdouble rate;
+  guint i;
+
+  setup_modder (interval, 0, NULL);
+
+  cpu_start = clock ();
+
+  /* Pushing blocks until the clock moves */
+  thread = g_thread_new ("pusher", push_packets, NULL);
+  wait_for_packets (BENCH_PACKETS);
+  g_thread_join (thread);
+
+  cpu_used = clock () - cpu_start;
+
+  fail_unless (received_packets == BENCH_PACKETS, "Only got %u packets",
+      received_packets);
+
+  /* Synchronised on their timestamps, or a full bucket at the start and
+   * then one interval worth of tokens at every tick */
+  for (i = 0; i < BENCH_PACKETS; i++)
+  {
+    GstClockTime expected = interval ? (i / interval_packets) * interval :
+        gst_util_uint64_scale (i * BENCH_PACKET_SIZE, GST_SECOND,
+            BENCH_RATE);
+
+    fail_unless (departures[i] == expected,
+        "Packet %u left at %" GST_TIME_FORMAT " instead of %" GST_TIME_FORMAT,
+        i, GST_TIME_ARGS (departures[i]), GST_TIME_ARGS (expected));
+  }
+
+  /* The first packet went out at once, measure the time taken by the
+   * others */
+  rate = (BENCH_PACKETS - 1) * (gdouble) BENCH_PACKET_SIZE * GST_SECOND /
+      MAX (departures[BENCH_PACKETS - 1] - departures[0], 1);
+
+  g_print ("%s interval %3" G_GUINT64_FORMAT " ms: %.0f bytes/s for %u"
+      " (%+.1f%%), %u pushes, at most %u packets at once,"
+      " %.0f ns CPU per packet\n",
+      interval ? "paced" : "synced", GST_TIME_AS_MSECONDS (interval),
+      rate, BENCH_RATE, (rate - BENCH_RATE) * 100.0 / BENCH_RATE,
+      received_pushes, max_push_packets,
+      (gdouble) cpu_used * 1e9 / CLOCKS_PER_SEC / BENCH_PACKETS);
+
+  if (interval)
+    fail_unless (max_push_packets <= interval_packets,
+        "Burst of %u packets is larger than one interval", max_push_packets);
+
+  teardown_modder ();
+}
+
+GST_START_TEST (test_pacerbench_synced)
+{
+  run_pacer_bench (0);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_pacerbench_paced)
+{
+  run_pacer_bench (2 * GST_MSECOND);
+  run_pacer_bench (5 * GST_MSECOND);
+  run_pacer_bench (20 * GST_MSECOND);
+}
+GST_END_TEST;
+
+/* 30 frames/sec of 5 packets, a key frame every 10 frames and every other
+ * delta frame not used as a reference, at twice the pacing rate */
+#define DROP_FPS (30)
+#define DROP_FRAMES (60)
+#define DROP_FRAME_PACKETS (5)
+#define DROP_GOP (10)
+#define DROP_PACKET_SIZE \
+  (BENCH_RATE * 2 / (DROP_FPS * DROP_FRAME_PACKETS))
+#define DROP_LATENCY_BUDGET (100 * GST_MSECOND)
+
+static void
+add_frame (GstBufferList *list, guint32 ssrc, guint16 *seqnum, guint frame,
+    guint size)
+{
+  guint i;
+
+  for (i = 0; i < DROP_FRAME_PACKETS; i++)
+  {
+    GstBuffer *buffer = new_packet (ssrc, 96, (*seqnum)++,
+        frame * 90000 / DROP_FPS, i == DROP_FRAME_PACKETS - 1, size);
+
+    GST_BUFFER_PTS (buffer) = frame * GST_SECOND / DROP_FPS;
+    if (frame % DROP_GOP)
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    if (frame % DROP_GOP && frame % 2)
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DROPPABLE);
+
+    gst_buffer_list_add (list, buffer);
+  }
+}
+
+GST_START_TEST (test_pacerbench_drop_frames)
+{
+  GstStructure *stats;
+  guint64 dropped_frames, dropped_packets, max_queue_delay;
+  guint16 seqnum = 0;
+  guint i, j;
+
+  setup_modder (5 * GST_MSECOND, DROP_LATENCY_BUDGET, NULL);
+  expect_ssrc (0x1234, seqnum);
+
+  for (i = 0; i < DROP_FRAMES; i++)
+  {
+    GstBufferList *list = gst_buffer_list_new ();
+
+    add_frame (list, 0x1234, &seqnum, i, DROP_PACKET_SIZE);
+
+    advance_clock (i * GST_SECOND / DROP_FPS);
+    fail_unless (gst_pad_push_list (srcpad, list) == GST_FLOW_OK);
+  }
+
+  g_object_get (modder, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "dropped-frames",
+          &dropped_frames));
+  fail_unless (gst_structure_get_uint64 (stats, "dropped-packets",
+          &dropped_packets));
+  gst_structure_free (stats);
+
+  advance_clock (GST_CLOCK_TIME_NONE);
+
+  g_object_get (modder, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "max-queue-delay",
+          &max_queue_delay));
+  gst_structure_free (stats);
+
+  g_print ("dropping: %u packets sent, %" G_GUINT64_FORMAT " frames and %"
+      G_GUINT64_FORMAT " packets dropped, %u key unit requests,"
+      " max queue delay %" G_GUINT64_FORMAT " ms\n", received_packets,
+      dropped_frames, dropped_packets, keyframe_requests,
+      GST_TIME_AS_MSECONDS (max_queue_delay));
+
+  fail_unless (received_packets + dropped_packets ==
+      DROP_FRAMES * DROP_FRAME_PACKETS);
+  fail_unless (dropped_frames > 0);
+  fail_unless (dropped_packets == dropped_frames * DROP_FRAME_PACKETS,
+      "Dropped %" G_GUINT64_FORMAT " packets for %" G_GUINT64_FORMAT
+      " frames", dropped_packets, dropped_frames);
+  fail_unless (keyframe_requests > 0);
+  fail_unless (seqnum_errors == 0, "%u holes in the sequence numbers",
+      seqnum_errors);
+  fail_unless (max_queue_delay < DROP_LATENCY_BUDGET + 50 * GST_MSECOND,
+      "Packets waited up to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (max_queue_delay));
+
+  teardown_modder ();
+}
+GST_END_TEST;
+
+/* The same at the same total rate, split between two video streams, with
+ * a retransmission every few frames */
+#define RTX_SSRC (0x9abc)
+#define RTX_INTERVAL (3)
+
+GST_START_TEST (test_pacerbench_drop_frames_ssrcs)
+{
+  GstStructure *stats;
+  guint64 dropped_frames, dropped_packets;
+  guint16 seqnums[2] = { 0, 30000 };
+  guint16 rtx_seqnum = 60000;
+  guint pushed = 0;
+  SsrcCheck *rtx_check;
+  guint i;
+
+  setup_modder (5 * GST_MSECOND, DROP_LATENCY_BUDGET, NULL);
+  expect_ssrc (0x1234, seqnums[0]);
+  expect_ssrc (0x5678, seqnums[1]);
+  expect_ssrc (RTX_SSRC, rtx_seqnum);
+
+  for (i = 0; i < DROP_FRAMES; i++)
+  {
+    GstBufferList *list = gst_buffer_list_new ();
+
+    if (i % RTX_INTERVAL == 0)
+    {
+      /* A retransmission is never a key unit */
+      GstBuffer *buffer = new_packet (RTX_SSRC, 97, rtx_seqnum++,
+          i * 90000 / DROP_FPS, TRUE, DROP_PACKET_SIZE / 2);
+
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+      gst_buffer_list_add (list, buffer);
+    }
+    add_frame (list, 0x1234, &seqnums[0], i, DROP_PACKET_SIZE / 2);
+    add_frame (list, 0x5678, &seqnums[1], i, DROP_PACKET_SIZE / 2);
+    pushed += gst_buffer_list_length (list);
+
+    advance_clock (i * GST_SECOND / DROP_FPS);
+    fail_unless (gst_pad_push_list (srcpad, list) == GST_FLOW_OK);
+  }
+
+  advance_clock (GST_CLOCK_TIME_NONE);
+
+  g_object_get (modder, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "dropped-frames",
+          &dropped_frames));
+  fail_unless (gst_structure_get_uint64 (stats, "dropped-packets",
+          &dropped_packets));
+  gst_structure_free (stats);
+
+  rtx_check = g_hash_table_lookup (ssrc_checks,
+      GUINT_TO_POINTER (RTX_SSRC));
+
+  g_print ("dropping from 3 SSRCs: %u packets sent, %" G_GUINT64_FORMAT
+      " frames and %" G_GUINT64_FORMAT " packets dropped, %u"
+      " retransmissions sent\n", received_packets, dropped_frames,
+      dropped_packets, rtx_check->packets);
+
+  fail_unless (received_packets + dropped_packets == pushed);
+  fail_unless (dropped_frames > 0);
+  fail_unless (rtx_check->packets > 0);
+  fail_unless (((SsrcCheck *) g_hash_table_lookup (ssrc_checks,
+              GUINT_TO_POINTER (0x1234)))->packets > 0);
+  fail_unless (((SsrcCheck *) g_hash_table_lookup (ssrc_checks,
+              GUINT_TO_POINTER (0x5678)))->packets > 0);
+  fail_unless (seqnum_errors == 0, "%u holes in the sequence numbers",
+      seqnum_errors);
+  fail_unless (shifted_packets == 0, "%u packets of SSRCs that lost nothing"
+      " were renumbered", shifted_packets);
+
+  teardown_modder ();
+}
+GST_END_TEST;
+
+/* Without %GST_BUFFER_FLAG_DROPPABLE, at 1.5 times the pacing rate, dropping
+ * the frames nothing refers to is enough. Each packet starts with
+ * @reference or @non_reference, the first byte of its payload. */
+
+static void
+run_drop_frames_payload (const gchar *encoding_name, guint8 reference,
+    guint8 non_reference)
+{
+  GstStructure *stats;
+  guint64 dropped_frames;
+  guint16 seqnum = 0;
+  guint i, j;
+
+  setup_modder (5 * GST_MSECOND, DROP_LATENCY_BUDGET, encoding_name);
+  expect_ssrc (0x1234, seqnum);
+
+  for (i = 0; i < DROP_FRAMES; i++)
+  {
+    GstBufferList *list = gst_buffer_list_new ();
+
+    for (j = 0; j < DROP_FRAME_PACKETS; j++)
+    {
+      GstBuffer *buffer = new_packet (0x1234, 96, seqnum++,
+          i * 90000 / DROP_FPS, j == DROP_FRAME_PACKETS - 1,
+          DROP_PACKET_SIZE * 3 / 4);
+      GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+      GST_BUFFER_PTS (buffer) = i * GST_SECOND / DROP_FPS;
+      if (i % DROP_GOP)
+        GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+      gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer);
+      *(guint8 *) gst_rtp_buffer_get_payload (&rtpbuffer) =
+          (i % DROP_GOP && i % 2) ? non_reference : reference;
+      gst_rtp_buffer_unmap (&rtpbuffer);
+
+      gst_buffer_list_add (list, buffer);
+    }
+
+    advance_clock (i * GST_SECOND / DROP_FPS);
+    fail_unless (gst_pad_push_list (srcpad, list) == GST_FLOW_OK);
+  }
+
+  advance_clock (GST_CLOCK_TIME_NONE);
+
+  g_object_get (modder, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "dropped-frames",
+          &dropped_frames));
+  gst_structure_free (stats);
+
+  g_print ("dropping %s from the payload: %u packets sent, %" G_GUINT64_FORMAT
+      " frames dropped, %u key unit requests\n", encoding_name,
+      received_packets, dropped_frames, keyframe_requests);
+
+  fail_unless (dropped_frames > 0);
+  for (i = 0; i < DROP_FRAMES; i++)
+    if (!(i % DROP_GOP && i % 2))
+      fail_unless (g_hash_table_contains (received_rtptimes,
+              GUINT_TO_POINTER (i * 90000 / DROP_FPS)),
+          "Reference frame %u was dropped", i);
+  fail_unless (keyframe_requests == 0);
+  fail_unless (seqnum_errors == 0, "%u holes in the sequence numbers",
+      seqnum_errors);
+
+  teardown_modder ();
+}
+
+GST_START_TEST (test_pacerbench_drop_frames_vp8)
+{
+  /* The S bit, and the N bit for the non-reference frames */
+  run_drop_frames_payload ("VP8", 0x10, 0x30);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_pacerbench_drop_frames_h264)
+{
+  /* FU-A indicators with a nal_ref_idc of 3 or 0 */
+  run_drop_frames_payload ("H264", 0x7c, 0x1c);
+}
+GST_END_TEST;
+
+#define PADDING_BYTES (2000)
+#define PADDING_PACKET_SIZE (500)
+
+static SsrcCheck *
+get_ssrc_check (guint32 ssrc)
+{
+  return g_hash_table_lookup (ssrc_checks, GUINT_TO_POINTER (ssrc));
+}
+
+GST_START_TEST (test_pacerbench_padding)
+{
+  GstBufferList *list;
+  GstStructure *stats;
+  guint64 padding_bytes;
+  guint16 seqnums[2] = { 0, 30000 };
+  SsrcCheck *padded, *other;
+
+  /* Padding is only sent with a latency budget, large enough to never
+   * drop anything here */
+  setup_modder (5 * GST_MSECOND, GST_SECOND, NULL);
+  expect_ssrc (0x1234, seqnums[0]);
+  expect_ssrc (0x5678, seqnums[1]);
+
+  list = gst_buffer_list_new ();
+  add_frame (list, 0x1234, &seqnums[0], 0, PADDING_PACKET_SIZE);
+  fail_unless (gst_pad_push_list (srcpad, list) == GST_FLOW_OK);
+
+  /* Sent in the stream of the frame that went out last */
+  fs_rtp_packet_modder_request_padding (modder, PADDING_BYTES);
+
+  list = gst_buffer_list_new ();
+  add_frame (list, 0x5678, &seqnums[1], 1, PADDING_PACKET_SIZE);
+  add_frame (list, 0x1234, &seqnums[0], 1, PADDING_PACKET_SIZE);
+  advance_clock (GST_SECOND / DROP_FPS);
+  fail_unless (gst_pad_push_list (srcpad, list) == GST_FLOW_OK);
+
+  advance_clock (GST_CLOCK_TIME_NONE);
+
+  g_object_get (modder, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "padding-bytes",
+          &padding_bytes));
+  gst_structure_free (stats);
+
+  padded = get_ssrc_check (0x1234);
+  other = get_ssrc_check (0x5678);
+
+  g_print ("padding: %" G_GUINT64_FORMAT " bytes in %u packets\n",
+      padding_bytes, padded->padding);
+
+  fail_unless (padding_bytes >= PADDING_BYTES);
+  fail_unless (padded->padding > 0);
+  fail_unless (other->padding == 0);
+  fail_unless (seqnum_errors == 0, "%u holes in the sequence numbers",
+      seqnum_errors);
+  /* Only the frame after the padding makes room for it */
+  fail_unless (padded->shifted == DROP_FRAME_PACKETS,
+      "%u packets of the padded SSRC were renumbered", padded->shifted);
+  fail_unless (padded->next_seqnum ==
+      (guint16) (seqnums[0] + padded->padding));
+  fail_unless (other->shifted == 0,
+      "%u packets of the other SSRC were renumbered", other->shifted);
+
+  teardown_modder ();
+}
+GST_END_TEST;
+
+static Suite *
+pacerbench_suite (void)
+{
+  Suite *s = suite_create ("pacerbench");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("pacer_synced");
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_pacerbench_synced);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("pacer_paced");
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_pacerbench_paced);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("pacer_drop_frames");
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_pacerbench_drop_frames);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("pacer_drop_frames_ssrcs");
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_pacerbench_drop_frames_ssrcs);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("pacer_drop_frames_vp8");
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_pacerbench_drop_frames_vp8);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("pacer_drop_frames_h264");
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_pacerbench_drop_frames_h264);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("pacer_padding");
+  tcase_set_timeout (tc_chain, 30);
+  tcase_add_test (tc_chain, test_pacerbench_padding);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (pacerbench);
@@ -0,0 +1,368 @@
+/* Farstream unit tests for FsRtpRetransmission
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtpbuffer.h>
+
+#include "fs-rtp-retransmission.h"
+#include "fs-rtp-codec-negotiation.h"
+#include "fs-impair-model.h"
+
+GST_DEBUG_CATEGORY (fsrtpconference_debug);
+
+/*
+ * The packets go from the auxiliary sender to the auxiliary receiver
+ * through a link that loses some of them. The sink asks for the missing
+ * packets like a jitterbuffer does when it sees a hole in the sequence
+ * numbers, the request goes upstream to the sender which sends them again
+ * in the RTX stream, and the receiver turns them back into the originals.
+ */
+
+#define MEDIA_PT (96)
+#define RTX_PT (97)
+#define MEDIA_SSRC (0x1234)
+#define LOSS_PACKETS (300)
+/* The last ones are not lost, they reveal the holes before them */
+#define LOSS_TAIL (5)
+#define LOSS_TIMEOUT (5 * G_TIME_SPAN_SECOND)
+
+static GMutex loss_mutex;
+static GCond loss_cond;
+static guint received[LOSS_PACKETS];
+static guint received_packets;
+static guint next_seqnum;
+static guint lost_packets;
+
+static FsImpairModel *model;
+static GstPad *srcpad, *sinkpad;
+
+static void
+setup (void)
+{
+  GST_DEBUG_CATEGORY_INIT (fsrtpconference_debug, "fsrtpconference", 0,
+      "Farstream RTP Conference Element");
+}
+
+GST_START_TEST (test_retransmission_history)
+{
+  setup ();
+
+  /* Without an RTT, as long as possible */
+  fail_unless_equals_int (fs_rtp_retransmission_get_history_time (0), 1000);
+
+  /* A few RTTs and a margin for the reordering */
+  fail_unless_equals_int (fs_rtp_retransmission_get_history_time (40000),
+      170);
+  fail_unless_equals_int (fs_rtp_retransmission_get_history_time (200000),
+      650);
+
+  /* But bounded */
+  fail_unless_equals_int (fs_rtp_retransmission_get_history_time (1000),
+      100);
+  fail_unless_equals_int (fs_rtp_retransmission_get_history_time (2000000),
+      1000);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_retransmission_codec_is_rtx)
+{
+  FsCodec *codec;
+  gint apt = -1;
+
+  setup ();
+
+  codec = fs_codec_new (RTX_PT, "rtx", FS_MEDIA_TYPE_VIDEO, 90000);
+  fail_if (fs_rtp_codec_is_rtx (codec, &apt));
+  fs_codec_add_optional_parameter (codec, "apt", "96x");
+  fail_if (fs_rtp_codec_is_rtx (codec, &apt));
+  fs_codec_remove_optional_parameter (codec,
+      fs_codec_get_optional_parameter (codec, "apt", NULL));
+  fs_codec_add_optional_parameter (codec, "apt", "96");
+  fail_unless (fs_rtp_codec_is_rtx (codec, &apt));
+  fail_unless_equals_int (apt, MEDIA_PT);
+  fs_codec_destroy (codec);
+
+  codec = fs_codec_new (MEDIA_PT, "H264", FS_MEDIA_TYPE_VIDEO, 90000);
+  fail_if (fs_rtp_codec_is_rtx (codec, NULL));
+  fs_codec_destroy (codec);
+}
+GST_END_TEST;
+
+static GstPadProbeReturn
+lossy_link (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
+{
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GstClockTime departure;
+  gboolean drop = FALSE;
+  guint16 seqnum;
+  guint8 pt;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
+    return GST_PAD_PROBE_OK;
+  pt = gst_rtp_buffer_get_payload_type (&rtpbuffer);
+  seqnum = gst_rtp_buffer_get_seq (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+
+  /* The retransmissions always make it */
+  if (pt != MEDIA_PT || seqnum >= LOSS_PACKETS - LOSS_TAIL)
+    return GST_PAD_PROBE_OK;
+
+  g_mutex_lock (&loss_mutex);
+  if (!fs_impair_model_process (model, gst_buffer_get_size (buffer),
+          GST_BUFFER_PTS (buffer), &departure))
+  {
+    lost_packets++;
+    drop = TRUE;
+  }
+  g_mutex_unlock (&loss_mutex);
+
+  return drop ? GST_PAD_PROBE_DROP : GST_PAD_PROBE_OK;
+}
+
+static GstFlowReturn
+loss_sink_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+  GArray *missing = g_array_new (FALSE, FALSE, sizeof (guint));
+  guint16 seqnum;
+  guint i;
+
+  fail_unless (gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer));
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_type (&rtpbuffer),
+      MEDIA_PT);
+  fail_unless_equals_int (gst_rtp_buffer_get_ssrc (&rtpbuffer), MEDIA_SSRC);
+  seqnum = gst_rtp_buffer_get_seq (&rtpbuffer);
+  gst_rtp_buffer_unmap (&rtpbuffer);
+  gst_buffer_unref (buffer);
+
+  fail_unless (seqnum < LOSS_PACKETS);
+
+  g_mutex_lock (&loss_mutex);
+  received[seqnum]++;
+  received_packets++;
+  for (; next_seqnum < seqnum; next_seqnum++)
+    if (!received[next_seqnum])
+      g_array_append_val (missing, next_seqnum);
+  next_seqnum = MAX (next_seqnum, seqnum + 1);
+  g_cond_broadcast (&loss_cond);
+  g_mutex_unlock (&loss_mutex);
+
+  /* Ask for the holes, like a jitterbuffer */
+  for (i = 0; i < missing->len; i++)
+    gst_pad_push_event (sinkpad,
+        gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+            gst_structure_new ("GstRTPRetransmissionRequest",
+                "seqnum", G_TYPE_UINT, g_array_index (missing, guint, i),
+                "ssrc", G_TYPE_UINT, MEDIA_SSRC,
+                NULL)));
+  g_array_free (missing, TRUE);
+
+  return GST_FLOW_OK;
+}
+
+static CodecAssociation *
+new_codec_association (FsCodec *codec)
+{
+  CodecAssociation *ca = g_slice_new0 (CodecAssociation);
+
+  ca->codec = codec;
+  ca->send_codec = fs_codec_copy (codec);
+
+  return ca;
+}
+
+static void
+free_codec_association (CodecAssociation *ca)
+{
+  fs_codec_destroy (ca->codec);
+  fs_codec_destroy (ca->send_codec);
+  g_slice_free (CodecAssociation, ca);
+}
+
+GST_START_TEST (test_retransmission_loss)
+{
+  FsRtpRetransmission *rtx;
+  GstElement *sender, *receiver;
+  GstPad *pad, *peer;
+  GstStructure *s;
+  GstSegment segment;
+  GstCaps *caps;
+  GList *cas = NULL;
+  FsCodec *codec;
+  GError *error = NULL;
+  gint64 end_time;
+  guint nacked = 0, retransmitted = 0, requested = 0, recovered = 0;
+  guint i;
+
+  setup ();
+
+  rtx = fs_rtp_retransmission_new (0);
+  if (!fs_rtp_retransmission_is_available (rtx))
+  {
+    g_debug ("rtprtxsend or rtprtxreceive not installed, skipping test");
+    gst_object_unref (rtx);
+    return;
+  }
+
+  s = gst_structure_from_string ("impairment, seed=(uint)4588,"
+      " loss=(double)0.05", NULL);
+  model = fs_impair_model_new (s, 0, &error);
+  g_assert_no_error (error);
+  gst_structure_free (s);
+
+  memset (received, 0, sizeof (received));
+  received_packets = 0;
+  next_seqnum = 0;
+  lost_packets = 0;
+
+  codec = fs_codec_new (MEDIA_PT, "H264", FS_MEDIA_TYPE_VIDEO, 90000);
+  fs_codec_add_feedback_parameter (codec, "nack", "", "");
+  cas = g_list_append (cas, new_codec_association (codec));
+  codec = fs_codec_new (RTX_PT, "rtx", FS_MEDIA_TYPE_VIDEO, 90000);
+  fs_codec_add_optional_parameter (codec, "apt", "96");
+  cas = g_list_append (cas, new_codec_association (codec));
+  fs_rtp_retransmission_codecs_updated (rtx, cas);
+  g_list_free_full (cas, (GDestroyNotify) free_codec_association);
+
+  sender = fs_rtp_retransmission_get_aux_sender (rtx);
+  receiver = fs_rtp_retransmission_get_aux_receiver (rtx);
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (sinkpad, loss_sink_chain);
+
+  pad = gst_element_get_static_pad (sender, "sink_0");
+  fail_unless (gst_pad_link (srcpad, pad) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (sender, "src_0");
+  peer = gst_element_get_static_pad (receiver, "sink_0");
+  fail_unless (gst_pad_link (pad, peer) == GST_PAD_LINK_OK);
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, lossy_link, NULL, NULL);
+  gst_object_unref (peer);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (receiver, "src_0");
+  fail_unless (gst_pad_link (pad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (pad);
+
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_if (gst_element_set_state (receiver, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+  fail_if (gst_element_set_state (sender, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("retransmission"));
+  caps = gst_caps_new_simple ("application/x-rtp",
+      "media", G_TYPE_STRING, "video",
+      "clock-rate", G_TYPE_INT, 90000,
+      "encoding-name", G_TYPE_STRING, "H264",
+      "payload", G_TYPE_INT, MEDIA_PT,
+      "ssrc", G_TYPE_UINT, MEDIA_SSRC,
+      NULL);
+  gst_pad_push_event (srcpad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  /* One packet per frame at 30 frames/sec */
+  for (i = 0; i < LOSS_PACKETS; i++)
+  {
+    GstBuffer *buffer = gst_rtp_buffer_new_allocate (500, 0, 0);
+    GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
+
+    gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtpbuffer);
+    gst_rtp_buffer_set_payload_type (&rtpbuffer, MEDIA_PT);
+    gst_rtp_buffer_set_ssrc (&rtpbuffer, MEDIA_SSRC);
+    gst_rtp_buffer_set_seq (&rtpbuffer, i);
+    gst_rtp_buffer_set_timestamp (&rtpbuffer, i * 3000);
+    gst_rtp_buffer_set_marker (&rtpbuffer, TRUE);
+    gst_rtp_buffer_unmap (&rtpbuffer);
+    GST_BUFFER_PTS (buffer) = i * GST_SECOND / 30;
+
+    fail_unless (gst_pad_push (srcpad, buffer) == GST_FLOW_OK);
+  }
+
+  end_time = g_get_monotonic_time () + LOSS_TIMEOUT;
+  g_mutex_lock (&loss_mutex);
+  while (received_packets < LOSS_PACKETS)
+    if (!g_cond_wait_until (&loss_cond, &loss_mutex, end_time))
+      break;
+  g_mutex_unlock (&loss_mutex);
+
+  fail_unless (lost_packets > 0, "The link lost nothing");
+
+  /* Every lost packet came back once */
+  for (i = 0; i < LOSS_PACKETS; i++)
+    fail_unless (received[i] == 1, "Got packet %u %u times", i, received[i]);
+
+  s = fs_rtp_retransmission_get_stats (rtx);
+  fail_unless (gst_structure_get_uint (s, "nacked-packets", &nacked));
+  fail_unless (gst_structure_get_uint (s, "retransmitted-packets",
+          &retransmitted));
+  fail_unless (gst_structure_get_uint (s, "requested-packets", &requested));
+  fail_unless (gst_structure_get_uint (s, "recovered-packets", &recovered));
+  gst_structure_free (s);
+
+  fail_unless_equals_int (nacked, lost_packets);
+  fail_unless_equals_int (retransmitted, lost_packets);
+  fail_unless_equals_int (requested, lost_packets);
+  fail_unless_equals_int (recovered, lost_packets);
+
+  gst_element_set_state (sender, GST_STATE_NULL);
+  gst_element_set_state (receiver, GST_STATE_NULL);
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+  gst_object_unref (sender);
+  gst_object_unref (receiver);
+  gst_object_unref (rtx);
+  fs_impair_model_free (model);
+}
+GST_END_TEST;
+
+static Suite *
+retransmission_suite (void)
+{
+  Suite *s = suite_create ("retransmission");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("retransmission_history");
+  tcase_add_test (tc_chain, test_retransmission_history);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("retransmission_codec_is_rtx");
+  tcase_add_test (tc_chain, test_retransmission_codec_is_rtx);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("retransmission_loss");
+  tcase_add_test (tc_chain, test_retransmission_loss);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (retransmission);
@@ -0,0 +1,404 @@
+/* Farstream congestion control simulations on a virtual clock
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "sim-common.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+
+/*
+ * A bottleneck link with a drop-tail queue, a propagation delay and random
+ * loss, whose parameters can change over time. Nothing waits on a real
+ * clock: the events are run in time order from a priority queue, so
+ * minutes of traffic take milliseconds. The simulations put their own
+ * events in the queue, the feedback goes back on a path without a queue.
+ *
+ * For each scenario, this prints on one line the time the flows take to
+ * converge after the last change, the fairness between them, how much
+ * their rate oscillates, how much of the link they use and how long the
+ * packets wait in the bottleneck queue. The random numbers come from a
+ * fixed seed, so the same code always prints the same numbers, and each
+ * scenario fails if they get worse than its limits.
+ */
+
+#define EVENT_AT(sim, i) \
+  ((SimEvent *) ((sim)->events->data + (i) * sim_event_size (sim)))
+
+static guint
+sim_event_size (Sim *sim)
+{
+  return g_array_get_element_size (sim->events);
+}
+
+static gboolean
+sim_event_before (SimEvent *a, SimEvent *b)
+{
+  return a->time < b->time || (a->time == b->time && a->order < b->order);
+}
+
+static void
+sim_swap_events (Sim *sim, guint a, guint b, gpointer tmp)
+{
+  guint size = sim_event_size (sim);
+
+  memcpy (tmp, EVENT_AT (sim, a), size);
+  memcpy (EVENT_AT (sim, a), EVENT_AT (sim, b), size);
+  memcpy (EVENT_AT (sim, b), tmp, size);
+}
+
+/**
+ * sim_push_event:
+ * @sim: a #Sim
+ * @event: an event of the size of the harness, starting with a #SimEvent
+ *
+ * Copies @event in the queue
+ */
+
+void
+sim_push_event (Sim *sim, gpointer event)
+{
+  gpointer tmp = g_alloca (sim_event_size (sim));
+  guint i;
+
+  ((SimEvent *) event)->order = sim->event_order++;
+  g_array_append_vals (sim->events, event, 1);
+
+  for (i = sim->events->len - 1; i > 0; i = (i - 1) / 2)
+  {
+    if (!sim_event_before (EVENT_AT (sim, i), EVENT_AT (sim, (i - 1) / 2)))
+      break;
+    sim_swap_events (sim, i, (i - 1) / 2, tmp);
+  }
+}
+
+static gboolean
+sim_pop_event (Sim *sim, SimEvent *event)
+{
+  gpointer tmp = g_alloca (sim_event_size (sim));
+  guint len = sim->events->len;
+  guint i = 0;
+
+  if (len == 0)
+    return FALSE;
+
+  memcpy (event, EVENT_AT (sim, 0), sim_event_size (sim));
+  memcpy (EVENT_AT (sim, 0), EVENT_AT (sim, len - 1), sim_event_size (sim));
+  g_array_set_size (sim->events, --len);
+
+  for (;;)
+  {
+    guint smallest = i;
+
+    if (2 * i + 1 < len && sim_event_before (EVENT_AT (sim, 2 * i + 1),
+            EVENT_AT (sim, smallest)))
+      smallest = 2 * i + 1;
+    if (2 * i + 2 < len && sim_event_before (EVENT_AT (sim, 2 * i + 2),
+            EVENT_AT (sim, smallest)))
+      smallest = 2 * i + 2;
+    if (smallest == i)
+      break;
+
+    sim_swap_events (sim, i, smallest, tmp);
+    i = smallest;
+  }
+
+  return TRUE;
+}
+
+void
+sim_push_simple_event (Sim *sim, guint type, guint flow, guint64 time)
+{
+  SimEvent *event = g_alloca (sim_event_size (sim));
+
+  memset (event, 0, sim_event_size (sim));
+  event->time = time;
+  event->type = type;
+  event->flow = flow;
+
+  sim_push_event (sim, event);
+}
+
+/**
+ * sim_link_transmit:
+ * @sim: a #Sim
+ * @size: the size of the packet in bytes
+ * @arrival: (out): when it reaches the other end
+ *
+ * Puts a packet on the bottleneck link
+ *
+ * Returns: %FALSE if it is dropped
+ */
+
+gboolean
+sim_link_transmit (Sim *sim, guint size, guint64 *arrival)
+{
+  guint64 start;
+
+  while (sim->queue_len && sim->queue[sim->queue_head] <= sim->now)
+  {
+    sim->queue_head = (sim->queue_head + 1) % sim->queue_max;
+    sim->queue_len--;
+  }
+
+  if (sim->queue_len == sim->queue_max)
+    return FALSE;
+
+  start = MAX (sim->now, sim->link_free);
+  sim->link_free = start + (guint64) size * SIM_SECOND / sim->step->link_rate;
+  sim->queue[(sim->queue_head + sim->queue_len) % sim->queue_max] =
+      sim->link_free;
+  sim->queue_len++;
+
+  if (sim->now >= sim->n_bins / 2 * SIM_BIN)
+  {
+    guint64 delay = (start - sim->now) / SIM_MS;
+
+    sim->queue_delays[MIN (delay, SIM_MAX_QUEUE_DELAY / SIM_MS)]++;
+    sim->queue_delay_sum += delay;
+    sim->queue_delay_count++;
+  }
+
+  if (g_rand_double (sim->rand) < sim->step->loss)
+    return FALSE;
+
+  *arrival = sim->link_free + sim->step->delay;
+
+  return TRUE;
+}
+
+static gdouble
+sim_capacity (const SimScenario *scenario, guint64 time)
+{
+  const SimStep *step = scenario->steps;
+
+  while (step[1].time <= time)
+    step++;
+
+  return step->link_rate;
+}
+
+static void
+sim_compute_results (Sim *sim, SimResults *results)
+{
+  const SimScenario *scenario = sim->scenario;
+  const SimStep *step;
+  guint64 settle_time = (scenario->flows - 1) * scenario->flow_spacing;
+  guint first_bin = sim->n_bins / 2;
+  gdouble sum = 0, sum_squares = 0, capacity = 0;
+  guint64 count = 0;
+  guint i, b;
+
+  results->packets = sim->packets;
+
+  /* Convergence is when all the flows first send within 25% of their fair
+   * share, after the last change */
+  for (step = scenario->steps; step[1].time != G_MAXUINT64; step++);
+  settle_time = MAX (settle_time, step->time);
+
+  results->convergence = (sim->n_bins * SIM_BIN - settle_time) /
+      (gdouble) SIM_SECOND;
+  for (b = settle_time / SIM_BIN; b < sim->n_bins; b++)
+  {
+    gdouble fair = scenario->fair_rate ? scenario->fair_rate :
+        sim_capacity (scenario, b * SIM_BIN) / scenario->flows;
+
+    for (i = 0; i < scenario->flows; i++)
+    {
+      gdouble sent = (gdouble) sim->sent_bins[i][b] * SIM_SECOND / SIM_BIN;
+
+      if (sent < 0.75 * fair || sent > 1.25 * fair)
+        break;
+    }
+
+    if (i == scenario->flows)
+    {
+      results->convergence = ((b + 1) * SIM_BIN - settle_time) /
+          (gdouble) SIM_SECOND;
+      break;
+    }
+  }
+
+  /* The rest is measured over the second half */
+  results->oscillation = 0;
+  for (i = 0; i < scenario->flows; i++)
+  {
+    gdouble flow_sum = 0, flow_sum_squares = 0, mean;
+
+    for (b = first_bin; b < sim->n_bins; b++)
+    {
+      flow_sum += sim->received_bins[i][b];
+      flow_sum_squares += (gdouble) sim->received_bins[i][b] *
+          sim->received_bins[i][b];
+    }
+
+    mean = flow_sum / (sim->n_bins - first_bin);
+    if (mean > 0)
+      results->oscillation = MAX (results->oscillation,
+          sqrt (MAX (flow_sum_squares / (sim->n_bins - first_bin) -
+                  mean * mean, 0)) / mean);
+
+    sum += flow_sum;
+    sum_squares += flow_sum * flow_sum;
+  }
+
+  /* Jain's fairness index */
+  results->fairness = sum_squares > 0 ?
+      sum * sum / (scenario->flows * sum_squares) : 0;
+
+  for (b = first_bin; b < sim->n_bins; b++)
+    capacity += scenario->fair_rate ? scenario->fair_rate * scenario->flows :
+        sim_capacity (scenario, b * SIM_BIN);
+  results->utilisation = sum / (capacity * SIM_BIN / SIM_SECOND);
+
+  results->queue_delay = sim->queue_delay_count ?
+      (gdouble) sim->queue_delay_sum / sim->queue_delay_count : 0;
+  results->queue_delay_95 = 0;
+  for (i = 0; i <= SIM_MAX_QUEUE_DELAY / SIM_MS; i++)
+  {
+    count += sim->queue_delays[i];
+    if (count >= 0.95 * sim->queue_delay_count)
+    {
+      results->queue_delay_95 = i;
+      break;
+    }
+  }
+}
+
+/**
+ * sim_run_scenario:
+ * @harness: the controllers to run
+ * @scenario: the link and the flows
+ * @user_data: the flows of @harness, in #Sim.user_data
+ * @results: (out): where to put the results
+ *
+ * Runs @scenario until its end and prints its results
+ */
+
+void
+sim_run_scenario (const SimHarness *harness, const SimScenario *scenario,
+    gpointer user_data, SimResults *results)
+{
+  Sim sim = { scenario, scenario->steps };
+  SimEvent *event;
+  gint64 start;
+  guint i;
+
+  g_assert (scenario->flows <= SIM_MAX_FLOWS);
+  g_assert (harness->event_size >= sizeof (SimEvent));
+
+  sim.rand = g_rand_new_with_seed (SIM_SEED);
+  sim.events = g_array_new (FALSE, FALSE, harness->event_size);
+  sim.n_bins = scenario->duration / SIM_BIN;
+  sim.queue_max = MAX (scenario->queue_size / SIM_PACKET_SIZE, 1);
+  sim.queue = g_new (guint64, sim.queue_max);
+  sim.queue_delays = g_new0 (guint64, SIM_MAX_QUEUE_DELAY / SIM_MS + 1);
+  sim.user_data = user_data;
+
+  for (i = 0; i < scenario->flows; i++)
+  {
+    sim.sent_bins[i] = g_new0 (guint64, sim.n_bins);
+    sim.received_bins[i] = g_new0 (guint64, sim.n_bins);
+  }
+
+  event = g_malloc0 (harness->event_size);
+
+  harness->start (&sim);
+
+  start = g_get_monotonic_time ();
+
+  while (sim_pop_event (&sim, event))
+  {
+    if (event->time >= sim.n_bins * SIM_BIN)
+      break;
+
+    sim.now = event->time;
+    while (sim.step[1].time <= sim.now)
+      sim.step++;
+
+    harness->handle_event (&sim, event);
+  }
+
+  sim_compute_results (&sim, results);
+
+  g_print ("%s %-12s: %u flows, %4" G_GUINT64_FORMAT " s in %4"
+      G_GINT64_FORMAT " ms, convergence %5.1f s, fairness %.3f,"
+      " oscillation %.3f, utilisation %.3f, queue delay %.0f ms"
+      " (95%%: %.0f ms)\n", harness->name, scenario->name,
+      scenario->flows, scenario->duration / SIM_SECOND,
+      (g_get_monotonic_time () - start) / 1000, results->convergence,
+      results->fairness, results->oscillation, results->utilisation,
+      results->queue_delay, results->queue_delay_95);
+
+  harness->stop (&sim);
+
+  for (i = 0; i < scenario->flows; i++)
+  {
+    g_free (sim.sent_bins[i]);
+    g_free (sim.received_bins[i]);
+  }
+  g_free (event);
+  g_free (sim.queue_delays);
+  g_free (sim.queue);
+  g_array_free (sim.events, TRUE);
+  g_rand_free (sim.rand);
+}
+
+/**
+ * sim_check_scenario:
+ * @harness: the controllers to run
+ * @scenario: the link, the flows and the limits
+ * @user_data: the flows of @harness, in #Sim.user_data
+ *
+ * Runs @scenario and fails if any of its limits is exceeded
+ */
+
+void
+sim_check_scenario (const SimHarness *harness, const SimScenario *scenario,
+    gpointer user_data)
+{
+  SimResults results = { 0 };
+
+  sim_run_scenario (harness, scenario, user_data, &results);
+
+  if (scenario->max_convergence)
+    fail_unless (results.convergence <= scenario->max_convergence,
+        "%s: took %.1f s to converge", scenario->name, results.convergence);
+  if (scenario->min_fairness)
+    fail_unless (results.fairness >= scenario->min_fairness,
+        "%s: fairness is %.3f", scenario->name, results.fairness);
+  if (scenario->max_oscillation)
+    fail_unless (results.oscillation <= scenario->max_oscillation,
+        "%s: oscillation is %.3f", scenario->name, results.oscillation);
+  if (scenario->min_utilisation)
+    fail_unless (results.utilisation >= scenario->min_utilisation,
+        "%s: utilisation is %.3f", scenario->name, results.utilisation);
+  if (scenario->max_utilisation)
+    fail_unless (results.utilisation <= scenario->max_utilisation,
+        "%s: utilisation is %.3f", scenario->name, results.utilisation);
+  if (scenario->max_queue_delay)
+    fail_unless (results.queue_delay_95 <= scenario->max_queue_delay,
+        "%s: queue delay is %.0f ms", scenario->name,
+        results.queue_delay_95);
+}
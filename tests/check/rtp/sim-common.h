@@ -0,0 +1,142 @@
+/* Farstream congestion control simulations on a virtual clock
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifndef __SIM_COMMON_H__
+#define __SIM_COMMON_H__
+
+#include <glib.h>
+
+/* All times are in microseconds */
+#define SIM_SECOND (1000 * 1000)
+#define SIM_MS (1000)
+#define SIM_PACKET_SIZE (1200)
+/* The rates are sampled over this long */
+#define SIM_BIN (500 * 1000)
+#define SIM_MAX_FLOWS (8)
+#define SIM_SEED (42)
+/* The queue delays are counted in 1ms slots up to that */
+#define SIM_MAX_QUEUE_DELAY (2 * SIM_SECOND)
+
+typedef struct {
+  guint64 time;
+  guint link_rate; /* bytes/sec */
+  guint delay; /* one way */
+  gdouble loss;
+} SimStep;
+
+typedef struct {
+  const gchar *name;
+  guint flows;
+  guint64 flow_spacing;
+  guint64 duration;
+  guint queue_size; /* bytes */
+  /* The first starts at 0, ends with a time of G_MAXUINT64 */
+  const SimStep *steps;
+  /* What each flow should get if it is not the link capacity divided by
+   * the number of flows */
+  guint fair_rate;
+
+  /* Limits for the regression checks, 0 to not check */
+  gdouble max_convergence; /* seconds */
+  gdouble min_fairness;
+  gdouble max_oscillation;
+  gdouble min_utilisation;
+  gdouble max_utilisation;
+  gdouble max_queue_delay; /* milliseconds, 95th percentile */
+} SimScenario;
+
+typedef struct {
+  gdouble convergence;
+  gdouble fairness;
+  gdouble oscillation;
+  gdouble utilisation;
+  gdouble queue_delay;
+  gdouble queue_delay_95;
+  guint64 packets;
+} SimResults;
+
+/* The first member of the events of each simulation */
+typedef struct {
+  guint64 time;
+  /* keeps the events of the same time in the order they were added */
+  guint64 order;
+  guint type;
+  guint flow;
+} SimEvent;
+
+typedef struct _Sim Sim;
+
+struct _Sim {
+  const SimScenario *scenario;
+  const SimStep *step;
+  GRand *rand;
+  guint64 now;
+  guint64 packets;
+
+  GArray *events;
+  guint64 event_order;
+
+  guint n_bins;
+  guint64 *sent_bins[SIM_MAX_FLOWS];
+  guint64 *received_bins[SIM_MAX_FLOWS];
+
+  /* Departure times of the packets in the bottleneck queue */
+  guint64 *queue;
+  guint queue_max;
+  guint queue_head;
+  guint queue_len;
+  guint64 link_free;
+
+  /* over the second half, in milliseconds */
+  guint64 *queue_delays;
+  guint64 queue_delay_count;
+  guint64 queue_delay_sum;
+
+  /* the flows of the simulation */
+  gpointer user_data;
+};
+
+/*
+ * What differs between the simulations: the events they put in the queue
+ * and the controllers on each side
+ */
+typedef struct {
+  /* printed at the start of the line of each scenario */
+  const gchar *name;
+  /* the size of the events, which start with a #SimEvent */
+  gsize event_size;
+
+  /* pushes the first events */
+  void (*start) (Sim *sim);
+  void (*handle_event) (Sim *sim, SimEvent *event);
+  /* frees what the flows created */
+  void (*stop) (Sim *sim);
+} SimHarness;
+
+void sim_push_event (Sim *sim, gpointer event);
+void sim_push_simple_event (Sim *sim, guint type, guint flow, guint64 time);
+
+gboolean sim_link_transmit (Sim *sim, guint size, guint64 *arrival);
+
+void sim_run_scenario (const SimHarness *harness,
+    const SimScenario *scenario, gpointer user_data, SimResults *results);
+void sim_check_scenario (const SimHarness *harness,
+    const SimScenario *scenario, gpointer user_data);
+
+#endif /* __SIM_COMMON_H__ */
@@ -0,0 +1,466 @@
+/* Farstream TFRC receiver microbenchmark
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <math.h>
+
+#include <gst/check/gstcheck.h>
+
+#include "tfrc.h"
+
+/*
+ * Feeds synthetic packet traces straight into a TfrcReceiver, without any
+ * pipeline, and prints how long each packet takes to account for. The
+ * traces are generated from a fixed seed, so every run sees the same
+ * sequence numbers.
+ *
+ * The sender side sends the same packets to a growing number of receivers,
+ * each with its own TfrcSender, and prints the cost of accounting for each
+ * sent packet. The steps counted by the TfrcSendLog, not the time, are
+ * compared, and must not depend on the number of receivers.
+ *
+ * The TCP throughput equation and its inverse are compared with the
+ * straightforward implementation they replaced, for accuracy and speed.
+ *
+ * All times are in microseconds, like in tfrc.c
+ */
+
+#define BENCH_PACKETS (200000)
+#define BENCH_PACKET_SIZE (1200)
+#define BENCH_INTERVAL (10 * 1000)
+#define BENCH_TRANSIT (50 * 1000)
+#define BENCH_RTT (100 * 1000)
+
+typedef enum {
+  TRACE_IN_ORDER,
+  TRACE_RANDOM_LOSS,
+  TRACE_BURST_LOSS,
+  TRACE_REORDER
+} TraceType;
+
+static const gchar *trace_names[] = {
+  "in-order", "random-loss", "burst-loss", "reorder"
+};
+
+/* Fills @seqnums with the order in which the packets arrive */
+
+static guint
+generate_trace (TraceType type, guint *seqnums)
+{
+  GRand *rand = g_rand_new_with_seed (42);
+  guint count = 0;
+  guint i;
+
+  for (i = 0; i < BENCH_PACKETS; i++)
+  {
+    switch (type)
+    {
+      case TRACE_IN_ORDER:
+        break;
+      case TRACE_RANDOM_LOSS:
+        if (g_rand_double (rand) < 0.02)
+          continue;
+        break;
+      case TRACE_BURST_LOSS:
+        if (g_rand_double (rand) < 0.005)
+        {
+          i += g_rand_int_range (rand, 2, 10);
+          continue;
+        }
+        break;
+      case TRACE_REORDER:
+        /* Swap with the next one, the receiver must not see a loss */
+        if (i + 1 < BENCH_PACKETS && g_rand_double (rand) < 0.05)
+        {
+          seqnums[count++] = i + 1;
+          seqnums[count++] = i;
+          i++;
+          continue;
+        }
+        break;
+    }
+
+    seqnums[count++] = i;
+  }
+
+  g_rand_free (rand);
+
+  return count;
+}
+
+static void
+run_tfrc_bench (TraceType type, gboolean expect_loss)
+{
+  guint *seqnums = g_new (guint, BENCH_PACKETS);
+  guint count = generate_trace (type, seqnums);
+  TfrcReceiver *receiver;
+  guint64 now = BENCH_TRANSIT;
+  guint64 next_feedback = now + BENCH_RTT;
+  gdouble loss_event_rate = 0;
+  gdouble max_loss_event_rate = 0;
+  guint receive_rate = 0;
+  gint64 start, elapsed;
+  guint i;
+
+  receiver = tfrc_receiver_new (now);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < count; i++)
+  {
+    guint64 timestamp = (guint64) seqnums[i] * BENCH_INTERVAL;
+
+    now = MAX (now, timestamp + BENCH_TRANSIT);
+
+    tfrc_receiver_got_packet (receiver, timestamp, now, seqnums[i], BENCH_RTT,
+        BENCH_PACKET_SIZE);
+
+    /* Never send feedback while a reordered packet is still on its way */
+    if (now >= next_feedback &&
+        (i + 1 == count || seqnums[i + 1] > seqnums[i]))
+    {
+      if (tfrc_receiver_send_feedback (receiver, now, &loss_event_rate,
+              &receive_rate))
+        max_loss_event_rate = MAX (max_loss_event_rate, loss_event_rate);
+      next_feedback = now + BENCH_RTT;
+    }
+  }
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("tfrc receiver %-11s: %u packets in %" G_GINT64_FORMAT
+      " us, %.1f ns/packet, max loss event rate %f\n", trace_names[type],
+      count, elapsed, (elapsed * 1000.0) / count, max_loss_event_rate);
+
+  if (expect_loss)
+    fail_unless (max_loss_event_rate > 0 && max_loss_event_rate < 0.5,
+        "Loss event rate %f out of range", max_loss_event_rate);
+  else
+    fail_unless (max_loss_event_rate == 0, "Found loss event rate %f without"
+        " any loss", max_loss_event_rate);
+
+  tfrc_receiver_free (receiver);
+  g_free (seqnums);
+}
+
+GST_START_TEST (test_tfrcbench_in_order)
+{
+  run_tfrc_bench (TRACE_IN_ORDER, FALSE);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_tfrcbench_random_loss)
+{
+  run_tfrc_bench (TRACE_RANDOM_LOSS, TRUE);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_tfrcbench_burst_loss)
+{
+  run_tfrc_bench (TRACE_BURST_LOSS, TRUE);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_tfrcbench_reorder)
+{
+  run_tfrc_bench (TRACE_REORDER, FALSE);
+}
+GST_END_TEST;
+
+/*
+ * Returns the steps done for each sent packet, and in @feedback_operations,
+ * the steps done to catch up for each feedback packet
+ */
+
+static gdouble
+run_tfrc_sender_bench (guint receivers, gdouble *feedback_operations)
+{
+  TfrcSendLog *log = tfrc_send_log_new (BENCH_PACKET_SIZE);
+  TfrcSender **senders = g_new (TfrcSender *, receivers);
+  guint packets_per_rtt = BENCH_RTT / BENCH_INTERVAL;
+  guint64 now = 0;
+  gint64 elapsed = 0;
+  guint64 send_operations = 0, sync_operations = 0;
+  guint feedbacks = 0;
+  guint i, j;
+
+  for (i = 0; i < receivers; i++)
+  {
+    senders[i] = tfrc_sender_new (BENCH_PACKET_SIZE, now, 0);
+    tfrc_sender_sync_send_log (senders[i], log);
+  }
+
+  for (i = 0; i < BENCH_PACKETS; i += packets_per_rtt)
+  {
+    gint64 start = g_get_monotonic_time ();
+    guint64 operations = tfrc_send_log_get_operations (log);
+
+    for (j = 0; j < packets_per_rtt; j++)
+    {
+      tfrc_send_log_sending_packet (log, now, BENCH_PACKET_SIZE, FALSE);
+      now += BENCH_INTERVAL;
+    }
+
+    elapsed += g_get_monotonic_time () - start;
+    send_operations += tfrc_send_log_get_operations (log) - operations;
+    operations = tfrc_send_log_get_operations (log);
+
+    /* Every receiver sends one feedback packet per RTT, acknowledging
+     * the packet sent half a RTT ago */
+    for (j = 0; j < receivers; j++)
+    {
+      tfrc_sender_sync_send_log (senders[j], log);
+      tfrc_sender_on_feedback_packet (senders[j], now, BENCH_RTT,
+          BENCH_PACKET_SIZE * packets_per_rtt * G_USEC_PER_SEC / BENCH_RTT,
+          0, tfrc_send_log_is_data_limited (log, now - BENCH_RTT / 2,
+              BENCH_RTT));
+      feedbacks++;
+    }
+
+    sync_operations += tfrc_send_log_get_operations (log) - operations;
+  }
+
+  *feedback_operations = (gdouble) sync_operations / feedbacks;
+
+  g_print ("tfrc sender %3u receivers: %u packets, %.1f ns/packet,"
+      " %.2f steps/packet, %.2f steps/feedback\n",
+      receivers, BENCH_PACKETS, (elapsed * 1000.0) / BENCH_PACKETS,
+      (gdouble) send_operations / BENCH_PACKETS, *feedback_operations);
+
+  for (i = 0; i < receivers; i++)
+  {
+    fail_unless (tfrc_sender_get_send_rate (senders[i]) > 0);
+    tfrc_sender_free (senders[i]);
+  }
+  g_free (senders);
+  tfrc_send_log_free (log);
+
+  return (gdouble) send_operations / BENCH_PACKETS;
+}
+
+GST_START_TEST (test_tfrcbench_sender)
+{
+  gdouble one, many, one_feedback, many_feedback;
+
+  one = run_tfrc_sender_bench (1, &one_feedback);
+  run_tfrc_sender_bench (10, &many_feedback);
+  many = run_tfrc_sender_bench (100, &many_feedback);
+
+  /* Each packet is accounted for once, whatever the number of receivers,
+   * and catching up costs each receiver the same */
+  fail_unless (many <= 2 * one, "%.2f steps per packet with 100 receivers,"
+      " %.2f with one", many, one);
+  fail_unless (many_feedback <= 2 * one_feedback, "%.2f steps per feedback"
+      " with 100 receivers, %.2f with one", many_feedback, one_feedback);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_tfrcbench_send_log_data_limited)
+{
+  TfrcSendLog *log = tfrc_send_log_new (BENCH_PACKET_SIZE);
+  guint64 now;
+
+  fail_unless (tfrc_send_log_is_data_limited (log, BENCH_RTT, BENCH_RTT));
+
+  /* One RTT where the sender is not limited, then two where it is */
+  for (now = 0; now < BENCH_RTT; now += BENCH_INTERVAL)
+    tfrc_send_log_sending_packet (log, now, BENCH_PACKET_SIZE, FALSE);
+  for (; now < 3 * BENCH_RTT; now += BENCH_INTERVAL)
+    tfrc_send_log_sending_packet (log, now, BENCH_PACKET_SIZE, TRUE);
+
+  fail_if (tfrc_send_log_is_data_limited (log, BENCH_RTT / 2, BENCH_RTT));
+  fail_if (tfrc_send_log_is_data_limited (log, 3 * BENCH_RTT / 2,
+          BENCH_RTT));
+  fail_unless (tfrc_send_log_is_data_limited (log, 5 * BENCH_RTT / 2,
+          BENCH_RTT));
+
+  tfrc_send_log_free (log);
+}
+GST_END_TEST;
+
+/* What tfrc.c used before the table */
+
+static gdouble
+reference_equation_bitrate (gdouble s, gdouble R, gdouble p)
+{
+  gdouble f = sqrt (2 * p / 3) + 12 * sqrt (3 * p / 8) * p * (1 + 32 * p * p);
+
+  return (1000 * 1000 * s) / (R * f);
+}
+
+static gdouble
+reference_equation_loss_event_rate (gdouble s, gdouble R, gdouble rate)
+{
+  gdouble p_min = 0;
+  gdouble p_max = 1;
+  gdouble p;
+  gdouble computed_rate;
+
+  do {
+    p = (p_min + p_max) / 2;
+    computed_rate = reference_equation_bitrate (s, R, p);
+
+    if (computed_rate < rate)
+      p_max = p;
+    else
+      p_min = p;
+
+  } while (computed_rate < 0.95 * rate || computed_rate > 1.05 * rate);
+
+  return p;
+}
+
+#define EQUATION_STEPS (1000)
+
+/* Loss event rates from 1e-8 to 1 */
+static gdouble
+equation_p (guint i)
+{
+  return pow (10, -8.0 + 8.0 * i / EQUATION_STEPS);
+}
+
+GST_START_TEST (test_tfrcbench_equation_accuracy)
+{
+  gdouble max_forward_error = 0, max_inverse_error = 0;
+  guint i;
+
+  for (i = 0; i <= EQUATION_STEPS; i++)
+  {
+    gdouble p = equation_p (i);
+    gdouble rate = reference_equation_bitrate (BENCH_PACKET_SIZE, BENCH_RTT,
+        p);
+    gdouble new_p = tfrc_equation_loss_event_rate (BENCH_PACKET_SIZE,
+        BENCH_RTT, rate);
+
+    max_forward_error = MAX (max_forward_error,
+        fabs (tfrc_equation_bitrate (BENCH_PACKET_SIZE, BENCH_RTT, p) - rate) /
+        rate);
+    max_inverse_error = MAX (max_inverse_error, fabs (new_p - p) / p);
+  }
+
+  g_print ("tfrc equation: max relative error %g, inverse %g\n",
+      max_forward_error, max_inverse_error);
+
+  fail_unless (max_forward_error < 1e-9, "Equation off by %g",
+      max_forward_error);
+  /* The bisection it replaces stopped within 5% of the rate */
+  fail_unless (max_inverse_error < 1e-4, "Inverse off by %g",
+      max_inverse_error);
+
+  /* Rates too low for any loss event rate */
+  fail_unless (tfrc_equation_loss_event_rate (BENCH_PACKET_SIZE, BENCH_RTT,
+          1) == 1);
+  fail_unless (tfrc_equation_loss_event_rate (BENCH_PACKET_SIZE, BENCH_RTT,
+          0) == 1);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_tfrcbench_equation)
+{
+  gdouble p[EQUATION_STEPS + 1], rates[EQUATION_STEPS + 1];
+  gdouble sum = 0;
+  gint64 start, reference_forward, forward, reference_inverse, inverse;
+  guint i, j;
+
+  for (i = 0; i <= EQUATION_STEPS; i++)
+  {
+    p[i] = equation_p (i);
+    rates[i] = reference_equation_bitrate (BENCH_PACKET_SIZE, BENCH_RTT, p[i]);
+  }
+
+  start = g_get_monotonic_time ();
+  for (j = 0; j < 100; j++)
+    for (i = 0; i <= EQUATION_STEPS; i++)
+      sum += reference_equation_bitrate (BENCH_PACKET_SIZE, BENCH_RTT, p[i]);
+  reference_forward = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (j = 0; j < 100; j++)
+    for (i = 0; i <= EQUATION_STEPS; i++)
+      sum += tfrc_equation_bitrate (BENCH_PACKET_SIZE, BENCH_RTT, p[i]);
+  forward = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (j = 0; j < 100; j++)
+    for (i = 0; i <= EQUATION_STEPS; i++)
+      sum += reference_equation_loss_event_rate (BENCH_PACKET_SIZE, BENCH_RTT,
+          rates[i]);
+  reference_inverse = g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (j = 0; j < 100; j++)
+    for (i = 0; i <= EQUATION_STEPS; i++)
+      sum += tfrc_equation_loss_event_rate (BENCH_PACKET_SIZE, BENCH_RTT,
+          rates[i]);
+  inverse = g_get_monotonic_time () - start;
+
+  g_print ("tfrc equation: %.1f ns/call (was %.1f), inverse %.1f ns/call"
+      " (was %.1f)\n",
+      forward * 1000.0 / (100 * (EQUATION_STEPS + 1)),
+      reference_forward * 1000.0 / (100 * (EQUATION_STEPS + 1)),
+      inverse * 1000.0 / (100 * (EQUATION_STEPS + 1)),
+      reference_inverse * 1000.0 / (100 * (EQUATION_STEPS + 1)));
+
+  fail_unless (sum > 0);
+}
+GST_END_TEST;
+
+static Suite *
+tfrcbench_suite (void)
+{
+  Suite *s = suite_create ("tfrcbench");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("tfrc_in_order");
+  tcase_add_test (tc_chain, test_tfrcbench_in_order);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_random_loss");
+  tcase_add_test (tc_chain, test_tfrcbench_random_loss);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_burst_loss");
+  tcase_add_test (tc_chain, test_tfrcbench_burst_loss);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_reorder");
+  tcase_add_test (tc_chain, test_tfrcbench_reorder);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_sender");
+  tcase_add_test (tc_chain, test_tfrcbench_sender);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_send_log_data_limited");
+  tcase_add_test (tc_chain, test_tfrcbench_send_log_data_limited);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_equation_accuracy");
+  tcase_add_test (tc_chain, test_tfrcbench_equation_accuracy);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_equation");
+  tcase_add_test (tc_chain, test_tfrcbench_equation);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tfrcbench);
@@ -0,0 +1,483 @@
+/* Farstream TFRC simulation on a virtual clock
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#include "sim-common.h"
+#include "tfrc.h"
+
+/*
+ * Connects TfrcSender and TfrcReceiver pairs through the simulated
+ * bottleneck link of sim-common.c. The feedback is used the way
+ * FsRtpTfrc uses it.
+ */
+
+typedef enum {
+  EVENT_SEND,
+  EVENT_RECEIVE,
+  EVENT_FEEDBACK,
+  EVENT_NOFEEDBACK_TIMER,
+  EVENT_FEEDBACK_TIMER
+} TfrcSimEventType;
+
+typedef struct {
+  SimEvent header;
+
+  /* the send time of the packet, or of the last one for the feedback */
+  guint64 ts;
+  guint seqnum;
+  guint rtt;
+  guint delay;
+  guint receive_rate;
+  gdouble loss_event_rate;
+} TfrcSimEvent;
+
+typedef struct {
+  TfrcSender *sender;
+  TfrcSendLog *send_log;
+  TfrcReceiver *receiver;
+
+  guint seqnum;
+  guint64 last_send;
+  guint64 fb_last_ts;
+  /* when the pending events are due, 0 if there is none */
+  guint64 send_expiry;
+  guint64 nofeedback_expiry;
+  guint64 feedback_expiry;
+
+  /* on the receiver side */
+  guint64 last_ts;
+  guint64 last_now;
+  guint last_rtt;
+} SimFlow;
+
+#define SIM_FLOW(sim, i) (&((SimFlow *) (sim)->user_data)[i])
+
+static guint
+sim_flow_get_send_rate (Sim *sim, SimFlow *flow)
+{
+  tfrc_sender_sync_send_log (flow->sender, flow->send_log);
+  return tfrc_sender_get_send_rate (flow->sender);
+}
+
+/* The next packet goes out when the current rate allows it, which is
+ * moved when the rate changes, like the pacing does */
+
+static void
+sim_schedule_send (Sim *sim, guint i)
+{
+  SimFlow *flow = SIM_FLOW (sim, i);
+  guint rate = MAX (sim_flow_get_send_rate (sim, flow), 1);
+  guint64 next = MAX (sim->now, flow->last_send +
+      MAX ((guint64) SIM_PACKET_SIZE * SIM_SECOND / rate, 1));
+
+  if (next == flow->send_expiry)
+    return;
+
+  flow->send_expiry = next;
+  sim_push_simple_event (sim, EVENT_SEND, i, next);
+}
+
+static void
+sim_update_sender_timer (Sim *sim, guint i)
+{
+  SimFlow *flow = SIM_FLOW (sim, i);
+  guint64 expiry = tfrc_sender_get_no_feedback_timer_expiry (flow->sender);
+
+  if (expiry <= sim->now)
+  {
+    tfrc_sender_sync_send_log (flow->sender, flow->send_log);
+    tfrc_sender_no_feedback_timer_expired (flow->sender, sim->now);
+    expiry = tfrc_sender_get_no_feedback_timer_expiry (flow->sender);
+  }
+
+  flow->nofeedback_expiry = expiry;
+  sim_push_simple_event (sim, EVENT_NOFEEDBACK_TIMER, i, expiry);
+}
+
+static void
+sim_set_receiver_timer (Sim *sim, guint i)
+{
+  SimFlow *flow = SIM_FLOW (sim, i);
+  guint64 expiry = tfrc_receiver_get_feedback_timer_expiry (flow->receiver);
+
+  if (expiry == 0)
+    return;
+
+  if (flow->feedback_expiry && flow->feedback_expiry <= expiry)
+    return;
+
+  flow->feedback_expiry = expiry;
+  sim_push_simple_event (sim, EVENT_FEEDBACK_TIMER, i, expiry);
+}
+
+static void
+sim_send_feedback (Sim *sim, guint i)
+{
+  SimFlow *flow = SIM_FLOW (sim, i);
+  TfrcSimEvent event = { { 0 } };
+
+  if (tfrc_receiver_send_feedback (flow->receiver, sim->now,
+          &event.loss_event_rate, &event.receive_rate))
+  {
+    event.header.time = sim->now + sim->step->delay;
+    event.header.type = EVENT_FEEDBACK;
+    event.header.flow = i;
+    event.ts = flow->last_ts;
+    event.delay = sim->now - flow->last_now;
+    sim_push_event (sim, &event);
+  }
+
+  sim_set_receiver_timer (sim, i);
+}
+
+static void
+sim_receiver_timer_func (Sim *sim, guint i)
+{
+  SimFlow *flow = SIM_FLOW (sim, i);
+  guint64 expiry;
+
+  flow->feedback_expiry = 0;
+  expiry = tfrc_receiver_get_feedback_timer_expiry (flow->receiver);
+
+  if (expiry <= sim->now &&
+      tfrc_receiver_feedback_timer_expired (flow->receiver, sim->now))
+    sim_send_feedback (sim, i);
+  else
+    sim_set_receiver_timer (sim, i);
+}
+
+static void
+sim_handle_send (Sim *sim, guint i)
+{
+  SimFlow *flow = SIM_FLOW (sim, i);
+  TfrcSimEvent event = { { 0 } };
+  guint64 arrival;
+
+  if (!flow->sender)
+  {
+    flow->sender = tfrc_sender_new (SIM_PACKET_SIZE, sim->now, 0);
+    flow->send_log = tfrc_send_log_new (SIM_PACKET_SIZE);
+    tfrc_sender_sync_send_log (flow->sender, flow->send_log);
+    sim_update_sender_timer (sim, i);
+  }
+
+  tfrc_send_log_sending_packet (flow->send_log, sim->now, SIM_PACKET_SIZE,
+      FALSE);
+  sim->sent_bins[i][sim->now / SIM_BIN] += SIM_PACKET_SIZE;
+
+  if (sim_link_transmit (sim, SIM_PACKET_SIZE, &arrival))
+  {
+    event.header.time = arrival;
+    event.header.type = EVENT_RECEIVE;
+    event.header.flow = i;
+    event.ts = sim->now;
+    event.seqnum = flow->seqnum;
+    event.rtt = tfrc_sender_get_averaged_rtt (flow->sender);
+    sim_push_event (sim, &event);
+  }
+  flow->seqnum++;
+  flow->last_send = sim->now;
+
+  sim_schedule_send (sim, i);
+}
+
+static void
+sim_handle_receive (Sim *sim, TfrcSimEvent *event)
+{
+  SimFlow *flow = SIM_FLOW (sim, event->header.flow);
+  gboolean send_feedback;
+
+  if (!flow->receiver)
+    flow->receiver = tfrc_receiver_new (sim->now);
+
+  send_feedback = tfrc_receiver_got_packet (flow->receiver, event->ts,
+      sim->now, event->seqnum, event->rtt, SIM_PACKET_SIZE);
+  if (sim->now / SIM_BIN < sim->n_bins)
+    sim->received_bins[event->header.flow][sim->now / SIM_BIN] +=
+        SIM_PACKET_SIZE;
+
+  if (event->rtt && flow->last_rtt == 0)
+    sim_receiver_timer_func (sim, event->header.flow);
+
+  flow->last_ts = event->ts;
+  flow->last_now = sim->now;
+  flow->last_rtt = event->rtt;
+
+  if (send_feedback)
+    sim_send_feedback (sim, event->header.flow);
+}
+
+static void
+sim_handle_feedback (Sim *sim, TfrcSimEvent *event)
+{
+  SimFlow *flow = SIM_FLOW (sim, event->header.flow);
+  gboolean is_data_limited;
+  guint64 rtt;
+
+  /* Reordered, FsRtpTfrc ignores them too */
+  if (event->ts < flow->fb_last_ts)
+    return;
+  flow->fb_last_ts = event->ts;
+
+  rtt = sim->now - event->ts - event->delay;
+  if (rtt == 0)
+    rtt = 1;
+
+  if (tfrc_sender_get_averaged_rtt (flow->sender) == 0)
+    tfrc_sender_on_first_rtt (flow->sender, sim->now);
+
+  is_data_limited = tfrc_send_log_is_data_limited (flow->send_log, event->ts,
+      tfrc_sender_get_averaged_rtt (flow->sender));
+
+  tfrc_sender_sync_send_log (flow->sender, flow->send_log);
+  tfrc_sender_on_feedback_packet (flow->sender, sim->now, rtt,
+      event->receive_rate, event->loss_event_rate, is_data_limited);
+
+  sim_update_sender_timer (sim, event->header.flow);
+  sim_schedule_send (sim, event->header.flow);
+}
+
+static void
+sim_start (Sim *sim)
+{
+  guint i;
+
+  for (i = 0; i < sim->scenario->flows; i++)
+  {
+    SIM_FLOW (sim, i)->send_expiry = i * sim->scenario->flow_spacing;
+    sim_push_simple_event (sim, EVENT_SEND, i, SIM_FLOW (sim, i)->send_expiry);
+  }
+}
+
+static void
+sim_handle_event (Sim *sim, SimEvent *event)
+{
+  SimFlow *flow = SIM_FLOW (sim, event->flow);
+
+  switch (event->type)
+  {
+    case EVENT_SEND:
+      if (flow->send_expiry != event->time)
+        break;
+      sim_handle_send (sim, event->flow);
+      sim->packets++;
+      break;
+    case EVENT_RECEIVE:
+      sim_handle_receive (sim, (TfrcSimEvent *) event);
+      break;
+    case EVENT_FEEDBACK:
+      sim_handle_feedback (sim, (TfrcSimEvent *) event);
+      break;
+    case EVENT_NOFEEDBACK_TIMER:
+      if (flow->nofeedback_expiry == event->time)
+      {
+        sim_update_sender_timer (sim, event->flow);
+        sim_schedule_send (sim, event->flow);
+      }
+      break;
+    case EVENT_FEEDBACK_TIMER:
+      if (flow->feedback_expiry == event->time)
+        sim_receiver_timer_func (sim, event->flow);
+      break;
+  }
+}
+
+static void
+sim_stop (Sim *sim)
+{
+  guint i;
+
+  for (i = 0; i < sim->scenario->flows; i++)
+  {
+    SimFlow *flow = SIM_FLOW (sim, i);
+
+    if (flow->sender)
+    {
+      tfrc_sender_free (flow->sender);
+      tfrc_send_log_free (flow->send_log);
+    }
+    if (flow->receiver)
+      tfrc_receiver_free (flow->receiver);
+  }
+}
+
+static const SimHarness tfrc_harness = {
+  "tfrc-sim", sizeof (TfrcSimEvent), sim_start, sim_handle_event, sim_stop
+};
+
+static void
+run_scenario (const SimScenario *scenario, SimResults *results)
+{
+  SimFlow flows[SIM_MAX_FLOWS] = { { 0 } };
+
+  sim_run_scenario (&tfrc_harness, scenario, flows, results);
+}
+
+static void
+check_scenario (const SimScenario *scenario)
+{
+  SimFlow flows[SIM_MAX_FLOWS] = { { 0 } };
+
+  sim_check_scenario (&tfrc_harness, scenario, flows);
+}
+
+/* 1 Mbit/s, 100ms RTT */
+static const SimStep single_steps[] = {
+  { 0, 125000, 50 * 1000, 0 },
+  { G_MAXUINT64 }
+};
+
+static const SimScenario single_scenario = {
+  "single", 1, 0, 600 * SIM_SECOND, 25000, single_steps, 0,
+  10, 0, 0.1, 0.9
+};
+
+GST_START_TEST (test_tfrcsim_single)
+{
+  check_scenario (&single_scenario);
+}
+GST_END_TEST;
+
+/*
+ * The same link with a second of buffer, TFRC only slows down when it
+ * overflows, see the deep-buffer scenario of gcc-sim.c for comparison
+ */
+static const SimScenario deep_buffer_scenario = {
+  "deep-buffer", 1, 0, 600 * SIM_SECOND, 125000, single_steps, 0,
+  10, 0, 0.1, 0.9
+};
+
+GST_START_TEST (test_tfrcsim_deep_buffer)
+{
+  check_scenario (&deep_buffer_scenario);
+}
+GST_END_TEST;
+
+/* 4 Mbit/s, 80ms RTT, flows starting 20 seconds apart */
+static const SimStep fairness_steps[] = {
+  { 0, 500000, 40 * 1000, 0 },
+  { G_MAXUINT64 }
+};
+
+static const SimScenario fairness_scenario = {
+  "fairness", 4, 20 * SIM_SECOND, 1000 * SIM_SECOND, 40000, fairness_steps,
+  0, 30, 0.95, 0.3, 0.9
+};
+
+GST_START_TEST (test_tfrcsim_fairness)
+{
+  check_scenario (&fairness_scenario);
+}
+GST_END_TEST;
+
+/* 2 Mbit/s down to 500 kbit/s and back */
+static const SimStep rate_change_steps[] = {
+  { 0, 250000, 30 * 1000, 0 },
+  { 200 * SIM_SECOND, 62500, 30 * 1000, 0 },
+  { 400 * SIM_SECOND, 250000, 30 * 1000, 0 },
+  { G_MAXUINT64 }
+};
+
+static const SimScenario rate_change_scenario = {
+  "rate-change", 2, 5 * SIM_SECOND, 800 * SIM_SECOND, 30000,
+  rate_change_steps, 0, 15, 0.95, 0.3, 0.9
+};
+
+GST_START_TEST (test_tfrcsim_rate_change)
+{
+  check_scenario (&rate_change_scenario);
+}
+GST_END_TEST;
+
+/*
+ * A fast link with 1% random loss, the rate is then limited by the TCP
+ * throughput equation: s / (R * (sqrt(2*p/3) + 12*sqrt(3*p/8)*p*(1+32*p^2)))
+ * which is about 135 kB/s for 1200 bytes packets and a 100ms RTT.
+ */
+static const SimStep random_loss_steps[] = {
+  { 0, 2500000, 50 * 1000, 0.01 },
+  { G_MAXUINT64 }
+};
+
+static const SimScenario random_loss_scenario = {
+  "random-loss", 1, 0, 600 * SIM_SECOND, 250000, random_loss_steps, 135000,
+  30, 0, 0.4, 0.8, 1.2
+};
+
+GST_START_TEST (test_tfrcsim_random_loss)
+{
+  check_scenario (&random_loss_scenario);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_tfrcsim_deterministic)
+{
+  SimResults first = { 0 }, second = { 0 };
+
+  run_scenario (&fairness_scenario, &first);
+  run_scenario (&fairness_scenario, &second);
+
+  fail_unless (first.packets == second.packets &&
+      first.convergence == second.convergence &&
+      first.fairness == second.fairness &&
+      first.oscillation == second.oscillation &&
+      first.utilisation == second.utilisation,
+      "Two runs of the same scenario gave different results");
+}
+GST_END_TEST;
+
+static Suite *
+tfrcsim_suite (void)
+{
+  Suite *s = suite_create ("tfrcsim");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("tfrc_sim_single");
+  tcase_add_test (tc_chain, test_tfrcsim_single);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_sim_deep_buffer");
+  tcase_add_test (tc_chain, test_tfrcsim_deep_buffer);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_sim_fairness");
+  tcase_add_test (tc_chain, test_tfrcsim_fairness);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_sim_rate_change");
+  tcase_add_test (tc_chain, test_tfrcsim_rate_change);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_sim_random_loss");
+  tcase_add_test (tc_chain, test_tfrcsim_random_loss);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("tfrc_sim_deterministic");
+  tcase_add_test (tc_chain, test_tfrcsim_deterministic);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tfrcsim);
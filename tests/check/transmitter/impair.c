@@ -0,0 +1,613 @@
+/* Farstream unit tests for FsImpairTransmitter
+ *
+ * Copyright (C) 2026 Collabora Ltd
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <farstream/fs-transmitter.h>
+#include <farstream/fs-conference.h>
+#include <farstream/fs-plugin.h>
+
+#include "check-threadsafe.h"
+#include "generic.h"
+
+#include "fs-impair-model.h"
+
+gint buffer_count[2] = {0, 0};
+gint other_buffer_count = 0;
+GList *local_cands = NULL;
+
+GMutex test_mutex;
+GCond cond;
+gboolean done = FALSE;
+gint64 first_buffer_time = 0;
+
+static FsImpairModel *
+new_model (const gchar *description, guint stream_id)
+{
+  GstStructure *s = gst_structure_from_string (description, NULL);
+  GError *error = NULL;
+  FsImpairModel *model;
+
+  ts_fail_unless (s != NULL, "Could not parse %s", description);
+
+  model = fs_impair_model_new (s, stream_id, &error);
+  gst_structure_free (s);
+
+  if (error)
+    ts_fail ("Could not build model from %s: %s", description,
+        error->message);
+  ts_fail_unless (model != NULL);
+
+  return model;
+}
+
+static void
+check_invalid (const gchar *description)
+{
+  GstStructure *s = gst_structure_from_string (description, NULL);
+  GError *error = NULL;
+
+  ts_fail_unless (s != NULL, "Could not parse %s", description);
+  ts_fail_unless (fs_impair_model_new (s, 0, &error) == NULL,
+      "%s was accepted", description);
+  ts_fail_unless (error && error->domain == FS_ERROR &&
+      error->code == FS_ERROR_INVALID_ARGUMENTS);
+  g_clear_error (&error);
+  gst_structure_free (s);
+}
+
+GST_START_TEST (test_impair_model_invalid)
+{
+  check_invalid ("impairment, lost=(double)0.1");
+  check_invalid ("impairment, loss=(double)1.5");
+  check_invalid ("impairment, delay=(int)-5");
+  check_invalid ("impairment, loss-burst=(double)0.5");
+  check_invalid ("impairment, bandwidth-trace=(string)\"100:1000\"");
+  check_invalid ("impairment, bandwidth-trace=(string)\"0:1000;0:2000\"");
+  check_invalid ("impairment, bandwidth-trace=(string)\"0:1000;x\"");
+  check_invalid ("impairment, bandwidth-trace=(int)5");
+}
+GST_END_TEST;
+
+GST_START_TEST (test_impair_model_deterministic)
+{
+  const gchar *description = "impairment, seed=(uint)42, loss=(double)0.1,"
+    " delay=(uint)20, jitter=(uint)5, reorder=(double)0.05";
+  FsImpairModel *a = new_model (description, 2);
+  FsImpairModel *b = new_model (description, 2);
+  FsImpairModel *other = new_model (description, 3);
+  gboolean differs = FALSE;
+  guint i;
+
+  for (i = 0; i < 10000; i++)
+  {
+    GstClockTime t = i * GST_MSECOND;
+    GstClockTime da = 0, db = 0, dother = 0;
+    gboolean ka, kb, kother;
+
+    ka = fs_impair_model_process (a, 100, t, &da);
+    kb = fs_impair_model_process (b, 100, t, &db);
+    kother = fs_impair_model_process (other, 100, t, &dother);
+
+    ts_fail_unless (ka == kb, "Packet %u kept by only one model", i);
+    if (ka)
+      ts_fail_unless (da == db, "Packet %u has different departures", i);
+
+    if (ka != kother || (ka && da != dother))
+      differs = TRUE;
+  }
+
+  ts_fail_unless (fs_impair_model_get_dropped (a) ==
+      fs_impair_model_get_dropped (b));
+  ts_fail_unless (differs,
+      "Models of different streams draw the same sequence");
+
+  fs_impair_model_free (a);
+  fs_impair_model_free (b);
+  fs_impair_model_free (other);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_impair_model_loss)
+{
+  FsImpairModel *independent = new_model (
+      "impairment, seed=(uint)1, loss=(double)0.2", 0);
+  FsImpairModel *bursty = new_model (
+      "impairment, seed=(uint)1, loss=(double)0.2, loss-burst=(double)4", 0);
+  guint i, bursts = 0;
+  gboolean was_lost = FALSE;
+  gdouble rate;
+  GstClockTime d;
+
+  for (i = 0; i < 100000; i++)
+  {
+    gboolean lost;
+
+    fs_impair_model_process (independent, 100, i * GST_MSECOND, &d);
+
+    lost = !fs_impair_model_process (bursty, 100, i * GST_MSECOND, &d);
+    if (lost && !was_lost)
+      bursts++;
+    was_lost = lost;
+  }
+
+  rate = fs_impair_model_get_dropped (independent) / 100000.0;
+  ts_fail_unless (rate > 0.19 && rate < 0.21, "Loss rate is %f", rate);
+
+  rate = fs_impair_model_get_dropped (bursty) / 100000.0;
+  ts_fail_unless (rate > 0.18 && rate < 0.22, "Burst loss rate is %f", rate);
+
+  /* The mean burst length is 4 */
+  rate = (gdouble) fs_impair_model_get_dropped (bursty) / bursts;
+  ts_fail_unless (rate > 3.5 && rate < 4.5, "Mean burst length is %f", rate);
+
+  fs_impair_model_free (independent);
+  fs_impair_model_free (bursty);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_impair_model_bandwidth)
+{
+  /* 100 kB/s, so a 1000 bytes packet takes 10ms */
+  FsImpairModel *model = new_model (
+      "impairment, bandwidth=(uint)800000, queue-size=(uint)5000", 0);
+  GstClockTime d;
+  guint i;
+
+  for (i = 0; i < 5; i++)
+  {
+    ts_fail_unless (fs_impair_model_process (model, 1000, 0, &d));
+    ts_fail_unless (d == (i + 1) * 10 * GST_MSECOND,
+        "Packet %u leaves at %" GST_TIME_FORMAT, i, GST_TIME_ARGS (d));
+  }
+
+  /* The queue is full */
+  ts_fail_if (fs_impair_model_process (model, 1000, 0, &d));
+
+  /* It has drained */
+  ts_fail_unless (fs_impair_model_process (model, 1000, 100 * GST_MSECOND,
+          &d));
+  ts_fail_unless (d == 110 * GST_MSECOND);
+
+  fs_impair_model_free (model);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_impair_model_trace)
+{
+  FsImpairModel *model = new_model ("impairment,"
+      " bandwidth-trace=(string)\"0:800000;100:0;200:80000\"", 0);
+  GstClockTime d;
+
+  ts_fail_unless (fs_impair_model_process (model, 1000, 0, &d));
+  ts_fail_unless (d == 10 * GST_MSECOND);
+
+  ts_fail_unless (fs_impair_model_process (model, 1000, 50 * GST_MSECOND,
+          &d));
+  ts_fail_unless (d == 60 * GST_MSECOND);
+
+  /* Outage */
+  ts_fail_if (fs_impair_model_process (model, 1000, 150 * GST_MSECOND, &d));
+
+  /* 10 kB/s */
+  ts_fail_unless (fs_impair_model_process (model, 1000, 250 * GST_MSECOND,
+          &d));
+  ts_fail_unless (d == 350 * GST_MSECOND);
+
+  fs_impair_model_free (model);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_impair_model_delay)
+{
+  FsImpairModel *model = new_model (
+      "impairment, seed=(uint)5, delay=(uint)50, jitter=(uint)10", 0);
+  GstClockTime d, last = 0;
+  guint i;
+
+  for (i = 0; i < 1000; i++)
+  {
+    GstClockTime t = i * 20 * GST_MSECOND;
+
+    ts_fail_unless (fs_impair_model_process (model, 100, t, &d));
+    ts_fail_unless (d >= last, "Packet %u was reordered", i);
+    ts_fail_unless (d >= t + 40 * GST_MSECOND && d <= t + 60 * GST_MSECOND,
+        "Packet %u has a delay of %" GST_TIME_FORMAT, i,
+        GST_TIME_ARGS (d - t));
+    last = d;
+  }
+
+  fs_impair_model_free (model);
+}
+GST_END_TEST;
+
+/* Like fs_transmitter_new(), but with the name of the wrapped transmitter */
+static FsTransmitter *
+new_impair_transmitter (const gchar *wrapped, GError **error)
+{
+  FsTransmitter *trans = FS_TRANSMITTER (fs_plugin_create ("impair",
+          "transmitter", error,
+          "components", 2,
+          "tos", 0,
+          "transmitter", wrapped,
+          NULL));
+
+  if (trans && trans->construction_error)
+  {
+    g_propagate_error (error, trans->construction_error);
+    trans->construction_error = NULL;
+    g_object_unref (trans);
+    trans = NULL;
+  }
+
+  return trans;
+}
+
+GST_START_TEST (test_impairtransmitter_new)
+{
+  GError *error = NULL;
+  FsTransmitter *trans;
+  gchar *wrapped = NULL;
+
+  /* Wraps rawudp by default */
+  test_transmitter_creation ("impair");
+
+  trans = new_impair_transmitter ("inproc", &error);
+  ts_fail_unless (trans != NULL);
+  ts_fail_unless (error == NULL);
+  g_object_get (trans, "transmitter", &wrapped, NULL);
+  ts_fail_unless (!g_strcmp0 (wrapped, "inproc"));
+  g_free (wrapped);
+  g_object_unref (trans);
+
+  trans = new_impair_transmitter ("doesnotexist", &error);
+  ts_fail_unless (trans == NULL);
+  ts_fail_unless (error != NULL);
+  g_clear_error (&error);
+}
+GST_END_TEST;
+
+static void
+_new_local_candidate (FsStreamTransmitter *st, FsCandidate *candidate,
+  gpointer user_data)
+{
+  local_cands = g_list_append (local_cands, fs_candidate_copy (candidate));
+}
+
+static void
+_handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
+  gpointer user_data)
+{
+  gint component_id = GPOINTER_TO_INT (user_data);
+
+  ts_fail_unless (gst_buffer_get_size (buffer) == component_id * 10,
+    "Buffer is size %d but component_id is %d", gst_buffer_get_size (buffer),
+    component_id);
+
+  g_mutex_lock (&test_mutex);
+  if (!first_buffer_time)
+    first_buffer_time = g_get_monotonic_time ();
+
+  buffer_count[component_id-1]++;
+
+  ts_fail_if (buffer_count[component_id-1] > 20,
+    "Too many buffers %d > 20 for component",
+    buffer_count[component_id-1], component_id);
+
+  if (buffer_count[0] == 20 && buffer_count[1] == 20) {
+    done = TRUE;
+    g_cond_signal (&cond);
+  }
+  g_mutex_unlock (&test_mutex);
+}
+
+static FsStreamTransmitter *
+new_stream_transmitter (FsTransmitter *trans, const gchar *impairment,
+    GError **error)
+{
+  GParameter params[1];
+  FsStreamTransmitter *st;
+
+  if (!impairment)
+    return fs_transmitter_new_stream_transmitter (trans, NULL, 0, NULL,
+        error);
+
+  memset (params, 0, sizeof (GParameter));
+  params[0].name = "send-impairment";
+  g_value_init (&params[0].value, GST_TYPE_STRUCTURE);
+  g_value_take_boxed (&params[0].value,
+      gst_structure_from_string (impairment, NULL));
+
+  st = fs_transmitter_new_stream_transmitter (trans, NULL, 1, params, error);
+
+  g_value_unset (&params[0].value);
+
+  return st;
+}
+
+GST_START_TEST (test_impairtransmitter_invalid_parameter)
+{
+  GError *error = NULL;
+  FsTransmitter *trans;
+
+  trans = new_impair_transmitter ("inproc", &error);
+  ts_fail_unless (trans != NULL);
+
+  ts_fail_unless (new_stream_transmitter (trans,
+          "impairment, lost=(double)0.5", &error) == NULL);
+  ts_fail_unless (error && error->domain == FS_ERROR &&
+      error->code == FS_ERROR_INVALID_ARGUMENTS);
+  g_clear_error (&error);
+
+  g_object_unref (trans);
+}
+GST_END_TEST;
+
+/*
+ * Sends through impair wrapping inproc with a delay on the send side and checks
+ * that everything arrives, late enough.
+ */
+
+GST_START_TEST (test_impairtransmitter_delay)
+{
+  GError *error = NULL;
+  FsTransmitter *trans_send, *trans_recv;
+  FsStreamTransmitter *st_send, *st_recv;
+  GstElement *pipeline_send, *pipeline_recv;
+  gint64 start;
+
+  done = FALSE;
+  first_buffer_time = 0;
+  buffer_count[0] = buffer_count[1] = 0;
+  local_cands = NULL;
+  g_cond_init (&cond);
+  g_mutex_init (&test_mutex);
+
+  trans_send = new_impair_transmitter ("inproc", &error);
+  ts_fail_unless (trans_send != NULL);
+  trans_recv = fs_transmitter_new ("inproc", 2, 0, &error);
+  ts_fail_unless (trans_recv != NULL);
+
+  pipeline_send = setup_pipeline (trans_send, NULL);
+  pipeline_recv = setup_pipeline (trans_recv, G_CALLBACK (_handoff_handler));
+
+  st_send = new_stream_transmitter (trans_send,
+      "impairment, delay=(uint)200, jitter=(uint)20", &error);
+  if (error)
+    ts_fail ("Could not create stream transmitter: %s", error->message);
+  st_recv = new_stream_transmitter (trans_recv, NULL, &error);
+  ts_fail_unless (st_recv != NULL);
+
+  g_signal_connect (st_send, "new-local-candidate",
+      G_CALLBACK (_new_local_candidate), NULL);
+  g_signal_connect (st_recv, "error", G_CALLBACK (stream_transmitter_error),
+      NULL);
+
+  ts_fail_unless (fs_stream_transmitter_gather_local_candidates (st_send,
+          &error));
+  ts_fail_unless (g_list_length (local_cands) == 2);
+
+  ts_fail_if (gst_element_set_state (pipeline_send, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+  ts_fail_if (gst_element_set_state (pipeline_recv, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  ts_fail_unless (fs_stream_transmitter_force_remote_candidates (st_recv,
+          local_cands, &error));
+
+  start = g_get_monotonic_time ();
+  setup_fakesrc (trans_send, pipeline_send, 1);
+  setup_fakesrc (trans_send, pipeline_send, 2);
+
+  g_mutex_lock (&test_mutex);
+  while (!done)
+    g_cond_wait (&cond, &test_mutex);
+  g_mutex_unlock (&test_mutex);
+
+  ts_fail_unless (first_buffer_time - start >= 180 * G_TIME_SPAN_MILLISECOND,
+      "The first buffer arrived after only %" G_GINT64_FORMAT "us",
+      first_buffer_time - start);
+
+  gst_element_set_state (pipeline_send, GST_STATE_NULL);
+  gst_element_set_state (pipeline_recv, GST_STATE_NULL);
+
+  fs_stream_transmitter_stop (st_recv);
+  g_object_unref (st_recv);
+  fs_stream_transmitter_stop (st_send);
+  g_object_unref (st_send);
+
+  g_object_unref (trans_recv);
+  g_object_unref (trans_send);
+
+  gst_object_unref (pipeline_recv);
+  gst_object_unref (pipeline_send);
+
+  fs_candidate_list_destroy (local_cands);
+  local_cands = NULL;
+
+  g_cond_clear (&cond);
+  g_mutex_clear (&test_mutex);
+}
+GST_END_TEST;
+
+static void
+_other_handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
+  gpointer user_data)
+{
+  g_mutex_lock (&test_mutex);
+  other_buffer_count++;
+  g_mutex_unlock (&test_mutex);
+}
+
+static FsStreamTransmitter *
+new_receiver (FsTransmitter *trans, FsStreamTransmitter *st_send)
+{
+  FsStreamTransmitter *st_recv;
+  GError *error = NULL;
+
+  local_cands = NULL;
+  g_signal_connect (st_send, "new-local-candidate",
+      G_CALLBACK (_new_local_candidate), NULL);
+  ts_fail_unless (fs_stream_transmitter_gather_local_candidates (st_send,
+          &error));
+  ts_fail_unless (g_list_length (local_cands) == 2);
+
+  st_recv = new_stream_transmitter (trans, NULL, &error);
+  ts_fail_unless (st_recv != NULL);
+  g_signal_connect (st_recv, "error", G_CALLBACK (stream_transmitter_error),
+      NULL);
+  ts_fail_unless (fs_stream_transmitter_force_remote_candidates (st_recv,
+          local_cands, &error));
+
+  fs_candidate_list_destroy (local_cands);
+  local_cands = NULL;
+
+  return st_recv;
+}
+
+/*
+ * Two streams of the same transmitter, only one of them loses everything
+ * it sends, so the other one's receiver gets all the buffers.
+ */
+
+GST_START_TEST (test_impairtransmitter_per_stream)
+{
+  GError *error = NULL;
+  FsTransmitter *trans_send, *trans_recv, *trans_lost;
+  FsStreamTransmitter *st_send, *st_lossy, *st_recv, *st_lost;
+  GstElement *pipeline_send, *pipeline_recv, *pipeline_lost;
+  GstStructure *impairment = NULL;
+
+  done = FALSE;
+  first_buffer_time = 0;
+  buffer_count[0] = buffer_count[1] = 0;
+  other_buffer_count = 0;
+  g_cond_init (&cond);
+  g_mutex_init (&test_mutex);
+
+  trans_send = new_impair_transmitter ("inproc", &error);
+  ts_fail_unless (trans_send != NULL);
+  trans_recv = fs_transmitter_new ("inproc", 2, 0, &error);
+  ts_fail_unless (trans_recv != NULL);
+  trans_lost = fs_transmitter_new ("inproc", 2, 0, &error);
+  ts_fail_unless (trans_lost != NULL);
+
+  pipeline_send = setup_pipeline (trans_send, NULL);
+  pipeline_recv = setup_pipeline (trans_recv, G_CALLBACK (_handoff_handler));
+  pipeline_lost = setup_pipeline (trans_lost,
+      G_CALLBACK (_other_handoff_handler));
+
+  st_send = new_stream_transmitter (trans_send, NULL, &error);
+  ts_fail_unless (st_send != NULL);
+  st_lossy = new_stream_transmitter (trans_send,
+      "impairment, loss=(double)1.0", &error);
+  ts_fail_unless (st_lossy != NULL);
+
+  /* The parameter only applies to its stream */
+  g_object_get (trans_send, "send-impairment", &impairment, NULL);
+  ts_fail_unless (impairment == NULL);
+
+  st_recv = new_receiver (trans_recv, st_send);
+  st_lost = new_receiver (trans_lost, st_lossy);
+
+  ts_fail_if (gst_element_set_state (pipeline_send, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+  ts_fail_if (gst_element_set_state (pipeline_recv, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+  ts_fail_if (gst_element_set_state (pipeline_lost, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  setup_fakesrc (trans_send, pipeline_send, 1);
+  setup_fakesrc (trans_send, pipeline_send, 2);
+
+  g_mutex_lock (&test_mutex);
+  while (!done)
+    g_cond_wait (&cond, &test_mutex);
+  ts_fail_unless (other_buffer_count == 0,
+      "The lossy stream delivered %d buffers", other_buffer_count);
+  g_mutex_unlock (&test_mutex);
+
+  gst_element_set_state (pipeline_send, GST_STATE_NULL);
+  gst_element_set_state (pipeline_recv, GST_STATE_NULL);
+  gst_element_set_state (pipeline_lost, GST_STATE_NULL);
+
+  fs_stream_transmitter_stop (st_recv);
+  g_object_unref (st_recv);
+  fs_stream_transmitter_stop (st_lost);
+  g_object_unref (st_lost);
+  fs_stream_transmitter_stop (st_send);
+  g_object_unref (st_send);
+  fs_stream_transmitter_stop (st_lossy);
+  g_object_unref (st_lossy);
+
+  g_object_unref (trans_lost);
+  g_object_unref (trans_recv);
+  g_object_unref (trans_send);
+
+  gst_object_unref (pipeline_lost);
+  gst_object_unref (pipeline_recv);
+  gst_object_unref (pipeline_send);
+
+  g_cond_clear (&cond);
+  g_mutex_clear (&test_mutex);
+}
+GST_END_TEST;
+
+
+static Suite *
+impairtransmitter_suite (void)
+{
+  Suite *s = suite_create ("impairtransmitter");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("impair_model");
+  tcase_add_test (tc_chain, test_impair_model_invalid);
+  tcase_add_test (tc_chain, test_impair_model_deterministic);
+  tcase_add_test (tc_chain, test_impair_model_loss);
+  tcase_add_test (tc_chain, test_impair_model_bandwidth);
+  tcase_add_test (tc_chain, test_impair_model_trace);
+  tcase_add_test (tc_chain, test_impair_model_delay);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("impairtransmitter_new");
+  tcase_add_test (tc_chain, test_impairtransmitter_new);
+  tcase_add_test (tc_chain, test_impairtransmitter_invalid_parameter);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("impairtransmitter_delay");
+  tcase_add_test (tc_chain, test_impairtransmitter_delay);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("impairtransmitter_per_stream");
+  tcase_add_test (tc_chain, test_impairtransmitter_per_stream);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+
+GST_CHECK_MAIN (impairtransmitter);
@@ -0,0 +1,415 @@
+/* Farstream unit tests for FsInprocTransmitter
+ *
+ * Copyright (C) 2026 Collabora Ltd
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <farstream/fs-transmitter.h>
+#include <farstream/fs-conference.h>
+
+#include "check-threadsafe.h"
+#include "generic.h"
+
+gint buffer_count[2] = {0, 0};
+guint received_known[2] = {0, 0};
+GList *local_cands = NULL;
+gboolean got_prepared;
+
+GMutex test_mutex;
+GCond cond;
+gboolean done = FALSE;
+guint connected_count;
+
+
+enum {
+  FLAG_NOT_SENDING = 1 << 3,
+  FLAG_LOCAL_CANDIDATES = 1 << 5
+};
+
+GST_START_TEST (test_inproctransmitter_new)
+{
+  gchar **transmitters;
+  gint i;
+  gboolean found_it = FALSE;
+
+  transmitters = fs_transmitter_list_available ();
+  for (i=0; transmitters[i]; i++)
+  {
+    if (!strcmp ("inproc", transmitters[i]))
+    {
+      found_it = TRUE;
+      break;
+    }
+  }
+  g_strfreev (transmitters);
+
+  ts_fail_unless (found_it, "Did not find inproc transmitter");
+
+  test_transmitter_creation ("inproc");
+  test_transmitter_creation ("inproc");
+}
+GST_END_TEST;
+
+static void
+_new_local_candidate (FsStreamTransmitter *st, FsCandidate *candidate,
+  gpointer user_data)
+{
+  ts_fail_if (candidate == NULL, "Passed NULL candidate");
+  ts_fail_unless (candidate->ip != NULL, "Null name in candidate");
+  ts_fail_unless (candidate->type == FS_CANDIDATE_TYPE_HOST,
+      "Candidate is not host");
+
+  if (GPOINTER_TO_INT (user_data) & FLAG_LOCAL_CANDIDATES)
+    ts_fail_unless (!strcmp (candidate->ip,
+            candidate->component_id == 1 ? "inproc-test-rtp" :
+            "inproc-test-rtcp"), "Preferred name %s not used", candidate->ip);
+
+  GST_DEBUG ("New local candidate %s for component %d",
+      candidate->ip, candidate->component_id);
+
+  local_cands = g_list_append (local_cands, fs_candidate_copy (candidate));
+}
+
+static void
+_candidate_prepared (FsStreamTransmitter *st, gpointer user_data)
+{
+  ts_fail_unless (g_list_length (local_cands) == 2);
+  got_prepared = TRUE;
+}
+
+static void
+_state_changed (FsStreamTransmitter *st, guint component_id,
+    FsStreamState state, gpointer user_data)
+{
+  g_mutex_lock (&test_mutex);
+  connected_count++;
+  g_mutex_unlock (&test_mutex);
+  g_cond_signal (&cond);
+}
+
+static void
+_handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
+  gpointer user_data)
+{
+  gint component_id = GPOINTER_TO_INT (user_data);
+
+  ts_fail_unless (gst_buffer_get_size (buffer) == component_id * 10,
+    "Buffer is size %d but component_id is %d", gst_buffer_get_size (buffer),
+    component_id);
+
+  buffer_count[component_id-1]++;
+
+  ts_fail_if (buffer_count[component_id-1] > 20,
+    "Too many buffers %d > 20 for component",
+    buffer_count[component_id-1], component_id);
+
+  if (buffer_count[0] == 20 && buffer_count[1] == 20) {
+    GST_DEBUG ("Test complete, got 20 buffers twice");
+    ts_fail_unless (buffer_count[0] == received_known[0] &&
+        buffer_count[1] == received_known[1], "Some known buffers from known"
+        " sources have not been reported (%d != %u || %d != %u)",
+        buffer_count[0], received_known[0],
+        buffer_count[1], received_known[1]);
+
+    g_mutex_lock (&test_mutex);
+    done = TRUE;
+    g_mutex_unlock (&test_mutex);
+    g_cond_signal (&cond);
+  }
+}
+
+static void
+_known_source_packet_received (FsStreamTransmitter *st, guint component_id,
+    GstBuffer *buffer, gpointer user_data)
+{
+  ts_fail_unless (component_id == 1 || component_id == 2,
+      "Invalid component id %u", component_id);
+
+  received_known[component_id - 1]++;
+}
+
+static void
+sync_error_handler (GstBus *bus, GstMessage *message, gpointer blob)
+{
+  GError *error = NULL;
+  gchar *debug;
+  gst_message_parse_error (message, &error, &debug);
+  g_error ("bus sync error %s debug: %s", error->message, debug);
+}
+
+static GstElement *
+setup_inproc_pipeline (FsTransmitter *trans, GCallback cb)
+{
+  GstElement *pipeline = setup_pipeline (trans, cb);
+  GstBus *bus = gst_element_get_bus (pipeline);
+
+  gst_bus_enable_sync_message_emission (bus);
+  g_signal_connect (bus, "sync-message::error",
+      G_CALLBACK (sync_error_handler), NULL);
+  gst_object_unref (bus);
+
+  return pipeline;
+}
+
+static FsTransmitter *
+new_inproc_transmitter (void)
+{
+  GError *error = NULL;
+  FsTransmitter *trans;
+
+  trans = fs_transmitter_new ("inproc", 2, 0, &error);
+
+  if (error)
+    ts_fail ("Error creating transmitter: (%s:%d) %s",
+      g_quark_to_string (error->domain), error->code, error->message);
+  ts_fail_if (trans == NULL, "No transmitter create, yet error is still NULL");
+
+  return trans;
+}
+
+/*
+ * One conference sends to another through two transmitters that each have
+ * their own pipeline
+ */
+
+static void
+run_inproc_transmitter_test (gint flags)
+{
+  GError *error = NULL;
+  FsTransmitter *trans_send, *trans_recv;
+  FsStreamTransmitter *st_send, *st_recv;
+  GstElement *pipeline_send, *pipeline_recv;
+  GParameter params[1];
+  int param_count = 0;
+  gboolean ret;
+
+  done = FALSE;
+  connected_count = 0;
+  got_prepared = FALSE;
+  local_cands = NULL;
+  g_cond_init (&cond);
+  g_mutex_init (&test_mutex);
+
+  buffer_count[0] = 0;
+  buffer_count[1] = 0;
+  received_known[0] = 0;
+  received_known[1] = 0;
+
+  if (flags & FLAG_LOCAL_CANDIDATES)
+  {
+    GList *preferred = NULL;
+
+    preferred = g_list_append (preferred, fs_candidate_new (NULL, 1,
+            FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP,
+            "inproc-test-rtp", 0));
+    preferred = g_list_append (preferred, fs_candidate_new (NULL, 2,
+            FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP,
+            "inproc-test-rtcp", 0));
+
+    memset (params, 0, sizeof (GParameter));
+
+    params[0].name = "preferred-local-candidates";
+    g_value_init (&params[0].value, FS_TYPE_CANDIDATE_LIST);
+    g_value_take_boxed (&params[0].value, preferred);
+
+    param_count = 1;
+  }
+
+  if (flags & FLAG_NOT_SENDING)
+  {
+    buffer_count[0] = 20;
+    received_known[0] = 20;
+  }
+
+  trans_send = new_inproc_transmitter ();
+  trans_recv = new_inproc_transmitter ();
+
+  pipeline_send = setup_inproc_pipeline (trans_send, NULL);
+  pipeline_recv = setup_inproc_pipeline (trans_recv,
+      G_CALLBACK (_handoff_handler));
+
+  st_send = fs_transmitter_new_stream_transmitter (trans_send, NULL,
+      param_count, params, &error);
+  if (param_count)
+    g_value_unset (&params[0].value);
+  ts_fail_if (st_send == NULL, "No stream transmitter created");
+  ts_fail_unless (error == NULL);
+
+  st_recv = fs_transmitter_new_stream_transmitter (trans_recv, NULL, 0, NULL,
+      &error);
+  ts_fail_if (st_recv == NULL, "No stream transmitter created");
+  ts_fail_unless (error == NULL);
+
+  g_object_set (st_send, "sending", !(flags & FLAG_NOT_SENDING), NULL);
+
+  ts_fail_unless (g_signal_connect (st_send, "new-local-candidate",
+      G_CALLBACK (_new_local_candidate), GINT_TO_POINTER (flags)),
+    "Could not connect new-local-candidate signal");
+  ts_fail_unless (g_signal_connect (st_send, "local-candidates-prepared",
+      G_CALLBACK (_candidate_prepared), NULL),
+    "Could not connect local-candidates-prepared signal");
+  ts_fail_unless (g_signal_connect (st_recv, "error",
+      G_CALLBACK (stream_transmitter_error), NULL),
+    "Could not connect error signal");
+  ts_fail_unless (g_signal_connect (st_recv, "known-source-packet-received",
+      G_CALLBACK (_known_source_packet_received), NULL),
+    "Could not connect known-source-packet-received signal");
+  ts_fail_unless (g_signal_connect (st_recv, "state-changed",
+      G_CALLBACK (_state_changed), NULL),
+    "Could not connect state-changed signal");
+
+  ret = fs_stream_transmitter_gather_local_candidates (st_send, &error);
+  if (error)
+    ts_fail ("Could not gather local candidates (%s:%d) %s",
+        g_quark_to_string (error->domain), error->code, error->message);
+  ts_fail_unless (ret);
+  ts_fail_unless (got_prepared);
+
+  ts_fail_if (gst_element_set_state (pipeline_send, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+  ts_fail_if (gst_element_set_state (pipeline_recv, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  ret = fs_stream_transmitter_force_remote_candidates (st_recv, local_cands,
+      &error);
+  if (error)
+    ts_fail ("Error while adding candidate: (%s:%d) %s",
+        g_quark_to_string (error->domain), error->code, error->message);
+  ts_fail_unless (ret == TRUE, "No detailed error from add_remote_candidate");
+
+  g_mutex_lock (&test_mutex);
+  while (connected_count < 2)
+    g_cond_wait (&cond, &test_mutex);
+  g_mutex_unlock (&test_mutex);
+
+  setup_fakesrc (trans_send, pipeline_send, 1);
+  setup_fakesrc (trans_send, pipeline_send, 2);
+
+  g_mutex_lock (&test_mutex);
+  while (!done)
+    g_cond_wait (&cond, &test_mutex);
+  g_mutex_unlock (&test_mutex);
+
+  gst_element_set_state (pipeline_send, GST_STATE_NULL);
+  gst_element_set_state (pipeline_recv, GST_STATE_NULL);
+
+  fs_stream_transmitter_stop (st_recv);
+  g_object_unref (st_recv);
+  fs_stream_transmitter_stop (st_send);
+  g_object_unref (st_send);
+
+  g_object_unref (trans_recv);
+  g_object_unref (trans_send);
+
+  gst_object_unref (pipeline_recv);
+  gst_object_unref (pipeline_send);
+
+  fs_candidate_list_destroy (local_cands);
+  local_cands = NULL;
+
+  g_cond_clear (&cond);
+  g_mutex_clear (&test_mutex);
+}
+
+GST_START_TEST (test_inproctransmitter_run_basic)
+{
+  run_inproc_transmitter_test (0);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_inproctransmitter_sending_half)
+{
+  run_inproc_transmitter_test (FLAG_NOT_SENDING);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_inproctransmitter_local_cands)
+{
+  run_inproc_transmitter_test (FLAG_LOCAL_CANDIDATES);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_inproctransmitter_unknown_name)
+{
+  GError *error = NULL;
+  FsTransmitter *trans;
+  FsStreamTransmitter *st;
+  GList *cands;
+
+  trans = new_inproc_transmitter ();
+
+  st = fs_transmitter_new_stream_transmitter (trans, NULL, 0, NULL, &error);
+  ts_fail_if (st == NULL, "No stream transmitter created");
+  ts_fail_unless (error == NULL);
+
+  cands = g_list_prepend (NULL, fs_candidate_new (NULL, 1,
+          FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP,
+          "inproc-nobody", 0));
+  ts_fail_if (fs_stream_transmitter_force_remote_candidates (st, cands,
+          &error));
+  ts_fail_unless (error && error->domain == FS_ERROR &&
+      error->code == FS_ERROR_NETWORK);
+  g_clear_error (&error);
+  fs_candidate_list_destroy (cands);
+
+  fs_stream_transmitter_stop (st);
+  g_object_unref (st);
+  g_object_unref (trans);
+}
+GST_END_TEST;
+
+
+static Suite *
+inproctransmitter_suite (void)
+{
+  Suite *s = suite_create ("inproctransmitter");
+  TCase *tc_chain;
+  GLogLevelFlags fatal_mask;
+
+  fatal_mask = g_log_set_always_fatal (G_LOG_FATAL_MASK);
+  fatal_mask |= G_LOG_LEVEL_WARNING | G_LOG_LEVEL_CRITICAL;
+  g_log_set_always_fatal (fatal_mask);
+
+  tc_chain = tcase_create ("inproctransmitter_new");
+  tcase_add_test (tc_chain, test_inproctransmitter_new);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("inproctransmitter_basic");
+  tcase_add_test (tc_chain, test_inproctransmitter_run_basic);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("inproctransmitter-sending-half");
+  tcase_add_test (tc_chain, test_inproctransmitter_sending_half);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("inproctransmitter-local-candidates");
+  tcase_add_test (tc_chain, test_inproctransmitter_local_cands);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("inproctransmitter-unknown-name");
+  tcase_add_test (tc_chain, test_inproctransmitter_unknown_name);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+
+GST_CHECK_MAIN (inproctransmitter);
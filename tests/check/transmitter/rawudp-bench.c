@@ -0,0 +1,376 @@
+/* Farstream loopback throughput benchmark for FsRawUdpTransmitter
+ *
+ * Copyright (C) 2026 Collabora Ltd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <farstream/fs-transmitter.h>
+#include <farstream/fs-conference.h>
+
+#include "check-threadsafe.h"
+#include "generic.h"
+
+/*
+ * Pushes a fixed number of RTP sized packets through a rawudp transmitter
+ * that sends to itself over the loopback interface, once with the classic
+ * udpsrc/multiudpsink pair and once with the batched socket elements, and
+ * prints the packet rate seen on the receiving side.
+ *
+ * The sharded variants instead have many plain sockets, each in its own
+ * thread, send to the port of the transmitter to show how the receive rate
+ * scales with the number of SO_REUSEPORT sockets reading it.
+ *
+ * The loopback can drop packets when the receiving side falls behind, so
+ * nothing is asserted on the rates and "make check" doesn't run it.
+ */
+
+#define BENCH_PACKETS (50000)
+#define BENCH_PACKET_SIZE (200)
+#define BENCH_LIST_SIZE (32)
+#define BENCH_IDLE_TIMEOUT (500 * G_TIME_SPAN_MILLISECOND)
+#define BENCH_SENDERS (8)
+
+static GMainLoop *loop = NULL;
+static volatile gint received = 0;
+static gboolean rtp_ready = FALSE;
+static guint local_port = 0;
+
+struct BenchSender {
+  GSocket *socket;
+  GSocketAddress *dest;
+  guint count;
+};
+
+static void
+_new_local_candidate (FsStreamTransmitter *st, FsCandidate *candidate,
+  gpointer user_data)
+{
+  GError *error = NULL;
+  GList *item = NULL;
+  gboolean ret;
+
+  if (candidate->component_id == FS_COMPONENT_RTP)
+    local_port = candidate->port;
+
+  item = g_list_prepend (NULL, candidate);
+  ret = fs_stream_transmitter_force_remote_candidates (st, item, &error);
+  g_list_free (item);
+
+  if (error)
+    ts_fail ("Error while adding candidate: (%s:%d) %s",
+      g_quark_to_string (error->domain), error->code, error->message);
+
+  ts_fail_unless (ret == TRUE, "No detailed error from add_remote_candidate");
+}
+
+static void
+_new_active_candidate_pair (FsStreamTransmitter *st, FsCandidate *local,
+  FsCandidate *remote, gpointer user_data)
+{
+  if (local->component_id != FS_COMPONENT_RTP)
+    return;
+
+  rtp_ready = TRUE;
+  g_main_loop_quit (loop);
+}
+
+static void
+_handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
+  gpointer user_data)
+{
+  if (GPOINTER_TO_INT (user_data) == FS_COMPONENT_RTP)
+    g_atomic_int_inc (&received);
+}
+
+static GstPad *
+setup_bench_src (FsTransmitter *trans, GstPad **sinkpad)
+{
+  GstElement *trans_sink;
+  GstPad *srcpad;
+  GstSegment segment;
+
+  g_object_get (trans, "gst-sink", &trans_sink, NULL);
+  *sinkpad = gst_element_get_request_pad (trans_sink, "sink_1");
+  ts_fail_if (*sinkpad == NULL, "Could not get the transmitter sink pad");
+  gst_object_unref (trans_sink);
+
+  srcpad = gst_pad_new ("benchsrc", GST_PAD_SRC);
+  gst_pad_set_active (srcpad, TRUE);
+  ts_fail_unless (gst_pad_link (srcpad, *sinkpad) == GST_PAD_LINK_OK,
+      "Could not link to the transmitter sink pad");
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("rawudp-bench"));
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  return srcpad;
+}
+
+static void
+push_packets (GstPad *srcpad)
+{
+  guint pushed = 0;
+
+  while (pushed < BENCH_PACKETS)
+  {
+    GstBufferList *list = gst_buffer_list_new_sized (BENCH_LIST_SIZE);
+    guint i;
+
+    for (i = 0; i < BENCH_LIST_SIZE && pushed < BENCH_PACKETS; i++, pushed++)
+    {
+      GstBuffer *buffer = gst_buffer_new_allocate (NULL, BENCH_PACKET_SIZE,
+          NULL);
+
+      gst_buffer_memset (buffer, 0, 0x80, BENCH_PACKET_SIZE);
+      gst_buffer_list_add (list, buffer);
+    }
+
+    ts_fail_unless (gst_pad_push_list (srcpad, list) == GST_FLOW_OK,
+        "Could not push buffer list");
+  }
+}
+
+static gpointer
+sender_thread (gpointer user_data)
+{
+  struct BenchSender *sender = user_data;
+  gchar buf[BENCH_PACKET_SIZE];
+  guint i;
+
+  memset (buf, 0x80, sizeof (buf));
+
+  for (i = 0; i < sender->count; i++)
+    g_socket_send_to (sender->socket, sender->dest, buf, sizeof (buf), NULL,
+        NULL);
+
+  return NULL;
+}
+
+/* Each sender has its own source port, so its own 5-tuple */
+
+static void
+send_from_many_sockets (guint n_senders)
+{
+  struct BenchSender senders[BENCH_SENDERS];
+  GThread *threads[BENCH_SENDERS];
+  GInetAddress *localhost;
+  GSocketAddress *bind_addr;
+  guint i;
+
+  localhost = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  bind_addr = g_inet_socket_address_new (localhost, 0);
+
+  for (i = 0; i < n_senders; i++)
+  {
+    senders[i].socket = g_socket_new (G_SOCKET_FAMILY_IPV4,
+        G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, NULL);
+    ts_fail_if (senders[i].socket == NULL, "Could not create sender socket");
+    ts_fail_unless (g_socket_bind (senders[i].socket, bind_addr, FALSE, NULL),
+        "Could not bind sender socket");
+    senders[i].dest = g_inet_socket_address_new (localhost, local_port);
+    senders[i].count = BENCH_PACKETS / n_senders;
+  }
+
+  for (i = 0; i < n_senders; i++)
+    threads[i] = g_thread_new ("bench-sender", sender_thread, &senders[i]);
+
+  for (i = 0; i < n_senders; i++)
+  {
+    g_thread_join (threads[i]);
+    g_object_unref (senders[i].socket);
+    g_object_unref (senders[i].dest);
+  }
+
+  g_object_unref (bind_addr);
+  g_object_unref (localhost);
+}
+
+static void
+wait_for_packets (void)
+{
+  gint last = -1;
+  gint64 last_change = g_get_monotonic_time ();
+
+  for (;;)
+  {
+    gint now = g_atomic_int_get (&received);
+
+    if (now >= BENCH_PACKETS)
+      break;
+
+    if (now != last)
+    {
+      last = now;
+      last_change = g_get_monotonic_time ();
+    }
+    else if (g_get_monotonic_time () - last_change > BENCH_IDLE_TIMEOUT)
+    {
+      break;
+    }
+
+    g_usleep (1000);
+  }
+}
+
+static void
+run_rawudp_bench (guint batch_size, guint shards, guint n_senders)
+{
+  GError *error = NULL;
+  FsTransmitter *trans;
+  FsStreamTransmitter *st;
+  GstElement *pipeline;
+  GstBus *bus;
+  GstPad *srcpad, *sinkpad;
+  GParameter params[1];
+  gint64 start, elapsed;
+  gint count;
+
+  g_atomic_int_set (&received, 0);
+  rtp_ready = FALSE;
+  local_port = 0;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  trans = fs_transmitter_new ("rawudp", 2, 0, &error);
+
+  if (error)
+    ts_fail ("Error creating transmitter: (%s:%d) %s",
+      g_quark_to_string (error->domain), error->code, error->message);
+
+  g_object_set (trans,
+      "batch-size", batch_size,
+      "receive-shards", shards,
+      NULL);
+
+  pipeline = setup_pipeline (trans, G_CALLBACK (_handoff_handler));
+
+  bus = gst_element_get_bus (pipeline);
+  gst_bus_add_watch (bus, bus_error_callback, NULL);
+  gst_object_unref (bus);
+
+  memset (params, 0, sizeof (GParameter));
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  st = fs_transmitter_new_stream_transmitter (trans, NULL, 1, params, &error);
+  g_value_unset (&params[0].value);
+
+  if (error)
+    ts_fail ("Error creating stream transmitter: (%s:%d) %s",
+        g_quark_to_string (error->domain), error->code, error->message);
+
+  g_signal_connect (st, "new-local-candidate",
+      G_CALLBACK (_new_local_candidate), NULL);
+  g_signal_connect (st, "new-active-candidate-pair",
+      G_CALLBACK (_new_active_candidate_pair), NULL);
+  g_signal_connect (st, "error", G_CALLBACK (stream_transmitter_error), NULL);
+
+  ts_fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+    GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  ts_fail_unless (fs_stream_transmitter_gather_local_candidates (st, &error),
+      "Could not start gathering local candidates");
+
+  g_main_loop_run (loop);
+  ts_fail_unless (rtp_ready, "No active candidate pair for RTP");
+
+  srcpad = setup_bench_src (trans, &sinkpad);
+
+  start = g_get_monotonic_time ();
+  if (n_senders)
+    send_from_many_sockets (n_senders);
+  else
+    push_packets (srcpad);
+  wait_for_packets ();
+  elapsed = g_get_monotonic_time () - start;
+
+  count = g_atomic_int_get (&received);
+  g_print ("rawudp batch-size %3u shards %2u senders %2u: %d/%d packets in %"
+      G_GINT64_FORMAT " us, %.0f packets/s\n", batch_size, shards, n_senders,
+      count, BENCH_PACKETS, elapsed,
+      elapsed ? (count * (gdouble) G_USEC_PER_SEC) / elapsed : 0.0);
+
+  ts_fail_unless (count > 0, "No packet went through the loopback");
+
+  gst_pad_push_event (srcpad, gst_event_new_eos ());
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  gst_pad_unlink (srcpad, sinkpad);
+  gst_object_unref (srcpad);
+  gst_object_unref (sinkpad);
+
+  fs_stream_transmitter_stop (st);
+  g_object_unref (st);
+  g_object_unref (trans);
+  gst_object_unref (pipeline);
+  g_main_loop_unref (loop);
+}
+
+GST_START_TEST (test_rawudpbench_unbatched)
+{
+  run_rawudp_bench (0, 1, 0);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rawudpbench_batched)
+{
+  run_rawudp_bench (32, 1, 0);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rawudpbench_many_senders_one_shard)
+{
+  run_rawudp_bench (0, 1, BENCH_SENDERS);
+}
+GST_END_TEST;
+
+GST_START_TEST (test_rawudpbench_many_senders_sharded)
+{
+  run_rawudp_bench (0, 4, BENCH_SENDERS);
+}
+GST_END_TEST;
+
+static Suite *
+rawudpbench_suite (void)
+{
+  Suite *s = suite_create ("rawudpbench");
+  TCase *tc_chain;
+
+  tc_chain = tcase_create ("rawudp_unbatched");
+  tcase_add_test (tc_chain, test_rawudpbench_unbatched);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudp_batched");
+  tcase_add_test (tc_chain, test_rawudpbench_batched);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudp_many_senders_one_shard");
+  tcase_add_test (tc_chain, test_rawudpbench_many_senders_one_shard);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudp_many_senders_sharded");
+  tcase_add_test (tc_chain, test_rawudpbench_many_senders_sharded);
+  suite_add_tcase (s, tc_chain);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rawudpbench);
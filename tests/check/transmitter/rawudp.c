@@ -28,6 +28,7 @@
 
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <sys/socket.h>
 
 #include <unistd.h>
 
@@ -48,6 +49,7 @@ volatile gint running = TRUE;
 guint received_known[2] = {0, 0};
 gboolean has_stun = FALSE;
 gboolean associate_on_source = TRUE;
+gboolean validate_source = FALSE;
 
 gboolean pipeline_done = FALSE;
 GMutex pipeline_mod_mutex;
@@ -58,7 +60,8 @@ enum {
   FLAG_HAS_STUN  = 1 << 0,
   FLAG_IS_LOCAL  = 1 << 1,
   FLAG_NO_SOURCE = 1 << 2,
-  FLAG_NOT_SENDING = 1 << 3
+  FLAG_NOT_SENDING = 1 << 3,
+  FLAG_VALIDATE_SOURCE = 1 << 4
 };
 
 #define RTP_PORT 9828
@@ -214,7 +217,14 @@ _handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
 
   if (buffer_count[0] == 20 && buffer_count[1] == 20) {
     /* TEST OVER */
-    if (associate_on_source)
+    if (associate_on_source && validate_source)
+      /* Forcing the other component's candidate drops the validation, and
+       * each receiving thread may race with it, so allow a few */
+      ts_fail_unless (received_known[0] + received_known[1] >= 1 &&
+          received_known[0] + received_known[1] <= 6,
+          "Got %u known source packets after validating the source",
+          received_known[0] + received_known[1]);
+    else if (associate_on_source)
       ts_fail_unless (buffer_count[0] == received_known[0] &&
           buffer_count[1] == received_known[1], "Some known buffers from known"
           " sources have not been reported (%d != %u || %d != %u)",
@@ -242,6 +252,9 @@ _known_source_packet_received (FsStreamTransmitter *st, guint component_id,
       buffer);
 
   received_known[component_id - 1]++;
+
+  if (validate_source)
+    fs_stream_transmitter_set_source_validated (st, TRUE);
 }
 
 static gboolean
@@ -281,6 +294,7 @@ run_rawudp_transmitter_test (gint n_parameters, GParameter *params,
 
   has_stun = flags & FLAG_HAS_STUN;
   associate_on_source = !(flags & FLAG_NO_SOURCE);
+  validate_source = flags & FLAG_VALIDATE_SOURCE;
 
   if ((flags & FLAG_NOT_SENDING))
   {
@@ -403,6 +417,20 @@ GST_START_TEST (test_rawudptransmitter_run_nostun)
 }
 GST_END_TEST;
 
+GST_START_TEST (test_rawudptransmitter_run_nostun_validated)
+{
+  GParameter params[1];
+
+  memset (params, 0, sizeof (GParameter));
+
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  run_rawudp_transmitter_test (1, params, FLAG_VALIDATE_SOURCE);
+}
+GST_END_TEST;
+
 GST_START_TEST (test_rawudptransmitter_run_nostun_nosource)
 {
   GParameter params[2];
@@ -877,6 +905,694 @@ GST_START_TEST (test_rawudptransmitter_strange_arguments)
 }
 GST_END_TEST;
 
+#define MANY_KNOWN_ADDRESSES 4000
+#define KNOWN_ADDRESS_PORT 10000
+#define KNOWN_ADDRESS_BURST 64
+#define KNOWN_ADDRESS_TIMEOUT (5 * G_TIME_SPAN_SECOND)
+
+static volatile gint *known_received = NULL;
+static volatile gint fence_received = 0;
+static guint known_local_port = 0;
+
+/*
+ * Each address is on its own IP of 127.0.0.0/8, so the test can send from
+ * all of them on the same port
+ */
+
+static gchar *
+known_address (guint net, guint i)
+{
+  return g_strdup_printf ("127.%u.%u.%u", net, i / 200, i % 200 + 1);
+}
+
+static void
+force_remote_address (FsStreamTransmitter *st, guint net, guint i)
+{
+  GError *error = NULL;
+  FsCandidate *cand;
+  GList *list;
+  gchar *ip = known_address (net, i);
+
+  cand = fs_candidate_new ("abc", FS_COMPONENT_RTP,
+      FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP, ip, KNOWN_ADDRESS_PORT);
+  list = g_list_prepend (NULL, cand);
+  ts_fail_unless (fs_stream_transmitter_force_remote_candidates (st, list,
+          &error));
+  ts_fail_unless (error == NULL);
+  fs_candidate_list_destroy (list);
+  g_free (ip);
+}
+
+static gboolean
+send_from_address (guint net, guint i)
+{
+  gchar *ip = known_address (net, i);
+  GInetAddress *addr = g_inet_address_new_from_string (ip);
+  GSocketAddress *bind_addr = g_inet_socket_address_new (addr,
+      KNOWN_ADDRESS_PORT);
+  GInetAddress *localhost = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *dest = g_inet_socket_address_new (localhost,
+      known_local_port);
+  GSocket *socket;
+  gboolean ret;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  ts_fail_if (socket == NULL);
+
+  ret = g_socket_bind (socket, bind_addr, TRUE, NULL) &&
+    g_socket_send_to (socket, dest, "0123456789", 10, NULL, NULL) == 10;
+
+  g_socket_close (socket, NULL);
+  g_object_unref (socket);
+  g_object_unref (dest);
+  g_object_unref (localhost);
+  g_object_unref (bind_addr);
+  g_object_unref (addr);
+  g_free (ip);
+
+  return ret;
+}
+
+static void
+_known_source_packet_received (FsStreamTransmitter *st, guint component_id,
+    GstBuffer *buffer, gpointer user_data)
+{
+  gint i = GPOINTER_TO_INT (user_data);
+
+  if (component_id != FS_COMPONENT_RTP)
+    return;
+
+  if (i < 0)
+    g_atomic_int_inc (&fence_received);
+  else
+    g_atomic_int_inc (&known_received[i]);
+}
+
+static void
+_known_local_candidate (FsStreamTransmitter *st, FsCandidate *candidate,
+    gpointer user_data)
+{
+  if (candidate->component_id == FS_COMPONENT_RTP)
+    known_local_port = candidate->port;
+}
+
+static void
+_known_local_candidates_prepared (FsStreamTransmitter *st, gpointer user_data)
+{
+  g_main_loop_quit (loop);
+}
+
+/*
+ * Sends a packet from every address of @net, in bursts followed by a
+ * packet from the unique address of the fence stream. All the packets go
+ * through the same socket and streaming thread, so once the fence packet
+ * is reported, the packets before it have been checked.
+ */
+
+static void
+send_from_all_addresses (guint net)
+{
+  guint i, j;
+
+  for (i = 0; i < MANY_KNOWN_ADDRESSES; i += KNOWN_ADDRESS_BURST)
+  {
+    gint fences = g_atomic_int_get (&fence_received);
+    gint64 timeout = g_get_monotonic_time () + KNOWN_ADDRESS_TIMEOUT;
+
+    for (j = i; j < MIN (i + KNOWN_ADDRESS_BURST, MANY_KNOWN_ADDRESSES); j++)
+      ts_fail_unless (send_from_address (net, j));
+    ts_fail_unless (send_from_address (3, 0));
+
+    while (g_atomic_int_get (&fence_received) == fences)
+    {
+      ts_fail_if (g_get_monotonic_time () > timeout,
+          "Fence packet not received");
+      g_usleep (1000);
+    }
+  }
+}
+
+static void
+check_known_received (gint expected)
+{
+  guint i;
+
+  for (i = 0; i < MANY_KNOWN_ADDRESSES; i++)
+    ts_fail_unless (g_atomic_int_get (&known_received[i]) == expected,
+        "Stream %u got %d packets from its known source instead of %d", i,
+        g_atomic_int_get (&known_received[i]), expected);
+}
+
+/*
+ * All the stream transmitters share the same UdpPort, so every remote
+ * candidate ends up in the same known address table. Packets from an
+ * address are only reported as coming from a known source to the stream
+ * that has it as its remote candidate, and only while it is the only one.
+ */
+GST_START_TEST (test_rawudptransmitter_many_known_addresses)
+{
+  FsTransmitter *trans = NULL;
+  FsStreamTransmitter **st;
+  FsStreamTransmitter *fence_st;
+  GError *error = NULL;
+  GParameter params[1];
+  gboolean can_send;
+  gint64 start;
+  guint i;
+
+  memset (params, 0, sizeof (GParameter));
+
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  known_received = g_new0 (gint, MANY_KNOWN_ADDRESSES);
+  fence_received = 0;
+  known_local_port = 0;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  trans = fs_transmitter_new ("rawudp", 2, 0, &error);
+  ts_fail_if (trans == NULL);
+  ts_fail_unless (error == NULL);
+
+  pipeline = setup_pipeline (trans, NULL);
+
+  st = g_new0 (FsStreamTransmitter *, MANY_KNOWN_ADDRESSES);
+
+  for (i = 0; i < MANY_KNOWN_ADDRESSES; i++)
+  {
+    st[i] = fs_transmitter_new_stream_transmitter (trans, NULL, 1, params,
+        &error);
+    ts_fail_if (st[i] == NULL);
+    ts_fail_unless (error == NULL);
+    g_object_set (st[i], "sending", FALSE, NULL);
+    g_signal_connect (st[i], "known-source-packet-received",
+        G_CALLBACK (_known_source_packet_received), GINT_TO_POINTER (i));
+  }
+
+  fence_st = fs_transmitter_new_stream_transmitter (trans, NULL, 1, params,
+      &error);
+  ts_fail_if (fence_st == NULL);
+  ts_fail_unless (error == NULL);
+  g_object_set (fence_st, "sending", FALSE, NULL);
+  g_signal_connect (fence_st, "known-source-packet-received",
+      G_CALLBACK (_known_source_packet_received), GINT_TO_POINTER (-1));
+  g_signal_connect (fence_st, "new-local-candidate",
+      G_CALLBACK (_known_local_candidate), NULL);
+  g_signal_connect (fence_st, "local-candidates-prepared",
+      G_CALLBACK (_known_local_candidates_prepared), NULL);
+  force_remote_address (fence_st, 3, 0);
+
+  ts_fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  ts_fail_unless (fs_stream_transmitter_gather_local_candidates (fence_st,
+          &error));
+  g_main_loop_run (loop);
+  ts_fail_unless (known_local_port != 0, "No local RTP candidate");
+
+  /* Only Linux routes all of 127.0.0.0/8 to the loopback */
+  can_send = send_from_address (3, 0);
+  if (can_send)
+  {
+    gint64 timeout = g_get_monotonic_time () + KNOWN_ADDRESS_TIMEOUT;
+
+    while (g_atomic_int_get (&fence_received) == 0)
+    {
+      ts_fail_if (g_get_monotonic_time () > timeout,
+          "Fence packet not received");
+      g_usleep (1000);
+    }
+  }
+  else
+  {
+    GST_WARNING ("Can not send from 127.3.0.1, only checking the churn");
+  }
+
+  start = g_get_monotonic_time ();
+
+  /* Every address is unique */
+  for (i = 0; i < MANY_KNOWN_ADDRESSES; i++)
+    force_remote_address (st[i], 1, i);
+
+  GST_INFO ("Added %u known addresses in %" G_GINT64_FORMAT " us",
+      MANY_KNOWN_ADDRESSES, g_get_monotonic_time () - start);
+
+  if (can_send)
+  {
+    send_from_all_addresses (1);
+    check_known_received (1);
+  }
+
+  /* Make pairs of stream transmitters share an address, the address each
+   * odd one leaves is forgotten */
+  start = g_get_monotonic_time ();
+  for (i = 0; i < MANY_KNOWN_ADDRESSES; i += 2)
+    force_remote_address (st[i + 1], 1, i);
+
+  GST_INFO ("Shared %u known addresses in %" G_GINT64_FORMAT " us",
+      MANY_KNOWN_ADDRESSES / 2, g_get_monotonic_time () - start);
+
+  if (can_send)
+  {
+    send_from_all_addresses (1);
+    check_known_received (1);
+  }
+
+  /* Make them unique again on a fresh set of addresses */
+  start = g_get_monotonic_time ();
+  for (i = 0; i < MANY_KNOWN_ADDRESSES; i++)
+    force_remote_address (st[i], 2, i);
+
+  GST_INFO ("Moved %u known addresses in %" G_GINT64_FORMAT " us",
+      MANY_KNOWN_ADDRESSES, g_get_monotonic_time () - start);
+
+  if (can_send)
+  {
+    send_from_all_addresses (1);
+    check_known_received (1);
+    send_from_all_addresses (2);
+    check_known_received (2);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  fs_stream_transmitter_stop (fence_st);
+  g_object_unref (fence_st);
+  for (i = 0; i < MANY_KNOWN_ADDRESSES; i++)
+  {
+    fs_stream_transmitter_stop (st[i]);
+    g_object_unref (st[i]);
+  }
+  g_free (st);
+  g_free ((gpointer) known_received);
+  known_received = NULL;
+
+  gst_object_unref (pipeline);
+  pipeline = NULL;
+  g_main_loop_unref (loop);
+  loop = NULL;
+
+  g_value_unset (&params[0].value);
+  g_object_unref (trans);
+}
+GST_END_TEST;
+
+static gboolean
+can_bind_port (guint port)
+{
+  GInetAddress *addr = g_inet_address_new_any (G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *socket_addr = g_inet_socket_address_new (addr, port);
+  GSocket *socket;
+  gboolean ret;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  ts_fail_if (socket == NULL);
+  ret = g_socket_bind (socket, socket_addr, FALSE, NULL);
+
+  g_socket_close (socket, NULL);
+  g_object_unref (socket);
+  g_object_unref (socket_addr);
+  g_object_unref (addr);
+
+  return ret;
+}
+
+#define SOCKET_POOL_CHURN 200
+
+/*
+ * Streams are created and destroyed in a loop, their sockets must come
+ * from the pool and go back to it.
+ */
+
+GST_START_TEST (test_rawudptransmitter_socket_pool)
+{
+  FsTransmitter *trans = NULL;
+  FsStreamTransmitter *st;
+  GError *error = NULL;
+  GParameter params[1];
+  gint64 start;
+  guint pool_size;
+  guint i;
+
+  memset (params, 0, sizeof (GParameter));
+
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  trans = fs_transmitter_new ("rawudp", 2, 0, &error);
+  ts_fail_if (trans == NULL);
+  ts_fail_unless (error == NULL);
+
+  if (!can_bind_port (7078) || !can_bind_port (7079))
+  {
+    GST_WARNING ("Ports 7078 and 7079 are in use, skipping pool test");
+    goto out;
+  }
+
+  g_object_set (trans, "socket-pool-size", 4, NULL);
+  g_object_get (trans, "socket-pool-size", &pool_size, NULL);
+  ts_fail_unless (pool_size == 4);
+
+  /* The pool starts on the default ports */
+  ts_fail_if (can_bind_port (7078));
+  ts_fail_if (can_bind_port (7079));
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < SOCKET_POOL_CHURN; i++)
+  {
+    st = fs_transmitter_new_stream_transmitter (trans, NULL, 1, params,
+        &error);
+    ts_fail_if (st == NULL);
+    ts_fail_unless (error == NULL);
+    fs_stream_transmitter_stop (st);
+    g_object_unref (st);
+  }
+
+  GST_INFO ("Created %u streams in %" G_GINT64_FORMAT " us",
+      SOCKET_POOL_CHURN, g_get_monotonic_time () - start);
+
+  /* The sockets went back to the pool */
+  ts_fail_if (can_bind_port (7078));
+  ts_fail_if (can_bind_port (7079));
+
+  g_object_set (trans, "socket-pool-size", 0, NULL);
+
+  ts_fail_unless (can_bind_port (7078));
+  ts_fail_unless (can_bind_port (7079));
+
+ out:
+  g_value_unset (&params[0].value);
+  g_object_unref (trans);
+}
+GST_END_TEST;
+
+/*
+ * The pool is shared by all the transmitters of the process. A free port
+ * that is asked for is bound instead of taking a pooled socket, and the
+ * ports of the sockets that are not pooled are released.
+ */
+
+GST_START_TEST (test_rawudptransmitter_shared_socket_pool)
+{
+  FsTransmitter *trans = NULL;
+  FsTransmitter *trans2 = NULL;
+  FsStreamTransmitter *st;
+  GError *error = NULL;
+  GParameter params[2];
+  GList *list = NULL;
+  guint pool_size;
+
+  memset (params, 0, sizeof (GParameter) * 2);
+
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  list = g_list_prepend (list, fs_candidate_new ("L1", FS_COMPONENT_RTP,
+          FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP, NULL, 7200));
+  params[1].name = "preferred-local-candidates";
+  g_value_init (&params[1].value, FS_TYPE_CANDIDATE_LIST);
+  g_value_set_boxed (&params[1].value, list);
+
+  trans = fs_transmitter_new ("rawudp", 2, 0, &error);
+  ts_fail_if (trans == NULL);
+  ts_fail_unless (error == NULL);
+  trans2 = fs_transmitter_new ("rawudp", 2, 0, &error);
+  ts_fail_if (trans2 == NULL);
+  ts_fail_unless (error == NULL);
+
+  if (!can_bind_port (7078) || !can_bind_port (7079) ||
+      !can_bind_port (7200) || !can_bind_port (7201))
+  {
+    GST_WARNING ("Ports 7078, 7079, 7200 or 7201 are in use,"
+        " skipping shared pool test");
+    goto out;
+  }
+
+  g_object_set (trans, "socket-pool-size", 4, NULL);
+  g_object_get (trans2, "socket-pool-size", &pool_size, NULL);
+  ts_fail_unless (pool_size == 4);
+
+  st = fs_transmitter_new_stream_transmitter (trans2, NULL, 2, params,
+      &error);
+  ts_fail_if (st == NULL);
+  ts_fail_unless (error == NULL);
+  ts_fail_if (can_bind_port (7200));
+  ts_fail_if (can_bind_port (7201));
+  fs_stream_transmitter_stop (st);
+  g_object_unref (st);
+
+  ts_fail_unless (can_bind_port (7200));
+  ts_fail_unless (can_bind_port (7201));
+
+  /* Emptying the pool from the other transmitter closes its sockets */
+  g_object_set (trans2, "socket-pool-size", 0, NULL);
+  ts_fail_unless (can_bind_port (7078));
+  ts_fail_unless (can_bind_port (7079));
+
+  /* Sharded sockets are not pooled, but their ports must be released so
+   * the next stream gets the same one */
+  g_object_set (trans2, "receive-shards", 2, NULL);
+
+  st = fs_transmitter_new_stream_transmitter (trans2, NULL, 1, params,
+      &error);
+  ts_fail_if (st == NULL);
+  ts_fail_unless (error == NULL);
+  ts_fail_if (can_bind_port (7078));
+  fs_stream_transmitter_stop (st);
+  g_object_unref (st);
+
+  st = fs_transmitter_new_stream_transmitter (trans2, NULL, 1, params,
+      &error);
+  ts_fail_if (st == NULL);
+  ts_fail_unless (error == NULL);
+  ts_fail_if (can_bind_port (7078));
+  fs_stream_transmitter_stop (st);
+  g_object_unref (st);
+
+ out:
+  g_value_unset (&params[0].value);
+  g_value_unset (&params[1].value);
+  fs_candidate_list_destroy (list);
+  g_object_unref (trans2);
+  g_object_unref (trans);
+}
+GST_END_TEST;
+
+/*
+ * The sharded ports are bound with SO_REUSEPORT, they must not join another
+ * socket of the same user that already has the port with it, even on a
+ * given address where the ports do not come from the allocator.
+ */
+
+GST_START_TEST (test_rawudptransmitter_shards_exclusive_port)
+{
+#ifdef SO_REUSEPORT
+  FsTransmitter *trans = NULL;
+  FsStreamTransmitter *st;
+  GError *error = NULL;
+  GParameter params[2];
+  GList *list = NULL;
+  GInetAddress *addr;
+  GSocketAddress *socket_addr;
+  GSocket *holder;
+  gboolean bound;
+  int one = 1;
+
+  holder = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  ts_fail_if (holder == NULL);
+  ts_fail_if (setsockopt (g_socket_get_fd (holder), SOL_SOCKET, SO_REUSEPORT,
+          &one, sizeof (one)) < 0);
+
+  addr = g_inet_address_new_from_string ("127.0.0.1");
+  socket_addr = g_inet_socket_address_new (addr, 7300);
+  bound = g_socket_bind (holder, socket_addr, FALSE, NULL);
+  g_object_unref (socket_addr);
+  g_object_unref (addr);
+
+  if (!bound || !can_bind_port (7302))
+  {
+    GST_WARNING ("Ports 7300 or 7302 are in use, skipping shards test");
+    g_socket_close (holder, NULL);
+    g_object_unref (holder);
+    return;
+  }
+
+  memset (params, 0, sizeof (GParameter) * 2);
+
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  list = g_list_prepend (list, fs_candidate_new ("L1", FS_COMPONENT_RTP,
+          FS_CANDIDATE_TYPE_HOST, FS_NETWORK_PROTOCOL_UDP, "127.0.0.1",
+          7300));
+  params[1].name = "preferred-local-candidates";
+  g_value_init (&params[1].value, FS_TYPE_CANDIDATE_LIST);
+  g_value_set_boxed (&params[1].value, list);
+
+  trans = fs_transmitter_new ("rawudp", 1, 0, &error);
+  ts_fail_if (trans == NULL);
+  ts_fail_unless (error == NULL);
+  g_object_set (trans, "receive-shards", 2, NULL);
+
+  st = fs_transmitter_new_stream_transmitter (trans, NULL, 2, params,
+      &error);
+  ts_fail_if (st == NULL);
+  ts_fail_unless (error == NULL);
+
+  /* It went on to the next port instead of sharing the held one */
+  ts_fail_if (can_bind_port (7302),
+      "The shards were bound to the port of another socket");
+
+  fs_stream_transmitter_stop (st);
+  g_object_unref (st);
+
+  g_value_unset (&params[0].value);
+  g_value_unset (&params[1].value);
+  fs_candidate_list_destroy (list);
+  g_object_unref (trans);
+
+  g_socket_close (holder, NULL);
+  g_object_unref (holder);
+#endif
+}
+GST_END_TEST;
+
+#define LARGE_DATAGRAM_SIZE 9000
+
+static guint large_local_port = 0;
+static volatile gint large_received = 0;
+
+static void
+_large_new_local_candidate (FsStreamTransmitter *st, FsCandidate *candidate,
+    gpointer user_data)
+{
+  if (candidate->component_id == FS_COMPONENT_RTP)
+    large_local_port = candidate->port;
+}
+
+static void
+_large_local_candidates_prepared (FsStreamTransmitter *st, gpointer user_data)
+{
+  g_main_loop_quit (loop);
+}
+
+static void
+_large_handoff_handler (GstElement *element, GstBuffer *buffer, GstPad *pad,
+    gpointer user_data)
+{
+  if (GPOINTER_TO_INT (user_data) != FS_COMPONENT_RTP)
+    return;
+
+  ts_fail_unless (gst_buffer_get_size (buffer) == LARGE_DATAGRAM_SIZE,
+      "Received a datagram of %" G_GSIZE_FORMAT " bytes instead of %d",
+      gst_buffer_get_size (buffer), LARGE_DATAGRAM_SIZE);
+  ts_fail_unless (gst_buffer_memcmp (buffer, LARGE_DATAGRAM_SIZE - 1, "z",
+          1) == 0, "The end of the datagram was not received");
+
+  g_atomic_int_inc (&large_received);
+}
+
+/*
+ * A datagram larger than the pooled buffers of the batched source must be
+ * received whole, like with udpsrc.
+ */
+
+GST_START_TEST (test_rawudptransmitter_large_datagram)
+{
+  FsTransmitter *trans = NULL;
+  FsStreamTransmitter *st;
+  GError *error = NULL;
+  GParameter params[1];
+  GInetAddress *localhost;
+  GSocketAddress *dest;
+  GSocket *socket;
+  gchar *data;
+  guint i;
+
+  large_local_port = 0;
+  g_atomic_int_set (&large_received, 0);
+
+  memset (params, 0, sizeof (GParameter));
+
+  params[0].name = "upnp-discovery";
+  g_value_init (&params[0].value, G_TYPE_BOOLEAN);
+  g_value_set_boolean (&params[0].value, FALSE);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  trans = fs_transmitter_new ("rawudp", 2, 0, &error);
+  ts_fail_if (trans == NULL);
+  ts_fail_unless (error == NULL);
+
+  g_object_set (trans, "batch-size", 4, NULL);
+
+  pipeline = setup_pipeline (trans, G_CALLBACK (_large_handoff_handler));
+
+  st = fs_transmitter_new_stream_transmitter (trans, NULL, 1, params, &error);
+  ts_fail_if (st == NULL);
+  ts_fail_unless (error == NULL);
+
+  g_signal_connect (st, "new-local-candidate",
+      G_CALLBACK (_large_new_local_candidate), NULL);
+  g_signal_connect (st, "local-candidates-prepared",
+      G_CALLBACK (_large_local_candidates_prepared), NULL);
+  g_signal_connect (st, "error", G_CALLBACK (stream_transmitter_error), NULL);
+
+  ts_fail_if (gst_element_set_state (pipeline, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_FAILURE, "Could not set the pipeline to playing");
+
+  ts_fail_unless (fs_stream_transmitter_gather_local_candidates (st, &error));
+  g_main_loop_run (loop);
+  ts_fail_unless (large_local_port != 0, "No local RTP candidate");
+
+  localhost = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  dest = g_inet_socket_address_new (localhost, large_local_port);
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  ts_fail_if (socket == NULL);
+
+  data = g_malloc (LARGE_DATAGRAM_SIZE);
+  memset (data, 0x80, LARGE_DATAGRAM_SIZE);
+  data[LARGE_DATAGRAM_SIZE - 1] = 'z';
+
+  /* Loopback doesn't lose packets, but the socket may not be read yet */
+  for (i = 0; i < 200 && g_atomic_int_get (&large_received) == 0; i++)
+  {
+    if (i % 20 == 0)
+      ts_fail_unless (g_socket_send_to (socket, dest, data,
+              LARGE_DATAGRAM_SIZE, NULL, NULL) == LARGE_DATAGRAM_SIZE);
+    g_usleep (10 * 1000);
+  }
+
+  ts_fail_unless (g_atomic_int_get (&large_received) > 0,
+      "The large datagram was not received");
+
+  g_free (data);
+  g_object_unref (socket);
+  g_object_unref (dest);
+  g_object_unref (localhost);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  fs_stream_transmitter_stop (st);
+  g_object_unref (st);
+  g_object_unref (trans);
+  gst_object_unref (pipeline);
+  pipeline = NULL;
+  g_main_loop_unref (loop);
+  loop = NULL;
+
+  g_value_unset (&params[0].value);
+}
+GST_END_TEST;
+
 void
 setup_stunalternd_valid (void)
 {
@@ -944,6 +1660,10 @@ rawudptransmitter_suite (void)
   tcase_add_test (tc_chain, test_rawudptransmitter_run_nostun);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("rawudptransmitter_nostun_validated");
+  tcase_add_test (tc_chain, test_rawudptransmitter_run_nostun_validated);
+  suite_add_tcase (s, tc_chain);
+
   tc_chain = tcase_create ("rawudptransmitter_nostun_nosource");
   tcase_add_test (tc_chain, test_rawudptransmitter_run_nostun_nosource);
   suite_add_tcase (s, tc_chain);
@@ -1021,6 +1741,26 @@ rawudptransmitter_suite (void)
   tcase_add_test (tc_chain, test_rawudptransmitter_strange_arguments);
   suite_add_tcase (s, tc_chain);
 
+  tc_chain = tcase_create ("rawudptransmitter-many-known-addresses");
+  tcase_add_test (tc_chain, test_rawudptransmitter_many_known_addresses);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudptransmitter_socket_pool");
+  tcase_add_test (tc_chain, test_rawudptransmitter_socket_pool);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudptransmitter_shared_socket_pool");
+  tcase_add_test (tc_chain, test_rawudptransmitter_shared_socket_pool);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudptransmitter_shards_exclusive_port");
+  tcase_add_test (tc_chain, test_rawudptransmitter_shards_exclusive_port);
+  suite_add_tcase (s, tc_chain);
+
+  tc_chain = tcase_create ("rawudptransmitter_large_datagram");
+  tcase_add_test (tc_chain, test_rawudptransmitter_large_datagram);
+  suite_add_tcase (s, tc_chain);
+
   return s;
 }
 
@@ -0,0 +1,356 @@
+/*
+ * Farstream - Farstream Network Impairment Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-impair-filter.c - An element applying a #FsImpairModel to its buffers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The filter asks the model when each buffer must leave and holds it until
+ * then. The buffers are pushed out by a task on the src pad, which sleeps
+ * on the monotonic clock until the first buffer of the queue is due.
+ *
+ * Events are forwarded as soon as they arrive, only the buffers are
+ * delayed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-impair-filter.h"
+
+GST_DEBUG_CATEGORY_EXTERN (fs_impair_transmitter_debug);
+#define GST_CAT_DEFAULT fs_impair_transmitter_debug
+
+typedef struct {
+  GstBuffer *buffer;
+  GstClockTime departure;
+} QueuedBuffer;
+
+static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static void fs_impair_filter_class_init (FsImpairFilterClass *klass);
+static void fs_impair_filter_init (FsImpairFilter *self);
+static void fs_impair_filter_finalize (GObject *object);
+
+static GstFlowReturn fs_impair_filter_chain (GstPad *pad, GstObject *parent,
+    GstBuffer *buffer);
+static gboolean fs_impair_filter_sink_event (GstPad *pad, GstObject *parent,
+    GstEvent *event);
+static gboolean fs_impair_filter_src_activate_mode (GstPad *pad,
+    GstObject *parent, GstPadMode mode, gboolean active);
+
+static GstElementClass *parent_class = NULL;
+
+static GType type = 0;
+
+GType
+fs_impair_filter_get_type (void)
+{
+  return type;
+}
+
+GType
+fs_impair_filter_register_type (FsPlugin *module)
+{
+  static const GTypeInfo info = {
+    sizeof (FsImpairFilterClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_impair_filter_class_init,
+    NULL,
+    NULL,
+    sizeof (FsImpairFilter),
+    0,
+    (GInstanceInitFunc) fs_impair_filter_init
+  };
+
+  type = g_type_module_register_type (G_TYPE_MODULE (module),
+    GST_TYPE_ELEMENT, "FsImpairFilter", &info, 0);
+
+  return type;
+}
+
+static void
+fs_impair_filter_class_init (FsImpairFilterClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->finalize = fs_impair_filter_finalize;
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&sink_template));
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+
+  gst_element_class_set_static_metadata (element_class,
+      "Farstream network impairment filter",
+      "Filter",
+      "Drops and delays buffers like a network would",
+      "Collabora Ltd.");
+}
+
+static void
+fs_impair_filter_init (FsImpairFilter *self)
+{
+  g_mutex_init (&self->mutex);
+  g_cond_init (&self->cond);
+  g_queue_init (&self->queue);
+  self->flushing = TRUE;
+
+  self->sinkpad = gst_pad_new_from_static_template (&sink_template, "sink");
+  gst_pad_set_chain_function (self->sinkpad, fs_impair_filter_chain);
+  gst_pad_set_event_function (self->sinkpad, fs_impair_filter_sink_event);
+  GST_PAD_SET_PROXY_CAPS (self->sinkpad);
+  GST_PAD_SET_PROXY_ALLOCATION (self->sinkpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  self->srcpad = gst_pad_new_from_static_template (&src_template, "src");
+  gst_pad_set_activatemode_function (self->srcpad,
+      fs_impair_filter_src_activate_mode);
+  GST_PAD_SET_PROXY_CAPS (self->srcpad);
+  GST_PAD_SET_PROXY_ALLOCATION (self->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
+}
+
+static void
+_clear_queue_locked (FsImpairFilter *self)
+{
+  QueuedBuffer *qb;
+
+  while ((qb = g_queue_pop_head (&self->queue)))
+  {
+    gst_buffer_unref (qb->buffer);
+    g_slice_free (QueuedBuffer, qb);
+  }
+}
+
+static void
+fs_impair_filter_finalize (GObject *object)
+{
+  FsImpairFilter *self = FS_IMPAIR_FILTER (object);
+
+  _clear_queue_locked (self);
+  if (self->model)
+    fs_impair_model_free (self->model);
+
+  g_mutex_clear (&self->mutex);
+  g_cond_clear (&self->cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+FsImpairFilter *
+fs_impair_filter_new (void)
+{
+  return g_object_new (FS_TYPE_IMPAIR_FILTER, NULL);
+}
+
+/**
+ * fs_impair_filter_set_model:
+ * @self: a #FsImpairFilter
+ * @model: (transfer full): the new model or %NULL to let everything through
+ *
+ * Replaces the model, the buffers that are already queued keep their
+ * departure time.
+ */
+
+void
+fs_impair_filter_set_model (FsImpairFilter *self, FsImpairModel *model)
+{
+  FsImpairModel *old;
+
+  g_mutex_lock (&self->mutex);
+  old = self->model;
+  self->model = model;
+  g_mutex_unlock (&self->mutex);
+
+  if (old)
+    fs_impair_model_free (old);
+}
+
+static GstClockTime
+_now (void)
+{
+  return g_get_monotonic_time () * GST_USECOND;
+}
+
+static void
+_insert_sorted_locked (FsImpairFilter *self, GstBuffer *buffer,
+    GstClockTime departure)
+{
+  QueuedBuffer *qb = g_slice_new (QueuedBuffer);
+  GList *item;
+
+  qb->buffer = buffer;
+  qb->departure = departure;
+
+  /* Most buffers go at the end, so look from there */
+  for (item = self->queue.tail; item; item = item->prev)
+    if (((QueuedBuffer *) item->data)->departure <= departure)
+      break;
+
+  if (item)
+    g_queue_insert_after (&self->queue, item, qb);
+  else
+    g_queue_push_head (&self->queue, qb);
+
+  if (self->queue.head->data == qb)
+    g_cond_signal (&self->cond);
+}
+
+static GstFlowReturn
+fs_impair_filter_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  FsImpairFilter *self = FS_IMPAIR_FILTER (parent);
+  GstClockTime now = _now ();
+  GstClockTime departure = now;
+
+  g_mutex_lock (&self->mutex);
+
+  if (self->flushing)
+  {
+    g_mutex_unlock (&self->mutex);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_FLUSHING;
+  }
+
+  if (self->model && !fs_impair_model_process (self->model,
+          gst_buffer_get_size (buffer), now, &departure))
+  {
+    g_mutex_unlock (&self->mutex);
+    GST_LOG_OBJECT (self, "Dropping buffer of size %" G_GSIZE_FORMAT,
+        gst_buffer_get_size (buffer));
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  _insert_sorted_locked (self, buffer, departure);
+
+  g_mutex_unlock (&self->mutex);
+
+  return GST_FLOW_OK;
+}
+
+static void
+fs_impair_filter_loop (gpointer user_data)
+{
+  FsImpairFilter *self = FS_IMPAIR_FILTER (user_data);
+  QueuedBuffer *qb = NULL;
+  GstBuffer *buffer;
+
+  g_mutex_lock (&self->mutex);
+  while (!self->flushing)
+  {
+    qb = g_queue_peek_head (&self->queue);
+
+    if (!qb)
+      g_cond_wait (&self->cond, &self->mutex);
+    else if (qb->departure > _now ())
+      g_cond_wait_until (&self->cond, &self->mutex,
+          (qb->departure + GST_USECOND - 1) / GST_USECOND);
+    else
+      break;
+  }
+
+  if (self->flushing)
+  {
+    g_mutex_unlock (&self->mutex);
+    gst_pad_pause_task (self->srcpad);
+    return;
+  }
+
+  g_queue_pop_head (&self->queue);
+  g_mutex_unlock (&self->mutex);
+
+  buffer = qb->buffer;
+  g_slice_free (QueuedBuffer, qb);
+
+  /* The transmitter's sinks never return a fatal error */
+  gst_pad_push (self->srcpad, buffer);
+}
+
+static void
+_set_flushing (FsImpairFilter *self, gboolean flushing)
+{
+  g_mutex_lock (&self->mutex);
+  self->flushing = flushing;
+  if (flushing)
+    _clear_queue_locked (self);
+  g_cond_signal (&self->cond);
+  g_mutex_unlock (&self->mutex);
+}
+
+static gboolean
+fs_impair_filter_sink_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  FsImpairFilter *self = FS_IMPAIR_FILTER (parent);
+  gboolean ret;
+
+  switch (GST_EVENT_TYPE (event))
+  {
+    case GST_EVENT_FLUSH_START:
+      _set_flushing (self, TRUE);
+      ret = gst_pad_push_event (self->srcpad, event);
+      gst_pad_pause_task (self->srcpad);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      ret = gst_pad_push_event (self->srcpad, event);
+      _set_flushing (self, FALSE);
+      gst_pad_start_task (self->srcpad, fs_impair_filter_loop, self, NULL);
+      break;
+    default:
+      ret = gst_pad_event_default (pad, parent, event);
+      break;
+  }
+
+  return ret;
+}
+
+static gboolean
+fs_impair_filter_src_activate_mode (GstPad *pad, GstObject *parent,
+    GstPadMode mode, gboolean active)
+{
+  FsImpairFilter *self = FS_IMPAIR_FILTER (parent);
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  if (active)
+  {
+    _set_flushing (self, FALSE);
+    return gst_pad_start_task (pad, fs_impair_filter_loop, self, NULL);
+  }
+  else
+  {
+    _set_flushing (self, TRUE);
+    return gst_pad_stop_task (pad);
+  }
+}
@@ -0,0 +1,82 @@
+/*
+ * Farstream - Farstream Network Impairment Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-impair-filter.h - An element applying a #FsImpairModel to its buffers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_IMPAIR_FILTER_H__
+#define __FS_IMPAIR_FILTER_H__
+
+#include <gst/gst.h>
+
+#include <farstream/fs-plugin.h>
+
+#include "fs-impair-model.h"
+
+G_BEGIN_DECLS
+
+#define FS_TYPE_IMPAIR_FILTER \
+  (fs_impair_filter_get_type ())
+#define FS_IMPAIR_FILTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_IMPAIR_FILTER, FsImpairFilter))
+#define FS_IMPAIR_FILTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_IMPAIR_FILTER, \
+    FsImpairFilterClass))
+#define FS_IS_IMPAIR_FILTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_IMPAIR_FILTER))
+#define FS_IS_IMPAIR_FILTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_IMPAIR_FILTER))
+#define FS_IMPAIR_FILTER_CAST(obj) ((FsImpairFilter *) (obj))
+
+typedef struct _FsImpairFilter FsImpairFilter;
+typedef struct _FsImpairFilterClass FsImpairFilterClass;
+
+struct _FsImpairFilterClass
+{
+  GstElementClass parent_class;
+};
+
+struct _FsImpairFilter
+{
+  GstElement parent;
+
+  GstPad *sinkpad;
+  GstPad *srcpad;
+
+  GMutex mutex;
+  GCond cond;
+
+  /* Protected by the mutex */
+  FsImpairModel *model;
+  /* of QueuedBuffer, sorted by departure time */
+  GQueue queue;
+  gboolean flushing;
+};
+
+GType fs_impair_filter_register_type (FsPlugin *module);
+
+GType fs_impair_filter_get_type (void);
+
+FsImpairFilter *fs_impair_filter_new (void);
+
+void fs_impair_filter_set_model (FsImpairFilter *self, FsImpairModel *model);
+
+G_END_DECLS
+
+#endif /* __FS_IMPAIR_FILTER_H__ */
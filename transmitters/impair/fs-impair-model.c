@@ -0,0 +1,420 @@
+/*
+ * Farstream - Farstream Network Impairment Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-impair-model.c - The model deciding the fate of each packet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The model only looks at the size and the arrival time of each packet and
+ * at its own random number generator, it never reads a clock. Given the
+ * same description and the same arrival times, it always makes the same
+ * decisions, which is what makes the measurements reproducible.
+ *
+ * A packet goes through the stages in this order:
+ *  - loss, following a Gilbert model when a mean burst length is given
+ *  - the bottleneck link, which serializes the packets at the current
+ *    bandwidth and drops them when its queue is full
+ *  - the propagation delay and its jitter, the packets stay in order
+ *    unless they are picked for reordering, then they skip the delay
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-impair-model.h"
+
+#include <farstream/fs-conference.h>
+
+#include <string.h>
+
+typedef struct {
+  GstClockTime at;
+  guint64 bitrate;
+} TraceStep;
+
+struct _FsImpairModel {
+  GRand *rand;
+
+  gdouble loss;
+  gdouble loss_burst;
+  GstClockTime delay;
+  GstClockTime jitter;
+  gdouble reorder;
+  guint64 bandwidth;
+  guint64 queue_size;
+
+  /* of TraceStep, sorted by time, NULL if the bandwidth is fixed */
+  GArray *trace;
+  guint trace_pos;
+
+  /* Current state */
+  gboolean in_burst;
+  GstClockTime origin;
+  GstClockTime link_free;
+  GstClockTime last_departure;
+
+  guint64 dropped;
+};
+
+static gboolean
+_get_number (const GstStructure *s, const gchar *field, gdouble *out,
+    GError **error)
+{
+  const GValue *v = gst_structure_get_value (s, field);
+
+  if (!v)
+    return TRUE;
+
+  if (G_VALUE_HOLDS_DOUBLE (v))
+    *out = g_value_get_double (v);
+  else if (G_VALUE_HOLDS_INT (v))
+    *out = g_value_get_int (v);
+  else if (G_VALUE_HOLDS_UINT (v))
+    *out = g_value_get_uint (v);
+  else if (G_VALUE_HOLDS_INT64 (v))
+    *out = g_value_get_int64 (v);
+  else if (G_VALUE_HOLDS_UINT64 (v))
+    *out = g_value_get_uint64 (v);
+  else
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "The impairment field \"%s\" must be a number", field);
+    return FALSE;
+  }
+
+  if (*out < 0)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "The impairment field \"%s\" can not be negative", field);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*
+ * The trace is a list of "time:bitrate" steps separated by semicolons, the
+ * time is in milliseconds from the first packet and the bitrate in bits per
+ * second. The last bitrate stays in effect until the end.
+ */
+
+static GArray *
+_parse_trace (const gchar *str, GError **error)
+{
+  GArray *trace = g_array_new (FALSE, FALSE, sizeof (TraceStep));
+  gchar **steps = g_strsplit (str, ";", -1);
+  guint i;
+
+  for (i = 0; steps[i]; i++)
+  {
+    TraceStep step;
+    gchar *end = NULL;
+    guint64 ms;
+
+    g_strstrip (steps[i]);
+    if (!steps[i][0])
+      continue;
+
+    ms = g_ascii_strtoull (steps[i], &end, 10);
+    if (end == steps[i] || *end != ':')
+      goto error;
+
+    step.at = ms * GST_MSECOND;
+    step.bitrate = g_ascii_strtoull (end + 1, &end, 10);
+    if (*end)
+      goto error;
+
+    if (trace->len &&
+        step.at <= g_array_index (trace, TraceStep, trace->len - 1).at)
+      goto error;
+
+    g_array_append_val (trace, step);
+  }
+
+  g_strfreev (steps);
+
+  if (trace->len == 0 || g_array_index (trace, TraceStep, 0).at != 0)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "The bandwidth trace must start at time 0");
+    g_array_free (trace, TRUE);
+    return NULL;
+  }
+
+  return trace;
+
+ error:
+  g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+      "Invalid bandwidth trace step \"%s\", expected \"ms:bitrate\" with"
+      " increasing times", steps[i]);
+  g_strfreev (steps);
+  g_array_free (trace, TRUE);
+  return NULL;
+}
+
+static gboolean
+_check_field (GQuark field_id, const GValue *value, gpointer user_data)
+{
+  static const gchar *known[] = {
+    "seed", "loss", "loss-burst", "delay", "jitter", "reorder", "bandwidth",
+    "queue-size", "bandwidth-trace", NULL
+  };
+  const gchar *name = g_quark_to_string (field_id);
+  guint i;
+
+  for (i = 0; known[i]; i++)
+    if (!strcmp (known[i], name))
+      return TRUE;
+
+  *(const gchar **) user_data = name;
+  return FALSE;
+}
+
+/**
+ * fs_impair_model_new:
+ * @description: a #GstStructure with the fields described in
+ *   #FsImpairTransmitter:send-impairment, or %NULL for no impairment
+ * @stream_id: distinguishes the models created from the same description,
+ *   so that each one draws a different random sequence
+ * @error: location of a #GError, or %NULL
+ *
+ * Returns: a new #FsImpairModel or %NULL if @description is invalid
+ */
+
+FsImpairModel *
+fs_impair_model_new (const GstStructure *description, guint stream_id,
+    GError **error)
+{
+  FsImpairModel *model;
+  const gchar *unknown = NULL;
+  const gchar *trace_str;
+  gdouble seed = 0, delay = 0, jitter = 0, bandwidth = 0, queue_size = 0;
+
+  model = g_slice_new0 (FsImpairModel);
+  model->loss_burst = 1;
+  model->origin = GST_CLOCK_TIME_NONE;
+
+  if (!description)
+    goto done;
+
+  if (!gst_structure_foreach (description, _check_field, &unknown))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "Unknown impairment field \"%s\"", unknown);
+    goto error;
+  }
+
+  if (!_get_number (description, "seed", &seed, error) ||
+      !_get_number (description, "loss", &model->loss, error) ||
+      !_get_number (description, "loss-burst", &model->loss_burst, error) ||
+      !_get_number (description, "delay", &delay, error) ||
+      !_get_number (description, "jitter", &jitter, error) ||
+      !_get_number (description, "reorder", &model->reorder, error) ||
+      !_get_number (description, "bandwidth", &bandwidth, error) ||
+      !_get_number (description, "queue-size", &queue_size, error))
+    goto error;
+
+  if (model->loss > 1 || model->reorder > 1)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "The loss and reorder probabilities must be between 0 and 1");
+    goto error;
+  }
+
+  if (model->loss_burst < 1)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "The mean loss burst length can not be below 1");
+    goto error;
+  }
+
+  model->delay = delay * GST_MSECOND;
+  model->jitter = jitter * GST_MSECOND;
+  model->bandwidth = bandwidth;
+  model->queue_size = queue_size;
+
+  trace_str = gst_structure_get_string (description, "bandwidth-trace");
+  if (trace_str)
+  {
+    model->trace = _parse_trace (trace_str, error);
+    if (!model->trace)
+      goto error;
+  }
+  else if (gst_structure_has_field (description, "bandwidth-trace"))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "The bandwidth trace must be a string");
+    goto error;
+  }
+
+ done:
+  model->rand = g_rand_new_with_seed ((guint32) seed ^
+      (stream_id * 0x9E3779B9U));
+
+  return model;
+
+ error:
+  fs_impair_model_free (model);
+  return NULL;
+}
+
+void
+fs_impair_model_free (FsImpairModel *model)
+{
+  if (model->rand)
+    g_rand_free (model->rand);
+  if (model->trace)
+    g_array_free (model->trace, TRUE);
+  g_slice_free (FsImpairModel, model);
+}
+
+static gboolean
+_is_lost (FsImpairModel *model)
+{
+  gdouble to_good, to_bad;
+
+  if (model->loss <= 0)
+    return FALSE;
+  if (model->loss >= 1)
+    return TRUE;
+
+  if (model->loss_burst <= 1)
+    return g_rand_double (model->rand) < model->loss;
+
+  /*
+   * Gilbert model: every packet of a burst is lost, the bursts have the
+   * requested mean length and the transitions are chosen so that the long
+   * term loss rate is the requested one.
+   */
+  to_good = 1 / model->loss_burst;
+  to_bad = model->loss * to_good / (1 - model->loss);
+
+  if (model->in_burst)
+    model->in_burst = g_rand_double (model->rand) >= to_good;
+  else
+    model->in_burst = g_rand_double (model->rand) < to_bad;
+
+  return model->in_burst;
+}
+
+static guint64
+_get_bitrate (FsImpairModel *model, GstClockTime now)
+{
+  GstClockTime elapsed;
+  TraceStep *steps;
+
+  if (!model->trace)
+    return model->bandwidth;
+
+  elapsed = now - model->origin;
+  steps = (TraceStep *) model->trace->data;
+
+  if (elapsed < steps[model->trace_pos].at)
+    model->trace_pos = 0;
+  while (model->trace_pos + 1 < model->trace->len &&
+      steps[model->trace_pos + 1].at <= elapsed)
+    model->trace_pos++;
+
+  return steps[model->trace_pos].bitrate;
+}
+
+/**
+ * fs_impair_model_process:
+ * @model: a #FsImpairModel
+ * @size: the size of the packet in bytes
+ * @arrival: the time at which the packet arrives, it must not go backwards
+ * @departure: location for the time at which the packet must leave
+ *
+ * Decides what happens to a packet.
+ *
+ * Returns: %FALSE if the packet must be dropped
+ */
+
+gboolean
+fs_impair_model_process (FsImpairModel *model, gsize size,
+    GstClockTime arrival, GstClockTime *departure)
+{
+  GstClockTime t = arrival;
+
+  if (model->origin == GST_CLOCK_TIME_NONE)
+  {
+    model->origin = arrival;
+    model->link_free = arrival;
+    model->last_departure = arrival;
+  }
+
+  if (_is_lost (model))
+    goto drop;
+
+  if (model->trace || model->bandwidth)
+  {
+    guint64 bitrate = _get_bitrate (model, arrival);
+
+    /* A bitrate of 0 in the trace is an outage */
+    if (bitrate == 0)
+      goto drop;
+
+    if (model->link_free > t)
+    {
+      if (model->queue_size &&
+          gst_util_uint64_scale (model->link_free - t, bitrate,
+              8 * GST_SECOND) + size > model->queue_size)
+        goto drop;
+      t = model->link_free;
+    }
+
+    t += gst_util_uint64_scale (size, 8 * GST_SECOND, bitrate);
+    model->link_free = t;
+  }
+
+  if (model->reorder > 0 && g_rand_double (model->rand) < model->reorder)
+  {
+    *departure = t;
+    return TRUE;
+  }
+
+  t += model->delay;
+  if (model->jitter)
+  {
+    gdouble offset = g_rand_double_range (model->rand,
+        -(gdouble) model->jitter, model->jitter);
+
+    if (offset < 0 && (GstClockTime) -offset > t - arrival)
+      t = arrival;
+    else
+      t += offset;
+  }
+
+  t = MAX (t, model->last_departure);
+  model->last_departure = t;
+
+  *departure = t;
+  return TRUE;
+
+ drop:
+  model->dropped++;
+  return FALSE;
+}
+
+guint64
+fs_impair_model_get_dropped (FsImpairModel *model)
+{
+  return model->dropped;
+}
@@ -0,0 +1,43 @@
+/*
+ * Farstream - Farstream Network Impairment Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-impair-model.h - The model deciding the fate of each packet
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_IMPAIR_MODEL_H__
+#define __FS_IMPAIR_MODEL_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _FsImpairModel FsImpairModel;
+
+FsImpairModel *fs_impair_model_new (const GstStructure *description,
+    guint stream_id, GError **error);
+void fs_impair_model_free (FsImpairModel *model);
+
+gboolean fs_impair_model_process (FsImpairModel *model, gsize size,
+    GstClockTime arrival, GstClockTime *departure);
+
+guint64 fs_impair_model_get_dropped (FsImpairModel *model);
+
+G_END_DECLS
+
+#endif /* __FS_IMPAIR_MODEL_H__ */
@@ -0,0 +1,991 @@
+/*
+ * Farstream - Farstream Network Impairment Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-impair-transmitter.c - A Farstream transmitter that emulates a bad
+ *   network on top of another transmitter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/**
+ * SECTION:fs-impair-transmitter
+ * @short_description: A transmitter that emulates loss, delay and a
+ *   bottleneck link on top of another transmitter
+ *
+ * The name of this transmitter is "impair". It wraps another transmitter,
+ * named by its #FsImpairTransmitter:transmitter construction property,
+ * which is "rawudp" unless it is created with fs_plugin_create(). It does
+ * not need any special privilege, so it can be used to test the congestion
+ * control on any machine.
+ *
+ * Each stream transmitter gets its own instance of the wrapped transmitter.
+ * The packets go through it unchanged, but before being sent and after
+ * being received, they go through the impairment models of that stream.
+ * They are described by the "send-impairment" and "recv-impairment"
+ * parameters of the stream transmitter, which are removed before the other
+ * parameters are passed to the wrapped transmitter. The streams created
+ * without them use the #FsImpairTransmitter:send-impairment and
+ * #FsImpairTransmitter:recv-impairment properties. The stream transmitters
+ * are those of the wrapped transmitters.
+ *
+ * An impairment is a #GstStructure with the following optional fields:
+ * <informaltable>
+ *   <tr><td>seed</td><td>The seed of the random number generator</td></tr>
+ *   <tr><td>loss</td><td>The probability that a packet is lost</td></tr>
+ *   <tr><td>loss-burst</td><td>The mean length of the loss bursts, 1 for
+ *     independent losses</td></tr>
+ *   <tr><td>delay</td><td>The propagation delay in milliseconds</td></tr>
+ *   <tr><td>jitter</td><td>The maximum variation of the delay in
+ *     milliseconds, the packets stay in order</td></tr>
+ *   <tr><td>reorder</td><td>The probability that a packet skips the delay,
+ *     overtaking the previous ones</td></tr>
+ *   <tr><td>bandwidth</td><td>The capacity of the bottleneck link in bits
+ *     per second, 0 for unlimited</td></tr>
+ *   <tr><td>queue-size</td><td>The size in bytes of the queue in front of
+ *     the bottleneck link, 0 for unlimited</td></tr>
+ *   <tr><td>bandwidth-trace</td><td>A string like
+ *     "0:2000000;5000:500000" giving the capacity of the link in bits per
+ *     second from a time in milliseconds after the first packet. It
+ *     replaces the bandwidth field, a capacity of 0 is an outage</td></tr>
+ * </informaltable>
+ *
+ * Each component and direction of a stream has its own random number
+ * generator derived from the seed, so the same description always drops
+ * the same packets.
+ * The decisions only depend on the sizes and arrival times of the packets.
+ *
+ * The known-source-packet-received signal is emitted by the wrapped
+ * transmitter, before the receive impairment.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-impair-transmitter.h"
+#include "fs-impair-filter.h"
+
+#include <farstream/fs-conference.h>
+#include <farstream/fs-plugin.h>
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY (fs_impair_transmitter_debug);
+#define GST_CAT_DEFAULT fs_impair_transmitter_debug
+
+/* Signals */
+enum
+{
+  LAST_SIGNAL
+};
+
+/* props */
+enum
+{
+  PROP_0,
+  PROP_GST_SINK,
+  PROP_GST_SRC,
+  PROP_COMPONENTS,
+  PROP_TYPE_OF_SERVICE,
+  PROP_DO_TIMESTAMP,
+  PROP_TRANSMITTER,
+  PROP_SEND_IMPAIRMENT,
+  PROP_RECV_IMPAIRMENT
+};
+
+enum
+{
+  DIRECTION_SEND,
+  DIRECTION_RECV
+};
+
+struct _FsImpairTransmitterPrivate
+{
+  gchar *transmitter_name;
+  /* Only used for the type of its stream transmitters */
+  FsTransmitter *transmitter;
+
+  /* We hold references to this element */
+  GstElement *gst_sink;
+  GstElement *gst_src;
+
+  /* We don't hold a reference to these elements, they are owned
+     by the bins */
+  /* They are tables of pointers, one per component */
+  GstElement **funnels;
+  GstElement **tees;
+
+  guint tos;
+  gboolean do_timestamp;
+
+  GMutex mutex;
+  /* Protected by the mutex */
+  GstStructure *impairments[2];
+  /* of ImpairStream */
+  GList *streams;
+};
+
+/* The wrapped transmitter and filters of one stream transmitter */
+typedef struct {
+  FsImpairTransmitter *self;
+  FsTransmitter *transmitter;
+  gulong error_handler_id;
+
+  GstElement *src;
+  GstElement *sink;
+  /* One per component */
+  FsImpairFilter **send_filters;
+  FsImpairFilter **recv_filters;
+  GstPad **tee_pads;
+  GstPad **funnel_pads;
+} ImpairStream;
+
+static GQuark impair_stream_quark = 0;
+
+#define FS_IMPAIR_TRANSMITTER_GET_PRIVATE(o)  \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), FS_TYPE_IMPAIR_TRANSMITTER,   \
+      FsImpairTransmitterPrivate))
+
+static void fs_impair_transmitter_class_init (
+    FsImpairTransmitterClass *klass);
+static void fs_impair_transmitter_init (FsImpairTransmitter *self);
+static void fs_impair_transmitter_constructed (GObject *object);
+static void fs_impair_transmitter_dispose (GObject *object);
+static void fs_impair_transmitter_finalize (GObject *object);
+
+static void fs_impair_transmitter_get_property (GObject *object,
+                                                guint prop_id,
+                                                GValue *value,
+                                                GParamSpec *pspec);
+static void fs_impair_transmitter_set_property (GObject *object,
+                                                guint prop_id,
+                                                const GValue *value,
+                                                GParamSpec *pspec);
+
+static FsStreamTransmitter *fs_impair_transmitter_new_stream_transmitter (
+    FsTransmitter *transmitter, FsParticipant *participant,
+    guint n_parameters, GParameter *parameters, GError **error);
+static GType fs_impair_transmitter_get_stream_transmitter_type (
+    FsTransmitter *transmitter);
+
+static FsImpairModel **fs_impair_transmitter_new_models (
+    FsImpairTransmitter *self, guint direction,
+    const GstStructure *description, GError **error);
+static void fs_impair_transmitter_free_models (FsImpairTransmitter *self,
+    FsImpairModel **models);
+
+
+static GObjectClass *parent_class = NULL;
+//static guint signals[LAST_SIGNAL] = { 0 };
+
+/*
+ * Lets register the plugin
+ */
+
+static GType type = 0;
+
+GType
+fs_impair_transmitter_get_type (void)
+{
+  g_assert (type);
+  return type;
+}
+
+static GType
+fs_impair_transmitter_register_type (FsPlugin *module)
+{
+  static const GTypeInfo info = {
+    sizeof (FsImpairTransmitterClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_impair_transmitter_class_init,
+    NULL,
+    NULL,
+    sizeof (FsImpairTransmitter),
+    0,
+    (GInstanceInitFunc) fs_impair_transmitter_init
+  };
+
+  GST_DEBUG_CATEGORY_INIT (fs_impair_transmitter_debug,
+      "fsimpairtransmitter", 0,
+      "Farstream network impairment transmitter");
+
+  fs_impair_filter_register_type (module);
+
+  impair_stream_quark = g_quark_from_static_string ("fs-impair-stream");
+
+  type = g_type_module_register_type (G_TYPE_MODULE (module),
+    FS_TYPE_TRANSMITTER, "FsImpairTransmitter", &info, 0);
+
+  return type;
+}
+
+FS_INIT_PLUGIN (fs_impair_transmitter_register_type)
+
+static void
+fs_impair_transmitter_class_init (FsImpairTransmitterClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  FsTransmitterClass *transmitter_class = FS_TRANSMITTER_CLASS (klass);
+
+  parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->set_property = fs_impair_transmitter_set_property;
+  gobject_class->get_property = fs_impair_transmitter_get_property;
+
+  gobject_class->constructed = fs_impair_transmitter_constructed;
+
+  g_object_class_override_property (gobject_class, PROP_GST_SRC, "gst-src");
+  g_object_class_override_property (gobject_class, PROP_GST_SINK, "gst-sink");
+  g_object_class_override_property (gobject_class, PROP_COMPONENTS,
+    "components");
+  g_object_class_override_property (gobject_class, PROP_TYPE_OF_SERVICE,
+    "tos");
+  g_object_class_override_property (gobject_class, PROP_DO_TIMESTAMP,
+    "do-timestamp");
+
+  /**
+   * FsImpairTransmitter:transmitter:
+   *
+   * The name of the wrapped transmitter. fs_transmitter_new() leaves it to
+   * "rawudp", to wrap another one, create the transmitter with
+   * fs_plugin_create() and set it.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_TRANSMITTER,
+      g_param_spec_string ("transmitter",
+          "The wrapped transmitter",
+          "The name of the transmitter that sends and receives the packets",
+          "rawudp",
+          G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS));
+
+  /**
+   * FsImpairTransmitter:send-impairment:
+   *
+   * The impairment applied to the packets before they are sent by the
+   * streams created afterwards without a "send-impairment" parameter, see
+   * the description of the transmitter for its fields. %NULL lets them
+   * through unchanged.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_SEND_IMPAIRMENT,
+      g_param_spec_boxed ("send-impairment",
+          "The impairment of the sent packets",
+          "A GstStructure describing the impairment of the sent packets",
+          GST_TYPE_STRUCTURE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * FsImpairTransmitter:recv-impairment:
+   *
+   * The impairment applied to the packets after they are received by the
+   * streams created afterwards without a "recv-impairment" parameter, see
+   * the description of the transmitter for its fields. %NULL lets them
+   * through unchanged.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_RECV_IMPAIRMENT,
+      g_param_spec_boxed ("recv-impairment",
+          "The impairment of the received packets",
+          "A GstStructure describing the impairment of the received packets",
+          GST_TYPE_STRUCTURE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  transmitter_class->new_stream_transmitter =
+    fs_impair_transmitter_new_stream_transmitter;
+  transmitter_class->get_stream_transmitter_type =
+    fs_impair_transmitter_get_stream_transmitter_type;
+
+  gobject_class->dispose = fs_impair_transmitter_dispose;
+  gobject_class->finalize = fs_impair_transmitter_finalize;
+
+  g_type_class_add_private (klass, sizeof (FsImpairTransmitterPrivate));
+}
+
+static void
+fs_impair_transmitter_init (FsImpairTransmitter *self)
+{
+
+  /* member init */
+  self->priv = FS_IMPAIR_TRANSMITTER_GET_PRIVATE (self);
+
+  self->components = 2;
+  self->priv->do_timestamp = TRUE;
+
+  g_mutex_init (&self->priv->mutex);
+}
+
+static void
+_wrapped_error (FsTransmitter *transmitter, gint errorno, gchar *error_msg,
+    gpointer user_data)
+{
+  fs_transmitter_emit_error (FS_TRANSMITTER (user_data), errorno, error_msg);
+}
+
+static gboolean
+_link_pads (GstElement *src, const gchar *srcname, GstElement *sink,
+    const gchar *sinkname)
+{
+  GstPad *srcpad = gst_element_get_static_pad (src, srcname);
+  GstPad *sinkpad = gst_element_get_static_pad (sink, sinkname);
+  GstPadLinkReturn ret = GST_PAD_LINK_REFUSED;
+
+  if (srcpad && sinkpad)
+    ret = gst_pad_link (srcpad, sinkpad);
+
+  if (srcpad)
+    gst_object_unref (srcpad);
+  if (sinkpad)
+    gst_object_unref (sinkpad);
+
+  return GST_PAD_LINK_SUCCESSFUL (ret);
+}
+
+static void
+_add_ghost_pad (GstElement *bin, GstElement *element, const gchar *padname,
+    const gchar *ghostname)
+{
+  GstPad *pad = gst_element_get_static_pad (element, padname);
+  GstPad *ghostpad = gst_ghost_pad_new (ghostname, pad);
+
+  gst_object_unref (pad);
+
+  gst_pad_set_active (ghostpad, TRUE);
+  gst_element_add_pad (bin, ghostpad);
+}
+
+static GstElement *
+_add_element (GstElement *bin, const gchar *factory, GError **error)
+{
+  GstElement *element = gst_element_factory_make (factory, NULL);
+
+  if (!element)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not make the %s element", factory);
+    return NULL;
+  }
+
+  if (!gst_bin_add (GST_BIN (bin), element))
+  {
+    gst_object_unref (element);
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not add the %s element to the transmitter bin", factory);
+    return NULL;
+  }
+
+  return element;
+}
+
+static void
+fs_impair_transmitter_constructed (GObject *object)
+{
+  FsImpairTransmitter *self = FS_IMPAIR_TRANSMITTER_CAST (object);
+  FsTransmitter *trans = FS_TRANSMITTER_CAST (self);
+  int c; /* component_id */
+
+  /* We waste one space in order to have the index be the component_id */
+  self->priv->funnels = g_new0 (GstElement *, self->components+1);
+  self->priv->tees = g_new0 (GstElement *, self->components+1);
+
+  if (!self->priv->transmitter_name || !self->priv->transmitter_name[0] ||
+      !strcmp (self->priv->transmitter_name, "impair"))
+  {
+    trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "The impair transmitter must wrap another transmitter");
+    goto out;
+  }
+
+  /* Checks that the wrapped transmitter exists */
+  self->priv->transmitter = fs_transmitter_new (self->priv->transmitter_name,
+      self->components, self->priv->tos, &trans->construction_error);
+  if (!self->priv->transmitter)
+    goto out;
+
+  self->priv->gst_src = gst_bin_new (NULL);
+  gst_object_ref (self->priv->gst_src);
+
+  self->priv->gst_sink = gst_bin_new (NULL);
+  g_object_set (G_OBJECT (self->priv->gst_sink),
+      "async-handling", TRUE,
+      NULL);
+  gst_object_ref (self->priv->gst_sink);
+
+  /* The streams are plugged between a tee and a funnel per component */
+
+  for (c = 1; c <= self->components; c++) {
+    GstElement *fakesink;
+    gchar *padname;
+
+    self->priv->funnels[c] = _add_element (self->priv->gst_src, "funnel",
+        &trans->construction_error);
+    if (!self->priv->funnels[c])
+      goto out;
+    padname = g_strdup_printf ("src_%u", c);
+    _add_ghost_pad (self->priv->gst_src, self->priv->funnels[c], "src",
+        padname);
+    g_free (padname);
+
+    self->priv->tees[c] = _add_element (self->priv->gst_sink, "tee",
+        &trans->construction_error);
+    if (!self->priv->tees[c])
+      goto out;
+    padname = g_strdup_printf ("sink_%u", c);
+    _add_ghost_pad (self->priv->gst_sink, self->priv->tees[c], "sink",
+        padname);
+    g_free (padname);
+
+    /* So the tee is linked even without any stream */
+    fakesink = _add_element (self->priv->gst_sink, "fakesink",
+        &trans->construction_error);
+    if (!fakesink)
+      goto out;
+    g_object_set (fakesink,
+        "async", FALSE,
+        "sync" , FALSE,
+        NULL);
+    if (!gst_element_link_pads (self->priv->tees[c], "src_%u", fakesink,
+            "sink"))
+    {
+      trans->construction_error = g_error_new (FS_ERROR,
+          FS_ERROR_CONSTRUCTION,
+          "Could not link the tee to the fakesink");
+      goto out;
+    }
+  }
+
+ out:
+  GST_CALL_PARENT (G_OBJECT_CLASS, constructed, (object));
+}
+
+static void
+fs_impair_transmitter_dispose (GObject *object)
+{
+  FsImpairTransmitter *self = FS_IMPAIR_TRANSMITTER (object);
+
+  if (self->priv->gst_src) {
+    gst_object_unref (self->priv->gst_src);
+    self->priv->gst_src = NULL;
+  }
+
+  if (self->priv->gst_sink) {
+    gst_object_unref (self->priv->gst_sink);
+    self->priv->gst_sink = NULL;
+  }
+
+  if (self->priv->transmitter) {
+    g_object_unref (self->priv->transmitter);
+    self->priv->transmitter = NULL;
+  }
+
+  parent_class->dispose (object);
+}
+
+static void
+fs_impair_transmitter_finalize (GObject *object)
+{
+  FsImpairTransmitter *self = FS_IMPAIR_TRANSMITTER (object);
+  guint i;
+
+  g_free (self->priv->funnels);
+  g_free (self->priv->tees);
+  g_free (self->priv->transmitter_name);
+
+  for (i = 0; i < G_N_ELEMENTS (self->priv->impairments); i++)
+    if (self->priv->impairments[i])
+      gst_structure_free (self->priv->impairments[i]);
+
+  g_mutex_clear (&self->priv->mutex);
+
+  parent_class->finalize (object);
+}
+
+static void
+fs_impair_transmitter_get_property (GObject *object,
+                             guint prop_id,
+                             GValue *value,
+                             GParamSpec *pspec)
+{
+  FsImpairTransmitter *self = FS_IMPAIR_TRANSMITTER (object);
+
+  switch (prop_id) {
+    case PROP_GST_SINK:
+      g_value_set_object (value, self->priv->gst_sink);
+      break;
+    case PROP_GST_SRC:
+      g_value_set_object (value, self->priv->gst_src);
+      break;
+    case PROP_COMPONENTS:
+      g_value_set_uint (value, self->components);
+      break;
+    case PROP_TYPE_OF_SERVICE:
+      g_value_set_uint (value, self->priv->tos);
+      break;
+    case PROP_DO_TIMESTAMP:
+      g_value_set_boolean (value, self->priv->do_timestamp);
+      break;
+    case PROP_TRANSMITTER:
+      g_value_set_string (value, self->priv->transmitter_name);
+      break;
+    case PROP_SEND_IMPAIRMENT:
+      g_mutex_lock (&self->priv->mutex);
+      g_value_set_boxed (value, self->priv->impairments[DIRECTION_SEND]);
+      g_mutex_unlock (&self->priv->mutex);
+      break;
+    case PROP_RECV_IMPAIRMENT:
+      g_mutex_lock (&self->priv->mutex);
+      g_value_set_boxed (value, self->priv->impairments[DIRECTION_RECV]);
+      g_mutex_unlock (&self->priv->mutex);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_impair_transmitter_set_property (GObject *object,
+                                    guint prop_id,
+                                    const GValue *value,
+                                    GParamSpec *pspec)
+{
+  FsImpairTransmitter *self = FS_IMPAIR_TRANSMITTER (object);
+  GError *error = NULL;
+
+  switch (prop_id) {
+    case PROP_COMPONENTS:
+      self->components = g_value_get_uint (value);
+      break;
+    case PROP_TYPE_OF_SERVICE:
+    case PROP_DO_TIMESTAMP:
+      {
+        GList *item;
+
+        g_mutex_lock (&self->priv->mutex);
+        if (prop_id == PROP_TYPE_OF_SERVICE)
+          self->priv->tos = g_value_get_uint (value);
+        else
+          self->priv->do_timestamp = g_value_get_boolean (value);
+        for (item = self->priv->streams; item; item = item->next)
+        {
+          ImpairStream *is = item->data;
+
+          g_object_set_property (G_OBJECT (is->transmitter),
+              g_param_spec_get_name (pspec), value);
+        }
+        g_mutex_unlock (&self->priv->mutex);
+      }
+      break;
+    case PROP_TRANSMITTER:
+      g_free (self->priv->transmitter_name);
+      self->priv->transmitter_name = g_value_dup_string (value);
+      break;
+    case PROP_SEND_IMPAIRMENT:
+    case PROP_RECV_IMPAIRMENT:
+      {
+        const GstStructure *description = g_value_get_boxed (value);
+        guint direction = (prop_id == PROP_SEND_IMPAIRMENT) ?
+          DIRECTION_SEND : DIRECTION_RECV;
+        FsImpairModel **models;
+
+        /* Only to validate it */
+        models = fs_impair_transmitter_new_models (self, direction,
+            description, &error);
+        if (error)
+        {
+          GST_WARNING ("Ignoring the invalid %s: %s",
+              g_param_spec_get_name (pspec), error->message);
+          g_clear_error (&error);
+          break;
+        }
+        fs_impair_transmitter_free_models (self, models);
+
+        g_mutex_lock (&self->priv->mutex);
+        if (self->priv->impairments[direction])
+          gst_structure_free (self->priv->impairments[direction]);
+        self->priv->impairments[direction] =
+          description ? gst_structure_copy (description) : NULL;
+        g_mutex_unlock (&self->priv->mutex);
+      }
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_impair_transmitter_free_models (FsImpairTransmitter *self,
+    FsImpairModel **models)
+{
+  gint c;
+
+  if (!models)
+    return;
+
+  for (c = 1; c <= self->components; c++)
+    if (models[c])
+      fs_impair_model_free (models[c]);
+  g_free (models);
+}
+
+/*
+ * Builds the models of all the components of a stream, or returns %NULL
+ * without setting @error if there is no @description.
+ */
+
+static FsImpairModel **
+fs_impair_transmitter_new_models (FsImpairTransmitter *self,
+    guint direction, const GstStructure *description, GError **error)
+{
+  FsImpairModel **models;
+  gint c;
+
+  if (!description)
+    return NULL;
+
+  models = g_new0 (FsImpairModel *, self->components + 1);
+
+  for (c = 1; c <= self->components; c++)
+  {
+    models[c] = fs_impair_model_new (description, c * 2 + direction, error);
+
+    if (!models[c])
+    {
+      fs_impair_transmitter_free_models (self, models);
+      return NULL;
+    }
+  }
+
+  return models;
+}
+
+static void
+_remove_element (GstElement *element)
+{
+  GstObject *parent;
+
+  if (!element)
+    return;
+
+  gst_element_set_locked_state (element, TRUE);
+  gst_element_set_state (element, GST_STATE_NULL);
+
+  parent = gst_object_get_parent (GST_OBJECT (element));
+  if (parent)
+  {
+    gst_bin_remove (GST_BIN (parent), element);
+    gst_object_unref (parent);
+  }
+}
+
+static void
+_release_pad (GstElement *element, GstPad *pad)
+{
+  if (!pad)
+    return;
+
+  gst_element_release_request_pad (element, pad);
+  gst_object_unref (pad);
+}
+
+/* Called when the stream transmitter is finalized */
+
+static void
+impair_stream_free (gpointer data)
+{
+  ImpairStream *is = data;
+  FsImpairTransmitter *self = is->self;
+  gint c;
+
+  g_mutex_lock (&self->priv->mutex);
+  self->priv->streams = g_list_remove (self->priv->streams, is);
+  g_mutex_unlock (&self->priv->mutex);
+
+  for (c = 1; c <= self->components; c++)
+  {
+    _release_pad (self->priv->tees[c], is->tee_pads[c]);
+    _release_pad (self->priv->funnels[c], is->funnel_pads[c]);
+
+    _remove_element (GST_ELEMENT_CAST (is->send_filters[c]));
+    _remove_element (GST_ELEMENT_CAST (is->recv_filters[c]));
+  }
+
+  _remove_element (is->sink);
+  _remove_element (is->src);
+  if (is->sink)
+    gst_object_unref (is->sink);
+  if (is->src)
+    gst_object_unref (is->src);
+
+  if (is->error_handler_id)
+    g_signal_handler_disconnect (is->transmitter, is->error_handler_id);
+  g_object_unref (is->transmitter);
+
+  g_free (is->send_filters);
+  g_free (is->recv_filters);
+  g_free (is->tee_pads);
+  g_free (is->funnel_pads);
+  g_slice_free (ImpairStream, is);
+}
+
+/*
+ * Plugs a new instance of the wrapped transmitter between the tees and the
+ * funnels, with the filters of the stream in front of it. The filters take
+ * the models.
+ */
+
+static ImpairStream *
+impair_stream_new (FsImpairTransmitter *self, FsImpairModel **models[2],
+    GError **error)
+{
+  ImpairStream *is = g_slice_new0 (ImpairStream);
+  guint tos;
+  gboolean do_timestamp;
+  gint c;
+
+  is->self = self;
+  is->send_filters = g_new0 (FsImpairFilter *, self->components + 1);
+  is->recv_filters = g_new0 (FsImpairFilter *, self->components + 1);
+  is->tee_pads = g_new0 (GstPad *, self->components + 1);
+  is->funnel_pads = g_new0 (GstPad *, self->components + 1);
+
+  g_mutex_lock (&self->priv->mutex);
+  tos = self->priv->tos;
+  do_timestamp = self->priv->do_timestamp;
+  g_mutex_unlock (&self->priv->mutex);
+
+  is->transmitter = fs_transmitter_new (self->priv->transmitter_name,
+      self->components, tos, error);
+  if (!is->transmitter)
+    goto error;
+  g_object_set (is->transmitter, "do-timestamp", do_timestamp, NULL);
+
+  is->error_handler_id = g_signal_connect (is->transmitter, "error",
+      G_CALLBACK (_wrapped_error), self);
+
+  g_object_get (is->transmitter,
+      "gst-src", &is->src,
+      "gst-sink", &is->sink,
+      NULL);
+
+  if (!gst_bin_add (GST_BIN (self->priv->gst_src), is->src) ||
+      !gst_bin_add (GST_BIN (self->priv->gst_sink), is->sink))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not add the %s elements to the transmitter bins",
+        self->priv->transmitter_name);
+    goto error;
+  }
+
+  for (c = 1; c <= self->components; c++)
+  {
+    gchar *padname;
+    gboolean linked;
+
+    is->recv_filters[c] = fs_impair_filter_new ();
+    fs_impair_filter_set_model (is->recv_filters[c],
+        models[DIRECTION_RECV] ? models[DIRECTION_RECV][c] : NULL);
+    if (models[DIRECTION_RECV])
+      models[DIRECTION_RECV][c] = NULL;
+    gst_bin_add (GST_BIN (self->priv->gst_src),
+        GST_ELEMENT (is->recv_filters[c]));
+
+    is->send_filters[c] = fs_impair_filter_new ();
+    fs_impair_filter_set_model (is->send_filters[c],
+        models[DIRECTION_SEND] ? models[DIRECTION_SEND][c] : NULL);
+    if (models[DIRECTION_SEND])
+      models[DIRECTION_SEND][c] = NULL;
+    gst_bin_add (GST_BIN (self->priv->gst_sink),
+        GST_ELEMENT (is->send_filters[c]));
+
+    is->funnel_pads[c] = gst_element_get_request_pad (self->priv->funnels[c],
+        "sink_%u");
+    is->tee_pads[c] = gst_element_get_request_pad (self->priv->tees[c],
+        "src_%u");
+
+    padname = g_strdup_printf ("src_%u", c);
+    linked = _link_pads (is->src, padname,
+        GST_ELEMENT (is->recv_filters[c]), "sink");
+    g_free (padname);
+
+    padname = g_strdup_printf ("sink_%u", c);
+    linked = linked && _link_pads (GST_ELEMENT (is->send_filters[c]), "src",
+        is->sink, padname);
+    g_free (padname);
+
+    linked = linked && is->funnel_pads[c] && is->tee_pads[c];
+    if (linked)
+    {
+      GstPad *pad;
+
+      pad = gst_element_get_static_pad (GST_ELEMENT (is->recv_filters[c]),
+          "src");
+      linked = GST_PAD_LINK_SUCCESSFUL (gst_pad_link (pad,
+              is->funnel_pads[c]));
+      gst_object_unref (pad);
+
+      pad = gst_element_get_static_pad (GST_ELEMENT (is->send_filters[c]),
+          "sink");
+      linked = linked && GST_PAD_LINK_SUCCESSFUL (gst_pad_link (
+              is->tee_pads[c], pad));
+      gst_object_unref (pad);
+    }
+
+    if (!linked)
+    {
+      g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+          "Could not link the impairment filters of component %d", c);
+      goto error;
+    }
+  }
+
+  /* Downstream first, so nothing is pushed into an element that isn't
+   * ready yet */
+  gst_element_sync_state_with_parent (is->sink);
+  for (c = 1; c <= self->components; c++)
+  {
+    gst_element_sync_state_with_parent (GST_ELEMENT (is->send_filters[c]));
+    gst_element_sync_state_with_parent (GST_ELEMENT (is->recv_filters[c]));
+  }
+  gst_element_sync_state_with_parent (is->src);
+
+  g_mutex_lock (&self->priv->mutex);
+  self->priv->streams = g_list_prepend (self->priv->streams, is);
+  g_mutex_unlock (&self->priv->mutex);
+
+  return is;
+
+ error:
+  if (is->transmitter)
+  {
+    /* It is not in the list yet, which impair_stream_free() doesn't mind */
+    impair_stream_free (is);
+  }
+  else
+  {
+    g_free (is->send_filters);
+    g_free (is->recv_filters);
+    g_free (is->tee_pads);
+    g_free (is->funnel_pads);
+    g_slice_free (ImpairStream, is);
+  }
+  return NULL;
+}
+
+
+/**
+ * fs_impair_transmitter_new_stream_impair_transmitter:
+ * @transmitter: a #FsTranmitter
+ * @participant: the #FsParticipant for which the #FsStream using this
+ * new #FsStreamTransmitter is created
+ *
+ * This function will create a new #FsStreamTransmitter of a new instance
+ * of the wrapped transmitter, with the impairments found in the parameters.
+ *
+ * Returns: a new #FsStreamTransmitter
+ */
+
+static FsStreamTransmitter *
+fs_impair_transmitter_new_stream_transmitter (FsTransmitter *transmitter,
+  FsParticipant *participant, guint n_parameters, GParameter *parameters,
+  GError **error)
+{
+  FsImpairTransmitter *self = FS_IMPAIR_TRANSMITTER (transmitter);
+  GParameter *wrapped_parameters = g_new0 (GParameter, n_parameters + 1);
+  guint n_wrapped_parameters = 0;
+  const GstStructure *descriptions[2] = {NULL, NULL};
+  gboolean has_description[2] = {FALSE, FALSE};
+  FsImpairModel **models[2] = {NULL, NULL};
+  FsStreamTransmitter *st = NULL;
+  ImpairStream *is;
+  guint i;
+
+  for (i = 0; i < n_parameters; i++)
+  {
+    guint direction;
+
+    if (!strcmp (parameters[i].name, "send-impairment"))
+      direction = DIRECTION_SEND;
+    else if (!strcmp (parameters[i].name, "recv-impairment"))
+      direction = DIRECTION_RECV;
+    else
+    {
+      /* The values are only borrowed */
+      wrapped_parameters[n_wrapped_parameters++] = parameters[i];
+      continue;
+    }
+
+    if (!G_VALUE_HOLDS (&parameters[i].value, GST_TYPE_STRUCTURE))
+    {
+      g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+          "The %s parameter must be a GstStructure", parameters[i].name);
+      goto out;
+    }
+
+    descriptions[direction] = gst_value_get_structure (&parameters[i].value);
+    has_description[direction] = TRUE;
+  }
+
+  g_mutex_lock (&self->priv->mutex);
+  for (i = 0; i < 2; i++)
+  {
+    if (!has_description[i])
+      descriptions[i] = self->priv->impairments[i];
+    models[i] = fs_impair_transmitter_new_models (self, i, descriptions[i],
+        error);
+    if (descriptions[i] && !models[i])
+    {
+      g_mutex_unlock (&self->priv->mutex);
+      goto out;
+    }
+  }
+  g_mutex_unlock (&self->priv->mutex);
+
+  is = impair_stream_new (self, models, error);
+  if (!is)
+    goto out;
+
+  st = fs_transmitter_new_stream_transmitter (is->transmitter,
+      participant, n_wrapped_parameters, wrapped_parameters, error);
+  if (!st)
+  {
+    impair_stream_free (is);
+    goto out;
+  }
+
+  /* The wrapped transmitter must outlive its stream transmitter */
+  g_object_set_qdata_full (G_OBJECT (st), impair_stream_quark, is,
+      impair_stream_free);
+
+ out:
+  fs_impair_transmitter_free_models (self, models[DIRECTION_SEND]);
+  fs_impair_transmitter_free_models (self, models[DIRECTION_RECV]);
+  g_free (wrapped_parameters);
+  return st;
+}
+
+static GType
+fs_impair_transmitter_get_stream_transmitter_type (
+    FsTransmitter *transmitter)
+{
+  FsImpairTransmitter *self = FS_IMPAIR_TRANSMITTER (transmitter);
+
+  return fs_transmitter_get_stream_transmitter_type (self->priv->transmitter);
+}
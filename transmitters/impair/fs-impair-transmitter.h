@@ -0,0 +1,88 @@
+/*
+ * Farstream - Farstream Network Impairment Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-impair-transmitter.h - A Farstream transmitter that emulates a bad
+ *   network on top of another transmitter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_IMPAIR_TRANSMITTER_H__
+#define __FS_IMPAIR_TRANSMITTER_H__
+
+#include <farstream/fs-transmitter.h>
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_IMPAIR_TRANSMITTER \
+  (fs_impair_transmitter_get_type ())
+#define FS_IMPAIR_TRANSMITTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_IMPAIR_TRANSMITTER, \
+    FsImpairTransmitter))
+#define FS_IMPAIR_TRANSMITTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_IMPAIR_TRANSMITTER, \
+    FsImpairTransmitterClass))
+#define FS_IS_IMPAIR_TRANSMITTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_IMPAIR_TRANSMITTER))
+#define FS_IS_IMPAIR_TRANSMITTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_IMPAIR_TRANSMITTER))
+#define FS_IMPAIR_TRANSMITTER_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), FS_TYPE_IMPAIR_TRANSMITTER, \
+    FsImpairTransmitterClass))
+#define FS_IMPAIR_TRANSMITTER_CAST(obj) ((FsImpairTransmitter *) (obj))
+
+typedef struct _FsImpairTransmitter FsImpairTransmitter;
+typedef struct _FsImpairTransmitterClass FsImpairTransmitterClass;
+typedef struct _FsImpairTransmitterPrivate FsImpairTransmitterPrivate;
+
+/**
+ * FsImpairTransmitterClass:
+ * @parent_class: Our parent
+ *
+ * The network impairment transmitter class
+ */
+
+struct _FsImpairTransmitterClass
+{
+  FsTransmitterClass parent_class;
+};
+
+/**
+ * FsImpairTransmitter:
+ * @parent: Parent object
+ *
+ * All members are private, access them using methods and properties
+ */
+struct _FsImpairTransmitter
+{
+  FsTransmitter parent;
+
+  /* The number of components (READONLY) */
+  gint components;
+
+  /*< private >*/
+  FsImpairTransmitterPrivate *priv;
+};
+
+GType fs_impair_transmitter_get_type (void);
+
+G_END_DECLS
+
+#endif /* __FS_IMPAIR_TRANSMITTER_H__ */
@@ -0,0 +1,529 @@
+/*
+ * Farstream - Farstream In-Process Stream Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-inproc-stream-transmitter.c - A Farstream in-process stream transmitter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+/**
+ * SECTION:fs-inproc-stream-transmitter
+ * @short_description: A stream transmitter object for in-process streams
+ *
+ * The name of this transmitter is "inproc".
+ *
+ * This transmitter connects streams of conferences that live in the same
+ * process. The buffers are handed from one pipeline to the other without
+ * being copied and without going through any socket, which makes it
+ * possible to measure the cost of the conferences themselves.
+ *
+ * Each stream has a name for each of its components. When the local
+ * candidates are gathered, the name is taken from the "ip" field of the
+ * #FsStreamTransmitter:preferred-local-candidates of the same component, or
+ * a unique name is generated, and a #FsStreamTransmitter::new-local-candidate
+ * signal is emitted with the name in its "ip" field.
+ *
+ * To receive from another stream, give its candidates to
+ * fs_stream_transmitter_force_remote_candidates(). The other stream must
+ * have gathered its candidates already, otherwise the call fails. Many
+ * streams can receive from the same stream.
+ *
+ * The buffers are pushed into the receiving pipeline from the streaming
+ * thread of the sender.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-inproc-stream-transmitter.h"
+#include "fs-inproc-transmitter.h"
+
+#include <farstream/fs-candidate.h>
+#include <farstream/fs-conference.h>
+
+#include <gst/gst.h>
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY_EXTERN (fs_inproc_transmitter_debug);
+#define GST_CAT_DEFAULT fs_inproc_transmitter_debug
+
+/* Signals */
+enum
+{
+  LAST_SIGNAL
+};
+
+/* props */
+enum
+{
+  PROP_0,
+  PROP_SENDING,
+  PROP_PREFERRED_LOCAL_CANDIDATES
+};
+
+struct _FsInprocStreamTransmitterPrivate
+{
+  /* We don't actually hold a ref to this,
+   * But since our parent FsStream can not exist without its parent
+   * FsSession, we should be safe
+   */
+  FsInprocTransmitter *transmitter;
+
+  GList *preferred_local_candidates;
+
+  GMutex mutex;
+
+  /* Protected by the mutex */
+  gboolean sending;
+
+  /* Protected by the mutex */
+  FsCandidate **local_candidates;
+
+  InprocOutlet **outlets;
+  InprocInlet **inlets;
+};
+
+#define FS_INPROC_STREAM_TRANSMITTER_GET_PRIVATE(o)  \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), FS_TYPE_INPROC_STREAM_TRANSMITTER, \
+                                FsInprocStreamTransmitterPrivate))
+
+#define FS_INPROC_STREAM_TRANSMITTER_LOCK(s) \
+  g_mutex_lock (&(s)->priv->mutex)
+#define FS_INPROC_STREAM_TRANSMITTER_UNLOCK(s) \
+  g_mutex_unlock (&(s)->priv->mutex)
+
+static void fs_inproc_stream_transmitter_class_init (
+    FsInprocStreamTransmitterClass *klass);
+static void fs_inproc_stream_transmitter_init (FsInprocStreamTransmitter *self);
+static void fs_inproc_stream_transmitter_dispose (GObject *object);
+static void fs_inproc_stream_transmitter_finalize (GObject *object);
+
+static void fs_inproc_stream_transmitter_get_property (GObject *object,
+                                                guint prop_id,
+                                                GValue *value,
+                                                GParamSpec *pspec);
+static void fs_inproc_stream_transmitter_set_property (GObject *object,
+                                                guint prop_id,
+                                                const GValue *value,
+                                                GParamSpec *pspec);
+
+static gboolean fs_inproc_stream_transmitter_force_remote_candidates (
+    FsStreamTransmitter *streamtransmitter, GList *candidates,
+    GError **error);
+static gboolean fs_inproc_stream_transmitter_gather_local_candidates (
+    FsStreamTransmitter *streamtransmitter,
+    GError **error);
+
+
+static GObjectClass *parent_class = NULL;
+// static guint signals[LAST_SIGNAL] = { 0 };
+
+/* Used to generate unique names */
+static gint name_counter = 0;
+
+static GType type = 0;
+
+GType
+fs_inproc_stream_transmitter_get_type (void)
+{
+  return type;
+}
+
+GType
+fs_inproc_stream_transmitter_register_type (FsPlugin *module)
+{
+  static const GTypeInfo info = {
+    sizeof (FsInprocStreamTransmitterClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_inproc_stream_transmitter_class_init,
+    NULL,
+    NULL,
+    sizeof (FsInprocStreamTransmitter),
+    0,
+    (GInstanceInitFunc) fs_inproc_stream_transmitter_init
+  };
+
+  type = g_type_module_register_type (G_TYPE_MODULE (module),
+    FS_TYPE_STREAM_TRANSMITTER, "FsInprocStreamTransmitter", &info, 0);
+
+  return type;
+}
+
+static void
+fs_inproc_stream_transmitter_class_init (FsInprocStreamTransmitterClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  FsStreamTransmitterClass *streamtransmitterclass =
+    FS_STREAM_TRANSMITTER_CLASS (klass);
+
+  parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->set_property = fs_inproc_stream_transmitter_set_property;
+  gobject_class->get_property = fs_inproc_stream_transmitter_get_property;
+
+  streamtransmitterclass->force_remote_candidates =
+    fs_inproc_stream_transmitter_force_remote_candidates;
+  streamtransmitterclass->gather_local_candidates =
+    fs_inproc_stream_transmitter_gather_local_candidates;
+
+  g_object_class_override_property (gobject_class, PROP_SENDING, "sending");
+  g_object_class_override_property (gobject_class,
+      PROP_PREFERRED_LOCAL_CANDIDATES, "preferred-local-candidates");
+
+  gobject_class->dispose = fs_inproc_stream_transmitter_dispose;
+  gobject_class->finalize = fs_inproc_stream_transmitter_finalize;
+
+  g_type_class_add_private (klass, sizeof (FsInprocStreamTransmitterPrivate));
+}
+
+static void
+fs_inproc_stream_transmitter_init (FsInprocStreamTransmitter *self)
+{
+  /* member init */
+  self->priv = FS_INPROC_STREAM_TRANSMITTER_GET_PRIVATE (self);
+
+  self->priv->sending = TRUE;
+
+  g_mutex_init (&self->priv->mutex);
+}
+
+static void
+fs_inproc_stream_transmitter_dispose (GObject *object)
+{
+  FsInprocStreamTransmitter *self = FS_INPROC_STREAM_TRANSMITTER (object);
+  gint c; /* component_id */
+
+  for (c = 1; self->priv->inlets && c <= self->priv->transmitter->components;
+       c++)
+  {
+    if (self->priv->inlets[c])
+      fs_inproc_transmitter_check_inlet (self->priv->transmitter,
+          self->priv->inlets[c], NULL);
+    self->priv->inlets[c] = NULL;
+
+    if (self->priv->outlets[c])
+      fs_inproc_transmitter_check_outlet (self->priv->transmitter,
+          self->priv->outlets[c], NULL);
+    self->priv->outlets[c] = NULL;
+  }
+
+  parent_class->dispose (object);
+}
+
+static void
+fs_inproc_stream_transmitter_finalize (GObject *object)
+{
+  FsInprocStreamTransmitter *self = FS_INPROC_STREAM_TRANSMITTER (object);
+  gint c; /* component_id */
+
+  fs_candidate_list_destroy (self->priv->preferred_local_candidates);
+
+  if (self->priv->local_candidates)
+  {
+    for (c = 1; c <= self->priv->transmitter->components; c++)
+      if (self->priv->local_candidates[c])
+        fs_candidate_destroy (self->priv->local_candidates[c]);
+    g_free (self->priv->local_candidates);
+  }
+
+  g_free (self->priv->outlets);
+  g_free (self->priv->inlets);
+  g_mutex_clear (&self->priv->mutex);
+
+  parent_class->finalize (object);
+}
+
+static void
+fs_inproc_stream_transmitter_get_property (GObject *object,
+                                           guint prop_id,
+                                           GValue *value,
+                                           GParamSpec *pspec)
+{
+  FsInprocStreamTransmitter *self = FS_INPROC_STREAM_TRANSMITTER (object);
+
+  switch (prop_id)
+  {
+    case PROP_SENDING:
+      FS_INPROC_STREAM_TRANSMITTER_LOCK (self);
+      g_value_set_boolean (value, self->priv->sending);
+      FS_INPROC_STREAM_TRANSMITTER_UNLOCK (self);
+      break;
+    case PROP_PREFERRED_LOCAL_CANDIDATES:
+      g_value_set_boxed (value, self->priv->preferred_local_candidates);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_inproc_stream_transmitter_set_property (GObject *object,
+                                           guint prop_id,
+                                           const GValue *value,
+                                           GParamSpec *pspec)
+{
+  FsInprocStreamTransmitter *self = FS_INPROC_STREAM_TRANSMITTER (object);
+
+  switch (prop_id) {
+    case PROP_SENDING:
+      FS_INPROC_STREAM_TRANSMITTER_LOCK (self);
+      self->priv->sending = g_value_get_boolean (value);
+      if (self->priv->outlets && self->priv->outlets[1])
+        fs_inproc_transmitter_outlet_set_sending (self->priv->transmitter,
+            self->priv->outlets[1], self->priv->sending);
+      FS_INPROC_STREAM_TRANSMITTER_UNLOCK (self);
+      break;
+    case PROP_PREFERRED_LOCAL_CANDIDATES:
+      self->priv->preferred_local_candidates = g_value_dup_boxed (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static gboolean
+fs_inproc_stream_transmitter_build (FsInprocStreamTransmitter *self,
+  GError **error)
+{
+  self->priv->outlets = g_new0 (InprocOutlet *,
+      self->priv->transmitter->components + 1);
+  self->priv->inlets = g_new0 (InprocInlet *,
+      self->priv->transmitter->components + 1);
+  self->priv->local_candidates = g_new0 (FsCandidate *,
+      self->priv->transmitter->components + 1);
+
+  return TRUE;
+}
+
+static void
+got_buffer_func (GstBuffer *buffer, guint component, gpointer data)
+{
+  FsInprocStreamTransmitter *self = FS_INPROC_STREAM_TRANSMITTER_CAST (data);
+
+  if (fs_stream_transmitter_get_source_validated (FS_STREAM_TRANSMITTER (self)))
+    return;
+
+  g_signal_emit_by_name (self, "known-source-packet-received", component,
+      buffer);
+}
+
+static gboolean
+fs_inproc_stream_transmitter_force_remote_candidate (
+    FsInprocStreamTransmitter *self, FsCandidate *candidate,
+    GError **error)
+{
+  guint c = candidate->component_id;
+  FsCandidate *local = NULL;
+
+  if (self->priv->inlets[c])
+  {
+    if (fs_inproc_transmitter_check_inlet (self->priv->transmitter,
+            self->priv->inlets[c], candidate->ip))
+      return TRUE;
+    self->priv->inlets[c] = NULL;
+  }
+
+  self->priv->inlets[c] = fs_inproc_transmitter_get_inlet (
+      self->priv->transmitter, c, candidate->ip, got_buffer_func, self, error);
+
+  if (self->priv->inlets[c] == NULL)
+    return FALSE;
+
+  g_signal_emit_by_name (self, "state-changed", c, FS_STREAM_STATE_READY);
+
+  FS_INPROC_STREAM_TRANSMITTER_LOCK (self);
+  if (self->priv->local_candidates[c])
+    local = fs_candidate_copy (self->priv->local_candidates[c]);
+  FS_INPROC_STREAM_TRANSMITTER_UNLOCK (self);
+
+  if (local)
+  {
+    g_signal_emit_by_name (self, "new-active-candidate-pair", local,
+        candidate);
+    fs_candidate_destroy (local);
+  }
+
+  return TRUE;
+}
+
+/**
+ * fs_inproc_stream_transmitter_force_remote_candidates
+ */
+
+static gboolean
+fs_inproc_stream_transmitter_force_remote_candidates (
+    FsStreamTransmitter *streamtransmitter, GList *candidates,
+    GError **error)
+{
+  GList *item = NULL;
+  FsInprocStreamTransmitter *self =
+    FS_INPROC_STREAM_TRANSMITTER (streamtransmitter);
+
+  for (item = candidates; item; item = g_list_next (item))
+  {
+    FsCandidate *candidate = item->data;
+
+    if (candidate->component_id == 0 ||
+        candidate->component_id > self->priv->transmitter->components) {
+      g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+          "The candidate passed has an invalid component id %u (not in [1,%u])",
+          candidate->component_id, self->priv->transmitter->components);
+      return FALSE;
+    }
+
+    if (!candidate->ip || !candidate->ip[0])
+    {
+      g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+          "The candidate does not have the name of an inproc stream in its"
+          " ip");
+      return FALSE;
+    }
+  }
+
+  for (item = candidates; item; item = g_list_next (item))
+    if (!fs_inproc_stream_transmitter_force_remote_candidate (self,
+            item->data, error))
+      return FALSE;
+
+
+  return TRUE;
+}
+
+
+FsInprocStreamTransmitter *
+fs_inproc_stream_transmitter_newv (FsInprocTransmitter *transmitter,
+  guint n_parameters, GParameter *parameters, GError **error)
+{
+  FsInprocStreamTransmitter *streamtransmitter = NULL;
+
+  streamtransmitter = g_object_newv (FS_TYPE_INPROC_STREAM_TRANSMITTER,
+    n_parameters, parameters);
+
+  if (!streamtransmitter) {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+      "Could not build the stream transmitter");
+    return NULL;
+  }
+
+  streamtransmitter->priv->transmitter = transmitter;
+
+  if (!fs_inproc_stream_transmitter_build (streamtransmitter, error)) {
+    g_object_unref (streamtransmitter);
+    return NULL;
+  }
+
+  return streamtransmitter;
+}
+
+static const gchar *
+_get_preferred_name (FsInprocStreamTransmitter *self, guint component)
+{
+  GList *item;
+
+  for (item = self->priv->preferred_local_candidates;
+       item;
+       item = g_list_next (item))
+  {
+    FsCandidate *candidate = item->data;
+
+    if (candidate->component_id == component &&
+        candidate->ip && candidate->ip[0])
+      return candidate->ip;
+  }
+
+  return NULL;
+}
+
+static gboolean
+fs_inproc_stream_transmitter_gather_local_candidates (
+    FsStreamTransmitter *streamtransmitter,
+    GError **error)
+{
+  FsInprocStreamTransmitter *self =
+    FS_INPROC_STREAM_TRANSMITTER (streamtransmitter);
+  gchar *generated_name = NULL;
+  GList *local_candidates = NULL;
+  GList *item;
+  guint c;
+
+  for (c = 1; c <= self->priv->transmitter->components; c++)
+  {
+    const gchar *name = _get_preferred_name (self, c);
+    FsCandidate *candidate;
+
+    if (!name)
+    {
+      if (!generated_name)
+        generated_name = g_strdup_printf ("inproc-%d",
+            g_atomic_int_add (&name_counter, 1));
+      name = generated_name;
+    }
+
+    if (self->priv->outlets[c])
+    {
+      if (!fs_inproc_transmitter_check_outlet (self->priv->transmitter,
+              self->priv->outlets[c], name))
+        self->priv->outlets[c] = NULL;
+    }
+
+    if (!self->priv->outlets[c])
+      self->priv->outlets[c] = fs_inproc_transmitter_get_outlet (
+          self->priv->transmitter, c, name, error);
+
+    if (!self->priv->outlets[c])
+    {
+      g_free (generated_name);
+      fs_candidate_list_destroy (local_candidates);
+      return FALSE;
+    }
+
+    candidate = fs_candidate_new (NULL, c, FS_CANDIDATE_TYPE_HOST,
+        FS_NETWORK_PROTOCOL_UDP, name, 0);
+    local_candidates = g_list_append (local_candidates, candidate);
+
+    FS_INPROC_STREAM_TRANSMITTER_LOCK (self);
+    if (c == 1)
+      fs_inproc_transmitter_outlet_set_sending (self->priv->transmitter,
+          self->priv->outlets[c], self->priv->sending);
+    if (self->priv->local_candidates[c])
+      fs_candidate_destroy (self->priv->local_candidates[c]);
+    self->priv->local_candidates[c] = fs_candidate_copy (candidate);
+    FS_INPROC_STREAM_TRANSMITTER_UNLOCK (self);
+  }
+
+  g_free (generated_name);
+
+  for (item = local_candidates; item; item = g_list_next (item))
+  {
+    FsCandidate *candidate = item->data;
+
+    GST_DEBUG ("Emitting new local candidate with name %s", candidate->ip);
+
+    g_signal_emit_by_name (self, "new-local-candidate", candidate);
+  }
+  g_signal_emit_by_name (self, "local-candidates-prepared");
+
+  fs_candidate_list_destroy (local_candidates);
+
+  return TRUE;
+}
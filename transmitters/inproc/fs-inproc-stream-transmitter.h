@@ -0,0 +1,96 @@
+/*
+ * Farstream - Farstream In-Process Stream Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-inproc-stream-transmitter.h - A Farstream in-process stream transmitter
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_INPROC_STREAM_TRANSMITTER_H__
+#define __FS_INPROC_STREAM_TRANSMITTER_H__
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include <farstream/fs-stream-transmitter.h>
+#include <farstream/fs-plugin.h>
+#include "fs-inproc-transmitter.h"
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_INPROC_STREAM_TRANSMITTER \
+  (fs_inproc_stream_transmitter_get_type ())
+#define FS_INPROC_STREAM_TRANSMITTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_INPROC_STREAM_TRANSMITTER, \
+                              FsInprocStreamTransmitter))
+#define FS_INPROC_STREAM_TRANSMITTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_INPROC_STREAM_TRANSMITTER, \
+                           FsInprocStreamTransmitterClass))
+#define FS_IS_INPROC_STREAM_TRANSMITTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_INPROC_STREAM_TRANSMITTER))
+#define FS_IS_INPROC_STREAM_TRANSMITTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_INPROC_STREAM_TRANSMITTER))
+#define FS_INPROC_STREAM_TRANSMITTER_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), FS_TYPE_INPROC_STREAM_TRANSMITTER, \
+                              FsInprocStreamTransmitterClass))
+#define FS_INPROC_STREAM_TRANSMITTER_CAST(obj) ((FsInprocStreamTransmitter *) (obj))
+
+typedef struct _FsInprocStreamTransmitter FsInprocStreamTransmitter;
+typedef struct _FsInprocStreamTransmitterClass FsInprocStreamTransmitterClass;
+typedef struct _FsInprocStreamTransmitterPrivate FsInprocStreamTransmitterPrivate;
+
+/**
+ * FsInprocStreamTransmitterClass:
+ * @parent_class: Our parent
+ *
+ * The In-Process stream transmitter class
+ */
+
+struct _FsInprocStreamTransmitterClass
+{
+  FsStreamTransmitterClass parent_class;
+
+  /*virtual functions */
+  /*< private >*/
+};
+
+/**
+ * FsInprocStreamTransmitter:
+ * @parent: Parent object
+ *
+ * All members are private, access them using methods and properties
+ */
+struct _FsInprocStreamTransmitter
+{
+  FsStreamTransmitter parent;
+
+  /*< private >*/
+  FsInprocStreamTransmitterPrivate *priv;
+};
+
+GType fs_inproc_stream_transmitter_register_type (FsPlugin *module);
+
+GType fs_inproc_stream_transmitter_get_type (void);
+
+FsInprocStreamTransmitter *
+fs_inproc_stream_transmitter_newv (FsInprocTransmitter *transmitter,
+  guint n_parameters, GParameter *parameters, GError **error);
+
+G_END_DECLS
+
+#endif /* __FS_INPROC_STREAM_TRANSMITTER_H__ */
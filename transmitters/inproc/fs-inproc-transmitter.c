@@ -0,0 +1,965 @@
+/*
+ * Farstream - Farstream In-Process Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-inproc-transmitter.c - A Farstream transmitter that passes buffers
+ *   between conferences of the same process
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/**
+ * SECTION:fs-inproc-transmitter
+ * @short_description: A transmitter between conferences of one process
+ *
+ * This transmitter passes the buffers directly between the pipelines of one
+ * process, without going through any socket.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-inproc-transmitter.h"
+#include "fs-inproc-stream-transmitter.h"
+
+#include <farstream/fs-conference.h>
+#include <farstream/fs-plugin.h>
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY (fs_inproc_transmitter_debug);
+#define GST_CAT_DEFAULT fs_inproc_transmitter_debug
+
+/* Signals */
+enum
+{
+  LAST_SIGNAL
+};
+
+/* props */
+enum
+{
+  PROP_0,
+  PROP_GST_SINK,
+  PROP_GST_SRC,
+  PROP_COMPONENTS,
+  PROP_DO_TIMESTAMP,
+};
+
+struct _FsInprocTransmitterPrivate
+{
+  /* We hold references to this element */
+  GstElement *gst_sink;
+  GstElement *gst_src;
+
+  /* We don't hold a reference to these elements, they are owned
+     by the bins */
+  /* They are tables of pointers, one per component */
+  GstElement **funnels;
+  GstElement **tees;
+
+  gboolean do_timestamp;
+};
+
+#define FS_INPROC_TRANSMITTER_GET_PRIVATE(o)  \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), FS_TYPE_INPROC_TRANSMITTER,   \
+      FsInprocTransmitterPrivate))
+
+static void fs_inproc_transmitter_class_init (
+    FsInprocTransmitterClass *klass);
+static void fs_inproc_transmitter_init (FsInprocTransmitter *self);
+static void fs_inproc_transmitter_constructed (GObject *object);
+static void fs_inproc_transmitter_dispose (GObject *object);
+static void fs_inproc_transmitter_finalize (GObject *object);
+
+static void fs_inproc_transmitter_get_property (GObject *object,
+                                                guint prop_id,
+                                                GValue *value,
+                                                GParamSpec *pspec);
+static void fs_inproc_transmitter_set_property (GObject *object,
+                                                guint prop_id,
+                                                const GValue *value,
+                                                GParamSpec *pspec);
+
+static FsStreamTransmitter *fs_inproc_transmitter_new_stream_transmitter (
+    FsTransmitter *transmitter, FsParticipant *participant,
+    guint n_parameters, GParameter *parameters, GError **error);
+static GType fs_inproc_transmitter_get_stream_transmitter_type (
+    FsTransmitter *transmitter);
+
+
+static GObjectClass *parent_class = NULL;
+//static guint signals[LAST_SIGNAL] = { 0 };
+
+/*
+ * The outlets of every transmitter of the process, indexed by
+ * "component/name" so that the inlets of any other transmitter can find
+ * them.
+ */
+
+static GMutex outlets_mutex;
+static GHashTable *outlets = NULL;
+
+/*
+ * Lets register the plugin
+ */
+
+static GType type = 0;
+
+GType
+fs_inproc_transmitter_get_type (void)
+{
+  g_assert (type);
+  return type;
+}
+
+static GType
+fs_inproc_transmitter_register_type (FsPlugin *module)
+{
+  static const GTypeInfo info = {
+    sizeof (FsInprocTransmitterClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_inproc_transmitter_class_init,
+    NULL,
+    NULL,
+    sizeof (FsInprocTransmitter),
+    0,
+    (GInstanceInitFunc) fs_inproc_transmitter_init
+  };
+
+  GST_DEBUG_CATEGORY_INIT (fs_inproc_transmitter_debug,
+      "fsinproctransmitter", 0,
+      "Farstream in-process transmitter");
+
+  fs_inproc_stream_transmitter_register_type (module);
+
+  type = g_type_module_register_type (G_TYPE_MODULE (module),
+    FS_TYPE_TRANSMITTER, "FsInprocTransmitter", &info, 0);
+
+  return type;
+}
+
+FS_INIT_PLUGIN (fs_inproc_transmitter_register_type)
+
+static void
+fs_inproc_transmitter_class_init (FsInprocTransmitterClass *klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  FsTransmitterClass *transmitter_class = FS_TRANSMITTER_CLASS (klass);
+
+  parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->set_property = fs_inproc_transmitter_set_property;
+  gobject_class->get_property = fs_inproc_transmitter_get_property;
+
+  gobject_class->constructed = fs_inproc_transmitter_constructed;
+
+  g_object_class_override_property (gobject_class, PROP_GST_SRC, "gst-src");
+  g_object_class_override_property (gobject_class, PROP_GST_SINK, "gst-sink");
+  g_object_class_override_property (gobject_class, PROP_COMPONENTS,
+    "components");
+  g_object_class_override_property (gobject_class, PROP_DO_TIMESTAMP,
+    "do-timestamp");
+
+  transmitter_class->new_stream_transmitter =
+    fs_inproc_transmitter_new_stream_transmitter;
+  transmitter_class->get_stream_transmitter_type =
+    fs_inproc_transmitter_get_stream_transmitter_type;
+
+  gobject_class->dispose = fs_inproc_transmitter_dispose;
+  gobject_class->finalize = fs_inproc_transmitter_finalize;
+
+  g_type_class_add_private (klass, sizeof (FsInprocTransmitterPrivate));
+}
+
+static void
+fs_inproc_transmitter_init (FsInprocTransmitter *self)
+{
+
+  /* member init */
+  self->priv = FS_INPROC_TRANSMITTER_GET_PRIVATE (self);
+
+  self->components = 2;
+  self->priv->do_timestamp = TRUE;
+}
+
+static void
+fs_inproc_transmitter_constructed (GObject *object)
+{
+  FsInprocTransmitter *self = FS_INPROC_TRANSMITTER_CAST (object);
+  FsTransmitter *trans = FS_TRANSMITTER_CAST (self);
+  GstPad *pad = NULL, *pad2 = NULL;
+  GstPad *ghostpad = NULL;
+  gchar *padname;
+  GstPadLinkReturn ret;
+  int c; /* component_id */
+
+
+  /* We waste one space in order to have the index be the component_id */
+  self->priv->funnels = g_new0 (GstElement *, self->components+1);
+  self->priv->tees = g_new0 (GstElement *, self->components+1);
+
+  /* First we need the src elemnet */
+
+  self->priv->gst_src = gst_bin_new (NULL);
+
+  if (!self->priv->gst_src) {
+    trans->construction_error = g_error_new (FS_ERROR,
+      FS_ERROR_CONSTRUCTION,
+      "Could not build the transmitter src bin");
+    return;
+  }
+
+  gst_object_ref (self->priv->gst_src);
+
+
+  /* Second, we do the sink element */
+
+  self->priv->gst_sink = gst_bin_new (NULL);
+
+  if (!self->priv->gst_sink) {
+    trans->construction_error = g_error_new (FS_ERROR,
+      FS_ERROR_CONSTRUCTION,
+      "Could not build the transmitter sink bin");
+    return;
+  }
+
+  g_object_set (G_OBJECT (self->priv->gst_sink),
+      "async-handling", TRUE,
+      NULL);
+
+  gst_object_ref (self->priv->gst_sink);
+
+  for (c = 1; c <= self->components; c++) {
+    GstElement *fakesink = NULL;
+
+    /* Lets create the RTP source funnel */
+
+    self->priv->funnels[c] = gst_element_factory_make ("funnel", NULL);
+
+    if (!self->priv->funnels[c]) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not make the funnel element");
+      return;
+    }
+
+    if (!gst_bin_add (GST_BIN (self->priv->gst_src),
+        self->priv->funnels[c])) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not add the funnel element to the transmitter src bin");
+    }
+
+    pad = gst_element_get_static_pad (self->priv->funnels[c], "src");
+    padname = g_strdup_printf ("src_%u", c);
+    ghostpad = gst_ghost_pad_new (padname, pad);
+    g_free (padname);
+    gst_object_unref (pad);
+
+    gst_pad_set_active (ghostpad, TRUE);
+    gst_element_add_pad (self->priv->gst_src, ghostpad);
+
+
+    /* Lets create the RTP sink tee */
+
+    self->priv->tees[c] = gst_element_factory_make ("tee", NULL);
+
+    if (!self->priv->tees[c]) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not make the tee element");
+      return;
+    }
+
+    if (!gst_bin_add (GST_BIN (self->priv->gst_sink),
+        self->priv->tees[c])) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not add the tee element to the transmitter sink bin");
+    }
+
+    pad = gst_element_get_static_pad (self->priv->tees[c], "sink");
+    padname = g_strdup_printf ("sink_%u", c);
+    ghostpad = gst_ghost_pad_new (padname, pad);
+    g_free (padname);
+    gst_object_unref (pad);
+
+    gst_pad_set_active (ghostpad, TRUE);
+    gst_element_add_pad (self->priv->gst_sink, ghostpad);
+
+    fakesink = gst_element_factory_make ("fakesink", NULL);
+
+    if (!fakesink) {
+      trans->construction_error = g_error_new (FS_ERROR,
+        FS_ERROR_CONSTRUCTION,
+        "Could not make the fakesink element");
+      return;
+    }
+
+    g_object_set (fakesink,
+        "async", FALSE,
+        "sync" , FALSE,
+        NULL);
+
+    if (!gst_bin_add (GST_BIN (self->priv->gst_sink), fakesink))
+    {
+      gst_object_unref (fakesink);
+      trans->construction_error = g_error_new (FS_ERROR,
+          FS_ERROR_CONSTRUCTION,
+          "Could not add the fakesink element to the transmitter sink bin");
+      return;
+    }
+
+    pad = gst_element_get_request_pad (self->priv->tees[c], "src_%u");
+    pad2 = gst_element_get_static_pad (fakesink, "sink");
+
+    ret = gst_pad_link (pad, pad2);
+
+    gst_object_unref (pad2);
+    gst_object_unref (pad);
+
+    if (GST_PAD_LINK_FAILED(ret)) {
+      trans->construction_error = g_error_new (FS_ERROR,
+          FS_ERROR_CONSTRUCTION,
+          "Could not link the tee to the fakesink");
+      return;
+    }
+  }
+
+  GST_CALL_PARENT (G_OBJECT_CLASS, constructed, (object));
+}
+
+static void
+fs_inproc_transmitter_dispose (GObject *object)
+{
+  FsInprocTransmitter *self = FS_INPROC_TRANSMITTER (object);
+
+  if (self->priv->gst_src) {
+    gst_object_unref (self->priv->gst_src);
+    self->priv->gst_src = NULL;
+  }
+
+  if (self->priv->gst_sink) {
+    gst_object_unref (self->priv->gst_sink);
+    self->priv->gst_sink = NULL;
+  }
+
+  parent_class->dispose (object);
+}
+
+static void
+fs_inproc_transmitter_finalize (GObject *object)
+{
+  FsInprocTransmitter *self = FS_INPROC_TRANSMITTER (object);
+
+  if (self->priv->funnels) {
+    g_free (self->priv->funnels);
+    self->priv->funnels = NULL;
+  }
+
+  if (self->priv->tees) {
+    g_free (self->priv->tees);
+    self->priv->tees = NULL;
+  }
+
+  parent_class->finalize (object);
+}
+
+static void
+fs_inproc_transmitter_get_property (GObject *object,
+                             guint prop_id,
+                             GValue *value,
+                             GParamSpec *pspec)
+{
+  FsInprocTransmitter *self = FS_INPROC_TRANSMITTER (object);
+
+  switch (prop_id) {
+    case PROP_GST_SINK:
+      g_value_set_object (value, self->priv->gst_sink);
+      break;
+    case PROP_GST_SRC:
+      g_value_set_object (value, self->priv->gst_src);
+      break;
+    case PROP_COMPONENTS:
+      g_value_set_uint (value, self->components);
+      break;
+    case PROP_DO_TIMESTAMP:
+      g_value_set_boolean (value, self->priv->do_timestamp);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_inproc_transmitter_set_property (GObject *object,
+                                    guint prop_id,
+                                    const GValue *value,
+                                    GParamSpec *pspec)
+{
+  FsInprocTransmitter *self = FS_INPROC_TRANSMITTER (object);
+
+  switch (prop_id) {
+    case PROP_COMPONENTS:
+      self->components = g_value_get_uint (value);
+      break;
+    case PROP_DO_TIMESTAMP:
+      self->priv->do_timestamp = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+
+/**
+ * fs_inproc_transmitter_new_stream_inproc_transmitter:
+ * @transmitter: a #FsTranmitter
+ * @participant: the #FsParticipant for which the #FsStream using this
+ * new #FsStreamTransmitter is created
+ *
+ * This function will create a new #FsStreamTransmitter element for a
+ * specific participant for this #FsInprocTransmitter
+ *
+ * Returns: a new #FsStreamTransmitter
+ */
+
+static FsStreamTransmitter *
+fs_inproc_transmitter_new_stream_transmitter (FsTransmitter *transmitter,
+  FsParticipant *participant, guint n_parameters, GParameter *parameters,
+  GError **error)
+{
+  FsInprocTransmitter *self = FS_INPROC_TRANSMITTER (transmitter);
+
+  return FS_STREAM_TRANSMITTER (fs_inproc_stream_transmitter_newv (
+        self, n_parameters, parameters, error));
+}
+
+static GType
+fs_inproc_transmitter_get_stream_transmitter_type (
+    FsTransmitter *transmitter)
+{
+  return FS_TYPE_INPROC_STREAM_TRANSMITTER;
+}
+
+
+/*
+ * An outlet receives what a stream sends on one component, from a pad
+ * linked to the tee of the component, and pushes it to the pads of all the
+ * inlets connected to it. Their pads are pushed to from the sending thread,
+ * so the receiving pipeline runs in the thread of the sender.
+ */
+
+struct _InprocOutlet {
+  guint component;
+  gchar *name;
+  gchar *key;
+
+  GstPad *sinkpad;
+  GstPad *teepad;
+
+  gint sending;
+
+  GMutex mutex;
+  /* Protected by the mutex, it is replaced instead of being modified so
+   * the streaming thread can use it after releasing the lock */
+  GPtrArray *inlet_pads;
+};
+
+/*
+ * An inlet is a pad linked to the funnel of a component of the receiving
+ * transmitter. It has no parent element, its sticky events are sent when it
+ * is created.
+ */
+
+struct _InprocInlet {
+  guint component;
+  gchar *name;
+  gchar *key;
+  gboolean attached;
+
+  GstPad *srcpad;
+  GstPad *funnelpad;
+
+  /* Only set to timestamp the buffers */
+  GstElement *clock_element;
+
+  got_buffer got_buffer_func;
+  gpointer cb_data;
+};
+
+static gchar *
+_make_key (guint component, const gchar *name)
+{
+  return g_strdup_printf ("%u/%s", component, name);
+}
+
+static GstBuffer *
+_inlet_timestamp_buffer (GstBuffer *buffer, GstClockTime now)
+{
+  buffer = gst_buffer_make_writable (buffer);
+  GST_BUFFER_PTS (buffer) = now;
+  GST_BUFFER_DTS (buffer) = GST_CLOCK_TIME_NONE;
+
+  return buffer;
+}
+
+static gboolean
+_inlet_timestamp_list_item (GstBuffer **buffer, guint idx, gpointer user_data)
+{
+  *buffer = _inlet_timestamp_buffer (*buffer,
+      *(GstClockTime *) user_data);
+
+  return TRUE;
+}
+
+static GstClockTime
+_inlet_get_running_time (InprocInlet *inlet)
+{
+  GstClock *clock;
+  GstClockTime now;
+
+  clock = gst_element_get_clock (inlet->clock_element);
+  if (!clock)
+    return GST_CLOCK_TIME_NONE;
+
+  now = gst_clock_get_time (clock) -
+    gst_element_get_base_time (inlet->clock_element);
+  gst_object_unref (clock);
+
+  return now;
+}
+
+/*
+ * Returns: the inlet of @pad with the stream lock of the pad taken, or
+ *   %NULL if the inlet is going away
+ */
+
+static InprocInlet *
+_inlet_lock (GstPad *pad)
+{
+  InprocInlet *inlet;
+
+  GST_PAD_STREAM_LOCK (pad);
+  inlet = gst_pad_get_element_private (pad);
+  if (!inlet || GST_PAD_IS_FLUSHING (pad))
+  {
+    GST_PAD_STREAM_UNLOCK (pad);
+    return NULL;
+  }
+
+  return inlet;
+}
+
+static void
+_inlet_push_buffer (GstPad *pad, GstBuffer *buffer)
+{
+  InprocInlet *inlet = _inlet_lock (pad);
+
+  if (!inlet)
+  {
+    gst_buffer_unref (buffer);
+    return;
+  }
+
+  if (inlet->got_buffer_func)
+    inlet->got_buffer_func (buffer, inlet->component, inlet->cb_data);
+
+  if (inlet->clock_element)
+  {
+    GstClockTime now = _inlet_get_running_time (inlet);
+
+    if (GST_CLOCK_TIME_IS_VALID (now))
+      buffer = _inlet_timestamp_buffer (buffer, now);
+  }
+
+  gst_pad_push (pad, buffer);
+
+  GST_PAD_STREAM_UNLOCK (pad);
+}
+
+static void
+_inlet_push_list (GstPad *pad, GstBufferList *list)
+{
+  InprocInlet *inlet = _inlet_lock (pad);
+  guint i, len;
+
+  if (!inlet)
+  {
+    gst_buffer_list_unref (list);
+    return;
+  }
+
+  if (inlet->got_buffer_func)
+  {
+    len = gst_buffer_list_length (list);
+    for (i = 0; i < len; i++)
+      inlet->got_buffer_func (gst_buffer_list_get (list, i), inlet->component,
+          inlet->cb_data);
+  }
+
+  if (inlet->clock_element)
+  {
+    GstClockTime now = _inlet_get_running_time (inlet);
+
+    if (GST_CLOCK_TIME_IS_VALID (now))
+    {
+      list = gst_buffer_list_make_writable (list);
+      gst_buffer_list_foreach (list, _inlet_timestamp_list_item, &now);
+    }
+  }
+
+  gst_pad_push_list (pad, list);
+
+  GST_PAD_STREAM_UNLOCK (pad);
+}
+
+static GPtrArray *
+_outlet_get_inlet_pads (InprocOutlet *outlet)
+{
+  GPtrArray *pads;
+
+  g_mutex_lock (&outlet->mutex);
+  pads = g_ptr_array_ref (outlet->inlet_pads);
+  g_mutex_unlock (&outlet->mutex);
+
+  return pads;
+}
+
+static GstFlowReturn
+_outlet_chain (GstPad *pad, GstObject *parent, GstBuffer *buffer)
+{
+  InprocOutlet *outlet = gst_pad_get_element_private (pad);
+  GPtrArray *pads;
+  guint i;
+
+  if (!g_atomic_int_get (&outlet->sending))
+    goto out;
+
+  pads = _outlet_get_inlet_pads (outlet);
+  for (i = 0; i < pads->len; i++)
+    _inlet_push_buffer (g_ptr_array_index (pads, i), gst_buffer_ref (buffer));
+  g_ptr_array_unref (pads);
+
+ out:
+  gst_buffer_unref (buffer);
+  return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+_outlet_chain_list (GstPad *pad, GstObject *parent, GstBufferList *list)
+{
+  InprocOutlet *outlet = gst_pad_get_element_private (pad);
+  GPtrArray *pads;
+  guint i;
+
+  if (!g_atomic_int_get (&outlet->sending))
+    goto out;
+
+  pads = _outlet_get_inlet_pads (outlet);
+  for (i = 0; i < pads->len; i++)
+    _inlet_push_list (g_ptr_array_index (pads, i),
+        gst_buffer_list_ref (list));
+  g_ptr_array_unref (pads);
+
+ out:
+  gst_buffer_list_unref (list);
+  return GST_FLOW_OK;
+}
+
+/* The inlets send their own events */
+
+static gboolean
+_outlet_event (GstPad *pad, GstObject *parent, GstEvent *event)
+{
+  gst_event_unref (event);
+  return TRUE;
+}
+
+/* Must be called with the outlets mutex held */
+
+static void
+_outlet_set_inlet_pad (InprocOutlet *outlet, GstPad *pad, gboolean add)
+{
+  GPtrArray *pads;
+  guint i;
+
+  g_mutex_lock (&outlet->mutex);
+  pads = g_ptr_array_new_with_free_func (gst_object_unref);
+  for (i = 0; i < outlet->inlet_pads->len; i++)
+  {
+    GstPad *item = g_ptr_array_index (outlet->inlet_pads, i);
+
+    if (item != pad)
+      g_ptr_array_add (pads, gst_object_ref (item));
+  }
+  if (add)
+    g_ptr_array_add (pads, gst_object_ref (pad));
+  g_ptr_array_unref (outlet->inlet_pads);
+  outlet->inlet_pads = pads;
+  g_mutex_unlock (&outlet->mutex);
+}
+
+InprocOutlet *
+fs_inproc_transmitter_get_outlet (FsInprocTransmitter *self,
+    guint component,
+    const gchar *name,
+    GError **error)
+{
+  InprocOutlet *outlet = g_slice_new0 (InprocOutlet);
+
+  GST_DEBUG ("Trying to add inproc outlet for c:%u name %s", component, name);
+
+  outlet->component = component;
+  outlet->name = g_strdup (name);
+  outlet->key = _make_key (component, name);
+  outlet->sending = TRUE;
+  g_mutex_init (&outlet->mutex);
+  outlet->inlet_pads = g_ptr_array_new_with_free_func (gst_object_unref);
+
+  outlet->sinkpad = gst_pad_new (NULL, GST_PAD_SINK);
+  gst_pad_set_element_private (outlet->sinkpad, outlet);
+  gst_pad_set_chain_function (outlet->sinkpad, _outlet_chain);
+  gst_pad_set_chain_list_function (outlet->sinkpad, _outlet_chain_list);
+  gst_pad_set_event_function (outlet->sinkpad, _outlet_event);
+  gst_pad_set_active (outlet->sinkpad, TRUE);
+
+  g_mutex_lock (&outlets_mutex);
+  if (!outlets)
+    outlets = g_hash_table_new (g_str_hash, g_str_equal);
+  if (g_hash_table_lookup (outlets, outlet->key))
+  {
+    g_mutex_unlock (&outlets_mutex);
+    g_set_error (error, FS_ERROR, FS_ERROR_INVALID_ARGUMENTS,
+        "There is already an inproc endpoint named %s for component %u",
+        name, component);
+    goto error;
+  }
+  g_hash_table_insert (outlets, outlet->key, outlet);
+  g_mutex_unlock (&outlets_mutex);
+
+  outlet->teepad = gst_element_get_request_pad (self->priv->tees[component],
+      "src_%u");
+
+  if (!outlet->teepad)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not get teepad");
+    goto error;
+  }
+
+  if (GST_PAD_LINK_FAILED (gst_pad_link (outlet->teepad, outlet->sinkpad)))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link the tee to the inproc outlet");
+    goto error;
+  }
+
+  return outlet;
+
+ error:
+  fs_inproc_transmitter_check_outlet (self, outlet, NULL);
+  return NULL;
+}
+
+/*
+ * Returns: %TRUE if the name is the same, otherwise %FALSE and frees the
+ *   InprocOutlet
+ */
+
+gboolean
+fs_inproc_transmitter_check_outlet (FsInprocTransmitter *self,
+    InprocOutlet *outlet,
+    const gchar *name)
+{
+  if (name && !strcmp (name, outlet->name))
+    return TRUE;
+
+  if (name)
+    GST_DEBUG ("Replacing inproc outlet %s with %s", outlet->name, name);
+  else
+    GST_DEBUG ("Freeing inproc outlet %s", outlet->name);
+
+  g_mutex_lock (&outlets_mutex);
+  if (outlets && g_hash_table_lookup (outlets, outlet->key) == outlet)
+    g_hash_table_remove (outlets, outlet->key);
+  g_mutex_unlock (&outlets_mutex);
+
+  if (outlet->teepad)
+  {
+    gst_element_release_request_pad (self->priv->tees[outlet->component],
+        outlet->teepad);
+    gst_object_unref (outlet->teepad);
+  }
+  outlet->teepad = NULL;
+
+  /* Waits for the streaming thread to leave the chain function */
+  gst_pad_set_active (outlet->sinkpad, FALSE);
+  gst_object_unref (outlet->sinkpad);
+
+  g_ptr_array_unref (outlet->inlet_pads);
+  g_mutex_clear (&outlet->mutex);
+  g_free (outlet->key);
+  g_free (outlet->name);
+  g_slice_free (InprocOutlet, outlet);
+
+  return FALSE;
+}
+
+void
+fs_inproc_transmitter_outlet_set_sending (FsInprocTransmitter *self,
+    InprocOutlet *outlet, gboolean sending)
+{
+  g_atomic_int_set (&outlet->sending, sending);
+
+  if (sending)
+    gst_pad_push_event (outlet->sinkpad,
+        gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+            gst_structure_new ("GstForceKeyUnit",
+              "all-headers", G_TYPE_BOOLEAN, TRUE,
+              NULL)));
+}
+
+InprocInlet *
+fs_inproc_transmitter_get_inlet (FsInprocTransmitter *self,
+    guint component,
+    const gchar *name,
+    got_buffer got_buffer_func,
+    gpointer cb_data,
+    GError **error)
+{
+  InprocInlet *inlet = g_slice_new0 (InprocInlet);
+  InprocOutlet *outlet;
+  GstSegment segment;
+  gchar *stream_id;
+
+  GST_DEBUG ("Trying to add inproc inlet for c:%u name %s", component, name);
+
+  inlet->component = component;
+  inlet->name = g_strdup (name);
+  inlet->key = _make_key (component, name);
+  inlet->got_buffer_func = got_buffer_func;
+  inlet->cb_data = cb_data;
+  if (self->priv->do_timestamp)
+    inlet->clock_element = gst_object_ref (self->priv->gst_src);
+
+  inlet->funnelpad = gst_element_get_request_pad (self->priv->funnels[component],
+      "sink_%u");
+
+  if (!inlet->funnelpad)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not get funnelpad");
+    goto error;
+  }
+
+  inlet->srcpad = gst_pad_new (NULL, GST_PAD_SRC);
+  gst_pad_set_element_private (inlet->srcpad, inlet);
+  gst_pad_set_active (inlet->srcpad, TRUE);
+
+  if (GST_PAD_LINK_FAILED (gst_pad_link (inlet->srcpad, inlet->funnelpad)))
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+        "Could not link the inproc inlet to the funnel");
+    goto error;
+  }
+
+  stream_id = g_strdup_printf ("inproc/%s", inlet->key);
+  gst_pad_push_event (inlet->srcpad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (inlet->srcpad, gst_event_new_segment (&segment));
+
+  g_mutex_lock (&outlets_mutex);
+  outlet = outlets ? g_hash_table_lookup (outlets, inlet->key) : NULL;
+  if (outlet)
+  {
+    _outlet_set_inlet_pad (outlet, inlet->srcpad, TRUE);
+    inlet->attached = TRUE;
+  }
+  g_mutex_unlock (&outlets_mutex);
+
+  if (!inlet->attached)
+  {
+    g_set_error (error, FS_ERROR, FS_ERROR_NETWORK,
+        "There is no inproc endpoint named %s for component %u", name,
+        component);
+    goto error;
+  }
+
+  return inlet;
+
+ error:
+  fs_inproc_transmitter_check_inlet (self, inlet, NULL);
+  return NULL;
+}
+
+/*
+ * Returns: %TRUE if the name is the same, otherwise %FALSE and frees the
+ *   InprocInlet
+ */
+
+gboolean
+fs_inproc_transmitter_check_inlet (FsInprocTransmitter *self,
+    InprocInlet *inlet,
+    const gchar *name)
+{
+  if (name && !strcmp (name, inlet->name))
+    return TRUE;
+
+  if (inlet->attached)
+  {
+    InprocOutlet *outlet;
+
+    g_mutex_lock (&outlets_mutex);
+    outlet = outlets ? g_hash_table_lookup (outlets, inlet->key) : NULL;
+    if (outlet)
+      _outlet_set_inlet_pad (outlet, inlet->srcpad, FALSE);
+    g_mutex_unlock (&outlets_mutex);
+  }
+
+  if (inlet->srcpad)
+  {
+    /* Waits for the sending thread to be done with the inlet */
+    gst_pad_set_active (inlet->srcpad, FALSE);
+    gst_pad_set_element_private (inlet->srcpad, NULL);
+    if (inlet->funnelpad)
+      gst_pad_unlink (inlet->srcpad, inlet->funnelpad);
+    gst_object_unref (inlet->srcpad);
+  }
+
+  if (inlet->funnelpad)
+  {
+    gst_element_release_request_pad (self->priv->funnels[inlet->component],
+        inlet->funnelpad);
+    gst_object_unref (inlet->funnelpad);
+  }
+
+  if (inlet->clock_element)
+    gst_object_unref (inlet->clock_element);
+
+  g_free (inlet->key);
+  g_free (inlet->name);
+  g_slice_free (InprocInlet, inlet);
+
+  return FALSE;
+}
@@ -0,0 +1,116 @@
+/*
+ * Farstream - Farstream In-Process Transmitter
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-inproc-transmitter.h - A Farstream transmitter that passes buffers
+ *   between conferences of the same process
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_INPROC_TRANSMITTER_H__
+#define __FS_INPROC_TRANSMITTER_H__
+
+#include <farstream/fs-transmitter.h>
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_INPROC_TRANSMITTER \
+  (fs_inproc_transmitter_get_type ())
+#define FS_INPROC_TRANSMITTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_INPROC_TRANSMITTER, \
+    FsInprocTransmitter))
+#define FS_INPROC_TRANSMITTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), FS_TYPE_INPROC_TRANSMITTER, \
+    FsInprocTransmitterClass))
+#define FS_IS_INPROC_TRANSMITTER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_INPROC_TRANSMITTER))
+#define FS_IS_INPROC_TRANSMITTER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), FS_TYPE_INPROC_TRANSMITTER))
+#define FS_INPROC_TRANSMITTER_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), FS_TYPE_INPROC_TRANSMITTER, \
+    FsInprocTransmitterClass))
+#define FS_INPROC_TRANSMITTER_CAST(obj) ((FsInprocTransmitter *) (obj))
+
+typedef struct _FsInprocTransmitter FsInprocTransmitter;
+typedef struct _FsInprocTransmitterClass FsInprocTransmitterClass;
+typedef struct _FsInprocTransmitterPrivate FsInprocTransmitterPrivate;
+
+/**
+ * FsInprocTransmitterClass:
+ * @parent_class: Our parent
+ *
+ * The In-Process transmitter class
+ */
+
+struct _FsInprocTransmitterClass
+{
+  FsTransmitterClass parent_class;
+};
+
+/**
+ * FsInprocTransmitter:
+ * @parent: Parent object
+ *
+ * All members are private, access them using methods and properties
+ */
+struct _FsInprocTransmitter
+{
+  FsTransmitter parent;
+
+  /* The number of components (READONLY) */
+  gint components;
+
+  /*< private >*/
+  FsInprocTransmitterPrivate *priv;
+};
+
+GType fs_inproc_transmitter_get_type (void);
+
+typedef struct _InprocOutlet InprocOutlet;
+typedef struct _InprocInlet InprocInlet;
+
+typedef void (*got_buffer) (GstBuffer *buffer, guint component, gpointer data);
+
+InprocOutlet *fs_inproc_transmitter_get_outlet (FsInprocTransmitter *self,
+    guint component,
+    const gchar *name,
+    GError **error);
+
+gboolean fs_inproc_transmitter_check_outlet (FsInprocTransmitter *self,
+    InprocOutlet *outlet,
+    const gchar *name);
+
+void fs_inproc_transmitter_outlet_set_sending (FsInprocTransmitter *self,
+    InprocOutlet *outlet, gboolean sending);
+
+InprocInlet *fs_inproc_transmitter_get_inlet (FsInprocTransmitter *self,
+    guint component,
+    const gchar *name,
+    got_buffer got_buffer_func,
+    gpointer cb_data,
+    GError **error);
+
+gboolean fs_inproc_transmitter_check_inlet (FsInprocTransmitter *self,
+    InprocInlet *inlet,
+    const gchar *name);
+
+G_END_DECLS
+
+#endif /* __FS_INPROC_TRANSMITTER_H__ */
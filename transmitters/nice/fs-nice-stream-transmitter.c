@@ -1920,7 +1920,8 @@ known_buffer_have_buffer_handler (GstPad *pad, GstPadProbeInfo *info,
   guint component_id;
   GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
 
-  if (!g_atomic_int_get (&self->priv->associate_on_source))
+  if (!g_atomic_int_get (&self->priv->associate_on_source) ||
+      fs_stream_transmitter_get_source_validated (FS_STREAM_TRANSMITTER (self)))
     return TRUE;
 
   component_id = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (pad),
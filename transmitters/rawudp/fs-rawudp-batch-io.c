@@ -0,0 +1,1315 @@
+/*
+ * Farstream - Farstream RAW UDP batched socket I/O
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rawudp-batch-io.c - Elements reading and writing bursts of datagrams
+ *   with a single syscall
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * These two elements replace the udpsrc/multiudpsink pair of a UdpPort
+ * when the "batch-size" property of the transmitter is set.
+ *
+ * The source reads up to batch-size datagrams with one recvmmsg() call into
+ * buffers from a pool and pushes them downstream as one #GstBufferList.
+ * The sink sends every buffer of a #GstBufferList to every destination with
+ * as few sendmmsg() calls as possible.
+ *
+ * They share the socket of the UdpPort, which is owned and closed by the
+ * transmitter.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifndef _GNU_SOURCE
+/* For recvmmsg() and sendmmsg() */
+#define _GNU_SOURCE
+#endif
+
+#include "fs-rawudp-batch-io.h"
+
+#include "fs-rawudp-transmitter.h"
+
+#ifdef FS_RAWUDP_HAVE_BATCH_IO
+
+#include <gio/gio.h>
+#include <gst/net/gstnetaddressmeta.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#define GST_CAT_DEFAULT fs_rawudp_transmitter_debug
+
+#define DEFAULT_BATCH_SIZE (32)
+#define DEFAULT_BUFFER_SIZE (2048)
+/* The largest UDP payload, what doesn't fit in the pooled buffer is read
+ * into an overflow memory */
+#define MAX_DATAGRAM_SIZE (65535)
+/* Buffers with more memories than this are merged before being sent */
+#define MAX_IOV (8)
+
+/*
+ * FsRawUdpBatchSrc
+ */
+
+struct _FsRawUdpBatchSrc
+{
+  GstElement parent;
+
+  GstPad *srcpad;
+
+  /* Properties, can only be changed in the NULL or READY state */
+  GSocket *socket;
+  guint batch_size;
+  guint buffer_size;
+  gboolean do_timestamp;
+
+  GCancellable *cancellable;
+
+  GMutex mutex;
+  GCond cond;
+  /* Protected by the mutex */
+  gboolean playing;
+  gboolean flushing;
+
+  /* Only used from the streaming thread */
+  gboolean need_events;
+  GstBufferPool *pool;
+  GstBuffer **buffers;
+  GstMapInfo *maps;
+  GstMemory **overflows;
+  GstMapInfo *overflow_maps;
+  struct mmsghdr *msgs;
+  struct iovec *iovs;
+  struct sockaddr_storage *addrs;
+};
+
+struct _FsRawUdpBatchSrcClass
+{
+  GstElementClass parent_class;
+};
+
+enum
+{
+  PROP_SRC_0,
+  PROP_SRC_SOCKET,
+  PROP_SRC_BATCH_SIZE,
+  PROP_SRC_BUFFER_SIZE,
+  PROP_SRC_DO_TIMESTAMP
+};
+
+static GstStaticPadTemplate fs_rawudp_batch_src_template =
+  GST_STATIC_PAD_TEMPLATE ("src",
+      GST_PAD_SRC,
+      GST_PAD_ALWAYS,
+      GST_STATIC_CAPS_ANY);
+
+static GType src_type = 0;
+static GstElementClass *src_parent_class = NULL;
+
+static void fs_rawudp_batch_src_loop (gpointer user_data);
+
+GType
+fs_rawudp_batch_src_get_type (void)
+{
+  g_assert (src_type);
+  return src_type;
+}
+
+static void
+fs_rawudp_batch_src_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (object);
+
+  switch (prop_id)
+  {
+    case PROP_SRC_SOCKET:
+      if (self->socket)
+        g_object_unref (self->socket);
+      self->socket = g_value_dup_object (value);
+      break;
+    case PROP_SRC_BATCH_SIZE:
+      self->batch_size = g_value_get_uint (value);
+      break;
+    case PROP_SRC_BUFFER_SIZE:
+      self->buffer_size = g_value_get_uint (value);
+      break;
+    case PROP_SRC_DO_TIMESTAMP:
+      self->do_timestamp = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_rawudp_batch_src_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (object);
+
+  switch (prop_id)
+  {
+    case PROP_SRC_SOCKET:
+      g_value_set_object (value, self->socket);
+      break;
+    case PROP_SRC_BATCH_SIZE:
+      g_value_set_uint (value, self->batch_size);
+      break;
+    case PROP_SRC_BUFFER_SIZE:
+      g_value_set_uint (value, self->buffer_size);
+      break;
+    case PROP_SRC_DO_TIMESTAMP:
+      g_value_set_boolean (value, self->do_timestamp);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_rawudp_batch_src_finalize (GObject *object)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (object);
+
+  if (self->socket)
+    g_object_unref (self->socket);
+  g_object_unref (self->cancellable);
+
+  g_mutex_clear (&self->mutex);
+  g_cond_clear (&self->cond);
+
+  G_OBJECT_CLASS (src_parent_class)->finalize (object);
+}
+
+static gboolean
+fs_rawudp_batch_src_activate_mode (GstPad *pad, GstObject *parent,
+    GstPadMode mode, gboolean active)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (parent);
+
+  if (mode != GST_PAD_MODE_PUSH)
+    return FALSE;
+
+  if (active)
+  {
+    g_mutex_lock (&self->mutex);
+    self->flushing = FALSE;
+    g_mutex_unlock (&self->mutex);
+    g_cancellable_reset (self->cancellable);
+    self->need_events = TRUE;
+
+    return gst_pad_start_task (pad, fs_rawudp_batch_src_loop, self, NULL);
+  }
+  else
+  {
+    g_mutex_lock (&self->mutex);
+    self->flushing = TRUE;
+    g_cond_broadcast (&self->cond);
+    g_mutex_unlock (&self->mutex);
+    g_cancellable_cancel (self->cancellable);
+
+    return gst_pad_stop_task (pad);
+  }
+}
+
+static gboolean
+fs_rawudp_batch_src_query (GstPad *pad, GstObject *parent, GstQuery *query)
+{
+  switch (GST_QUERY_TYPE (query))
+  {
+    case GST_QUERY_LATENCY:
+      /* We are a live source without any latency of our own */
+      gst_query_set_latency (query, TRUE, 0, GST_CLOCK_TIME_NONE);
+      return TRUE;
+    default:
+      return gst_pad_query_default (pad, parent, query);
+  }
+}
+
+static gboolean
+fs_rawudp_batch_src_start (FsRawUdpBatchSrc *self)
+{
+  GstStructure *config;
+  guint i;
+
+  if (!self->socket)
+  {
+    GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ, (NULL),
+        ("No socket set on the batched UDP source"));
+    return FALSE;
+  }
+
+  self->pool = gst_buffer_pool_new ();
+  config = gst_buffer_pool_get_config (self->pool);
+  gst_buffer_pool_config_set_params (config, NULL, self->buffer_size,
+      self->batch_size, 0);
+  if (!gst_buffer_pool_set_config (self->pool, config) ||
+      !gst_buffer_pool_set_active (self->pool, TRUE))
+  {
+    GST_ELEMENT_ERROR (self, RESOURCE, NO_SPACE_LEFT, (NULL),
+        ("Could not activate the buffer pool"));
+    gst_object_unref (self->pool);
+    self->pool = NULL;
+    return FALSE;
+  }
+
+  self->buffers = g_new0 (GstBuffer *, self->batch_size);
+  self->maps = g_new0 (GstMapInfo, self->batch_size);
+  self->overflows = g_new0 (GstMemory *, self->batch_size);
+  self->overflow_maps = g_new0 (GstMapInfo, self->batch_size);
+  self->msgs = g_new0 (struct mmsghdr, self->batch_size);
+  self->iovs = g_new0 (struct iovec, self->batch_size * 2);
+  self->addrs = g_new0 (struct sockaddr_storage, self->batch_size);
+
+  /* Like udpsrc, each datagram is scattered over a pooled buffer and an
+   * overflow memory that is only kept with the packet if it was used */
+  for (i = 0; i < self->batch_size; i++)
+  {
+    self->msgs[i].msg_hdr.msg_iov = &self->iovs[i * 2];
+    self->msgs[i].msg_hdr.msg_iovlen =
+        self->buffer_size < MAX_DATAGRAM_SIZE ? 2 : 1;
+    self->msgs[i].msg_hdr.msg_name = &self->addrs[i];
+  }
+
+  return TRUE;
+}
+
+static void
+fs_rawudp_batch_src_stop (FsRawUdpBatchSrc *self)
+{
+  guint i;
+
+  if (self->buffers)
+    for (i = 0; i < self->batch_size; i++)
+      if (self->buffers[i])
+        gst_buffer_unref (self->buffers[i]);
+
+  g_free (self->buffers);
+  self->buffers = NULL;
+  g_free (self->maps);
+  self->maps = NULL;
+
+  if (self->overflows)
+    for (i = 0; i < self->batch_size; i++)
+      if (self->overflows[i])
+        gst_memory_unref (self->overflows[i]);
+
+  g_free (self->overflows);
+  self->overflows = NULL;
+  g_free (self->overflow_maps);
+  self->overflow_maps = NULL;
+  g_free (self->msgs);
+  self->msgs = NULL;
+  g_free (self->iovs);
+  self->iovs = NULL;
+  g_free (self->addrs);
+  self->addrs = NULL;
+
+  if (self->pool)
+  {
+    gst_buffer_pool_set_active (self->pool, FALSE);
+    gst_object_unref (self->pool);
+    self->pool = NULL;
+  }
+}
+
+static GstStateChangeReturn
+fs_rawudp_batch_src_change_state (GstElement *element,
+    GstStateChange transition)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (element);
+  GstStateChangeReturn ret;
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!fs_rawudp_batch_src_start (self))
+        return GST_STATE_CHANGE_FAILURE;
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      g_mutex_lock (&self->mutex);
+      self->playing = TRUE;
+      g_cond_broadcast (&self->cond);
+      g_mutex_unlock (&self->mutex);
+      break;
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      g_mutex_lock (&self->mutex);
+      self->playing = FALSE;
+      g_mutex_unlock (&self->mutex);
+      /* Wake up the streaming thread if it's waiting for data */
+      g_cancellable_cancel (self->cancellable);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (src_parent_class)->change_state (element,
+      transition);
+
+  if (ret == GST_STATE_CHANGE_FAILURE)
+  {
+    if (transition == GST_STATE_CHANGE_READY_TO_PAUSED)
+      fs_rawudp_batch_src_stop (self);
+    return ret;
+  }
+
+  switch (transition)
+  {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+      ret = GST_STATE_CHANGE_NO_PREROLL;
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      fs_rawudp_batch_src_stop (self);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+static void
+fs_rawudp_batch_src_push_events (FsRawUdpBatchSrc *self)
+{
+  GstSegment segment;
+  gchar *stream_id;
+
+  stream_id = g_strdup_printf ("fsrawudpbatchsrc-%p", self);
+  gst_pad_push_event (self->srcpad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (self->srcpad, gst_event_new_segment (&segment));
+}
+
+static void
+fs_rawudp_batch_src_unmap (FsRawUdpBatchSrc *self, guint count)
+{
+  guint i;
+
+  for (i = 0; i < count; i++)
+  {
+    gst_buffer_unmap (self->buffers[i], &self->maps[i]);
+    if (self->msgs[i].msg_hdr.msg_iovlen > 1)
+      gst_memory_unmap (self->overflows[i], &self->overflow_maps[i]);
+  }
+}
+
+/*
+ * Reads as many datagrams as are available, up to batch-size, without
+ * blocking. Returns %NULL with @error unset if there was nothing to read.
+ */
+
+static GstBufferList *
+fs_rawudp_batch_src_receive (FsRawUdpBatchSrc *self, GError **error)
+{
+  GstBufferList *list;
+  GstClockTime timestamp = GST_CLOCK_TIME_NONE;
+  guint i;
+  gint n;
+  int errsv;
+
+  for (i = 0; i < self->batch_size; i++)
+  {
+    struct msghdr *hdr = &self->msgs[i].msg_hdr;
+
+    if (!self->buffers[i])
+    {
+      GstFlowReturn ret = gst_buffer_pool_acquire_buffer (self->pool,
+          &self->buffers[i], NULL);
+
+      if (ret != GST_FLOW_OK)
+      {
+        g_set_error (error, GST_RESOURCE_ERROR,
+            GST_RESOURCE_ERROR_NO_SPACE_LEFT,
+            "Could not allocate a buffer: %s", gst_flow_get_name (ret));
+        fs_rawudp_batch_src_unmap (self, i);
+        return NULL;
+      }
+    }
+
+    /* The buffer may have been shrunk the last time it was used */
+    gst_buffer_set_size (self->buffers[i], self->buffer_size);
+    gst_buffer_map (self->buffers[i], &self->maps[i], GST_MAP_WRITE);
+
+    self->iovs[i * 2].iov_base = self->maps[i].data;
+    self->iovs[i * 2].iov_len = self->maps[i].size;
+
+    if (hdr->msg_iovlen > 1)
+    {
+      if (!self->overflows[i])
+        self->overflows[i] = gst_allocator_alloc (NULL,
+            MAX_DATAGRAM_SIZE - self->buffer_size, NULL);
+      gst_memory_map (self->overflows[i], &self->overflow_maps[i],
+          GST_MAP_WRITE);
+
+      self->iovs[i * 2 + 1].iov_base = self->overflow_maps[i].data;
+      self->iovs[i * 2 + 1].iov_len = self->overflow_maps[i].size;
+    }
+
+    hdr->msg_namelen = sizeof (struct sockaddr_storage);
+    hdr->msg_control = NULL;
+    hdr->msg_controllen = 0;
+    hdr->msg_flags = 0;
+    self->msgs[i].msg_len = 0;
+  }
+
+  do {
+    n = recvmmsg (g_socket_get_fd (self->socket), self->msgs,
+        self->batch_size, MSG_DONTWAIT, NULL);
+  } while (n < 0 && errno == EINTR);
+  errsv = errno;
+
+  fs_rawudp_batch_src_unmap (self, self->batch_size);
+
+  if (n < 0)
+  {
+    /* ICMP errors from previous sends are reported here, ignore them */
+    if (errsv == EAGAIN || errsv == EWOULDBLOCK || errsv == ECONNREFUSED)
+      return NULL;
+
+    g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+        "Could not receive datagrams: %s", g_strerror (errsv));
+    return NULL;
+  }
+
+  if (self->do_timestamp)
+  {
+    GstClock *clock = gst_element_get_clock (GST_ELEMENT (self));
+
+    if (clock)
+    {
+      GstClockTime now = gst_clock_get_time (clock);
+      GstClockTime base_time = gst_element_get_base_time (GST_ELEMENT (self));
+
+      /* All the datagrams of a burst get the same timestamp */
+      timestamp = now > base_time ? now - base_time : 0;
+      gst_object_unref (clock);
+    }
+  }
+
+  list = gst_buffer_list_new_sized (n);
+
+  /* The buffers that were not filled are kept for the next burst */
+  for (i = 0; i < (guint) n; i++)
+  {
+    GstBuffer *buffer = self->buffers[i];
+    struct msghdr *hdr = &self->msgs[i].msg_hdr;
+    GSocketAddress *addr;
+
+    self->buffers[i] = NULL;
+
+    if (hdr->msg_flags & MSG_TRUNC)
+    {
+      GST_WARNING_OBJECT (self, "Dropping datagram larger than %u bytes",
+          MAX (self->buffer_size, MAX_DATAGRAM_SIZE));
+      gst_buffer_unref (buffer);
+      continue;
+    }
+
+    if (self->msgs[i].msg_len > self->buffer_size)
+    {
+      GstMemory *overflow = self->overflows[i];
+
+      /* A new one will be allocated for the next datagram of this slot */
+      self->overflows[i] = NULL;
+      gst_memory_resize (overflow, 0,
+          self->msgs[i].msg_len - self->buffer_size);
+      gst_buffer_append_memory (buffer, overflow);
+    }
+    else
+    {
+      gst_buffer_set_size (buffer, self->msgs[i].msg_len);
+    }
+
+    addr = g_socket_address_new_from_native (hdr->msg_name, hdr->msg_namelen);
+    if (addr)
+    {
+      gst_buffer_add_net_address_meta (buffer, addr);
+      g_object_unref (addr);
+    }
+
+    GST_BUFFER_PTS (buffer) = timestamp;
+    GST_BUFFER_DTS (buffer) = timestamp;
+
+    gst_buffer_list_add (list, buffer);
+  }
+
+  if (gst_buffer_list_length (list) == 0)
+  {
+    gst_buffer_list_unref (list);
+    return NULL;
+  }
+
+  return list;
+}
+
+static void
+fs_rawudp_batch_src_loop (gpointer user_data)
+{
+  FsRawUdpBatchSrc *self = FS_RAWUDP_BATCH_SRC (user_data);
+  GstBufferList *list;
+  GstFlowReturn ret;
+  GError *error = NULL;
+
+  g_mutex_lock (&self->mutex);
+  while (!self->playing && !self->flushing)
+    g_cond_wait (&self->cond, &self->mutex);
+  if (self->flushing)
+  {
+    g_mutex_unlock (&self->mutex);
+    goto pause;
+  }
+  g_mutex_unlock (&self->mutex);
+
+  if (self->need_events)
+  {
+    fs_rawudp_batch_src_push_events (self);
+    self->need_events = FALSE;
+  }
+
+  if (!g_socket_condition_wait (self->socket, G_IO_IN, self->cancellable,
+          &error))
+  {
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      /* Paused or flushing, the next iteration will tell */
+      g_clear_error (&error);
+      g_cancellable_reset (self->cancellable);
+      return;
+    }
+
+    GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL),
+        ("Could not wait for data: %s", error->message));
+    g_clear_error (&error);
+    goto pause;
+  }
+
+  list = fs_rawudp_batch_src_receive (self, &error);
+  if (!list)
+  {
+    if (error)
+    {
+      GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL), ("%s", error->message));
+      g_clear_error (&error);
+      goto pause;
+    }
+    return;
+  }
+
+  GST_LOG_OBJECT (self, "Pushing a burst of %u datagrams",
+      gst_buffer_list_length (list));
+
+  ret = gst_pad_push_list (self->srcpad, list);
+  if (ret != GST_FLOW_OK)
+  {
+    if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_EOS)
+      GST_ELEMENT_ERROR (self, STREAM, FAILED,
+          ("Internal data flow error."),
+          ("streaming task paused, reason %s (%d)", gst_flow_get_name (ret),
+              ret));
+    goto pause;
+  }
+
+  return;
+
+ pause:
+  GST_DEBUG_OBJECT (self, "Pausing task");
+  gst_pad_pause_task (self->srcpad);
+}
+
+static void
+fs_rawudp_batch_src_class_init (FsRawUdpBatchSrcClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  src_parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->set_property = fs_rawudp_batch_src_set_property;
+  gobject_class->get_property = fs_rawudp_batch_src_get_property;
+  gobject_class->finalize = fs_rawudp_batch_src_finalize;
+
+  gstelement_class->change_state = fs_rawudp_batch_src_change_state;
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rawudp_batch_src_template));
+
+  gst_element_class_set_metadata (gstelement_class,
+      "Farstream batched UDP source",
+      "Source/Network",
+      "Receives bursts of UDP datagrams as buffer lists",
+      "Farstream developers <farstream-devel@lists.freedesktop.org>");
+
+  g_object_class_install_property (gobject_class,
+      PROP_SRC_SOCKET,
+      g_param_spec_object ("socket",
+          "Socket",
+          "The socket to receive from",
+          G_TYPE_SOCKET,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SRC_BATCH_SIZE,
+      g_param_spec_uint ("batch-size",
+          "Batch size",
+          "The maximum number of datagrams read with one syscall",
+          1, FS_RAWUDP_BATCH_SIZE_MAX, DEFAULT_BATCH_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SRC_BUFFER_SIZE,
+      g_param_spec_uint ("buffer-size",
+          "Buffer size",
+          "The size of the pooled buffers, larger datagrams get an extra"
+          " memory appended",
+          576, G_MAXUINT16, DEFAULT_BUFFER_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SRC_DO_TIMESTAMP,
+      g_param_spec_boolean ("do-timestamp",
+          "Do timestamp",
+          "Timestamp the buffers with the running time of their reception",
+          FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+fs_rawudp_batch_src_init (FsRawUdpBatchSrc *self)
+{
+  self->srcpad = gst_pad_new_from_static_template (
+      &fs_rawudp_batch_src_template, "src");
+  gst_pad_set_activatemode_function (self->srcpad,
+      fs_rawudp_batch_src_activate_mode);
+  gst_pad_set_query_function (self->srcpad, fs_rawudp_batch_src_query);
+  gst_pad_use_fixed_caps (self->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->srcpad);
+
+  GST_OBJECT_FLAG_SET (self, GST_ELEMENT_FLAG_SOURCE);
+
+  self->batch_size = DEFAULT_BATCH_SIZE;
+  self->buffer_size = DEFAULT_BUFFER_SIZE;
+  self->cancellable = g_cancellable_new ();
+
+  g_mutex_init (&self->mutex);
+  g_cond_init (&self->cond);
+}
+
+/*
+ * FsRawUdpBatchSink
+ */
+
+struct _FsRawUdpBatchSink
+{
+  GstBaseSink parent;
+
+  /* Properties, can only be changed in the NULL or READY state */
+  GSocket *socket;
+  guint batch_size;
+
+  GCancellable *cancellable;
+
+  /* Protected by the object lock */
+  GArray *clients;
+
+  /* Only used from the streaming thread */
+  GArray *addrs;
+  GArray *msgs;
+  GstBuffer **buffers;
+  struct iovec *iovs;
+  GstMapInfo *maps;
+  guint *n_iovs;
+  gboolean *merged;
+};
+
+struct _FsRawUdpBatchSinkClass
+{
+  GstBaseSinkClass parent_class;
+
+  void (*add) (FsRawUdpBatchSink *self, const gchar *host, gint port);
+  void (*remove) (FsRawUdpBatchSink *self, const gchar *host, gint port);
+};
+
+struct BatchClient
+{
+  gchar *host;
+  gint port;
+  guint refcount;
+
+  struct sockaddr_storage addr;
+  socklen_t addrlen;
+};
+
+struct BatchAddr
+{
+  struct sockaddr_storage addr;
+  socklen_t addrlen;
+};
+
+enum
+{
+  SIGNAL_ADD,
+  SIGNAL_REMOVE,
+  LAST_SINK_SIGNAL
+};
+
+enum
+{
+  PROP_SINK_0,
+  PROP_SINK_SOCKET,
+  PROP_SINK_BATCH_SIZE
+};
+
+static GstStaticPadTemplate fs_rawudp_batch_sink_template =
+  GST_STATIC_PAD_TEMPLATE ("sink",
+      GST_PAD_SINK,
+      GST_PAD_ALWAYS,
+      GST_STATIC_CAPS_ANY);
+
+static GType sink_type = 0;
+static GstBaseSinkClass *sink_parent_class = NULL;
+static guint sink_signals[LAST_SINK_SIGNAL] = { 0 };
+
+GType
+fs_rawudp_batch_sink_get_type (void)
+{
+  g_assert (sink_type);
+  return sink_type;
+}
+
+static void
+fs_rawudp_batch_sink_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (object);
+
+  switch (prop_id)
+  {
+    case PROP_SINK_SOCKET:
+      if (self->socket)
+        g_object_unref (self->socket);
+      self->socket = g_value_dup_object (value);
+      break;
+    case PROP_SINK_BATCH_SIZE:
+      self->batch_size = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_rawudp_batch_sink_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (object);
+
+  switch (prop_id)
+  {
+    case PROP_SINK_SOCKET:
+      g_value_set_object (value, self->socket);
+      break;
+    case PROP_SINK_BATCH_SIZE:
+      g_value_set_uint (value, self->batch_size);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+fs_rawudp_batch_sink_finalize (GObject *object)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (object);
+  guint i;
+
+  for (i = 0; i < self->clients->len; i++)
+    g_free (g_array_index (self->clients, struct BatchClient, i).host);
+  g_array_free (self->clients, TRUE);
+
+  if (self->socket)
+    g_object_unref (self->socket);
+  g_object_unref (self->cancellable);
+
+  G_OBJECT_CLASS (sink_parent_class)->finalize (object);
+}
+
+static void
+fs_rawudp_batch_sink_add (FsRawUdpBatchSink *self, const gchar *host,
+    gint port)
+{
+  struct BatchClient client = {0};
+  GInetAddress *inetaddr;
+  GSocketAddress *addr;
+  gboolean ok;
+  guint i;
+
+  inetaddr = g_inet_address_new_from_string (host);
+  if (!inetaddr)
+  {
+    GST_WARNING_OBJECT (self, "Could not parse address %s", host);
+    return;
+  }
+
+  addr = g_inet_socket_address_new (inetaddr, port);
+  g_object_unref (inetaddr);
+  client.addrlen = g_socket_address_get_native_size (addr);
+  ok = g_socket_address_to_native (addr, &client.addr, sizeof (client.addr),
+      NULL);
+  g_object_unref (addr);
+
+  if (!ok)
+  {
+    GST_WARNING_OBJECT (self, "Could not convert address %s:%d", host, port);
+    return;
+  }
+
+  GST_OBJECT_LOCK (self);
+  for (i = 0; i < self->clients->len; i++)
+  {
+    struct BatchClient *c = &g_array_index (self->clients,
+        struct BatchClient, i);
+
+    if (c->port == port && !strcmp (c->host, host))
+    {
+      c->refcount++;
+      GST_OBJECT_UNLOCK (self);
+      return;
+    }
+  }
+
+  client.host = g_strdup (host);
+  client.port = port;
+  client.refcount = 1;
+  g_array_append_val (self->clients, client);
+  GST_OBJECT_UNLOCK (self);
+
+  GST_DEBUG_OBJECT (self, "Added destination %s:%d", host, port);
+}
+
+static void
+fs_rawudp_batch_sink_remove (FsRawUdpBatchSink *self, const gchar *host,
+    gint port)
+{
+  guint i;
+
+  GST_OBJECT_LOCK (self);
+  for (i = 0; i < self->clients->len; i++)
+  {
+    struct BatchClient *c = &g_array_index (self->clients,
+        struct BatchClient, i);
+
+    if (c->port == port && !strcmp (c->host, host))
+    {
+      if (--c->refcount == 0)
+      {
+        g_free (c->host);
+        g_array_remove_index (self->clients, i);
+        GST_DEBUG_OBJECT (self, "Removed destination %s:%d", host, port);
+      }
+      GST_OBJECT_UNLOCK (self);
+      return;
+    }
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  GST_WARNING_OBJECT (self, "Tried to remove unknown destination %s:%d",
+      host, port);
+}
+
+static gboolean
+fs_rawudp_batch_sink_start (GstBaseSink *sink)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (sink);
+
+  if (!self->socket)
+  {
+    GST_ELEMENT_ERROR (self, RESOURCE, OPEN_WRITE, (NULL),
+        ("No socket set on the batched UDP sink"));
+    return FALSE;
+  }
+
+  self->addrs = g_array_new (FALSE, TRUE, sizeof (struct BatchAddr));
+  self->msgs = g_array_new (FALSE, TRUE, sizeof (struct mmsghdr));
+  self->buffers = g_new0 (GstBuffer *, self->batch_size);
+  self->iovs = g_new0 (struct iovec, self->batch_size * MAX_IOV);
+  self->maps = g_new0 (GstMapInfo, self->batch_size * MAX_IOV);
+  self->n_iovs = g_new0 (guint, self->batch_size);
+  self->merged = g_new0 (gboolean, self->batch_size);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rawudp_batch_sink_stop (GstBaseSink *sink)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (sink);
+
+  g_array_free (self->addrs, TRUE);
+  self->addrs = NULL;
+  g_array_free (self->msgs, TRUE);
+  self->msgs = NULL;
+  g_free (self->buffers);
+  self->buffers = NULL;
+  g_free (self->iovs);
+  self->iovs = NULL;
+  g_free (self->maps);
+  self->maps = NULL;
+  g_free (self->n_iovs);
+  self->n_iovs = NULL;
+  g_free (self->merged);
+  self->merged = NULL;
+
+  return TRUE;
+}
+
+static gboolean
+fs_rawudp_batch_sink_unlock (GstBaseSink *sink)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (sink);
+
+  g_cancellable_cancel (self->cancellable);
+
+  return TRUE;
+}
+
+static gboolean
+fs_rawudp_batch_sink_unlock_stop (GstBaseSink *sink)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (sink);
+
+  g_cancellable_reset (self->cancellable);
+
+  return TRUE;
+}
+
+static void
+fs_rawudp_batch_sink_map_buffer (FsRawUdpBatchSink *self, guint b)
+{
+  GstBuffer *buffer = self->buffers[b];
+  struct iovec *iov = &self->iovs[b * MAX_IOV];
+  GstMapInfo *map = &self->maps[b * MAX_IOV];
+  guint n_mem = gst_buffer_n_memory (buffer);
+  guint i;
+
+  if (n_mem > MAX_IOV)
+  {
+    gst_buffer_map (buffer, map, GST_MAP_READ);
+    iov->iov_base = map->data;
+    iov->iov_len = map->size;
+    self->n_iovs[b] = 1;
+    self->merged[b] = TRUE;
+    return;
+  }
+
+  /* Send the memories in place, the RTP header and the payload are often
+   * separate */
+  for (i = 0; i < n_mem; i++)
+  {
+    gst_memory_map (gst_buffer_peek_memory (buffer, i), &map[i],
+        GST_MAP_READ);
+    iov[i].iov_base = map[i].data;
+    iov[i].iov_len = map[i].size;
+  }
+  self->n_iovs[b] = n_mem;
+  self->merged[b] = FALSE;
+}
+
+static void
+fs_rawudp_batch_sink_unmap_buffer (FsRawUdpBatchSink *self, guint b)
+{
+  GstMapInfo *map = &self->maps[b * MAX_IOV];
+  guint i;
+
+  if (self->merged[b])
+  {
+    gst_buffer_unmap (self->buffers[b], map);
+    return;
+  }
+
+  for (i = 0; i < self->n_iovs[b]; i++)
+    gst_memory_unmap (map[i].memory, &map[i]);
+}
+
+/*
+ * Sends the first @n_buffers of self->buffers to every destination
+ */
+
+static GstFlowReturn
+fs_rawudp_batch_sink_send (FsRawUdpBatchSink *self, guint n_buffers)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  struct mmsghdr *msgs;
+  guint n_clients;
+  guint n_msgs;
+  guint sent = 0;
+  guint b, c;
+  int fd;
+
+  GST_OBJECT_LOCK (self);
+  n_clients = self->clients->len;
+  g_array_set_size (self->addrs, n_clients);
+  for (c = 0; c < n_clients; c++)
+  {
+    struct BatchClient *client = &g_array_index (self->clients,
+        struct BatchClient, c);
+    struct BatchAddr *addr = &g_array_index (self->addrs, struct BatchAddr, c);
+
+    memcpy (&addr->addr, &client->addr, client->addrlen);
+    addr->addrlen = client->addrlen;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  if (n_clients == 0)
+    return GST_FLOW_OK;
+
+  n_msgs = n_buffers * n_clients;
+  g_array_set_size (self->msgs, n_msgs);
+  msgs = (struct mmsghdr *) self->msgs->data;
+
+  for (b = 0; b < n_buffers; b++)
+  {
+    fs_rawudp_batch_sink_map_buffer (self, b);
+
+    for (c = 0; c < n_clients; c++)
+    {
+      struct msghdr *hdr = &msgs[b * n_clients + c].msg_hdr;
+      struct BatchAddr *addr = &g_array_index (self->addrs, struct BatchAddr,
+          c);
+
+      memset (hdr, 0, sizeof (struct msghdr));
+      hdr->msg_name = &addr->addr;
+      hdr->msg_namelen = addr->addrlen;
+      hdr->msg_iov = &self->iovs[b * MAX_IOV];
+      hdr->msg_iovlen = self->n_iovs[b];
+    }
+  }
+
+  fd = g_socket_get_fd (self->socket);
+
+  while (sent < n_msgs)
+  {
+    gint n = sendmmsg (fd, msgs + sent,
+        MIN (n_msgs - sent, FS_RAWUDP_BATCH_SIZE_MAX), 0);
+
+    if (n >= 0)
+    {
+      sent += n;
+      continue;
+    }
+
+    if (errno == EINTR)
+      continue;
+
+    if (errno == EAGAIN || errno == EWOULDBLOCK)
+    {
+      GError *error = NULL;
+
+      if (!g_socket_condition_wait (self->socket, G_IO_OUT, self->cancellable,
+              &error))
+      {
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+          ret = GST_FLOW_FLUSHING;
+        else
+          GST_WARNING_OBJECT (self, "Could not wait for the socket: %s",
+              error->message);
+        g_clear_error (&error);
+        if (ret != GST_FLOW_OK)
+          break;
+      }
+      continue;
+    }
+
+    /* Like multiudpsink, a failing destination is not fatal, skip it */
+    GST_DEBUG_OBJECT (self, "Could not send datagram %u: %s", sent,
+        g_strerror (errno));
+    sent++;
+  }
+
+  for (b = 0; b < n_buffers; b++)
+    fs_rawudp_batch_sink_unmap_buffer (self, b);
+
+  return ret;
+}
+
+static GstFlowReturn
+fs_rawudp_batch_sink_render (GstBaseSink *sink, GstBuffer *buffer)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (sink);
+
+  self->buffers[0] = buffer;
+
+  return fs_rawudp_batch_sink_send (self, 1);
+}
+
+static GstFlowReturn
+fs_rawudp_batch_sink_render_list (GstBaseSink *sink, GstBufferList *list)
+{
+  FsRawUdpBatchSink *self = FS_RAWUDP_BATCH_SINK (sink);
+  GstFlowReturn ret = GST_FLOW_OK;
+  guint len = gst_buffer_list_length (list);
+  guint i, j;
+
+  for (i = 0; i < len && ret == GST_FLOW_OK; i += j)
+  {
+    for (j = 0; j < self->batch_size && i + j < len; j++)
+      self->buffers[j] = gst_buffer_list_get (list, i + j);
+
+    ret = fs_rawudp_batch_sink_send (self, j);
+  }
+
+  return ret;
+}
+
+static void
+fs_rawudp_batch_sink_class_init (FsRawUdpBatchSinkClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSinkClass *gstbasesink_class = GST_BASE_SINK_CLASS (klass);
+
+  sink_parent_class = g_type_class_peek_parent (klass);
+
+  gobject_class->set_property = fs_rawudp_batch_sink_set_property;
+  gobject_class->get_property = fs_rawudp_batch_sink_get_property;
+  gobject_class->finalize = fs_rawudp_batch_sink_finalize;
+
+  gstbasesink_class->start = fs_rawudp_batch_sink_start;
+  gstbasesink_class->stop = fs_rawudp_batch_sink_stop;
+  gstbasesink_class->unlock = fs_rawudp_batch_sink_unlock;
+  gstbasesink_class->unlock_stop = fs_rawudp_batch_sink_unlock_stop;
+  gstbasesink_class->render = fs_rawudp_batch_sink_render;
+  gstbasesink_class->render_list = fs_rawudp_batch_sink_render_list;
+
+  klass->add = fs_rawudp_batch_sink_add;
+  klass->remove = fs_rawudp_batch_sink_remove;
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&fs_rawudp_batch_sink_template));
+
+  gst_element_class_set_metadata (gstelement_class,
+      "Farstream batched UDP sink",
+      "Sink/Network",
+      "Sends buffer lists to multiple destinations in bursts of datagrams",
+      "Farstream developers <farstream-devel@lists.freedesktop.org>");
+
+  g_object_class_install_property (gobject_class,
+      PROP_SINK_SOCKET,
+      g_param_spec_object ("socket",
+          "Socket",
+          "The socket to send from",
+          G_TYPE_SOCKET,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SINK_BATCH_SIZE,
+      g_param_spec_uint ("batch-size",
+          "Batch size",
+          "The maximum number of buffers of a list sent at once",
+          1, FS_RAWUDP_BATCH_SIZE_MAX, DEFAULT_BATCH_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /* Same action signals as multiudpsink */
+  sink_signals[SIGNAL_ADD] = g_signal_new ("add",
+      G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (FsRawUdpBatchSinkClass, add),
+      NULL, NULL,
+      g_cclosure_marshal_generic,
+      G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_INT);
+
+  sink_signals[SIGNAL_REMOVE] = g_signal_new ("remove",
+      G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (FsRawUdpBatchSinkClass, remove),
+      NULL, NULL,
+      g_cclosure_marshal_generic,
+      G_TYPE_NONE, 2, G_TYPE_STRING, G_TYPE_INT);
+}
+
+static void
+fs_rawudp_batch_sink_init (FsRawUdpBatchSink *self)
+{
+  self->batch_size = DEFAULT_BATCH_SIZE;
+  self->cancellable = g_cancellable_new ();
+  self->clients = g_array_new (FALSE, TRUE, sizeof (struct BatchClient));
+
+  gst_base_sink_set_last_sample_enabled (GST_BASE_SINK (self), FALSE);
+}
+
+void
+fs_rawudp_batch_io_register_types (FsPlugin *module)
+{
+  static const GTypeInfo src_info = {
+    sizeof (FsRawUdpBatchSrcClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_rawudp_batch_src_class_init,
+    NULL,
+    NULL,
+    sizeof (FsRawUdpBatchSrc),
+    0,
+    (GInstanceInitFunc) fs_rawudp_batch_src_init
+  };
+  static const GTypeInfo sink_info = {
+    sizeof (FsRawUdpBatchSinkClass),
+    NULL,
+    NULL,
+    (GClassInitFunc) fs_rawudp_batch_sink_class_init,
+    NULL,
+    NULL,
+    sizeof (FsRawUdpBatchSink),
+    0,
+    (GInstanceInitFunc) fs_rawudp_batch_sink_init
+  };
+
+  src_type = g_type_module_register_type (G_TYPE_MODULE (module),
+      GST_TYPE_ELEMENT, "FsRawUdpBatchSrc", &src_info, 0);
+  sink_type = g_type_module_register_type (G_TYPE_MODULE (module),
+      GST_TYPE_BASE_SINK, "FsRawUdpBatchSink", &sink_info, 0);
+}
+
+#else /* FS_RAWUDP_HAVE_BATCH_IO */
+
+void
+fs_rawudp_batch_io_register_types (FsPlugin *module)
+{
+}
+
+#endif /* FS_RAWUDP_HAVE_BATCH_IO */
@@ -0,0 +1,71 @@
+/*
+ * Farstream - Farstream RAW UDP batched socket I/O
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rawudp-batch-io.h - Elements reading and writing bursts of datagrams
+ *   with a single syscall
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RAWUDP_BATCH_IO_H__
+#define __FS_RAWUDP_BATCH_IO_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+
+#include <farstream/fs-plugin.h>
+
+G_BEGIN_DECLS
+
+/* TYPE MACROS */
+#define FS_TYPE_RAWUDP_BATCH_SRC \
+  (fs_rawudp_batch_src_get_type ())
+#define FS_RAWUDP_BATCH_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_RAWUDP_BATCH_SRC, \
+    FsRawUdpBatchSrc))
+#define FS_IS_RAWUDP_BATCH_SRC(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_RAWUDP_BATCH_SRC))
+
+#define FS_TYPE_RAWUDP_BATCH_SINK \
+  (fs_rawudp_batch_sink_get_type ())
+#define FS_RAWUDP_BATCH_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), FS_TYPE_RAWUDP_BATCH_SINK, \
+    FsRawUdpBatchSink))
+#define FS_IS_RAWUDP_BATCH_SINK(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), FS_TYPE_RAWUDP_BATCH_SINK))
+
+typedef struct _FsRawUdpBatchSrc FsRawUdpBatchSrc;
+typedef struct _FsRawUdpBatchSrcClass FsRawUdpBatchSrcClass;
+typedef struct _FsRawUdpBatchSink FsRawUdpBatchSink;
+typedef struct _FsRawUdpBatchSinkClass FsRawUdpBatchSinkClass;
+
+/* The largest burst that can be requested */
+#define FS_RAWUDP_BATCH_SIZE_MAX (1024)
+
+/* Batched I/O is only available where the mmsg syscalls exist */
+#if defined (HAVE_RECVMMSG) && defined (HAVE_SENDMMSG)
+# define FS_RAWUDP_HAVE_BATCH_IO 1
+#endif
+
+GType fs_rawudp_batch_src_get_type (void);
+GType fs_rawudp_batch_sink_get_type (void);
+
+void fs_rawudp_batch_io_register_types (FsPlugin *module);
+
+G_END_DECLS
+
+#endif /* __FS_RAWUDP_BATCH_IO_H__ */
@@ -92,6 +92,17 @@ enum
 };
 
 
+/*
+ * Immutable copy of the remote address, so incoming packets can be
+ * compared against it without taking the component lock
+ */
+typedef struct {
+  gboolean unique;
+  guint16 port;
+  gsize len;
+  guint8 bytes[16];
+} RemoteKey;
+
 struct _FsRawUdpComponentPrivate
 {
   gboolean disposed;
@@ -153,6 +164,16 @@ struct _FsRawUdpComponentPrivate
 
   gboolean remote_is_unique;
 
+  /* Read without the lock from the streaming thread */
+  RemoteKey * volatile remote_key;
+  /* The number of streaming threads reading the remote_key */
+  volatile gint remote_key_readers;
+  /* Keys that have been replaced while a streaming thread may have been
+   * reading them, freed as soon as there is no reader left */
+  GSList *retired_remote_keys;
+  volatile gint have_retired_remote_keys;
+  volatile gint source_validated;
+
 #ifdef HAVE_GUPNP
   GSource *upnp_discovery_timeout_src;
   FsCandidate *local_upnp_candidate;
@@ -194,6 +215,8 @@ fs_rawudp_component_set_property (GObject *object,
     GParamSpec *pspec);
 
 
+static void remote_key_free (gpointer data, gpointer user_data);
+
 static gboolean
 fs_rawudp_component_emit_local_candidates (FsRawUdpComponent *self,
     GError **eror);
@@ -675,6 +698,10 @@ fs_rawudp_component_finalize (GObject *object)
   g_free (self->priv->ip);
   g_free (self->priv->stun_ip);
 
+  g_slice_free (RemoteKey, self->priv->remote_key);
+  g_slist_foreach (self->priv->retired_remote_keys, remote_key_free, NULL);
+  g_slist_free (self->priv->retired_remote_keys);
+
   g_mutex_clear (&self->priv->mutex);
 
   parent_class->finalize (object);
@@ -882,6 +909,84 @@ fs_rawudp_component_new (
   return self;
 }
 
+static void
+remote_key_free (gpointer data, gpointer user_data)
+{
+  g_slice_free (RemoteKey, data);
+}
+
+/*
+ * Once the key has been replaced, a reader that comes after can only see
+ * the new one, so if no reader is left, nobody can be using the old ones.
+ */
+
+static void
+fs_rawudp_component_free_retired_remote_keys_locked (FsRawUdpComponent *self)
+{
+  if (!self->priv->retired_remote_keys ||
+      g_atomic_int_get (&self->priv->remote_key_readers) != 0)
+    return;
+
+  g_slist_foreach (self->priv->retired_remote_keys, remote_key_free, NULL);
+  g_slist_free (self->priv->retired_remote_keys);
+  self->priv->retired_remote_keys = NULL;
+  g_atomic_int_set (&self->priv->have_retired_remote_keys, FALSE);
+}
+
+static void
+fs_rawudp_component_publish_remote_key_locked (FsRawUdpComponent *self)
+{
+  RemoteKey *key = NULL;
+  RemoteKey *old_key;
+
+  if (self->priv->remote_address &&
+      G_IS_INET_SOCKET_ADDRESS (self->priv->remote_address))
+  {
+    GInetSocketAddress *inet =
+      G_INET_SOCKET_ADDRESS (self->priv->remote_address);
+    GInetAddress *addr = g_inet_socket_address_get_address (inet);
+
+    key = g_slice_new0 (RemoteKey);
+    key->unique = self->priv->remote_is_unique;
+    key->port = g_inet_socket_address_get_port (inet);
+    key->len = MIN (g_inet_address_get_native_size (addr),
+        sizeof (key->bytes));
+    memcpy (key->bytes, g_inet_address_to_bytes (addr), key->len);
+  }
+
+  old_key = g_atomic_pointer_get (&self->priv->remote_key);
+  g_atomic_pointer_set (&self->priv->remote_key, key);
+
+  if (old_key)
+  {
+    self->priv->retired_remote_keys =
+      g_slist_prepend (self->priv->retired_remote_keys, old_key);
+    g_atomic_int_set (&self->priv->have_retired_remote_keys, TRUE);
+  }
+
+  fs_rawudp_component_free_retired_remote_keys_locked (self);
+}
+
+static gboolean
+remote_key_matches (RemoteKey *key, GSocketAddress *address)
+{
+  GInetSocketAddress *inet;
+  GInetAddress *addr;
+
+  if (!key || !key->unique || !G_IS_INET_SOCKET_ADDRESS (address))
+    return FALSE;
+
+  inet = G_INET_SOCKET_ADDRESS (address);
+  if (g_inet_socket_address_get_port (inet) != key->port)
+    return FALSE;
+
+  addr = g_inet_socket_address_get_address (inet);
+  if (g_inet_address_get_native_size (addr) != key->len)
+    return FALSE;
+
+  return !memcmp (g_inet_address_to_bytes (addr), key->bytes, key->len);
+}
+
 static void
 remote_is_unique_cb (gboolean unique, GSocketAddress *address,
     gpointer user_data)
@@ -897,6 +1002,7 @@ remote_is_unique_cb (gboolean unique, GSocketAddress *address,
   }
 
   self->priv->remote_is_unique = unique;
+  fs_rawudp_component_publish_remote_key_locked (self);
 
  out:
   FS_RAWUDP_COMPONENT_UNLOCK (self);
@@ -957,6 +1063,8 @@ fs_rawudp_component_set_remote_candidate (FsRawUdpComponent *self,
   self->priv->remote_is_unique =
     fs_rawudp_transmitter_udpport_add_known_address (self->priv->udpport,
         self->priv->remote_address, remote_is_unique_cb, self);
+  fs_rawudp_component_publish_remote_key_locked (self);
+  g_atomic_int_set (&self->priv->source_validated, FALSE);
 
   FS_RAWUDP_COMPONENT_UNLOCK (self);
 
@@ -1669,24 +1777,36 @@ static GstPadProbeReturn
 buffer_recv_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
 {
   FsRawUdpComponent *self = FS_RAWUDP_COMPONENT (user_data);
-  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
-  GstNetAddressMeta *netmeta = gst_buffer_get_net_address_meta (buffer);
+  GstBuffer *buffer;
+  GstNetAddressMeta *netmeta;
+  gboolean matches;
+
+  /* Nobody wants to hear about this source anymore */
+  if (g_atomic_int_get (&self->priv->source_validated))
+    return GST_PAD_PROBE_OK;
+
+  buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  netmeta = gst_buffer_get_net_address_meta (buffer);
 
   if (netmeta)
   {
-    FS_RAWUDP_COMPONENT_LOCK (self);
-    if (self->priv->remote_is_unique &&
-        fs_g_inet_socket_address_equal (self->priv->remote_address,
-            netmeta->addr))
+    g_atomic_int_inc (&self->priv->remote_key_readers);
+    matches = remote_key_matches (
+        g_atomic_pointer_get (&self->priv->remote_key), netmeta->addr);
+
+    /* The last reader frees the keys that were replaced under it, without
+     * ever waiting for the lock */
+    if (g_atomic_int_dec_and_test (&self->priv->remote_key_readers) &&
+        g_atomic_int_get (&self->priv->have_retired_remote_keys) &&
+        g_mutex_trylock (&self->priv->mutex))
     {
+      fs_rawudp_component_free_retired_remote_keys_locked (self);
       FS_RAWUDP_COMPONENT_UNLOCK (self);
+    }
+
+    if (matches)
       g_signal_emit (self, signals[KNOWN_SOURCE_PACKET_RECEIVED], 0,
           self->priv->component, buffer);
-    }
-    else
-    {
-      FS_RAWUDP_COMPONENT_UNLOCK (self);
-    }
   }
   else
   {
@@ -1695,3 +1815,16 @@ buffer_recv_cb (GstPad *pad, GstPadProbeInfo *info, gpointer user_data)
 
   return GST_PAD_PROBE_OK;
 }
+
+/*
+ * While the source is validated, incoming packets are not compared against
+ * the remote address and known-source-packet-received is not emitted.
+ * The validation is dropped when the remote candidate changes.
+ */
+
+void
+fs_rawudp_component_set_source_validated (FsRawUdpComponent *self,
+    gboolean validated)
+{
+  g_atomic_int_set (&self->priv->source_validated, validated);
+}
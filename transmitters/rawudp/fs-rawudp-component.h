@@ -123,6 +123,10 @@ fs_rawudp_component_gather_local_candidates (FsRawUdpComponent *self,
 void
 fs_rawudp_component_stop (FsRawUdpComponent *self);
 
+void
+fs_rawudp_component_set_source_validated (FsRawUdpComponent *self,
+    gboolean validated);
+
 G_END_DECLS
 
 #endif /* __FS_RAWUDP_COMPONENT_H__ */
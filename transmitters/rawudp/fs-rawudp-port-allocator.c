@@ -0,0 +1,450 @@
+/*
+ * Farstream - Farstream RAW UDP port allocator
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rawudp-port-allocator.c - Tracks the local ports in use and keeps a
+ *   pool of pre-bound sockets
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * The allocator remembers which ports the transmitters have bound on the
+ * wildcard address and which ones were found busy, so finding a free port
+ * is a bitmap scan instead of a series of failing bind() calls. The busy
+ * ports belong to someone else and may become free again, they are
+ * forgotten whenever the scan runs out of ports.
+ *
+ * The pool holds sockets that are already bound, one queue per component,
+ * and indexed by port so that the next component of a stream can get the
+ * port following the one of the first component.
+ *
+ * There is one allocator for the whole process, shared by all the rawudp
+ * transmitters, so they don't try each other's ports and share one pool.
+ * Except for ref and unref, its functions must be called between
+ * fs_rawudp_port_allocator_lock() and fs_rawudp_port_allocator_unlock().
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fs-rawudp-port-allocator.h"
+
+#include <string.h>
+
+#define N_PORTS (65536)
+#define BITS_PER_WORD (64)
+#define N_WORDS (N_PORTS / BITS_PER_WORD)
+
+#define PORT_WORD(port) ((port) / BITS_PER_WORD)
+#define PORT_BIT(port) (G_GUINT64_CONSTANT (1) << ((port) % BITS_PER_WORD))
+
+typedef struct {
+  guint port;
+  GSocket *socket;
+} PooledSocket;
+
+typedef struct {
+  /* of PooledSocket, oldest first */
+  GQueue queue;
+  /* port -> GList link in the queue */
+  GHashTable *by_port;
+} ComponentPool;
+
+struct _FsRawUdpPortAllocator {
+  guint refcount;
+
+  guint64 used[N_WORDS];
+  guint64 busy[N_WORDS];
+
+  guint components;
+  guint pool_size;
+  /* One per component, index 0 is unused */
+  ComponentPool *pools;
+};
+
+static GMutex allocator_mutex;
+/* Protected by the allocator_mutex */
+static FsRawUdpPortAllocator *allocator = NULL;
+
+/**
+ * fs_rawudp_port_allocator_ref:
+ * @components: the number of components of the transmitter
+ *
+ * Gets the allocator of the process, creating it for the first transmitter
+ * and adding pools if @components is more than it has.
+ *
+ * Returns: the #FsRawUdpPortAllocator, unref with
+ *  fs_rawudp_port_allocator_unref()
+ */
+
+FsRawUdpPortAllocator *
+fs_rawudp_port_allocator_ref (guint components)
+{
+  FsRawUdpPortAllocator *alloc;
+  guint c;
+
+  g_mutex_lock (&allocator_mutex);
+  if (!allocator)
+  {
+    allocator = g_slice_new0 (FsRawUdpPortAllocator);
+    allocator->pools = g_new0 (ComponentPool, 1);
+
+    /* Port 0 means "any port" to the kernel, never hand it out */
+    allocator->used[0] |= PORT_BIT (0);
+  }
+  alloc = allocator;
+  alloc->refcount++;
+
+  if (components > alloc->components)
+  {
+    /* The hash tables point to the queue links, not to the queues */
+    alloc->pools = g_renew (ComponentPool, alloc->pools, components + 1);
+    for (c = alloc->components + 1; c <= components; c++)
+    {
+      g_queue_init (&alloc->pools[c].queue);
+      alloc->pools[c].by_port = g_hash_table_new (g_direct_hash,
+          g_direct_equal);
+    }
+    alloc->components = components;
+  }
+  g_mutex_unlock (&allocator_mutex);
+
+  return alloc;
+}
+
+static void
+pooled_socket_free (PooledSocket *ps)
+{
+  g_socket_close (ps->socket, NULL);
+  g_object_unref (ps->socket);
+  g_slice_free (PooledSocket, ps);
+}
+
+/**
+ * fs_rawudp_port_allocator_unref:
+ * @alloc: a #FsRawUdpPortAllocator
+ *
+ * Once the last transmitter is gone, the pooled sockets are closed.
+ */
+
+void
+fs_rawudp_port_allocator_unref (FsRawUdpPortAllocator *alloc)
+{
+  guint c;
+
+  g_mutex_lock (&allocator_mutex);
+  g_assert (alloc == allocator);
+  if (--alloc->refcount > 0)
+  {
+    g_mutex_unlock (&allocator_mutex);
+    return;
+  }
+  allocator = NULL;
+  g_mutex_unlock (&allocator_mutex);
+
+  for (c = 1; c <= alloc->components; c++)
+  {
+    PooledSocket *ps;
+
+    while ((ps = g_queue_pop_head (&alloc->pools[c].queue)))
+      pooled_socket_free (ps);
+    g_hash_table_destroy (alloc->pools[c].by_port);
+  }
+
+  g_free (alloc->pools);
+  g_slice_free (FsRawUdpPortAllocator, alloc);
+}
+
+void
+fs_rawudp_port_allocator_lock (FsRawUdpPortAllocator *alloc)
+{
+  g_mutex_lock (&allocator_mutex);
+}
+
+void
+fs_rawudp_port_allocator_unlock (FsRawUdpPortAllocator *alloc)
+{
+  g_mutex_unlock (&allocator_mutex);
+}
+
+static gboolean
+port_is_free (FsRawUdpPortAllocator *alloc, guint port)
+{
+  guint w = PORT_WORD (port);
+
+  return !((alloc->used[w] | alloc->busy[w]) & PORT_BIT (port));
+}
+
+static guint
+find_free_port (FsRawUdpPortAllocator *alloc, guint from, guint step)
+{
+  guint port;
+
+  for (port = from; port < N_PORTS; port += step)
+  {
+    guint w = PORT_WORD (port);
+
+    /* With a step of 1, skip over the words that are completely taken */
+    if (step == 1 && port % BITS_PER_WORD == 0 &&
+        (alloc->used[w] | alloc->busy[w]) == G_MAXUINT64)
+    {
+      port += BITS_PER_WORD - 1;
+      continue;
+    }
+
+    if (port_is_free (alloc, port))
+      return port;
+
+    if (step == 0)
+      break;
+  }
+
+  return 0;
+}
+
+/**
+ * fs_rawudp_port_allocator_reserve:
+ * @alloc: a #FsRawUdpPortAllocator
+ * @from: the first port to try
+ * @step: the distance between the ports to try, 0 to only try @from
+ *
+ * Finds a port that is neither in use by the transmitter nor known to be
+ * busy and marks it as used.
+ *
+ * Returns: the reserved port or 0 if there is none
+ */
+
+guint
+fs_rawudp_port_allocator_reserve (FsRawUdpPortAllocator *alloc, guint from,
+    guint step)
+{
+  guint port = find_free_port (alloc, from, step);
+
+  if (port == 0)
+  {
+    /* Busy ports may have been freed since, give them another chance */
+    memset (alloc->busy, 0, sizeof (alloc->busy));
+    port = find_free_port (alloc, from, step);
+  }
+
+  if (port)
+    alloc->used[PORT_WORD (port)] |= PORT_BIT (port);
+
+  return port;
+}
+
+/**
+ * fs_rawudp_port_allocator_mark_busy:
+ * @alloc: a #FsRawUdpPortAllocator
+ * @port: a port reserved with fs_rawudp_port_allocator_reserve()
+ *
+ * Records that @port could not be bound because someone else uses it.
+ */
+
+void
+fs_rawudp_port_allocator_mark_busy (FsRawUdpPortAllocator *alloc, guint port)
+{
+  if (port == 0 || port >= N_PORTS)
+    return;
+
+  alloc->used[PORT_WORD (port)] &= ~PORT_BIT (port);
+  alloc->busy[PORT_WORD (port)] |= PORT_BIT (port);
+}
+
+/**
+ * fs_rawudp_port_allocator_release:
+ * @alloc: a #FsRawUdpPortAllocator
+ * @port: a port reserved with fs_rawudp_port_allocator_reserve()
+ *
+ * Records that the socket bound to @port was closed.
+ */
+
+void
+fs_rawudp_port_allocator_release (FsRawUdpPortAllocator *alloc, guint port)
+{
+  if (port == 0 || port >= N_PORTS)
+    return;
+
+  alloc->used[PORT_WORD (port)] &= ~PORT_BIT (port);
+}
+
+/**
+ * fs_rawudp_port_allocator_take_pooled:
+ * @alloc: a #FsRawUdpPortAllocator
+ * @component_id: the component the socket is for
+ * @port: the port that is wanted
+ * @any_port: whether a socket on another port is acceptable
+ * @used_port: location for the port of the returned socket
+ *
+ * Takes a socket out of the pool, the port stays reserved. A socket on
+ * another port is only returned if @port is taken, if it is free it must
+ * be bound instead.
+ *
+ * Returns: a bound #GSocket or %NULL if the pool has none that fits
+ */
+
+GSocket *
+fs_rawudp_port_allocator_take_pooled (FsRawUdpPortAllocator *alloc,
+    guint component_id, guint port, gboolean any_port, guint *used_port)
+{
+  ComponentPool *pool;
+  PooledSocket *ps = NULL;
+  GList *link;
+  GSocket *socket;
+
+  if (component_id == 0 || component_id > alloc->components)
+    return NULL;
+
+  pool = &alloc->pools[component_id];
+
+  link = g_hash_table_lookup (pool->by_port, GUINT_TO_POINTER (port));
+  if (link)
+  {
+    ps = link->data;
+    g_queue_delete_link (&pool->queue, link);
+  }
+  else if (any_port && (port == 0 || port >= N_PORTS ||
+          !port_is_free (alloc, port)))
+  {
+    ps = g_queue_pop_head (&pool->queue);
+  }
+
+  if (!ps)
+    return NULL;
+
+  g_hash_table_remove (pool->by_port, GUINT_TO_POINTER (ps->port));
+
+  socket = ps->socket;
+  *used_port = ps->port;
+  g_slice_free (PooledSocket, ps);
+
+  return socket;
+}
+
+/**
+ * fs_rawudp_port_allocator_add_pooled:
+ * @alloc: a #FsRawUdpPortAllocator
+ * @component_id: the component the socket is for
+ * @port: the port @socket is bound to
+ * @socket: a bound #GSocket, the pool takes ownership of it
+ *
+ * Adds a socket to the pool, even if it is full.
+ */
+
+void
+fs_rawudp_port_allocator_add_pooled (FsRawUdpPortAllocator *alloc,
+    guint component_id, guint port, GSocket *socket)
+{
+  ComponentPool *pool = &alloc->pools[component_id];
+  PooledSocket *ps = g_slice_new (PooledSocket);
+
+  ps->port = port;
+  ps->socket = socket;
+
+  g_queue_push_tail (&pool->queue, ps);
+  g_hash_table_insert (pool->by_port, GUINT_TO_POINTER (port),
+      g_queue_peek_tail_link (&pool->queue));
+}
+
+/**
+ * fs_rawudp_port_allocator_recycle:
+ * @alloc: a #FsRawUdpPortAllocator
+ * @component_id: the component the socket was used for
+ * @port: the port @socket is bound to
+ * @socket: a bound #GSocket that is no longer used
+ *
+ * Puts a socket back in the pool if it is not full. On success the pool
+ * takes ownership of @socket.
+ *
+ * Returns: %TRUE if the socket was pooled, %FALSE if it must be closed
+ */
+
+gboolean
+fs_rawudp_port_allocator_recycle (FsRawUdpPortAllocator *alloc,
+    guint component_id, guint port, GSocket *socket)
+{
+  if (component_id == 0 || component_id > alloc->components)
+    return FALSE;
+
+  if (g_queue_get_length (&alloc->pools[component_id].queue) >=
+      alloc->pool_size)
+    return FALSE;
+
+  fs_rawudp_port_allocator_add_pooled (alloc, component_id, port, socket);
+
+  return TRUE;
+}
+
+/**
+ * fs_rawudp_port_allocator_set_pool_size:
+ * @alloc: a #FsRawUdpPortAllocator
+ * @pool_size: the number of sockets to keep for each component
+ *
+ * Changes the size of the pool, closing the sockets that no longer fit and
+ * releasing their ports.
+ */
+
+void
+fs_rawudp_port_allocator_set_pool_size (FsRawUdpPortAllocator *alloc,
+    guint pool_size)
+{
+  guint c;
+
+  alloc->pool_size = pool_size;
+
+  for (c = 1; c <= alloc->components; c++)
+  {
+    ComponentPool *pool = &alloc->pools[c];
+
+    while (g_queue_get_length (&pool->queue) > pool_size)
+    {
+      PooledSocket *ps = g_queue_pop_tail (&pool->queue);
+
+      g_hash_table_remove (pool->by_port, GUINT_TO_POINTER (ps->port));
+      fs_rawudp_port_allocator_release (alloc, ps->port);
+      pooled_socket_free (ps);
+    }
+  }
+}
+
+guint
+fs_rawudp_port_allocator_get_pool_size (FsRawUdpPortAllocator *alloc)
+{
+  return alloc->pool_size;
+}
+
+/**
+ * fs_rawudp_port_allocator_get_pool_missing:
+ * @alloc: a #FsRawUdpPortAllocator
+ *
+ * Returns: how many groups of consecutive ports, one per component, must be
+ *   bound to fill the pool
+ */
+
+guint
+fs_rawudp_port_allocator_get_pool_missing (FsRawUdpPortAllocator *alloc)
+{
+  guint len;
+
+  if (alloc->components == 0)
+    return 0;
+
+  len = g_queue_get_length (&alloc->pools[1].queue);
+
+  return (len < alloc->pool_size) ? alloc->pool_size - len : 0;
+}
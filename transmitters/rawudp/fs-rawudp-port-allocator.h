@@ -0,0 +1,63 @@
+/*
+ * Farstream - Farstream RAW UDP port allocator
+ *
+ * Copyright 2026 Collabora Ltd.
+ *
+ * fs-rawudp-port-allocator.h - Tracks the local ports in use and keeps a
+ *   pool of pre-bound sockets
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __FS_RAWUDP_PORT_ALLOCATOR_H__
+#define __FS_RAWUDP_PORT_ALLOCATOR_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _FsRawUdpPortAllocator FsRawUdpPortAllocator;
+
+/* The largest number of socket groups the pool can hold */
+#define FS_RAWUDP_SOCKET_POOL_SIZE_MAX (4096)
+
+FsRawUdpPortAllocator *fs_rawudp_port_allocator_ref (guint components);
+void fs_rawudp_port_allocator_unref (FsRawUdpPortAllocator *alloc);
+
+void fs_rawudp_port_allocator_lock (FsRawUdpPortAllocator *alloc);
+void fs_rawudp_port_allocator_unlock (FsRawUdpPortAllocator *alloc);
+
+guint fs_rawudp_port_allocator_reserve (FsRawUdpPortAllocator *alloc,
+    guint from, guint step);
+void fs_rawudp_port_allocator_mark_busy (FsRawUdpPortAllocator *alloc,
+    guint port);
+void fs_rawudp_port_allocator_release (FsRawUdpPortAllocator *alloc,
+    guint port);
+
+GSocket *fs_rawudp_port_allocator_take_pooled (FsRawUdpPortAllocator *alloc,
+    guint component_id, guint port, gboolean any_port, guint *used_port);
+gboolean fs_rawudp_port_allocator_recycle (FsRawUdpPortAllocator *alloc,
+    guint component_id, guint port, GSocket *socket);
+void fs_rawudp_port_allocator_add_pooled (FsRawUdpPortAllocator *alloc,
+    guint component_id, guint port, GSocket *socket);
+
+void fs_rawudp_port_allocator_set_pool_size (FsRawUdpPortAllocator *alloc,
+    guint pool_size);
+guint fs_rawudp_port_allocator_get_pool_size (FsRawUdpPortAllocator *alloc);
+guint fs_rawudp_port_allocator_get_pool_missing (FsRawUdpPortAllocator *alloc);
+
+G_END_DECLS
+
+#endif /* __FS_RAWUDP_PORT_ALLOCATOR_H__ */
@@ -175,6 +175,9 @@ static gboolean fs_rawudp_stream_transmitter_force_remote_candidates (
 static gboolean fs_rawudp_stream_transmitter_gather_local_candidates (
     FsStreamTransmitter *streamtransmitter,
     GError **error);
+static void fs_rawudp_stream_transmitter_source_validated (
+    FsStreamTransmitter *streamtransmitter,
+    gboolean validated);
 
 static FsCandidate* fs_rawudp_stream_transmitter_build_forced_candidate (
     FsRawUdpStreamTransmitter *self,
@@ -249,6 +252,8 @@ fs_rawudp_stream_transmitter_class_init (FsRawUdpStreamTransmitterClass *klass)
   streamtransmitterclass->gather_local_candidates =
     fs_rawudp_stream_transmitter_gather_local_candidates;
   streamtransmitterclass->stop = fs_rawudp_stream_transmitter_stop;
+  streamtransmitterclass->source_validated =
+    fs_rawudp_stream_transmitter_source_validated;
 
   g_object_class_override_property (gobject_class, PROP_SENDING, "sending");
   g_object_class_override_property (gobject_class,
@@ -707,6 +712,26 @@ fs_rawudp_stream_transmitter_stop (FsStreamTransmitter *streamtransmitter)
   }
 }
 
+static void
+fs_rawudp_stream_transmitter_source_validated (
+    FsStreamTransmitter *streamtransmitter,
+    gboolean validated)
+{
+  FsRawUdpStreamTransmitter *self =
+    FS_RAWUDP_STREAM_TRANSMITTER (streamtransmitter);
+  gint c;
+
+  if (self->priv->component)
+  {
+    for (c = 1; c <= self->priv->transmitter->components; c++)
+    {
+      if (self->priv->component[c])
+        fs_rawudp_component_set_source_validated (self->priv->component[c],
+            validated);
+    }
+  }
+}
+
 
 static gboolean
 fs_rawudp_stream_transmitter_force_remote_candidates (
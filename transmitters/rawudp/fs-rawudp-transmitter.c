@@ -36,6 +36,8 @@
 
 #include "fs-rawudp-transmitter.h"
 #include "fs-rawudp-stream-transmitter.h"
+#include "fs-rawudp-batch-io.h"
+#include "fs-rawudp-port-allocator.h"
 
 #include <farstream/fs-conference.h>
 #include <farstream/fs-plugin.h>
@@ -66,9 +68,15 @@ enum
   PROP_GST_SRC,
   PROP_COMPONENTS,
   PROP_TYPE_OF_SERVICE,
-  PROP_DO_TIMESTAMP
+  PROP_DO_TIMESTAMP,
+  PROP_BATCH_SIZE,
+  PROP_RECEIVE_SHARDS,
+  PROP_SOCKET_POOL_SIZE
 };
 
+/* The pool is filled with ports starting from the usual RTP port */
+#define SOCKET_POOL_FIRST_PORT (7078)
+
 struct _FsRawUdpTransmitterPrivate
 {
   /* We hold references to this element */
@@ -87,6 +95,11 @@ struct _FsRawUdpTransmitterPrivate
 
   gint type_of_service;
   gboolean do_timestamp;
+  guint batch_size;
+  guint receive_shards;
+  /* Bitmap of the wildcard ports and pool of pre-bound sockets, shared
+   * with the other transmitters and protected by its own lock */
+  FsRawUdpPortAllocator *port_allocator;
 
   gboolean disposed;
 };
@@ -122,6 +135,9 @@ static GType fs_rawudp_transmitter_get_stream_transmitter_type (
 static void fs_rawudp_transmitter_set_type_of_service (
     FsRawUdpTransmitter *self,
     gint tos);
+static void fs_rawudp_transmitter_set_socket_pool_size (
+    FsRawUdpTransmitter *self,
+    guint pool_size);
 
 
 static GObjectClass *parent_class = NULL;
@@ -161,6 +177,7 @@ fs_rawudp_transmitter_register_type (FsPlugin *module)
       "Farstream raw UDP transmitter");
 
   fs_rawudp_stream_transmitter_register_type (module);
+  fs_rawudp_batch_io_register_types (module);
 
   type = g_type_module_register_type (G_TYPE_MODULE (module),
       FS_TYPE_TRANSMITTER, "FsRawUdpTransmitter", &info, 0);
@@ -193,6 +210,64 @@ fs_rawudp_transmitter_class_init (FsRawUdpTransmitterClass *klass)
   g_object_class_override_property (gobject_class, PROP_DO_TIMESTAMP,
       "do-timestamp");
 
+  /**
+   * FsRawUdpTransmitter:batch-size:
+   *
+   * If non-zero, the sockets are read and written in bursts of up to this
+   * many datagrams per syscall (with recvmmsg() and sendmmsg()) instead of
+   * using udpsrc and multiudpsink, received packets are pushed downstream
+   * as buffer lists. This only applies to ports created after it is set and
+   * is ignored on platforms without these syscalls.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_BATCH_SIZE,
+      g_param_spec_uint ("batch-size",
+          "Number of datagrams per syscall",
+          "Read and write bursts of up to this many datagrams per syscall"
+          " (0 to use udpsrc and multiudpsink)",
+          0, FS_RAWUDP_BATCH_SIZE_MAX, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * FsRawUdpTransmitter:receive-shards:
+   *
+   * The number of sockets bound to each local port with SO_REUSEPORT, each
+   * one read by its own streaming thread. The kernel spreads the incoming
+   * packets between them by their source address, so the packets of one
+   * sender stay in order. This only applies to ports created after it is set
+   * and is ignored on platforms without SO_REUSEPORT.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_RECEIVE_SHARDS,
+      g_param_spec_uint ("receive-shards",
+          "Number of receiving sockets per port",
+          "Number of SO_REUSEPORT sockets, each with its own thread,"
+          " receiving on each port",
+          1, FS_RAWUDP_RECEIVE_SHARDS_MAX, 1,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * FsRawUdpTransmitter:socket-pool-size:
+   *
+   * The number of groups of sockets, one per component on consecutive
+   * ports, that are bound in advance on the wildcard address. New streams
+   * that do not ask for a specific local address take their sockets from
+   * this pool instead of binding new ones, and the sockets of the streams
+   * that go away are put back in it. Setting it binds the missing sockets
+   * right away.
+   *
+   * The pool is shared by all the rawudp transmitters of the process, so
+   * this is the size of the shared pool.
+   */
+  g_object_class_install_property (gobject_class,
+      PROP_SOCKET_POOL_SIZE,
+      g_param_spec_uint ("socket-pool-size",
+          "Number of pre-bound socket groups",
+          "Number of groups of sockets bound in advance and reused by new"
+          " streams (0 to disable)",
+          0, FS_RAWUDP_SOCKET_POOL_SIZE_MAX, 0,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   transmitter_class->new_stream_transmitter =
     fs_rawudp_transmitter_new_stream_transmitter;
   transmitter_class->get_stream_transmitter_type =
@@ -215,6 +290,7 @@ fs_rawudp_transmitter_init (FsRawUdpTransmitter *self)
   self->components = 2;
   g_mutex_init (&self->priv->mutex);
   self->priv->do_timestamp = TRUE;
+  self->priv->receive_shards = 1;
 }
 
 static void
@@ -233,6 +309,8 @@ fs_rawudp_transmitter_constructed (GObject *object)
   self->priv->udpsrc_funnels = g_new0 (GstElement *, self->components+1);
   self->priv->udpsink_tees = g_new0 (GstElement *, self->components+1);
   self->priv->udpports = g_new0 (GList *, self->components+1);
+  self->priv->port_allocator =
+    fs_rawudp_port_allocator_ref (self->components);
 
   /* First we need the src elemnet */
 
@@ -424,6 +502,12 @@ fs_rawudp_transmitter_finalize (GObject *object)
     self->priv->udpports = NULL;
   }
 
+  if (self->priv->port_allocator)
+  {
+    fs_rawudp_port_allocator_unref (self->priv->port_allocator);
+    self->priv->port_allocator = NULL;
+  }
+
   g_mutex_clear (&self->priv->mutex);
 
   parent_class->finalize (object);
@@ -456,6 +540,22 @@ fs_rawudp_transmitter_get_property (GObject *object,
     case PROP_DO_TIMESTAMP:
       g_value_set_boolean (value, self->priv->do_timestamp);
       break;
+    case PROP_BATCH_SIZE:
+      g_mutex_lock (&self->priv->mutex);
+      g_value_set_uint (value, self->priv->batch_size);
+      g_mutex_unlock (&self->priv->mutex);
+      break;
+    case PROP_RECEIVE_SHARDS:
+      g_mutex_lock (&self->priv->mutex);
+      g_value_set_uint (value, self->priv->receive_shards);
+      g_mutex_unlock (&self->priv->mutex);
+      break;
+    case PROP_SOCKET_POOL_SIZE:
+      fs_rawudp_port_allocator_lock (self->priv->port_allocator);
+      g_value_set_uint (value, fs_rawudp_port_allocator_get_pool_size (
+              self->priv->port_allocator));
+      fs_rawudp_port_allocator_unlock (self->priv->port_allocator);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -482,6 +582,30 @@ fs_rawudp_transmitter_set_property (GObject *object,
     case PROP_DO_TIMESTAMP:
       self->priv->do_timestamp = g_value_get_boolean (value);
       break;
+    case PROP_BATCH_SIZE:
+      g_mutex_lock (&self->priv->mutex);
+      self->priv->batch_size = g_value_get_uint (value);
+#ifndef FS_RAWUDP_HAVE_BATCH_IO
+      if (self->priv->batch_size)
+        GST_WARNING ("Batched I/O is not available on this platform,"
+            " using udpsrc and multiudpsink");
+#endif
+      g_mutex_unlock (&self->priv->mutex);
+      break;
+    case PROP_RECEIVE_SHARDS:
+      g_mutex_lock (&self->priv->mutex);
+      self->priv->receive_shards = g_value_get_uint (value);
+#ifndef SO_REUSEPORT
+      if (self->priv->receive_shards > 1)
+        GST_WARNING ("SO_REUSEPORT is not available on this platform,"
+            " using a single socket per port");
+#endif
+      g_mutex_unlock (&self->priv->mutex);
+      break;
+    case PROP_SOCKET_POOL_SIZE:
+      fs_rawudp_transmitter_set_socket_pool_size (self,
+          g_value_get_uint (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -531,6 +655,16 @@ struct _UdpPort {
   GstElement *udpsink;
   GstPad *udpsink_requested_pad;
 
+  /* If the udpsrc and udpsink are the batched elements */
+  gboolean batched;
+
+  /* Extra sockets bound to the same port with SO_REUSEPORT, each read by its
+   * own source, the first shard is the socket and udpsrc above */
+  guint n_extra_shards;
+  GSocket **shard_sockets;
+  GstElement **shard_srcs;
+  GstPad **shard_requested_pads;
+
   gchar *requested_ip;
   guint requested_port;
 
@@ -546,27 +680,117 @@ struct _UdpPort {
 
   /* Everything below is protected by the mutex */
   GMutex mutex;
-  GArray *known_addresses;
+  /* GSocketAddress -> GArray of struct KnownAddress */
+  GHashTable *known_addresses;
+  /* probe id on the udpsrc -> GArray of the probe ids on the extra shards */
+  GHashTable *shard_probes;
 };
 
 struct KnownAddress {
   FsRawUdpAddressUniqueCallbackFunc callback;
   gpointer user_data;
-  GSocketAddress *addr;
 };
 
+static void
+_set_socket_tos (GSocket *socket, int tos)
+{
+  int fd = g_socket_get_fd (socket);
+
+  if (setsockopt (fd, IPPROTO_IP, IP_TOS, &tos, sizeof (tos)) < 0)
+    GST_WARNING ("could not set socket ToS: %s", g_strerror (errno));
+
+#ifdef IPV6_TCLASS
+  if (setsockopt (fd, IPPROTO_IPV6, IPV6_TCLASS, &tos, sizeof (tos)) < 0)
+    GST_WARNING ("could not set TCLASS: %s", g_strerror (errno));
+#endif
+}
+
+static gboolean
+_set_socket_reuseport (GSocket *socket)
+{
+#ifdef SO_REUSEPORT
+  int one = 1;
+
+  if (setsockopt (g_socket_get_fd (socket), SOL_SOCKET, SO_REUSEPORT, &one,
+          sizeof (one)) < 0)
+  {
+    GST_WARNING ("could not set SO_REUSEPORT: %s", g_strerror (errno));
+    return FALSE;
+  }
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+/*
+ * A socket with SO_REUSEPORT can be bound to a port that another one of the
+ * same user already has with it, and would then steal part of its packets.
+ * So the port is first checked by binding a socket without it, which only
+ * succeeds if nobody uses the port. If @port is 0, it is set to the one
+ * the probe got.
+ */
+
+static gboolean
+_port_is_free (GInetAddress *addr, guint *port)
+{
+  GSocketAddress *socket_addr;
+  GSocket *probe;
+  gboolean ret;
+
+  probe = g_socket_new (g_inet_address_get_family (addr),
+      G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, NULL);
+  if (!probe)
+    return FALSE;
+
+  socket_addr = g_inet_socket_address_new (addr, *port);
+  ret = g_socket_bind (probe, socket_addr, FALSE, NULL);
+  g_object_unref (socket_addr);
+
+  if (ret && *port == 0)
+  {
+    socket_addr = g_socket_get_local_address (probe, NULL);
+    if (socket_addr)
+    {
+      *port = g_inet_socket_address_get_port (
+          G_INET_SOCKET_ADDRESS (socket_addr));
+      g_object_unref (socket_addr);
+    }
+    else
+    {
+      ret = FALSE;
+    }
+  }
+
+  g_socket_close (probe, NULL);
+  g_object_unref (probe);
+
+  return ret;
+}
+
+/*
+ * Binds a socket to @port or the next free one of the same parity. On the
+ * wildcard address, the ports are taken from the shared allocator
+ * so the ones we already hold are skipped without trying to bind them.
+ * With @reuseport, the port must be free before the socket with
+ * SO_REUSEPORT is bound to it, the shards are bound next to it afterwards.
+ */
+
 static GSocket *
 _bind_port (
+    FsRawUdpTransmitter *trans,
     const gchar *ip,
     guint port,
     guint *used_port,
     int tos,
+    gboolean reuseport,
     GError **error)
 {
   GSocketAddress *socket_addr;
   GInetAddress *addr;
   GSocket *socket;
-  int fd;
+  gboolean use_allocator = (ip == NULL && port != 0);
 
   if (ip)
   {
@@ -587,24 +811,47 @@ _bind_port (
   if (!socket)
     return FALSE;
 
-  for (;;) {
-    socket_addr = g_inet_socket_address_new (addr, port);
+  if (reuseport)
+    _set_socket_reuseport (socket);
 
-    if (g_socket_bind (socket, socket_addr, FALSE, NULL))
-      break;
-
-    g_object_unref (socket_addr);
+  for (;;) {
+    if (use_allocator)
+    {
+      fs_rawudp_port_allocator_lock (trans->priv->port_allocator);
+      port = fs_rawudp_port_allocator_reserve (trans->priv->port_allocator,
+          port, 2);
+      fs_rawudp_port_allocator_unlock (trans->priv->port_allocator);
+    }
 
-    GST_INFO ("could not bind port %d", port);
-    port += 2;
-    if (port > 65535)
+    if ((use_allocator && port == 0) || port > 65535)
     {
       g_set_error (error, FS_ERROR, FS_ERROR_NETWORK,
           "Could not bind the socket to a port");
       g_socket_close (socket, NULL);
       g_object_unref (socket);
+      g_object_unref (addr);
       return NULL;
     }
+
+    if (!reuseport || _port_is_free (addr, &port))
+    {
+      socket_addr = g_inet_socket_address_new (addr, port);
+
+      if (g_socket_bind (socket, socket_addr, FALSE, NULL))
+        break;
+
+      g_object_unref (socket_addr);
+    }
+
+    if (use_allocator)
+    {
+      fs_rawudp_port_allocator_lock (trans->priv->port_allocator);
+      fs_rawudp_port_allocator_mark_busy (trans->priv->port_allocator, port);
+      fs_rawudp_port_allocator_unlock (trans->priv->port_allocator);
+    }
+
+    GST_INFO ("could not bind port %d", port);
+    port += 2;
   }
 
   g_object_unref (socket_addr);
@@ -612,16 +859,57 @@ _bind_port (
 
   *used_port = port;
 
-  fd = g_socket_get_fd (socket);
+  _set_socket_tos (socket, tos);
 
-  if (setsockopt (fd, IPPROTO_IP, IP_TOS, &tos, sizeof (tos)) < 0)
-    GST_WARNING ("could not set socket ToS: %s", g_strerror (errno));
+  return socket;
+}
 
-#ifdef IPV6_TCLASS
-  if (setsockopt (fd, IPPROTO_IPV6, IPV6_TCLASS, &tos, sizeof (tos)) < 0)
-    GST_WARNING ("could not set TCLASS: %s", g_strerror (errno));
-#endif
+/* Throws away the packets that were sent to the previous user of a socket */
+
+static void
+_drain_socket (GSocket *socket)
+{
+  gchar buf[1];
+
+  while (g_socket_receive_with_blocking (socket, buf, sizeof (buf), FALSE,
+          NULL, NULL) >= 0);
+}
+
+/*
+ * Binds one more socket to the exact local address of @first, which must
+ * have been bound with SO_REUSEPORT
+ */
+
+static GSocket *
+_bind_shard (GSocket *first, int tos, GError **error)
+{
+  GSocketAddress *local_addr;
+  GSocket *socket;
+
+  local_addr = g_socket_get_local_address (first, error);
+  if (!local_addr)
+    return NULL;
 
+  socket = g_socket_new (g_socket_get_family (first),
+      G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, error);
+  if (!socket)
+    goto out;
+
+  if (!_set_socket_reuseport (socket) ||
+      !g_socket_bind (socket, local_addr, FALSE, error))
+  {
+    if (error && !*error)
+      g_set_error (error, FS_ERROR, FS_ERROR_NETWORK,
+          "Could not share the port with SO_REUSEPORT");
+    g_socket_close (socket, NULL);
+    g_clear_object (&socket);
+    goto out;
+  }
+
+  _set_socket_tos (socket, tos);
+
+ out:
+  g_object_unref (local_addr);
   return socket;
 }
 
@@ -634,6 +922,7 @@ _create_sinksource (
     GSocket *socket,
     GstPadDirection direction,
     gboolean do_timestamp,
+    guint batch_size,
     GstPad **requested_pad,
     GError **error)
 {
@@ -644,19 +933,32 @@ _create_sinksource (
 
   g_assert (direction == GST_PAD_SINK || direction == GST_PAD_SRC);
 
-  elem = gst_element_factory_make (elementname, NULL);
-  if (!elem)
+#ifdef FS_RAWUDP_HAVE_BATCH_IO
+  if (batch_size)
   {
-    g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
-        "Could not create the %s element", elementname);
-    return NULL;
+    elem = g_object_new (direction == GST_PAD_SINK ?
+        FS_TYPE_RAWUDP_BATCH_SINK : FS_TYPE_RAWUDP_BATCH_SRC,
+        "batch-size", batch_size,
+        NULL);
   }
+  else
+#endif
+  {
+    elem = gst_element_factory_make (elementname, NULL);
+    if (!elem)
+    {
+      g_set_error (error, FS_ERROR, FS_ERROR_CONSTRUCTION,
+          "Could not create the %s element", elementname);
+      return NULL;
+    }
 
-  g_object_set (elem,
-      "auto-multicast", FALSE,
-      "close-socket", FALSE,
-      "socket", socket,
-      NULL);
+    g_object_set (elem,
+        "auto-multicast", FALSE,
+        "close-socket", FALSE,
+        NULL);
+  }
+
+  g_object_set (elem, "socket", socket, NULL);
 
   if (direction == GST_PAD_SINK)
     g_object_set (elem,
@@ -832,6 +1134,9 @@ fs_rawudp_transmitter_get_udpport (FsRawUdpTransmitter *trans,
   UdpPort *udpport;
   UdpPort *tmpudpport;
   int tos;
+  guint batch_size;
+  guint shards;
+  guint i;
 
   /* First lets check if we already have one */
   if (component_id > trans->components)
@@ -845,8 +1150,17 @@ fs_rawudp_transmitter_get_udpport (FsRawUdpTransmitter *trans,
   udpport = fs_rawudp_transmitter_get_udpport_locked (trans, component_id,
       requested_ip, requested_port);
   tos = trans->priv->type_of_service;
+  batch_size = trans->priv->batch_size;
+  shards = trans->priv->receive_shards;
   g_mutex_unlock (&trans->priv->mutex);
 
+#ifndef FS_RAWUDP_HAVE_BATCH_IO
+  batch_size = 0;
+#endif
+#ifndef SO_REUSEPORT
+  shards = 1;
+#endif
+
   if (udpport)
     return udpport;
 
@@ -859,14 +1173,35 @@ fs_rawudp_transmitter_get_udpport (FsRawUdpTransmitter *trans,
   udpport->requested_ip = g_strdup (requested_ip);
   udpport->requested_port = requested_port;
   udpport->component_id = component_id;
+  udpport->batched = (batch_size > 0);
   g_mutex_init (&udpport->mutex);
-  udpport->known_addresses = g_array_new (TRUE, FALSE,
-      sizeof (struct KnownAddress));
+  udpport->known_addresses = g_hash_table_new_full (
+      fs_g_inet_socket_address_hash, fs_g_inet_socket_address_equal_func,
+      g_object_unref, (GDestroyNotify) g_array_unref);
+  udpport->shard_probes = g_hash_table_new_full (g_direct_hash,
+      g_direct_equal, NULL, (GDestroyNotify) g_array_unref);
+
+  /* Now lets bind the port, taking it from the pool if we can, the first
+   * component accepts any pooled port and the others follow it */
 
-  /* Now lets bind both ports */
+  if (!requested_ip && shards == 1)
+  {
+    fs_rawudp_port_allocator_lock (trans->priv->port_allocator);
+    udpport->socket = fs_rawudp_port_allocator_take_pooled (
+        trans->priv->port_allocator, component_id, requested_port,
+        (component_id == 1), &udpport->port);
+    fs_rawudp_port_allocator_unlock (trans->priv->port_allocator);
 
-  udpport->socket = _bind_port (requested_ip, requested_port, &udpport->port,
-      tos, error);
+    if (udpport->socket)
+    {
+      GST_DEBUG ("Took port %u from the socket pool", udpport->port);
+      _set_socket_tos (udpport->socket, tos);
+    }
+  }
+
+  if (!udpport->socket)
+    udpport->socket = _bind_port (trans, requested_ip, requested_port,
+        &udpport->port, tos, (shards > 1), error);
   if (!udpport->socket)
     goto error;
 
@@ -877,15 +1212,37 @@ fs_rawudp_transmitter_get_udpport (FsRawUdpTransmitter *trans,
 
   udpport->udpsrc = _create_sinksource ("udpsrc",
       GST_BIN (trans->priv->gst_src), udpport->funnel, NULL,
-      udpport->socket, GST_PAD_SRC, trans->priv->do_timestamp,
+      udpport->socket, GST_PAD_SRC, trans->priv->do_timestamp, batch_size,
       &udpport->udpsrc_requested_pad, error);
   if (!udpport->udpsrc)
     goto error;
 
+  if (shards > 1)
+  {
+    udpport->shard_sockets = g_new0 (GSocket *, shards - 1);
+    udpport->shard_srcs = g_new0 (GstElement *, shards - 1);
+    udpport->shard_requested_pads = g_new0 (GstPad *, shards - 1);
+  }
+
+  for (i = 0; i + 1 < shards; i++)
+  {
+    udpport->shard_sockets[i] = _bind_shard (udpport->socket, tos, error);
+    if (!udpport->shard_sockets[i])
+      goto error;
+    udpport->n_extra_shards++;
+
+    udpport->shard_srcs[i] = _create_sinksource ("udpsrc",
+        GST_BIN (trans->priv->gst_src), udpport->funnel, NULL,
+        udpport->shard_sockets[i], GST_PAD_SRC, trans->priv->do_timestamp,
+        batch_size, &udpport->shard_requested_pads[i], error);
+    if (!udpport->shard_srcs[i])
+      goto error;
+  }
+
   udpport->udpsink = _create_sinksource ("multiudpsink",
       GST_BIN (trans->priv->gst_sink), udpport->tee, NULL,
-      udpport->socket, GST_PAD_SINK, FALSE, &udpport->udpsink_requested_pad,
-      error);
+      udpport->socket, GST_PAD_SINK, FALSE, batch_size,
+      &udpport->udpsink_requested_pad, error);
   if (!udpport->udpsink)
     goto error;
 
@@ -917,6 +1274,8 @@ void
 fs_rawudp_transmitter_put_udpport (FsRawUdpTransmitter *trans,
   UdpPort *udpport)
 {
+  guint i;
+
   GST_LOG ("Put port refcount %d->%d", udpport->refcount, udpport->refcount-1);
 
   g_mutex_lock (&trans->priv->mutex);
@@ -952,6 +1311,35 @@ fs_rawudp_transmitter_put_udpport (FsRawUdpTransmitter *trans,
     gst_object_unref (udpport->udpsrc_requested_pad);
   }
 
+  for (i = 0; i < udpport->n_extra_shards; i++)
+  {
+    if (udpport->shard_srcs[i])
+    {
+      GstStateChangeReturn ret;
+      gst_element_set_locked_state (udpport->shard_srcs[i], TRUE);
+      ret = gst_element_set_state (udpport->shard_srcs[i], GST_STATE_NULL);
+      if (ret != GST_STATE_CHANGE_SUCCESS)
+        GST_ERROR ("Error changing state of udpsrc shard: %s",
+            gst_element_state_change_return_get_name (ret));
+      if (!gst_bin_remove (GST_BIN (trans->priv->gst_src),
+              udpport->shard_srcs[i]))
+        GST_ERROR ("Could not remove udpsrc shard from transmitter source");
+    }
+
+    if (udpport->shard_requested_pads[i])
+    {
+      gst_element_release_request_pad (udpport->funnel,
+          udpport->shard_requested_pads[i]);
+      gst_object_unref (udpport->shard_requested_pads[i]);
+    }
+
+    g_socket_close (udpport->shard_sockets[i], NULL);
+    g_object_unref (udpport->shard_sockets[i]);
+  }
+  g_free (udpport->shard_sockets);
+  g_free (udpport->shard_srcs);
+  g_free (udpport->shard_requested_pads);
+
   if (udpport->udpsink_requested_pad)
   {
     gst_element_release_request_pad (udpport->tee,
@@ -972,17 +1360,37 @@ fs_rawudp_transmitter_put_udpport (FsRawUdpTransmitter *trans,
   }
 
   if (udpport->socket)
-    g_socket_close (udpport->socket, NULL);
+  {
+    gboolean pooled = FALSE;
+
+    /* The wildcard ports are all reserved in the allocator, but sockets
+     * shared with SO_REUSEPORT are not reused */
+    if (!udpport->requested_ip)
+    {
+      if (!udpport->shard_sockets)
+        _drain_socket (udpport->socket);
+
+      fs_rawudp_port_allocator_lock (trans->priv->port_allocator);
+      if (!udpport->shard_sockets)
+        pooled = fs_rawudp_port_allocator_recycle (trans->priv->port_allocator,
+            udpport->component_id, udpport->port, udpport->socket);
+      if (!pooled)
+        fs_rawudp_port_allocator_release (trans->priv->port_allocator,
+            udpport->port);
+      fs_rawudp_port_allocator_unlock (trans->priv->port_allocator);
+    }
+
+    if (pooled)
+      udpport->socket = NULL;
+    else
+      g_socket_close (udpport->socket, NULL);
+  }
   g_clear_object (&udpport->socket);
 
   if (udpport->known_addresses)
-  {
-    guint i;
-    for (i = 0; i < udpport->known_addresses->len; i++)
-      g_object_unref (g_array_index (udpport->known_addresses,
-              struct KnownAddress, i).addr);
-    g_array_free (udpport->known_addresses, TRUE);
-  }
+    g_hash_table_unref (udpport->known_addresses);
+  if (udpport->shard_probes)
+    g_hash_table_unref (udpport->shard_probes);
 
   g_free (udpport->requested_ip);
   g_mutex_clear (&udpport->mutex);
@@ -1030,21 +1438,130 @@ fs_rawudp_transmitter_udpport_sendto (UdpPort *udpport,
   return ret;
 }
 
+struct RecvCallback {
+  GstPadProbeCallback callback;
+  gpointer user_data;
+};
+
+static void
+recv_callback_free (gpointer data)
+{
+  g_slice_free (struct RecvCallback, data);
+}
+
+/*
+ * The batched source pushes buffer lists, call the per-buffer callback
+ * on each of them and remove the ones it wants to drop
+ */
+
+static GstPadProbeReturn
+_buffer_list_recv_probe (GstPad *pad, GstPadProbeInfo *info,
+    gpointer user_data)
+{
+  struct RecvCallback *rc = user_data;
+  GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+  GstPadProbeInfo buffer_info = *info;
+  guint i = 0;
+
+  buffer_info.type = (info->type & ~GST_PAD_PROBE_TYPE_BUFFER_LIST) |
+      GST_PAD_PROBE_TYPE_BUFFER;
+
+  while (i < gst_buffer_list_length (list))
+  {
+    buffer_info.data = gst_buffer_list_get (list, i);
+
+    if (rc->callback (pad, &buffer_info, rc->user_data) == GST_PAD_PROBE_DROP)
+    {
+      list = gst_buffer_list_make_writable (list);
+      GST_PAD_PROBE_INFO_DATA (info) = list;
+      gst_buffer_list_remove (list, i, 1);
+    }
+    else
+    {
+      i++;
+    }
+  }
+
+  if (gst_buffer_list_length (list) == 0)
+    return GST_PAD_PROBE_DROP;
+
+  return GST_PAD_PROBE_OK;
+}
+
+static gulong
+_add_recv_probe (UdpPort *udpport, GstElement *src,
+    GstPadProbeCallback callback, gpointer user_data)
+{
+  GstPad *pad;
+  gulong id;
+
+  pad = gst_element_get_static_pad (src, "src");
+
+  if (udpport->batched)
+  {
+    struct RecvCallback *rc = g_slice_new (struct RecvCallback);
+
+    rc->callback = callback;
+    rc->user_data = user_data;
+    id = gst_pad_add_probe (pad,
+        GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        _buffer_list_recv_probe, rc, recv_callback_free);
+  }
+  else
+  {
+    id = gst_pad_add_probe (pad,
+        GST_PAD_PROBE_TYPE_BUFFER,
+        callback, user_data, NULL);
+  }
+
+  gst_object_unref (pad);
+
+  return id;
+}
+
+static void
+_remove_recv_probe (GstElement *src, gulong id)
+{
+  GstPad *pad = gst_element_get_static_pad (src, "src");
+
+  gst_pad_remove_probe (pad, id);
+
+  gst_object_unref (pad);
+}
+
+/*
+ * The id returned is the one of the probe on the first shard, the probes on
+ * the other shards are looked up from it
+ */
+
 gulong
 fs_rawudp_transmitter_udpport_connect_recv (UdpPort *udpport,
     GstPadProbeCallback callback,
     gpointer user_data)
 {
-  GstPad *pad;
+  GArray *shard_ids;
   gulong id;
+  guint i;
 
-  pad = gst_element_get_static_pad (udpport->udpsrc, "src");
+  id = _add_recv_probe (udpport, udpport->udpsrc, callback, user_data);
 
-  id = gst_pad_add_probe (pad,
-      GST_PAD_PROBE_TYPE_BUFFER,
-      callback, user_data, NULL);
+  if (udpport->n_extra_shards == 0)
+    return id;
 
-  gst_object_unref (pad);
+  shard_ids = g_array_sized_new (FALSE, FALSE, sizeof (gulong),
+      udpport->n_extra_shards);
+  for (i = 0; i < udpport->n_extra_shards; i++)
+  {
+    gulong shard_id = _add_recv_probe (udpport, udpport->shard_srcs[i],
+        callback, user_data);
+
+    g_array_append_val (shard_ids, shard_id);
+  }
+
+  g_mutex_lock (&udpport->mutex);
+  g_hash_table_insert (udpport->shard_probes, GSIZE_TO_POINTER (id),
+      shard_ids);
+  g_mutex_unlock (&udpport->mutex);
 
   return id;
 }
@@ -1054,21 +1571,37 @@ void
 fs_rawudp_transmitter_udpport_disconnect_recv (UdpPort *udpport,
     gulong id)
 {
-  GstPad *pad = gst_element_get_static_pad (udpport->udpsrc, "src");
+  GArray *shard_ids = NULL;
+  guint i;
 
-  gst_pad_remove_probe (pad, id);
+  _remove_recv_probe (udpport->udpsrc, id);
 
-  gst_object_unref (pad);
+  if (udpport->n_extra_shards == 0)
+    return;
+
+  g_mutex_lock (&udpport->mutex);
+  if (g_hash_table_lookup_extended (udpport->shard_probes,
+          GSIZE_TO_POINTER (id), NULL, (gpointer *) &shard_ids))
+    g_hash_table_steal (udpport->shard_probes, GSIZE_TO_POINTER (id));
+  g_mutex_unlock (&udpport->mutex);
+
+  if (!shard_ids)
+    return;
+
+  for (i = 0; i < shard_ids->len; i++)
+    _remove_recv_probe (udpport->shard_srcs[i],
+        g_array_index (shard_ids, gulong, i));
+
+  g_array_unref (shard_ids);
 }
 
-gboolean
-fs_rawudp_transmitter_udpport_is_pad (UdpPort *udpport,
-    GstPad *pad)
+static gboolean
+_is_src_pad (GstElement *src, GstPad *pad)
 {
   GstPad *mypad;
   gboolean res;
 
-  mypad =  gst_element_get_static_pad (udpport->udpsrc, "src");
+  mypad =  gst_element_get_static_pad (src, "src");
 
   res = (mypad == pad);
 
@@ -1077,6 +1610,22 @@ fs_rawudp_transmitter_udpport_is_pad (UdpPort *udpport,
   return res;
 }
 
+gboolean
+fs_rawudp_transmitter_udpport_is_pad (UdpPort *udpport,
+    GstPad *pad)
+{
+  guint i;
+
+  if (_is_src_pad (udpport->udpsrc, pad))
+    return TRUE;
+
+  for (i = 0; i < udpport->n_extra_shards; i++)
+    if (_is_src_pad (udpport->shard_srcs[i], pad))
+      return TRUE;
+
+  return FALSE;
+}
+
 
 gint
 fs_rawudp_transmitter_udpport_get_port (UdpPort *udpport)
@@ -1111,45 +1660,48 @@ fs_rawudp_transmitter_udpport_add_known_address (UdpPort *udpport,
     FsRawUdpAddressUniqueCallbackFunc callback,
     gpointer user_data)
 {
-  gint i;
+  GSocketAddress *key = NULL;
+  GArray *kas = NULL;
   gboolean unique = FALSE;
   struct KnownAddress newka = {0};
-  guint counter = 0;
-  struct KnownAddress *prev_ka = NULL;
 
   g_mutex_lock (&udpport->mutex);
 
-  for (i = 0;
-       g_array_index (udpport->known_addresses,
-           struct KnownAddress, i).callback;
-       i++)
+  if (!g_hash_table_lookup_extended (udpport->known_addresses, address,
+          (gpointer *) &key, (gpointer *) &kas))
   {
-    struct KnownAddress *ka = &g_array_index (udpport->known_addresses,
-        struct KnownAddress, i);
-    if (fs_g_inet_socket_address_equal (address, ka->addr))
+    kas = g_array_sized_new (FALSE, FALSE, sizeof (struct KnownAddress), 1);
+    key = g_object_ref (address);
+    g_hash_table_insert (udpport->known_addresses, key, kas);
+    unique = TRUE;
+  }
+  else
+  {
+#ifndef G_DISABLE_ASSERT
+    guint i;
+
+    for (i = 0; i < kas->len; i++)
     {
+      struct KnownAddress *ka = &g_array_index (kas, struct KnownAddress, i);
       g_assert (!(ka->callback == callback && ka->user_data == user_data));
-
-      prev_ka = ka;
-      counter++;
     }
-  }
+#endif
 
-  if (counter == 0)
-  {
-    unique = TRUE;
-  }
-  else if (counter == 1)
-  {
-    if (prev_ka->callback)
-      prev_ka->callback (FALSE, prev_ka->addr, prev_ka->user_data);
+    /* Only the first other user has to be told, the others already know */
+    if (kas->len == 1)
+    {
+      struct KnownAddress *prev_ka = &g_array_index (kas,
+          struct KnownAddress, 0);
+
+      if (prev_ka->callback)
+        prev_ka->callback (FALSE, key, prev_ka->user_data);
+    }
   }
 
-  newka.addr = g_object_ref (address);
   newka.callback = callback;
   newka.user_data = user_data;
 
-  g_array_append_val (udpport->known_addresses, newka);
+  g_array_append_val (kas, newka);
 
   g_mutex_unlock (&udpport->mutex);
 
@@ -1175,45 +1727,44 @@ fs_rawudp_transmitter_udpport_remove_known_address (UdpPort *udpport,
     FsRawUdpAddressUniqueCallbackFunc callback,
     gpointer user_data)
 {
-  gint i;
-  gint remove_i = -1;
-  guint counter = 0;
-  struct KnownAddress *prev_ka = NULL;
+  GSocketAddress *key = NULL;
+  GArray *kas = NULL;
+  guint i;
 
   g_mutex_lock (&udpport->mutex);
 
-  for (i = 0;
-       g_array_index (udpport->known_addresses, struct KnownAddress, i).callback;
-       i++)
+  if (!g_hash_table_lookup_extended (udpport->known_addresses, address,
+          (gpointer *) &key, (gpointer *) &kas))
+    goto unknown;
+
+  for (i = 0; i < kas->len; i++)
   {
-    struct KnownAddress *ka = &g_array_index (udpport->known_addresses,
-        struct KnownAddress, i);
-    if (fs_g_inet_socket_address_equal (address, ka->addr))
-    {
-      if (ka->callback == callback && ka->user_data == user_data)
-      {
-        remove_i = i;
-      }
-      else
-      {
-        counter++;
-        prev_ka = ka;
-      }
-    }
+    struct KnownAddress *ka = &g_array_index (kas, struct KnownAddress, i);
+
+    if (ka->callback == callback && ka->user_data == user_data)
+      break;
   }
 
-  if (remove_i == -1)
+  if (i == kas->len)
+    goto unknown;
+
+  g_array_remove_index_fast (kas, i);
+
+  if (kas->len == 1)
   {
-    GST_ERROR ("Tried to remove unknown known address");
-    goto out;
+    struct KnownAddress *ka = &g_array_index (kas, struct KnownAddress, 0);
+
+    ka->callback (TRUE, key, ka->user_data);
+  }
+  else if (kas->len == 0)
+  {
+    g_hash_table_remove (udpport->known_addresses, key);
   }
 
-  if (counter == 1)
-    prev_ka->callback (TRUE, prev_ka->addr, prev_ka->user_data);
+  goto out;
 
-  g_object_unref (g_array_index (udpport->known_addresses,
-          struct KnownAddress, remove_i).addr);
-  g_array_remove_index_fast (udpport->known_addresses, remove_i);
+ unknown:
+  GST_ERROR ("Tried to remove unknown known address");
 
  out:
 
@@ -1256,6 +1807,136 @@ fs_rawudp_transmitter_set_type_of_service (FsRawUdpTransmitter *self,
 }
 
 
+static GSocket *
+_bind_exact_port (guint port, int tos)
+{
+  GInetAddress *addr = g_inet_address_new_any (G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *socket_addr = g_inet_socket_address_new (addr, port);
+  GSocket *socket;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+
+  if (socket && !g_socket_bind (socket, socket_addr, FALSE, NULL))
+  {
+    g_socket_close (socket, NULL);
+    g_clear_object (&socket);
+  }
+
+  if (socket)
+    _set_socket_tos (socket, tos);
+
+  g_object_unref (socket_addr);
+  g_object_unref (addr);
+
+  return socket;
+}
+
+/*
+ * Binds one socket per component on consecutive wildcard ports, the first
+ * one being the first free even port at or after *@port
+ */
+
+static gboolean
+_bind_pool_group (FsRawUdpTransmitter *self, guint *port, int tos,
+    GSocket **sockets)
+{
+  FsRawUdpPortAllocator *alloc = self->priv->port_allocator;
+  guint first;
+  guint c;
+
+ again:
+  fs_rawudp_port_allocator_lock (alloc);
+  first = fs_rawudp_port_allocator_reserve (alloc, *port, 2);
+  for (c = 2; first && c <= self->components; c++)
+  {
+    if (!fs_rawudp_port_allocator_reserve (alloc, first + c - 1, 0))
+    {
+      while (--c > 0)
+        fs_rawudp_port_allocator_release (alloc, first + c - 1);
+      *port = first + 2;
+      fs_rawudp_port_allocator_unlock (alloc);
+      goto again;
+    }
+  }
+  fs_rawudp_port_allocator_unlock (alloc);
+
+  if (!first)
+    return FALSE;
+
+  for (c = 1; c <= self->components; c++)
+  {
+    sockets[c] = _bind_exact_port (first + c - 1, tos);
+    if (!sockets[c])
+      break;
+  }
+
+  if (c <= self->components)
+  {
+    GST_INFO ("could not bind port %u for the socket pool", first + c - 1);
+
+    fs_rawudp_port_allocator_lock (alloc);
+    fs_rawudp_port_allocator_mark_busy (alloc, first + c - 1);
+    while (--c > 0)
+    {
+      fs_rawudp_port_allocator_release (alloc, first + c - 1);
+      g_socket_close (sockets[c], NULL);
+      g_clear_object (&sockets[c]);
+    }
+    fs_rawudp_port_allocator_unlock (alloc);
+
+    *port = first + 2;
+    goto again;
+  }
+
+  *port = first;
+  return TRUE;
+}
+
+static void
+fs_rawudp_transmitter_set_socket_pool_size (FsRawUdpTransmitter *self,
+    guint pool_size)
+{
+  GSocket **sockets = g_new0 (GSocket *, self->components + 1);
+  guint port = SOCKET_POOL_FIRST_PORT;
+  guint missing;
+  gint tos;
+  guint c;
+
+  g_mutex_lock (&self->priv->mutex);
+  tos = self->priv->type_of_service;
+  g_mutex_unlock (&self->priv->mutex);
+
+  fs_rawudp_port_allocator_lock (self->priv->port_allocator);
+  fs_rawudp_port_allocator_set_pool_size (self->priv->port_allocator,
+      pool_size);
+  missing = fs_rawudp_port_allocator_get_pool_missing (
+      self->priv->port_allocator);
+  fs_rawudp_port_allocator_unlock (self->priv->port_allocator);
+
+  /* The ports are reserved in the allocator, so they can be bound without
+   * holding the mutex */
+  for (; missing > 0; missing--)
+  {
+    if (!_bind_pool_group (self, &port, tos, sockets))
+    {
+      GST_WARNING ("Ran out of ports to fill the socket pool");
+      break;
+    }
+
+    fs_rawudp_port_allocator_lock (self->priv->port_allocator);
+    for (c = 1; c <= self->components; c++)
+      fs_rawudp_port_allocator_add_pooled (self->priv->port_allocator, c,
+          port + c - 1, sockets[c]);
+    fs_rawudp_port_allocator_unlock (self->priv->port_allocator);
+
+    port += self->components + (self->components % 2);
+  }
+
+  g_free (sockets);
+}
+
+
 /* TEMPORARY: should be in Glib */
 gboolean
 fs_g_inet_socket_address_equal (GSocketAddress *addr1, GSocketAddress *addr2)
@@ -1277,3 +1958,34 @@ fs_g_inet_socket_address_equal (GSocketAddress *addr1, GSocketAddress *addr2)
   else
     return FALSE;
 }
+
+gboolean
+fs_g_inet_socket_address_equal_func (gconstpointer addr1, gconstpointer addr2)
+{
+  return fs_g_inet_socket_address_equal ((GSocketAddress *) addr1,
+      (GSocketAddress *) addr2);
+}
+
+guint
+fs_g_inet_socket_address_hash (gconstpointer addr)
+{
+  GInetSocketAddress *inet;
+  GInetAddress *inetaddr;
+  const guint8 *bytes;
+  gsize size, i;
+  guint hash;
+
+  if (!G_IS_INET_SOCKET_ADDRESS (addr))
+    return g_direct_hash (addr);
+
+  inet = G_INET_SOCKET_ADDRESS (addr);
+  inetaddr = g_inet_socket_address_get_address (inet);
+  bytes = g_inet_address_to_bytes (inetaddr);
+  size = g_inet_address_get_native_size (inetaddr);
+
+  hash = g_inet_socket_address_get_port (inet);
+  for (i = 0; i < size; i++)
+    hash = (hash << 5) - hash + bytes[i];
+
+  return hash;
+}
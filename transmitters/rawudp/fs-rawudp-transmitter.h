@@ -93,6 +93,9 @@ struct _FsRawUdpTransmitter
 /* Private declaration */
 typedef struct _UdpPort UdpPort;
 
+/* The most sockets that can share one port */
+#define FS_RAWUDP_RECEIVE_SHARDS_MAX (64)
+
 typedef void (*FsRawUdpAddressUniqueCallbackFunc) (gboolean unique,
     GSocketAddress *address, gpointer user_data);
 
@@ -147,6 +150,9 @@ void fs_rawudp_transmitter_udpport_remove_known_address (UdpPort *udpport,
 
 gboolean fs_g_inet_socket_address_equal (GSocketAddress *addr1,
     GSocketAddress *addr2);
+gboolean fs_g_inet_socket_address_equal_func (gconstpointer addr1,
+    gconstpointer addr2);
+guint fs_g_inet_socket_address_hash (gconstpointer addr);
 
 G_END_DECLS
 
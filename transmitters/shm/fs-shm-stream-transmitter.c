@@ -363,6 +363,9 @@ got_buffer_func (GstBuffer *buffer, guint component, gpointer data)
 {
   FsShmStreamTransmitter *self = FS_SHM_STREAM_TRANSMITTER_CAST (data);
 
+  if (fs_stream_transmitter_get_source_validated (FS_STREAM_TRANSMITTER (self)))
+    return;
+
   g_signal_emit_by_name (self, "known-source-packet-received", component,
       buffer);
 }